@@ -0,0 +1,225 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Benchmark for the tablet scan path across controlled on-disk layouts.
+//
+// This builds a local tablet with a parameterized shape -- a number of
+// DiskRowSets, a number of delta files layered on each of them, a column
+// count, and a predicate selectivity -- then repeatedly scans it through
+// Tablet::NewRowIterator and reports rows/sec and CPU cycles per row.
+//
+// Results are printed to stdout as tab-separated lines prefixed with
+// "RESULT", one per scan iteration, so they can be scraped by scripts:
+//
+//   RESULT <rowsets> <deltas> <cols> <sel_pct> <rows> <wall_ms> <rows_per_sec> <cycles_per_row>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/iterator.h"
+#include "kudu/common/partial_row.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/scan_spec.h"
+#include "kudu/common/schema.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/walltime.h"
+#include "kudu/tablet/local_tablet_writer.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/tablet/tablet-harness.h"
+#include "kudu/util/env.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/status.h"
+#include "kudu/util/stopwatch.h"
+
+DEFINE_int32(num_rowsets, 10, "Number of DiskRowSets to create");
+DEFINE_int32(num_rows_per_rowset, 100000, "Number of rows to insert into each rowset");
+DEFINE_int32(num_delta_files, 2,
+             "Number of delta files to layer on each rowset. Each layer "
+             "updates a fraction of the rowset's rows and then flushes the "
+             "delta memstores.");
+DEFINE_int32(update_fraction_pct, 10,
+             "Percentage of each rowset's rows updated by each delta layer");
+DEFINE_int32(num_value_columns, 4, "Number of int32 value columns in the schema");
+DEFINE_int32(selectivity_pct, 100,
+             "Percentage of rows selected by the scan predicate. 100 scans "
+             "without a predicate.");
+DEFINE_int32(num_scan_iters, 5, "Number of times to scan the tablet");
+DEFINE_string(base_dir, "/tmp/tablet_scan_shape",
+              "Directory for the tablet data. Deleted and re-created on startup.");
+
+using std::string;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tablet {
+
+namespace {
+
+// The low-order part of the key determines the value of 'val_0', which the
+// selectivity predicate ranges over. Updates never change 'val_0', so the
+// predicate selects the same rows regardless of how many delta layers exist.
+int32_t SelectivityValue(int32_t key) {
+  return key % 100;
+}
+
+} // anonymous namespace
+
+class TabletScanShapeBenchmark {
+ public:
+  TabletScanShapeBenchmark() {
+    CHECK_GE(FLAGS_num_value_columns, 1) << "need at least one value column";
+    SchemaBuilder builder;
+    CHECK_OK(builder.AddKeyColumn("key", INT32));
+    for (int i = 0; i < FLAGS_num_value_columns; i++) {
+      CHECK_OK(builder.AddColumn(Substitute("val_$0", i), INT32));
+    }
+    client_schema_ = builder.BuildWithoutIds();
+  }
+
+  Status Run() {
+    Env* env = Env::Default();
+    if (env->FileExists(FLAGS_base_dir)) {
+      RETURN_NOT_OK(env->DeleteRecursively(FLAGS_base_dir));
+    }
+
+    TabletHarness::Options opts(FLAGS_base_dir);
+    harness_.reset(new TabletHarness(client_schema_, opts));
+    RETURN_NOT_OK(harness_->Create(/* first_time= */ true));
+    RETURN_NOT_OK(harness_->Open());
+
+    LOG_TIMING(INFO, "loading tablet") {
+      RETURN_NOT_OK(Load());
+    }
+
+    for (int i = 0; i < FLAGS_num_scan_iters; i++) {
+      RETURN_NOT_OK(Scan());
+    }
+    return Status::OK();
+  }
+
+ private:
+  // Build the requested layout: each rowset is a batch of contiguous keys
+  // flushed separately, and each delta layer updates a subset of every
+  // rowset's rows before the delta memstores are flushed.
+  Status Load() {
+    Tablet* tablet = harness_->tablet().get();
+    LocalTabletWriter writer(tablet, &client_schema_);
+    KuduPartialRow row(&client_schema_);
+
+    for (int r = 0; r < FLAGS_num_rowsets; r++) {
+      for (int i = 0; i < FLAGS_num_rows_per_rowset; i++) {
+        int32_t key = r * FLAGS_num_rows_per_rowset + i;
+        RETURN_NOT_OK(row.SetInt32("key", key));
+        RETURN_NOT_OK(row.SetInt32("val_0", SelectivityValue(key)));
+        for (int c = 1; c < FLAGS_num_value_columns; c++) {
+          RETURN_NOT_OK(row.SetInt32(Substitute("val_$0", c), key));
+        }
+        RETURN_NOT_OK(writer.Insert(row));
+      }
+      RETURN_NOT_OK(tablet->Flush());
+    }
+
+    int num_rows = FLAGS_num_rowsets * FLAGS_num_rows_per_rowset;
+    int stride = 100 / std::max(1, FLAGS_update_fraction_pct);
+    for (int d = 0; d < FLAGS_num_delta_files; d++) {
+      for (int32_t key = d % stride; key < num_rows; key += stride) {
+        RETURN_NOT_OK(row.SetInt32("key", key));
+        // Updates deliberately leave 'val_0' at its original value so that
+        // the predicate's selectivity is independent of the delta count.
+        RETURN_NOT_OK(row.SetInt32("val_0", SelectivityValue(key)));
+        for (int c = 1; c < FLAGS_num_value_columns; c++) {
+          RETURN_NOT_OK(row.SetInt32(Substitute("val_$0", c), key + d + 1));
+        }
+        RETURN_NOT_OK(writer.Update(row));
+      }
+      // FlushBiggestDMS() only flushes a single rowset's delta memstore, so
+      // drain them all by calling it once per rowset.
+      for (int r = 0; r < FLAGS_num_rowsets; r++) {
+        RETURN_NOT_OK(tablet->FlushBiggestDMS());
+      }
+    }
+    return Status::OK();
+  }
+
+  Status Scan() {
+    Tablet* tablet = harness_->tablet().get();
+
+    gscoped_ptr<RowwiseIterator> iter;
+    RETURN_NOT_OK(tablet->NewRowIterator(client_schema_, &iter));
+
+    // An upper bound of 100 selects everything; elide the predicate entirely
+    // in that case to also cover the no-predicate path.
+    ScanSpec spec;
+    int32_t pred_lower = 0;
+    int32_t pred_upper = FLAGS_selectivity_pct;
+    if (FLAGS_selectivity_pct < 100) {
+      spec.AddPredicate(ColumnPredicate::Range(client_schema_.column(1),
+                                               &pred_lower, &pred_upper));
+    }
+    RETURN_NOT_OK(iter->Init(&spec));
+
+    Arena arena(1024, 4 * 1024 * 1024);
+    RowBlock block(iter->schema(), 1024, &arena);
+    uint64_t rows = 0;
+
+    MonoTime start = MonoTime::Now();
+    int64_t start_cycles = CycleClock::Now();
+    while (iter->HasNext()) {
+      arena.Reset();
+      RETURN_NOT_OK(iter->NextBlock(&block));
+      rows += block.selection_vector()->CountSelected();
+    }
+    int64_t cycles = CycleClock::Now() - start_cycles;
+    MonoDelta elapsed = MonoTime::Now() - start;
+
+    double wall_ms = elapsed.ToSeconds() * 1000.0;
+    double rows_per_sec = rows / elapsed.ToSeconds();
+    double cycles_per_row = rows > 0 ? static_cast<double>(cycles) / rows : 0;
+    std::cout << Substitute("RESULT\t$0\t$1\t$2\t$3\t$4\t$5\t$6\t$7",
+                            FLAGS_num_rowsets, FLAGS_num_delta_files,
+                            FLAGS_num_value_columns, FLAGS_selectivity_pct,
+                            rows, wall_ms, rows_per_sec, cycles_per_row)
+              << std::endl;
+    return Status::OK();
+  }
+
+  Schema client_schema_;
+  gscoped_ptr<TabletHarness> harness_;
+};
+
+} // namespace tablet
+} // namespace kudu
+
+int main(int argc, char* argv[]) {
+  FLAGS_logtostderr = 1;
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  kudu::InitGoogleLoggingSafe(argv[0]);
+
+  kudu::tablet::TabletScanShapeBenchmark benchmark;
+  CHECK_OK(benchmark.Run());
+  return 0;
+}
@@ -142,6 +142,34 @@ TEST_F(RpcLineItemDAOTest, TestInsert) {
   ASSERT_EQ(15, rows.size());
 }
 
+TEST_F(RpcLineItemDAOTest, TestScanTokens) {
+  for (int i = 1; i < 10; i++) {
+    for (int y = 0; y < 5; y++) {
+      dao_->WriteLine(boost::bind(BuildTestRow, i, y, _1));
+    }
+  }
+  dao_->FinishWriting();
+
+  vector<string> tokens;
+  ASSERT_OK(dao_->BuildTpch1ScanTokens(0, &tokens));
+  ASSERT_FALSE(tokens.empty());
+
+  // The tokens partition the query: executing all of them must yield every
+  // row exactly once.
+  int count = 0;
+  for (const string& token : tokens) {
+    gscoped_ptr<RpcLineItemDAO::Scanner> scanner;
+    dao_->OpenScannerForToken(token, &scanner);
+    client::KuduScanBatch batch;
+    while (scanner->HasMore()) {
+      scanner->GetNext(&batch);
+      count += batch.NumRows();
+    }
+    ASSERT_GE(scanner->bytes_scanned(), 0);
+  }
+  ASSERT_EQ(45, count);
+}
+
 TEST_F(RpcLineItemDAOTest, TestUpdate) {
   dao_->WriteLine(boost::bind(BuildTestRow, 1, 1, _1));
   dao_->FinishWriting();
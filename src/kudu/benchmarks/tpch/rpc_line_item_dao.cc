@@ -23,6 +23,8 @@
 #include "kudu/benchmarks/tpch/rpc_line_item_dao.h"
 #include "kudu/client/callbacks.h"
 #include "kudu/client/client.h"
+#include "kudu/client/resource_metrics.h"
+#include "kudu/client/scan_batch.h"
 #include "kudu/client/meta_cache.h"
 #include "kudu/client/value.h"
 #include "kudu/client/write_op.h"
@@ -45,7 +47,10 @@ using client::KuduClientBuilder;
 using client::KuduError;
 using client::KuduPredicate;
 using client::KuduRowResult;
+using client::KuduScanBatch;
 using client::KuduScanner;
+using client::KuduScanToken;
+using client::KuduScanTokenBuilder;
 using client::KuduSchema;
 using client::KuduSession;
 using client::KuduStatusCallback;
@@ -178,6 +183,42 @@ void RpcLineItemDAO::OpenTpch1Scanner(gscoped_ptr<Scanner>* out_scanner) {
   OpenScannerImpl(tpch::GetTpchQ1QueryColumns(), preds, out_scanner);
 }
 
+Status RpcLineItemDAO::BuildTpch1ScanTokens(uint64_t split_size_bytes,
+                                            vector<string>* out_tokens) {
+  KuduScanTokenBuilder builder(client_table_.get());
+  RETURN_NOT_OK(builder.SetProjectedColumnNames(tpch::GetTpchQ1QueryColumns()));
+  RETURN_NOT_OK(builder.AddConjunctPredicate(client_table_->NewComparisonPredicate(
+      tpch::kShipDateColName, KuduPredicate::LESS_EQUAL,
+      KuduValue::CopyString(kScanUpperBound))));
+  RETURN_NOT_OK(builder.SetCacheBlocks(FLAGS_tpch_cache_blocks_when_scanning));
+  RETURN_NOT_OK(builder.SetTimeoutMillis(timeout_.ToMilliseconds()));
+  if (split_size_bytes > 0) {
+    RETURN_NOT_OK(builder.SetSplitSizeBytes(split_size_bytes));
+  }
+
+  vector<KuduScanToken*> tokens;
+  ElementDeleter deleter(&tokens);
+  RETURN_NOT_OK(builder.Build(&tokens));
+
+  out_tokens->clear();
+  for (KuduScanToken* token : tokens) {
+    string buf;
+    RETURN_NOT_OK(token->Serialize(&buf));
+    out_tokens->push_back(std::move(buf));
+  }
+  return Status::OK();
+}
+
+void RpcLineItemDAO::OpenScannerForToken(const string& token,
+                                         gscoped_ptr<Scanner>* out_scanner) {
+  gscoped_ptr<Scanner> ret(new Scanner);
+  KuduScanner* scanner;
+  CHECK_OK(KuduScanToken::DeserializeIntoScanner(client_.get(), token, &scanner));
+  ret->scanner_.reset(scanner);
+  CHECK_OK(ret->scanner_->Open());
+  out_scanner->swap(ret);
+}
+
 void RpcLineItemDAO::OpenTpch1ScannerForOrderKeyRange(int64_t min_key, int64_t max_key,
                                                       gscoped_ptr<Scanner>* out_scanner) {
   vector<KuduPredicate*> preds;
@@ -239,4 +280,14 @@ void RpcLineItemDAO::Scanner::GetNext(vector<KuduRowResult> *rows) {
   CHECK_OK(scanner_->NextBatch(rows));
 }
 
+void RpcLineItemDAO::Scanner::GetNext(KuduScanBatch* batch) {
+  CHECK_OK(scanner_->NextBatch(batch));
+}
+
+int64_t RpcLineItemDAO::Scanner::bytes_scanned() const {
+  const client::ResourceMetrics& metrics = scanner_->GetResourceMetrics();
+  return metrics.GetMetric("cfile_cache_hit_bytes") +
+      metrics.GetMetric("cfile_cache_miss_bytes");
+}
+
 } // namespace kudu
@@ -54,6 +54,18 @@ class RpcLineItemDAO {
   // Calls OpenScanner with the tpch1 query parameters.
   void OpenTpch1Scanner(gscoped_ptr<Scanner>* scanner);
 
+  // Builds serialized scan tokens covering the tpch1 query (same projection
+  // and predicate as OpenTpch1Scanner), one per tablet, or several per
+  // tablet if 'split_size_bytes' is non-zero. The tokens partition the scan
+  // into disjoint ranges, so they can be handed to concurrent workers.
+  Status BuildTpch1ScanTokens(uint64_t split_size_bytes,
+                              std::vector<std::string>* tokens);
+
+  // Opens a scanner over the portion of the table described by a token
+  // obtained from BuildTpch1ScanTokens().
+  void OpenScannerForToken(const std::string& token,
+                           gscoped_ptr<Scanner>* scanner);
+
   // Opens a scanner with the TPCH Q1 projection and filter, plus range filter to only
   // select rows in the given order key range.
   void OpenTpch1ScannerForOrderKeyRange(int64_t min_orderkey, int64_t max_orderkey,
@@ -72,6 +84,14 @@ class RpcLineItemDAO {
     // Return the next batch of rows into '*rows'. Any existing data is cleared.
     void GetNext(std::vector<client::KuduRowResult> *rows);
 
+    // Batch-based variant of the above; the batch's rows are valid until the
+    // next call.
+    void GetNext(client::KuduScanBatch* batch);
+
+    // Return the number of bytes read from disk or block cache on behalf of
+    // this scanner so far, as reported by the server's resource metrics.
+    int64_t bytes_scanned() const;
+
    private:
     friend class RpcLineItemDAO;
     Scanner() {}
@@ -50,6 +50,7 @@
 #include "kudu/benchmarks/tpch/line_item_tsv_importer.h"
 #include "kudu/benchmarks/tpch/rpc_line_item_dao.h"
 #include "kudu/benchmarks/tpch/tpch-schemas.h"
+#include "kudu/client/scan_batch.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -84,6 +85,18 @@ DEFINE_int32(tpch_scaling_factor, 1,
 DEFINE_int32(tpch_num_inserters, 1,
              "Number of data inserters to run in parallel. Each inserter implies a new tablet "
              "in the table");
+DEFINE_int32(tpch_num_tablets, 0,
+             "Number of tablets to create the table with. Must be a multiple of "
+             "tpch_num_inserters so that each inserter writes a contiguous run of "
+             "tablets. The default (0) creates one tablet per inserter.");
+DEFINE_int32(tpch_num_query_threads, 1,
+             "Number of threads to run each query with. When more than one, the "
+             "query is split into per-tablet scan tokens which the threads "
+             "execute in parallel.");
+DEFINE_int64(tpch_scan_token_split_size_bytes, 0,
+             "If non-zero, further split each tablet's scan into tokens covering "
+             "approximately this much data, so more query threads than tablets "
+             "can be put to work.");
 DEFINE_string(tpch_master_addresses, "localhost",
               "Addresses of masters for the cluster to operate on if not using a mini cluster");
 DEFINE_string(tpch_mini_cluster_base_dir, "/tmp/tpch",
@@ -124,6 +137,14 @@ class TpchRealWorld {
 
   void RunQueriesThread();
 
+  void RunParallelQueriesThread();
+
+  void QueryWorkerThread(RpcLineItemDAO* dao,
+                         const vector<string>* tokens,
+                         AtomicInt<int32_t>* next_token,
+                         AtomicInt<int64_t>* rows_scanned,
+                         AtomicInt<int64_t>* bytes_scanned);
+
   void WaitForRowCount(int64_t row_count);
 
   Status Run();
@@ -244,12 +265,19 @@ gscoped_ptr<RpcLineItemDAO> TpchRealWorld::GetInittedDAO() {
   //
   // For example, when run with SF=2 and three chunks, the first keys for each
   // chunk are 1, 4000001, and 8000001.
-  int64_t increment = 6000000L * FLAGS_tpch_scaling_factor /
-      FLAGS_tpch_num_inserters;
+  //
+  // The table may be split into more tablets than there are inserters, as
+  // long as the tablet boundaries subdivide the dbgen chunks evenly, so that
+  // each inserter still writes a contiguous run of tablets.
+  int num_tablets = FLAGS_tpch_num_tablets > 0 ? FLAGS_tpch_num_tablets
+                                               : FLAGS_tpch_num_inserters;
+  CHECK_EQ(0, num_tablets % FLAGS_tpch_num_inserters)
+      << "tpch_num_tablets must be a multiple of tpch_num_inserters";
+  int64_t increment = 6000000L * FLAGS_tpch_scaling_factor / num_tablets;
 
   KuduSchema schema(tpch::CreateLineItemSchema());
   vector<const KuduPartialRow*> split_rows;
-  for (int64_t i = 1; i < FLAGS_tpch_num_inserters; i++) {
+  for (int64_t i = 1; i < num_tablets; i++) {
     KuduPartialRow* row = schema.NewRow();
     CHECK_OK(row->SetInt64(tpch::kOrderKeyColName, i * increment));
     CHECK_OK(row->SetInt32(tpch::kLineNumberColName, 0));
@@ -339,6 +367,90 @@ void TpchRealWorld::RunQueriesThread() {
   }
 }
 
+void TpchRealWorld::QueryWorkerThread(RpcLineItemDAO* dao,
+                                      const vector<string>* tokens,
+                                      AtomicInt<int32_t>* next_token,
+                                      AtomicInt<int64_t>* rows_scanned,
+                                      AtomicInt<int64_t>* bytes_scanned) {
+  while (!stop_threads_.Load()) {
+    int32_t idx = next_token->Increment() - 1;
+    if (idx >= static_cast<int32_t>(tokens->size())) {
+      return;
+    }
+    gscoped_ptr<RpcLineItemDAO::Scanner> scanner;
+    dao->OpenScannerForToken((*tokens)[idx], &scanner);
+    int64_t rows = 0;
+    client::KuduScanBatch batch;
+    while (scanner->HasMore() && !stop_threads_.Load()) {
+      scanner->GetNext(&batch);
+      rows += batch.NumRows();
+    }
+    rows_scanned->IncrementBy(rows);
+    bytes_scanned->IncrementBy(scanner->bytes_scanned());
+  }
+}
+
+void TpchRealWorld::RunParallelQueriesThread() {
+  gscoped_ptr<RpcLineItemDAO> dao = GetInittedDAO();
+  int64_t total_rows = 0;
+  double total_wall = 0;
+  double total_cpu = 0;
+  int run = 0;
+  while (!stop_threads_.Load()) {
+    run++;
+    vector<string> tokens;
+    CHECK_OK(dao->BuildTpch1ScanTokens(FLAGS_tpch_scan_token_split_size_bytes,
+                                       &tokens));
+    AtomicInt<int32_t> next_token(0);
+    AtomicInt<int64_t> rows_scanned(0);
+    AtomicInt<int64_t> bytes_scanned(0);
+
+    // ALL_THREADS CPU covers the whole process; when loading concurrently the
+    // cpu/row figure includes insert-side work, so it is only meaningful for
+    // query-only runs.
+    Stopwatch sw(Stopwatch::ALL_THREADS);
+    sw.start();
+    vector<scoped_refptr<kudu::Thread> > workers;
+    for (int i = 0; i < FLAGS_tpch_num_query_threads; i++) {
+      scoped_refptr<kudu::Thread> thr;
+      CHECK_OK(kudu::Thread::Create("test", Substitute("tpch1-worker$0", i),
+                                    &TpchRealWorld::QueryWorkerThread, this,
+                                    dao.get(), &tokens, &next_token,
+                                    &rows_scanned, &bytes_scanned,
+                                    &thr));
+      workers.push_back(thr);
+    }
+    for (const scoped_refptr<kudu::Thread>& thr : workers) {
+      CHECK_OK(ThreadJoiner(thr.get()).Join());
+    }
+    sw.stop();
+
+    // As with the serial query runner, a run truncated by shutdown must not
+    // be reported.
+    if (stop_threads_.Load()) break;
+
+    int64_t rows = rows_scanned.Load();
+    double wall = sw.elapsed().wall_seconds();
+    double cpu = sw.elapsed().user_cpu_seconds() + sw.elapsed().system_cpu_seconds();
+    total_rows += rows;
+    total_wall += wall;
+    total_cpu += cpu;
+    LOG(INFO) << Substitute(
+        "Query run $0: $1 tokens on $2 threads, $3 rows in $4s "
+        "($5 rows/sec, $6 MB/sec scanned, $7us cpu/row)",
+        run, tokens.size(), FLAGS_tpch_num_query_threads, rows,
+        StringPrintf("%.2f", wall),
+        StringPrintf("%.0f", rows / wall),
+        StringPrintf("%.2f", bytes_scanned.Load() / wall / (1024 * 1024)),
+        StringPrintf("%.2f", rows > 0 ? cpu * 1e6 / rows : 0));
+    LOG(INFO) << Substitute(
+        "Across $0 runs: $1 rows/sec, $2us cpu/row",
+        run,
+        StringPrintf("%.0f", total_rows / total_wall),
+        StringPrintf("%.2f", total_rows > 0 ? total_cpu * 1e6 / total_rows : 0));
+  }
+}
+
 void TpchRealWorld::WaitForRowCount(int64_t row_count) {
   while (rows_inserted_.Load() < row_count) {
     SleepFor(MonoDelta::FromMilliseconds(100));
@@ -367,9 +479,15 @@ Status TpchRealWorld::Run() {
 
   if (FLAGS_tpch_run_queries) {
     scoped_refptr<kudu::Thread> thr;
-    RETURN_NOT_OK(kudu::Thread::Create("test", "lineitem-query",
-                                       &TpchRealWorld::RunQueriesThread, this,
-                                       &thr));
+    if (FLAGS_tpch_num_query_threads > 1) {
+      RETURN_NOT_OK(kudu::Thread::Create("test", "lineitem-query",
+                                         &TpchRealWorld::RunParallelQueriesThread, this,
+                                         &thr));
+    } else {
+      RETURN_NOT_OK(kudu::Thread::Create("test", "lineitem-query",
+                                         &TpchRealWorld::RunQueriesThread, this,
+                                         &thr));
+    }
     threads.push_back(thr);
   }
 
@@ -0,0 +1,372 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Benchmark for the full tablet write path.
+//
+// This stands up a single-replica TabletPeer backed by a real WAL and
+// drives it with concurrent write batches, exercising the same stack a
+// tablet server write RPC goes through once decoded: transaction prepare
+// and locking, local consensus replication, WAL append, and apply into the
+// MRS. Batch size, writer thread count, and key distribution (sequential,
+// uniform, or zipfian) are configurable.
+//
+// Reports rows/sec and per-batch latency percentiles from an HdrHistogram.
+// Results are printed to stdout as a tab-separated line prefixed with
+// "RESULT" so they can be scraped by scripts:
+//
+//   RESULT <threads> <batch> <dist> <rows> <wall_ms> <rows_per_sec> \
+//       <p50_us> <p95_us> <p99_us> <p999_us> <max_us>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/common/partial_row.h"
+#include "kudu/common/row_operations.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/wire_protocol.h"
+#include "kudu/consensus/consensus_meta.h"
+#include "kudu/consensus/log.h"
+#include "kudu/consensus/log_util.h"
+#include "kudu/gutil/bind.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/rpc/messenger.h"
+#include "kudu/rpc/result_tracker.h"
+#include "kudu/server/clock.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/tablet/tablet-harness.h"
+#include "kudu/tablet/tablet_peer.h"
+#include "kudu/tablet/transactions/transaction.h"
+#include "kudu/tablet/transactions/write_transaction.h"
+#include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/env.h"
+#include "kudu/util/hdr_histogram.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/pb_util.h"
+#include "kudu/util/random.h"
+#include "kudu/util/status.h"
+#include "kudu/util/threadpool.h"
+
+DEFINE_int32(num_writer_threads, 4, "Number of concurrent writer threads");
+DEFINE_int32(batch_size, 100, "Number of rows per write batch");
+DEFINE_int32(num_batches_per_thread, 1000,
+             "Number of write batches each thread submits");
+DEFINE_string(key_distribution, "sequential",
+              "Key distribution: one of 'sequential' (each thread writes a "
+              "disjoint increasing key range), 'uniform', or 'zipfian' "
+              "(YCSB-style, theta=0.99)");
+DEFINE_int64(key_space, 10 * 1000 * 1000,
+             "Number of distinct keys for the uniform and zipfian "
+             "distributions");
+DEFINE_int32(num_value_columns, 4, "Number of int32 value columns in the schema");
+DEFINE_string(base_dir, "/tmp/write_path_bench",
+              "Directory for the tablet data and WAL. Deleted and re-created "
+              "on startup.");
+
+METRIC_DECLARE_entity(tablet);
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tablet {
+
+using consensus::ConsensusBootstrapInfo;
+using consensus::ConsensusMetadata;
+using consensus::RaftConfigPB;
+using consensus::RaftPeerPB;
+using log::Log;
+using log::LogOptions;
+using rpc::Messenger;
+using rpc::MessengerBuilder;
+using tserver::WriteRequestPB;
+using tserver::WriteResponsePB;
+
+namespace {
+
+// YCSB-style bounded zipfian generator (theta = 0.99). The zeta constant is
+// computed once up front; generation itself is O(1).
+class ZipfianGenerator {
+ public:
+  explicit ZipfianGenerator(int64_t n)
+      : n_(n),
+        theta_(0.99) {
+    zetan_ = 0;
+    for (int64_t i = 1; i <= n_; i++) {
+      zetan_ += 1.0 / pow(static_cast<double>(i), theta_);
+    }
+    zeta2_ = 1.0 + 1.0 / pow(2.0, theta_);
+    alpha_ = 1.0 / (1.0 - theta_);
+    eta_ = (1 - pow(2.0 / n_, 1 - theta_)) / (1 - zeta2_ / zetan_);
+  }
+
+  int64_t Next(Random* rng) const {
+    double u = rng->NextDoubleFraction();
+    double uz = u * zetan_;
+    if (uz < 1.0) return 0;
+    if (uz < zeta2_) return 1;
+    return static_cast<int64_t>(n_ * pow(eta_ * u - eta_ + 1, alpha_));
+  }
+
+ private:
+  const int64_t n_;
+  const double theta_;
+  double zetan_;
+  double zeta2_;
+  double alpha_;
+  double eta_;
+};
+
+void TabletPeerStateChanged(const string& tablet_id, const string& reason) {
+  LOG(INFO) << "Tablet peer state changed for tablet " << tablet_id
+            << ". Reason: " << reason;
+}
+
+} // anonymous namespace
+
+class WritePathBenchmark {
+ public:
+  WritePathBenchmark() {
+    CHECK_GE(FLAGS_num_value_columns, 1) << "need at least one value column";
+    CHECK(FLAGS_key_distribution == "sequential" ||
+          FLAGS_key_distribution == "uniform" ||
+          FLAGS_key_distribution == "zipfian")
+        << "unknown key distribution: " << FLAGS_key_distribution;
+    SchemaBuilder builder;
+    CHECK_OK(builder.AddKeyColumn("key", INT64));
+    for (int i = 0; i < FLAGS_num_value_columns; i++) {
+      CHECK_OK(builder.AddColumn(Substitute("val_$0", i), INT32));
+    }
+    client_schema_ = builder.BuildWithoutIds();
+  }
+
+  Status Run() {
+    RETURN_NOT_OK(SetUpPeer());
+
+    if (FLAGS_key_distribution == "zipfian") {
+      zipfian_.reset(new ZipfianGenerator(FLAGS_key_space));
+    }
+
+    HdrHistogram latency_us(10 * 1000 * 1000, 3);
+    MonoTime start = MonoTime::Now();
+
+    vector<std::thread> threads;
+    vector<unique_ptr<HdrHistogram>> thread_histos;
+    for (int t = 0; t < FLAGS_num_writer_threads; t++) {
+      thread_histos.emplace_back(new HdrHistogram(10 * 1000 * 1000, 3));
+      threads.emplace_back(&WritePathBenchmark::WriterThread, this,
+                           t, thread_histos.back().get());
+    }
+    for (std::thread& t : threads) {
+      t.join();
+    }
+
+    MonoDelta elapsed = MonoTime::Now() - start;
+    for (const unique_ptr<HdrHistogram>& h : thread_histos) {
+      latency_us.MergeFrom(*h);
+    }
+
+    int64_t rows = static_cast<int64_t>(FLAGS_num_writer_threads) *
+        FLAGS_num_batches_per_thread * FLAGS_batch_size;
+    double wall_ms = elapsed.ToSeconds() * 1000.0;
+    double rows_per_sec = rows / elapsed.ToSeconds();
+
+    LOG(INFO) << Substitute(
+        "wrote $0 rows in $1ms ($2 rows/sec): "
+        "p50=$3us p95=$4us p99=$5us p99.9=$6us max=$7us",
+        rows, wall_ms, rows_per_sec,
+        latency_us.ValueAtPercentile(50),
+        latency_us.ValueAtPercentile(95),
+        latency_us.ValueAtPercentile(99),
+        latency_us.ValueAtPercentile(99.9),
+        latency_us.MaxValue());
+
+    std::cout << "RESULT"
+              << "\t" << FLAGS_num_writer_threads
+              << "\t" << FLAGS_batch_size
+              << "\t" << FLAGS_key_distribution
+              << "\t" << rows
+              << "\t" << wall_ms
+              << "\t" << rows_per_sec
+              << "\t" << latency_us.ValueAtPercentile(50)
+              << "\t" << latency_us.ValueAtPercentile(95)
+              << "\t" << latency_us.ValueAtPercentile(99)
+              << "\t" << latency_us.ValueAtPercentile(99.9)
+              << "\t" << latency_us.MaxValue()
+              << std::endl;
+
+    TearDownPeer();
+    return Status::OK();
+  }
+
+ private:
+  // Stand up a single-replica TabletPeer on a fresh filesystem layout, the
+  // same way TSTabletManager does modulo bootstrap (the tablet is new, so
+  // there is nothing to replay).
+  Status SetUpPeer() {
+    Env* env = Env::Default();
+    if (env->FileExists(FLAGS_base_dir)) {
+      RETURN_NOT_OK(env->DeleteRecursively(FLAGS_base_dir));
+    }
+
+    TabletHarness::Options opts(FLAGS_base_dir);
+    harness_.reset(new TabletHarness(client_schema_, opts));
+    RETURN_NOT_OK(harness_->Create(/* first_time= */ true));
+    RETURN_NOT_OK(harness_->Open());
+
+    RETURN_NOT_OK(ThreadPoolBuilder("apply").Build(&apply_pool_));
+    RETURN_NOT_OK(MessengerBuilder("write_path_bench").Build(&messenger_));
+
+    metric_entity_ = METRIC_ENTITY_tablet.Instantiate(&metric_registry_,
+                                                      "write-path-bench");
+
+    FsManager* fs_manager = harness_->fs_manager();
+    const string& tablet_id = harness_->tablet()->tablet_id();
+
+    RaftPeerPB config_peer;
+    config_peer.set_permanent_uuid(fs_manager->uuid());
+    config_peer.mutable_last_known_addr()->set_host("0.0.0.0");
+    config_peer.mutable_last_known_addr()->set_port(0);
+    config_peer.set_member_type(RaftPeerPB::VOTER);
+
+    tablet_peer_.reset(
+        new TabletPeer(make_scoped_refptr(harness_->tablet()->metadata()),
+                       config_peer,
+                       apply_pool_.get(),
+                       nullptr,
+                       Bind(&TabletPeerStateChanged, tablet_id)));
+
+    RaftConfigPB config;
+    config.add_peers()->CopyFrom(config_peer);
+    config.set_opid_index(consensus::kInvalidOpIdIndex);
+
+    unique_ptr<ConsensusMetadata> cmeta;
+    RETURN_NOT_OK(ConsensusMetadata::Create(fs_manager, tablet_id,
+                                            fs_manager->uuid(), config,
+                                            consensus::kMinimumTerm, &cmeta));
+
+    scoped_refptr<Log> log;
+    RETURN_NOT_OK(Log::Open(LogOptions(), fs_manager, tablet_id,
+                            *harness_->tablet()->schema(),
+                            harness_->tablet()->metadata()->schema_version(),
+                            metric_entity_.get(), &log));
+
+    tablet_peer_->SetBootstrapping();
+    RETURN_NOT_OK(tablet_peer_->Init(harness_->tablet(),
+                                     scoped_refptr<server::Clock>(harness_->clock()),
+                                     messenger_,
+                                     scoped_refptr<rpc::ResultTracker>(),
+                                     log,
+                                     metric_entity_));
+
+    ConsensusBootstrapInfo boot_info;
+    RETURN_NOT_OK(tablet_peer_->Start(boot_info));
+    return tablet_peer_->consensus()->WaitUntilLeaderForTests(
+        MonoDelta::FromSeconds(10));
+  }
+
+  void TearDownPeer() {
+    tablet_peer_->Shutdown();
+    apply_pool_->Shutdown();
+  }
+
+  int64_t NextKey(int thread_idx, int64_t n, Random* rng) const {
+    if (FLAGS_key_distribution == "sequential") {
+      return static_cast<int64_t>(thread_idx) *
+          FLAGS_num_batches_per_thread * FLAGS_batch_size + n;
+    }
+    if (FLAGS_key_distribution == "uniform") {
+      return rng->Next64() % FLAGS_key_space;
+    }
+    return zipfian_->Next(rng);
+  }
+
+  // Submit 'num_batches_per_thread' write batches, recording the
+  // submit-to-apply latency of each in 'histo' in microseconds.
+  void WriterThread(int thread_idx, HdrHistogram* histo) {
+    Random rng(thread_idx + 1);
+    int64_t n = 0;
+    for (int b = 0; b < FLAGS_num_batches_per_thread; b++) {
+      WriteRequestPB req;
+      req.set_tablet_id(tablet_peer_->tablet_id());
+      CHECK_OK(SchemaToPB(client_schema_, req.mutable_schema()));
+
+      KuduPartialRow row(&client_schema_);
+      RowOperationsPBEncoder enc(req.mutable_row_operations());
+      for (int i = 0; i < FLAGS_batch_size; i++) {
+        int64_t key = NextKey(thread_idx, n++, &rng);
+        CHECK_OK(row.SetInt64("key", key));
+        for (int c = 0; c < FLAGS_num_value_columns; c++) {
+          CHECK_OK(row.SetInt32(Substitute("val_$0", c),
+                                static_cast<int32_t>(key) + c));
+        }
+        // Non-sequential distributions revisit keys, so write as UPSERT to
+        // keep row errors out of the measurement.
+        enc.Add(RowOperationsPB::UPSERT, row);
+      }
+
+      WriteResponsePB resp;
+      unique_ptr<WriteTransactionState> tx_state(
+          new WriteTransactionState(tablet_peer_.get(), &req,
+                                    nullptr, // No RequestIdPB
+                                    &resp));
+      CountDownLatch rpc_latch(1);
+      tx_state->set_completion_callback(gscoped_ptr<TransactionCompletionCallback>(
+          new LatchTransactionCompletionCallback<WriteResponsePB>(&rpc_latch, &resp)));
+
+      MonoTime submit_time = MonoTime::Now();
+      CHECK_OK(tablet_peer_->SubmitWrite(std::move(tx_state)));
+      rpc_latch.Wait();
+      CHECK(!resp.has_error()) << "Write failed: " << SecureDebugString(resp);
+      histo->Increment((MonoTime::Now() - submit_time).ToMicroseconds());
+    }
+  }
+
+  Schema client_schema_;
+  gscoped_ptr<TabletHarness> harness_;
+  gscoped_ptr<ThreadPool> apply_pool_;
+  std::shared_ptr<Messenger> messenger_;
+  MetricRegistry metric_registry_;
+  scoped_refptr<MetricEntity> metric_entity_;
+  scoped_refptr<TabletPeer> tablet_peer_;
+  unique_ptr<ZipfianGenerator> zipfian_;
+};
+
+} // namespace tablet
+} // namespace kudu
+
+int main(int argc, char* argv[]) {
+  FLAGS_logtostderr = 1;
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  kudu::InitGoogleLoggingSafe(argv[0]);
+
+  kudu::tablet::WritePathBenchmark benchmark;
+  CHECK_OK(benchmark.Run());
+  return 0;
+}
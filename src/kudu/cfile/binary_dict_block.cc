@@ -279,6 +279,12 @@ Status BinaryDictBlockDecoder::CopyNextAndEval(size_t* n,
     return CopyNextDecodeStrings(n, dst);
   }
 
+  // If every word in the dictionary satisfies the predicate, there is no
+  // need to test each row's codeword; decode the strings directly.
+  if (parent_cfile_iter_->CodeWordsMatchAllPredicate()) {
+    return CopyNextDecodeStrings(n, dst);
+  }
+
   // Load the rows' codeword values into a buffer for scanning.
   BShufBlockDecoder<UINT32>* d_bptr = down_cast<BShufBlockDecoder<UINT32>*>(data_decoder_.get());
   codeword_buf_.resize(*n * sizeof(uint32_t));
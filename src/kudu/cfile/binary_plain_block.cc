@@ -25,6 +25,7 @@
 #include "kudu/common/columnblock.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/gutil/stringprintf.h"
+#include "kudu/util/alignment.h"
 #include "kudu/util/coding.h"
 #include "kudu/util/coding-inl.h"
 #include "kudu/util/group_varint-inl.h"
@@ -179,20 +180,28 @@ Status BinaryPlainBlockDecoder::ParseHeader() {
                    offsets_pos, data_.size()));
   }
 
-  // Decode the string offsets themselves
+  // Decode the string offsets themselves.
+  //
+  // The entire offset array is decoded up front, so that seeks and
+  // random access within the block reduce to O(1) array indexing. The
+  // array is sized before decoding (always a whole number of groups of
+  // four, since that's what the decoders produce) so that the SSE
+  // decoder can write each group directly into place with no
+  // per-element bookkeeping.
   const uint8_t *p = data_.data() + offsets_pos;
   const uint8_t *limit = data_.data() + data_.size();
 
-  offsets_.clear();
-  offsets_.reserve(num_elems_);
+  // One extra entry for the end-of-data offset appended below.
+  offsets_buf_.resize(sizeof(uint32_t) * (KUDU_ALIGN_UP(num_elems_, 4) + 1));
+  uint32_t *out = reinterpret_cast<uint32_t *>(offsets_buf_.data());
 
   size_t rem = num_elems_;
+  const __m128i zero = _mm_setzero_si128();
   while (rem >= 4) {
-    uint32_t ints[4];
     if (p + 16 < limit) {
-      p = coding::DecodeGroupVarInt32_SSE(p, &ints[0], &ints[1], &ints[2], &ints[3]);
+      p = coding::DecodeGroupVarInt32_SSE_Add(p, out, zero);
     } else {
-      p = coding::DecodeGroupVarInt32_SlowButSafe(p, &ints[0], &ints[1], &ints[2], &ints[3]);
+      p = coding::DecodeGroupVarInt32_SlowButSafe(p, &out[0], &out[1], &out[2], &out[3]);
     }
     if (p > limit) {
       LOG(WARNING) << "bad block: " << HexDump(data_);
@@ -200,29 +209,24 @@ Status BinaryPlainBlockDecoder::ParseHeader() {
         StringPrintf("unable to decode offsets in block"));
     }
 
-    offsets_.push_back(ints[0]);
-    offsets_.push_back(ints[1]);
-    offsets_.push_back(ints[2]);
-    offsets_.push_back(ints[3]);
+    out += 4;
     rem -= 4;
   }
 
   if (rem > 0) {
-    uint32_t ints[4];
-    p = coding::DecodeGroupVarInt32_SlowButSafe(p, &ints[0], &ints[1], &ints[2], &ints[3]);
+    // The rounded-up allocation guarantees room for the full group of four.
+    p = coding::DecodeGroupVarInt32_SlowButSafe(p, &out[0], &out[1], &out[2], &out[3]);
     if (p > limit) {
       LOG(WARNING) << "bad block: " << HexDump(data_);
       return Status::Corruption(
         StringPrintf("unable to decode offsets in block"));
     }
-
-    for (int i = 0; i < rem; i++) {
-      offsets_.push_back(ints[i]);
-    }
+    out += rem;
   }
 
   // Add one extra entry pointing after the last item to make the indexing easier.
-  offsets_.push_back(offsets_pos);
+  *out++ = offsets_pos;
+  offsets_buf_.resize(sizeof(uint32_t) * (num_elems_ + 1));
 
   parsed_ = true;
 
@@ -122,8 +122,8 @@ class BinaryPlainBlockDecoder final : public BlockDecoder {
   }
 
   Slice string_at_index(size_t idx) const {
-    const uint32_t offset = offsets_[idx];
-    uint32_t len = offsets_[idx + 1] - offset;
+    const uint32_t offset = offsets()[idx];
+    uint32_t len = offsets()[idx + 1] - offset;
     return Slice(&data_[offset], len);
   }
 
@@ -139,13 +139,21 @@ class BinaryPlainBlockDecoder final : public BlockDecoder {
   template <typename CellHandler>
   Status HandleBatch(size_t* n, ColumnDataView* dst, CellHandler c);
 
+  const uint32_t* offsets() const {
+    return reinterpret_cast<const uint32_t*>(offsets_buf_.data());
+  }
+
   Slice data_;
   bool parsed_;
 
-  // The parsed offsets.
+  // The parsed offsets, as an array of uint32s.
   // This array also contains one extra offset at the end, pointing
   // _after_ the last entry. This makes the code much simpler.
-  std::vector<uint32_t> offsets_;
+  //
+  // A faststring is used rather than a vector<uint32_t> so that resizing
+  // doesn't have to zero-initialize memory which is about to be overwritten
+  // by the decoded offsets.
+  faststring offsets_buf_;
 
   uint32_t num_elems_;
   rowid_t ordinal_pos_base_;
@@ -15,11 +15,18 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <cstring>
+
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
 #include "kudu/cfile/block_cache.h"
 #include "kudu/util/cache.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/test_util.h"
+
+DECLARE_string(block_cache_ssd_path);
+DECLARE_int64(decoded_block_cache_capacity_mb);
 
 namespace kudu {
 namespace cfile {
@@ -35,11 +42,11 @@ TEST(TestBlockCache, TestBasics) {
   // Lookup something missing from cache
   {
     BlockCacheHandle handle;
-    ASSERT_FALSE(cache.Lookup(key, Cache::EXPECT_IN_CACHE, &handle));
+    ASSERT_FALSE(cache.Lookup(key, BlockCache::DATA_BLOCK, Cache::EXPECT_IN_CACHE, &handle));
     ASSERT_FALSE(handle.valid());
   }
 
-  BlockCache::PendingEntry data = cache.Allocate(key, data_size);
+  BlockCache::PendingEntry data = cache.Allocate(key, BlockCache::DATA_BLOCK, data_size);
   memcpy(data.val_ptr(), DATA_TO_CACHE, data_size);
 
   // Insert and re-lookup
@@ -49,7 +56,7 @@ TEST(TestBlockCache, TestBasics) {
   ASSERT_TRUE(inserted_handle.valid());
 
   BlockCacheHandle retrieved_handle;
-  ASSERT_TRUE(cache.Lookup(key, Cache::EXPECT_IN_CACHE, &retrieved_handle));
+  ASSERT_TRUE(cache.Lookup(key, BlockCache::DATA_BLOCK, Cache::EXPECT_IN_CACHE, &retrieved_handle));
   ASSERT_TRUE(retrieved_handle.valid());
 
   ASSERT_EQ(0, memcmp(retrieved_handle.data().data(), DATA_TO_CACHE, data_size));
@@ -57,9 +64,88 @@ TEST(TestBlockCache, TestBasics) {
   // Ensure that a lookup for a different offset doesn't
   // return this data.
   BlockCache::CacheKey key1(id, 3);
-  ASSERT_FALSE(cache.Lookup(key1, Cache::EXPECT_IN_CACHE, &retrieved_handle));
+  ASSERT_FALSE(cache.Lookup(key1, BlockCache::DATA_BLOCK, Cache::EXPECT_IN_CACHE, &retrieved_handle));
 }
 
+TEST(TestBlockCache, TestDecodedBlockCache) {
+  google::FlagSaver saver;
+  FLAGS_decoded_block_cache_capacity_mb = 16;
+
+  size_t data_size = strlen(DATA_TO_CACHE) + 1;
+  BlockCache cache(512 * 1024 * 1024);
+  ASSERT_TRUE(cache.decoded_cache_enabled());
+  BlockCache::FileId id(1234);
+  BlockCache::CacheKey key(id, 1);
+
+  // The decoded cache is keyed separately from the main cache: an entry in
+  // one is not visible in the other.
+  BlockCache::PendingEntry raw = cache.Allocate(key, BlockCache::DATA_BLOCK, data_size);
+  memcpy(raw.val_ptr(), DATA_TO_CACHE, data_size);
+  BlockCacheHandle raw_handle;
+  cache.Insert(&raw, &raw_handle);
+  {
+    BlockCacheHandle handle;
+    ASSERT_FALSE(cache.LookupDecoded(key, Cache::EXPECT_IN_CACHE, &handle));
+  }
+
+  BlockCache::PendingEntry decoded = cache.AllocateDecoded(key, data_size);
+  ASSERT_TRUE(decoded.valid());
+  memcpy(decoded.val_ptr(), DATA_TO_CACHE, data_size);
+  BlockCacheHandle inserted_handle;
+  cache.InsertDecoded(&decoded, &inserted_handle);
+  ASSERT_TRUE(inserted_handle.valid());
+
+  BlockCacheHandle retrieved_handle;
+  ASSERT_TRUE(cache.LookupDecoded(key, Cache::EXPECT_IN_CACHE, &retrieved_handle));
+  ASSERT_EQ(0, memcmp(retrieved_handle.data().data(), DATA_TO_CACHE, data_size));
+}
+
+TEST(TestBlockCache, TestDecodedBlockCacheDisabled) {
+  BlockCache cache(512 * 1024 * 1024);
+  ASSERT_FALSE(cache.decoded_cache_enabled());
+  BlockCache::CacheKey key(BlockCache::FileId(1234), 1);
+  BlockCacheHandle handle;
+  ASSERT_FALSE(cache.LookupDecoded(key, Cache::EXPECT_IN_CACHE, &handle));
+  ASSERT_FALSE(cache.AllocateDecoded(key, 16).valid());
+}
+
+
+class SsdTierBlockCacheTest : public KuduTest {
+ protected:
+  google::FlagSaver saver_;
+};
+
+TEST_F(SsdTierBlockCacheTest, TestEvictedBlocksServedFromTier) {
+  FLAGS_block_cache_ssd_path = GetTestPath("block_cache_ssd");
+
+  // Insert far more data than the in-memory cache can hold, forcing the
+  // earlier blocks to be evicted and admitted into the flash tier.
+  const size_t kBlockSize = 16 * 1024;
+  const int kNumBlocks = 1024;
+  BlockCache cache(1024 * 1024);
+  BlockCache::FileId id(1234);
+  for (int i = 0; i < kNumBlocks; i++) {
+    BlockCache::CacheKey key(id, i);
+    BlockCache::PendingEntry entry = cache.Allocate(key, BlockCache::DATA_BLOCK, kBlockSize);
+    ASSERT_TRUE(entry.valid());
+    memset(entry.val_ptr(), i & 0xff, kBlockSize);
+    BlockCacheHandle inserted;
+    cache.Insert(&entry, &inserted);
+  }
+
+  // Every block should still be resident in one tier or the other, and
+  // should come back with its original contents.
+  for (int i = 0; i < kNumBlocks; i++) {
+    BlockCache::CacheKey key(id, i);
+    BlockCacheHandle handle;
+    ASSERT_TRUE(cache.Lookup(key, BlockCache::DATA_BLOCK, Cache::EXPECT_IN_CACHE, &handle))
+        << "missing block " << i;
+    Slice data = handle.data();
+    ASSERT_EQ(kBlockSize, data.size());
+    ASSERT_EQ(i & 0xff, data.data()[0]);
+    ASSERT_EQ(i & 0xff, data.data()[kBlockSize - 1]);
+  }
+}
 
 } // namespace cfile
 } // namespace kudu
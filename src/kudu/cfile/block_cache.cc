@@ -15,14 +15,31 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include <gflags/gflags.h>
 
 #include "kudu/cfile/block_cache.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/strings/util.h"
 #include "kudu/util/cache.h"
+#include "kudu/util/env.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/logging.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/mutex.h"
+#include "kudu/util/path_util.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/status.h"
 #include "kudu/util/string_case.h"
 
 DEFINE_int64(block_cache_capacity_mb, 512, "block cache capacity in MB");
@@ -35,14 +52,278 @@ DEFINE_string(block_cache_type, "DRAM",
               "in a memory-mapped file using the NVML library.");
 TAG_FLAG(block_cache_type, experimental);
 
+DEFINE_string(block_cache_ssd_path, "",
+              "Directory in which to store second-tier block cache files, "
+              "expected to reside on flash storage. When set, blocks evicted "
+              "from the in-memory block cache are written to append-only "
+              "cache files in this directory, and block cache misses check "
+              "the flash tier before falling through to the data "
+              "directories. If empty, the second tier is disabled.");
+TAG_FLAG(block_cache_ssd_path, experimental);
+
+DEFINE_int64(block_cache_ssd_capacity_mb, 16384,
+             "Capacity of the flash-based second-tier block cache, in MB. "
+             "Only takes effect when --block_cache_ssd_path is set. When "
+             "the tier grows beyond this size, the oldest cache file is "
+             "dropped in its entirety.");
+TAG_FLAG(block_cache_ssd_capacity_mb, experimental);
+
+DEFINE_int64(decoded_block_cache_capacity_mb, 0,
+             "Capacity, in MB, of the cache of decoded block representations "
+             "(e.g. unshuffled bitshuffle-encoded blocks). Hot blocks cached "
+             "here skip per-scan decoding entirely, at the cost of holding "
+             "both the encoded and decoded forms in memory. If 0, decoded "
+             "blocks are not cached.");
+TAG_FLAG(decoded_block_cache_capacity_mb, advanced);
+TAG_FLAG(decoded_block_cache_capacity_mb, experimental);
+
+METRIC_DEFINE_counter(server, block_cache_data_hits,
+                      "Block Cache Data Block Hits", kudu::MetricUnit::kBlocks,
+                      "Number of data block lookups that found a block");
+METRIC_DEFINE_counter(server, block_cache_data_misses,
+                      "Block Cache Data Block Misses", kudu::MetricUnit::kBlocks,
+                      "Number of data block lookups that didn't yield a block");
+METRIC_DEFINE_counter(server, block_cache_index_hits,
+                      "Block Cache Index Block Hits", kudu::MetricUnit::kBlocks,
+                      "Number of index block lookups that found a block");
+METRIC_DEFINE_counter(server, block_cache_index_misses,
+                      "Block Cache Index Block Misses", kudu::MetricUnit::kBlocks,
+                      "Number of index block lookups that didn't yield a block");
+METRIC_DEFINE_counter(server, block_cache_bloom_hits,
+                      "Block Cache Bloom Filter Block Hits", kudu::MetricUnit::kBlocks,
+                      "Number of bloom filter block lookups that found a block");
+METRIC_DEFINE_counter(server, block_cache_bloom_misses,
+                      "Block Cache Bloom Filter Block Misses", kudu::MetricUnit::kBlocks,
+                      "Number of bloom filter block lookups that didn't yield a block");
+
 namespace kudu {
 
 class MetricEntity;
 
 namespace cfile {
 
+using std::shared_ptr;
+using std::string;
+using std::unordered_map;
+using std::vector;
+using strings::Substitute;
+
+// Flash-backed second tier for the block cache.
+//
+// Blocks evicted from the in-memory tier are appended to a series of
+// fixed-size cache files and tracked by an in-memory index. A lookup which
+// misses in memory consults the index and, on a hit, reads the block back
+// from flash so the caller can promote it into the in-memory tier again.
+//
+// Space is reclaimed in FIFO order: once the tier exceeds its capacity, the
+// oldest cache file is dropped along with its index entries. Since the index
+// is in-memory only, the tier does not survive restarts; stale cache files
+// are removed on startup.
+class BlockCacheSsdTier {
+ public:
+  BlockCacheSsdTier(string dir, int64_t capacity)
+      : dir_(std::move(dir)),
+        capacity_(capacity),
+        next_file_seq_(0),
+        total_bytes_(0) {
+  }
+
+  ~BlockCacheSsdTier() {
+    MutexLock l(lock_);
+    for (const auto& e : files_) {
+      WARN_NOT_OK(Env::Default()->DeleteFile(e.second.path),
+                  "Could not delete block cache tier file");
+    }
+  }
+
+  // Create the cache directory if necessary and remove any cache files
+  // left over from a previous process.
+  Status Init() {
+    Env* env = Env::Default();
+    if (!env->FileExists(dir_)) {
+      RETURN_NOT_OK(env->CreateDir(dir_));
+    }
+    vector<string> children;
+    RETURN_NOT_OK(env->GetChildren(dir_, &children));
+    for (const string& child : children) {
+      if (HasPrefixString(child, kFilePrefix)) {
+        RETURN_NOT_OK(env->DeleteFile(JoinPathSegments(dir_, child)));
+      }
+    }
+    return Status::OK();
+  }
+
+  // Admit the given block into the tier. Best-effort: failures to write are
+  // logged and the block is simply not admitted.
+  void Admit(Slice key, Slice value) {
+    MutexLock l(lock_);
+    string key_str = key.ToString();
+    if (ContainsKey(index_, key_str)) {
+      // CFile blocks are immutable, so an existing entry is still valid.
+      return;
+    }
+    if (files_.empty() || cur_file()->size >= kFileSizeBytes) {
+      Status s = RollFile();
+      if (PREDICT_FALSE(!s.ok())) {
+        KLOG_EVERY_N_SECS(WARNING, 60)
+            << "Could not roll block cache tier file: " << s.ToString();
+        return;
+      }
+    }
+    FileState* f = cur_file();
+    Status s = f->file->Write(f->size, value);
+    if (PREDICT_FALSE(!s.ok())) {
+      KLOG_EVERY_N_SECS(WARNING, 60)
+          << "Could not write to block cache tier: " << s.ToString();
+      return;
+    }
+    IndexEntry entry = { cur_file_seq(), f->size, value.size() };
+    f->size += value.size();
+    f->keys.push_back(key_str);
+    total_bytes_ += value.size();
+    InsertOrDie(&index_, std::move(key_str), entry);
+
+    // Reclaim space by dropping whole files, oldest first. The file being
+    // appended to is never dropped.
+    while (total_bytes_ > capacity_ && files_.size() > 1) {
+      EvictOldestFile();
+    }
+  }
+
+  // Look up 'key' in the tier. On a hit, copies the block into 'out',
+  // removes the index entry (the caller promotes the block back into the
+  // in-memory tier, whence it may be re-admitted later), and returns true.
+  bool Lookup(Slice key, faststring* out) {
+    MutexLock l(lock_);
+    string key_str = key.ToString();
+    const IndexEntry* entry = FindOrNull(index_, key_str);
+    if (entry == nullptr) {
+      return false;
+    }
+    FileState& f = FindOrDie(files_, entry->file_seq);
+    out->resize(entry->length);
+    Slice read;
+    Status s = f.file->Read(entry->offset, entry->length, &read, out->data());
+    if (PREDICT_FALSE(!s.ok())) {
+      KLOG_EVERY_N_SECS(WARNING, 60)
+          << "Could not read from block cache tier: " << s.ToString();
+      index_.erase(key_str);
+      return false;
+    }
+    if (read.data() != out->data()) {
+      memcpy(out->data(), read.data(), read.size());
+    }
+    index_.erase(key_str);
+    return true;
+  }
+
+ private:
+  // The location of a cached block within the tier.
+  struct IndexEntry {
+    uint64_t file_seq;
+    uint64_t offset;
+    size_t length;
+  };
+
+  // One append-only cache file.
+  struct FileState {
+    shared_ptr<RWFile> file;
+    string path;
+    uint64_t size;
+
+    // The keys of all entries written to this file, so that the index can
+    // be pruned when the file is dropped.
+    vector<string> keys;
+  };
+
+  uint64_t cur_file_seq() const {
+    DCHECK(!files_.empty());
+    return files_.rbegin()->first;
+  }
+
+  FileState* cur_file() {
+    DCHECK(!files_.empty());
+    return &files_.rbegin()->second;
+  }
+
+  // Start a new cache file, which becomes the append target.
+  Status RollFile() {
+    string path = JoinPathSegments(
+        dir_, Substitute("$0.$1", kFilePrefix, next_file_seq_));
+    std::unique_ptr<RWFile> file;
+    RETURN_NOT_OK(Env::Default()->NewRWFile(path, &file));
+    FileState state;
+    state.file = shared_ptr<RWFile>(std::move(file));
+    state.path = path;
+    state.size = 0;
+    InsertOrDie(&files_, next_file_seq_, std::move(state));
+    next_file_seq_++;
+    return Status::OK();
+  }
+
+  // Drop the oldest cache file and all of its index entries.
+  void EvictOldestFile() {
+    auto it = files_.begin();
+    for (const string& key : it->second.keys) {
+      index_.erase(key);
+    }
+    total_bytes_ -= it->second.size;
+    WARN_NOT_OK(Env::Default()->DeleteFile(it->second.path),
+                "Could not delete block cache tier file");
+    files_.erase(it);
+  }
+
+  static const char* const kFilePrefix;
+  static const uint64_t kFileSizeBytes = 64 * 1024 * 1024;
+
+  const string dir_;
+  const int64_t capacity_;
+
+  // Guards all state below. Admissions and tier lookups are serialized;
+  // this is acceptable since both are off the hot (in-memory hit) path.
+  Mutex lock_;
+
+  // Cache files by sequence number; the highest sequence number is the
+  // current append target.
+  std::map<uint64_t, FileState> files_;
+  uint64_t next_file_seq_;
+
+  // Total bytes written across all live files.
+  int64_t total_bytes_;
+
+  unordered_map<string, IndexEntry> index_;
+
+  DISALLOW_COPY_AND_ASSIGN(BlockCacheSsdTier);
+};
+
+const char* const BlockCacheSsdTier::kFilePrefix = "block_cache_tier";
+
 namespace {
 
+// Admits blocks evicted from the in-memory cache into the flash tier.
+class SsdAdmissionCallback : public Cache::EvictionCallback {
+ public:
+  explicit SsdAdmissionCallback(BlockCacheSsdTier* tier) : tier_(tier) {}
+
+  void EvictedEntry(Slice key, Slice value) OVERRIDE {
+    tier_->Admit(key, value);
+  }
+
+ private:
+  BlockCacheSsdTier* tier_;
+};
+
+// Return the cache priority at which blocks of the given type are inserted.
+Cache::EntryPriority PriorityForBlockType(BlockCache::BlockType type) {
+  switch (type) {
+    case BlockCache::INDEX_BLOCK:
+    case BlockCache::BLOOM_BLOCK:
+      return Cache::HIGH_PRIORITY;
+    default:
+      return Cache::LOW_PRIORITY;
+  }
+}
+
 Cache* CreateCache(int64_t capacity) {
   CacheType t;
   ToUpperCase(FLAGS_block_cache_type, &FLAGS_block_cache_type);
@@ -65,32 +346,126 @@ BlockCache::BlockCache()
 
 BlockCache::BlockCache(size_t capacity)
   : cache_(CreateCache(capacity)) {
+  if (FLAGS_decoded_block_cache_capacity_mb > 0) {
+    decoded_cache_.reset(NewLRUCache(
+        DRAM_CACHE, FLAGS_decoded_block_cache_capacity_mb * 1024 * 1024,
+        "decoded_block_cache"));
+  }
+  if (!FLAGS_block_cache_ssd_path.empty()) {
+    gscoped_ptr<BlockCacheSsdTier> tier(
+        new BlockCacheSsdTier(FLAGS_block_cache_ssd_path,
+                              FLAGS_block_cache_ssd_capacity_mb * 1024 * 1024));
+    Status s = tier->Init();
+    if (s.ok()) {
+      ssd_tier_.swap(tier);
+      eviction_callback_.reset(new SsdAdmissionCallback(ssd_tier_.get()));
+    } else {
+      LOG(WARNING) << "Could not initialize flash-based block cache tier in "
+                   << FLAGS_block_cache_ssd_path << ": " << s.ToString()
+                   << "; continuing without a second tier";
+    }
+  }
+}
+
+BlockCache::~BlockCache() {
 }
 
-BlockCache::PendingEntry BlockCache::Allocate(const CacheKey& key, size_t val_size) {
+BlockCache::PendingEntry BlockCache::Allocate(const CacheKey& key, BlockType type,
+                                              size_t val_size) {
   Slice key_slice(reinterpret_cast<const uint8_t*>(&key), sizeof(key));
   int charge = val_size;
-  return PendingEntry(cache_.get(), cache_->Allocate(key_slice, val_size, charge));
+  return PendingEntry(cache_.get(),
+                      cache_->Allocate(key_slice, val_size, charge,
+                                       PriorityForBlockType(type)));
 }
 
-bool BlockCache::Lookup(const CacheKey& key, Cache::CacheBehavior behavior,
+bool BlockCache::Lookup(const CacheKey& key, BlockType type,
+                        Cache::CacheBehavior behavior,
                         BlockCacheHandle *handle) {
-  Cache::Handle *h = cache_->Lookup(Slice(reinterpret_cast<const uint8_t*>(&key),
-                                          sizeof(key)), behavior);
+  Slice key_slice(reinterpret_cast<const uint8_t*>(&key), sizeof(key));
+  Cache::Handle *h = cache_->Lookup(key_slice, behavior);
   if (h != nullptr) {
+    UpdateTypeMetrics(type, true);
     handle->SetHandle(cache_.get(), h);
+    return true;
+  }
+  if (ssd_tier_ == nullptr || behavior != Cache::EXPECT_IN_CACHE) {
+    UpdateTypeMetrics(type, false);
+    return false;
+  }
+
+  // Miss in memory: consult the flash tier, and on a hit promote the block
+  // back into the in-memory cache. The tier drops its own copy on a hit, so
+  // a block always lives in exactly one tier.
+  faststring buf;
+  if (!ssd_tier_->Lookup(key_slice, &buf)) {
+    UpdateTypeMetrics(type, false);
+    return false;
+  }
+  PendingEntry entry = Allocate(key, type, buf.size());
+  if (PREDICT_FALSE(!entry.valid())) {
+    UpdateTypeMetrics(type, false);
+    return false;
+  }
+  memcpy(entry.val_ptr(), buf.data(), buf.size());
+  Insert(&entry, handle);
+  UpdateTypeMetrics(type, true);
+  return true;
+}
+
+void BlockCache::UpdateTypeMetrics(BlockType type, bool hit) {
+  DCHECK_LT(type, kNumBlockTypes);
+  const scoped_refptr<Counter>& c = hit ? type_hits_[type] : type_misses_[type];
+  if (PREDICT_TRUE(c)) {
+    c->Increment();
   }
-  return h != nullptr;
 }
 
 void BlockCache::Insert(BlockCache::PendingEntry* entry, BlockCacheHandle* inserted) {
-  Cache::Handle *h = cache_->Insert(entry->handle_, /* eviction_callback= */ nullptr);
+  Cache::Handle *h = cache_->Insert(entry->handle_, eviction_callback_.get());
   entry->handle_ = nullptr;
   inserted->SetHandle(cache_.get(), h);
 }
 
+bool BlockCache::LookupDecoded(const CacheKey& key, Cache::CacheBehavior behavior,
+                               BlockCacheHandle* handle) {
+  if (decoded_cache_ == nullptr) {
+    return false;
+  }
+  Slice key_slice(reinterpret_cast<const uint8_t*>(&key), sizeof(key));
+  Cache::Handle* h = decoded_cache_->Lookup(key_slice, behavior);
+  if (h == nullptr) {
+    return false;
+  }
+  handle->SetHandle(decoded_cache_.get(), h);
+  return true;
+}
+
+BlockCache::PendingEntry BlockCache::AllocateDecoded(const CacheKey& key, size_t val_size) {
+  if (decoded_cache_ == nullptr) {
+    return PendingEntry();
+  }
+  Slice key_slice(reinterpret_cast<const uint8_t*>(&key), sizeof(key));
+  int charge = val_size;
+  return PendingEntry(decoded_cache_.get(),
+                      decoded_cache_->Allocate(key_slice, val_size, charge));
+}
+
+void BlockCache::InsertDecoded(BlockCache::PendingEntry* entry, BlockCacheHandle* inserted) {
+  DCHECK_EQ(entry->cache_, decoded_cache_.get());
+  Cache::Handle* h = decoded_cache_->Insert(entry->handle_, nullptr);
+  entry->handle_ = nullptr;
+  inserted->SetHandle(decoded_cache_.get(), h);
+}
+
 void BlockCache::StartInstrumentation(const scoped_refptr<MetricEntity>& metric_entity) {
   cache_->SetMetrics(metric_entity);
+  type_hits_[DATA_BLOCK] = METRIC_block_cache_data_hits.Instantiate(metric_entity);
+  type_misses_[DATA_BLOCK] = METRIC_block_cache_data_misses.Instantiate(metric_entity);
+  type_hits_[INDEX_BLOCK] = METRIC_block_cache_index_hits.Instantiate(metric_entity);
+  type_misses_[INDEX_BLOCK] = METRIC_block_cache_index_misses.Instantiate(metric_entity);
+  type_hits_[BLOOM_BLOCK] = METRIC_block_cache_bloom_hits.Instantiate(metric_entity);
+  type_misses_[BLOOM_BLOCK] = METRIC_block_cache_bloom_misses.Instantiate(metric_entity);
 }
 
 } // namespace cfile
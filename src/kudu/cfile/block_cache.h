@@ -30,11 +30,13 @@ DECLARE_string(block_cache_type);
 
 namespace kudu {
 
+class Counter;
 class MetricRegistry;
 
 namespace cfile {
 
 class BlockCacheHandle;
+class BlockCacheSsdTier;
 
 // Wrapper around kudu::Cache specifically for caching blocks of CFiles.
 // Provides a singleton and LRU cache for CFile blocks.
@@ -45,6 +47,20 @@ class BlockCache {
   // which is just a portion of a CFile.
   typedef BlockId FileId;
 
+  // The kind of cfile block being cached. Index and bloom filter blocks are
+  // cached at high priority: a miss on them costs a multi-level b-tree
+  // traversal or turns a bloom-filter negative into a disk seek, so they are
+  // granted a reserved fraction of cache capacity (see
+  // --cache_high_priority_reserved_percentage) which large data scans cannot
+  // evict. Hits and misses are also accounted per type.
+  enum BlockType {
+    DATA_BLOCK,
+    INDEX_BLOCK,
+    BLOOM_BLOCK,
+
+    kNumBlockTypes // must be last
+  };
+
   // The unique key identifying entries in the block cache.
   // Each cached block corresponds to a specific offset within
   // a file (called a "block" in other parts of Kudu).
@@ -110,6 +126,7 @@ class BlockCache {
   }
 
   explicit BlockCache(size_t capacity);
+  ~BlockCache();
 
   // Lookup the given block in the cache.
   //
@@ -117,8 +134,15 @@ class BlockCache {
   // This object's destructor will release the cache entry so it may be freed again.
   // Alternatively,  handle->Release() may be used to explicitly release it.
   //
+  // If the entry is not in memory but --block_cache_ssd_path is configured,
+  // the flash-based second tier is consulted, and on a hit the block is
+  // promoted back into the in-memory tier.
+  //
+  // 'type' is used for per-type hit/miss accounting only; it does not
+  // affect which entry is found.
+  //
   // Returns true to indicate that the entry was found, false otherwise.
-  bool Lookup(const CacheKey& key, Cache::CacheBehavior behavior,
+  bool Lookup(const CacheKey& key, BlockType type, Cache::CacheBehavior behavior,
               BlockCacheHandle* handle);
 
   // Pass a metric entity to the cache to start recording metrics.
@@ -134,7 +158,7 @@ class BlockCache {
   // this pending entry before being inserted. For example:
   //
   //   // Allocate space in the cache for a block of 'data_size' bytes.
-  //   PendingEntry entry = cache->Allocate(my_cache_key, data_size);
+  //   PendingEntry entry = cache->Allocate(my_cache_key, DATA_BLOCK, data_size);
   //   // Check for allocation failure.
   //   if (!entry.valid()) {
   //     // if there is no space left in the cache, handle the error.
@@ -145,20 +169,71 @@ class BlockCache {
   //   BlockCacheHandle bch;
   //   cache->Insert(&entry, &bch);
 
-  // Allocate a new entry to be inserted into the cache.
-  PendingEntry Allocate(const CacheKey& key, size_t block_size);
+  // Allocate a new entry to be inserted into the cache. Index and bloom
+  // blocks are allocated at high cache priority; see BlockType above.
+  PendingEntry Allocate(const CacheKey& key, BlockType type, size_t block_size);
 
   // Insert the given block into the cache. 'inserted' is set to refer to the
   // entry in the cache.
   void Insert(PendingEntry* entry, BlockCacheHandle* inserted);
 
+  // Decoded block cache
+  // --------------------
+  // An optional second cache, keyed identically to the main cache, which
+  // stores decoded representations of blocks (e.g. the unshuffled output of
+  // a bitshuffle-encoded block) so that hot blocks don't pay the decode cost
+  // on every scan. Keys never collide with the main cache since the two use
+  // separate Cache instances; cfile blocks are immutable, so (file id,
+  // offset) fully identifies the decoded contents. Entries follow the same
+  // two-phase insertion path as the main cache. Disabled unless
+  // --decoded_block_cache_capacity_mb is greater than zero.
+
+  // Return true if the decoded block cache is enabled.
+  bool decoded_cache_enabled() const {
+    return decoded_cache_ != nullptr;
+  }
+
+  // Lookup the decoded form of the given block. Returns true if found.
+  bool LookupDecoded(const CacheKey& key, Cache::CacheBehavior behavior,
+                     BlockCacheHandle* handle);
+
+  // Allocate a new entry to be inserted into the decoded block cache.
+  // Returns an invalid entry if the decoded cache is disabled or full.
+  PendingEntry AllocateDecoded(const CacheKey& key, size_t val_size);
+
+  // Insert the given entry, allocated with AllocateDecoded(), into the
+  // decoded block cache.
+  void InsertDecoded(PendingEntry* entry, BlockCacheHandle* inserted);
+
  private:
   friend class Singleton<BlockCache>;
   BlockCache();
 
   DISALLOW_COPY_AND_ASSIGN(BlockCache);
 
+  // Increment the per-type hit or miss counter for 'type', if
+  // StartInstrumentation() has been called.
+  void UpdateTypeMetrics(BlockType type, bool hit);
+
+  // Flash-based second tier; NULL unless --block_cache_ssd_path is set.
+  //
+  // Must be declared before 'cache_': entries evicted while the in-memory
+  // cache is destructed are still admitted into the tier.
+  gscoped_ptr<BlockCacheSsdTier> ssd_tier_;
+  gscoped_ptr<Cache::EvictionCallback> eviction_callback_;
+
   gscoped_ptr<Cache> cache_;
+
+  // Cache of decoded block representations; NULL unless
+  // --decoded_block_cache_capacity_mb is greater than zero. Always
+  // DRAM-resident and never spilled to the flash tier: decoded forms can be
+  // rebuilt cheaply from the main cache relative to a disk read.
+  gscoped_ptr<Cache> decoded_cache_;
+
+  // Per-block-type hit/miss counters, indexed by BlockType. NULL until
+  // StartInstrumentation() is called.
+  scoped_refptr<Counter> type_hits_[kNumBlockTypes];
+  scoped_refptr<Counter> type_misses_[kNumBlockTypes];
 };
 
 // Scoped reference to a block from the block cache.
@@ -66,6 +66,35 @@ TEST_F(BloomFileTest, TestWriteAndRead) {
   VerifyBloomFile();
 }
 
+TEST_F(BloomFileTest, TestBatchCheck) {
+  ASSERT_NO_FATAL_FAILURE(WriteTestBloomFile());
+  ASSERT_OK(OpenBloomFile());
+
+  // Build a sorted batch of probes alternating between keys that were
+  // inserted and keys that were not (the writer shifts keys left, so any
+  // key with the low bit set is a guaranteed miss).
+  std::vector<uint64_t> key_storage;
+  for (uint64_t i = 0; i < 100; i++) {
+    key_storage.push_back(BigEndian::FromHost64(i << kKeyShift));
+    key_storage.push_back(BigEndian::FromHost64((i << kKeyShift) | 1));
+  }
+  std::vector<BloomKeyProbe> probes;
+  for (const uint64_t& key : key_storage) {
+    probes.push_back(BloomKeyProbe(
+        Slice(reinterpret_cast<const uint8_t *>(&key), sizeof(key))));
+  }
+
+  // The batch check must agree with checking each key individually.
+  std::vector<bool> maybe_present;
+  ASSERT_OK(bfr_->CheckKeysPresent(probes, &maybe_present));
+  ASSERT_EQ(probes.size(), maybe_present.size());
+  for (int i = 0; i < probes.size(); i++) {
+    bool present = false;
+    ASSERT_OK_FAST(bfr_->CheckKeyPresent(probes[i], &present));
+    ASSERT_EQ(present, maybe_present[i]) << "disagreement at probe " << i;
+  }
+}
+
 #ifdef NDEBUG
 TEST_F(BloomFileTest, Benchmark) {
   ASSERT_NO_FATAL_FAILURE(WriteTestBloomFile());
@@ -15,6 +15,7 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <gflags/gflags.h>
 #include <mutex>
 #include <sched.h>
 #include <string>
@@ -25,15 +26,26 @@
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/sysinfo.h"
 #include "kudu/util/coding.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/hexdump.h"
 #include "kudu/util/malloc.h"
 #include "kudu/util/pb_util.h"
 
 DECLARE_bool(cfile_lazy_open);
 
+DEFINE_bool(bloomfile_write_micro_filter, true,
+            "Whether to store a compact in-memory bloom filter (roughly one "
+            "byte per key) in each bloom file's footer. Readers keep it "
+            "resident and consult it before reading any bloom block, so most "
+            "negative key-presence checks on the write path cost a single "
+            "cache miss instead of a 4KB block read per rowset.");
+TAG_FLAG(bloomfile_write_micro_filter, advanced);
+
 namespace kudu {
 namespace cfile {
 
+const char* const kBloomMicroFilterMetaEntryName = "micro_bloom_filter";
+
 using fs::ReadableBlock;
 using fs::ScopedWritableBlockCloser;
 using fs::WritableBlock;
@@ -69,6 +81,9 @@ Status BloomFileWriter::FinishAndReleaseBlock(ScopedWritableBlockCloser* closer)
   if (bloom_builder_.count() > 0) {
     RETURN_NOT_OK(FinishCurrentBloomBlock());
   }
+  if (!micro_filter_hashes_.empty()) {
+    FinishMicroFilter();
+  }
   return writer_->FinishAndReleaseBlock(closer);
 }
 
@@ -86,7 +101,12 @@ Status BloomFileWriter::AppendKeys(
 
   for (size_t i = 0; i < n_keys; i++) {
 
-    bloom_builder_.AddKey(BloomKeyProbe(keys[i]));
+    BloomKeyProbe probe(keys[i]);
+    bloom_builder_.AddKey(probe);
+    if (FLAGS_bloomfile_write_micro_filter) {
+      micro_filter_hashes_.push_back(
+          (static_cast<uint64_t>(probe.initial_hash()) << 32) | probe.mixing_hash());
+    }
 
     // Bloom has reached optimal occupancy: flush it to the file
     if (PREDICT_FALSE(bloom_builder_.count() >= bloom_builder_.expected_count())) {
@@ -135,6 +155,18 @@ Status BloomFileWriter::FinishCurrentBloomBlock() {
   return Status::OK();
 }
 
+void BloomFileWriter::FinishMicroFilter() {
+  BlockedBloomFilterBuilder micro_builder(micro_filter_hashes_.size());
+  for (uint64_t h : micro_filter_hashes_) {
+    micro_builder.AddKey(BloomKeyProbe(static_cast<uint32_t>(h >> 32),
+                                       static_cast<uint32_t>(h)));
+  }
+  // Added after Start(), so the entry lands in the footer.
+  writer_->AddMetadataPair(kBloomMicroFilterMetaEntryName, micro_builder.slice());
+  micro_filter_hashes_.clear();
+  micro_filter_hashes_.shrink_to_fit();
+}
+
 ////////////////////////////////////////////////////////////
 // Reader
 ////////////////////////////////////////////////////////////
@@ -170,6 +202,7 @@ Status BloomFileReader::OpenNoInit(gscoped_ptr<ReadableBlock> block,
 BloomFileReader::BloomFileReader(gscoped_ptr<CFileReader> reader,
                                  ReaderOptions options)
   : reader_(std::move(reader)),
+    has_micro_filter_(false),
     mem_consumption_(std::move(options.parent_mem_tracker),
                      memory_footprint_excluding_reader()) {
 }
@@ -205,6 +238,18 @@ Status BloomFileReader::InitOnce() {
   }
   iter_locks_.reset(new padded_spinlock[n_cpus]);
 
+  // Load the resident micro-filter, if this file has one. Files written
+  // before micro-filters existed (or with them disabled) simply fall back
+  // to per-key bloom block reads.
+  string micro_filter;
+  if (reader_->GetMetadataEntry(kBloomMicroFilterMetaEntryName, &micro_filter) &&
+      !micro_filter.empty() &&
+      micro_filter.size() % BlockedBloomFilterBuilder::kBlockBytes == 0) {
+    micro_filter_data_.assign_copy(micro_filter.data(), micro_filter.size());
+    micro_filter_ = BlockedBloomFilter(Slice(micro_filter_data_));
+    has_micro_filter_ = true;
+  }
+
   // The memory footprint has changed.
   mem_consumption_.Reset(memory_footprint_excluding_reader());
 
@@ -244,6 +289,13 @@ Status BloomFileReader::CheckKeyPresent(const BloomKeyProbe &probe,
                                         bool *maybe_present) {
   DCHECK(init_once_.initted());
 
+  // Check the resident micro-filter first: a negative answer saves the
+  // index seek and bloom block read below.
+  if (has_micro_filter_ && !micro_filter_.MayContainKey(probe)) {
+    *maybe_present = false;
+    return Status::OK();
+  }
+
 #if defined(__linux__)
   int cpu = sched_getcpu();
 #else
@@ -277,7 +329,8 @@ Status BloomFileReader::CheckKeyPresent(const BloomKeyProbe &probe,
   }
 
   BlockHandle dblk_data;
-  RETURN_NOT_OK(reader_->ReadBlock(bblk_ptr, CFileReader::CACHE_BLOCK, &dblk_data));
+  RETURN_NOT_OK(reader_->ReadBlock(bblk_ptr, CFileReader::CACHE_BLOCK,
+                                   BlockCache::BLOOM_BLOCK, &dblk_data));
 
   // Parse the header in the block.
   BloomBlockHeaderPB hdr;
@@ -290,6 +343,87 @@ Status BloomFileReader::CheckKeyPresent(const BloomKeyProbe &probe,
   return Status::OK();
 }
 
+Status BloomFileReader::CheckKeysPresent(const vector<BloomKeyProbe> &probes,
+                                         vector<bool> *maybe_present) {
+  DCHECK(init_once_.initted());
+
+  maybe_present->assign(probes.size(), false);
+
+  // First pass: look up the bloom block pointer for each probe. We hold one
+  // of the index iterators for the whole pass; since the probes are sorted,
+  // the seeks walk mostly forward through the index, staying within the
+  // already-cached index blocks.
+  vector<BlockPointer> bblk_ptrs(probes.size());
+  vector<bool> has_block(probes.size(), false);
+  {
+#if defined(__linux__)
+    int cpu = sched_getcpu();
+#else
+    // Use just one lock if on OS X.
+    int cpu = 0;
+#endif
+    std::unique_lock<simple_spinlock> lock;
+    while (true) {
+      std::unique_lock<simple_spinlock> l(iter_locks_[cpu], std::try_to_lock);
+      if (l.owns_lock()) {
+        lock.swap(l);
+        break;
+      }
+      cpu = (cpu + 1) % index_iters_.size();
+    }
+
+    cfile::IndexTreeIterator *index_iter = index_iters_[cpu].get();
+
+    for (int i = 0; i < probes.size(); i++) {
+      DCHECK(i == 0 || probes[i - 1].key().compare(probes[i].key()) <= 0)
+          << "probes must be sorted by key";
+
+      // Keys rejected by the resident micro-filter don't need an index seek
+      // or a bloom block read at all.
+      if (has_micro_filter_ && !micro_filter_.MayContainKey(probes[i])) {
+        continue;
+      }
+
+      Status s = index_iter->SeekAtOrBefore(probes[i].key());
+      if (PREDICT_FALSE(s.IsNotFound())) {
+        // Before the first entry in the file: definitely not present.
+        continue;
+      }
+      RETURN_NOT_OK(s);
+      bblk_ptrs[i] = index_iter->GetCurrentBlockPointer();
+      has_block[i] = true;
+    }
+  }
+
+  // Second pass: read each distinct bloom block once and check all of the
+  // probes which landed in it. Sorted probes yield runs of identical block
+  // pointers, so this does the actual block reads outside the iterator lock
+  // and never re-parses a block.
+  BlockHandle dblk_data;
+  BloomBlockHeaderPB hdr;
+  Slice bloom_data;
+  bool have_block = false;
+  BlockPointer cur_ptr;
+  for (int i = 0; i < probes.size(); i++) {
+    if (!has_block[i]) continue;
+
+    if (!have_block ||
+        bblk_ptrs[i].offset() != cur_ptr.offset() ||
+        bblk_ptrs[i].size() != cur_ptr.size()) {
+      RETURN_NOT_OK(reader_->ReadBlock(bblk_ptrs[i], CFileReader::CACHE_BLOCK,
+                                       BlockCache::BLOOM_BLOCK, &dblk_data));
+      RETURN_NOT_OK(ParseBlockHeader(dblk_data.data(), &hdr, &bloom_data));
+      cur_ptr = bblk_ptrs[i];
+      have_block = true;
+    }
+
+    BloomFilter bf(bloom_data, hdr.num_hash_functions());
+    (*maybe_present)[i] = bf.MayContainKey(probes[i]);
+  }
+
+  return Status::OK();
+}
+
 size_t BloomFileReader::memory_footprint_excluding_reader() const {
   size_t size = kudu_malloc_usable_size(this);
 
@@ -308,6 +442,8 @@ size_t BloomFileReader::memory_footprint_excluding_reader() const {
     size += kudu_malloc_usable_size(iter_locks_.get());
   }
 
+  size += micro_filter_data_.capacity();
+
   return size;
 }
 
@@ -33,6 +33,10 @@
 namespace kudu {
 namespace cfile {
 
+// Name of the footer metadata entry in which the resident micro-filter is
+// stored (see BloomFileWriter).
+extern const char* const kBloomMicroFilterMetaEntryName;
+
 class BloomFileWriter {
  public:
   BloomFileWriter(gscoped_ptr<fs::WritableBlock> block,
@@ -55,10 +59,20 @@ class BloomFileWriter {
 
   Status FinishCurrentBloomBlock();
 
+  // Build the resident micro-filter from the buffered key hashes and store
+  // it in the file's footer metadata.
+  void FinishMicroFilter();
+
   gscoped_ptr<cfile::CFileWriter> writer_;
 
   BloomFilterBuilder bloom_builder_;
 
+  // Hashes of every appended key, buffered so that the micro-filter (a
+  // compact blocked bloom kept resident in memory by readers) can be sized
+  // exactly once the total key count is known. Each entry packs the probe's
+  // two 32-bit hashes.
+  std::vector<uint64_t> micro_filter_hashes_;
+
   // first key inserted in the current block.
   faststring first_key_;
 
@@ -103,6 +117,16 @@ class BloomFileReader {
   Status CheckKeyPresent(const BloomKeyProbe &probe,
                          bool *maybe_present);
 
+  // Batch variant of CheckKeyPresent().
+  //
+  // Checks each entry of 'probes', which must be sorted by key, and sets the
+  // corresponding entry of 'maybe_present'. Because the probes are sorted,
+  // consecutive probes tend to fall into the same bloom block, and each
+  // distinct block is read and parsed only once. This makes a batch of point
+  // lookups substantially cheaper than checking the keys one at a time.
+  Status CheckKeysPresent(const std::vector<BloomKeyProbe> &probes,
+                          std::vector<bool> *maybe_present);
+
  private:
   DISALLOW_COPY_AND_ASSIGN(BloomFileReader);
 
@@ -134,6 +158,14 @@ class BloomFileReader {
   std::vector<std::unique_ptr<cfile::IndexTreeIterator>> index_iters_;
   gscoped_ptr<padded_spinlock[]> iter_locks_;
 
+  // The resident micro-filter loaded from the file's footer metadata, if
+  // present. This is consulted before any bloom block lookup: a negative
+  // answer costs at most one cache miss and avoids the index seek and 4KB
+  // block read entirely.
+  bool has_micro_filter_;
+  faststring micro_filter_data_;
+  BlockedBloomFilter micro_filter_;
+
   KuduOnceDynamic init_once_;
 
   ScopedTrackedConsumption mem_consumption_;
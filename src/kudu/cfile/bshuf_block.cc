@@ -99,15 +99,15 @@ Status BShufBlockDecoder<UINT32>::SeekAtOrAfterValue(const void* value_void, boo
     uint32_t mid_key;
     switch (size_of_elem_) {
       case 1: {
-        mid_key = Decode<uint8_t>(&decoded_[mid * size_of_elem_]);
+        mid_key = Decode<uint8_t>(&decoded_data_[mid * size_of_elem_]);
         break;
       }
       case 2: {
-        mid_key = Decode<uint16_t>(&decoded_[mid * size_of_elem_]);
+        mid_key = Decode<uint16_t>(&decoded_data_[mid * size_of_elem_]);
         break;
       }
       case 4: {
-        mid_key = Decode<uint32_t>(&decoded_[mid * size_of_elem_]);
+        mid_key = Decode<uint32_t>(&decoded_data_[mid * size_of_elem_]);
         break;
       }
     }
@@ -141,7 +141,7 @@ Status BShufBlockDecoder<UINT32>::CopyNextValuesToArray(size_t* n, uint8_t* arra
 
   // First, copy it to the destination array without any "expansion".
   size_t max_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
-  memcpy(array, &decoded_[cur_idx_ * size_of_elem_], max_fetch * size_of_elem_);
+  memcpy(array, &decoded_data_[cur_idx_ * size_of_elem_], max_fetch * size_of_elem_);
 
   *n = max_fetch;
   cur_idx_ += max_fetch;
@@ -27,6 +27,7 @@
 #include <stdint.h>
 
 #include "kudu/cfile/bitshuffle_arch_wrapper.h"
+#include "kudu/cfile/block_cache.h"
 #include "kudu/cfile/block_encodings.h"
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/common/columnblock.h"
@@ -163,15 +164,17 @@ class BShufBlockBuilder final : public BlockBuilder {
   }
 
   Slice Finish(rowid_t ordinal_pos, int final_size_of_type) {
-    data_.resize(kHeaderSize + final_size_of_type * count_);
-
-    // Do padding so that the input num of element is multiple of 8.
+    // Pad the data so that the input num of elements is a multiple of 8,
+    // as required by the bitshuffle library. The padding elements are
+    // zeroed so that identical inputs always produce identical blocks.
+    // The data is then shuffled and compressed directly from 'data_' into
+    // the output buffer, with no intermediate copy.
     int num_elems_after_padding = KUDU_ALIGN_UP(count_, 8);
-    int padding_elems = num_elems_after_padding - count_;
-    int padding_bytes = padding_elems * final_size_of_type;
-    for (int i = 0; i < padding_bytes; i++) {
-      data_.push_back(0);
-    }
+    size_t size_before_padding = final_size_of_type * count_;
+    size_t size_after_padding = final_size_of_type * num_elems_after_padding;
+    data_.resize(size_after_padding);
+    memset(data_.data() + size_before_padding, 0,
+           size_after_padding - size_before_padding);
 
     buffer_.resize(kHeaderSize +
                    bitshuffle::compress_lz4_bound(num_elems_after_padding, final_size_of_type, 0));
@@ -220,11 +223,22 @@ class BShufBlockDecoder final : public BlockDecoder {
   explicit BShufBlockDecoder(Slice slice)
       : data_(std::move(slice)),
         parsed_(false),
+        cache_key_(BlockCache::FileId(), 0),
+        has_cache_key_(false),
         ordinal_pos_base_(0),
         num_elems_(0),
         compressed_size_(0),
         num_elems_after_padding_(0),
-        cur_idx_(0) {
+        cur_idx_(0),
+        decoded_data_(nullptr) {
+  }
+
+  // Set the cache key under which the unshuffled form of this block may be
+  // stored in the decoded block cache. Must be called before ParseHeader().
+  void SetDecodedCacheKey(const BlockCache::CacheKey& key) {
+    DCHECK(!parsed_);
+    cache_key_ = key;
+    has_cache_key_ = true;
   }
 
   Status ParseHeader() OVERRIDE {
@@ -291,7 +305,7 @@ class BShufBlockDecoder final : public BlockDecoder {
     while (left != right) {
       uint32_t mid = (left + right) / 2;
       CppType mid_key = Decode<CppType>(
-            &decoded_[mid * size_of_type]);
+            &decoded_data_[mid * size_of_type]);
       if (mid_key == target) {
         cur_idx_ = mid;
         *exact = true;
@@ -329,7 +343,7 @@ class BShufBlockDecoder final : public BlockDecoder {
     }
 
     size_t max_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
-    memcpy(array, &decoded_[cur_idx_ * size_of_type], max_fetch * size_of_type);
+    memcpy(array, &decoded_data_[cur_idx_ * size_of_type], max_fetch * size_of_type);
 
     *n = max_fetch;
     cur_idx_ += max_fetch;
@@ -364,16 +378,45 @@ class BShufBlockDecoder final : public BlockDecoder {
 
   Status Expand() {
     if (num_elems_ > 0) {
-      int64_t bytes;
-      decoded_.resize(num_elems_after_padding_ * size_of_elem_);
-      uint8_t* in = const_cast<uint8_t*>(&data_[kHeaderSize]);
-      bytes = bitshuffle::decompress_lz4(in, decoded_.data(), num_elems_after_padding_,
-                                         size_of_elem_, 0);
-      if (PREDICT_FALSE(bytes < 0)) {
-        // Ideally, this should not happen.
-        AbortWithBitShuffleError(bytes);
-        return Status::RuntimeError("Unshuffle Process failed");
+      size_t decoded_size = num_elems_after_padding_ * size_of_elem_;
+
+      // If the decoded block cache is enabled, either read the unshuffled
+      // form from the cache or unshuffle directly into a new cache entry so
+      // that later scans of this block skip the decode step.
+      BlockCache* cache = BlockCache::GetSingleton();
+      if (has_cache_key_ && cache->decoded_cache_enabled()) {
+        if (cache->LookupDecoded(cache_key_, Cache::EXPECT_IN_CACHE,
+                                 &decoded_cache_handle_)) {
+          decoded_data_ = decoded_cache_handle_.data().data();
+          return Status::OK();
+        }
+        BlockCache::PendingEntry entry =
+            cache->AllocateDecoded(cache_key_, decoded_size);
+        if (entry.valid()) {
+          RETURN_NOT_OK(Unshuffle(entry.val_ptr()));
+          cache->InsertDecoded(&entry, &decoded_cache_handle_);
+          decoded_data_ = decoded_cache_handle_.data().data();
+          return Status::OK();
+        }
+        // The cache entry could not be allocated (e.g. the decoded cache is
+        // under memory pressure); fall through to a private buffer.
       }
+
+      decoded_.resize(decoded_size);
+      RETURN_NOT_OK(Unshuffle(decoded_.data()));
+      decoded_data_ = decoded_.data();
+    }
+    return Status::OK();
+  }
+
+  Status Unshuffle(uint8_t* out) {
+    uint8_t* in = const_cast<uint8_t*>(&data_[kHeaderSize]);
+    int64_t bytes = bitshuffle::decompress_lz4(in, out, num_elems_after_padding_,
+                                               size_of_elem_, 0);
+    if (PREDICT_FALSE(bytes < 0)) {
+      // Ideally, this should not happen.
+      AbortWithBitShuffleError(bytes);
+      return Status::RuntimeError("Unshuffle Process failed");
     }
     return Status::OK();
   }
@@ -388,6 +431,11 @@ class BShufBlockDecoder final : public BlockDecoder {
   Slice data_;
   bool parsed_;
 
+  // Key under which the unshuffled block may be cached; only valid if
+  // 'has_cache_key_' is true.
+  BlockCache::CacheKey cache_key_;
+  bool has_cache_key_;
+
   rowid_t ordinal_pos_base_;
   uint32_t num_elems_;
   uint32_t compressed_size_;
@@ -399,7 +447,12 @@ class BShufBlockDecoder final : public BlockDecoder {
   int size_of_elem_;
 
   size_t cur_idx_;
+
+  // The unshuffled block contents. Points either into 'decoded_' or into a
+  // decoded block cache entry pinned by 'decoded_cache_handle_'.
+  const uint8_t* decoded_data_;
   faststring decoded_;
+  BlockCacheHandle decoded_cache_handle_;
 };
 
 template<>
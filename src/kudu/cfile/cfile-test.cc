@@ -36,6 +36,7 @@
 
 DECLARE_string(block_cache_type);
 DECLARE_string(cfile_do_on_finish);
+DECLARE_double(cfile_gather_scan_threshold);
 
 #if defined(__linux__)
 DECLARE_string(nvm_cache_path);
@@ -144,6 +145,50 @@ class TestCFile : public CFileTestBase {
     ASSERT_EQ(10000, n);
   }
 
+  // Write a file and read it back with a sparse, final selection vector
+  // attached to the materialization context, exercising the gather path
+  // which seeks the decoder over deselected rows instead of bulk-decoding
+  // them.
+  template <class DataGeneratorType>
+  void TestSparseGatherScan(EncodingType encoding) {
+    google::FlagSaver saver;
+    FLAGS_cfile_gather_scan_threshold = 0.25;
+
+    const int kNumRows = 10000;
+    BlockId block_id;
+    DataGeneratorType generator;
+    WriteTestFile(&generator, encoding, NO_COMPRESSION, kNumRows, SMALL_BLOCKSIZE, &block_id);
+
+    gscoped_ptr<ReadableBlock> block;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    gscoped_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    gscoped_ptr<CFileIterator> iter;
+    ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK));
+    ASSERT_OK(iter->SeekToOrdinal(0));
+
+    // Select every 100th row in the first half of the file, leaving a long
+    // deselected tail that must still advance the decoders.
+    SelectionVector sel(kNumRows);
+    sel.SetAllFalse();
+    for (int i = 0; i < kNumRows / 2; i += 100) {
+      sel.SetRowSelected(i);
+    }
+
+    ScopedColumnBlock<DataGeneratorType::kDataType> out(kNumRows);
+    ColumnMaterializationContext ctx = CreateNonDecoderEvalContext(&out, &sel);
+    ctx.SetAllowSkipUnselected();
+    size_t n = kNumRows;
+    ASSERT_OK(iter->CopyNextValues(&n, &ctx));
+    ASSERT_EQ(kNumRows, n);
+    ASSERT_FALSE(iter->HasNext());
+
+    DataGeneratorType verifier;
+    for (int i = 0; i < kNumRows / 2; i += 100) {
+      ASSERT_EQ(verifier.BuildTestValue(0, i), out[i]) << "mismatch at index " << i;
+    }
+  }
+
   template <class DataGeneratorType>
   void TimeSeekAndReadFileWithNulls(DataGeneratorType* generator,
                                     const BlockId& block_id, size_t num_entries) {
@@ -247,7 +292,8 @@ class TestCFile : public CFileTestBase {
     do {
       BlockHandle dblk_data;
       BlockPointer blk_ptr = iter->GetCurrentBlockPointer();
-      ASSERT_OK(reader->ReadBlock(blk_ptr, CFileReader::CACHE_BLOCK, &dblk_data));
+      ASSERT_OK(reader->ReadBlock(blk_ptr, CFileReader::CACHE_BLOCK,
+                                  BlockCache::DATA_BLOCK, &dblk_data));
 
       memcpy(data + 12, &count, 4);
       ASSERT_EQ(expected_data, dblk_data.data());
@@ -454,6 +500,18 @@ TEST_P(TestCFileBothCacheTypes, TestReadWriteInt32) {
   }
 }
 
+TEST_P(TestCFileBothCacheTypes, TestSparseGatherScanInt32) {
+  for (auto enc : { PLAIN_ENCODING, RLE }) {
+    TestSparseGatherScan<Int32DataGenerator<false>>(enc);
+  }
+}
+
+TEST_P(TestCFileBothCacheTypes, TestSparseGatherScanUInt64) {
+  for (auto enc : { PLAIN_ENCODING, BIT_SHUFFLE }) {
+    TestSparseGatherScan<UInt64DataGenerator<false>>(enc);
+  }
+}
+
 TEST_P(TestCFileBothCacheTypes, TestReadWriteUInt64) {
   for (auto enc : { PLAIN_ENCODING, RLE, BIT_SHUFFLE }) {
     TestReadWriteFixedSizeTypes<UInt64DataGenerator<false>>(enc);
@@ -888,6 +946,7 @@ TEST_P(TestCFileBothCacheTypes, TestCacheKeysAreStable) {
     BlockHandle bh;
     ASSERT_OK(reader->ReadBlock(iter->GetCurrentBlockPointer(),
                                 CFileReader::CACHE_BLOCK,
+                                BlockCache::DATA_BLOCK,
                                 &bh));
 
     // The first time through, we miss in the seek and in the ReadBlock().
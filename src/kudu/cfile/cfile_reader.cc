@@ -20,6 +20,7 @@
 #include <glog/logging.h>
 
 #include <algorithm>
+#include <mutex>
 
 #include "kudu/cfile/binary_plain_block.h"
 #include "kudu/cfile/block_cache.h"
@@ -30,11 +31,15 @@
 #include "kudu/cfile/compression_codec.h"
 #include "kudu/cfile/index_block.h"
 #include "kudu/cfile/index_btree.h"
+#include "kudu/gutil/bind.h"
+#include "kudu/gutil/endian.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/mathlimits.h"
+#include "kudu/gutil/once.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/coding.h"
 #include "kudu/util/debug/trace_event.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/malloc.h"
 #include "kudu/util/memory/overwrite.h"
@@ -43,12 +48,36 @@
 #include "kudu/util/rle-encoding.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
+#include "kudu/util/threadlocal.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
 
 DEFINE_bool(cfile_lazy_open, true,
             "Allow lazily opening of cfiles");
 TAG_FLAG(cfile_lazy_open, hidden);
 
+DEFINE_double(cfile_gather_scan_threshold, 0.1,
+              "If the fraction of rows still selected within a data block is at or "
+              "below this threshold, columns without predicates are materialized by "
+              "seeking to and copying only the selected rows, instead of bulk-decoding "
+              "the whole range. Set to 0 to always bulk-decode.");
+TAG_FLAG(cfile_gather_scan_threshold, advanced);
+TAG_FLAG(cfile_gather_scan_threshold, runtime);
+
+DEFINE_int32(cfile_read_ahead_blocks, 4,
+             "Number of data blocks to asynchronously read ahead of a "
+             "sequential cfile scan. Read-ahead begins once a scan has pulled "
+             "at least two consecutive data blocks. Set to 0 to disable "
+             "read-ahead.");
+TAG_FLAG(cfile_read_ahead_blocks, advanced);
+TAG_FLAG(cfile_read_ahead_blocks, runtime);
+
+DEFINE_int32(cfile_io_pool_threads, 8,
+             "Number of threads in the shared pool used for cfile background "
+             "I/O (sequential-scan read-ahead and parallel column "
+             "preparation).");
+TAG_FLAG(cfile_io_pool_threads, advanced);
+
 using kudu::fs::ReadableBlock;
 using strings::Substitute;
 
@@ -58,6 +87,26 @@ namespace cfile {
 const char* CFILE_CACHE_MISS_BYTES_METRIC_NAME = "cfile_cache_miss_bytes";
 const char* CFILE_CACHE_HIT_BYTES_METRIC_NAME = "cfile_cache_hit_bytes";
 
+namespace {
+
+ThreadPool* g_io_pool = nullptr;
+GoogleOnceType g_io_pool_once = GOOGLE_ONCE_INIT;
+
+void InitCFileIOPool() {
+  gscoped_ptr<ThreadPool> pool;
+  CHECK_OK(ThreadPoolBuilder("cfile-io")
+           .set_max_threads(FLAGS_cfile_io_pool_threads)
+           .Build(&pool));
+  g_io_pool = pool.release();
+}
+
+} // anonymous namespace
+
+ThreadPool* CFileIOPool() {
+  GoogleOnceInit(&g_io_pool_once, &InitCFileIOPool);
+  return g_io_pool;
+}
+
 // Magic+Length: 8-byte magic, followed by 4-byte header size
 static const size_t kMagicAndLengthSize = 12;
 static const size_t kMaxHeaderFooterPBSize = 64*1024;
@@ -265,9 +314,10 @@ class ScratchMemory {
   // no capacity and cannot evict to make room, this will fall back
   // to allocating from the heap. In that case, IsFromCache() will
   // return false.
-  void TryAllocateFromCache(BlockCache* cache, const BlockCache::CacheKey& key, int size) {
+  void TryAllocateFromCache(BlockCache* cache, const BlockCache::CacheKey& key,
+                            BlockCache::BlockType block_type, int size) {
     DCHECK(!ptr_);
-    from_cache_ = cache->Allocate(key, size);
+    from_cache_ = cache->Allocate(key, block_type, size);
     if (!from_cache_.valid()) {
       AllocateFromHeap(size);
       return;
@@ -325,7 +375,7 @@ class ScratchMemory {
 } // anonymous namespace
 
 Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_control,
-                              BlockHandle *ret) const {
+                              BlockCache::BlockType block_type, BlockHandle *ret) const {
   DCHECK(init_once_.initted());
   CHECK(ptr.offset() > 0 &&
         ptr.offset() + ptr.size() < file_size_) <<
@@ -336,7 +386,7 @@ Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_contro
       Cache::EXPECT_IN_CACHE : Cache::NO_EXPECT_IN_CACHE;
   BlockCache* cache = BlockCache::GetSingleton();
   BlockCache::CacheKey key(block_->id(), ptr.offset());
-  if (cache->Lookup(key, cache_behavior, &bc_handle)) {
+  if (cache->Lookup(key, block_type, cache_behavior, &bc_handle)) {
     TRACE_COUNTER_INCREMENT("cfile_cache_hit", 1);
     TRACE_COUNTER_INCREMENT(CFILE_CACHE_HIT_BYTES_METRIC_NAME, ptr.size());
     *ret = BlockHandle::WithDataFromCache(&bc_handle);
@@ -354,24 +404,21 @@ Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_contro
   TRACE_COUNTER_INCREMENT(CFILE_CACHE_MISS_BYTES_METRIC_NAME, ptr.size());
 
   ScratchMemory scratch;
-  // If we are reading uncompressed data and plan to cache the result,
-  // then we should allocate our scratch memory directly from the cache.
-  // This avoids an extra memory copy in the case of an NVM cache.
-  if (codec_ == nullptr && cache_control == CACHE_BLOCK) {
-    scratch.TryAllocateFromCache(cache, key, ptr.size());
-  } else {
-    scratch.AllocateFromHeap(ptr.size());
-  }
-  uint8_t* buf = scratch.get();
-
   Slice block;
-  RETURN_NOT_OK(block_->Read(ptr.offset(), ptr.size(), &block, buf));
-  if (block.size() != ptr.size()) {
-    return Status::IOError("Could not read full block length");
-  }
-
-  // Decompress the block
   if (codec_ != nullptr) {
+    // The compressed input is only needed until it has been decompressed, so
+    // rather than allocating a fresh buffer for every block, read it into a
+    // per-thread scratch buffer which is reused across blocks. This saves an
+    // allocation and free of up to the block size for every cache miss on a
+    // compressed cfile.
+    BLOCK_STATIC_THREAD_LOCAL(faststring, compressed_scratch);
+    compressed_scratch->resize(ptr.size());
+    RETURN_NOT_OK(block_->Read(ptr.offset(), ptr.size(), &block,
+                               compressed_scratch->data()));
+    if (block.size() != ptr.size()) {
+      return Status::IOError("Could not read full block length");
+    }
+
     // Init the decompressor and get the size required for the uncompressed buffer.
     CompressedBlockDecoder uncompressor(codec_, cfile_version_, block);
     Status s = uncompressor.Init();
@@ -385,27 +432,34 @@ Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_contro
 
     // If we plan to put the uncompressed block in the cache, we should
     // decompress directly into the cache's memory (to avoid a memcpy for NVM).
-    ScratchMemory decompressed_scratch;
     if (cache_control == CACHE_BLOCK) {
-      decompressed_scratch.TryAllocateFromCache(cache, key, uncompressed_size);
+      scratch.TryAllocateFromCache(cache, key, block_type, uncompressed_size);
     } else {
-      decompressed_scratch.AllocateFromHeap(uncompressed_size);
+      scratch.AllocateFromHeap(uncompressed_size);
     }
-    s = uncompressor.UncompressIntoBuffer(decompressed_scratch.get());
+    s = uncompressor.UncompressIntoBuffer(scratch.get());
     if (!s.ok()) {
       LOG(WARNING) << "Unable to uncompress block at " << ptr.offset()
                    << " of size " << ptr.size() << ": " << s.ToString();
       return s;
     }
 
-    // Now that we've decompressed, we don't need to keep holding onto the original
-    // scratch buffer. Instead, we have to start holding onto our decompression
-    // output buffer.
-    scratch.Swap(&decompressed_scratch);
-
     // Set the result block to our decompressed data.
-    block = Slice(buf, uncompressed_size);
+    block = Slice(scratch.get(), uncompressed_size);
   } else {
+    // If we are reading uncompressed data and plan to cache the result,
+    // then we should allocate our scratch memory directly from the cache.
+    // This avoids an extra memory copy in the case of an NVM cache.
+    if (cache_control == CACHE_BLOCK) {
+      scratch.TryAllocateFromCache(cache, key, block_type, ptr.size());
+    } else {
+      scratch.AllocateFromHeap(ptr.size());
+    }
+    RETURN_NOT_OK(block_->Read(ptr.offset(), ptr.size(), &block, scratch.get()));
+    if (block.size() != ptr.size()) {
+      return Status::IOError("Could not read full block length");
+    }
+
     // Some of the File implementations from LevelDB attempt to be tricky
     // and just return a Slice into an mmapped region (or in-memory region).
     // But, this is hard to program against in terms of cache management, etc,
@@ -425,7 +479,7 @@ Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_contro
     // if the entry could not be allocated from the block cache.
     // Since we allocate memory to include the key for the cache entry
     // we must reset the block.
-    DCHECK_EQ(block.data(), buf);
+    DCHECK_EQ(block.data(), scratch.get());
     DCHECK(!scratch.IsFromCache());
     *ret = BlockHandle::WithOwnedData(scratch.as_slice());
   }
@@ -442,6 +496,45 @@ Status CFileReader::CountRows(rowid_t *count) const {
   return Status::OK();
 }
 
+Status CFileReader::GetOrdinalFenceIndex(const OrdinalFenceIndex** fences) {
+  DCHECK(has_posidx());
+  {
+    std::lock_guard<simple_spinlock> l(ordinal_fence_lock_);
+    if (PREDICT_TRUE(ordinal_fences_)) {
+      *fences = ordinal_fences_.get();
+      return Status::OK();
+    }
+  }
+
+  // Build the index outside the lock: walking the leaf level of the
+  // positional index may incur I/O. If several threads race here, the
+  // losers' copies are simply discarded.
+  gscoped_ptr<OrdinalFenceIndex> built(new OrdinalFenceIndex());
+  gscoped_ptr<IndexTreeIterator> iter(
+      IndexTreeIterator::Create(this, posidx_root()));
+  RETURN_NOT_OK(iter->SeekToFirst());
+  while (true) {
+    Slice key = iter->GetCurrentKey();
+    if (PREDICT_FALSE(key.size() != sizeof(uint32_t))) {
+      return Status::Corruption(
+          Substitute("bad $0-byte key in positional index", key.size()));
+    }
+    OrdinalFence fence;
+    fence.first_ordinal = BigEndian::Load32(key.data());
+    fence.ptr = iter->GetCurrentBlockPointer();
+    built->push_back(fence);
+    if (!iter->HasNext()) break;
+    RETURN_NOT_OK(iter->Next());
+  }
+
+  std::lock_guard<simple_spinlock> l(ordinal_fence_lock_);
+  if (!ordinal_fences_) {
+    ordinal_fences_.swap(built);
+  }
+  *fences = ordinal_fences_.get();
+  return Status::OK();
+}
+
 bool CFileReader::GetMetadataEntry(const string &key, string *val) {
   for (const FileMetadataPairPB &pair : header().metadata()) {
     if (pair.key() == key) {
@@ -530,14 +623,35 @@ Status DefaultColumnValueIterator::FinishBatch() {
 CFileIterator::CFileIterator(CFileReader* reader,
                              CFileReader::CacheControl cache_control)
   : reader_(reader),
+    codewords_match_all_(false),
     seeked_(nullptr),
+    fences_(nullptr),
+    cur_fence_idx_(0),
     prepared_(false),
     cache_control_(cache_control),
+    preparing_dblk_(false),
     last_prepare_idx_(-1),
-    last_prepare_count_(-1) {
+    last_prepare_count_(-1),
+    consecutive_queued_blocks_(0),
+    prefetched_blocks_(0),
+    prefetch_cv_(&prefetch_lock_),
+    outstanding_prefetches_(0) {
+  if (cache_control_ == CFileReader::DONT_CACHE_BLOCK) {
+    // Uncached iterators make one sequential pass over the file (e.g.
+    // compaction inputs), so ask the OS to read ahead aggressively.
+    WARN_NOT_OK(reader_->HintAccessPattern(ACCESS_PATTERN_SEQUENTIAL),
+                "Unable to hint sequential access pattern");
+  }
 }
 
 CFileIterator::~CFileIterator() {
+  WaitForPrefetches();
+  if (cache_control_ == CFileReader::DONT_CACHE_BLOCK) {
+    // The one-pass data won't be read again soon; drop it from the page
+    // cache so it doesn't evict the working set of co-located hot tablets.
+    WARN_NOT_OK(reader_->HintAccessPattern(ACCESS_PATTERN_DONTNEED),
+                "Unable to hint page cache release");
+  }
 }
 
 Status CFileIterator::SeekToOrdinal(rowid_t ord_idx) {
@@ -546,20 +660,29 @@ Status CFileIterator::SeekToOrdinal(rowid_t ord_idx) {
     return Status::NotSupported("no positional index in file");
   }
 
-  tmp_buf_.clear();
-  KeyEncoderTraits<UINT32, faststring>::Encode(ord_idx, &tmp_buf_);
-  RETURN_NOT_OK(posidx_iter_->SeekAtOrBefore(Slice(tmp_buf_)));
+  // Find the block containing 'ord_idx' with a single binary search in the
+  // reader's flat fence index, rather than descending the positional index
+  // b-tree (which costs a block cache lookup per level) on every seek.
+  RETURN_NOT_OK(reader_->GetOrdinalFenceIndex(&fences_));
+  DCHECK(!fences_->empty());
+  auto it = std::upper_bound(
+      fences_->begin(), fences_->end(), ord_idx,
+      [](rowid_t ord, const CFileReader::OrdinalFence& fence) {
+        return ord < fence.first_ordinal;
+      });
+  if (PREDICT_FALSE(it == fences_->begin())) {
+    return Status::NotFound("trying to seek before first ordinal in file");
+  }
+  cur_fence_idx_ = (it - fences_->begin()) - 1;
 
   // TODO: fast seek within block (without reseeking index)
   pblock_pool_scoped_ptr b = prepared_block_pool_.make_scoped_ptr(
     prepared_block_pool_.Construct());
-  RETURN_NOT_OK(ReadCurrentDataBlock(*posidx_iter_, b.get()));
+  RETURN_NOT_OK(ReadDataBlock((*fences_)[cur_fence_idx_].ptr, b.get()));
 
   // If the data block doesn't actually contain the data
   // we're looking for, then we're probably in the last
   // block in the file.
-  // TODO: could assert that each of the index layers is
-  // at its last entry (ie HasNext() is false for each)
   if (PREDICT_FALSE(ord_idx > b->last_row_idx())) {
     return Status::NotFound("trying to seek past highest ordinal in file");
   }
@@ -574,6 +697,9 @@ Status CFileIterator::SeekToOrdinal(rowid_t ord_idx) {
   prepared_blocks_.push_back(b.release());
   last_prepare_idx_ = ord_idx;
   last_prepare_count_ = 0;
+  // Mark the iterator as seeked. The b-tree iterator itself is never
+  // positioned on this path: HasNext() and PrepareBatch() consult
+  // 'fences_' instead.
   seeked_ = posidx_iter_.get();
 
   CHECK_EQ(ord_idx, GetCurrentOrdinal());
@@ -717,7 +843,8 @@ Status CFileIterator::PrepareForNewSeek() {
     BlockPointer bp(reader_->footer().dict_block_ptr());
 
     // Cache the dictionary for performance
-    RETURN_NOT_OK_PREPEND(reader_->ReadBlock(bp, CFileReader::CACHE_BLOCK, &dict_block_handle_),
+    RETURN_NOT_OK_PREPEND(reader_->ReadBlock(bp, CFileReader::CACHE_BLOCK,
+                                             BlockCache::DATA_BLOCK, &dict_block_handle_),
                           "Couldn't read dictionary block");
 
     dict_decoder_.reset(new BinaryPlainBlockDecoder(dict_block_handle_.data()));
@@ -725,11 +852,19 @@ Status CFileIterator::PrepareForNewSeek() {
   }
 
   seeked_ = nullptr;
+  fences_ = nullptr;
+  cur_fence_idx_ = 0;
   for (PreparedBlock *pb : prepared_blocks_) {
     prepared_block_pool_.Destroy(pb);
   }
   prepared_blocks_.clear();
 
+  // A seek invalidates any read-ahead position. In-flight tasks are harmless:
+  // they only warm the block cache.
+  prefetch_iter_.reset();
+  consecutive_queued_blocks_ = 0;
+  prefetched_blocks_ = 0;
+
   return Status::OK();
 }
 
@@ -763,8 +898,14 @@ Status DecodeNullInfo(Slice *data_block, uint32_t *num_rows_in_block, Slice *nul
 
 Status CFileIterator::ReadCurrentDataBlock(const IndexTreeIterator &idx_iter,
                                            PreparedBlock *prep_block) {
-  prep_block->dblk_ptr_ = idx_iter.GetCurrentBlockPointer();
-  RETURN_NOT_OK(reader_->ReadBlock(prep_block->dblk_ptr_, cache_control_, &prep_block->dblk_data_));
+  return ReadDataBlock(idx_iter.GetCurrentBlockPointer(), prep_block);
+}
+
+Status CFileIterator::ReadDataBlock(const BlockPointer &dblk_ptr,
+                                    PreparedBlock *prep_block) {
+  prep_block->dblk_ptr_ = dblk_ptr;
+  RETURN_NOT_OK(reader_->ReadBlock(prep_block->dblk_ptr_, cache_control_,
+                                   BlockCache::DATA_BLOCK, &prep_block->dblk_data_));
 
   uint32_t num_rows_in_block = 0;
   Slice data_block = prep_block->dblk_data_.data();
@@ -775,7 +916,11 @@ Status CFileIterator::ReadCurrentDataBlock(const IndexTreeIterator &idx_iter,
   }
 
   BlockDecoder *bd;
-  RETURN_NOT_OK(reader_->type_encoding_info()->CreateBlockDecoder(&bd, data_block, this));
+  preparing_dblk_ptr_ = dblk_ptr;
+  preparing_dblk_ = true;
+  Status s = reader_->type_encoding_info()->CreateBlockDecoder(&bd, data_block, this);
+  preparing_dblk_ = false;
+  RETURN_NOT_OK(s);
   prep_block->dblk_.reset(bd);
   RETURN_NOT_OK(prep_block->dblk_->ParseHeader());
 
@@ -799,18 +944,116 @@ Status CFileIterator::ReadCurrentDataBlock(const IndexTreeIterator &idx_iter,
   return Status::OK();
 }
 
-Status CFileIterator::QueueCurrentDataBlock(const IndexTreeIterator &idx_iter) {
+Status CFileIterator::QueueDataBlock(const BlockPointer &dblk_ptr) {
   pblock_pool_scoped_ptr b = prepared_block_pool_.make_scoped_ptr(
     prepared_block_pool_.Construct());
-  RETURN_NOT_OK(ReadCurrentDataBlock(idx_iter, b.get()));
+  RETURN_NOT_OK(ReadDataBlock(dblk_ptr, b.get()));
   prepared_blocks_.push_back(b.release());
+
+  consecutive_queued_blocks_++;
+  if (prefetched_blocks_ > 0) {
+    prefetched_blocks_--;
+  }
+  MaybePrefetchAhead();
   return Status::OK();
 }
 
+void CFileIterator::MaybePrefetchAhead() {
+  int32_t n_ahead = FLAGS_cfile_read_ahead_blocks;
+  // Only read ahead once the access pattern looks sequential: callers doing
+  // point lookups re-seek instead of pulling consecutive blocks.
+  if (n_ahead <= 0 || consecutive_queued_blocks_ < 2) {
+    return;
+  }
+
+  if (!prefetch_iter_) {
+    BlockPointer root;
+    if (seeked_ == posidx_iter_.get()) {
+      root = BlockPointer(reader_->footer().posidx_info().root_block());
+    } else {
+      root = BlockPointer(reader_->footer().validx_info().root_block());
+    }
+    gscoped_ptr<IndexTreeIterator> iter(IndexTreeIterator::Create(reader_, root));
+    // Position the read-ahead iterator on the block which was just queued.
+    // Read-ahead is best-effort: on failure, the foreground read will
+    // surface any error.
+    Slice cur_key;
+    if (fences_) {
+      // In fence mode the b-tree iterator isn't positioned; re-derive the
+      // current index key from the fence entry of the just-queued block.
+      tmp_buf_.clear();
+      KeyEncoderTraits<UINT32, faststring>::Encode(
+          (*fences_)[cur_fence_idx_].first_ordinal, &tmp_buf_);
+      cur_key = Slice(tmp_buf_);
+    } else {
+      cur_key = seeked_->GetCurrentKey();
+    }
+    if (!iter->SeekAtOrBefore(cur_key).ok()) {
+      return;
+    }
+    prefetch_iter_.reset(iter.release());
+    prefetched_blocks_ = 0;
+  }
+
+  while (prefetched_blocks_ < n_ahead && prefetch_iter_->HasNext()) {
+    if (!prefetch_iter_->Next().ok()) {
+      break;
+    }
+    BlockPointer ptr = prefetch_iter_->GetCurrentBlockPointer();
+    if (cache_control_ != CFileReader::CACHE_BLOCK) {
+      // Scans which bypass the block cache (e.g. compaction inputs) can't
+      // stage read-ahead data there. Instead, hint the kernel to begin
+      // readahead in the background; the foreground read will then be
+      // served from the page cache.
+      if (PREDICT_FALSE(!reader_->PrefetchRange(ptr).ok())) {
+        break;
+      }
+      prefetched_blocks_++;
+      continue;
+    }
+    {
+      MutexLock l(prefetch_lock_);
+      outstanding_prefetches_++;
+    }
+    Status s = CFileIOPool()->SubmitClosure(
+        Bind(&CFileIterator::DoPrefetch, Unretained(this), ptr));
+    if (PREDICT_FALSE(!s.ok())) {
+      MutexLock l(prefetch_lock_);
+      outstanding_prefetches_--;
+      break;
+    }
+    prefetched_blocks_++;
+  }
+}
+
+void CFileIterator::DoPrefetch(BlockPointer ptr) {
+  BlockHandle bh;
+  Status s = reader_->ReadBlock(ptr, CFileReader::CACHE_BLOCK, BlockCache::DATA_BLOCK, &bh);
+  if (PREDICT_FALSE(!s.ok())) {
+    // Any error will resurface on the foreground read of this block.
+    VLOG(1) << "Read-ahead of block " << ptr.ToString()
+            << " failed: " << s.ToString();
+  }
+  MutexLock l(prefetch_lock_);
+  if (--outstanding_prefetches_ == 0) {
+    prefetch_cv_.Broadcast();
+  }
+}
+
+void CFileIterator::WaitForPrefetches() {
+  MutexLock l(prefetch_lock_);
+  while (outstanding_prefetches_ > 0) {
+    prefetch_cv_.Wait();
+  }
+}
+
 bool CFileIterator::HasNext() const {
   CHECK(seeked_) << "not seeked";
   CHECK(!prepared_) << "Cannot call HasNext() mid-batch";
 
+  if (fences_) {
+    return !prepared_blocks_.empty() || cur_fence_idx_ + 1 < fences_->size();
+  }
   return !prepared_blocks_.empty() || seeked_->HasNext();
 }
 
@@ -826,6 +1069,17 @@ Status CFileIterator::PrepareBatch(size_t *n) {
   // Read blocks until all blocks covering the requested range are in the
   // prepared_blocks_ queue.
   while (prepared_blocks_.back()->last_row_idx() < end_idx) {
+    if (fences_) {
+      // Advance to the next block through the flat fence index rather than
+      // the positional index b-tree.
+      if (PREDICT_FALSE(cur_fence_idx_ + 1 >= fences_->size())) {
+        VLOG(1) << "Reached EOF";
+        break;
+      }
+      cur_fence_idx_++;
+      RETURN_NOT_OK(QueueDataBlock((*fences_)[cur_fence_idx_].ptr));
+      continue;
+    }
     Status s = seeked_->Next();
     if (PREDICT_FALSE(s.IsNotFound())) {
       VLOG(1) << "Reached EOF";
@@ -833,7 +1087,7 @@ Status CFileIterator::PrepareBatch(size_t *n) {
     } else if (!s.ok()) {
       return s;
     }
-    RETURN_NOT_OK(QueueCurrentDataBlock(*seeked_));
+    RETURN_NOT_OK(QueueDataBlock(seeked_->GetCurrentBlockPointer()));
   }
 
   // Seek the first block in the queue such that the first value to be read
@@ -907,6 +1161,97 @@ Status CFileIterator::FinishBatch() {
   return Status::OK();
 }
 
+void CFileIterator::PrepareDictionaryPredicate(ColumnMaterializationContext* ctx) {
+  if (!dict_decoder_ || !ctx->DecoderEvalNotDisabled() || codewords_matching_pred_) {
+    return;
+  }
+  size_t nwords = dict_decoder_->Count();
+  if (nwords == 0) {
+    return;
+  }
+  codewords_matching_pred_.reset(new SelectionVector(nwords));
+  codewords_matching_pred_->SetAllFalse();
+  size_t n_matching = 0;
+  for (size_t i = 0; i < nwords; i++) {
+    Slice cur_string = dict_decoder_->string_at_index(i);
+    if (ctx->pred()->EvaluateCell<BINARY>(static_cast<const void *>(&cur_string))) {
+      BitmapSet(codewords_matching_pred_->mutable_bitmap(), i);
+      n_matching++;
+    }
+  }
+  codewords_match_all_ = n_matching == nwords;
+}
+
+bool CFileIterator::ShouldGatherSelected(ColumnMaterializationContext* ctx,
+                                         SelectionVectorView* sel,
+                                         size_t nrows) const {
+  if (FLAGS_cfile_gather_scan_threshold <= 0 || nrows == 0) {
+    return false;
+  }
+  // Restricted to contexts which have explicitly declared their selection
+  // vector final (only non-predicate columns in the materializing iterator):
+  // other callers only write to the selection vector, or expect every row to
+  // be decoded. Nullable columns interleave the non-null bitmap with the
+  // data, so runs of selected rows don't map directly to positions within
+  // the decoder.
+  if (!ctx->AllowSkipUnselected() || ctx->sel() == nullptr || reader_->is_nullable()) {
+    return false;
+  }
+  size_t max_selected = nrows * FLAGS_cfile_gather_scan_threshold;
+  size_t n_selected = 0;
+  for (size_t i = 0; i < nrows; i++) {
+    if (sel->TestBit(i) && ++n_selected > max_selected) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Status CFileIterator::GatherSelectedValues(PreparedBlock* pb,
+                                           SelectionVectorView* sel,
+                                           ColumnDataView* dst,
+                                           size_t nrows) {
+  DCHECK_GT(nrows, 0);
+#ifndef NDEBUG
+  // The cells of unselected rows are left unmaterialized; make that obvious
+  // in debug builds.
+  kudu::OverwriteWithPattern(reinterpret_cast<char *>(dst->data()),
+                             dst->stride() * nrows,
+                             "GATHERGATHERGATHER");
+#endif
+  size_t idx = 0;
+  while (idx < nrows) {
+    // Find the next run of selected rows.
+    size_t run_start = idx;
+    while (run_start < nrows && !sel->TestBit(run_start)) {
+      run_start++;
+    }
+    if (run_start == nrows) {
+      // No further selected rows. Materialize the final row of the range
+      // anyway, so that the decoder finishes positioned exactly 'nrows' past
+      // where it started: some decoders cannot seek to the one-past-the-end
+      // position.
+      run_start = nrows - 1;
+    }
+    size_t run_end = run_start + 1;
+    while (run_end < nrows && sel->TestBit(run_end)) {
+      run_end++;
+    }
+
+    pb->dblk_->SeekToPositionInBlock(pb->idx_in_block_ + run_start);
+    size_t n = run_end - run_start;
+    ColumnDataView run_dst(*dst);
+    run_dst.Advance(run_start);
+    RETURN_NOT_OK(pb->dblk_->CopyNextValues(&n, &run_dst));
+    if (PREDICT_FALSE(n != run_end - run_start)) {
+      return Status::Corruption(
+          Substitute("Data block yielded $0 of $1 requested rows", n, run_end - run_start));
+    }
+    idx = run_end;
+  }
+  return Status::OK();
+}
+
 Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
   CHECK(seeked_) << "not seeked";
 
@@ -918,19 +1263,8 @@ Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
 
   // Determine the matching codewords for dictionary encoding if they haven't
   // yet been determined for this CFile.
-  if (dict_decoder_ && ctx->DecoderEvalNotDisabled() && !codewords_matching_pred_) {
-    size_t nwords = dict_decoder_->Count();
-    if (nwords > 0) {
-      codewords_matching_pred_.reset(new SelectionVector(nwords));
-      codewords_matching_pred_->SetAllFalse();
-      for (size_t i = 0; i < nwords; i++) {
-        Slice cur_string = dict_decoder_->string_at_index(i);
-        if (ctx->pred()->EvaluateCell<BINARY>(static_cast<const void *>(&cur_string))) {
-          BitmapSet(codewords_matching_pred_->mutable_bitmap(), i);
-        }
-      }
-    }
-  }
+  PrepareDictionaryPredicate(ctx);
+
   for (PreparedBlock *pb : prepared_blocks_) {
     if (pb->needs_rewind_) {
       // Seek back to the saved position.
@@ -990,7 +1324,14 @@ Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
       // Fetch as many as we can from the current datablock.
       size_t this_batch = rem;
 
-      if (ctx->DecoderEvalNotDisabled()) {
+      size_t rows_left_in_block = pb->num_rows_in_block_ - pb->idx_in_block_;
+      if (ShouldGatherSelected(ctx, &remaining_sel,
+                               std::min<size_t>(rem, rows_left_in_block))) {
+        // Sparse selection: copy only the selected runs, seeking the decoder
+        // past the unselected rows.
+        this_batch = std::min<size_t>(rem, rows_left_in_block);
+        RETURN_NOT_OK(GatherSelectedValues(pb, &remaining_sel, &remaining_dst, this_batch));
+      } else if (ctx->DecoderEvalNotDisabled()) {
         RETURN_NOT_OK(pb->dblk_->CopyNextAndEval(&this_batch, ctx, &remaining_sel, &remaining_dst));
       } else {
         RETURN_NOT_OK(pb->dblk_->CopyNextValues(&this_batch, &remaining_dst));
@@ -35,7 +35,10 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/mem_tracker.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/object_pool.h"
 #include "kudu/util/once.h"
 #include "kudu/util/rle-encoding.h"
@@ -44,6 +47,9 @@
 #include "kudu/common/key_encoder.h"
 
 namespace kudu {
+
+class ThreadPool;
+
 namespace cfile {
 
 class BlockCache;
@@ -54,6 +60,11 @@ class CFileFooterPB;
 class CFileIterator;
 class BinaryPlainBlockDecoder;
 
+// Returns the process-wide thread pool used for cfile background I/O
+// (sequential-scan read-ahead and parallel column preparation). Lazily
+// created on first use.
+ThreadPool* CFileIOPool();
+
 class CFileReader {
  public:
   // Fully open a cfile using a previously opened block.
@@ -96,8 +107,11 @@ class CFileReader {
 
   // TODO: make this private? should only be used
   // by the iterator and index tree readers, I think.
+  //
+  // 'block_type' determines the block's cache priority and which per-type
+  // cache metrics are updated; see BlockCache::BlockType.
   Status ReadBlock(const BlockPointer &ptr, CacheControl cache_control,
-                   BlockHandle *ret) const;
+                   BlockCache::BlockType block_type, BlockHandle *ret) const;
 
   // Return the number of rows in this cfile.
   // This is assumed to be reasonably fast (i.e does not scan
@@ -121,6 +135,18 @@ class CFileReader {
     return block_->id();
   }
 
+  // Hint to the OS that the given range of the underlying block will soon
+  // be read. Best-effort; see fs::ReadableBlock::Prefetch().
+  Status PrefetchRange(const BlockPointer& ptr) const {
+    return block_->Prefetch(ptr.offset(), ptr.size());
+  }
+
+  // Hint to the OS how the underlying block's data will be accessed.
+  // Best-effort; see fs::ReadableBlock::HintAccessPattern().
+  Status HintAccessPattern(FileAccessPatternHint hint) const {
+    return block_->HintAccessPattern(hint);
+  }
+
   const TypeInfo *type_info() const {
     DCHECK(init_once_.initted());
     return type_info_;
@@ -160,6 +186,25 @@ class CFileReader {
     return BlockPointer(footer().posidx_info().root_block());
   }
 
+  // One entry per data block in the file: the ordinal of the block's first
+  // row, and the location of the block. Entries are sorted by ordinal.
+  struct OrdinalFence {
+    rowid_t first_ordinal;
+    BlockPointer ptr;
+  };
+  typedef std::vector<OrdinalFence> OrdinalFenceIndex;
+
+  // Return a flat in-memory index of the file's data blocks, built lazily
+  // from the positional index on first use. This lets ordinal seeks use a
+  // single binary search instead of descending the positional index b-tree
+  // (and taking a block cache lookup per level) on every seek.
+  //
+  // The returned index is immutable and remains valid for the lifetime of
+  // this reader.
+  //
+  // Requires that the file has a positional index (see has_posidx()).
+  Status GetOrdinalFenceIndex(const OrdinalFenceIndex** fences);
+
   // Return true if there is a value-based index on this file.
   bool has_validx() const { return footer().has_validx_info(); }
   BlockPointer validx_root() const {
@@ -203,6 +248,11 @@ class CFileReader {
 
   KuduOnceDynamic init_once_;
 
+  // Protects 'ordinal_fences_'. The index itself is immutable once
+  // installed; the lock only guards installation.
+  simple_spinlock ordinal_fence_lock_;
+  gscoped_ptr<OrdinalFenceIndex> ordinal_fences_;
+
   ScopedTrackedConsumption mem_consumption_;
 };
 
@@ -384,6 +434,23 @@ class CFileIterator : public ColumnIterator {
   // single set of predicate-satisfying codewords.
   SelectionVector* GetCodeWordsMatchingPredicate() { return codewords_matching_pred_.get(); }
 
+  // Returns true if every codeword in the dictionary satisfies the predicate,
+  // in which case decoder-level evaluation can skip the per-row codeword
+  // membership test and decode the block directly.
+  bool CodeWordsMatchAllPredicate() const { return codewords_match_all_; }
+
+  // If the iterator is currently preparing a data block which is eligible
+  // for the decoded block cache, returns true and sets *key to the block's
+  // cache key. This is called by block decoders which can cache their
+  // decoded representation (e.g. BShufBlockDecoder) at creation time.
+  bool GetPreparingBlockCacheKey(BlockCache::CacheKey* key) const {
+    if (!preparing_dblk_ || cache_control_ != CFileReader::CACHE_BLOCK) {
+      return false;
+    }
+    *key = BlockCache::CacheKey(reader_->block_id(), preparing_dblk_ptr_.offset());
+    return true;
+  }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(CFileIterator);
 
@@ -430,6 +497,11 @@ class CFileIterator : public ColumnIterator {
   // Seek the given PreparedBlock to the given index within it.
   void SeekToPositionInBlock(PreparedBlock *pb, uint32_t idx_in_block);
 
+  // Read the data block at 'dblk_ptr' into the given PreparedBlock
+  // structure.
+  Status ReadDataBlock(const BlockPointer &dblk_ptr,
+                       PreparedBlock *prep_block);
+
   // Read the data block currently pointed to by idx_iter_
   // into the given PreparedBlock structure.
   //
@@ -437,14 +509,52 @@ class CFileIterator : public ColumnIterator {
   Status ReadCurrentDataBlock(const IndexTreeIterator &idx_iter,
                               PreparedBlock *prep_block);
 
-  // Read the data block currently pointed to by idx_iter_, and enqueue
-  // it onto the end of the prepared_blocks_ deque.
-  Status QueueCurrentDataBlock(const IndexTreeIterator &idx_iter);
+  // Read the data block at 'dblk_ptr', and enqueue it onto the end of the
+  // prepared_blocks_ deque.
+  Status QueueDataBlock(const BlockPointer &dblk_ptr);
 
   // Fully initialize the underlying cfile reader if needed, and clear any
   // seek-related state.
   Status PrepareForNewSeek();
 
+  // If this cfile is dictionary-coded and 'ctx' carries a predicate eligible
+  // for decoder-level evaluation, translate the predicate into the set of
+  // matching dictionary codewords. The translation is done at most once per
+  // cfile; subsequent calls are no-ops.
+  void PrepareDictionaryPredicate(ColumnMaterializationContext* ctx);
+
+  // Determine whether Scan() should use the sparse "gather" path for the
+  // next 'nrows' rows: rather than bulk-decoding every row, seek the decoder
+  // over unselected rows and copy only the selected runs. Only applies to
+  // non-nullable columns whose context allows skipping unselected rows, when
+  // the fraction of selected rows is at or below
+  // --cfile_gather_scan_threshold.
+  bool ShouldGatherSelected(ColumnMaterializationContext* ctx,
+                            SelectionVectorView* sel,
+                            size_t nrows) const;
+
+  // Copy only the selected runs among the next 'nrows' rows of 'pb' into
+  // 'dst', seeking the decoder past unselected rows. The cells of unselected
+  // rows are left unmaterialized. The final row of the range is always
+  // materialized, so the decoder finishes positioned exactly 'nrows' past
+  // its starting position.
+  Status GatherSelectedValues(PreparedBlock* pb,
+                              SelectionVectorView* sel,
+                              ColumnDataView* dst,
+                              size_t nrows);
+
+  // If the current access pattern looks sequential, issue asynchronous
+  // read-ahead of upcoming data blocks into the block cache on the shared
+  // read-ahead pool.
+  void MaybePrefetchAhead();
+
+  // Read the block at 'ptr' into the block cache. Runs on the shared
+  // read-ahead thread pool.
+  void DoPrefetch(BlockPointer ptr);
+
+  // Block until all read-ahead tasks issued by this iterator have finished.
+  void WaitForPrefetches();
+
   CFileReader* reader_;
 
   gscoped_ptr<IndexTreeIterator> posidx_iter_;
@@ -457,10 +567,28 @@ class CFileIterator : public ColumnIterator {
   // Set containing the codewords that match the predicate in a dictionary.
   std::unique_ptr<SelectionVector> codewords_matching_pred_;
 
+  // True if all codewords in the dictionary matched the predicate. Only
+  // meaningful once codewords_matching_pred_ has been computed.
+  bool codewords_match_all_;
+
   // The currently in-use index iterator. This is equal to either
   // posidx_iter_.get(), validx_iter_.get(), or NULL if not seeked.
+  //
+  // When 'fences_' is set, posidx_iter_ serves only as a non-NULL sentinel
+  // here: block-to-block iteration walks the fence index instead, and the
+  // b-tree iterator is never positioned.
   IndexTreeIterator *seeked_;
 
+  // When seeked by ordinal, the reader's flat ordinal fence index, which is
+  // used in place of the positional index b-tree for finding and advancing
+  // between data blocks. NULL when seeked by value or not seeked. Owned by
+  // the reader.
+  const CFileReader::OrdinalFenceIndex *fences_;
+
+  // When 'fences_' is set, the index of the fence entry for the most
+  // recently queued data block.
+  size_t cur_fence_idx_;
+
   // Data blocks that contain data relevant to the currently Prepared
   // batch of rows.
   // These pointers are allocated from the prepared_block_pool_ below.
@@ -475,6 +603,12 @@ class CFileIterator : public ColumnIterator {
   // Whether this iterator will ask the cfile to cache the blocks it requests or not.
   const CFileReader::CacheControl cache_control_;
 
+  // The pointer of the data block being prepared by ReadDataBlock(), set
+  // only for the duration of the block decoder's creation. Used by
+  // GetPreparingBlockCacheKey().
+  BlockPointer preparing_dblk_ptr_;
+  bool preparing_dblk_;
+
   // RowID of the current prepared batch, if prepared_ is true.
   // Otherwise, the RowID of the next batch that will be prepared.
   rowid_t last_prepare_idx_;
@@ -487,6 +621,24 @@ class CFileIterator : public ColumnIterator {
 
   // a temporary buffer for encoding
   faststring tmp_buf_;
+
+  // A second index iterator which runs ahead of 'seeked_' on the same index,
+  // issuing background reads of upcoming data blocks once the access pattern
+  // looks sequential. See MaybePrefetchAhead().
+  gscoped_ptr<IndexTreeIterator> prefetch_iter_;
+
+  // Number of consecutive data blocks pulled since the last seek.
+  int consecutive_queued_blocks_;
+
+  // Number of blocks that 'prefetch_iter_' is currently ahead of 'seeked_'.
+  int prefetched_blocks_;
+
+  // Protects 'outstanding_prefetches_'.
+  Mutex prefetch_lock_;
+  ConditionVariable prefetch_cv_;
+
+  // Number of read-ahead tasks currently in flight on the read-ahead pool.
+  int outstanding_prefetches_;
 };
 
 } // namespace cfile
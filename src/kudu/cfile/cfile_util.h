@@ -60,6 +60,14 @@ struct WriterOptions {
   // instead of entire keys.
   bool optimize_index_keys;
 
+  // Whether to track the minimum and maximum values appended to the file and
+  // store them in the footer metadata (under CFileWriter::kMinValueMetaEntryName
+  // and kMaxValueMetaEntryName). Readers can use these statistics to skip the
+  // file entirely for scans whose predicates exclude the value range.
+  //
+  // Default: false.
+  bool write_value_stats;
+
   // Column storage attributes.
   //
   // Default: all default values as specified in the constructor in
@@ -73,6 +73,9 @@ const char kMagicStringV1[] = "kuducfil";
 const char kMagicStringV2[] = "kuducfl2";
 const int kMagicLength = 8;
 
+const char* CFileWriter::kMinValueMetaEntryName = "min_value";
+const char* CFileWriter::kMaxValueMetaEntryName = "max_value";
+
 static const size_t kMinBlockSize = 512;
 
 static CompressionType GetDefaultCompressionCodec() {
@@ -87,7 +90,8 @@ WriterOptions::WriterOptions()
     block_restart_interval(16),
     write_posidx(false),
     write_validx(false),
-    optimize_index_keys(true) {
+    optimize_index_keys(true),
+    write_value_stats(false) {
 }
 
 
@@ -107,6 +111,7 @@ CFileWriter::CFileWriter(const WriterOptions &options,
     is_nullable_(is_nullable),
     typeinfo_(typeinfo),
     key_encoder_(nullptr),
+    has_value_stats_(false),
     state_(kWriterInitialized) {
   EncodingType encoding = options_.storage_attributes.encoding;
   Status s = TypeEncodingInfo::Get(typeinfo_, encoding, &type_encoding_info_);
@@ -231,6 +236,13 @@ Status CFileWriter::FinishAndReleaseBlock(ScopedWritableBlockCloser* closer) {
   // Example: dictionary block for dictionary encoding
   RETURN_NOT_OK(data_block_->AppendExtraInfo(this, &footer));
 
+  // Store the min/max value statistics, if we tracked any. Note that a file
+  // containing only null values legitimately has no statistics.
+  if (has_value_stats_) {
+    AddMetadataPair(kMinValueMetaEntryName, Slice(value_stats_min_));
+    AddMetadataPair(kMaxValueMetaEntryName, Slice(value_stats_max_));
+  }
+
   // Flush metadata.
   FlushMetadataToPB(footer.mutable_metadata());
 
@@ -286,6 +298,10 @@ void CFileWriter::FlushMetadataToPB(RepeatedPtrField<FileMetadataPairPB> *field)
 Status CFileWriter::AppendEntries(const void *entries, size_t count) {
   DCHECK(!is_nullable_);
 
+  if (options_.write_value_stats) {
+    UpdateValueStats(entries, count);
+  }
+
   int rem = count;
 
   const uint8_t *ptr = reinterpret_cast<const uint8_t *>(entries);
@@ -319,6 +335,9 @@ Status CFileWriter::AppendNullableEntries(const uint8_t *bitmap,
   BitmapIterator bmap_iter(bitmap, count);
   while ((nblock = bmap_iter.Next(&not_null)) > 0) {
     if (not_null) {
+      if (options_.write_value_stats) {
+        UpdateValueStats(ptr, nblock);
+      }
       size_t rem = nblock;
       do {
         int n = data_block_->Add(ptr, rem);
@@ -344,6 +363,40 @@ Status CFileWriter::AppendNullableEntries(const uint8_t *bitmap,
   return Status::OK();
 }
 
+void CFileWriter::UpdateValueStats(const void* entries, size_t count) {
+  const uint8_t* ptr = reinterpret_cast<const uint8_t*>(entries);
+  for (size_t i = 0; i < count; i++, ptr += typeinfo_->size()) {
+    if (PREDICT_FALSE(!has_value_stats_)) {
+      CopyCellToStat(ptr, &value_stats_min_);
+      CopyCellToStat(ptr, &value_stats_max_);
+      has_value_stats_ = true;
+      continue;
+    }
+    if (CompareCellToStat(ptr, value_stats_min_) < 0) {
+      CopyCellToStat(ptr, &value_stats_min_);
+    } else if (CompareCellToStat(ptr, value_stats_max_) > 0) {
+      CopyCellToStat(ptr, &value_stats_max_);
+    }
+  }
+}
+
+void CFileWriter::CopyCellToStat(const void* cell, faststring* dst) const {
+  if (typeinfo_->physical_type() == BINARY) {
+    const Slice* val = reinterpret_cast<const Slice*>(cell);
+    dst->assign_copy(val->data(), val->size());
+  } else {
+    dst->assign_copy(reinterpret_cast<const uint8_t*>(cell), typeinfo_->size());
+  }
+}
+
+int CFileWriter::CompareCellToStat(const void* cell, const faststring& stat) const {
+  if (typeinfo_->physical_type() == BINARY) {
+    Slice stat_slice(stat);
+    return typeinfo_->Compare(cell, &stat_slice);
+  }
+  return typeinfo_->Compare(cell, stat.data());
+}
+
 Status CFileWriter::FinishCurDataBlock() {
   uint32_t num_elems_in_block = data_block_->Count();
   if (is_nullable_) {
@@ -92,6 +92,13 @@ class NullBitmapBuilder {
 // Main class used to write a CFile.
 class CFileWriter {
  public:
+  // Metadata entries under which the minimum and maximum appended values are
+  // stored when WriterOptions::write_value_stats is enabled. For binary-typed
+  // files the entry holds the value contents; for other types it holds the
+  // value's raw in-memory representation.
+  static const char* kMinValueMetaEntryName;
+  static const char* kMaxValueMetaEntryName;
+
   explicit CFileWriter(const WriterOptions &options,
                        const TypeInfo* typeinfo,
                        bool is_nullable,
@@ -181,6 +188,17 @@ class CFileWriter {
 
   Status FinishCurDataBlock();
 
+  // Fold 'count' contiguous non-null cells starting at 'entries' into the
+  // min/max value statistics.
+  void UpdateValueStats(const void* entries, size_t count);
+
+  // Copy the cell pointed to by 'cell' into the stat buffer 'dst'.
+  void CopyCellToStat(const void* cell, faststring* dst) const;
+
+  // Three-way comparison of the cell pointed to by 'cell' against the value
+  // held in the stat buffer 'stat'.
+  int CompareCellToStat(const void* cell, const faststring& stat) const;
+
   // Flush the current unflushed_metadata_ entries into the given protobuf
   // field, clearing the buffer.
   void FlushMetadataToPB(google::protobuf::RepeatedPtrField<FileMetadataPairPB> *field);
@@ -216,6 +234,15 @@ class CFileWriter {
   // Metadata which has been added to the writer but not yet flushed.
   vector<pair<string, string> > unflushed_metadata_;
 
+  // Whether any value has been folded into the min/max value statistics yet.
+  // Only used when options_.write_value_stats is enabled.
+  bool has_value_stats_;
+
+  // The smallest and largest non-null values appended so far, in the format
+  // described at kMinValueMetaEntryName.
+  faststring value_stats_min_;
+  faststring value_stats_max_;
+
   gscoped_ptr<BlockBuilder> data_block_;
   gscoped_ptr<IndexTreeBuilder> posidx_builder_;
   gscoped_ptr<IndexTreeBuilder> validx_builder_;
@@ -25,12 +25,17 @@
 #include "kudu/cfile/block_encodings.h"
 #include "kudu/cfile/bshuf_block.h"
 #include "kudu/cfile/cfile_writer.h"
+#include "kudu/cfile/frame_of_reference_block.h"
 #include "kudu/cfile/plain_bitmap_block.h"
 #include "kudu/cfile/plain_block.h"
 #include "kudu/cfile/rle_block.h"
 #include "kudu/cfile/binary_plain_block.h"
 #include "kudu/cfile/binary_prefix_block.h"
+#include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/util/group_varint-inl.h"
@@ -705,6 +710,112 @@ TEST_F(TestEncoding, TestRleIntBlockEncoder) {
   ASSERT_EQ(14UL, s.size());
 }
 
+// Test that the RLE decoder evaluates predicates run-at-a-time: runs which
+// fail the predicate deselect a whole range of the selection vector without
+// materializing the values.
+TEST_F(TestEncoding, TestRleIntBlockDecoderCopyNextAndEval) {
+  unique_ptr<WriterOptions> opts(NewWriterOptions());
+  RleIntBlockBuilder<INT32> ibb(opts.get());
+
+  // Three runs of 100 values each: 0s, 1s, 2s.
+  vector<int32_t> ints;
+  for (int32_t run_val = 0; run_val < 3; run_val++) {
+    for (int i = 0; i < 100; i++) {
+      ints.push_back(run_val);
+    }
+  }
+  ASSERT_EQ(ints.size(), ibb.Add(reinterpret_cast<const uint8_t *>(&ints[0]),
+                                 ints.size()));
+  Slice s = ibb.Finish(0);
+
+  RleIntBlockDecoder<INT32> ibd(s);
+  ASSERT_OK(ibd.ParseHeader());
+
+  ScopedColumnBlock<INT32> cb(ints.size());
+  ColumnDataView dst(&cb);
+  SelectionVector sel(ints.size());
+  sel.SetAllTrue();
+  SelectionVectorView sel_view(&sel);
+
+  ColumnSchema col("col", INT32);
+  int32_t pred_val = 1;
+  ColumnPredicate pred = ColumnPredicate::Equality(col, &pred_val);
+  ColumnMaterializationContext ctx(0, &pred, &cb, &sel);
+
+  size_t n = ints.size();
+  ASSERT_OK(ibd.CopyNextAndEval(&n, &ctx, &sel_view, &dst));
+  ASSERT_EQ(ints.size(), n);
+  ASSERT_FALSE(ctx.DecoderEvalNotSupported());
+
+  for (size_t i = 0; i < ints.size(); i++) {
+    bool expect_selected = ints[i] == pred_val;
+    ASSERT_EQ(expect_selected, sel.IsRowSelected(i)) << "at index " << i;
+    if (expect_selected) {
+      ASSERT_EQ(pred_val, cb[i]);
+    }
+  }
+}
+
+TEST_F(TestEncoding, TestRleBitMapBlockDecoderCopyNextAndEval) {
+  unique_ptr<WriterOptions> opts(NewWriterOptions());
+  RleBitMapBlockBuilder bbb(opts.get());
+
+  // A run of 64 'false' followed by a run of 64 'true'.
+  vector<uint8_t> bools;
+  for (int i = 0; i < 128; i++) {
+    bools.push_back(i >= 64);
+  }
+  ASSERT_EQ(bools.size(), bbb.Add(&bools[0], bools.size()));
+  Slice s = bbb.Finish(0);
+
+  RleBitMapBlockDecoder bbd(s);
+  ASSERT_OK(bbd.ParseHeader());
+
+  ScopedColumnBlock<BOOL> cb(bools.size());
+  ColumnDataView dst(&cb);
+  SelectionVector sel(bools.size());
+  sel.SetAllTrue();
+  SelectionVectorView sel_view(&sel);
+
+  ColumnSchema col("col", BOOL);
+  bool pred_val = true;
+  ColumnPredicate pred = ColumnPredicate::Equality(col, &pred_val);
+  ColumnMaterializationContext ctx(0, &pred, &cb, &sel);
+
+  size_t n = bools.size();
+  ASSERT_OK(bbd.CopyNextAndEval(&n, &ctx, &sel_view, &dst));
+  ASSERT_EQ(bools.size(), n);
+  ASSERT_FALSE(ctx.DecoderEvalNotSupported());
+
+  for (size_t i = 0; i < bools.size(); i++) {
+    ASSERT_EQ(i >= 64, sel.IsRowSelected(i)) << "at index " << i;
+    if (i >= 64) {
+      ASSERT_TRUE(cb[i]);
+    }
+  }
+}
+
+TEST_F(TestEncoding, TestFrameOfReferenceIntBlockEncoder) {
+  unique_ptr<WriterOptions> opts(NewWriterOptions());
+  FrameOfReferenceBlockBuilder<INT64> ibb(opts.get());
+  gscoped_ptr<int64_t[]> ints(new int64_t[10000]);
+  // Slowly-increasing timestamps should pack into just a few bits per value.
+  int64_t ts = 1400000000000000;
+  for (int i = 0; i < 10000; i++) {
+    ts += random() % 1000;
+    ints[i] = ts;
+  }
+  ibb.Add(reinterpret_cast<const uint8_t *>(ints.get()), 10000);
+
+  Slice s = ibb.Finish(12345);
+  LOG(INFO) << "FOR-encoded size for 10k slowly-increasing int64s: " << s.size();
+  ASSERT_LT(s.size(), 10000 * 2);
+
+  FrameOfReferenceBlockDecoder<INT64> ibd(s);
+  ASSERT_OK(ibd.ParseHeader());
+  ASSERT_EQ(10000, ibd.Count());
+}
+
 TEST_F(TestEncoding, TestPlainBitMapRoundTrip) {
   TestBoolBlockRoundTrip<PlainBitMapBlockBuilder, PlainBitMapBlockDecoder>();
 }
@@ -789,7 +900,16 @@ struct BitshuffleTestTraits {
     typedef BShufBlockDecoder<type> decoder_type;
   };
 };
-typedef testing::Types<RleTestTraits, BitshuffleTestTraits, PlainTestTraits> MyTestFixtures;
+
+struct FrameOfReferenceTestTraits {
+  template<DataType type>
+  struct Classes {
+    typedef FrameOfReferenceBlockBuilder<type> encoder_type;
+    typedef FrameOfReferenceBlockDecoder<type> decoder_type;
+  };
+};
+typedef testing::Types<RleTestTraits, BitshuffleTestTraits, PlainTestTraits,
+                       FrameOfReferenceTestTraits> MyTestFixtures;
 TYPED_TEST_CASE(IntEncodingTest, MyTestFixtures);
 
 template<class TestTraits>
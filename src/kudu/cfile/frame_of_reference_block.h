@@ -0,0 +1,391 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Frame-of-reference/delta encoding for fixed size integer blocks,
+// such as UINT8, INT8, UINT16, INT16, UINT32, INT32, UINT64, INT64.
+#ifndef KUDU_CFILE_FRAME_OF_REFERENCE_BLOCK_H
+#define KUDU_CFILE_FRAME_OF_REFERENCE_BLOCK_H
+
+#include <algorithm>
+#include <stdint.h>
+#include <type_traits>
+
+#include "kudu/cfile/block_encodings.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/gutil/bits.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/bit-stream-utils.inline.h"
+#include "kudu/util/coding.h"
+
+namespace kudu {
+namespace cfile {
+
+// FrameOfReferenceBlockBuilder encodes a block of fixed size integers by
+// splitting it into frames of up to 128 consecutive values, and bit-packing
+// the differences between consecutive values within each frame relative to
+// the smallest such difference.
+//
+// All delta arithmetic is performed modulo the width of the type, so the
+// encoding is lossless for arbitrary inputs, while sorted or slowly-varying
+// data (e.g. timestamps or auto-incrementing IDs) packs into just a few bits
+// per value.
+//
+// The block format is as follows:
+//
+// 1. Header: (8 bytes total)
+//
+//    <first_ordinal> [32-bit]
+//      The ordinal offset of the first element in the block.
+//
+//    <num_elements> [32-bit]
+//      The number of elements encoded in the block.
+//
+// 2. A sequence of frames, each covering up to 128 consecutive values:
+//
+//    <reference> [size_of_type bytes]
+//      The first value in the frame, stored raw.
+//
+//    <min_delta> [size_of_type bytes]
+//      The minimum difference between consecutive values in the frame,
+//      where differences are interpreted as signed values of the type's
+//      width.
+//
+//    <bit_width> [8 bits]
+//      The number of bits used to pack each delta in this frame.
+//      May be zero, in which case no packed deltas follow.
+//
+//    <deltas> [(frame_count - 1) * bit_width bits]
+//      For each value after the first, the difference from the preceding
+//      value minus <min_delta>, bit-packed. The packed run is padded to a
+//      byte boundary at the end of the frame.
+//
+// Values are reconstructed as v[i] = v[i-1] + min_delta + delta[i].
+//
+// NOTE: all on-disk ints are encoded little-endian.
+template<DataType Type>
+class FrameOfReferenceBlockBuilder final : public BlockBuilder {
+ public:
+  explicit FrameOfReferenceBlockBuilder(const WriterOptions* options)
+    : count_(0),
+      options_(options) {
+    Reset();
+  }
+
+  void Reset() OVERRIDE {
+    auto block_size = options_->storage_attributes.cfile_block_size;
+    count_ = 0;
+    data_.clear();
+    data_.reserve(block_size);
+    buffer_.clear();
+    finished_ = false;
+    rem_elem_capacity_ = block_size / size_of_type;
+  }
+
+  bool IsBlockFull() const OVERRIDE {
+    return rem_elem_capacity_ == 0;
+  }
+
+  int Add(const uint8_t* vals_void, size_t count) OVERRIDE {
+    DCHECK(!finished_);
+    int to_add = std::min<int>(rem_elem_capacity_, count);
+    data_.append(vals_void, to_add * size_of_type);
+    count_ += to_add;
+    rem_elem_capacity_ -= to_add;
+    return to_add;
+  }
+
+  size_t Count() const OVERRIDE {
+    return count_;
+  }
+
+  Status GetFirstKey(void* key) const OVERRIDE {
+    DCHECK(finished_);
+    if (count_ == 0) {
+      return Status::NotFound("no keys in data block");
+    }
+    memcpy(key, cell_ptr(0), size_of_type);
+    return Status::OK();
+  }
+
+  Status GetLastKey(void* key) const OVERRIDE {
+    DCHECK(finished_);
+    if (count_ == 0) {
+      return Status::NotFound("no keys in data block");
+    }
+    memcpy(key, cell_ptr(count_ - 1), size_of_type);
+    return Status::OK();
+  }
+
+  Slice Finish(rowid_t ordinal_pos) OVERRIDE {
+    BitWriter writer(&buffer_);
+    writer.PutAligned<uint32_t>(ordinal_pos, sizeof(uint32_t));
+    writer.PutAligned<uint32_t>(count_, sizeof(uint32_t));
+
+    for (uint32_t frame_start = 0; frame_start < count_; frame_start += kFrameSize) {
+      uint32_t frame_count = std::min<uint32_t>(kFrameSize, count_ - frame_start);
+      const CppType* frame = cell_ptr(frame_start);
+
+      // Compute the differences between consecutive values. Unsigned
+      // arithmetic makes the (mod 2^w) wrap-around well defined.
+      UnsignedType deltas[kFrameSize];
+      for (uint32_t i = 1; i < frame_count; i++) {
+        deltas[i] = static_cast<UnsignedType>(frame[i]) -
+            static_cast<UnsignedType>(frame[i - 1]);
+      }
+
+      // Find the minimum delta, interpreting the deltas as signed values
+      // so that a mix of increasing and decreasing values still yields a
+      // small packed range.
+      SignedType min_delta_signed = 0;
+      for (uint32_t i = 1; i < frame_count; i++) {
+        SignedType d = static_cast<SignedType>(deltas[i]);
+        if (i == 1 || d < min_delta_signed) {
+          min_delta_signed = d;
+        }
+      }
+      UnsignedType min_delta = static_cast<UnsignedType>(min_delta_signed);
+
+      // Make the deltas relative to the minimum and determine how many
+      // bits are needed for the largest one.
+      UnsignedType max_rel_delta = 0;
+      for (uint32_t i = 1; i < frame_count; i++) {
+        deltas[i] -= min_delta;
+        max_rel_delta = std::max(max_rel_delta, deltas[i]);
+      }
+      int bit_width = max_rel_delta == 0 ?
+          0 : Bits::Log2FloorNonZero64(max_rel_delta) + 1;
+
+      writer.PutAligned<UnsignedType>(static_cast<UnsignedType>(frame[0]), size_of_type);
+      writer.PutAligned<UnsignedType>(min_delta, size_of_type);
+      writer.PutAligned<uint8_t>(bit_width, 1);
+      if (bit_width > 0) {
+        for (uint32_t i = 1; i < frame_count; i++) {
+          writer.PutValue(deltas[i], bit_width);
+        }
+      }
+      // Pad the frame to a byte boundary.
+      writer.Flush(/* align= */ true);
+    }
+    writer.Flush();
+    finished_ = true;
+    return Slice(buffer_.data(), writer.bytes_written());
+  }
+
+ private:
+  typedef typename TypeTraits<Type>::cpp_type CppType;
+  typedef typename std::make_unsigned<CppType>::type UnsignedType;
+  typedef typename std::make_signed<CppType>::type SignedType;
+
+  const CppType* cell_ptr(int idx) const {
+    DCHECK_GE(idx, 0);
+    return reinterpret_cast<const CppType*>(&data_[idx * size_of_type]);
+  }
+
+  enum {
+    // The number of values in each frame.
+    kFrameSize = 128,
+    size_of_type = TypeTraits<Type>::size
+  };
+
+  faststring data_;
+  faststring buffer_;
+  uint32_t count_;
+  int rem_elem_capacity_;
+  bool finished_;
+  const WriterOptions* options_;
+};
+
+template<DataType Type>
+class FrameOfReferenceBlockDecoder final : public BlockDecoder {
+ public:
+  explicit FrameOfReferenceBlockDecoder(Slice slice)
+      : data_(std::move(slice)),
+        parsed_(false),
+        ordinal_pos_base_(0),
+        num_elems_(0),
+        cur_idx_(0) {
+  }
+
+  Status ParseHeader() OVERRIDE {
+    CHECK(!parsed_);
+    if (data_.size() < kHeaderSize) {
+      return Status::Corruption(
+        strings::Substitute("not enough bytes for header: frame-of-reference block header "
+          "size ($0) less than expected header length ($1)",
+          data_.size(), kHeaderSize));
+    }
+
+    ordinal_pos_base_ = DecodeFixed32(&data_[0]);
+    num_elems_        = DecodeFixed32(&data_[4]);
+
+    RETURN_NOT_OK(Expand());
+
+    parsed_ = true;
+    return Status::OK();
+  }
+
+  void SeekToPositionInBlock(uint pos) OVERRIDE {
+    CHECK(parsed_) << "Must call ParseHeader()";
+    if (PREDICT_FALSE(num_elems_ == 0)) {
+      DCHECK_EQ(0, pos);
+      return;
+    }
+
+    DCHECK_LE(pos, num_elems_);
+    cur_idx_ = pos;
+  }
+
+  Status SeekAtOrAfterValue(const void* value_void, bool* exact) OVERRIDE {
+    CppType target = *reinterpret_cast<const CppType*>(value_void);
+    int32_t left = 0;
+    int32_t right = num_elems_;
+    while (left != right) {
+      uint32_t mid = (left + right) / 2;
+      CppType mid_key = Decode<CppType>(
+            &decoded_[mid * size_of_type]);
+      if (mid_key == target) {
+        cur_idx_ = mid;
+        *exact = true;
+        return Status::OK();
+      } else if (mid_key > target) {
+        right = mid;
+      } else {
+        left = mid + 1;
+      }
+    }
+
+    *exact = false;
+    cur_idx_ = left;
+    if (cur_idx_ == num_elems_) {
+      return Status::NotFound("after last key in block");
+    }
+    return Status::OK();
+  }
+
+  Status CopyNextValues(size_t* n, ColumnDataView* dst) OVERRIDE {
+    DCHECK(parsed_);
+    DCHECK_EQ(dst->stride(), sizeof(CppType));
+    if (PREDICT_FALSE(*n == 0 || cur_idx_ >= num_elems_)) {
+      *n = 0;
+      return Status::OK();
+    }
+
+    size_t max_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
+    memcpy(dst->data(), &decoded_[cur_idx_ * size_of_type], max_fetch * size_of_type);
+
+    *n = max_fetch;
+    cur_idx_ += max_fetch;
+
+    return Status::OK();
+  }
+
+  size_t GetCurrentIndex() const OVERRIDE {
+    DCHECK(parsed_) << "must parse header first";
+    return cur_idx_;
+  }
+
+  virtual rowid_t GetFirstRowId() const OVERRIDE {
+    return ordinal_pos_base_;
+  }
+
+  size_t Count() const OVERRIDE {
+    return num_elems_;
+  }
+
+  bool HasNext() const OVERRIDE {
+    return (num_elems_ - cur_idx_) > 0;
+  }
+
+ private:
+  typedef typename TypeTraits<Type>::cpp_type CppType;
+  typedef typename std::make_unsigned<CppType>::type UnsignedType;
+
+  template<typename T>
+  static T Decode(const uint8_t* ptr) {
+    T result;
+    memcpy(&result, ptr, sizeof(result));
+    return result;
+  }
+
+  // Decode all of the frames up front: scans which touch any of the block
+  // typically read most of it, and having the full frame materialized
+  // keeps the positional seek and copy paths trivial. The per-frame
+  // unpacking loop below has a fixed bit width, which lets the compiler
+  // vectorize it.
+  Status Expand() {
+    decoded_.resize(static_cast<size_t>(num_elems_) * size_of_type);
+    uint8_t* out = decoded_.data();
+    BitReader reader(data_.data() + kHeaderSize, data_.size() - kHeaderSize);
+    uint32_t rem = num_elems_;
+    while (rem > 0) {
+      uint32_t frame_count = std::min<uint32_t>(kFrameSize, rem);
+      UnsignedType reference;
+      UnsignedType min_delta;
+      uint8_t bit_width;
+      if (PREDICT_FALSE(!reader.GetAligned<UnsignedType>(size_of_type, &reference) ||
+                        !reader.GetAligned<UnsignedType>(size_of_type, &min_delta) ||
+                        !reader.GetAligned<uint8_t>(1, &bit_width))) {
+        return Status::Corruption("truncated frame in frame-of-reference block");
+      }
+      if (PREDICT_FALSE(bit_width > 8 * size_of_type)) {
+        return Status::Corruption(
+            strings::Substitute("invalid bit width $0 in frame-of-reference block",
+                                bit_width));
+      }
+
+      memcpy(out, &reference, size_of_type);
+      out += size_of_type;
+      UnsignedType prev = reference;
+      for (uint32_t i = 1; i < frame_count; i++) {
+        UnsignedType rel_delta = 0;
+        if (bit_width > 0 &&
+            PREDICT_FALSE(!reader.GetValue(bit_width, &rel_delta))) {
+          return Status::Corruption("truncated frame in frame-of-reference block");
+        }
+        prev += min_delta + rel_delta;
+        memcpy(out, &prev, size_of_type);
+        out += size_of_type;
+      }
+      // The padding at the end of the frame is implicitly skipped by the
+      // aligned reads at the top of the next frame.
+      rem -= frame_count;
+    }
+    return Status::OK();
+  }
+
+  // Length of a header.
+  static const size_t kHeaderSize = sizeof(uint32_t) * 2;
+  enum {
+    // The number of values in each frame. Must match the builder.
+    kFrameSize = 128,
+    size_of_type = TypeTraits<Type>::size
+  };
+
+  Slice data_;
+  bool parsed_;
+
+  rowid_t ordinal_pos_base_;
+  uint32_t num_elems_;
+
+  size_t cur_idx_;
+  faststring decoded_;
+};
+
+} // namespace cfile
+} // namespace kudu
+#endif
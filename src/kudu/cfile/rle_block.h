@@ -24,6 +24,7 @@
 #include "kudu/gutil/port.h"
 #include "kudu/cfile/block_encodings.h"
 #include "kudu/cfile/cfile_util.h"
+#include "kudu/common/column_materialization_context.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/util/coding.h"
 #include "kudu/util/coding-inl.h"
@@ -185,6 +186,45 @@ class RleBitMapBlockDecoder final : public BlockDecoder {
     return Status::OK();
   }
 
+  virtual Status CopyNextAndEval(size_t* n,
+                                 ColumnMaterializationContext* ctx,
+                                 SelectionVectorView* sel,
+                                 ColumnDataView* dst) OVERRIDE {
+    DCHECK(parsed_);
+    DCHECK_LE(*n, dst->nrows());
+    DCHECK_EQ(dst->stride(), sizeof(bool));
+
+    ctx->SetDecoderEvalSupported();
+    if (PREDICT_FALSE(*n == 0 || cur_idx_ >= num_elems_)) {
+      *n = 0;
+      return Status::OK();
+    }
+
+    size_t to_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
+    size_t fetched = 0;
+    uint8_t* data_ptr = dst->data();
+    while (fetched < to_fetch) {
+      bool val = false;
+      size_t run = rle_decoder_.GetNextRun(&val, to_fetch - fetched);
+      DCHECK_GT(run, 0);
+      if (ctx->pred()->EvaluateCell<BOOL>(&val)) {
+        // The run passes the predicate: materialize it. Rows which were
+        // already deselected keep their cleared bits.
+        memset(data_ptr, val, run);
+      } else {
+        // The run fails the predicate: deselect the whole range at once
+        // without materializing the values.
+        sel->ClearBits(fetched, run);
+      }
+      data_ptr += run;
+      fetched += run;
+    }
+
+    cur_idx_ += to_fetch;
+    *n = to_fetch;
+    return Status::OK();
+  }
+
   virtual Status SeekAtOrAfterValue(const void *value,
                                     bool *exact_match) OVERRIDE {
     return Status::NotSupported("BOOL keys are not supported!");
@@ -409,6 +449,48 @@ class RleIntBlockDecoder final : public BlockDecoder {
     return Status::OK();
   }
 
+  virtual Status CopyNextAndEval(size_t* n,
+                                 ColumnMaterializationContext* ctx,
+                                 SelectionVectorView* sel,
+                                 ColumnDataView* dst) OVERRIDE {
+    DCHECK(parsed_);
+    DCHECK_LE(*n, dst->nrows());
+    DCHECK_EQ(dst->stride(), sizeof(CppType));
+
+    ctx->SetDecoderEvalSupported();
+    if (PREDICT_FALSE(*n == 0 || cur_idx_ >= num_elems_)) {
+      *n = 0;
+      return Status::OK();
+    }
+
+    size_t to_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
+    size_t fetched = 0;
+    uint8_t* data_ptr = dst->data();
+    while (fetched < to_fetch) {
+      CppType val;
+      size_t run = rle_decoder_.GetNextRun(&val, to_fetch - fetched);
+      DCHECK_GT(run, 0);
+      if (ctx->pred()->EvaluateCell<IntType>(&val)) {
+        // The run passes the predicate: materialize it. Rows which were
+        // already deselected keep their cleared bits.
+        for (size_t i = 0; i < run; i++) {
+          *reinterpret_cast<CppType*>(data_ptr) = val;
+          data_ptr += kCppTypeSize;
+        }
+      } else {
+        // The run fails the predicate: deselect the whole range at once
+        // without materializing the values.
+        sel->ClearBits(fetched, run);
+        data_ptr += run * kCppTypeSize;
+      }
+      fetched += run;
+    }
+
+    cur_idx_ += to_fetch;
+    *n = to_fetch;
+    return Status::OK();
+  }
+
   virtual bool HasNext() const OVERRIDE {
     return cur_idx_ < num_elems_;
   }
@@ -23,6 +23,8 @@
 #include <glog/logging.h>
 
 #include "kudu/cfile/bshuf_block.h"
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/frame_of_reference_block.h"
 #include "kudu/cfile/plain_bitmap_block.h"
 #include "kudu/cfile/plain_block.h"
 #include "kudu/cfile/rle_block.h"
@@ -79,7 +81,12 @@ struct DataTypeEncodingTraits<Type, BIT_SHUFFLE> {
 
   static Status CreateBlockDecoder(BlockDecoder **bd, const Slice &slice,
                                    CFileIterator *iter) {
-    *bd = new BShufBlockDecoder<Type>(slice);
+    BShufBlockDecoder<Type>* decoder = new BShufBlockDecoder<Type>(slice);
+    BlockCache::CacheKey key(BlockCache::FileId(), 0);
+    if (iter != nullptr && iter->GetPreparingBlockCacheKey(&key)) {
+      decoder->SetDecodedCacheKey(key);
+    }
+    *bd = decoder;
     return Status::OK();
   }
 };
@@ -182,6 +189,22 @@ struct DataTypeEncodingTraits<IntType, RLE> {
   }
 };
 
+// Partial specialization for frame-of-reference encoded integers.
+template<DataType IntType>
+struct DataTypeEncodingTraits<IntType, FOR_ENCODING> {
+
+  static Status CreateBlockBuilder(BlockBuilder** bb, const WriterOptions *options) {
+    *bb = new FrameOfReferenceBlockBuilder<IntType>(options);
+    return Status::OK();
+  }
+
+  static Status CreateBlockDecoder(BlockDecoder** bd, const Slice& slice,
+                                   CFileIterator *iter) {
+    *bd = new FrameOfReferenceBlockDecoder<IntType>(slice);
+    return Status::OK();
+  }
+};
+
 
 template<typename TypeEncodingTraitsClass>
 TypeEncodingInfo::TypeEncodingInfo(TypeEncodingTraitsClass t)
@@ -240,27 +263,35 @@ class TypeEncodingResolver {
     AddMapping<UINT8, BIT_SHUFFLE>();
     AddMapping<UINT8, PLAIN_ENCODING>();
     AddMapping<UINT8, RLE>();
+    AddMapping<UINT8, FOR_ENCODING>();
     AddMapping<INT8, BIT_SHUFFLE>();
     AddMapping<INT8, PLAIN_ENCODING>();
     AddMapping<INT8, RLE>();
+    AddMapping<INT8, FOR_ENCODING>();
     AddMapping<UINT16, BIT_SHUFFLE>();
     AddMapping<UINT16, PLAIN_ENCODING>();
     AddMapping<UINT16, RLE>();
+    AddMapping<UINT16, FOR_ENCODING>();
     AddMapping<INT16, BIT_SHUFFLE>();
     AddMapping<INT16, PLAIN_ENCODING>();
     AddMapping<INT16, RLE>();
+    AddMapping<INT16, FOR_ENCODING>();
     AddMapping<UINT32, BIT_SHUFFLE>();
     AddMapping<UINT32, RLE>();
     AddMapping<UINT32, PLAIN_ENCODING>();
+    AddMapping<UINT32, FOR_ENCODING>();
     AddMapping<INT32, BIT_SHUFFLE>();
     AddMapping<INT32, PLAIN_ENCODING>();
     AddMapping<INT32, RLE>();
+    AddMapping<INT32, FOR_ENCODING>();
     AddMapping<UINT64, BIT_SHUFFLE>();
     AddMapping<UINT64, PLAIN_ENCODING>();
     AddMapping<UINT64, RLE>();
+    AddMapping<UINT64, FOR_ENCODING>();
     AddMapping<INT64, BIT_SHUFFLE>();
     AddMapping<INT64, PLAIN_ENCODING>();
     AddMapping<INT64, RLE>();
+    AddMapping<INT64, FOR_ENCODING>();
     AddMapping<FLOAT, BIT_SHUFFLE>();
     AddMapping<FLOAT, PLAIN_ENCODING>();
     AddMapping<DOUBLE, BIT_SHUFFLE>();
@@ -80,6 +80,13 @@ namespace client {
 
 namespace internal {
 
+// Maximum number of Write RPCs that a batcher will keep in flight to any one
+// tablet server. Bounding the per-server pipeline keeps a slow or overloaded
+// server from absorbing an arbitrarily deep queue of RPCs (and the buffer
+// space their operations pin) while batches destined for healthy servers
+// proceed unimpeded.
+static const int kMaxWriteRpcsPerServer = 2;
+
 // About lock ordering in this file:
 // ------------------------------
 // The locks must be acquired in the following order:
@@ -123,8 +130,8 @@ struct InFlightOp {
     // the op may sit in this state for some amount of time while waiting on the
     // MetaCache to perform an RPC to the master and find the correct tablet.
     //
-    // OWNERSHIP: the op is present in the 'ops_' set, and also referenced by the
-    // in-flight callback provided to MetaCache.
+    // OWNERSHIP: the op is counted in 'num_pending_ops_', and referenced by
+    // the in-flight callback provided to MetaCache.
     kLookingUpTablet,
 
     // Once the correct tablet has been determined, and the tablet locations have been
@@ -137,9 +144,9 @@ struct InFlightOp {
     //
     //   1) There are already too many outstanding RPCs to the given tablet server.
     //
-    //      We restrict the number of concurrent RPCs from one client to a given TS
-    //      to achieve better batching and throughput.
-    //      TODO: not implemented yet
+    //      We restrict the number of concurrent RPCs from one batcher to a given TS
+    //      to achieve better batching and throughput, and so that a slow server
+    //      doesn't absorb an unbounded pipeline of RPCs. See FlushBuffer().
     //
     //   2) Batching delay.
     //
@@ -151,16 +158,16 @@ struct InFlightOp {
     //      requests together in a single RPC.
     //      TODO: not implemented yet
     //
-    // OWNERSHIP: When the operation is in this state, it is present in the 'ops_' set
-    // and also in the 'per_tablet_ops' map.
+    // OWNERSHIP: When the operation is in this state, it is present in the
+    // 'per_tablet_ops_' map (and counted in 'num_pending_ops_').
     kBufferedToTabletServer,
 
     // Once the operation has been flushed (either due to explicit Flush() or background flush)
     // it will enter this state.
     //
-    // OWNERSHIP: when entering this state, the op is removed from 'per_tablet_ops' map
-    // and ownership is transfered to a WriteRPC's 'ops_' vector. The op still
-    // remains in the 'ops_' set.
+    // OWNERSHIP: when entering this state, the op is removed from 'per_tablet_ops_' map
+    // and ownership is transfered to a WriteRPC's 'ops_' vector. The op is still
+    // counted in 'num_pending_ops_'.
     kRequestSent
   };
   State state;
@@ -201,7 +208,8 @@ class WriteRpc : public RetriableRpc<RemoteTabletServer, WriteRequestPB, WriteRe
            const MonoTime& deadline,
            const shared_ptr<Messenger>& messenger,
            const string& tablet_id,
-           uint64_t propagated_timestamp);
+           uint64_t propagated_timestamp,
+           RemoteTabletServer* window_server);
   virtual ~WriteRpc();
   string ToString() const override;
 
@@ -213,6 +221,7 @@ class WriteRpc : public RetriableRpc<RemoteTabletServer, WriteRequestPB, WriteRe
   const vector<InFlightOp*>& ops() const { return ops_; }
   const WriteResponsePB& resp() const { return resp_; }
   const string& tablet_id() const { return tablet_id_; }
+  RemoteTabletServer* window_server() const { return window_server_; }
 
  protected:
   void Try(RemoteTabletServer* replica, const ResponseCallback& callback) override;
@@ -230,6 +239,10 @@ class WriteRpc : public RetriableRpc<RemoteTabletServer, WriteRequestPB, WriteRe
 
   // The id of the tablet being written to.
   string tablet_id_;
+
+  // The tablet server whose per-server RPC window this RPC occupies, or
+  // NULL if the leader was unknown at send time. See Batcher::FlushBuffer().
+  RemoteTabletServer* window_server_;
 };
 
 WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
@@ -239,11 +252,13 @@ WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
                    const MonoTime& deadline,
                    const shared_ptr<Messenger>& messenger,
                    const string& tablet_id,
-                   uint64_t propagated_timestamp)
+                   uint64_t propagated_timestamp,
+                   RemoteTabletServer* window_server)
     : RetriableRpc(replica_picker, request_tracker, deadline, messenger),
       batcher_(batcher),
       ops_(std::move(ops)),
-      tablet_id_(tablet_id) {
+      tablet_id_(tablet_id),
+      window_server_(window_server) {
   const Schema* schema = table()->schema().schema_;
 
   req_.set_tablet_id(tablet_id_);
@@ -400,6 +415,7 @@ Batcher::Batcher(KuduClient* client,
     error_collector_(std::move(error_collector)),
     had_errors_(false),
     flush_callback_(nullptr),
+    num_pending_ops_(0),
     next_op_sequence_number_(0),
     timeout_(client->default_rpc_timeout()),
     outstanding_lookups_(0),
@@ -410,13 +426,32 @@ void Batcher::Abort() {
   std::unique_lock<simple_spinlock> l(lock_);
   state_ = kAborted;
 
+  // Only the buffered (not yet sent) ops can be aborted. Those are exactly
+  // the ones still present in 'per_tablet_ops_': ops still looking up their
+  // tablet will notice the aborted state when the lookup finishes, and ops
+  // already handed off to a WriteRpc may still be delivered.
   vector<InFlightOp*> to_abort;
-  for (InFlightOp* op : ops_) {
-    std::lock_guard<simple_spinlock> l(op->lock_);
-    if (op->state == InFlightOp::kBufferedToTabletServer) {
+  for (const OpsMap::value_type& e : per_tablet_ops_) {
+    for (InFlightOp* op : e.second) {
+      std::lock_guard<simple_spinlock> l(op->lock_);
+      DCHECK_EQ(op->state, InFlightOp::kBufferedToTabletServer);
       to_abort.push_back(op);
     }
   }
+  per_tablet_ops_.clear();
+
+  // Ops whose send was deferred by the per-server window haven't been handed
+  // to a WriteRpc yet, so they can be aborted the same way.
+  for (const auto& e : deferred_buffers_) {
+    for (const auto& buffer : e.second) {
+      for (InFlightOp* op : buffer.second) {
+        std::lock_guard<simple_spinlock> l(op->lock_);
+        DCHECK_EQ(op->state, InFlightOp::kBufferedToTabletServer);
+        to_abort.push_back(op);
+      }
+    }
+  }
+  deferred_buffers_.clear();
 
   for (InFlightOp* op : to_abort) {
     VLOG(1) << "Aborting op: " << op->ToString();
@@ -431,12 +466,7 @@ void Batcher::Abort() {
 }
 
 Batcher::~Batcher() {
-  if (PREDICT_FALSE(!ops_.empty())) {
-    for (InFlightOp* op : ops_) {
-      LOG(ERROR) << "Orphaned op: " << op->ToString();
-    }
-    LOG(FATAL) << "ops_ not empty";
-  }
+  CHECK_EQ(0, num_pending_ops_) << "Orphaned ops still pending";
   CHECK(state_ == kFlushed || state_ == kAborted) << "Bad state: " << state_;
 }
 
@@ -448,13 +478,13 @@ void Batcher::SetTimeout(const MonoDelta& timeout) {
 
 bool Batcher::HasPendingOperations() const {
   std::lock_guard<simple_spinlock> l(lock_);
-  return !ops_.empty();
+  return num_pending_ops_ > 0;
 }
 
 int Batcher::CountBufferedOperations() const {
   std::lock_guard<simple_spinlock> l(lock_);
   if (state_ == kGatheringOps) {
-    return ops_.size();
+    return num_pending_ops_;
   } else {
     // If we've already started to flush, then the ops aren't
     // considered "buffered".
@@ -466,7 +496,7 @@ void Batcher::CheckForFinishedFlush() {
   sp::shared_ptr<KuduSession> session;
   {
     std::lock_guard<simple_spinlock> l(lock_);
-    if (state_ != kFlushing || !ops_.empty()) {
+    if (state_ != kFlushing || num_pending_ops_ > 0) {
       return;
     }
 
@@ -551,7 +581,7 @@ void Batcher::AddInFlightOp(InFlightOp* op) {
 
   std::lock_guard<simple_spinlock> l(lock_);
   CHECK_EQ(state_, kGatheringOps);
-  InsertOrDie(&ops_, op);
+  num_pending_ops_++;
   op->sequence_number_ = next_op_sequence_number_++;
 
   // Set the time of the first operation in the batch, if not set yet.
@@ -575,8 +605,9 @@ void Batcher::MarkInFlightOpFailed(InFlightOp* op, const Status& s) {
 }
 
 void Batcher::MarkInFlightOpFailedUnlocked(InFlightOp* op, const Status& s) {
-  CHECK_EQ(1, ops_.erase(op))
-    << "Could not remove op " << op->ToString() << " from in-flight list";
+  CHECK_GT(num_pending_ops_, 0)
+    << "Could not remove op " << op->ToString() << ": no ops in flight";
+  num_pending_ops_--;
   gscoped_ptr<KuduError> error(new KuduError(op->write_op.release(), s));
   error_collector_->AddError(std::move(error));
   had_errors_ = true;
@@ -689,6 +720,29 @@ void Batcher::FlushBuffersIfReady() {
 void Batcher::FlushBuffer(RemoteTablet* tablet, const vector<InFlightOp*>& ops) {
   CHECK(!ops.empty());
 
+  // Bound the number of Write RPCs concurrently in flight to any one tablet
+  // server. The window is keyed by the tablet's leader as known at send time;
+  // if the leader is not known, the RPC is sent unthrottled and the replica
+  // picker sorts out the destination.
+  RemoteTabletServer* ts = tablet->LeaderTServer();
+  if (ts != nullptr) {
+    std::lock_guard<simple_spinlock> l(lock_);
+    int& in_flight = LookupOrInsert(&rpcs_by_server_, ts, 0);
+    if (in_flight >= kMaxWriteRpcsPerServer) {
+      VLOG(3) << "FlushBuffer: server " << ts->ToString() << " already has "
+              << in_flight << " RPCs in flight; deferring buffer for tablet "
+              << tablet->tablet_id();
+      deferred_buffers_[ts].emplace_back(tablet, ops);
+      return;
+    }
+    in_flight++;
+  }
+  SendBuffer(tablet, ops, ts);
+}
+
+void Batcher::SendBuffer(RemoteTablet* tablet,
+                         const vector<InFlightOp*>& ops,
+                         RemoteTabletServer* window_server) {
   // Create and send an RPC that aggregates the ops. The RPC is freed when
   // its callback completes.
   //
@@ -708,7 +762,8 @@ void Batcher::FlushBuffer(RemoteTablet* tablet, const vector<InFlightOp*>& ops)
                                deadline_,
                                client_->data_->messenger_,
                                tablet->tablet_id(),
-                               client_->data_->GetLatestObservedTimestamp());
+                               client_->data_->GetLatestObservedTimestamp(),
+                               window_server);
   rpc->SendRpc();
 }
 
@@ -777,10 +832,34 @@ void Batcher::ProcessWriteResponse(const WriteRpc& rpc,
   //     from which the Flush() is being called.
   {
     std::lock_guard<simple_spinlock> l(lock_);
-    for (InFlightOp* op : rpc.ops()) {
-      CHECK_EQ(1, ops_.erase(op))
-            << "Could not remove op " << op->ToString()
-            << " from in-flight list";
+    num_pending_ops_ -= rpc.ops().size();
+    CHECK_GE(num_pending_ops_, 0)
+        << "More ops completed than were in flight";
+  }
+
+  // Release the RPC's slot in its server's in-flight window. If a buffer for
+  // the same server was deferred waiting for a slot, hand the slot directly
+  // to it.
+  RemoteTabletServer* ts = rpc.window_server();
+  if (ts != nullptr) {
+    RemoteTablet* next_tablet = nullptr;
+    vector<InFlightOp*> next_ops;
+    {
+      std::lock_guard<simple_spinlock> l(lock_);
+      auto it = deferred_buffers_.find(ts);
+      if (it == deferred_buffers_.end()) {
+        --FindOrDie(rpcs_by_server_, ts);
+      } else {
+        next_tablet = it->second.front().first;
+        next_ops = std::move(it->second.front().second);
+        it->second.pop_front();
+        if (it->second.empty()) {
+          deferred_buffers_.erase(it);
+        }
+      }
+    }
+    if (next_tablet != nullptr) {
+      SendBuffer(next_tablet, next_ops, ts);
     }
   }
 
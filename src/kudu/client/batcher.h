@@ -17,8 +17,9 @@
 #ifndef KUDU_CLIENT_BATCHER_H
 #define KUDU_CLIENT_BATCHER_H
 
+#include <deque>
 #include <unordered_map>
-#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "kudu/client/client.h"
@@ -45,6 +46,7 @@ struct InFlightOp;
 
 class ErrorCollector;
 class RemoteTablet;
+class RemoteTabletServer;
 class WriteRpc;
 
 // A Batcher is the class responsible for collecting row operations, routing them to the
@@ -155,8 +157,20 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
 
   void CheckForFinishedFlush();
   void FlushBuffersIfReady();
+
+  // Send the given tablet's buffer, or defer it if the tablet's leader
+  // already has the maximum number of Write RPCs outstanding from this
+  // batcher. Deferred buffers are sent as earlier RPCs to the same server
+  // complete.
   void FlushBuffer(RemoteTablet* tablet, const std::vector<InFlightOp*>& ops);
 
+  // Unconditionally send the given tablet's buffer as a Write RPC.
+  // 'window_server' is the server whose in-flight window the RPC occupies,
+  // or NULL if the RPC is not subject to windowing (leader unknown).
+  void SendBuffer(RemoteTablet* tablet,
+                  const std::vector<InFlightOp*>& ops,
+                  RemoteTabletServer* window_server);
+
   // Cleans up an RPC response, scooping out any errors and passing them up
   // to the batcher.
   void ProcessWriteResponse(const WriteRpc& rpc, const Status& s);
@@ -200,12 +214,30 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
   // will be called exactly once (and the state changed to kFlushed).
   KuduStatusCallback* flush_callback_;
 
-  // All buffered or in-flight ops.
-  std::unordered_set<InFlightOp*> ops_;
+  // The number of buffered or in-flight ops. An op is counted from the time
+  // it is added until it either succeeds or fails. We track only a count
+  // rather than a set of pointers so that the hot Add() path doesn't have to
+  // do a hash insertion (and its associated allocation) under lock_.
+  // Protected by lock_.
+  int64_t num_pending_ops_;
+
   // Each tablet's buffered ops.
   typedef std::unordered_map<RemoteTablet*, std::vector<InFlightOp*> > OpsMap;
   OpsMap per_tablet_ops_;
 
+  // The number of outstanding Write RPCs, keyed by the tablet's leader server
+  // as known at send time. Used by FlushBuffer() to bound the number of
+  // concurrent RPCs to any one server.
+  // Protected by lock_.
+  std::unordered_map<RemoteTabletServer*, int> rpcs_by_server_;
+
+  // Tablet buffers whose send was deferred because their leader server
+  // already had the maximum number of RPCs outstanding. Buffers are sent in
+  // deferral order as that server's earlier RPCs complete.
+  // Protected by lock_.
+  std::unordered_map<RemoteTabletServer*,
+      std::deque<std::pair<RemoteTablet*, std::vector<InFlightOp*> > > > deferred_buffers_;
+
   // When each operation is added to the batcher, it is assigned a sequence number
   // which preserves the user's intended order. Preserving order is critical when
   // a batch contains multiple operations against the same row key. This member
@@ -283,6 +283,9 @@ KuduClient::Data::~Data() {
   // fix urgently, because typically once a client is shutting down, latency
   // jitter on the reactor is not a big deal (and DNS resolutions are not in flight).
   ThreadRestrictions::ScopedAllowWait allow_wait;
+  if (meta_cache_) {
+    meta_cache_->StopConnectionKeepAlivePings();
+  }
   dns_resolver_.reset();
 }
 
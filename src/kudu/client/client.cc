@@ -234,6 +234,12 @@ Status KuduClientBuilder::Build(shared_ptr<KuduClient>* client) {
 
   // Init messenger.
   MessengerBuilder builder("client");
+  // Negotiation involves multiple blocking round trips per connection, and
+  // with the default cap of 4 threads a mass reconnect (e.g. after a rolling
+  // restart of the cluster) serializes behind a few slow or dead servers.
+  // Negotiation threads are torn down again after a short idle timeout, so a
+  // larger cap only costs anything during such reconnect storms.
+  builder.set_max_negotiation_threads(16);
   RETURN_NOT_OK(builder.Build(&c->data_->messenger_));
 
   c->data_->master_server_addrs_ = data_->master_server_addrs_;
@@ -1100,6 +1106,13 @@ Status KuduScanner::SetSnapshotRaw(uint64_t snapshot_timestamp) {
   return Status::OK();
 }
 
+Status KuduScanner::SetReadYoungestWithinMicros(uint64_t staleness_micros) {
+  if (data_->open_) {
+    return Status::IllegalState("Staleness bound must be set before Open()");
+  }
+  return data_->mutable_configuration()->SetReadYoungestWithinMicros(staleness_micros);
+}
+
 Status KuduScanner::SetSelection(KuduClient::ReplicaSelection selection) {
   if (data_->open_) {
     return Status::IllegalState("Replica selection must be set before Open()");
@@ -1225,6 +1238,10 @@ void KuduScanner::Close() {
 
   VLOG(2) << "Ending " << data_->DebugString();
 
+  // If a prefetched batch is still in flight, its response is being written
+  // into members of 'data_', so it must complete before we tear anything down.
+  data_->DiscardPrefetchedBatch();
+
   // Close the scanner on the server-side, if necessary.
   //
   // If the scan did not match any rows, the tserver will not assign a scanner ID.
@@ -1261,10 +1278,6 @@ Status KuduScanner::NextBatch(vector<KuduRowResult>* rows) {
 }
 
 Status KuduScanner::NextBatch(KuduScanBatch* batch) {
-  // TODO: do some double-buffering here -- when we return this batch
-  // we should already have fired off the RPC for the next batch, but
-  // need to do some swapping of the response objects around to avoid
-  // stomping on the memory the user is looking at.
   CHECK(data_->open_);
   CHECK(data_->proxy_);
 
@@ -1278,20 +1291,36 @@ Status KuduScanner::NextBatch(KuduScanBatch* batch) {
     // We have data from a previous scan.
     VLOG(2) << "Extracting data from " << data_->DebugString();
     data_->data_in_open_ = false;
-    return batch->data_->Reset(&data_->controller_,
-                               data_->configuration().projection(),
-                               data_->configuration().client_projection(),
-                                make_gscoped_ptr(data_->last_response_.release_data()));
+    RETURN_NOT_OK(batch->data_->Reset(&data_->controller_,
+                                      data_->configuration().projection(),
+                                      data_->configuration().client_projection(),
+                                      make_gscoped_ptr(data_->last_response_.release_data())));
+    // Overlap the next round trip with the application's processing of
+    // this batch.
+    data_->MaybePrefetchNextBatch();
+    return Status::OK();
   } else if (data_->last_response_.has_more_results()) {
     // More data is available in this tablet.
     VLOG(2) << "Continuing " << data_->DebugString();
 
     MonoTime batch_deadline = MonoTime::Now() + data_->configuration().timeout();
-    data_->PrepareRequest(KuduScanner::Data::CONTINUE);
+    bool use_prefetched = data_->prefetch_in_flight_;
+    if (!use_prefetched) {
+      data_->PrepareRequest(KuduScanner::Data::CONTINUE);
+    }
 
     while (true) {
-      bool allow_time_for_failover = data_->configuration().is_fault_tolerant();
-      ScanRpcStatus result = data_->SendScanRpc(batch_deadline, allow_time_for_failover);
+      ScanRpcStatus result;
+      if (use_prefetched) {
+        // The RPC for this batch was already sent when the previous batch was
+        // returned; just collect its response. If it failed, the retry logic
+        // below re-sends the same request synchronously.
+        result = data_->WaitForPrefetchedBatch();
+        use_prefetched = false;
+      } else {
+        bool allow_time_for_failover = data_->configuration().is_fault_tolerant();
+        result = data_->SendScanRpc(batch_deadline, allow_time_for_failover);
+      }
 
       // Success case.
       if (result.result == ScanRpcStatus::OK) {
@@ -1299,10 +1328,12 @@ Status KuduScanner::NextBatch(KuduScanBatch* batch) {
           data_->last_primary_key_ = data_->last_response_.last_primary_key();
         }
         data_->scan_attempts_ = 0;
-        return batch->data_->Reset(&data_->controller_,
-                                   data_->configuration().projection(),
-                                   data_->configuration().client_projection(),
-                                   make_gscoped_ptr(data_->last_response_.release_data()));
+        RETURN_NOT_OK(batch->data_->Reset(&data_->controller_,
+                                          data_->configuration().projection(),
+                                          data_->configuration().client_projection(),
+                                          make_gscoped_ptr(data_->last_response_.release_data())));
+        data_->MaybePrefetchNextBatch();
+        return Status::OK();
       }
 
       data_->scan_attempts_++;
@@ -1450,6 +1481,11 @@ Status KuduScanTokenBuilder::SetTimeoutMillis(int millis) {
   return Status::OK();
 }
 
+Status KuduScanTokenBuilder::SetSplitSizeBytes(uint64_t split_size_bytes) {
+  data_->set_split_size_bytes(split_size_bytes);
+  return Status::OK();
+}
+
 Status KuduScanTokenBuilder::AddConjunctPredicate(KuduPredicate* pred) {
   return data_->mutable_configuration()->AddConjunctPredicate(pred);
 }
@@ -1929,6 +1929,24 @@ class KUDU_EXPORT KuduScanner {
   /// @return Operation result status.
   Status SetSnapshotRaw(uint64_t snapshot_timestamp) WARN_UNUSED_RESULT;
 
+  /// Set a bounded-staleness read from the closest replica.
+  ///
+  /// This forces the scan into @c READ_AT_SNAPSHOT mode with
+  /// @c KuduClient::CLOSEST_REPLICA selection, choosing the snapshot
+  /// timestamp at Open() time such that the returned rows are at most
+  /// @c staleness_micros old. This allows follower replicas to serve the
+  /// scan, offloading read traffic from leaders at the cost of possibly
+  /// stale results.
+  ///
+  /// @note This method is experimental and will either disappear or
+  ///   change in a future release.
+  ///
+  /// @param [in] staleness_micros
+  ///   Maximum staleness to tolerate, in microseconds. Must be greater
+  ///   than 0.
+  /// @return Operation result status.
+  Status SetReadYoungestWithinMicros(uint64_t staleness_micros) WARN_UNUSED_RESULT;
+
   /// Set the maximum time that Open() and NextBatch() are allowed to take.
   ///
   /// @param [in] millis
@@ -2042,6 +2060,17 @@ class KUDU_EXPORT KuduScanToken {
 
 /// @brief Builds scan tokens for a table.
 ///
+/// Scan tokens are the recommended way to scan many tablets in parallel:
+/// Build() emits one or more tokens per tablet, and each token can be
+/// turned into a KuduScanner (possibly in another process) and executed
+/// concurrently with the others.
+///
+/// In @c READ_AT_SNAPSHOT mode, all tokens produced by a single Build()
+/// call carry the same snapshot timestamp -- either the one set via
+/// SetSnapshotMicros()/SetSnapshotRaw(), or the client's latest observed
+/// timestamp -- so the per-tablet scans together observe one consistent
+/// snapshot of the table.
+///
 /// @note This class is not thread-safe.
 class KUDU_EXPORT KuduScanTokenBuilder {
  public:
@@ -2123,6 +2152,22 @@ class KUDU_EXPORT KuduScanTokenBuilder {
   /// @copydoc KuduScanner::SetTimeoutMillis
   Status SetTimeoutMillis(int millis) WARN_UNUSED_RESULT;
 
+  /// Set a split size for emitting multiple tokens per tablet.
+  ///
+  /// If set to a non-zero value, the builder asks each tablet's leader
+  /// replica to split its primary key space into ranges covering
+  /// approximately @c split_size_bytes of on-disk data each, and emits one
+  /// token per range, so that multiple readers can scan a single tablet in
+  /// parallel. The split points are estimates: tokens may cover
+  /// significantly more or less data than requested. If a tablet's server
+  /// does not support splitting, a single token is emitted for that tablet.
+  ///
+  /// @param [in] split_size_bytes
+  ///   The target amount of data for each token to scan. If zero (the
+  ///   default), one token is emitted per tablet.
+  /// @return Operation result status.
+  Status SetSplitSizeBytes(uint64_t split_size_bytes) WARN_UNUSED_RESULT;
+
   /// Build the set of scan tokens.
   ///
   /// The builder may be reused after this call.
@@ -63,6 +63,29 @@ namespace internal {
 
 namespace {
 const int MAX_RETURNED_TABLE_LOCATIONS = 10;
+
+// Interval between connection keep-alive pings to cached tablet servers.
+// This must be comfortably below the reactor's idle connection timeout
+// (--rpc_default_keepalive_time_ms, 65 seconds by default) so that warmed
+// connections are not torn down between pings.
+const int kConnectionKeepAlivePingIntervalMs = 30 * 1000;
+
+// Heap-allocated state for an async connection warm-up or keep-alive ping.
+// Deleted by the response callback.
+struct PingState {
+  tserver::PingRequestPB req;
+  tserver::PingResponsePB resp;
+  rpc::RpcController controller;
+};
+
+void PingRpcFinished(PingState* state, const string& uuid) {
+  if (!state->controller.status().ok()) {
+    VLOG(1) << "Keep-alive ping to TS " << uuid << " failed: "
+            << state->controller.status().ToString();
+  }
+  delete state;
+}
+
 } // anonymous namespace
 
 ////////////////////////////////////////////////////////////
@@ -126,6 +149,35 @@ void RemoteTabletServer::InitProxy(KuduClient* client, const StatusCallback& cb)
                     Unretained(this), hp, addrs, client, cb));
 }
 
+void RemoteTabletServer::WarmConnection(KuduClient* client) {
+  InitProxy(client, Bind(&RemoteTabletServer::WarmConnectionProxyReady,
+                         Unretained(this)));
+}
+
+void RemoteTabletServer::WarmConnectionProxyReady(const Status& status) {
+  if (!status.ok()) {
+    VLOG(1) << "Failed to warm connection to TS " << uuid_ << ": "
+            << status.ToString();
+    return;
+  }
+  SendConnectionKeepAlivePing();
+}
+
+void RemoteTabletServer::SendConnectionKeepAlivePing() {
+  shared_ptr<TabletServerServiceProxy> proxy;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    proxy = proxy_;
+  }
+  if (!proxy) {
+    return;
+  }
+  PingState* state = new PingState;
+  state->controller.set_timeout(MonoDelta::FromSeconds(10));
+  proxy->PingAsync(state->req, &state->resp, &state->controller,
+                   boost::bind(&PingRpcFinished, state, uuid_));
+}
+
 void RemoteTabletServer::Update(const master::TSInfoPB& pb) {
   CHECK_EQ(pb.permanent_uuid(), uuid_);
 
@@ -485,6 +537,8 @@ void MetaCacheServerPicker::InitProxyCb(const ServerPickedCallback& callback,
 
 MetaCache::MetaCache(KuduClient* client)
   : client_(client),
+    keepalive_pings_started_(false),
+    keepalive_pings_stopped_(false),
     master_lookup_sem_(50) {
 }
 
@@ -493,7 +547,9 @@ MetaCache::~MetaCache() {
 }
 
 void MetaCache::UpdateTabletServer(const TSInfoPB& pb) {
-  DCHECK(lock_.is_write_locked());
+  // A writer holds every per-CPU lock in write mode, so checking the current
+  // CPU's lock is a valid assertion regardless of thread migration.
+  DCHECK(lock_.get_lock().is_write_locked());
   RemoteTabletServer* ts = FindPtrOrNull(ts_cache_, pb.permanent_uuid());
   if (ts) {
     ts->Update(pb);
@@ -501,7 +557,56 @@ void MetaCache::UpdateTabletServer(const TSInfoPB& pb) {
   }
 
   VLOG(1) << "Client caching new TabletServer " << pb.permanent_uuid();
-  InsertOrDie(&ts_cache_, pb.permanent_uuid(), new RemoteTabletServer(pb));
+  ts = new RemoteTabletServer(pb);
+  InsertOrDie(&ts_cache_, pb.permanent_uuid(), ts);
+
+  // Warm the connection in the background so that the first operation routed
+  // to this server doesn't pay for DNS resolution, TCP connection
+  // establishment, and RPC negotiation.
+  ts->WarmConnection(client_);
+
+  if (!keepalive_pings_started_) {
+    keepalive_pings_started_ = true;
+    shared_ptr<Messenger> messenger = client_->data_->messenger_;
+    messenger->ScheduleOnReactor(
+        boost::bind(&MetaCache::ConnectionKeepAliveTask, _1,
+                    std::weak_ptr<Messenger>(messenger),
+                    scoped_refptr<MetaCache>(this)),
+        MonoDelta::FromMilliseconds(kConnectionKeepAlivePingIntervalMs));
+  }
+}
+
+void MetaCache::ConnectionKeepAliveTask(const Status& status,
+                                        std::weak_ptr<Messenger> messenger,
+                                        scoped_refptr<MetaCache> self) {
+  if (!status.ok()) {
+    // The reactor is shutting down.
+    return;
+  }
+  if (self->keepalive_pings_stopped_.Load()) {
+    // The owning client is being destroyed: don't re-schedule, so that the
+    // MetaCache reference held by this task is dropped.
+    return;
+  }
+
+  {
+    shared_lock<rw_spinlock> l(self->lock_.get_lock());
+    for (const auto& entry : self->ts_cache_) {
+      entry.second->SendConnectionKeepAlivePing();
+    }
+  }
+
+  shared_ptr<Messenger> m(messenger.lock());
+  if (PREDICT_TRUE(m)) {
+    m->ScheduleOnReactor(
+        boost::bind(&MetaCache::ConnectionKeepAliveTask, _1,
+                    std::move(messenger), std::move(self)),
+        MonoDelta::FromMilliseconds(kConnectionKeepAlivePingIntervalMs));
+  }
+}
+
+void MetaCache::StopConnectionKeepAlivePings() {
+  keepalive_pings_stopped_.Store(true);
 }
 
 // A (table, partition_key) --> tablet lookup. May be in-flight to a master, or
@@ -775,7 +880,7 @@ Status MetaCache::ProcessLookupResponse(const LookupRpc& rpc,
   MonoTime expiration_time = MonoTime::Now() +
       MonoDelta::FromMilliseconds(rpc.resp().ttl_millis());
 
-  std::lock_guard<rw_spinlock> l(lock_);
+  std::lock_guard<percpu_rwlock> l(lock_);
   TabletMap& tablets_by_key = LookupOrInsert(&tablets_by_table_and_key_,
                                              rpc.table_id(), TabletMap());
 
@@ -915,7 +1020,7 @@ Status MetaCache::ProcessLookupResponse(const LookupRpc& rpc,
 bool MetaCache::LookupTabletByKeyFastPath(const KuduTable* table,
                                           const string& partition_key,
                                           MetaCacheEntry* entry) {
-  shared_lock<rw_spinlock> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   const TabletMap* tablets = FindOrNull(tablets_by_table_and_key_, table->id());
   if (PREDICT_FALSE(!tablets)) {
     // No cache available for this table.
@@ -943,7 +1048,7 @@ bool MetaCache::LookupTabletByKeyFastPath(const KuduTable* table,
 
 void MetaCache::ClearCache() {
   VLOG(3) << "Clearing cache";
-  std::lock_guard<rw_spinlock> l(lock_);
+  std::lock_guard<percpu_rwlock> l(lock_);
   STLDeleteValues(&ts_cache_);
   tablets_by_id_.clear();
   tablets_by_table_and_key_.clear();
@@ -984,7 +1089,7 @@ void MetaCache::LookupTabletByKeyOrNext(const KuduTable* table,
 void MetaCache::MarkTSFailed(RemoteTabletServer* ts,
                              const Status& status) {
   LOG(INFO) << "Marking tablet server " << ts->ToString() << " as failed.";
-  shared_lock<rw_spinlock> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
 
   Status ts_status = status.CloneAndPrepend("TS failed");
 
@@ -33,6 +33,7 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/rpc/rpc.h"
 #include "kudu/util/async_util.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/monotime.h"
@@ -79,6 +80,18 @@ class RemoteTabletServer {
   // If there is an active proxy, does nothing.
   void InitProxy(KuduClient* client, const StatusCallback& cb);
 
+  // Asynchronously open a connection to this tablet server: initialize the
+  // proxy (which performs DNS resolution) and then issue a ping RPC, which
+  // drives the TCP connection and RPC negotiation. This makes the first
+  // "real" RPC to the server cheaper. Best-effort: if warming fails, the
+  // connection is established on first use as before.
+  void WarmConnection(KuduClient* client);
+
+  // Asynchronously ping this tablet server, re-opening the connection if the
+  // reactor has closed it as idle. Does nothing if InitProxy() has not yet
+  // completed.
+  void SendConnectionKeepAlivePing();
+
   // Update information from the given pb.
   // Requires that 'pb''s UUID matches this server.
   void Update(const master::TSInfoPB& pb);
@@ -102,6 +115,10 @@ class RemoteTabletServer {
                              const StatusCallback& user_callback,
                              const Status &result_status);
 
+  // Internal callback for WarmConnection(), invoked once the proxy has been
+  // initialized.
+  void WarmConnectionProxyReady(const Status& status);
+
   mutable simple_spinlock lock_;
   const std::string uuid_;
 
@@ -394,6 +411,11 @@ class MetaCache : public RefCountedThreadSafe<MetaCache> {
   bool AcquireMasterLookupPermit();
   void ReleaseMasterLookupPermit();
 
+  // Stop the periodic connection keep-alive pings, if they have been
+  // started. Must be called before the owning client is destroyed so that
+  // the reactor task drops its reference to this MetaCache.
+  void StopConnectionKeepAlivePings();
+
  private:
   friend class LookupRpc;
 
@@ -418,9 +440,23 @@ class MetaCache : public RefCountedThreadSafe<MetaCache> {
   // NOTE: Must be called with lock_ held.
   void UpdateTabletServer(const master::TSInfoPB& pb);
 
+  // Periodic task which pings every cached tablet server so that their
+  // connections stay established across idle periods. Re-schedules itself
+  // on 'messenger' until the messenger shuts down or 'self' has had its
+  // keep-alive pings stopped. 'self' keeps the MetaCache alive while the
+  // task is pending.
+  static void ConnectionKeepAliveTask(const Status& status,
+                                      std::weak_ptr<rpc::Messenger> messenger,
+                                      scoped_refptr<MetaCache> self);
+
   KuduClient* client_;
 
-  rw_spinlock lock_;
+  // Protects the caches below. This is a per-CPU reader-writer lock because
+  // the fast-path lookup takes it in shared mode on every operation routed by
+  // the client: with a plain rw_spinlock, all reader threads would contend on
+  // a single lock word. Write acquisitions (processing a master response,
+  // clearing the cache) are comparatively rare.
+  percpu_rwlock lock_;
 
   // Cache of Tablet Server locations: TS UUID -> RemoteTabletServer*.
   //
@@ -446,6 +482,16 @@ class MetaCache : public RefCountedThreadSafe<MetaCache> {
   // Protected by lock_
   std::unordered_map<std::string, scoped_refptr<RemoteTablet>> tablets_by_id_;
 
+  // Set once the connection keep-alive task has been scheduled, when the
+  // first tablet server is added to ts_cache_.
+  //
+  // Protected by lock_.
+  bool keepalive_pings_started_;
+
+  // Set when the owning client is being destroyed, telling the keep-alive
+  // task not to re-schedule itself.
+  AtomicBool keepalive_pings_stopped_;
+
   // Prevents master lookup "storms" by delaying master lookups when all
   // permits have been acquired.
   Semaphore master_lookup_sem_;
@@ -33,6 +33,7 @@ namespace kudu {
 namespace client {
 
 const uint64_t ScanConfiguration::kNoTimestamp = KuduClient::kNoTimestamp;
+const uint64_t ScanConfiguration::kNoStaleness = 0;
 const int ScanConfiguration::kHtTimestampBitsToShift = 12;
 
 ScanConfiguration::ScanConfiguration(KuduTable* table)
@@ -45,6 +46,7 @@ ScanConfiguration::ScanConfiguration(KuduTable* table)
       read_mode_(KuduScanner::READ_LATEST),
       is_fault_tolerant_(false),
       snapshot_timestamp_(kNoTimestamp),
+      max_staleness_micros_(kNoStaleness),
       timeout_(MonoDelta::FromMilliseconds(KuduScanner::kScanTimeoutMillis)),
       arena_(1024, 1024 * 1024) {
 }
@@ -172,6 +174,16 @@ void ScanConfiguration::SetSnapshotRaw(uint64_t snapshot_timestamp) {
   snapshot_timestamp_ = snapshot_timestamp;
 }
 
+Status ScanConfiguration::SetReadYoungestWithinMicros(uint64_t staleness_micros) {
+  if (staleness_micros == kNoStaleness) {
+    return Status::InvalidArgument("Staleness bound must be greater than zero");
+  }
+  RETURN_NOT_OK(SetReadMode(KuduScanner::READ_AT_SNAPSHOT));
+  RETURN_NOT_OK(SetSelection(KuduClient::CLOSEST_REPLICA));
+  max_staleness_micros_ = staleness_micros;
+  return Status::OK();
+}
+
 void ScanConfiguration::SetTimeoutMillis(int millis) {
   timeout_ = MonoDelta::FromMilliseconds(millis);
 }
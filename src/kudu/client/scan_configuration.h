@@ -73,6 +73,11 @@ class ScanConfiguration {
 
   void SetSnapshotRaw(uint64_t snapshot_timestamp);
 
+  // Set a bounded-staleness read: a READ_AT_SNAPSHOT scan from the closest
+  // replica, whose snapshot timestamp is chosen at open time to be at most
+  // 'staleness_micros' in the past. See KuduScanner::SetReadYoungestWithinMicros.
+  Status SetReadYoungestWithinMicros(uint64_t staleness_micros) WARN_UNUSED_RESULT;
+
   void SetTimeoutMillis(int millis);
 
   void OptimizeScanSpec();
@@ -129,6 +134,15 @@ class ScanConfiguration {
     return snapshot_timestamp_;
   }
 
+  bool has_max_staleness_micros() const {
+    return max_staleness_micros_ != kNoStaleness;
+  }
+
+  uint64_t max_staleness_micros() const {
+    CHECK(has_max_staleness_micros());
+    return max_staleness_micros_;
+  }
+
   const MonoDelta& timeout() const {
     return timeout_;
   }
@@ -141,6 +155,7 @@ class ScanConfiguration {
   friend class KuduScanTokenBuilder;
 
   static const uint64_t kNoTimestamp;
+  static const uint64_t kNoStaleness;
   static const int kHtTimestampBitsToShift;
 
   // Non-owned, non-null table.
@@ -165,6 +180,8 @@ class ScanConfiguration {
 
   uint64_t snapshot_timestamp_;
 
+  uint64_t max_staleness_micros_;
+
   MonoDelta timeout_;
 
   // Manages interior allocations for the scan spec and copied bounds.
@@ -18,6 +18,8 @@
 #include "kudu/client/scan_token-internal.h"
 
 #include <boost/optional.hpp>
+#include <glog/logging.h>
+#include <utility>
 #include <vector>
 #include <string>
 #include <memory>
@@ -32,9 +34,12 @@
 #include "kudu/common/wire_protocol.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/rpc/rpc_controller.h"
+#include "kudu/tserver/tserver_service.proxy.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/status.h"
 
+using std::pair;
 using std::string;
 using std::unique_ptr;
 using std::vector;
@@ -43,6 +48,61 @@ using strings::Substitute;
 namespace kudu {
 namespace client {
 
+namespace {
+
+// Ask the leader replica of 'tablet' to split the tablet's primary key space
+// into ranges of approximately 'split_size_bytes' of on-disk data each. The
+// returned pairs are (start, stop) encoded primary keys, where an empty key
+// means the range is unbounded on that side.
+Status SplitTabletKeyRange(KuduClient* client,
+                           internal::RemoteTablet* tablet,
+                           const vector<internal::RemoteReplica>& replicas,
+                           const string& lower_bound_primary_key,
+                           const string& upper_bound_primary_key,
+                           uint64_t split_size_bytes,
+                           const MonoTime& deadline,
+                           vector<pair<string, string>>* key_ranges) {
+  internal::RemoteTabletServer* leader = nullptr;
+  for (const auto& r : replicas) {
+    if (r.role == consensus::RaftPeerPB::LEADER && !r.failed) {
+      leader = r.ts;
+      break;
+    }
+  }
+  if (leader == nullptr) {
+    return Status::NotFound(Substitute("no leader replica to split tablet $0",
+                                       tablet->tablet_id()));
+  }
+
+  Synchronizer init_sync;
+  leader->InitProxy(client, init_sync.AsStatusCallback());
+  RETURN_NOT_OK(init_sync.Wait());
+
+  tserver::SplitKeyRangeRequestPB req;
+  req.set_tablet_id(tablet->tablet_id());
+  if (!lower_bound_primary_key.empty()) {
+    req.set_start_primary_key(lower_bound_primary_key);
+  }
+  if (!upper_bound_primary_key.empty()) {
+    req.set_stop_primary_key(upper_bound_primary_key);
+  }
+  req.set_target_chunk_size_bytes(split_size_bytes);
+
+  tserver::SplitKeyRangeResponsePB resp;
+  rpc::RpcController controller;
+  controller.set_deadline(deadline);
+  RETURN_NOT_OK(leader->proxy()->SplitKeyRange(req, &resp, &controller));
+  if (resp.has_error()) {
+    return StatusFromPB(resp.error().status());
+  }
+  for (const auto& range : resp.ranges()) {
+    key_ranges->emplace_back(range.start_primary_key(), range.stop_primary_key());
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+
 KuduScanToken::Data::Data(KuduTable* table,
                           ScanTokenPB message,
                           unique_ptr<KuduTablet> tablet)
@@ -162,7 +222,8 @@ Status KuduScanToken::Data::PBIntoScanner(KuduClient* client,
 }
 
 KuduScanTokenBuilder::Data::Data(KuduTable* table)
-    : configuration_(table) {
+    : configuration_(table),
+      split_size_bytes_(0) {
 }
 
 Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
@@ -208,6 +269,14 @@ Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
       pb.set_read_mode(kudu::READ_AT_SNAPSHOT);
       if (configuration_.has_snapshot_timestamp()) {
         pb.set_snap_timestamp(configuration_.snapshot_timestamp());
+      } else if (client->GetLatestObservedTimestamp() != KuduClient::kNoTimestamp) {
+        // No explicit snapshot was requested. If the tokens were left without
+        // a timestamp, each tablet server would assign its own at scan time,
+        // and the per-tablet scans would not observe one consistent
+        // cross-table snapshot. Stamp every token with the same timestamp
+        // so that the batch forms a single snapshot regardless of which
+        // servers execute the scans.
+        pb.set_snap_timestamp(client->GetLatestObservedTimestamp());
       }
       break;
     default:
@@ -252,46 +321,82 @@ Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
     vector<internal::RemoteReplica> replicas;
     tablet->GetRemoteReplicas(&replicas);
 
-    vector<const KuduReplica*> client_replicas;
-    ElementDeleter deleter(&client_replicas);
-
-    // Convert the replicas from their internal format to something appropriate
-    // for clients.
-    for (const auto& r : replicas) {
-      vector<HostPort> host_ports;
-      r.ts->GetHostPorts(&host_ports);
-      if (host_ports.empty()) {
-        return Status::IllegalState(Substitute(
-            "No host found for tablet server $0", r.ts->ToString()));
+    // Determine the primary key ranges for which to emit tokens. By default a
+    // single token covers the tablet's entire key space; if a split size was
+    // requested, ask the tablet's leader replica to split its key space by
+    // estimated on-disk size so that multiple readers can share the tablet.
+    vector<pair<string, string>> key_ranges;
+    if (split_size_bytes_ > 0) {
+      Status split_status = SplitTabletKeyRange(client, tablet.get(), replicas,
+                                                pb.lower_bound_primary_key(),
+                                                pb.upper_bound_primary_key(),
+                                                split_size_bytes_,
+                                                deadline,
+                                                &key_ranges);
+      if (!split_status.ok()) {
+        // The server may predate the SplitKeyRange RPC; emit a single token
+        // for the tablet rather than failing the build.
+        LOG(WARNING) << "Unable to split key range of tablet "
+                     << tablet->tablet_id() << ", emitting a single token: "
+                     << split_status.ToString();
+        key_ranges.clear();
       }
-      unique_ptr<KuduTabletServer> client_ts(new KuduTabletServer);
-      client_ts->data_ = new KuduTabletServer::Data(r.ts->permanent_uuid(),
-                                                    host_ports[0]);
-      bool is_leader = r.role == consensus::RaftPeerPB::LEADER;
-      unique_ptr<KuduReplica> client_replica(new KuduReplica);
-      client_replica->data_ = new KuduReplica::Data(is_leader,
-                                                    std::move(client_ts));
-      client_replicas.push_back(client_replica.release());
+    }
+    if (key_ranges.empty()) {
+      key_ranges.emplace_back(pb.lower_bound_primary_key(),
+                              pb.upper_bound_primary_key());
     }
 
-    unique_ptr<KuduTablet> client_tablet(new KuduTablet);
-    client_tablet->data_ = new KuduTablet::Data(tablet->tablet_id(),
-                                                std::move(client_replicas));
-    client_replicas.clear();
-
-    // Create the scan token itself.
-    ScanTokenPB message;
-    message.CopyFrom(pb);
-    message.set_lower_bound_partition_key(
-        tablet->partition().partition_key_start());
-    message.set_upper_bound_partition_key(
-        tablet->partition().partition_key_end());
-    unique_ptr<KuduScanToken> client_scan_token(new KuduScanToken);
-    client_scan_token->data_ =
-        new KuduScanToken::Data(table,
-                                std::move(message),
-                                std::move(client_tablet));
-    tokens->push_back(client_scan_token.release());
+    for (const auto& key_range : key_ranges) {
+      vector<const KuduReplica*> client_replicas;
+      ElementDeleter deleter(&client_replicas);
+
+      // Convert the replicas from their internal format to something appropriate
+      // for clients.
+      for (const auto& r : replicas) {
+        vector<HostPort> host_ports;
+        r.ts->GetHostPorts(&host_ports);
+        if (host_ports.empty()) {
+          return Status::IllegalState(Substitute(
+              "No host found for tablet server $0", r.ts->ToString()));
+        }
+        unique_ptr<KuduTabletServer> client_ts(new KuduTabletServer);
+        client_ts->data_ = new KuduTabletServer::Data(r.ts->permanent_uuid(),
+                                                      host_ports[0]);
+        bool is_leader = r.role == consensus::RaftPeerPB::LEADER;
+        unique_ptr<KuduReplica> client_replica(new KuduReplica);
+        client_replica->data_ = new KuduReplica::Data(is_leader,
+                                                      std::move(client_ts));
+        client_replicas.push_back(client_replica.release());
+      }
+
+      unique_ptr<KuduTablet> client_tablet(new KuduTablet);
+      client_tablet->data_ = new KuduTablet::Data(tablet->tablet_id(),
+                                                  std::move(client_replicas));
+      client_replicas.clear();
+
+      // Create the scan token itself. The split key ranges are subranges of
+      // any primary key bounds in the scan configuration, so setting them
+      // here only ever tightens the token's bounds.
+      ScanTokenPB message;
+      message.CopyFrom(pb);
+      if (!key_range.first.empty()) {
+        message.set_lower_bound_primary_key(key_range.first);
+      }
+      if (!key_range.second.empty()) {
+        message.set_upper_bound_primary_key(key_range.second);
+      }
+      message.set_lower_bound_partition_key(
+          tablet->partition().partition_key_start());
+      message.set_upper_bound_partition_key(
+          tablet->partition().partition_key_end());
+      unique_ptr<KuduScanToken> client_scan_token(new KuduScanToken);
+      client_scan_token->data_ =
+          new KuduScanToken::Data(table,
+                                  std::move(message),
+                                  std::move(client_tablet));
+      tokens->push_back(client_scan_token.release());
+    }
     pruner.RemovePartitionKeyRange(tablet->partition().partition_key_end());
   }
   return Status::OK();
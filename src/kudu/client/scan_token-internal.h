@@ -71,8 +71,17 @@ class KuduScanTokenBuilder::Data {
     return &configuration_;
   }
 
+  void set_split_size_bytes(uint64_t split_size_bytes) {
+    split_size_bytes_ = split_size_bytes;
+  }
+
  private:
   ScanConfiguration configuration_;
+
+  // If non-zero, the target amount of data for each emitted token, used to
+  // split large tablets into multiple tokens. See
+  // KuduScanTokenBuilder::SetSplitSizeBytes().
+  uint64_t split_size_bytes_;
 };
 
 } // namespace client
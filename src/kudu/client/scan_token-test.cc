@@ -400,6 +400,53 @@ TEST_F(ScanTokenTest, TestTimestampPropagation) {
       EXPECT_EQ(ts_propagated, pb.propagated_timestamp());
     }
   }
+
+  // In READ_AT_SNAPSHOT mode without an explicit snapshot timestamp, all
+  // tokens from a single Build() must carry the same snapshot timestamp so
+  // that the per-tablet scans observe one consistent snapshot.
+  {
+    ASSERT_OK(client_->OpenTable(kTableName, &table));
+    const uint64_t ts_observed = client_->GetLatestObservedTimestamp();
+    ASSERT_NE(KuduClient::kNoTimestamp, ts_observed);
+
+    vector<KuduScanToken*> tokens;
+    ElementDeleter deleter(&tokens);
+    KuduScanTokenBuilder builder(table.get());
+    ASSERT_OK(builder.SetReadMode(KuduScanner::READ_AT_SNAPSHOT));
+    ASSERT_OK(builder.Build(&tokens));
+    ASSERT_GT(tokens.size(), 1);
+    for (const auto* t : tokens) {
+      string serialized_token;
+      ASSERT_OK(t->Serialize(&serialized_token));
+
+      ScanTokenPB pb;
+      ASSERT_TRUE(pb.ParseFromString(serialized_token));
+      ASSERT_TRUE(pb.has_snap_timestamp());
+      EXPECT_EQ(ts_observed, pb.snap_timestamp());
+    }
+  }
+
+  // An explicitly set snapshot timestamp takes precedence over the client's
+  // latest observed timestamp.
+  {
+    const uint64_t ts_explicit = client_->GetLatestObservedTimestamp() + 1000;
+
+    vector<KuduScanToken*> tokens;
+    ElementDeleter deleter(&tokens);
+    KuduScanTokenBuilder builder(table.get());
+    ASSERT_OK(builder.SetReadMode(KuduScanner::READ_AT_SNAPSHOT));
+    ASSERT_OK(builder.SetSnapshotRaw(ts_explicit));
+    ASSERT_OK(builder.Build(&tokens));
+    for (const auto* t : tokens) {
+      string serialized_token;
+      ASSERT_OK(t->Serialize(&serialized_token));
+
+      ScanTokenPB pb;
+      ASSERT_TRUE(pb.ParseFromString(serialized_token));
+      ASSERT_TRUE(pb.has_snap_timestamp());
+      EXPECT_EQ(ts_explicit, pb.snap_timestamp());
+    }
+  }
 }
 
 } // namespace client
@@ -30,6 +30,7 @@
 #include "kudu/common/common.pb.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/walltime.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/util/hexdump.h"
 
@@ -56,11 +57,16 @@ KuduScanner::Data::Data(KuduTable* table)
     open_(false),
     data_in_open_(false),
     short_circuit_(false),
+    prefetch_in_flight_(false),
+    prefetch_latch_(0),
     table_(DCHECK_NOTNULL(table)->shared_from_this()),
     scan_attempts_(0) {
 }
 
 KuduScanner::Data::~Data() {
+  // KuduScanner::Close() should have waited for any in-flight prefetch, but
+  // make sure regardless: the RPC layer writes into our members.
+  DiscardPrefetchedBatch();
 }
 
 Status KuduScanner::Data::HandleError(const ScanRpcStatus& err,
@@ -270,6 +276,14 @@ Status KuduScanner::Data::OpenTablet(const string& partition_key,
       break;
     case KuduScanner::READ_AT_SNAPSHOT:
       scan->set_read_mode(kudu::READ_AT_SNAPSHOT);
+      if (!configuration_.has_snapshot_timestamp() &&
+          configuration_.has_max_staleness_micros()) {
+        // Bounded-staleness scan: pick the snapshot timestamp now, at the
+        // maximum tolerated staleness behind the client's clock. Once set, the
+        // same snapshot is reused for all tablets in the scan.
+        configuration_.SetSnapshotMicros(
+            GetCurrentTimeMicros() - configuration_.max_staleness_micros());
+      }
       if (configuration_.has_snapshot_timestamp()) {
         scan->set_snap_timestamp(configuration_.snapshot_timestamp());
       }
@@ -431,6 +445,48 @@ Status KuduScanner::Data::OpenTablet(const string& partition_key,
   return Status::OK();
 }
 
+void KuduScanner::Data::MaybePrefetchNextBatch() {
+  if (!last_response_.has_more_results()) {
+    return;
+  }
+  DCHECK(!prefetch_in_flight_);
+  PrepareRequest(KuduScanner::Data::CONTINUE);
+  prefetch_deadline_ = MonoTime::Now() + configuration_.timeout();
+  prefetch_controller_.Reset();
+  prefetch_controller_.set_deadline(prefetch_deadline_);
+  if (!configuration_.spec().predicates().empty()) {
+    prefetch_controller_.RequireServerFeature(TabletServerFeatures::COLUMN_PREDICATES);
+  }
+  prefetch_latch_.Reset(1);
+  prefetch_in_flight_ = true;
+  proxy_->ScanAsync(next_req_, &prefetch_response_, &prefetch_controller_,
+                    boost::bind(&CountDownLatch::CountDown, &prefetch_latch_));
+}
+
+ScanRpcStatus KuduScanner::Data::WaitForPrefetchedBatch() {
+  DCHECK(prefetch_in_flight_);
+  prefetch_latch_.Wait();
+  prefetch_in_flight_ = false;
+  last_response_.Swap(&prefetch_response_);
+  controller_.Swap(&prefetch_controller_);
+  ScanRpcStatus scan_status = AnalyzeResponse(
+      controller_.status(), prefetch_deadline_, prefetch_deadline_);
+  if (scan_status.result == ScanRpcStatus::OK) {
+    UpdateResourceMetrics();
+  }
+  return scan_status;
+}
+
+void KuduScanner::Data::DiscardPrefetchedBatch() {
+  if (!prefetch_in_flight_) {
+    return;
+  }
+  prefetch_latch_.Wait();
+  prefetch_in_flight_ = false;
+  prefetch_response_.Clear();
+  prefetch_controller_.Reset();
+}
+
 Status KuduScanner::Data::KeepAlive() {
   if (!open_) return Status::IllegalState("Scanner was not open.");
   // If there is no scanner to keep alive, we still return Status::OK().
@@ -462,6 +518,13 @@ void KuduScanner::Data::PrepareRequest(RequestType state) {
     next_req_.set_batch_size_bytes(0);
   } else if (configuration_.has_batch_size_bytes()) {
     next_req_.set_batch_size_bytes(configuration_.batch_size_bytes());
+  } else if (state == KuduScanner::Data::CONTINUE &&
+             last_response_.has_batch_size_bytes_hint()) {
+    // The server cut the previous batch short because it hit its per-batch
+    // time budget. Size the next request to what the server was able to
+    // produce within the budget, rather than asking for the server default
+    // again and timing out at the same point.
+    next_req_.set_batch_size_bytes(last_response_.batch_size_bytes_hint());
   } else {
     next_req_.clear_batch_size_bytes();
   }
@@ -30,6 +30,7 @@
 #include "kudu/gutil/macros.h"
 #include "kudu/tserver/tserver_service.proxy.h"
 #include "kudu/util/auto_release_pool.h"
+#include "kudu/util/countdown_latch.h"
 
 namespace kudu {
 
@@ -123,6 +124,28 @@ class KuduScanner::Data {
 
   Status KeepAlive();
 
+  // If the last response indicated that more results are available in the
+  // current tablet, issues an asynchronous Scan RPC for the next batch. The
+  // response accumulates in 'prefetch_response_'/'prefetch_controller_' while
+  // the application processes the batch in hand, overlapping the server-side
+  // iteration and network round trip with client-side processing.
+  //
+  // At most one batch is prefetched at a time, so the additional buffered
+  // memory is bounded by the configured batch size.
+  void MaybePrefetchNextBatch();
+
+  // Waits for the outstanding prefetched Scan RPC to complete and moves its
+  // response into 'last_response_'/'controller_'. Returns the analyzed result
+  // of the RPC, exactly as SendScanRpc() would have.
+  //
+  // Requires that a prefetch is in flight.
+  ScanRpcStatus WaitForPrefetchedBatch();
+
+  // Waits for any outstanding prefetched Scan RPC and discards its response.
+  // Must be called before tearing down the scanner, since the RPC layer
+  // writes the response into members of this object.
+  void DiscardPrefetchedBatch();
+
   // Returns whether there may exist more tablets to scan.
   //
   // This method does not take into account any non-covered range partitions
@@ -189,6 +212,16 @@ class KuduScanner::Data {
   // RPC controller for the last in-flight RPC.
   rpc::RpcController controller_;
 
+  // State for the prefetched (double-buffered) continuation RPC, if any.
+  // While 'prefetch_in_flight_' is true, the RPC reactor thread may be
+  // writing to 'prefetch_response_' and 'prefetch_controller_', so they must
+  // not be touched until 'prefetch_latch_' has been waited on.
+  bool prefetch_in_flight_;
+  tserver::ScanResponsePB prefetch_response_;
+  rpc::RpcController prefetch_controller_;
+  MonoTime prefetch_deadline_;
+  CountDownLatch prefetch_latch_;
+
   // The table we're scanning.
   sp::shared_ptr<KuduTable> table_;
 
@@ -38,7 +38,8 @@ class ColumnMaterializationContext {
       pred_(pred),
       block_(block),
       sel_(sel),
-      decoder_eval_status_(kNotSet) {
+      decoder_eval_status_(kNotSet),
+      allow_skip_unselected_(false) {
       if (!pred_ || !sel || !block) {
         decoder_eval_status_ = kDecoderEvalNotSupported;
       }
@@ -104,6 +105,19 @@ class ColumnMaterializationContext {
     decoder_eval_status_ = kDecoderEvalNotSupported;
   }
 
+  // May be set by the caller to indicate that the selection vector is final:
+  // rows whose bits are already cleared will never be read, so the column
+  // iterator is free to leave their cells unmaterialized. Only valid for
+  // contexts without a predicate.
+  void SetAllowSkipUnselected() {
+    DCHECK(pred_ == nullptr);
+    allow_skip_unselected_ = true;
+  }
+
+  bool AllowSkipUnselected() const {
+    return allow_skip_unselected_;
+  }
+
  private:
   enum DecoderEvalStatus {
     // During scan, will try to evaluate with the decoder, after which the
@@ -132,6 +146,8 @@ class ColumnMaterializationContext {
   SelectionVector* const sel_;
 
   DecoderEvalStatus decoder_eval_status_;
+
+  bool allow_skip_unselected_;
 };
 
 } // namespace kudu
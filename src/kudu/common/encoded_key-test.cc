@@ -19,6 +19,8 @@
 
 #include <gtest/gtest.h>
 
+#include "kudu/common/row.h"
+#include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/stopwatch.h"
@@ -242,6 +244,36 @@ TEST_F(EncodedKeyTest, TestConstructFromEncodedString) {
   }
 }
 
+// Test that batch encoding produces the same keys as encoding each
+// row individually.
+TEST_F(EncodedKeyTest, TestBatchFromContiguousRows) {
+  Schema schema({ ColumnSchema("key0", UINT32),
+                  ColumnSchema("key1", UINT32) }, 2);
+  struct RowData {
+    uint32_t key0;
+    uint32_t key1;
+  };
+  RowData rows_data[] = { { 0, 0 },
+                          { 1, 2 },
+                          { 123456, 7 },
+                          { 0xffffffff, 0xffffffff } };
+
+  vector<ConstContiguousRow> rows;
+  for (const RowData& rd : rows_data) {
+    rows.push_back(ConstContiguousRow(&schema,
+                                      reinterpret_cast<const uint8_t*>(&rd)));
+  }
+
+  vector<EncodedKey*> keys;
+  ElementDeleter deleter(&keys);
+  EncodedKey::BatchFromContiguousRows(schema, rows, &keys);
+  ASSERT_EQ(rows.size(), keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    gscoped_ptr<EncodedKey> expected = EncodedKey::FromContiguousRow(rows[i]);
+    EXPECT_EQ(expected->encoded_key(), keys[i]->encoded_key());
+  }
+}
+
 // Test encoding random strings and ensure that the decoded string
 // matches the input.
 TEST_F(EncodedKeyTest, TestRandomStringEncoding) {
@@ -50,6 +50,39 @@ gscoped_ptr<EncodedKey> EncodedKey::FromContiguousRow(const ConstContiguousRow&
 
 }
 
+void EncodedKey::BatchFromContiguousRows(const Schema& schema,
+                                         const vector<ConstContiguousRow>& rows,
+                                         vector<EncodedKey*>* keys) {
+  const int num_key_cols = schema.num_key_columns();
+
+  // Resolve the encoder for each key column up front: the type dispatch is
+  // then paid once per column instead of once per cell.
+  vector<const KeyEncoder<faststring>*> encoders;
+  encoders.reserve(num_key_cols);
+  for (int i = 0; i < num_key_cols; i++) {
+    DCHECK(!schema.column(i).is_nullable());
+    encoders.push_back(&GetKeyEncoder<faststring>(schema.column(i).type_info()));
+  }
+
+  keys->reserve(keys->size() + rows.size());
+  faststring buf(schema.key_byte_size());
+  vector<const void*> raw_keys;
+  for (const ConstContiguousRow& row : rows) {
+    DCHECK_EQ(num_key_cols, row.schema()->num_key_columns());
+    buf.reserve(schema.key_byte_size());
+    raw_keys.clear();
+    raw_keys.reserve(num_key_cols);
+    for (int i = 0; i < num_key_cols; i++) {
+      const void* cell = row.cell_ptr(i);
+      encoders[i]->Encode(cell, i == num_key_cols - 1, &buf);
+      raw_keys.push_back(cell);
+    }
+    // The EncodedKey takes over 'buf's data and 'raw_keys's contents,
+    // leaving them empty for the next iteration.
+    keys->push_back(new EncodedKey(&buf, &raw_keys, num_key_cols));
+  }
+}
+
 Status EncodedKey::DecodeEncodedString(const Schema& schema,
                                        Arena* arena,
                                        const Slice& encoded,
@@ -41,6 +41,17 @@ class EncodedKey {
 
   static gscoped_ptr<EncodedKey> FromContiguousRow(const ConstContiguousRow& row);
 
+  // Encode the key columns of every row in 'rows', appending the resulting
+  // keys to 'keys'. All of the rows must use 'schema'. The caller takes
+  // ownership of the appended keys.
+  //
+  // This is equivalent to calling FromContiguousRow() on each row, but
+  // resolves the encoder for each key column once rather than once per cell,
+  // which is significantly cheaper for large batches.
+  static void BatchFromContiguousRows(const Schema& schema,
+                                      const std::vector<ConstContiguousRow>& rows,
+                                      std::vector<EncodedKey*>* keys);
+
   // Decode the encoded key specified in 'encoded', which must correspond to the
   // provided schema.
   // The returned row data is allocated from 'arena' and returned in '*result'.
@@ -25,9 +25,11 @@
 #include "kudu/common/generic_iterators.h"
 #include "kudu/common/column_materialization_context.h"
 #include "kudu/common/rowblock.h"
+#include "kudu/common/scan_deadline.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
 #include "kudu/gutil/casts.h"
+#include "kudu/gutil/hash/city.h"
 #include "kudu/gutil/mathlimits.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
@@ -50,7 +52,9 @@ class VectorIterator : public ColumnwiseIterator {
   explicit VectorIterator(vector<uint32_t> ints)
       : ints_(std::move(ints)),
         cur_idx_(0),
-        block_size_(ints_.size()) {
+        block_size_(ints_.size()),
+        select_no_rows_(false),
+        num_columns_materialized_(0) {
   }
 
   // Set the number of rows that will be returned in each
@@ -72,12 +76,28 @@ class VectorIterator : public ColumnwiseIterator {
     return Status::OK();
   }
 
+  // Make InitializeSelectionVector() deselect every row, as if all of the
+  // rows in the block had been deleted.
+  void set_select_no_rows(bool value) {
+    select_no_rows_ = value;
+  }
+
+  // The number of calls to MaterializeColumn() so far.
+  int num_columns_materialized() const {
+    return num_columns_materialized_;
+  }
+
   virtual Status InitializeSelectionVector(SelectionVector *sel_vec) OVERRIDE {
-    sel_vec->SetAllTrue();
+    if (select_no_rows_) {
+      sel_vec->SetAllFalse();
+    } else {
+      sel_vec->SetAllTrue();
+    }
     return Status::OK();
   }
 
   Status MaterializeColumn(ColumnMaterializationContext* ctx) override {
+    num_columns_materialized_++;
     ctx->SetDecoderEvalNotSupported();
     CHECK_EQ(UINT32, ctx->block()->type_info()->physical_type());
     DCHECK_LE(prepared_, ctx->block()->nrows());
@@ -114,6 +134,8 @@ class VectorIterator : public ColumnwiseIterator {
   vector<uint32_t> ints_;
   int cur_idx_;
   int block_size_;
+  bool select_no_rows_;
+  int num_columns_materialized_;
   size_t prepared_;
 };
 
@@ -144,7 +166,8 @@ class TestIntRangePredicate {
   ColumnPredicate pred_;
 };
 
-void TestMerge(const TestIntRangePredicate &predicate) {
+void TestMerge(const TestIntRangePredicate &predicate,
+               bool overlapping_ranges = true) {
   vector<shared_ptr<RowwiseIterator>> to_merge;
   vector<uint32_t> ints;
   vector<uint32_t> expected;
@@ -159,7 +182,9 @@ void TestMerge(const TestIntRangePredicate &predicate) {
     ints.clear();
     ints.reserve(FLAGS_num_rows);
 
-    uint32_t entry = 0;
+    // With non-overlapping ranges, each list gets its own disjoint key space,
+    // which exercises the MergeIterator's whole-block run optimization.
+    uint32_t entry = overlapping_ranges ? 0 : i * FLAGS_num_rows * 5;
     for (int j = 0; j < FLAGS_num_rows; j++) {
       entry += rand() % 5;
       ints.push_back(entry);
@@ -214,6 +239,11 @@ TEST(TestMergeIterator, TestMerge) {
   TestMerge(predicate);
 }
 
+TEST(TestMergeIterator, TestMergeNonOverlapping) {
+  TestIntRangePredicate predicate(0, MathLimits<uint32_t>::kMax);
+  TestMerge(predicate, /* overlapping_ranges=*/false);
+}
+
 TEST(TestMergeIterator, TestMergePredicate) {
   TestIntRangePredicate predicate(0, FLAGS_num_rows / 5);
   TestMerge(predicate);
@@ -259,6 +289,80 @@ TEST(TestMaterializingIterator, TestMaterializingPredicatePushdown) {
   ASSERT_FALSE(dst.selection_vector()->IsRowSelected(30));
 }
 
+// Test that when the underlying iterator deselects an entire block up front
+// (e.g. because all of its rows were deleted), the materializing iterator
+// doesn't decode any column data for the block.
+TEST(TestMaterializingIterator, TestMaterializingSkipsFullyDeselectedBlocks) {
+  vector<uint32> ints(100, 0);
+  shared_ptr<VectorIterator> colwise(new VectorIterator(ints));
+  colwise->set_select_no_rows(true);
+
+  MaterializingIterator materializing(colwise);
+  ScanSpec spec;
+  ASSERT_OK(materializing.Init(&spec));
+
+  Arena arena(1024, 1024);
+  RowBlock dst(kIntSchema, 100, &arena);
+  ASSERT_OK(materializing.NextBlock(&dst));
+  ASSERT_EQ(dst.nrows(), 100);
+  ASSERT_EQ(0, dst.selection_vector()->CountSelected());
+  ASSERT_EQ(0, colwise->num_columns_materialized());
+}
+
+// Test that an expired ScopedScanDeadline installed on the scanning thread
+// aborts materialization with TimedOut before any column data is decoded,
+// and that scans with no installed deadline are unaffected.
+TEST(TestMaterializingIterator, TestScanDeadlineAbortsMaterialization) {
+  vector<uint32> ints(100, 0);
+  shared_ptr<VectorIterator> colwise(new VectorIterator(ints));
+  MaterializingIterator materializing(colwise);
+  ScanSpec spec;
+  ASSERT_OK(materializing.Init(&spec));
+
+  Arena arena(1024, 1024);
+  RowBlock dst(kIntSchema, 100, &arena);
+  {
+    ScopedScanDeadline deadline(MonoTime::Now() - MonoDelta::FromSeconds(1));
+    Status s = materializing.NextBlock(&dst);
+    ASSERT_TRUE(s.IsTimedOut()) << s.ToString();
+    ASSERT_EQ(0, colwise->num_columns_materialized());
+  }
+
+  // Once the scope is gone, the same iterator scans normally.
+  ASSERT_OK(materializing.NextBlock(&dst));
+  ASSERT_EQ(100, dst.nrows());
+  ASSERT_EQ(1, colwise->num_columns_materialized());
+}
+
+// As above, but for the per-block check in MergeIterator.
+TEST(TestMergeIterator, TestScanDeadlineAbortsMerge) {
+  vector<uint32_t> ints;
+  for (int i = 0; i < 100; i++) {
+    ints.push_back(i);
+  }
+  shared_ptr<RowwiseIterator> iter(
+    new MaterializingIterator(
+      shared_ptr<ColumnwiseIterator>(new VectorIterator(ints))));
+
+  vector<shared_ptr<RowwiseIterator>> to_merge;
+  to_merge.push_back(iter);
+
+  MergeIterator merger(kIntSchema, to_merge);
+  ASSERT_OK(merger.Init(nullptr));
+  ASSERT_TRUE(merger.HasNext());
+
+  Arena arena(1024, 1024);
+  RowBlock dst(kIntSchema, 100, &arena);
+  {
+    ScopedScanDeadline deadline(MonoTime::Now() - MonoDelta::FromSeconds(1));
+    Status s = merger.NextBlock(&dst);
+    ASSERT_TRUE(s.IsTimedOut()) << s.ToString();
+  }
+
+  ASSERT_OK(merger.NextBlock(&dst));
+  ASSERT_EQ(100, dst.nrows());
+}
+
 // Test that PredicateEvaluatingIterator will properly evaluate predicates on its
 // input.
 TEST(TestPredicateEvaluatingIterator, TestPredicateEvaluation) {
@@ -320,4 +424,182 @@ TEST(TestPredicateEvaluatingIterator, TestDontWrapWhenNoPredicates) {
   ASSERT_EQ(outer_iter, materializing) << "InitAndMaybeWrap should not have wrapped iter";
 }
 
+// Build the standard set of aggregates (COUNT, MIN, MAX, SUM over 'val')
+// along with their result schema.
+static void BuildTestAggregates(vector<AggregateIterator::AggregateOp>* ops,
+                                Schema* result_schema) {
+  ops->push_back({ AggregateIterator::COUNT, -1 });
+  ops->push_back({ AggregateIterator::MIN, 0 });
+  ops->push_back({ AggregateIterator::MAX, 0 });
+  ops->push_back({ AggregateIterator::SUM, 0 });
+  ASSERT_OK(AggregateIterator::ValidateOps(kIntSchema, *ops, result_schema));
+}
+
+// Test that AggregateIterator computes COUNT/MIN/MAX/SUM over its entire
+// input and yields a single result row.
+TEST(TestAggregateIterator, TestAggregation) {
+  vector<uint32> ints;
+  for (int i = 0; i < 100; i++) {
+    ints.push_back(i);
+  }
+  shared_ptr<RowwiseIterator> base(
+      new MaterializingIterator(
+          shared_ptr<ColumnwiseIterator>(new VectorIterator(ints))));
+  ScanSpec spec;
+  ASSERT_OK(base->Init(&spec));
+
+  vector<AggregateIterator::AggregateOp> ops;
+  Schema result_schema;
+  NO_FATALS(BuildTestAggregates(&ops, &result_schema));
+  ASSERT_EQ(4, result_schema.num_columns());
+  ASSERT_EQ(INT64, result_schema.column(0).type_info()->type());
+  ASSERT_EQ(UINT32, result_schema.column(1).type_info()->type());
+
+  AggregateIterator agg(std::move(base), std::move(ops), result_schema);
+  ASSERT_OK(agg.Init(nullptr));
+  ASSERT_TRUE(agg.HasNext());
+
+  Arena arena(1024, 1024);
+  RowBlock dst(result_schema, 1, &arena);
+  ASSERT_OK(agg.NextBlock(&dst));
+  ASSERT_EQ(1, dst.nrows());
+  ASSERT_EQ(1, dst.selection_vector()->CountSelected());
+  ASSERT_FALSE(agg.HasNext());
+
+  ASSERT_EQ(100, *reinterpret_cast<const int64_t*>(dst.column_block(0).cell_ptr(0)));
+  ASSERT_FALSE(dst.column_block(1).is_null(0));
+  ASSERT_EQ(0, *reinterpret_cast<const uint32_t*>(dst.column_block(1).cell_ptr(0)));
+  ASSERT_EQ(99, *reinterpret_cast<const uint32_t*>(dst.column_block(2).cell_ptr(0)));
+  ASSERT_EQ(4950, *reinterpret_cast<const int64_t*>(dst.column_block(3).cell_ptr(0)));
+}
+
+// Test that rows deselected by a predicate below the aggregation don't
+// contribute to the aggregates.
+TEST(TestAggregateIterator, TestAggregationSkipsFilteredRows) {
+  ScanSpec spec;
+  TestIntRangePredicate pred1(20, 30);
+  spec.AddPredicate(pred1.pred_);
+
+  vector<uint32> ints;
+  for (int i = 0; i < 100; i++) {
+    ints.push_back(i);
+  }
+  // Disallow pushdown so that the rows arrive at the aggregation with a
+  // partially-deselected selection vector.
+  shared_ptr<VectorIterator> colwise(new VectorIterator(ints));
+  MaterializingIterator* materializing = new MaterializingIterator(colwise);
+  materializing->disallow_pushdown_for_tests_ = true;
+  shared_ptr<RowwiseIterator> base(materializing);
+  ASSERT_OK(PredicateEvaluatingIterator::InitAndMaybeWrap(&base, &spec));
+
+  vector<AggregateIterator::AggregateOp> ops;
+  Schema result_schema;
+  NO_FATALS(BuildTestAggregates(&ops, &result_schema));
+
+  AggregateIterator agg(std::move(base), std::move(ops), result_schema);
+  ASSERT_OK(agg.Init(nullptr));
+
+  Arena arena(1024, 1024);
+  RowBlock dst(result_schema, 1, &arena);
+  ASSERT_OK(agg.NextBlock(&dst));
+  ASSERT_EQ(10, *reinterpret_cast<const int64_t*>(dst.column_block(0).cell_ptr(0)));
+  ASSERT_EQ(20, *reinterpret_cast<const uint32_t*>(dst.column_block(1).cell_ptr(0)));
+  ASSERT_EQ(29, *reinterpret_cast<const uint32_t*>(dst.column_block(2).cell_ptr(0)));
+  ASSERT_EQ(245, *reinterpret_cast<const int64_t*>(dst.column_block(3).cell_ptr(0)));
+}
+
+// Test that aggregating an empty input yields COUNT=0 and NULL for the
+// other aggregates.
+TEST(TestAggregateIterator, TestAggregateEmpty) {
+  vector<uint32> empty_vec;
+  shared_ptr<RowwiseIterator> base(
+      new MaterializingIterator(
+          shared_ptr<ColumnwiseIterator>(new VectorIterator(empty_vec))));
+  ScanSpec spec;
+  ASSERT_OK(base->Init(&spec));
+
+  vector<AggregateIterator::AggregateOp> ops;
+  Schema result_schema;
+  NO_FATALS(BuildTestAggregates(&ops, &result_schema));
+
+  AggregateIterator agg(std::move(base), std::move(ops), result_schema);
+  ASSERT_OK(agg.Init(nullptr));
+  // Even with no input rows, the aggregation produces one result row.
+  ASSERT_TRUE(agg.HasNext());
+
+  Arena arena(1024, 1024);
+  RowBlock dst(result_schema, 1, &arena);
+  ASSERT_OK(agg.NextBlock(&dst));
+  ASSERT_EQ(1, dst.nrows());
+  ASSERT_FALSE(agg.HasNext());
+
+  ASSERT_EQ(0, *reinterpret_cast<const int64_t*>(dst.column_block(0).cell_ptr(0)));
+  ASSERT_TRUE(dst.column_block(1).is_null(0));
+  ASSERT_TRUE(dst.column_block(2).is_null(0));
+  ASSERT_TRUE(dst.column_block(3).is_null(0));
+}
+
+// Test that ComputedColumnsIterator passes the base columns through and
+// appends the computed columns (here CAST and HASH over 'val').
+TEST(TestComputedColumnsIterator, TestComputeOverInts) {
+  vector<uint32> ints;
+  for (int i = 0; i < 100; i++) {
+    ints.push_back(i * 7);
+  }
+  shared_ptr<RowwiseIterator> base(
+      new MaterializingIterator(
+          shared_ptr<ColumnwiseIterator>(new VectorIterator(ints))));
+  ScanSpec spec;
+  ASSERT_OK(base->Init(&spec));
+
+  vector<ComputedColumnsIterator::ComputedOp> ops;
+  ops.push_back({ ComputedColumnsIterator::CAST, 0, 0, 0, INT64 });
+  ops.push_back({ ComputedColumnsIterator::HASH, 0, 0, 0, UINT8 });
+  Schema result_schema;
+  ASSERT_OK(ComputedColumnsIterator::ValidateOps(kIntSchema, ops, &result_schema));
+  ASSERT_EQ(3, result_schema.num_columns());
+  ASSERT_EQ("cast(val as int64)", result_schema.column(1).name());
+  ASSERT_EQ(INT64, result_schema.column(1).type_info()->type());
+  ASSERT_EQ("hash(val)", result_schema.column(2).name());
+  ASSERT_EQ(INT64, result_schema.column(2).type_info()->type());
+
+  ComputedColumnsIterator computed(std::move(base), std::move(ops), result_schema);
+  ASSERT_OK(computed.Init(nullptr));
+
+  Arena arena(1024, 1024);
+  RowBlock dst(result_schema, 100, &arena);
+  ASSERT_OK(computed.NextBlock(&dst));
+  ASSERT_EQ(100, dst.nrows());
+  ASSERT_FALSE(computed.HasNext());
+
+  for (int i = 0; i < 100; i++) {
+    uint32_t v = i * 7;
+    ASSERT_EQ(v, *reinterpret_cast<const uint32_t*>(dst.column_block(0).cell_ptr(i)));
+    ASSERT_EQ(v, *reinterpret_cast<const int64_t*>(dst.column_block(1).cell_ptr(i)));
+    int64_t expected_hash = static_cast<int64_t>(
+        util_hash::CityHash64(reinterpret_cast<const char*>(&v), sizeof(v)));
+    ASSERT_EQ(expected_hash,
+              *reinterpret_cast<const int64_t*>(dst.column_block(2).cell_ptr(i)));
+  }
+}
+
+// Test that ValidateOps() rejects functions which don't apply to the source
+// type as well as duplicate computed columns.
+TEST(TestComputedColumnsIterator, TestValidateRejectsBadOps) {
+  Schema result_schema;
+
+  // SUBSTRING doesn't apply to an integer column.
+  vector<ComputedColumnsIterator::ComputedOp> ops;
+  ops.push_back({ ComputedColumnsIterator::SUBSTRING, 0, 0, 4, UINT8 });
+  Status s = ComputedColumnsIterator::ValidateOps(kIntSchema, ops, &result_schema);
+  ASSERT_TRUE(s.IsNotSupported()) << s.ToString();
+
+  // A repeated computed column would produce a duplicate result name.
+  ops.clear();
+  ops.push_back({ ComputedColumnsIterator::HASH, 0, 0, 0, UINT8 });
+  ops.push_back({ ComputedColumnsIterator::HASH, 0, 0, 0, UINT8 });
+  s = ComputedColumnsIterator::ValidateOps(kIntSchema, ops, &result_schema);
+  ASSERT_FALSE(s.ok());
+}
+
 } // namespace kudu
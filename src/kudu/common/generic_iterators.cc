@@ -26,8 +26,11 @@
 #include "kudu/common/generic_iterators.h"
 #include "kudu/common/row.h"
 #include "kudu/common/rowblock.h"
+#include "kudu/common/scan_deadline.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/hash/city.h"
 #include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/ascii_ctype.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/memory/arena.h"
@@ -78,6 +81,15 @@ class MergeIterState {
     return next_row_;
   }
 
+  // The last selected row in the current block. Useful for detecting runs:
+  // if this row sorts before the next row of every other sub-iterator, the
+  // entire remainder of the current block can be yielded without any further
+  // comparisons.
+  const RowBlockRow& last_row() {
+    DCHECK_LT(num_advanced_, num_valid_);
+    return last_row_;
+  }
+
   Status Advance() {
     num_advanced_++;
     if (IsBlockExhausted()) {
@@ -122,6 +134,13 @@ class MergeIterState {
       for (next_row_idx_ = 0; next_row_idx_ < read_block_.nrows(); next_row_idx_++) {
         if (selection->IsRowSelected(next_row_idx_)) {
           next_row_.Reset(&read_block_, next_row_idx_);
+          // Point last_row_ at the last selected row in the block.
+          for (size_t i = read_block_.nrows(); i > 0; i--) {
+            if (selection->IsRowSelected(i - 1)) {
+              last_row_.Reset(&read_block_, i - 1);
+              break;
+            }
+          }
           return Status::OK();
         }
       }
@@ -148,6 +167,8 @@ class MergeIterState {
   RowBlock read_block_;
   // The row currently pointed to by the iterator.
   RowBlockRow next_row_;
+  // The last selected row in the current RowBlock.
+  RowBlockRow last_row_;
   // Row index of next_row_ in read_block_.
   size_t next_row_idx_;
   // Number of rows we've advanced past in the current RowBlock.
@@ -242,34 +263,67 @@ void MergeIterator::PrepareBatch(RowBlock* dst) {
 // and such around the comparisons. A simple experiment indicated there's some
 // 2x to be gained.
 Status MergeIterator::MaterializeBlock(RowBlock *dst) {
+  // Merging a block over many sub-iterators does a lot of key comparisons;
+  // bail out up front if the client has already given up on the response.
+  RETURN_NOT_OK(ScopedScanDeadline::Check());
+
   // Initialize the selection vector.
   // MergeIterState only returns selected rows.
   dst->selection_vector()->SetAllTrue();
-  for (size_t dst_row_idx = 0; dst_row_idx < dst->nrows(); dst_row_idx++) {
-    RowBlockRow dst_row = dst->row(dst_row_idx);
-
-    // Find the sub-iterator which is currently smallest
+  size_t dst_row_idx = 0;
+  while (dst_row_idx < dst->nrows()) {
+    // Find the sub-iterators with the smallest and second-smallest next rows.
+    //
+    // Typically the number of iters_ is not that large, so using a priority
+    // queue is not worth it. Instead, rows are copied in runs: once the
+    // smallest sub-iterator is identified, rows are copied from it until its
+    // next row no longer sorts before the second-smallest sub-iterator's next
+    // row, so the full scan below only happens once per run rather than once
+    // per row.
     MergeIterState *smallest = nullptr;
+    MergeIterState *second_smallest = nullptr;
     ssize_t smallest_idx = -1;
 
-    // Typically the number of iters_ is not that large, so using a priority
-    // queue is not worth it
     for (size_t i = 0; i < iters_.size(); i++) {
       unique_ptr<MergeIterState> &state = iters_[i];
 
       if (smallest == nullptr ||
           schema_.Compare(state->next_row(), smallest->next_row()) < 0) {
+        second_smallest = smallest;
         smallest = state.get();
         smallest_idx = i;
+      } else if (second_smallest == nullptr ||
+                 schema_.Compare(state->next_row(), second_smallest->next_row()) < 0) {
+        second_smallest = state.get();
       }
     }
 
     // If no iterators had any row left, then we're done iterating.
     if (PREDICT_FALSE(smallest == nullptr)) break;
 
-    // Otherwise, copy the row from the smallest one, and advance it
-    RETURN_NOT_OK(CopyRow(smallest->next_row(), &dst_row, dst->arena()));
-    RETURN_NOT_OK(smallest->Advance());
+    // If the entire remainder of 'smallest's current block sorts before the
+    // next row of every other sub-iterator, the whole run can be copied
+    // without any more comparisons. This is the common case after bulk loads,
+    // where rowsets tend not to interleave.
+    bool run_is_whole_block =
+        second_smallest == nullptr ||
+        schema_.Compare(smallest->last_row(), second_smallest->next_row()) < 0;
+
+    // Copy rows from 'smallest' until the run ends, the current block is
+    // exhausted, or the destination block is full. 'run_remaining' bounds the
+    // run to the current block: Advance() may transparently pull a new block,
+    // invalidating 'run_is_whole_block'.
+    size_t run_remaining = smallest->remaining_in_block();
+    do {
+      RowBlockRow dst_row = dst->row(dst_row_idx++);
+      RETURN_NOT_OK(CopyRow(smallest->next_row(), &dst_row, dst->arena()));
+      RETURN_NOT_OK(smallest->Advance());
+      run_remaining--;
+    } while (run_remaining > 0 &&
+             dst_row_idx < dst->nrows() &&
+             (run_is_whole_block ||
+              schema_.Compare(smallest->next_row(),
+                              second_smallest->next_row()) < 0));
 
     if (smallest->IsFullyExhausted()) {
       iters_.erase(iters_.begin() + smallest_idx);
@@ -329,6 +383,17 @@ UnionIterator::UnionIterator(const vector<shared_ptr<RowwiseIterator> > &iters)
   all_iters_.assign(iters.begin(), iters.end());
 }
 
+UnionIterator::UnionIterator(const vector<shared_ptr<RowwiseIterator> > &iters,
+                             vector<ScanSpec::KeyRange> key_ranges)
+  : initted_(false),
+    iters_(iters.size()),
+    key_ranges_(std::move(key_ranges)) {
+  CHECK_GT(iters.size(), 0);
+  CHECK_EQ(iters.size(), key_ranges_.size());
+  iters_.assign(iters.begin(), iters.end());
+  all_iters_.assign(iters.begin(), iters.end());
+}
+
 Status UnionIterator::Init(ScanSpec *spec) {
   CHECK(!initted_);
 
@@ -354,9 +419,20 @@ Status UnionIterator::Init(ScanSpec *spec) {
 
 
 Status UnionIterator::InitSubIterators(ScanSpec *spec) {
+  int idx = 0;
   for (shared_ptr<RowwiseIterator> &iter : iters_) {
-    ScanSpec *spec_copy = spec != nullptr ? scan_spec_copies_.Construct(*spec) : nullptr;
+    ScanSpec *spec_copy = nullptr;
+    if (spec != nullptr) {
+      spec_copy = scan_spec_copies_.Construct(*spec);
+      if (!key_ranges_.empty()) {
+        // Constrain this sub-iterator to its primary key range. The spec's
+        // own bounds are kept if they are more restrictive.
+        spec_copy->SetLowerBoundKey(key_ranges_[idx].lower_bound_key);
+        spec_copy->SetExclusiveUpperBoundKey(key_ranges_[idx].exclusive_upper_bound_key);
+      }
+    }
     RETURN_NOT_OK(PredicateEvaluatingIterator::InitAndMaybeWrap(&iter, spec_copy));
+    idx++;
   }
   // Since we handle predicates in all the wrapped iterators, we can clear
   // them here.
@@ -440,8 +516,13 @@ void UnionIterator::GetIteratorStats(std::vector<IteratorStats>* stats) const {
 // Materializing iterator
 ////////////////////////////////////////////////////////////
 
+// The number of blocks to materialize between recomputations of the
+// predicate evaluation order based on observed selectivity.
+static const int kBlocksBetweenPredicateReorders = 32;
+
 MaterializingIterator::MaterializingIterator(shared_ptr<ColumnwiseIterator> iter)
     : iter_(move(iter)),
+      blocks_since_reorder_(0),
       disallow_pushdown_for_tests_(!FLAGS_materializing_iterator_do_pushdown),
       disallow_decoder_eval_(!FLAGS_materializing_iterator_decoder_eval) {
 }
@@ -467,6 +548,8 @@ Status MaterializingIterator::Init(ScanSpec *spec) {
       col_idx_predicates_.emplace_back(col_idx, move(col_pred.second));
     }
 
+    blocks_since_reorder_ = 0;
+
     for (int32_t col_idx = 0; col_idx < schema().num_columns(); col_idx++) {
       if (!ContainsKey(spec->predicates(), schema().column(col_idx).name())) {
         non_predicate_column_indexes_.emplace_back(col_idx);
@@ -483,16 +566,31 @@ Status MaterializingIterator::Init(ScanSpec *spec) {
     }
   }
 
-  // Sort the predicates by selectivity so that the most selective are evaluated earlier.
+  // Sort the predicates by selectivity so that the most selective are evaluated
+  // earlier. Once the scan is underway, the order is periodically recomputed
+  // based on the selectivity actually observed.
   sort(col_idx_predicates_.begin(), col_idx_predicates_.end(),
-       [] (const tuple<int32_t, ColumnPredicate>& left,
-           const tuple<int32_t, ColumnPredicate>& right) {
-         return SelectivityComparator(get<1>(left), get<1>(right));
+       [] (const ColumnPredicateState& left, const ColumnPredicateState& right) {
+         return SelectivityComparator(left.pred, right.pred) < 0;
        });
 
   return Status::OK();
 }
 
+void MaterializingIterator::ReorderPredicatesBySelectivity() {
+  // Use stable_sort so that predicates with identical observed selectivity
+  // (e.g. predicates which have not rejected anything yet) keep their
+  // static-heuristic order.
+  std::stable_sort(col_idx_predicates_.begin(), col_idx_predicates_.end(),
+       [] (const ColumnPredicateState& left, const ColumnPredicateState& right) {
+         double left_rate = left.rows_evaluated == 0 ? 0.0 :
+             static_cast<double>(left.rows_rejected) / left.rows_evaluated;
+         double right_rate = right.rows_evaluated == 0 ? 0.0 :
+             static_cast<double>(right.rows_rejected) / right.rows_evaluated;
+         return left_rate > right_rate;
+       });
+}
+
 bool MaterializingIterator::HasNext() const {
   return iter_->HasNext();
 }
@@ -516,11 +614,30 @@ Status MaterializingIterator::MaterializeBlock(RowBlock *dst) {
   // been deleted.
   RETURN_NOT_OK(iter_->InitializeSelectionVector(dst->selection_vector()));
 
-  for (const auto& col_pred : col_idx_predicates_) {
+  // If the entire batch was deselected up front (e.g. all of its rows were
+  // deleted), don't bother decoding any column data just to throw it away.
+  if (!dst->selection_vector()->AnySelected()) {
+    DVLOG(1) << "0/" << dst->nrows() << " rows selected after initializing "
+             << "the selection vector; skipping column materialization";
+    return Status::OK();
+  }
+
+  if (!col_idx_predicates_.empty() &&
+      ++blocks_since_reorder_ >= kBlocksBetweenPredicateReorders) {
+    ReorderPredicatesBySelectivity();
+    blocks_since_reorder_ = 0;
+  }
+
+  size_t num_selected = dst->selection_vector()->CountSelected();
+  for (auto& col_pred : col_idx_predicates_) {
+    // Materializing a column may decode and evaluate a lot of data; give up
+    // between columns if the client's deadline has already passed.
+    RETURN_NOT_OK(ScopedScanDeadline::Check());
+
     // Materialize the column itself into the row block.
-    ColumnBlock dst_col(dst->column_block(get<0>(col_pred)));
-    ColumnMaterializationContext ctx(get<0>(col_pred),
-                                     &get<1>(col_pred),
+    ColumnBlock dst_col(dst->column_block(col_pred.col_idx));
+    ColumnMaterializationContext ctx(col_pred.col_idx,
+                                     &col_pred.pred,
                                      &dst_col,
                                      dst->selection_vector());
     // None predicates should be short-circuited in scan spec.
@@ -530,24 +647,34 @@ Status MaterializingIterator::MaterializeBlock(RowBlock *dst) {
     }
     RETURN_NOT_OK(iter_->MaterializeColumn(&ctx));
     if (ctx.DecoderEvalNotSupported()) {
-      get<1>(col_pred).Evaluate(dst_col, dst->selection_vector());
+      col_pred.pred.Evaluate(dst_col, dst->selection_vector());
     }
 
+    size_t still_selected = dst->selection_vector()->CountSelected();
+    col_pred.rows_evaluated += num_selected;
+    col_pred.rows_rejected += num_selected - still_selected;
+    num_selected = still_selected;
+
     // If after evaluating this predicate the entire row block has been filtered
     // out, we don't need to materialize other columns at all.
-    if (!dst->selection_vector()->AnySelected()) {
+    if (num_selected == 0) {
       DVLOG(1) << "0/" << dst->nrows() << " passed predicate";
       return Status::OK();
     }
   }
 
   for (size_t col_idx : non_predicate_column_indexes_) {
+    RETURN_NOT_OK(ScopedScanDeadline::Check());
+
     // Materialize the column itself into the row block.
     ColumnBlock dst_col(dst->column_block(col_idx));
     ColumnMaterializationContext ctx(col_idx,
                                      nullptr,
                                      &dst_col,
                                      dst->selection_vector());
+    // All predicates have been evaluated, so the selection vector is final:
+    // the column iterator may skip materializing deselected rows.
+    ctx.SetAllowSkipUnselected();
     RETURN_NOT_OK(iter_->MaterializeColumn(&ctx));
   }
 
@@ -556,6 +683,16 @@ Status MaterializingIterator::MaterializeBlock(RowBlock *dst) {
   return Status::OK();
 }
 
+void MaterializingIterator::GetIteratorStats(vector<IteratorStats>* stats) const {
+  iter_->GetIteratorStats(stats);
+  // Fold in the per-column predicate selectivity statistics.
+  for (const auto& col_pred : col_idx_predicates_) {
+    DCHECK_LT(col_pred.col_idx, stats->size());
+    (*stats)[col_pred.col_idx].rows_evaluated_by_predicate += col_pred.rows_evaluated;
+    (*stats)[col_pred.col_idx].rows_rejected_by_predicate += col_pred.rows_rejected;
+  }
+}
+
 string MaterializingIterator::ToString() const {
   string s;
   s.append("Materializing(").append(iter_->ToString()).append(")");
@@ -629,4 +766,562 @@ string PredicateEvaluatingIterator::ToString() const {
   return strings::Substitute("PredicateEvaluating($0)", base_iter_->ToString());
 }
 
+////////////////////////////////////////////////////////////
+// Aggregate iterator
+////////////////////////////////////////////////////////////
+
+// TODO: size by bytes, not # rows
+static const int kAggregateRowBuffer = 1000;
+
+namespace {
+
+// Read the numeric cell at ('cb', 'row_idx') into the widest representations
+// used by the accumulators. Only one of the outputs is meaningful, depending
+// on whether the column is an integer or a floating-point type.
+// REQUIRES: the cell is not NULL.
+void ReadNumericCell(const ColumnBlock& cb, size_t row_idx,
+                     int64_t* int_val, double* double_val) {
+  const uint8_t* cell = cb.cell_ptr(row_idx);
+  switch (cb.type_info()->type()) {
+    case UINT8:
+      *int_val = *reinterpret_cast<const uint8_t*>(cell);
+      break;
+    case INT8:
+      *int_val = *reinterpret_cast<const int8_t*>(cell);
+      break;
+    case UINT16:
+      *int_val = *reinterpret_cast<const uint16_t*>(cell);
+      break;
+    case INT16:
+      *int_val = *reinterpret_cast<const int16_t*>(cell);
+      break;
+    case UINT32:
+      *int_val = *reinterpret_cast<const uint32_t*>(cell);
+      break;
+    case INT32:
+      *int_val = *reinterpret_cast<const int32_t*>(cell);
+      break;
+    case INT64:
+    case UNIXTIME_MICROS:
+      *int_val = *reinterpret_cast<const int64_t*>(cell);
+      break;
+    case FLOAT:
+      *double_val = *reinterpret_cast<const float*>(cell);
+      break;
+    case DOUBLE:
+      *double_val = *reinterpret_cast<const double*>(cell);
+      break;
+    default:
+      LOG(FATAL) << "Unsupported aggregate source type: " << cb.type_info()->name();
+  }
+}
+
+} // anonymous namespace
+
+Status AggregateIterator::ValidateOps(const Schema& input_schema,
+                                      const vector<AggregateOp>& ops,
+                                      Schema* result_schema) {
+  if (ops.empty()) {
+    return Status::InvalidArgument("No aggregates specified");
+  }
+  vector<ColumnSchema> cols;
+  cols.reserve(ops.size());
+  for (const AggregateOp& op : ops) {
+    if (op.function == COUNT) {
+      cols.push_back(ColumnSchema("count(*)", INT64));
+      continue;
+    }
+    if (op.col_idx < 0 ||
+        op.col_idx >= static_cast<int32_t>(input_schema.num_columns())) {
+      return Status::InvalidArgument(
+          strings::Substitute("Bad aggregate source column index $0", op.col_idx));
+    }
+    const ColumnSchema& src = input_schema.column(op.col_idx);
+    switch (src.type_info()->type()) {
+      case UINT8: case INT8: case UINT16: case INT16:
+      case UINT32: case INT32: case INT64:
+      case UNIXTIME_MICROS: case FLOAT: case DOUBLE:
+        break;
+      default:
+        return Status::NotSupported(
+            strings::Substitute("Cannot aggregate column '$0' of type $1",
+                                src.name(), src.type_info()->name()));
+    }
+    const bool is_float = src.type_info()->type() == FLOAT ||
+                          src.type_info()->type() == DOUBLE;
+    string fn_name;
+    DataType result_type;
+    switch (op.function) {
+      case MIN:
+        fn_name = "min";
+        result_type = src.type_info()->type();
+        break;
+      case MAX:
+        fn_name = "max";
+        result_type = src.type_info()->type();
+        break;
+      case SUM:
+        fn_name = "sum";
+        result_type = is_float ? DOUBLE : INT64;
+        break;
+      default:
+        return Status::InvalidArgument("Unknown aggregate function");
+    }
+    cols.push_back(ColumnSchema(strings::Substitute("$0($1)", fn_name, src.name()),
+                                result_type, true));
+  }
+  // Reset() rejects duplicate column names, so a repeated aggregate
+  // (e.g. two copies of min(c)) fails here.
+  return result_schema->Reset(cols, 0);
+}
+
+AggregateIterator::AggregateIterator(shared_ptr<RowwiseIterator> base_iter,
+                                     vector<AggregateOp> ops,
+                                     const Schema& result_schema)
+    : base_iter_(move(base_iter)),
+      ops_(move(ops)),
+      result_schema_(result_schema),
+      done_(false),
+      row_count_(0),
+      accumulators_(ops_.size()) {
+  DCHECK_EQ(ops_.size(), result_schema_.num_columns());
+}
+
+Status AggregateIterator::Init(ScanSpec *spec) {
+  // base_iter_ is already Init()ed before this is constructed, so all
+  // predicate pushdown and evaluation has already been arranged below us.
+  DCHECK(spec == nullptr || spec->predicates().empty());
+  return Status::OK();
+}
+
+bool AggregateIterator::HasNext() const {
+  return !done_;
+}
+
+Status AggregateIterator::ConsumeInput() {
+  Arena arena(1024, 256*1024);
+  RowBlock block(base_iter_->schema(), kAggregateRowBuffer, &arena);
+  while (base_iter_->HasNext()) {
+    arena.Reset();
+    RETURN_NOT_OK(base_iter_->NextBlock(&block));
+    AccumulateBlock(block);
+  }
+  return Status::OK();
+}
+
+void AggregateIterator::AccumulateBlock(const RowBlock& block) {
+  const SelectionVector* sel = block.selection_vector();
+  for (size_t row_idx = 0; row_idx < block.nrows(); row_idx++) {
+    if (!sel->IsRowSelected(row_idx)) continue;
+    row_count_++;
+    for (size_t i = 0; i < ops_.size(); i++) {
+      const AggregateOp& op = ops_[i];
+      if (op.function == COUNT) continue;
+      ColumnBlock cb = block.column_block(op.col_idx);
+      if (cb.is_nullable() && cb.is_null(row_idx)) {
+        // NULL cells do not contribute to MIN/MAX/SUM.
+        continue;
+      }
+      int64_t int_val = 0;
+      double double_val = 0;
+      ReadNumericCell(cb, row_idx, &int_val, &double_val);
+      // Only one of the int/double halves of the accumulator is meaningful
+      // for a given column; updating both unconditionally avoids a branch
+      // on the source type in this hot loop.
+      Accumulator* acc = &accumulators_[i];
+      switch (op.function) {
+        case MIN:
+          if (!acc->has_value || int_val < acc->int_val) acc->int_val = int_val;
+          if (!acc->has_value || double_val < acc->double_val) acc->double_val = double_val;
+          break;
+        case MAX:
+          if (!acc->has_value || int_val > acc->int_val) acc->int_val = int_val;
+          if (!acc->has_value || double_val > acc->double_val) acc->double_val = double_val;
+          break;
+        case SUM:
+          acc->int_val += int_val;
+          acc->double_val += double_val;
+          break;
+        default:
+          LOG(FATAL) << "Unknown aggregate function: " << op.function;
+      }
+      acc->has_value = true;
+    }
+  }
+}
+
+Status AggregateIterator::NextBlock(RowBlock* dst) {
+  DCHECK(!done_);
+  CHECK_GE(dst->row_capacity(), 1);
+  RETURN_NOT_OK(ConsumeInput());
+  done_ = true;
+
+  dst->Resize(1);
+  dst->selection_vector()->SetAllTrue();
+  for (size_t i = 0; i < ops_.size(); i++) {
+    ColumnBlock cb = dst->column_block(i);
+    if (ops_[i].function == COUNT) {
+      int64_t count = row_count_;
+      cb.SetCellValue(0, &count);
+      continue;
+    }
+    const Accumulator& acc = accumulators_[i];
+    if (!acc.has_value) {
+      cb.SetCellIsNull(0, true);
+      continue;
+    }
+    cb.SetCellIsNull(0, false);
+    switch (cb.type_info()->type()) {
+      case UINT8: {
+        uint8_t v = acc.int_val;
+        cb.SetCellValue(0, &v);
+        break;
+      }
+      case INT8: {
+        int8_t v = acc.int_val;
+        cb.SetCellValue(0, &v);
+        break;
+      }
+      case UINT16: {
+        uint16_t v = acc.int_val;
+        cb.SetCellValue(0, &v);
+        break;
+      }
+      case INT16: {
+        int16_t v = acc.int_val;
+        cb.SetCellValue(0, &v);
+        break;
+      }
+      case UINT32: {
+        uint32_t v = acc.int_val;
+        cb.SetCellValue(0, &v);
+        break;
+      }
+      case INT32: {
+        int32_t v = acc.int_val;
+        cb.SetCellValue(0, &v);
+        break;
+      }
+      case INT64:
+      case UNIXTIME_MICROS:
+        cb.SetCellValue(0, &acc.int_val);
+        break;
+      case FLOAT: {
+        float v = acc.double_val;
+        cb.SetCellValue(0, &v);
+        break;
+      }
+      case DOUBLE:
+        cb.SetCellValue(0, &acc.double_val);
+        break;
+      default:
+        LOG(FATAL) << "Unsupported aggregate result type: " << cb.type_info()->name();
+    }
+  }
+  return Status::OK();
+}
+
+string AggregateIterator::ToString() const {
+  return strings::Substitute("Aggregate($0)", base_iter_->ToString());
+}
+
+
+////////////////////////////////////////////////////////////
+// Computed columns iterator
+////////////////////////////////////////////////////////////
+
+namespace {
+
+// Write 'int_val' or 'double_val' into the numeric cell at ('cb', 'row'),
+// converting to the cell's type. The inverse of ReadNumericCell above: only
+// one of the inputs is consulted, depending on whether the column is an
+// integer or a floating-point type.
+void WriteNumericCell(ColumnBlock* cb, size_t row,
+                      int64_t int_val, double double_val) {
+  switch (cb->type_info()->type()) {
+    case UINT8: {
+      uint8_t v = int_val;
+      cb->SetCellValue(row, &v);
+      break;
+    }
+    case INT8: {
+      int8_t v = int_val;
+      cb->SetCellValue(row, &v);
+      break;
+    }
+    case UINT16: {
+      uint16_t v = int_val;
+      cb->SetCellValue(row, &v);
+      break;
+    }
+    case INT16: {
+      int16_t v = int_val;
+      cb->SetCellValue(row, &v);
+      break;
+    }
+    case UINT32: {
+      uint32_t v = int_val;
+      cb->SetCellValue(row, &v);
+      break;
+    }
+    case INT32: {
+      int32_t v = int_val;
+      cb->SetCellValue(row, &v);
+      break;
+    }
+    case INT64:
+    case UNIXTIME_MICROS:
+      cb->SetCellValue(row, &int_val);
+      break;
+    case FLOAT: {
+      float v = double_val;
+      cb->SetCellValue(row, &v);
+      break;
+    }
+    case DOUBLE:
+      cb->SetCellValue(row, &double_val);
+      break;
+    default:
+      LOG(FATAL) << "Unsupported computed column result type: "
+                 << cb->type_info()->name();
+  }
+}
+
+// Return true if 't' is a fixed-size numeric type, i.e. a valid source or
+// target for a CAST computed column.
+bool IsNumericType(DataType t) {
+  switch (t) {
+    case UINT8: case INT8: case UINT16: case INT16:
+    case UINT32: case INT32: case INT64:
+    case UNIXTIME_MICROS: case FLOAT: case DOUBLE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+} // anonymous namespace
+
+Status ComputedColumnsIterator::DeriveOutputColumn(const ColumnSchema& src,
+                                                   const ComputedOp& op,
+                                                   ColumnSchema* out) {
+  const bool is_binary = src.type_info()->physical_type() == BINARY;
+  switch (op.function) {
+    case SUBSTRING:
+      if (!is_binary) {
+        return Status::NotSupported(
+            strings::Substitute("Cannot take a substring of column '$0' of type $1",
+                                src.name(), src.type_info()->name()));
+      }
+      if (op.substring_offset < 0 || op.substring_length < 0) {
+        return Status::InvalidArgument(
+            strings::Substitute("Bad substring bounds for column '$0'", src.name()));
+      }
+      *out = ColumnSchema(strings::Substitute("substr($0)", src.name()),
+                          src.type_info()->type(), src.is_nullable());
+      return Status::OK();
+    case HASH:
+      *out = ColumnSchema(strings::Substitute("hash($0)", src.name()),
+                          INT64, src.is_nullable());
+      return Status::OK();
+    case LENGTH:
+      if (!is_binary) {
+        return Status::NotSupported(
+            strings::Substitute("Cannot take the length of column '$0' of type $1",
+                                src.name(), src.type_info()->name()));
+      }
+      *out = ColumnSchema(strings::Substitute("length($0)", src.name()),
+                          INT32, src.is_nullable());
+      return Status::OK();
+    case CAST:
+      if (!IsNumericType(src.type_info()->type()) || !IsNumericType(op.cast_type)) {
+        return Status::NotSupported(
+            strings::Substitute("Cannot cast column '$0' of type $1 to $2",
+                                src.name(), src.type_info()->name(),
+                                GetTypeInfo(op.cast_type)->name()));
+      }
+      *out = ColumnSchema(strings::Substitute("cast($0 as $1)", src.name(),
+                                              GetTypeInfo(op.cast_type)->name()),
+                          op.cast_type, src.is_nullable());
+      return Status::OK();
+    case UPPER:
+    case LOWER:
+      if (src.type_info()->type() != STRING) {
+        return Status::NotSupported(
+            strings::Substitute("Cannot change the case of column '$0' of type $1",
+                                src.name(), src.type_info()->name()));
+      }
+      *out = ColumnSchema(strings::Substitute("$0($1)",
+                                              op.function == UPPER ? "upper" : "lower",
+                                              src.name()),
+                          STRING, src.is_nullable());
+      return Status::OK();
+    default:
+      return Status::InvalidArgument("Unknown computed column function");
+  }
+}
+
+Status ComputedColumnsIterator::ValidateOps(const Schema& input_schema,
+                                            const vector<ComputedOp>& ops,
+                                            Schema* result_schema) {
+  if (ops.empty()) {
+    return Status::InvalidArgument("No computed columns specified");
+  }
+  vector<ColumnSchema> cols = input_schema.columns();
+  for (const ComputedOp& op : ops) {
+    if (op.col_idx < 0 ||
+        op.col_idx >= static_cast<int32_t>(input_schema.num_columns())) {
+      return Status::InvalidArgument(
+          strings::Substitute("Bad computed column source index $0", op.col_idx));
+    }
+    ColumnSchema out("", UINT8);
+    RETURN_NOT_OK(DeriveOutputColumn(input_schema.column(op.col_idx), op, &out));
+    cols.push_back(out);
+  }
+  // Reset() rejects duplicate column names, so a repeated computed column
+  // (e.g. two copies of hash(c)) fails here.
+  return result_schema->Reset(cols, input_schema.num_key_columns());
+}
+
+ComputedColumnsIterator::ComputedColumnsIterator(shared_ptr<RowwiseIterator> base_iter,
+                                                 vector<ComputedOp> ops,
+                                                 const Schema& result_schema)
+    : base_iter_(move(base_iter)),
+      ops_(move(ops)),
+      result_schema_(result_schema) {
+  DCHECK_EQ(base_iter_->schema().num_columns() + ops_.size(),
+            result_schema_.num_columns());
+}
+
+ComputedColumnsIterator::~ComputedColumnsIterator() {
+}
+
+Status ComputedColumnsIterator::Init(ScanSpec* spec) {
+  // base_iter_ is already Init()ed before this is constructed, so all
+  // predicate pushdown and evaluation has already been arranged below us.
+  DCHECK(spec == nullptr || spec->predicates().empty());
+  return Status::OK();
+}
+
+bool ComputedColumnsIterator::HasNext() const {
+  return base_iter_->HasNext();
+}
+
+Status ComputedColumnsIterator::NextBlock(RowBlock* dst) {
+  if (!scratch_ || scratch_->row_capacity() < dst->row_capacity()) {
+    scratch_arena_.reset(new Arena(1024, 1024 * 1024));
+    scratch_.reset(new RowBlock(base_iter_->schema(), dst->row_capacity(),
+                                scratch_arena_.get()));
+  }
+  // The base iterator resets the scratch arena itself, invalidating any
+  // references handed out by the previous call, per the NextBlock() contract.
+  RETURN_NOT_OK(base_iter_->NextBlock(scratch_.get()));
+
+  size_t nrows = scratch_->nrows();
+  dst->Resize(nrows);
+  if (nrows == 0) {
+    return Status::OK();
+  }
+  memcpy(dst->selection_vector()->mutable_bitmap(),
+         scratch_->selection_vector()->bitmap(), BitmapSize(nrows));
+
+  // Copy the base columns' cell data and null bitmaps. Variable-length
+  // cells continue to reference the scratch block's memory.
+  for (size_t c = 0; c < base_iter_->schema().num_columns(); c++) {
+    ColumnBlock src = scratch_->column_block(c);
+    ColumnBlock out = dst->column_block(c);
+    memcpy(out.data(), src.data(), nrows * src.stride());
+    if (src.is_nullable()) {
+      memcpy(out.null_bitmap(), src.null_bitmap(), BitmapSize(nrows));
+    }
+  }
+
+  for (size_t i = 0; i < ops_.size(); i++) {
+    RETURN_NOT_OK(EvaluateOp(i, dst));
+  }
+  return Status::OK();
+}
+
+Status ComputedColumnsIterator::EvaluateOp(size_t op_idx, RowBlock* dst) {
+  const ComputedOp& op = ops_[op_idx];
+  ColumnBlock src = scratch_->column_block(op.col_idx);
+  ColumnBlock out = dst->column_block(base_iter_->schema().num_columns() + op_idx);
+  const SelectionVector* sel = scratch_->selection_vector();
+  const bool src_is_float = src.type_info()->type() == FLOAT ||
+                            src.type_info()->type() == DOUBLE;
+  for (size_t row = 0; row < scratch_->nrows(); row++) {
+    if (!sel->IsRowSelected(row)) continue;
+    if (src.is_nullable() && src.is_null(row)) {
+      out.SetCellIsNull(row, true);
+      continue;
+    }
+    if (out.is_nullable()) {
+      out.SetCellIsNull(row, false);
+    }
+    switch (op.function) {
+      case SUBSTRING: {
+        const Slice* s = reinterpret_cast<const Slice*>(src.cell_ptr(row));
+        size_t off = std::min<size_t>(op.substring_offset, s->size());
+        size_t len = std::min<size_t>(op.substring_length, s->size() - off);
+        Slice result(s->data() + off, len);
+        out.SetCellValue(row, &result);
+        break;
+      }
+      case HASH: {
+        const uint8_t* cell = src.cell_ptr(row);
+        int64_t h;
+        if (src.type_info()->physical_type() == BINARY) {
+          const Slice* s = reinterpret_cast<const Slice*>(cell);
+          h = util_hash::CityHash64(reinterpret_cast<const char*>(s->data()), s->size());
+        } else {
+          h = util_hash::CityHash64(reinterpret_cast<const char*>(cell), src.stride());
+        }
+        out.SetCellValue(row, &h);
+        break;
+      }
+      case LENGTH: {
+        const Slice* s = reinterpret_cast<const Slice*>(src.cell_ptr(row));
+        int32_t len = s->size();
+        out.SetCellValue(row, &len);
+        break;
+      }
+      case CAST: {
+        int64_t int_val = 0;
+        double double_val = 0;
+        ReadNumericCell(src, row, &int_val, &double_val);
+        if (src_is_float) {
+          int_val = static_cast<int64_t>(double_val);
+        } else {
+          double_val = static_cast<double>(int_val);
+        }
+        WriteNumericCell(&out, row, int_val, double_val);
+        break;
+      }
+      case UPPER:
+      case LOWER: {
+        const Slice* s = reinterpret_cast<const Slice*>(src.cell_ptr(row));
+        uint8_t* buf = static_cast<uint8_t*>(
+            scratch_arena_->AllocateBytes(s->size()));
+        if (PREDICT_FALSE(buf == nullptr && s->size() > 0)) {
+          return Status::RuntimeError("Unable to allocate memory for computed column");
+        }
+        for (size_t i = 0; i < s->size(); i++) {
+          buf[i] = op.function == UPPER ? ascii_toupper(s->data()[i])
+                                        : ascii_tolower(s->data()[i]);
+        }
+        Slice result(buf, s->size());
+        out.SetCellValue(row, &result);
+        break;
+      }
+      default:
+        LOG(FATAL) << "Unknown computed column function: " << op.function;
+    }
+  }
+  return Status::OK();
+}
+
+string ComputedColumnsIterator::ToString() const {
+  return strings::Substitute("ComputedColumns($0)", base_iter_->ToString());
+}
+
 } // namespace kudu
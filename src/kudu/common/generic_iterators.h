@@ -23,6 +23,7 @@
 #include <string>
 #include <tuple>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "kudu/common/iterator.h"
@@ -94,6 +95,14 @@ class UnionIterator : public RowwiseIterator {
   // calling iter->Init(spec) should remove all predicates from the spec.
   explicit UnionIterator(const std::vector<std::shared_ptr<RowwiseIterator> > &iters);
 
+  // Construct a union iterator over per-range sub-iterators: in addition to
+  // the Init() spec, sub-iterator 'i' is constrained to the primary key
+  // range 'key_ranges[i]'. The ranges must be disjoint and in the same
+  // order as the iterators. Does not take ownership of the bound keys,
+  // which must outlive the iterator.
+  UnionIterator(const std::vector<std::shared_ptr<RowwiseIterator> > &iters,
+                std::vector<ScanSpec::KeyRange> key_ranges);
+
   Status Init(ScanSpec *spec) OVERRIDE;
 
   bool HasNext() const OVERRIDE;
@@ -125,6 +134,10 @@ class UnionIterator : public RowwiseIterator {
   // the underlying iterators available for GetIteratorStats.
   std::vector<std::shared_ptr<RowwiseIterator> > all_iters_;
 
+  // Per-sub-iterator primary key ranges, parallel to the iterators passed
+  // to the constructor. Empty unless the per-range constructor was used.
+  std::vector<ScanSpec::KeyRange> key_ranges_;
+
   // When the underlying iterators are initialized, each needs its own
   // copy of the scan spec in order to do its own pushdown calculations, etc.
   // The copies are allocated from this pool so they can be automatically freed
@@ -153,26 +166,55 @@ class MaterializingIterator : public RowwiseIterator {
     return iter_->schema();
   }
 
-  virtual void GetIteratorStats(std::vector<IteratorStats>* stats) const OVERRIDE {
-    iter_->GetIteratorStats(stats);
-  }
+  virtual void GetIteratorStats(std::vector<IteratorStats>* stats) const OVERRIDE;
 
   virtual Status NextBlock(RowBlock* dst) OVERRIDE;
 
  private:
   FRIEND_TEST(TestMaterializingIterator, TestPredicatePushdown);
   FRIEND_TEST(TestPredicateEvaluatingIterator, TestPredicateEvaluation);
+  FRIEND_TEST(TestAggregateIterator, TestAggregationSkipsFilteredRows);
+
+  // A pushed-down predicate, together with the per-scan statistics used to
+  // order evaluation by observed selectivity.
+  struct ColumnPredicateState {
+    ColumnPredicateState(int32_t col_idx, ColumnPredicate pred)
+        : col_idx(col_idx),
+          pred(std::move(pred)),
+          rows_evaluated(0),
+          rows_rejected(0) {
+    }
+
+    int32_t col_idx;
+    ColumnPredicate pred;
+
+    // The number of rows evaluated against 'pred' so far, and the number of
+    // those which it rejected. The ratio of the two is the predicate's
+    // observed selectivity.
+    int64_t rows_evaluated;
+    int64_t rows_rejected;
+  };
 
   Status MaterializeBlock(RowBlock *dst);
 
+  // Re-sort 'col_idx_predicates_' so that the predicate with the highest
+  // observed rejection rate is evaluated first.
+  void ReorderPredicatesBySelectivity();
+
   std::shared_ptr<ColumnwiseIterator> iter_;
 
-  // List of (column index, predicate) in order of most to least selective.
-  std::vector<std::tuple<int32_t, ColumnPredicate>> col_idx_predicates_;
+  // List of pushed-down predicates, in evaluation order. Initially ordered
+  // by the static selectivity heuristic, then periodically re-ordered based
+  // on observed selectivity.
+  std::vector<ColumnPredicateState> col_idx_predicates_;
 
   // List of column indexes without predicates to materialize.
   std::vector<int32_t> non_predicate_column_indexes_;
 
+  // The number of blocks materialized since the predicate order was last
+  // recomputed.
+  int64_t blocks_since_reorder_;
+
   // Set only by test code to disallow pushdown.
   bool disallow_pushdown_for_tests_;
   bool disallow_decoder_eval_;
@@ -225,5 +267,200 @@ class PredicateEvaluatingIterator : public RowwiseIterator {
   std::vector<ColumnPredicate> col_idx_predicates_;
 };
 
+// An iterator which wraps another iterator and computes aggregate functions
+// (COUNT/MIN/MAX/SUM) over its entire output, yielding a single result row.
+//
+// The wrapped iterator is drained completely on the first call to NextBlock().
+// Since only the accumulators are retained, memory usage is constant in the
+// number of input rows.
+class AggregateIterator : public RowwiseIterator {
+ public:
+  enum AggregateFunction {
+    COUNT,
+    MIN,
+    MAX,
+    SUM
+  };
+
+  // A single aggregate to compute.
+  struct AggregateOp {
+    AggregateFunction function;
+
+    // Index of the source column in the base iterator's schema, or -1 for
+    // COUNT, which counts whole rows rather than cells.
+    int32_t col_idx;
+  };
+
+  // Validate 'ops' against 'input_schema' and derive the schema of the
+  // single result row:
+  // - COUNT yields a non-nullable INT64 named "count(*)".
+  // - MIN/MAX yield a nullable column of the source type, named e.g.
+  //   "min(col)". The result is NULL if no non-NULL cells were seen.
+  // - SUM yields a nullable INT64 for integer sources and a nullable DOUBLE
+  //   for floating-point sources, named e.g. "sum(col)".
+  //
+  // MIN/MAX/SUM are only supported on fixed-size numeric columns; other
+  // source types yield Status::NotSupported. Duplicate aggregates are
+  // rejected since the result column names must be unique.
+  static Status ValidateOps(const Schema& input_schema,
+                            const std::vector<AggregateOp>& ops,
+                            Schema* result_schema);
+
+  // Construct the aggregating iterator.
+  // REQUIRES: base_iter is already Init()ed.
+  // REQUIRES: 'ops' and 'result_schema' have been validated and derived by
+  // ValidateOps() against base_iter->schema().
+  AggregateIterator(std::shared_ptr<RowwiseIterator> base_iter,
+                    std::vector<AggregateOp> ops,
+                    const Schema& result_schema);
+
+  Status Init(ScanSpec* spec) OVERRIDE;
+
+  virtual Status NextBlock(RowBlock* dst) OVERRIDE;
+
+  bool HasNext() const OVERRIDE;
+
+  string ToString() const OVERRIDE;
+
+  const Schema& schema() const OVERRIDE {
+    return result_schema_;
+  }
+
+  virtual void GetIteratorStats(std::vector<IteratorStats>* stats) const OVERRIDE {
+    base_iter_->GetIteratorStats(stats);
+  }
+
+ private:
+  // Drain 'base_iter_' completely, folding each block into the accumulators.
+  Status ConsumeInput();
+
+  // Fold one block of input rows into the accumulators.
+  void AccumulateBlock(const RowBlock& block);
+
+  std::shared_ptr<RowwiseIterator> base_iter_;
+  const std::vector<AggregateOp> ops_;
+  const Schema result_schema_;
+
+  // Set once the single result row has been returned from NextBlock().
+  bool done_;
+
+  // The number of selected input rows seen so far.
+  int64_t row_count_;
+
+  // One accumulator per entry of 'ops_'. Unused for COUNT ops.
+  struct Accumulator {
+    Accumulator() : has_value(false), int_val(0), double_val(0) {}
+
+    // False until the first non-NULL cell has been folded in. A MIN/MAX/SUM
+    // over no non-NULL cells yields a NULL result.
+    bool has_value;
+
+    // Only one of these is meaningful, depending on whether the source
+    // column is an integer or a floating-point type.
+    int64_t int_val;
+    double double_val;
+  };
+  std::vector<Accumulator> accumulators_;
+};
+
+// An iterator which wraps another iterator and appends columns computed by
+// simple per-row expressions (substring, hash, length, cast, upper, lower)
+// over the base iterator's columns. The output schema is the base schema
+// followed by one column per computed op.
+//
+// This is the evaluation engine behind ComputedColumnPB: the server projects
+// the expression source columns, computes the derived values here, and then
+// serializes only the columns the client asked for, so a client which wants
+// e.g. a URL prefix doesn't pay to ship the whole URL.
+class ComputedColumnsIterator : public RowwiseIterator {
+ public:
+  enum ComputedFunction {
+    SUBSTRING,
+    HASH,
+    LENGTH,
+    CAST,
+    UPPER,
+    LOWER
+  };
+
+  // A single computed column.
+  struct ComputedOp {
+    ComputedFunction function;
+
+    // Index of the source column in the base iterator's schema.
+    int32_t col_idx;
+
+    // SUBSTRING arguments; both must be non-negative. Out-of-range bounds
+    // are clamped to the source value.
+    int32_t substring_offset;
+    int32_t substring_length;
+
+    // CAST target type.
+    DataType cast_type;
+  };
+
+  // Derive the schema of the column computed by 'op' over source column
+  // 'src'. The result is named "function(source)", e.g. "substr(url)", and
+  // is nullable iff the source is nullable (a NULL source cell yields a
+  // NULL computed cell).
+  //
+  // Returns Status::NotSupported if the function does not apply to the
+  // source column's type, or Status::InvalidArgument for bad arguments.
+  static Status DeriveOutputColumn(const ColumnSchema& src,
+                                   const ComputedOp& op,
+                                   ColumnSchema* out);
+
+  // Validate 'ops' against 'input_schema' and derive the output schema:
+  // the input schema's columns followed by one column per op. Duplicate
+  // computed columns are rejected, since result column names must be unique.
+  static Status ValidateOps(const Schema& input_schema,
+                            const std::vector<ComputedOp>& ops,
+                            Schema* result_schema);
+
+  // Construct the computing iterator.
+  // REQUIRES: base_iter is already Init()ed.
+  // REQUIRES: 'ops' and 'result_schema' have been validated and derived by
+  // ValidateOps() against base_iter->schema().
+  ComputedColumnsIterator(std::shared_ptr<RowwiseIterator> base_iter,
+                          std::vector<ComputedOp> ops,
+                          const Schema& result_schema);
+  virtual ~ComputedColumnsIterator();
+
+  Status Init(ScanSpec* spec) OVERRIDE;
+
+  // NOTE: variable-length results (and copied base columns) may reference
+  // memory owned by this iterator which remains valid only until the next
+  // call to NextBlock().
+  virtual Status NextBlock(RowBlock* dst) OVERRIDE;
+
+  bool HasNext() const OVERRIDE;
+
+  string ToString() const OVERRIDE;
+
+  const Schema& schema() const OVERRIDE {
+    return result_schema_;
+  }
+
+  virtual void GetIteratorStats(std::vector<IteratorStats>* stats) const OVERRIDE {
+    base_iter_->GetIteratorStats(stats);
+  }
+
+ private:
+  // Evaluate op 'op_idx' over the rows of 'scratch_', writing the results
+  // into the corresponding appended column of 'dst'. Only selected rows are
+  // computed.
+  Status EvaluateOp(size_t op_idx, RowBlock* dst);
+
+  std::shared_ptr<RowwiseIterator> base_iter_;
+  const std::vector<ComputedOp> ops_;
+  const Schema result_schema_;
+
+  // Scratch block (and backing arena) with the base iterator's schema into
+  // which base blocks are materialized; sized lazily to the capacity of the
+  // destination blocks.
+  gscoped_ptr<Arena> scratch_arena_;
+  gscoped_ptr<RowBlock> scratch_;
+};
+
 } // namespace kudu
 #endif
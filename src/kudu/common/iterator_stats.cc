@@ -28,22 +28,30 @@ using strings::Substitute;
 IteratorStats::IteratorStats()
     : data_blocks_read_from_disk(0),
       bytes_read_from_disk(0),
-      cells_read_from_disk(0) {
+      cells_read_from_disk(0),
+      rows_evaluated_by_predicate(0),
+      rows_rejected_by_predicate(0) {
 }
 
 string IteratorStats::ToString() const {
   return Substitute("data_blocks_read_from_disk=$0 "
                     "bytes_read_from_disk=$1 "
-                    "cells_read_from_disk=$2",
+                    "cells_read_from_disk=$2 "
+                    "rows_evaluated_by_predicate=$3 "
+                    "rows_rejected_by_predicate=$4",
                     data_blocks_read_from_disk,
                     bytes_read_from_disk,
-                    cells_read_from_disk);
+                    cells_read_from_disk,
+                    rows_evaluated_by_predicate,
+                    rows_rejected_by_predicate);
 }
 
 void IteratorStats::AddStats(const IteratorStats& other) {
   data_blocks_read_from_disk += other.data_blocks_read_from_disk;
   bytes_read_from_disk += other.bytes_read_from_disk;
   cells_read_from_disk += other.cells_read_from_disk;
+  rows_evaluated_by_predicate += other.rows_evaluated_by_predicate;
+  rows_rejected_by_predicate += other.rows_rejected_by_predicate;
   DCheckNonNegative();
 }
 
@@ -51,6 +59,8 @@ void IteratorStats::SubtractStats(const IteratorStats& other) {
   data_blocks_read_from_disk -= other.data_blocks_read_from_disk;
   bytes_read_from_disk -= other.bytes_read_from_disk;
   cells_read_from_disk -= other.cells_read_from_disk;
+  rows_evaluated_by_predicate -= other.rows_evaluated_by_predicate;
+  rows_rejected_by_predicate -= other.rows_rejected_by_predicate;
   DCheckNonNegative();
 }
 
@@ -58,6 +68,8 @@ void IteratorStats::DCheckNonNegative() const {
   DCHECK_GE(data_blocks_read_from_disk, 0);
   DCHECK_GE(bytes_read_from_disk, 0);
   DCHECK_GE(cells_read_from_disk, 0);
+  DCHECK_GE(rows_evaluated_by_predicate, 0);
+  DCHECK_GE(rows_rejected_by_predicate, 0);
 }
 
 
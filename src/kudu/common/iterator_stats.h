@@ -37,6 +37,15 @@ struct IteratorStats {
   // they were decoded/materialized.
   int64_t cells_read_from_disk;
 
+  // The number of rows which were evaluated against a pushed-down predicate
+  // on this column.
+  int64_t rows_evaluated_by_predicate;
+
+  // Of the rows evaluated, the number which were rejected by the predicate
+  // on this column. The ratio of rejected to evaluated rows is the observed
+  // selectivity of the predicate.
+  int64_t rows_rejected_by_predicate;
+
   // Add statistics contained 'other' to this object (for each field
   // in this object, increment it by the value of the equivalent field
   // in 'other').
@@ -252,10 +252,10 @@ Status RowChangeListDecoder::ApplyToOneColumn(size_t row_idx, ColumnBlock* dst_c
       continue;
     }
 
-    int junk_col_idx;
+    // The column was already resolved by the caller; validate against it
+    // directly rather than re-resolving the ID through the schema.
     const void* new_val;
-    RETURN_NOT_OK(dec.Validate(dst_schema, &junk_col_idx, &new_val));
-    DCHECK_EQ(junk_col_idx, col_idx);
+    RETURN_NOT_OK(dec.ValidateForColumn(col_schema, &new_val));
 
     SimpleConstCell src(&col_schema, new_val);
     ColumnBlock::Cell dst_cell = dst_col->cell(row_idx);
@@ -332,26 +332,30 @@ Status RowChangeListDecoder::DecodedUpdate::Validate(const Schema& schema,
   }
 
   // It's a valid column - validate it.
-  const ColumnSchema& col = schema.column(*col_idx);
+  return ValidateForColumn(schema.column(*col_idx), value);
+}
 
+Status RowChangeListDecoder::DecodedUpdate::ValidateForColumn(
+    const ColumnSchema& col_schema, const void** value) const {
   if (null) {
-    if (!col.is_nullable()) {
+    if (!col_schema.is_nullable()) {
       return Status::Corruption("decoded set-to-NULL for non-nullable column",
-                                col.ToString());
+                                col_schema.ToString());
     }
     *value = nullptr;
     return Status::OK();
   }
 
-  if (col.type_info()->physical_type() == BINARY) {
+  if (col_schema.type_info()->physical_type() == BINARY) {
     *value = &this->raw_value;
     return Status::OK();
   }
 
-  if (PREDICT_FALSE(col.type_info()->size() != this->raw_value.size())) {
+  if (PREDICT_FALSE(col_schema.type_info()->size() != this->raw_value.size())) {
     return Status::Corruption(Substitute(
                                   "invalid value $0 for column $1",
-                                  KUDU_REDACT(this->raw_value.ToDebugString()), col.ToString()));
+                                  KUDU_REDACT(this->raw_value.ToDebugString()),
+                                  col_schema.ToString()));
   }
 
   *value = reinterpret_cast<const void*>(this->raw_value.data());
@@ -402,6 +402,11 @@ class RowChangeListDecoder {
     Status Validate(const Schema& s,
                     int* col_idx,
                     const void** valid_value) const;
+
+    // Same as Validate(), but for a caller which has already resolved the
+    // updated column ID to 'col_schema'. Skips the by-ID column lookup.
+    Status ValidateForColumn(const ColumnSchema& col_schema,
+                             const void** valid_value) const;
   };
 
   // Decode the next updated column into '*update'.
@@ -20,6 +20,7 @@
 #include <string>
 
 #include "kudu/common/partial_row.h"
+#include "kudu/common/row.h"
 #include "kudu/common/row_operations.h"
 #include "kudu/common/schema.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -166,6 +167,39 @@ void RowOperationsTest::DoFuzzTest(const Schema& server_schema,
   }
 }
 
+// Test that decoding aliases variable-length values in place out of the
+// request protobuf rather than copying them into the destination arena.
+// The write path relies on this to avoid an extra copy of row data between
+// the RPC buffer and the tablet.
+TEST_F(RowOperationsTest, TestDecodedSlicesAliasIndirectData) {
+  KuduPartialRow row(&schema_without_ids_);
+  ASSERT_OK(row.SetInt32("key", 12345));
+  ASSERT_OK(row.SetInt32("int_val", 54321));
+  ASSERT_OK(row.SetStringCopy("string_val", "hello world"));
+
+  RowOperationsPB pb;
+  RowOperationsPBEncoder enc(&pb);
+  enc.Add(RowOperationsPB::INSERT, row);
+
+  vector<DecodedRowOperation> ops;
+  RowOperationsPBDecoder dec(&pb, &schema_without_ids_, &schema_, &arena_);
+  ASSERT_OK(dec.DecodeOperations(&ops));
+  ASSERT_EQ(1, ops.size());
+
+  ConstContiguousRow decoded(&schema_, ops[0].row_data);
+  int col_idx = schema_.find_column("string_val");
+  const Slice* cell = reinterpret_cast<const Slice*>(decoded.cell_ptr(col_idx));
+  ASSERT_EQ("hello world", cell->ToString());
+
+  // The cell's data should point into the protobuf's indirect_data buffer,
+  // not at a copy.
+  const char* indirect_start = pb.indirect_data().data();
+  const char* indirect_end = indirect_start + pb.indirect_data().size();
+  const char* cell_data = reinterpret_cast<const char*>(cell->data());
+  ASSERT_GE(cell_data, indirect_start);
+  ASSERT_LE(cell_data + cell->size(), indirect_end);
+}
+
 // Test that, even if the protobuf is corrupt in some way, we do not
 // crash. These protobufs are provided by clients, so we want to make sure
 // a malicious client can't crash the server.
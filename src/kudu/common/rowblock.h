@@ -147,6 +147,11 @@ class SelectionVectorView {
     DCHECK_LE(nrows, sel_vec_->nrows() - row_offset_);
     BitmapChangeBits(sel_vec_->mutable_bitmap(), row_offset_, nrows, false);
   }
+  // Clear 'nrows' bits starting at the view-relative index 'row_idx'.
+  void ClearBits(size_t row_idx, size_t nrows) {
+    DCHECK_LE(row_idx + nrows, sel_vec_->nrows() - row_offset_);
+    BitmapChangeBits(sel_vec_->mutable_bitmap(), row_offset_ + row_idx, nrows, false);
+  }
  private:
   SelectionVector* sel_vec_;
   size_t row_offset_;
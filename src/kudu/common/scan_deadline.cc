@@ -0,0 +1,59 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/common/scan_deadline.h"
+
+#include "kudu/gutil/port.h"
+
+namespace kudu {
+
+namespace {
+
+// A raw __thread pointer rather than the threadlocal.h helpers: a plain
+// pointer needs no destructor registration, and the load must stay cheap
+// enough for per-block checks.
+__thread const MonoTime* tls_scan_deadline = nullptr;
+
+} // anonymous namespace
+
+ScopedScanDeadline::ScopedScanDeadline(const MonoTime& deadline)
+    : deadline_(deadline),
+      saved_(tls_scan_deadline) {
+  if (deadline_.Initialized() && deadline_ != MonoTime::Max()) {
+    tls_scan_deadline = &deadline_;
+  }
+}
+
+ScopedScanDeadline::~ScopedScanDeadline() {
+  tls_scan_deadline = saved_;
+}
+
+bool ScopedScanDeadline::expired() {
+  const MonoTime* deadline = tls_scan_deadline;
+  if (PREDICT_TRUE(deadline == nullptr)) {
+    return false;
+  }
+  return MonoTime::Now() >= *deadline;
+}
+
+Status ScopedScanDeadline::Check() {
+  if (PREDICT_FALSE(expired())) {
+    return Status::TimedOut("client deadline expired while producing scan results");
+  }
+  return Status::OK();
+}
+
+} // namespace kudu
@@ -0,0 +1,72 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_COMMON_SCAN_DEADLINE_H
+#define KUDU_COMMON_SCAN_DEADLINE_H
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+// Propagates a per-RPC deadline into the iterator stack via a thread-local,
+// so that an expensive block decode or merge can abort once the client has
+// stopped waiting for the response, instead of burning CPU and I/O producing
+// a reply that will be thrown away.
+//
+// The RPC handler driving a scan installs the client's deadline for the
+// duration of the batch loop:
+//
+//   ScopedScanDeadline scan_deadline(rpc_context->GetClientDeadline());
+//   ... iter->NextBlock(...) ...
+//
+// and deadline-aware iterators call ScopedScanDeadline::Check() at coarse
+// work boundaries (per column, per block, per batch). A check is cheap --
+// a thread-local load plus a clock read -- but it is still meant to sit in
+// front of a nontrivial chunk of work, not inside per-row loops.
+//
+// Scopes nest: an inner scope overrides the outer deadline and the outer one
+// is restored on destruction. Threads with no installed scope (compactions,
+// flushes, tests) always pass Check().
+class ScopedScanDeadline {
+ public:
+  // Install 'deadline' as the calling thread's scan deadline. An
+  // uninitialized MonoTime or MonoTime::Max() (e.g. an RPC whose client set
+  // no timeout) imposes no constraint.
+  explicit ScopedScanDeadline(const MonoTime& deadline);
+  ~ScopedScanDeadline();
+
+  // Return true if the calling thread has an installed deadline which has
+  // already passed.
+  static bool expired();
+
+  // Return Status::TimedOut if the calling thread's installed deadline has
+  // passed, Status::OK() otherwise.
+  static Status Check();
+
+ private:
+  // This scope's deadline; the thread-local points at it while installed.
+  const MonoTime deadline_;
+
+  // The previously installed deadline, restored on destruction.
+  const MonoTime* saved_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedScanDeadline);
+};
+
+} // namespace kudu
+#endif
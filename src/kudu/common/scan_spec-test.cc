@@ -378,6 +378,67 @@ TEST_F(CompositeIntKeysTest, TestInListPushdownWithRange) {
             spec.ToString(schema_));
 }
 
+// Test that an IN-list on the leading key column with equality on the second
+// decomposes into one tight range per list value.
+TEST_F(CompositeIntKeysTest, TestDecomposeInListRanges) {
+  ScanSpec spec;
+  AddInPredicate<int8_t>(&spec, "a", { 1, 5 });
+  AddPredicate<int8_t>(&spec, "b", EQ, 10);
+  SCOPED_TRACE(spec.ToString(schema_));
+
+  vector<ScanSpec::KeyRange> ranges;
+  spec.DecomposePrimaryKeyRanges(schema_, &arena_, &pool_, 64, &ranges);
+  ASSERT_EQ(2, ranges.size());
+  EXPECT_EQ("PK >= (int8 a=1, int8 b=10, int8 c=-128) AND "
+            "PK < (int8 a=1, int8 b=11, int8 c=-128)",
+            EncodedKey::RangeToStringWithSchema(ranges[0].lower_bound_key,
+                                                ranges[0].exclusive_upper_bound_key,
+                                                schema_));
+  EXPECT_EQ("PK >= (int8 a=5, int8 b=10, int8 c=-128) AND "
+            "PK < (int8 a=5, int8 b=11, int8 c=-128)",
+            EncodedKey::RangeToStringWithSchema(ranges[1].lower_bound_key,
+                                                ranges[1].exclusive_upper_bound_key,
+                                                schema_));
+}
+
+// Test that a range predicate following the IN-list bounds each
+// per-value range.
+TEST_F(CompositeIntKeysTest, TestDecomposeInListWithRange) {
+  ScanSpec spec;
+  AddInPredicate<int8_t>(&spec, "a", { 1, 5 });
+  AddPredicate<int8_t>(&spec, "b", GE, 3);
+  SCOPED_TRACE(spec.ToString(schema_));
+
+  vector<ScanSpec::KeyRange> ranges;
+  spec.DecomposePrimaryKeyRanges(schema_, &arena_, &pool_, 64, &ranges);
+  ASSERT_EQ(2, ranges.size());
+  EXPECT_EQ("PK >= (int8 a=1, int8 b=3, int8 c=-128) AND "
+            "PK < (int8 a=2, int8 b=-128, int8 c=-128)",
+            EncodedKey::RangeToStringWithSchema(ranges[0].lower_bound_key,
+                                                ranges[0].exclusive_upper_bound_key,
+                                                schema_));
+  EXPECT_EQ("PK >= (int8 a=5, int8 b=3, int8 c=-128) AND "
+            "PK < (int8 a=6, int8 b=-128, int8 c=-128)",
+            EncodedKey::RangeToStringWithSchema(ranges[1].lower_bound_key,
+                                                ranges[1].exclusive_upper_bound_key,
+                                                schema_));
+}
+
+// Test that the decomposition gives up rather than exceed the range limit,
+// and that single-range specs are not decomposed.
+TEST_F(CompositeIntKeysTest, TestDecomposeRangeLimits) {
+  ScanSpec spec;
+  AddInPredicate<int8_t>(&spec, "a", { 1, 2, 3, 4, 5 });
+  vector<ScanSpec::KeyRange> ranges;
+  spec.DecomposePrimaryKeyRanges(schema_, &arena_, &pool_, 4, &ranges);
+  EXPECT_TRUE(ranges.empty());
+
+  ScanSpec eq_spec;
+  AddPredicate<int8_t>(&eq_spec, "a", EQ, 1);
+  eq_spec.DecomposePrimaryKeyRanges(schema_, &arena_, &pool_, 64, &ranges);
+  EXPECT_TRUE(ranges.empty());
+}
+
 // Tests that a scan spec without primary key bounds will not have predicates
 // after optimization.
 TEST_F(CompositeIntKeysTest, TestLiftPrimaryKeyBounds_NoBounds) {
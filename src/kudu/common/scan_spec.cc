@@ -32,6 +32,7 @@ using std::any_of;
 using std::max;
 using std::move;
 using std::string;
+using std::unordered_map;
 using std::vector;
 
 namespace kudu {
@@ -189,6 +190,92 @@ void ScanSpec::PushPredicatesIntoPrimaryKeyBounds(const Schema& schema,
   }
 }
 
+void ScanSpec::DecomposePrimaryKeyRanges(const Schema& schema,
+                                         Arena* arena,
+                                         AutoReleasePool* pool,
+                                         int max_ranges,
+                                         vector<KeyRange>* ranges) const {
+  ranges->clear();
+  if (max_ranges <= 1 || CanShortCircuit()) return;
+
+  // Step 1: find the prefix of key columns constrained to point values, and
+  // the cross product size of the IN-list values among them.
+  vector<int32_t> in_list_col_idxs;
+  int64_t num_combinations = 1;
+  for (int32_t col_idx = 0; col_idx < schema.num_key_columns(); col_idx++) {
+    const ColumnPredicate* predicate = FindOrNull(predicates_, schema.column(col_idx).name());
+    if (predicate == nullptr) break;
+    if (predicate->predicate_type() == PredicateType::Equality) {
+      continue;
+    }
+    if (predicate->predicate_type() == PredicateType::InList) {
+      num_combinations *= predicate->raw_values().size();
+      if (num_combinations > max_ranges) return;
+      in_list_col_idxs.push_back(col_idx);
+      continue;
+    }
+    // A range or IS NOT NULL predicate ends the point-value prefix; it (and
+    // any predicates beyond it) bound each combination's range below.
+    break;
+  }
+  if (num_combinations < 2) return;
+
+  // Step 2: for each combination of IN-list values, substitute equality
+  // predicates for the IN-lists and reuse the single-range push machinery
+  // to compute the combination's bounds. Combinations are enumerated in
+  // ascending key order, so the resulting ranges are sorted and disjoint.
+  unordered_map<string, ColumnPredicate> combo_predicates(predicates_);
+  vector<int> choice(in_list_col_idxs.size(), 0);
+  while (true) {
+    for (int i = 0; i < static_cast<int>(in_list_col_idxs.size()); i++) {
+      const ColumnSchema& column = schema.column(in_list_col_idxs[i]);
+      const void* value = FindOrDie(predicates_, column.name()).raw_values()[choice[i]];
+      combo_predicates.erase(column.name());
+      combo_predicates.emplace(column.name(), ColumnPredicate::Equality(column, value));
+    }
+
+    uint8_t* lower_buf = static_cast<uint8_t*>(
+        CHECK_NOTNULL(arena->AllocateBytes(schema.key_byte_size())));
+    uint8_t* upper_buf = static_cast<uint8_t*>(
+        CHECK_NOTNULL(arena->AllocateBytes(schema.key_byte_size())));
+    ContiguousRow lower_key(&schema, lower_buf);
+    ContiguousRow upper_key(&schema, upper_buf);
+
+    int lower_pushed = key_util::PushLowerBoundPrimaryKeyPredicates(
+        combo_predicates, &lower_key, arena);
+    int upper_pushed = key_util::PushUpperBoundPrimaryKeyPredicates(
+        combo_predicates, &upper_key, arena);
+    if (lower_pushed == 0 || upper_pushed == 0) {
+      // The combination's upper bound could not be incremented to an
+      // exclusive bound (e.g. the value is the maximum of its type), so its
+      // range is unbounded. Fall back to the single-range bounds.
+      ranges->clear();
+      return;
+    }
+
+    EncodedKey* lower = EncodedKey::FromContiguousRow(ConstContiguousRow(lower_key)).release();
+    pool->Add(lower);
+    EncodedKey* upper = EncodedKey::FromContiguousRow(ConstContiguousRow(upper_key)).release();
+    pool->Add(upper);
+    if (lower->encoded_key().compare(upper->encoded_key()) < 0) {
+      ranges->push_back(KeyRange{lower, upper});
+    }
+
+    // Advance the odometer, last IN-list column fastest.
+    int pos = static_cast<int>(choice.size()) - 1;
+    while (pos >= 0) {
+      const ColumnSchema& column = schema.column(in_list_col_idxs[pos]);
+      if (++choice[pos] < static_cast<int>(
+              FindOrDie(predicates_, column.name()).raw_values().size())) {
+        break;
+      }
+      choice[pos] = 0;
+      pos--;
+    }
+    if (pos < 0) break;
+  }
+}
+
 void ScanSpec::LiftPrimaryKeyBounds(const Schema& schema, Arena* arena) {
   if (lower_bound_key_ == nullptr && exclusive_upper_bound_key_ == nullptr) { return; }
   int32_t num_key_columns = schema.num_key_columns();
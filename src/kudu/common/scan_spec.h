@@ -19,10 +19,12 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "kudu/common/schema.h"
 #include "kudu/common/column_predicate.h"
 #include "kudu/common/encoded_key.h"
+#include "kudu/common/timestamp.h"
 
 namespace kudu {
 
@@ -37,7 +39,8 @@ class ScanSpec {
       exclusive_upper_bound_key_(nullptr),
       lower_bound_partition_key_(),
       exclusive_upper_bound_partition_key_(),
-      cache_blocks_(true) {
+      cache_blocks_(true),
+      has_mutated_since_(false) {
   }
 
   // Add a predicate on the column.
@@ -66,6 +69,37 @@ class ScanSpec {
                     AutoReleasePool* pool,
                     bool remove_pushed_predicates);
 
+  // A contiguous primary key range produced by DecomposePrimaryKeyRanges().
+  // Both bounds are always set.
+  struct KeyRange {
+    const EncodedKey* lower_bound_key;           // inclusive
+    const EncodedKey* exclusive_upper_bound_key; // exclusive
+  };
+
+  // Decompose the key-prefix predicates into a set of disjoint primary key
+  // ranges, in ascending key order.
+  //
+  // A prefix of key columns constrained to point values (equality or IN-list
+  // predicates) is expanded into the cross product of its values, and the
+  // remaining predicates bound each combination's range, so e.g. an IN-list
+  // on the leading key column with a range predicate on the second produces
+  // one tight range per list value instead of one range spanning them all.
+  //
+  // Leaves 'ranges' empty when the predicates describe at most one
+  // contiguous range (the single-range bounds computed by OptimizeScan()
+  // are already optimal), or when the decomposition would produce more than
+  // 'max_ranges' ranges or an unbounded range.
+  //
+  // Allocated bound keys are added to 'pool' and remain valid as long as
+  // 'pool' and 'arena' live. Only the column predicates are consulted, so
+  // this should be called before OptimizeScan() strips the predicates it
+  // pushes into the single-range key bounds.
+  void DecomposePrimaryKeyRanges(const Schema& schema,
+                                 Arena* arena,
+                                 AutoReleasePool* pool,
+                                 int max_ranges,
+                                 std::vector<KeyRange>* ranges) const;
+
   // Set the lower bound (inclusive) primary key for the scan.
   // Does not take ownership of 'key', which must remain valid.
   // If called multiple times, the most restrictive key will be used.
@@ -118,6 +152,23 @@ class ScanSpec {
     cache_blocks_ = cache_blocks;
   }
 
+  // Restrict the scan to rowsets which may contain rows inserted or mutated
+  // at or after 'timestamp'. This is a rowset-granularity filter: rows last
+  // modified before the bound are still returned if they share a rowset
+  // with more recent activity. Used by incremental ("diff") export scans.
+  void set_mutated_since(const Timestamp& timestamp) {
+    has_mutated_since_ = true;
+    mutated_since_ = timestamp;
+  }
+
+  bool has_mutated_since() const {
+    return has_mutated_since_;
+  }
+
+  const Timestamp& mutated_since() const {
+    return mutated_since_;
+  }
+
   std::string ToString(const Schema& s) const;
 
  private:
@@ -148,6 +199,11 @@ class ScanSpec {
   std::string lower_bound_partition_key_;
   std::string exclusive_upper_bound_partition_key_;
   bool cache_blocks_;
+
+  // See set_mutated_since(). 'mutated_since_' is only valid when
+  // 'has_mutated_since_' is true.
+  bool has_mutated_since_;
+  Timestamp mutated_since_;
 };
 
 } // namespace kudu
@@ -794,6 +794,19 @@ class Schema {
   // code to swap() and CopyFrom() as well to prevent subtle bugs.
 };
 
+// A reference-counted handle to an immutable Schema.
+//
+// Copying a Schema is expensive (it allocates vectors, strings, and a
+// name-to-index map), so long-lived owners such as TabletMetadata intern a
+// single Schema instance and hand out SchemaPtr handles to it. Passing a
+// handle costs only a refcount bump, the handle keeps the schema alive
+// regardless of the owner's lifetime, and two handles obtained from the same
+// owner at the same schema version may be compared by pointer instead of by
+// a full Schema::Equals() check.
+//
+// The pointed-to Schema must not be mutated once shared.
+typedef std::shared_ptr<Schema> SchemaPtr;
+
 // Helper used for schema creation/editing.
 //
 // Example:
@@ -227,6 +227,127 @@ TEST_F(WireProtocolTest, TestColumnarRowBlockToPB) {
   }
 }
 
+TEST_F(WireProtocolTest, TestColumnMajorSerialization) {
+  Arena arena(1024, 1024 * 1024);
+  RowBlock block(schema_, 10, &arena);
+  FillRowBlockWithTestRows(&block);
+
+  // Deselect one row and null out another's col3 cell to make sure both are
+  // reflected in the serialized batch.
+  BitmapClear(block.selection_vector()->mutable_bitmap(), 1);
+  block.row(2).cell(2).set_null(true);
+
+  ColumnarSerializedBatch batch;
+  SerializeRowBlockColumnar(block, nullptr, &batch);
+
+  int expected_rows = block.nrows() - 1;
+  ASSERT_EQ(expected_rows, batch.num_rows);
+  ASSERT_EQ(schema_.num_columns(), batch.columns.size());
+
+  // col1: variable-length, non-nullable. One uint32 end-offset per row plus
+  // the concatenated values.
+  const Slice col1_value("hello world col1");
+  ASSERT_TRUE(batch.columns[0].varlen_data);
+  ASSERT_FALSE(batch.columns[0].non_null_bitmap);
+  ASSERT_EQ(expected_rows * sizeof(uint32_t), batch.columns[0].data->size());
+  ASSERT_EQ(expected_rows * col1_value.size(), batch.columns[0].varlen_data->size());
+  const uint32_t* offsets = reinterpret_cast<const uint32_t*>(batch.columns[0].data->data());
+  for (int i = 0; i < expected_rows; i++) {
+    ASSERT_EQ((i + 1) * col1_value.size(), offsets[i]);
+  }
+
+  // col3: fixed-width, nullable. The deselected row must be absent, and the
+  // nulled row must have its non-null bit cleared.
+  ASSERT_FALSE(batch.columns[2].varlen_data);
+  ASSERT_TRUE(batch.columns[2].non_null_bitmap);
+  ASSERT_EQ(expected_rows * sizeof(uint32_t), batch.columns[2].data->size());
+  const uint32_t* col3_values = reinterpret_cast<const uint32_t*>(batch.columns[2].data->data());
+  int dst_idx = 0;
+  for (int i = 0; i < block.nrows(); i++) {
+    if (!block.selection_vector()->IsRowSelected(i)) continue;
+    bool expect_null = (i == 2);
+    ASSERT_EQ(!expect_null, BitmapTest(batch.columns[2].non_null_bitmap->data(), dst_idx));
+    if (!expect_null) {
+      ASSERT_EQ(i, col3_values[dst_idx]);
+    }
+    dst_idx++;
+  }
+}
+
+// Test that serialization produces correct results for a mix of dense and
+// sparse selection patterns, which take different code paths: dense runs of
+// selected rows are copied in bulk, while sparse selections fall back to
+// per-cell copies.
+TEST_F(WireProtocolTest, TestRowBlockToPBWithSelection) {
+  Schema schema({ ColumnSchema("k", INT32),
+                  ColumnSchema("v", INT64),
+                  ColumnSchema("s", STRING),
+                  ColumnSchema("n", UINT32, true /* nullable */) },
+                1);
+  Arena arena(1024, 1024 * 1024);
+  RowBlock block(schema, 100, &arena);
+  block.selection_vector()->SetAllTrue();
+  for (int i = 0; i < block.nrows(); i++) {
+    RowBlockRow row = block.row(i);
+    *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(0)) = i;
+    *reinterpret_cast<int64_t*>(row.mutable_cell_ptr(1)) = i * 12345L;
+    Slice s;
+    CHECK(test_data_arena_.RelocateSlice(std::string(i % 10, 'x'), &s));
+    *reinterpret_cast<Slice*>(row.mutable_cell_ptr(2)) = s;
+    if (i % 7 == 0) {
+      row.cell(3).set_null(true);
+    } else {
+      row.cell(3).set_null(false);
+      *reinterpret_cast<uint32_t*>(row.mutable_cell_ptr(3)) = i * 2;
+    }
+  }
+
+  // Deselect both a contiguous range and a sparse pattern so that the
+  // serializer sees all-ones runs as well as short runs.
+  for (int i = 20; i < 40; i++) {
+    block.selection_vector()->SetRowUnselected(i);
+  }
+  for (int i = 50; i < 100; i += 2) {
+    block.selection_vector()->SetRowUnselected(i);
+  }
+  int expected_rows = block.selection_vector()->CountSelected();
+
+  // Row-major serialization must round-trip the selected rows in order.
+  RowwiseRowBlockPB pb;
+  faststring direct, indirect;
+  SerializeRowBlock(block, &pb, nullptr, &direct, &indirect);
+  ASSERT_EQ(expected_rows, pb.num_rows());
+
+  vector<const uint8_t*> row_ptrs;
+  Slice direct_sidecar = direct;
+  ASSERT_OK(ExtractRowsFromRowBlockPB(schema, pb, indirect,
+                                      &direct_sidecar, &row_ptrs));
+  ASSERT_EQ(expected_rows, row_ptrs.size());
+  int dst_idx = 0;
+  for (int i = 0; i < block.nrows(); i++) {
+    if (!block.selection_vector()->IsRowSelected(i)) continue;
+    ConstContiguousRow row_roundtripped(&schema, row_ptrs[dst_idx]);
+    EXPECT_EQ(schema.DebugRow(block.row(i)),
+              schema.DebugRow(row_roundtripped));
+    dst_idx++;
+  }
+
+  // Column-major serialization of the same block must contain the same
+  // values for the fixed-width, non-nullable columns.
+  ColumnarSerializedBatch batch;
+  SerializeRowBlockColumnar(block, nullptr, &batch);
+  ASSERT_EQ(expected_rows, batch.num_rows);
+  const int32_t* k_values = reinterpret_cast<const int32_t*>(batch.columns[0].data->data());
+  const int64_t* v_values = reinterpret_cast<const int64_t*>(batch.columns[1].data->data());
+  dst_idx = 0;
+  for (int i = 0; i < block.nrows(); i++) {
+    if (!block.selection_vector()->IsRowSelected(i)) continue;
+    ASSERT_EQ(i, k_values[dst_idx]);
+    ASSERT_EQ(i * 12345L, v_values[dst_idx]);
+    dst_idx++;
+  }
+}
+
 #ifdef NDEBUG
 TEST_F(WireProtocolTest, TestColumnarRowBlockToPBBenchmark) {
   Arena arena(1024, 1024 * 1024);
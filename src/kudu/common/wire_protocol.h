@@ -20,6 +20,7 @@
 #define KUDU_COMMON_WIRE_PROTOCOL_H
 
 #include <boost/optional.hpp>
+#include <memory>
 #include <vector>
 
 #include "kudu/common/wire_protocol.pb.h"
@@ -128,6 +129,41 @@ void SerializeRowBlock(const RowBlock& block, RowwiseRowBlockPB* rowblock_pb,
                        const Schema* client_projection_schema,
                        faststring* data_buf, faststring* indirect_data);
 
+// Accumulates scan results serialized in the column-major layout described by
+// ColumnarRowBlockPB. Each column's buffers are typically attached to the RPC
+// response as separate sidecars.
+struct ColumnarSerializedBatch {
+  struct Column {
+    // One value per row for fixed-width columns; one little-endian uint32
+    // end-offset per row for variable-length columns.
+    std::unique_ptr<faststring> data;
+
+    // Concatenated values for variable-length columns. NULL for fixed-width
+    // columns.
+    std::unique_ptr<faststring> varlen_data;
+
+    // Bit i set if row i is non-NULL. NULL for non-nullable columns.
+    std::unique_ptr<faststring> non_null_bitmap;
+  };
+
+  std::vector<Column> columns;
+
+  // Total number of rows accumulated so far.
+  int64_t num_rows = 0;
+};
+
+// Column-major counterpart to SerializeRowBlock: append the selected rows of
+// 'block' to 'out', one buffer set per projected column.
+//
+// On the first call, the columns of 'out' are initialized from the projection
+// schema ('client_projection_schema', or the block's schema if NULL); further
+// calls must pass blocks of the same projection.
+//
+// Requires that block.nrows() > 0
+void SerializeRowBlockColumnar(const RowBlock& block,
+                               const Schema* client_projection_schema,
+                               ColumnarSerializedBatch* out);
+
 // Rewrites the data pointed-to by row data slice 'row_data_slice' by replacing
 // relative indirect data pointers with absolute ones in 'indirect_data_slice'.
 // At the time of this writing, this rewriting is only done for STRING types.
@@ -35,7 +35,10 @@
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_bool(log_inject_latency);
 DECLARE_int32(consensus_max_batch_size_bytes);
+DECLARE_int32(log_inject_latency_ms_mean);
+DECLARE_int32(log_inject_latency_ms_stddev);
 
 METRIC_DECLARE_entity(tablet);
 
@@ -237,6 +240,50 @@ TEST_F(ConsensusQueueTest, TestStartTrackingAfterStart) {
   request.mutable_ops()->ExtractSubrange(0, request.ops_size(), nullptr);
 }
 
+// Tests that the leader lease deadline is unset until a majority of voters
+// has acked one of our requests, and that once established it extends past
+// the send time of the acked request.
+TEST_F(ConsensusQueueTest, TestLeaderLeaseDeadline) {
+  queue_->Init(MinimumOpId(), MinimumOpId());
+  queue_->SetLeaderMode(kMinimumOpIdIndex, kMinimumTerm, BuildRaftConfigPBForTests(2));
+  AppendReplicateMessagesToQueue(queue_.get(), clock_, 1, 10);
+
+  // With two voters the local peer alone is not a majority, so there is no
+  // lease until the remote peer acks a request.
+  ASSERT_EQ(MonoTime::Min(), queue_->GetLeaderLeaseDeadline());
+
+  ConsensusRequestPB request;
+  ConsensusResponsePB response;
+  response.set_responder_uuid(kPeerUuid);
+  bool more_pending = false;
+
+  UpdatePeerWatermarkToOp(&request, &response, MinimumOpId(), MinimumOpId(),
+                          0, &more_pending);
+
+  // The log matching property mismatch above is not a successful exchange,
+  // so it must not establish a lease.
+  ASSERT_EQ(MonoTime::Min(), queue_->GetLeaderLeaseDeadline());
+
+  MonoTime before_request = MonoTime::Now();
+  vector<ReplicateRefPtr> refs;
+  bool needs_tablet_copy;
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, &request, &refs, &needs_tablet_copy));
+  ASSERT_FALSE(needs_tablet_copy);
+  ASSERT_EQ(10, request.ops_size());
+
+  SetLastReceivedAndLastCommitted(&response, request.ops(9).id());
+  queue_->ResponseFromPeer(response.responder_uuid(), response, &more_pending);
+
+  // A successful ack establishes a lease that extends past the time at which
+  // the acked request was assembled.
+  MonoTime deadline = queue_->GetLeaderLeaseDeadline();
+  ASSERT_NE(MonoTime::Min(), deadline);
+  ASSERT_LT(before_request, deadline);
+
+  // extract the ops from the request to avoid double free
+  request.mutable_ops()->ExtractSubrange(0, request.ops_size(), nullptr);
+}
+
 // Tests that the peers gets the messages pages, with the size of a page
 // being 'consensus_max_batch_size_bytes'
 TEST_F(ConsensusQueueTest, TestGetPagedMessages) {
@@ -447,6 +494,52 @@ TEST_F(ConsensusQueueTest, TestQueueAdvancesCommittedIndex) {
   ASSERT_EQ(queue_->GetAllReplicatedIndex(), 5);
 }
 
+// Tests that the commit index advances as soon as any majority of voters has
+// replicated an op, without waiting for the leader's own log sync: local
+// durability proceeds in parallel with replication, and in a 3-voter config
+// the two remote followers form a majority on their own.
+TEST_F(ConsensusQueueTest, TestCommitIndexAdvancesBeforeLocalAck) {
+  // Inject latency into the local log's sync path so that the local peer
+  // cannot have acked by the time the remote peers respond below.
+  FLAGS_log_inject_latency = true;
+  FLAGS_log_inject_latency_ms_mean = 300;
+  FLAGS_log_inject_latency_ms_stddev = 0;
+
+  queue_->Init(MinimumOpId(), MinimumOpId());
+  queue_->SetLeaderMode(kMinimumOpIdIndex, kMinimumTerm, BuildRaftConfigPBForTests(3));
+  queue_->TrackPeer("peer-1");
+  queue_->TrackPeer("peer-2");
+
+  // This should add messages 0.1 -> 0.7, 1.8 -> 1.10 to the queue.
+  AppendReplicateMessagesToQueue(queue_.get(), clock_, 1, 10);
+
+  // The local peer is still waiting on its (artificially slow) log sync.
+  ASSERT_LT(queue_->GetTrackedPeerForTests(kLeaderUuid).last_received.index(), 10);
+
+  ConsensusResponsePB response;
+  response.set_responder_term(1);
+  bool more_pending;
+  OpId last_sent = MakeOpId(1, 10);
+
+  // Ack all operations for peer-1. One remote peer is not a majority, so
+  // the commit index must not move.
+  response.set_responder_uuid("peer-1");
+  SetLastReceivedAndLastCommitted(&response, last_sent, MinimumOpId().index());
+  queue_->ResponseFromPeer(response.responder_uuid(), response, &more_pending);
+  ASSERT_EQ(0, queue_->GetCommittedIndex());
+
+  // Ack all operations for peer-2. The two remote peers now form a majority,
+  // so the commit index advances even though the local peer has not yet
+  // finished its own log sync.
+  response.set_responder_uuid("peer-2");
+  queue_->ResponseFromPeer(response.responder_uuid(), response, &more_pending);
+  ASSERT_EQ(10, queue_->GetCommittedIndex());
+  ASSERT_LT(queue_->GetTrackedPeerForTests(kLeaderUuid).last_received.index(), 10);
+
+  // Stop injecting latency so that TearDown's flush completes quickly.
+  FLAGS_log_inject_latency = false;
+}
+
 // In this test we append a sequence of operations to a log
 // and then start tracking a peer whose first required operation
 // is before the first operation in the queue.
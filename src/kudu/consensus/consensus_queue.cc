@@ -19,8 +19,10 @@
 #include <algorithm>
 #include <boost/optional.hpp>
 #include <boost/optional/optional_io.hpp>
+#include <functional>
 #include <gflags/gflags.h>
 #include <iostream>
+#include <iterator>
 #include <mutex>
 #include <string>
 #include <utility>
@@ -67,7 +69,17 @@ DEFINE_int32(consensus_inject_latency_ms_in_notifications, 0,
 TAG_FLAG(consensus_inject_latency_ms_in_notifications, hidden);
 TAG_FLAG(consensus_inject_latency_ms_in_notifications, unsafe);
 
+DEFINE_bool(raft_enable_leader_leases, true,
+            "Whether the leader should track a leader lease based on the "
+            "responses of a majority of voters. While the lease is valid the "
+            "leader's safe time is trustworthy and is attached to every "
+            "update sent to followers, rather than only to empty heartbeats.");
+TAG_FLAG(raft_enable_leader_leases, experimental);
+TAG_FLAG(raft_enable_leader_leases, runtime);
+
 DECLARE_bool(safe_time_advancement_without_writes);
+DECLARE_int32(raft_heartbeat_interval_ms);
+DECLARE_double(leader_failure_max_missed_heartbeat_periods);
 
 namespace kudu {
 namespace consensus {
@@ -210,6 +222,14 @@ void PeerMessageQueue::UntrackPeer(const string& uuid) {
   std::lock_guard<simple_spinlock> lock(queue_lock_);
   TrackedPeer* peer = EraseKeyReturnValuePtr(&peers_map_, uuid);
   if (peer != nullptr) {
+    if (peer->is_last_exchange_successful) {
+      std::multiset<int64_t>::const_iterator iter =
+          acked_peer_indexes_.find(peer->last_received.index());
+      DCHECK(iter != acked_peer_indexes_.end());
+      if (iter != acked_peer_indexes_.end()) {
+        acked_peer_indexes_.erase(iter);
+      }
+    }
     delete peer;
   }
 }
@@ -351,6 +371,12 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
       return Status::NotFound("Peer not tracked or queue not in leader mode.");
     }
 
+    // Record when this request was assembled: a later response from the peer
+    // proves that it processed a request sent no earlier than this, which
+    // feeds the leader lease. Taking the timestamp before assembling the
+    // request errs on the conservative (shorter lease) side.
+    peer->last_request_send_time = MonoTime::Now();
+
     // Clear the requests without deleting the entries, as they may be in use by other peers.
     request->mutable_ops()->ExtractSubrange(0, request->ops_size(), nullptr);
 
@@ -427,6 +453,13 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
     // "all replicated" point. At some point we may want to allow partially loading
     // (and not pinning) earlier messages. At that point we'll need to do something
     // smarter here, like copy or ref-count.
+    //
+    // TODO(perf): the ops are still re-serialized into the outbound RPC buffer
+    // once per peer. Attaching the already-serialized op payloads as RPC
+    // sidecars would avoid that per-peer serialization, but the RPC protocol
+    // currently only supports sidecars on responses (see
+    // ResponseHeader.sidecar_offsets in rpc_header.proto), so this requires
+    // request-side sidecar support in the RPC framework first.
     for (const ReplicateRefPtr& msg : messages) {
       request->mutable_ops()->AddAllocated(msg->get());
     }
@@ -440,7 +473,8 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
   // If we are sending ops to the follower, but the batch doesn't reach the current
   // committed index, we can consider the follower lagging, and it's worth
   // logging this fact periodically.
-  if (request->ops_size() > 0) {
+  const bool request_has_ops = request->ops_size() > 0;
+  if (request_has_ops) {
     int64_t last_op_sent = request->ops(request->ops_size() - 1).id().index();
     if (last_op_sent < request->committed_index()) {
       KLOG_EVERY_N_SECS_THROTTLER(INFO, 3, peer->status_log_throttler, "lagging")
@@ -448,15 +482,19 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
           << (request->committed_index() - last_op_sent)
           << " ops behind the committed index " << THROTTLE_MSG;
     }
-  // If we're not sending ops to the follower, set the safe time on the request.
-  // TODO(dralves) When we have leader leases, send this all the time.
-  } else {
-    if (PREDICT_TRUE(FLAGS_safe_time_advancement_without_writes)) {
+  }
+
+  // Set the safe time on the request. While this node holds a leader lease
+  // its safe time is trustworthy even alongside actual messages, so it is
+  // attached to every request; without a valid lease it is only attached to
+  // empty heartbeats, which limits the damage a deposed leader can do.
+  if (PREDICT_TRUE(FLAGS_safe_time_advancement_without_writes)) {
+    if (!request_has_ops || MonoTime::Now() < GetLeaderLeaseDeadline()) {
       request->set_safe_timestamp(time_manager_->GetSafeTime().value());
-    } else {
-      KLOG_EVERY_N_SECS(WARNING, 300) << "Safe time advancement without writes is disabled. "
-            "Snapshot reads on non-leader replicas may stall if there are no writes in progress.";
     }
+  } else if (!request_has_ops) {
+    KLOG_EVERY_N_SECS(WARNING, 300) << "Safe time advancement without writes is disabled. "
+          "Snapshot reads on non-leader replicas may stall if there are no writes in progress.";
   }
 
   if (PREDICT_FALSE(VLOG_IS_ON(2))) {
@@ -514,48 +552,22 @@ void PeerMessageQueue::AdvanceQueueWatermark(const char* type,
                                  << "Current value: " << *watermark;
   }
 
-  // Go through the peer's watermarks, we want the highest watermark that
-  // 'num_peers_required' of peers has replicated. To find this we do the
-  // following:
-  // - Store all the peer's 'last_received' in a vector
-  // - Sort the vector
-  // - Find the vector.size() - 'num_peers_required' position, this
-  //   will be the new 'watermark'.
-  vector<int64_t> watermarks;
-  for (const PeersMap::value_type& peer : peers_map_) {
-    // TODO: The fact that we only consider peers whose last exchange was
-    // successful can cause the "all_replicated" watermark to lag behind
-    // farther than necessary. For example:
-    // - local peer has replicated opid 100
-    // - remote peer A has replicated opid 100
-    // - remote peer B has replication opid 10 and is catching up
-    // - remote peer A goes down
-    // Here we'd start getting 'is_last_exchange_successful == false' for peer A.
-    // In that case, the 'all_replicated_watermark', which requires 3 peers, would not
-    // be updateable, even once we've replicated peer 'B' up to opid 100. It would
-    // get "stuck" at 10. In fact, in this case, the 'majority_replicated_watermark' would
-    // also move *backwards* when peer A started getting errors.
-    //
-    // The issue with simply removing this condition is that 'last_received' does not
-    // perfectly correspond to the 'match_index' in Raft Figure 2. It is simply the
-    // highest operation in a peer's log, regardless of whether that peer currently
-    // holds a prefix of the leader's log. So, in the case that the last exchange
-    // was an error (LMP mismatch, for example), the 'last_received' is _not_ usable
-    // for watermark calculation. This could be fixed by separately storing the
-    // 'match_index' on a per-peer basis and using that for watermark calculation.
-    if (peer.second->is_last_exchange_successful) {
-      watermarks.push_back(peer.second->last_received.index());
-    }
-  }
+  // We want the highest watermark that 'num_peers_required' of peers have
+  // replicated. 'acked_peer_indexes_' holds every acked peer's
+  // 'last_received' index in sorted order, so this is the
+  // 'num_peers_required'-th highest entry. Stepping back from the end is
+  // O(num_peers_required), with no allocation or re-sorting of all peers'
+  // watermarks on each response.
 
   // If we haven't enough peers to calculate the watermark return.
-  if (watermarks.size() < num_peers_required) {
+  if (acked_peer_indexes_.size() < num_peers_required) {
     return;
   }
 
-  std::sort(watermarks.begin(), watermarks.end());
+  std::multiset<int64_t>::const_iterator iter = acked_peer_indexes_.end();
+  std::advance(iter, -num_peers_required);
 
-  int64_t new_watermark = watermarks[watermarks.size() - num_peers_required];
+  int64_t new_watermark = *iter;
   int64_t old_watermark = *watermark;
   *watermark = new_watermark;
 
@@ -567,12 +579,92 @@ void PeerMessageQueue::AdvanceQueueWatermark(const char* type,
       VLOG_WITH_PREFIX_UNLOCKED(3) << "Peer: " << peer.second->ToString();
     }
     VLOG_WITH_PREFIX_UNLOCKED(3) << "Sorted watermarks:";
-    for (int64_t watermark : watermarks) {
+    for (int64_t watermark : acked_peer_indexes_) {
       VLOG_WITH_PREFIX_UNLOCKED(3) << "Watermark: " << watermark;
     }
   }
 }
 
+void PeerMessageQueue::SyncPeerAckedIndexUnlocked(const TrackedPeer& previous,
+                                                  const TrackedPeer& current) {
+  // TODO: The fact that we only consider peers whose last exchange was
+  // successful can cause the "all_replicated" watermark to lag behind
+  // farther than necessary. For example:
+  // - local peer has replicated opid 100
+  // - remote peer A has replicated opid 100
+  // - remote peer B has replication opid 10 and is catching up
+  // - remote peer A goes down
+  // Here we'd start getting 'is_last_exchange_successful == false' for peer A.
+  // In that case, the 'all_replicated_watermark', which requires 3 peers, would not
+  // be updateable, even once we've replicated peer 'B' up to opid 100. It would
+  // get "stuck" at 10. In fact, in this case, the 'majority_replicated_watermark' would
+  // also move *backwards* when peer A started getting errors.
+  //
+  // The issue with simply removing this condition is that 'last_received' does not
+  // perfectly correspond to the 'match_index' in Raft Figure 2. It is simply the
+  // highest operation in a peer's log, regardless of whether that peer currently
+  // holds a prefix of the leader's log. So, in the case that the last exchange
+  // was an error (LMP mismatch, for example), the 'last_received' is _not_ usable
+  // for watermark calculation. This could be fixed by separately storing the
+  // 'match_index' on a per-peer basis and using that for watermark calculation.
+  if (previous.is_last_exchange_successful) {
+    std::multiset<int64_t>::const_iterator iter =
+        acked_peer_indexes_.find(previous.last_received.index());
+    DCHECK(iter != acked_peer_indexes_.end());
+    if (iter != acked_peer_indexes_.end()) {
+      acked_peer_indexes_.erase(iter);
+    }
+  }
+  if (current.is_last_exchange_successful) {
+    acked_peer_indexes_.insert(current.last_received.index());
+  }
+}
+
+MonoTime PeerMessageQueue::GetLeaderLeaseDeadline() {
+  std::lock_guard<simple_spinlock> lock(queue_lock_);
+  if (PREDICT_FALSE(!FLAGS_raft_enable_leader_leases)) {
+    return MonoTime::Min();
+  }
+  if (queue_state_.mode != LEADER || queue_state_.state != kQueueOpen) {
+    return MonoTime::Min();
+  }
+
+  // Collect, for each voter, the send time of the latest request it has
+  // successfully responded to. The local peer trivially counts as of now.
+  std::vector<MonoTime> ack_times;
+  for (const RaftPeerPB& peer_pb : queue_state_.active_config->peers()) {
+    if (peer_pb.member_type() != RaftPeerPB::VOTER) continue;
+    if (peer_pb.permanent_uuid() == local_peer_pb_.permanent_uuid()) {
+      ack_times.push_back(MonoTime::Now());
+      continue;
+    }
+    TrackedPeer* peer = FindPtrOrNull(peers_map_, peer_pb.permanent_uuid());
+    ack_times.push_back(peer != nullptr ? peer->last_acked_request_send_time
+                                        : MonoTime::Min());
+  }
+  const int majority_size = queue_state_.majority_size_;
+  if (PREDICT_FALSE(majority_size <= 0 ||
+                    ack_times.size() < static_cast<size_t>(majority_size))) {
+    return MonoTime::Min();
+  }
+
+  // Find the most recent point in time as of which a majority of voters had
+  // processed one of our requests.
+  std::nth_element(ack_times.begin(), ack_times.begin() + majority_size - 1,
+                   ack_times.end(), std::greater<MonoTime>());
+  MonoTime majority_ack_time = ack_times[majority_size - 1];
+  if (majority_ack_time == MonoTime::Min()) {
+    return MonoTime::Min();
+  }
+
+  // Each of those voters withholds its vote for the minimum election timeout
+  // from the (no earlier) time at which it processed the request, so no new
+  // leader can be elected before then.
+  return majority_ack_time + MonoDelta::FromMilliseconds(
+      FLAGS_raft_heartbeat_interval_ms *
+      FLAGS_leader_failure_max_missed_heartbeat_periods);
+}
+
 void PeerMessageQueue::UpdateFollowerWatermarks(int64_t committed_index,
                                                 int64_t all_replicated_index) {
   std::lock_guard<simple_spinlock> l(queue_lock_);
@@ -597,6 +689,8 @@ void PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
 
   boost::optional<int64_t> updated_commit_index;
   Mode mode_copy;
+  int64_t majority_done_ops = 0;
+  int64_t in_progress_ops = 0;
   {
     std::lock_guard<simple_spinlock> scoped_lock(queue_lock_);
     DCHECK_NE(kQueueConstructed, queue_state_.state);
@@ -687,6 +781,7 @@ void PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
 
     if (PREDICT_FALSE(status.has_error())) {
       peer->is_last_exchange_successful = false;
+      SyncPeerAckedIndexUnlocked(previous, *peer);
       switch (status.error().code()) {
         case ConsensusErrorPB::PRECEDING_ENTRY_DIDNT_MATCH: {
           DCHECK(status.has_last_received());
@@ -716,6 +811,11 @@ void PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
     }
 
     peer->is_last_exchange_successful = true;
+    SyncPeerAckedIndexUnlocked(previous, *peer);
+
+    // A fully successful exchange proves that the peer processed a request
+    // assembled at 'last_request_send_time', extending the leader lease.
+    peer->last_acked_request_send_time = peer->last_request_send_time;
 
     if (response.has_responder_term()) {
       // The peer must have responded with a term that is greater than or equal to
@@ -793,9 +893,14 @@ void PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
 
     log_cache_.EvictThroughOp(queue_state_.all_replicated_index);
 
-    UpdateMetrics();
+    // Only compute the metric values under the lock; the gauges themselves
+    // are updated below, off the response critical path.
+    ComputeMetricsUnlocked(&majority_done_ops, &in_progress_ops);
   }
 
+  metrics_.num_majority_done_ops->set_value(majority_done_ops);
+  metrics_.num_in_progress_ops->set_value(in_progress_ops);
+
   if (mode_copy == LEADER && updated_commit_index != boost::none) {
     NotifyObserversOfCommitIndexChange(*updated_commit_index);
   }
@@ -830,15 +935,24 @@ int64_t PeerMessageQueue::GetMajorityReplicatedIndexForTests() const {
 
 
 void PeerMessageQueue::UpdateMetrics() {
-  // Since operations have consecutive indices we can update the metrics based
-  // on simple index math.
+  int64_t majority_done_ops;
+  int64_t in_progress_ops;
+  ComputeMetricsUnlocked(&majority_done_ops, &in_progress_ops);
+  metrics_.num_majority_done_ops->set_value(majority_done_ops);
+  metrics_.num_in_progress_ops->set_value(in_progress_ops);
+}
+
+void PeerMessageQueue::ComputeMetricsUnlocked(int64_t* majority_done_ops,
+                                              int64_t* in_progress_ops) const {
+  // Since operations have consecutive indices we can compute the metrics
+  // based on simple index math.
   // For non-leaders, majority_done_ops isn't meaningful because followers don't
   // track when an op is replicated to all peers.
-  metrics_.num_majority_done_ops->set_value(queue_state_.mode == LEADER ?
-    queue_state_.committed_index - queue_state_.all_replicated_index
-    : 0);
-  metrics_.num_in_progress_ops->set_value(
-    queue_state_.last_appended.index() - queue_state_.committed_index);
+  *majority_done_ops = queue_state_.mode == LEADER ?
+      queue_state_.committed_index - queue_state_.all_replicated_index
+      : 0;
+  *in_progress_ops =
+      queue_state_.last_appended.index() - queue_state_.committed_index;
 }
 
 void PeerMessageQueue::DumpToStrings(vector<string>* lines) const {
@@ -875,6 +989,7 @@ void PeerMessageQueue::DumpToHtml(std::ostream& out) const {
 
 void PeerMessageQueue::ClearUnlocked() {
   STLDeleteValues(&peers_map_);
+  acked_peer_indexes_.clear();
   queue_state_.state = kQueueClosed;
 }
 
@@ -21,6 +21,7 @@
 #include <boost/optional.hpp>
 #include <iosfwd>
 #include <map>
+#include <set>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -77,6 +78,8 @@ class PeerMessageQueue {
           last_known_committed_index(MinimumOpId().index()),
           is_last_exchange_successful(false),
           last_successful_communication_time(MonoTime::Now()),
+          last_request_send_time(MonoTime::Min()),
+          last_acked_request_send_time(MonoTime::Min()),
           needs_tablet_copy(false),
           last_seen_term_(0) {}
 
@@ -114,6 +117,16 @@ class PeerMessageQueue {
     // successful communication ever took place.
     MonoTime last_successful_communication_time;
 
+    // The time at which the most recent request for this peer was assembled.
+    // A later response from the peer proves that it processed a request sent
+    // no earlier than this time.
+    MonoTime last_request_send_time;
+
+    // The value of 'last_request_send_time' for the most recent request that
+    // resulted in a successful exchange with the peer. Used to compute the
+    // leader lease; see GetLeaderLeaseDeadline().
+    MonoTime last_acked_request_send_time;
+
     // Whether the follower was detected to need tablet copy.
     bool needs_tablet_copy;
 
@@ -234,6 +247,18 @@ class PeerMessageQueue {
                         const ConsensusResponsePB& response,
                         bool* more_pending);
 
+  // Returns the time until which this node holds a "leader lease", or
+  // MonoTime::Min() if it holds none (e.g. the queue is not in leader mode,
+  // or a majority of voters hasn't been heard from recently).
+  //
+  // Each voter withholds its vote for the minimum election timeout after
+  // processing one of our requests, and a successful response proves that
+  // the voter processed the request no earlier than the time it was sent.
+  // The lease thus extends until the point where a majority of voters is
+  // still guaranteed to be withholding votes on our behalf: until then, no
+  // other leader can be elected, so this node's safe time can be trusted.
+  MonoTime GetLeaderLeaseDeadline();
+
   // Called by the consensus implementation to update the queue's watermarks
   // based on information provided by the leader. This is used for metrics and
   // log retention.
@@ -379,6 +404,12 @@ class PeerMessageQueue {
   // Updates the metrics based on index math.
   void UpdateMetrics();
 
+  // Computes the metric values from 'queue_state_' without updating the
+  // gauges, so that callers can update the gauges after releasing
+  // 'queue_lock_'. Must be called with 'queue_lock_' held.
+  void ComputeMetricsUnlocked(int64_t* majority_done_ops,
+                              int64_t* in_progress_ops) const;
+
   void ClearUnlocked();
 
   // Returns the last operation in the message queue, or
@@ -397,6 +428,12 @@ class PeerMessageQueue {
                                const StatusCallback& callback,
                                const Status& status);
 
+  // Re-syncs 'acked_peer_indexes_' after a peer's 'last_received' or
+  // 'is_last_exchange_successful' may have changed from 'previous' to
+  // 'current'. Must be called with 'queue_lock_' held.
+  void SyncPeerAckedIndexUnlocked(const TrackedPeer& previous,
+                                  const TrackedPeer& current);
+
   // Advances 'watermark' to the smallest op that 'num_peers_required' have.
   void AdvanceQueueWatermark(const char* type,
                              int64_t* watermark,
@@ -421,6 +458,14 @@ class PeerMessageQueue {
 
   // The currently tracked peers.
   PeersMap peers_map_;
+
+  // The 'last_received' indexes of the tracked peers whose last exchange was
+  // successful, kept in sync with 'peers_map_' as an order-statistics
+  // structure. This lets AdvanceQueueWatermark() look up the k-th highest
+  // acked index directly instead of collecting and sorting every peer's
+  // watermark on each response. Protected by 'queue_lock_'.
+  std::multiset<int64_t> acked_peer_indexes_;
+
   mutable simple_spinlock queue_lock_; // TODO: rename
 
   // We assume that we never have multiple threads racing to append to the queue.
@@ -39,6 +39,10 @@ DEFINE_int32(num_batches, 10000,
 
 DECLARE_int32(log_min_segments_to_retain);
 DECLARE_int32(log_max_segments_to_retain);
+DECLARE_int32(log_segment_preallocation_ring);
+DECLARE_int32(log_appender_idle_shutdown_ms);
+DECLARE_int32(log_max_batched_commits);
+DECLARE_int32(log_commit_batch_window_us);
 DECLARE_double(log_inject_io_error_on_preallocate_fraction);
 DECLARE_int64(fs_wal_dir_reserved_bytes);
 DECLARE_int64(disk_reserved_bytes_free_for_testing);
@@ -384,6 +388,113 @@ TEST_F(LogTest, TestSegmentRollover) {
   ASSERT_EQ(num_entries, entries_.size());
 }
 
+// Same as TestSegmentRollover, but with the ring of spare pre-allocated
+// segment files enabled, so that rollovers adopt background-allocated
+// files instead of creating them inline.
+TEST_F(LogTest, TestSegmentRolloverWithPreallocationRing) {
+  FLAGS_log_segment_preallocation_ring = 2;
+  ASSERT_OK(BuildLog());
+  log_->SetMaxSegmentSizeForTests(990);
+  const int kNumEntriesPerBatch = 100;
+
+  OpId op_id = MakeOpId(1, 1);
+  int num_entries = 0;
+
+  SegmentSequence segments;
+  ASSERT_OK(log_->reader()->GetSegmentsSnapshot(&segments));
+
+  while (segments.size() < 3) {
+    ASSERT_OK(AppendNoOps(&op_id, kNumEntriesPerBatch));
+    num_entries += kNumEntriesPerBatch;
+    ASSERT_OK(log_->reader()->GetSegmentsSnapshot(&segments));
+  }
+
+  ASSERT_OK(log_->Close());
+
+  shared_ptr<LogReader> reader;
+  ASSERT_OK(LogReader::Open(fs_manager_.get(), NULL, kTestTablet, NULL, &reader));
+  ASSERT_OK(reader->GetSegmentsSnapshot(&segments));
+
+  for (const scoped_refptr<ReadableLogSegment>& entry : segments) {
+    ASSERT_OK(entry->ReadEntries(&entries_));
+  }
+  ASSERT_EQ(num_entries, entries_.size());
+
+  // Closing the log should have cleaned up any unused spare segment
+  // files; only real segments should remain in the WAL directory.
+  vector<string> children;
+  ASSERT_OK(fs_manager_->env()->GetChildren(
+      fs_manager_->GetTabletWalDir(kTestTablet), &children));
+  for (const string& child : children) {
+    ASSERT_STR_NOT_CONTAINS(child, "kudutmp");
+  }
+}
+
+// Tests that the append thread exits after the configured period of
+// inactivity and is transparently restarted by the next append.
+TEST_F(LogTest, TestAppendThreadShutsDownWhenIdle) {
+  FLAGS_log_appender_idle_shutdown_ms = 10;
+  ASSERT_OK(BuildLog());
+
+  OpId opid = MakeOpId(1, 1);
+  ASSERT_OK(AppendNoOp(&opid));
+  AssertEventually([&]() {
+      ASSERT_FALSE(log_->append_thread_active_for_tests());
+    });
+
+  // Appending again should restart the thread and complete normally.
+  ASSERT_OK(AppendNoOps(&opid, 10));
+  ASSERT_OK(log_->Close());
+}
+
+namespace {
+void CheckOkAndCountDown(CountDownLatch* latch, const Status& s) {
+  CHECK_OK(s);
+  latch->CountDown();
+}
+} // anonymous namespace
+
+// Tests that COMMIT messages are accumulated and written out as combined
+// entry batches, and that none are lost or reordered in the process.
+TEST_F(LogTest, TestBatchedCommits) {
+  FLAGS_log_max_batched_commits = 4;
+  // Use a long batching window so that the batch size cap is what triggers
+  // the intermediate flushes below.
+  FLAGS_log_commit_batch_window_us = 10 * 1000 * 1000;
+  ASSERT_OK(BuildLog());
+
+  const int kNumCommits = 10;
+  CountDownLatch latch(kNumCommits);
+  for (int i = 0; i < kNumCommits; i++) {
+    gscoped_ptr<CommitMsg> commit(new CommitMsg);
+    commit->set_op_type(NO_OP);
+    commit->mutable_commited_op_id()->CopyFrom(MakeOpId(1, i + 1));
+    ASSERT_OK(log_->AsyncAppendCommit(std::move(commit),
+                                      Bind(&CheckOkAndCountDown, &latch)));
+  }
+  // The first two groups of four commits flush when they hit the batch
+  // size cap; the last two sit in the commit buffer until the explicit
+  // flush below.
+  ASSERT_OK(log_->WaitUntilAllFlushed());
+  latch.Wait();
+
+  // All of the commits should be readable, in the order they were appended.
+  ASSERT_OK(log_->AllocateSegmentAndRollOver());
+  SegmentSequence segments;
+  ASSERT_OK(log_->reader()->GetSegmentsSnapshot(&segments));
+
+  vector<LogEntryPB*> entries;
+  ElementDeleter deleter(&entries);
+  ASSERT_OK(segments[0]->ReadEntries(&entries));
+  ASSERT_EQ(kNumCommits, entries.size());
+  for (int i = 0; i < kNumCommits; i++) {
+    ASSERT_EQ(COMMIT, entries[i]->type());
+    ASSERT_EQ(i + 1, entries[i]->commit().commited_op_id().index());
+  }
+
+  ASSERT_OK(log_->Close());
+}
+
 TEST_F(LogTest, TestWriteAndReadToAndFromInProgressSegment) {
   const int kNumEntries = 4;
   ASSERT_OK(BuildLog());
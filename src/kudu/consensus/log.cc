@@ -30,6 +30,7 @@
 #include "kudu/consensus/log_reader.h"
 #include "kudu/consensus/log_util.h"
 #include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/bind.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stl_util.h"
@@ -76,6 +77,49 @@ DEFINE_int32(group_commit_queue_size_bytes, 4 * 1024 * 1024,
              "Maximum size of the group commit queue in bytes");
 TAG_FLAG(group_commit_queue_size_bytes, advanced);
 
+DEFINE_int32(group_commit_window_us, -1,
+             "Amount of time, in microseconds, for which the log append thread "
+             "keeps accumulating entry batches before issuing a single sync, "
+             "once it has at least one batch in hand. A larger window "
+             "coalesces more entries per fsync at the cost of commit latency. "
+             "If 0, batches are synced as soon as they are drained from the "
+             "queue. If -1, the window is auto-tuned based on the observed "
+             "sync latency.");
+TAG_FLAG(group_commit_window_us, advanced);
+TAG_FLAG(group_commit_window_us, runtime);
+
+DEFINE_int32(group_commit_window_bytes, 1024 * 1024,
+             "Maximum number of bytes of log entries to accumulate within the "
+             "group commit window before syncing.");
+TAG_FLAG(group_commit_window_bytes, advanced);
+TAG_FLAG(group_commit_window_bytes, runtime);
+
+DEFINE_int32(log_max_batched_commits, 32,
+             "Maximum number of COMMIT messages to accumulate into a single "
+             "combined WAL entry batch. Writing one entry per group of "
+             "commits rather than one per commit halves the WAL record "
+             "count at high write rates. Set to 1 to append each COMMIT "
+             "message as its own entry.");
+TAG_FLAG(log_max_batched_commits, advanced);
+TAG_FLAG(log_max_batched_commits, runtime);
+
+DEFINE_int32(log_commit_batch_window_us, 1000,
+             "Maximum amount of time, in microseconds, to hold back a COMMIT "
+             "message in order to batch it together with subsequent ones. "
+             "Commit messages are not client-visible, so this window only "
+             "delays WAL metadata, not operation completion.");
+TAG_FLAG(log_commit_batch_window_us, advanced);
+TAG_FLAG(log_commit_batch_window_us, runtime);
+
+DEFINE_int32(log_appender_idle_shutdown_ms, 5000,
+             "Number of milliseconds of inactivity after which a tablet's log "
+             "append thread exits. The thread is restarted on demand by the "
+             "next append, so a server hosting many mostly-idle tablets does "
+             "not keep a dedicated thread per tablet. If -1, every tablet "
+             "keeps its append thread running for the lifetime of the log.");
+TAG_FLAG(log_appender_idle_shutdown_ms, advanced);
+TAG_FLAG(log_appender_idle_shutdown_ms, runtime);
+
 // Fault/latency injection flags.
 // -----------------------------
 DEFINE_bool(log_inject_latency, false,
@@ -108,6 +152,15 @@ DEFINE_double(log_inject_io_error_on_preallocate_fraction, 0.0,
 TAG_FLAG(log_inject_io_error_on_preallocate_fraction, unsafe);
 TAG_FLAG(log_inject_io_error_on_preallocate_fraction, runtime);
 
+DEFINE_int32(log_segment_preallocation_ring, 0,
+             "Number of spare pre-allocated WAL segment files to keep ready "
+             "in the background for each log. When non-zero, a segment "
+             "rollover adopts a spare file immediately instead of waiting "
+             "for file creation and preallocation, so the append path is "
+             "never blocked on segment allocation. 0 disables the ring.");
+TAG_FLAG(log_segment_preallocation_ring, advanced);
+TAG_FLAG(log_segment_preallocation_ring, experimental);
+
 DEFINE_int64(fs_wal_dir_reserved_bytes, 0,
              "Number of bytes to reserve on the log directory filesystem for non-Kudu usage");
 TAG_FLAG(fs_wal_dir_reserved_bytes, runtime);
@@ -140,6 +193,11 @@ using strings::Substitute;
 
 // This class is responsible for managing the thread that appends to
 // the log file.
+//
+// When --log_appender_idle_shutdown_ms is non-negative, the thread exits
+// after that period of inactivity and is restarted on demand by Wake(), so
+// that a server hosting many mostly-idle tablets does not pin a dedicated
+// thread per tablet.
 class Log::AppendThread {
  public:
   explicit AppendThread(Log* log);
@@ -147,6 +205,14 @@ class Log::AppendThread {
   // Initializes the objects and starts the thread.
   Status Init();
 
+  // Restarts the thread if it previously exited due to inactivity.
+  // Must be called after enqueuing an entry batch. No-op if the thread
+  // is already running or the appender is shutting down.
+  void Wake();
+
+  // Returns true if the append thread is currently running.
+  bool active_for_tests() const;
+
   // Waits until the last enqueued elements are processed, sets the
   // Appender thread to closing state. If any entries are added to the
   // queue during the process, invoke their callbacks' 'OnFailure()'
@@ -156,26 +222,67 @@ class Log::AppendThread {
  private:
   void RunThread();
 
+  // Starts the thread, joining any previous incarnation which exited due
+  // to inactivity. Must be called with 'lock_' held.
+  Status StartUnlocked();
+
   Log* const log_;
 
-  // Lock to protect access to thread_ during shutdown.
+  // Lock to protect access to thread_, running_ and closing_.
   mutable std::mutex lock_;
   scoped_refptr<Thread> thread_;
+
+  // True while RunThread() is executing. Cleared by the thread itself just
+  // before it exits, whether due to inactivity or shutdown.
+  bool running_;
+
+  // Set by Shutdown() to prevent Wake() from restarting the thread.
+  bool closing_;
 };
 
 
 Log::AppendThread::AppendThread(Log *log)
-  : log_(log) {
+  : log_(log),
+    running_(false),
+    closing_(false) {
 }
 
 Status Log::AppendThread::Init() {
   DCHECK(!thread_) << "Already initialized";
   VLOG(1) << "Starting log append thread for tablet " << log_->tablet_id();
+  std::lock_guard<std::mutex> lock_guard(lock_);
+  return StartUnlocked();
+}
+
+Status Log::AppendThread::StartUnlocked() {
+  DCHECK(!running_);
+  if (thread_) {
+    // Clean up a previous incarnation which exited due to inactivity.
+    CHECK_OK(ThreadJoiner(thread_.get()).Join());
+    thread_.reset();
+  }
   RETURN_NOT_OK(kudu::Thread::Create("log", "appender",
       &AppendThread::RunThread, this, &thread_));
+  running_ = true;
   return Status::OK();
 }
 
+void Log::AppendThread::Wake() {
+  std::lock_guard<std::mutex> lock_guard(lock_);
+  if (running_ || closing_) {
+    return;
+  }
+  // If the thread fails to start, leave the entries in the queue: the next
+  // Wake() will retry.
+  WARN_NOT_OK(StartUnlocked(),
+              "Unable to restart log append thread for tablet " + log_->tablet_id());
+}
+
+bool Log::AppendThread::active_for_tests() const {
+  std::lock_guard<std::mutex> lock_guard(lock_);
+  return running_;
+}
+
 void Log::AppendThread::RunThread() {
   bool shutting_down = false;
   while (PREDICT_TRUE(!shutting_down)) {
@@ -187,8 +294,82 @@ void Log::AppendThread::RunThread() {
     // the entry_batches vector with the final set of log entry batches that
     // were enqueued. We finish processing this last bunch of log entry batches
     // before exiting the main RunThread() loop.
-    if (PREDICT_FALSE(!log_->entry_queue()->BlockingDrainTo(&entry_batches))) {
+    // The wait for the first batch is bounded both by the idle-shutdown
+    // deadline and by the flush deadline of any COMMIT messages
+    // accumulating in the commit buffer, whichever comes first.
+    int32_t idle_ms = FLAGS_log_appender_idle_shutdown_ms;
+    MonoTime idle_deadline;
+    if (idle_ms >= 0) {
+      idle_deadline = MonoTime::Now() + MonoDelta::FromMilliseconds(idle_ms);
+    }
+    MonoTime drain_deadline = idle_deadline;
+    MonoTime commit_deadline = log_->commit_buffer_flush_deadline();
+    if (commit_deadline.Initialized() &&
+        (!drain_deadline.Initialized() || commit_deadline < drain_deadline)) {
+      drain_deadline = commit_deadline;
+    }
+
+    bool drained = drain_deadline.Initialized() ?
+        log_->entry_queue()->BlockingDrainTo(&entry_batches, drain_deadline) :
+        log_->entry_queue()->BlockingDrainTo(&entry_batches);
+    if (PREDICT_FALSE(!drained)) {
       shutting_down = true;
+    } else if (entry_batches.empty()) {
+      // The wait timed out. If COMMIT messages are waiting in the commit
+      // buffer, append them now as a single combined batch. The batch is
+      // created directly rather than through Reserve() so that the append
+      // thread can never block on its own full queue.
+      LogEntryBatch* commit_batch = log_->TakePendingCommitsAsBatch();
+      if (commit_batch != nullptr) {
+        entry_batches.push_back(commit_batch);
+        // Fall through to process the batch.
+      } else {
+        if (idle_deadline.Initialized() && MonoTime::Now() >= idle_deadline) {
+          // Nothing arrived within the idle window. Exit the thread unless
+          // an entry raced in since the drain timed out; Wake() restarts it
+          // on the next append. The queue must be re-checked under 'lock_'
+          // since Wake() declines to start a new thread while 'running_' is
+          // set.
+          std::lock_guard<std::mutex> lock_guard(lock_);
+          if (log_->entry_queue()->empty()) {
+            VLOG(1) << "Log append thread for tablet " << log_->tablet_id()
+                    << " exiting after " << idle_ms << "ms of inactivity";
+            running_ = false;
+            return;
+          }
+        }
+        continue;
+      }
+    }
+
+    // Group commit: now that we have at least one batch in hand, keep
+    // draining the queue for a short window so that the single Sync() below
+    // covers as many entry batches as possible. The window is bounded both
+    // in time and in accumulated bytes.
+    if (PREDICT_TRUE(!shutting_down)) {
+      MonoDelta window = log_->group_commit_window();
+      if (window.ToNanoseconds() > 0) {
+        MonoTime deadline = MonoTime::Now() + window;
+        size_t batched_bytes = 0;
+        for (LogEntryBatch* entry_batch : entry_batches) {
+          batched_bytes += entry_batch->total_size_bytes();
+        }
+        while (batched_bytes < FLAGS_group_commit_window_bytes) {
+          size_t prev_count = entry_batches.size();
+          if (PREDICT_FALSE(!log_->entry_queue()->BlockingDrainTo(
+                  &entry_batches, deadline))) {
+            shutting_down = true;
+            break;
+          }
+          if (entry_batches.size() == prev_count) {
+            // The window elapsed without any new batches arriving.
+            break;
+          }
+          for (size_t i = prev_count; i < entry_batches.size(); i++) {
+            batched_bytes += entry_batches[i]->total_size_bytes();
+          }
+        }
+      }
     }
 
     if (log_->metrics_) {
@@ -248,15 +429,26 @@ void Log::AppendThread::RunThread() {
     }
   }
   VLOG(1) << "Exiting AppendThread for tablet " << log_->tablet_id();
+  std::lock_guard<std::mutex> lock_guard(lock_);
+  running_ = false;
 }
 
 void Log::AppendThread::Shutdown() {
   log_->entry_queue()->Shutdown();
-  std::lock_guard<std::mutex> lock_guard(lock_);
-  if (thread_) {
+  scoped_refptr<Thread> thread_to_join;
+  {
+    std::lock_guard<std::mutex> lock_guard(lock_);
+    closing_ = true;
+    thread_to_join = thread_;
+  }
+  // The join must happen outside of 'lock_' since the thread acquires it on
+  // its way out. Wake() can no longer start a new thread once 'closing_' is
+  // set, so 'thread_' is stable from here on.
+  if (thread_to_join) {
     VLOG(1) << "Shutting down log append thread for tablet " << log_->tablet_id();
-    CHECK_OK(ThreadJoiner(thread_.get()).Join());
+    CHECK_OK(ThreadJoiner(thread_to_join.get()).Join());
     VLOG(1) << "Log append thread for tablet " << log_->tablet_id() << " is shut down";
+    std::lock_guard<std::mutex> lock_guard(lock_);
     thread_.reset();
   }
 }
@@ -311,6 +503,7 @@ Log::Log(LogOptions options, FsManager* fs_manager, string log_path,
       append_thread_(new AppendThread(this)),
       force_sync_all_(options_.force_fsync_all),
       sync_disabled_(false),
+      sync_latency_ewma_us_(0),
       allocation_state_(kAllocationNotStarted),
       metric_entity_(metric_entity) {
   CHECK_OK(ThreadPoolBuilder("log-alloc").set_max_threads(1).Build(&allocation_pool_));
@@ -356,6 +549,12 @@ Status Log::Init() {
   RETURN_NOT_OK(allocation_status_.Get());
   RETURN_NOT_OK(SwitchToAllocatedSegment());
 
+  // Start filling the ring of spare segment files, if configured.
+  if (FLAGS_log_segment_preallocation_ring > 0) {
+    RETURN_NOT_OK(allocation_pool_->SubmitClosure(
+        Bind(&Log::RefillSegmentRingTask, Unretained(this))));
+  }
+
   RETURN_NOT_OK(append_thread_->Init());
   log_state_ = kLogWriting;
   return Status::OK();
@@ -450,6 +649,13 @@ void Log::AsyncAppend(LogEntryBatch* entry_batch, const StatusCallback& callback
   TRACE("Serialized $0 byte log entry", entry_batch->total_size_bytes());
   TRACE_EVENT_FLOW_BEGIN0("log", "Batch", entry_batch);
   entry_batch->MarkReady();
+  // The batch was enqueued by Reserve(); restart the append thread if it
+  // shut down while the log was idle.
+  append_thread_->Wake();
+}
+
+bool Log::append_thread_active_for_tests() const {
+  return append_thread_->active_for_tests();
 }
 
 Status Log::AsyncAppendReplicates(const vector<ReplicateRefPtr>& replicates,
@@ -468,22 +674,127 @@ Status Log::AsyncAppendReplicates(const vector<ReplicateRefPtr>& replicates,
   return Status::OK();
 }
 
+namespace {
+
+// Callback for a combined COMMIT entry batch: fans the batch result out to
+// the callbacks of the individual commit messages it contains.
+void RunBatchedCommitCallbacks(const vector<StatusCallback>& callbacks,
+                               const Status& s) {
+  for (const StatusCallback& cb : callbacks) {
+    cb.Run(s);
+  }
+}
+
+} // anonymous namespace
+
 Status Log::AsyncAppendCommit(gscoped_ptr<consensus::CommitMsg> commit_msg,
                               const StatusCallback& callback) {
   MAYBE_FAULT(FLAGS_fault_crash_before_append_commit);
 
-  gscoped_ptr<LogEntryBatchPB> batch(new LogEntryBatchPB);
-  LogEntryPB* entry = batch->add_entry();
-  entry->set_type(COMMIT);
-  entry->set_allocated_commit(commit_msg.release());
+  if (FLAGS_log_max_batched_commits <= 1) {
+    gscoped_ptr<LogEntryBatchPB> batch(new LogEntryBatchPB);
+    LogEntryPB* entry = batch->add_entry();
+    entry->set_type(COMMIT);
+    entry->set_allocated_commit(commit_msg.release());
 
-  LogEntryBatch* reserved_entry_batch;
-  RETURN_NOT_OK(Reserve(COMMIT, std::move(batch), &reserved_entry_batch));
+    LogEntryBatch* reserved_entry_batch;
+    RETURN_NOT_OK(Reserve(COMMIT, std::move(batch), &reserved_entry_batch));
 
-  AsyncAppend(reserved_entry_batch, callback);
+    AsyncAppend(reserved_entry_batch, callback);
+    return Status::OK();
+  }
+
+  // Accumulate the message in the commit buffer. The buffer is flushed as
+  // a single combined entry batch once it fills up or its batching window
+  // expires; the append thread flushes any leftover messages when the
+  // entry queue goes idle (see AppendThread::RunThread()).
+  bool flush;
+  bool new_buffer = false;
+  {
+    std::lock_guard<simple_spinlock> l(commit_buffer_lock_);
+    if (!commit_buffer_) {
+      commit_buffer_.reset(new LogEntryBatchPB);
+      commit_buffer_flush_deadline_ = MonoTime::Now() +
+          MonoDelta::FromMicroseconds(FLAGS_log_commit_batch_window_us);
+      new_buffer = true;
+    }
+    LogEntryPB* entry = commit_buffer_->add_entry();
+    entry->set_type(COMMIT);
+    entry->set_allocated_commit(commit_msg.release());
+    commit_buffer_callbacks_.push_back(callback);
+    flush = commit_buffer_->entry_size() >= FLAGS_log_max_batched_commits ||
+        MonoTime::Now() >= commit_buffer_flush_deadline_;
+  }
+  if (flush) {
+    FlushPendingCommits();
+  } else if (new_buffer) {
+    // The append thread may be blocked waiting on the entry queue with a
+    // deadline computed before this buffer existed. Nudge it with a
+    // zero-byte marker so that it re-computes its wait to include the
+    // buffer's flush deadline.
+    gscoped_ptr<LogEntryBatchPB> marker(new LogEntryBatchPB);
+    marker->add_entry()->set_type(FLUSH_MARKER);
+    LogEntryBatch* reserved_marker;
+    RETURN_NOT_OK(Reserve(FLUSH_MARKER, std::move(marker), &reserved_marker));
+    AsyncAppend(reserved_marker, StatusCallback());
+  }
   return Status::OK();
 }
 
+bool Log::FlushPendingCommits() {
+  gscoped_ptr<LogEntryBatchPB> batch;
+  vector<StatusCallback> callbacks;
+  {
+    std::lock_guard<simple_spinlock> l(commit_buffer_lock_);
+    if (!commit_buffer_) {
+      return false;
+    }
+    batch = std::move(commit_buffer_);
+    callbacks.swap(commit_buffer_callbacks_);
+  }
+
+  LogEntryBatch* reserved_entry_batch;
+  Status s = Reserve(COMMIT, std::move(batch), &reserved_entry_batch);
+  if (PREDICT_FALSE(!s.ok())) {
+    // The log is shutting down; notify the callbacks directly, just as
+    // AsyncAppend() would have on failure.
+    RunBatchedCommitCallbacks(callbacks, s);
+    return false;
+  }
+  AsyncAppend(reserved_entry_batch, Bind(&RunBatchedCommitCallbacks, callbacks));
+  return true;
+}
+
+LogEntryBatch* Log::TakePendingCommitsAsBatch() {
+  gscoped_ptr<LogEntryBatchPB> batch_pb;
+  vector<StatusCallback> callbacks;
+  {
+    std::lock_guard<simple_spinlock> l(commit_buffer_lock_);
+    if (!commit_buffer_) {
+      return nullptr;
+    }
+    batch_pb = std::move(commit_buffer_);
+    callbacks.swap(commit_buffer_callbacks_);
+  }
+
+  // The batch bypasses the entry queue (see the caller in
+  // AppendThread::RunThread()), so drive the state machine directly, as
+  // Log::Append() does.
+  int num_ops = batch_pb->entry_size();
+  gscoped_ptr<LogEntryBatch> batch(new LogEntryBatch(
+      COMMIT, std::move(batch_pb), num_ops));
+  batch->state_ = LogEntryBatch::kEntryReserved;
+  batch->Serialize();
+  batch->set_callback(Bind(&RunBatchedCommitCallbacks, callbacks));
+  batch->state_ = LogEntryBatch::kEntryReady;
+  return batch.release();
+}
+
+MonoTime Log::commit_buffer_flush_deadline() const {
+  std::lock_guard<simple_spinlock> l(commit_buffer_lock_);
+  return commit_buffer_ ? commit_buffer_flush_deadline_ : MonoTime();
+}
+
 Status Log::DoAppend(LogEntryBatch* entry_batch) {
   size_t num_entries = entry_batch->count();
   DCHECK_GT(num_entries, 0) << "Cannot call DoAppend() with zero entries reserved";
@@ -613,6 +924,7 @@ Status Log::Sync() {
   }
 
   if (force_sync_all_ && !sync_disabled_) {
+    MonoTime start = MonoTime::Now();
     LOG_SLOW_EXECUTION(WARNING, 50, "Fsync log took a long time") {
       RETURN_NOT_OK(active_segment_->Sync());
 
@@ -621,6 +933,12 @@ Status Log::Sync() {
                               "PostSyncIfFsyncEnabled hook failed");
       }
     }
+    // Update the moving average of the sync latency, weighting the
+    // history at 3/4. This feeds back into the auto-tuned group commit
+    // window; see group_commit_window().
+    int64_t sync_us = (MonoTime::Now() - start).ToMicroseconds();
+    sync_latency_ewma_us_.Store(
+        (sync_latency_ewma_us_.Load() * 3 + sync_us) / 4);
   }
 
   if (log_hooks_) {
@@ -629,6 +947,26 @@ Status Log::Sync() {
   return Status::OK();
 }
 
+MonoDelta Log::group_commit_window() const {
+  int32_t window_us = FLAGS_group_commit_window_us;
+  if (window_us >= 0) {
+    return MonoDelta::FromMicroseconds(window_us);
+  }
+
+  // Auto-tune: delaying the sync is only worthwhile when we're actually
+  // fsyncing on every append.
+  if (!force_sync_all_ || sync_disabled_) {
+    return MonoDelta::FromMicroseconds(0);
+  }
+
+  // Wait for at most a quarter of the observed fsync latency, capped at
+  // 5ms. On devices with slow fsync this coalesces many more entry batches
+  // per sync while adding only a small fraction to commit latency; on fast
+  // devices the window shrinks towards zero.
+  return MonoDelta::FromMicroseconds(
+      std::min<int64_t>(sync_latency_ewma_us_.Load() / 4, 5000));
+}
+
 int GetPrefixSizeToGC(RetentionIndexes retention_indexes, const SegmentSequence& segments) {
   int rem_segs = segments.size();
   int prefix_size = 0;
@@ -681,6 +1019,10 @@ Status Log::Append(LogEntryPB* entry) {
 }
 
 Status Log::WaitUntilAllFlushed() {
+  // Push any buffered COMMIT messages into the queue ahead of the flush
+  // marker.
+  FlushPendingCommits();
+
   // In order to make sure we empty the queue we need to use
   // the async api.
   gscoped_ptr<LogEntryBatchPB> entry_batch(new LogEntryBatchPB);
@@ -797,9 +1139,27 @@ void Log::SetSchemaForNextLogSegment(const Schema& schema,
 }
 
 Status Log::Close() {
+  // Flush any buffered COMMIT messages while the entry queue is still
+  // accepting batches; the append thread writes them out on its way down.
+  FlushPendingCommits();
+
   allocation_pool_->Shutdown();
   append_thread_->Shutdown();
 
+  // Clean up any spare segment files which were never adopted. This runs
+  // after the allocation pool has shut down, so the ring is no longer
+  // being refilled.
+  {
+    std::lock_guard<RWMutex> l(allocation_lock_);
+    for (const auto& e : segment_ring_) {
+      WARN_NOT_OK(e.second->Close(),
+                  "Error closing spare WAL segment " + e.first);
+      WARN_NOT_OK(fs_manager_->env()->DeleteFile(e.first),
+                  "Error deleting spare WAL segment " + e.first);
+    }
+    segment_ring_.clear();
+  }
+
   std::lock_guard<percpu_rwlock> l(state_lock_);
   switch (log_state_) {
     case kLogWriting:
@@ -859,27 +1219,80 @@ Status Log::PreAllocateNewSegment() {
     allocation_state_ = kAllocationFinished;
   });
 
+  // If the ring holds a spare segment file, adopt it rather than creating
+  // and preallocating one inline.
+  bool adopted_spare = false;
+  {
+    std::lock_guard<RWMutex> l(allocation_lock_);
+    if (!segment_ring_.empty()) {
+      next_segment_path_ = segment_ring_.front().first;
+      next_segment_file_ = segment_ring_.front().second;
+      segment_ring_.pop_front();
+      adopted_spare = true;
+    }
+  }
+  if (adopted_spare) {
+    TRACE("Adopted pre-allocated segment $0 from the ring", next_segment_path_);
+    WARN_NOT_OK(allocation_pool_->SubmitClosure(
+                    Bind(&Log::RefillSegmentRingTask, Unretained(this))),
+                "Could not submit segment ring refill task");
+    return Status::OK();
+  }
+
+  RETURN_NOT_OK(CreateAndPreallocateSegmentFile(&next_segment_path_,
+                                                &next_segment_file_));
+
+  return Status::OK();
+}
+
+Status Log::CreateAndPreallocateSegmentFile(string* path,
+                                            shared_ptr<WritableFile>* out) {
   WritableFileOptions opts;
   opts.sync_on_close = force_sync_all_;
-  RETURN_NOT_OK(CreatePlaceholderSegment(opts, &next_segment_path_, &next_segment_file_));
+  RETURN_NOT_OK(CreatePlaceholderSegment(opts, path, out));
 
   MAYBE_RETURN_FAILURE(FLAGS_log_inject_io_error_on_preallocate_fraction,
                        Status::IOError("Injected IOError in Log::PreAllocateNewSegment()"));
 
   if (options_.preallocate_segments) {
-    TRACE("Preallocating $0 byte segment in $1", max_segment_size_, next_segment_path_);
+    TRACE("Preallocating $0 byte segment in $1", max_segment_size_, *path);
     RETURN_NOT_OK(env_util::VerifySufficientDiskSpace(fs_manager_->env(),
-                                                      next_segment_path_,
+                                                      *path,
                                                       max_segment_size_,
                                                       FLAGS_fs_wal_dir_reserved_bytes));
     // TODO (perf) zero the new segments -- this could result in
     // additional performance improvements.
-    RETURN_NOT_OK(next_segment_file_->PreAllocate(max_segment_size_));
+    RETURN_NOT_OK((*out)->PreAllocate(max_segment_size_));
   }
 
   return Status::OK();
 }
 
+void Log::RefillSegmentRingTask() {
+  while (true) {
+    {
+      shared_lock<RWMutex> l(allocation_lock_);
+      if (segment_ring_.size() >=
+          static_cast<size_t>(FLAGS_log_segment_preallocation_ring)) {
+        return;
+      }
+    }
+
+    string path;
+    shared_ptr<WritableFile> file;
+    Status s = CreateAndPreallocateSegmentFile(&path, &file);
+    if (PREDICT_FALSE(!s.ok())) {
+      // Not fatal: the next rollover falls back to allocating inline and
+      // will surface any persistent error.
+      WARN_NOT_OK(s, "Unable to pre-allocate spare WAL segment");
+      return;
+    }
+
+    std::lock_guard<RWMutex> l(allocation_lock_);
+    segment_ring_.emplace_back(std::move(path), std::move(file));
+  }
+}
+
 Status Log::SwitchToAllocatedSegment() {
   CHECK_EQ(allocation_state(), kAllocationFinished);
 
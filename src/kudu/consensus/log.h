@@ -18,6 +18,7 @@
 #ifndef KUDU_CONSENSUS_LOG_H_
 #define KUDU_CONSENSUS_LOG_H_
 
+#include <deque>
 #include <limits>
 #include <map>
 #include <memory>
@@ -31,8 +32,10 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/spinlock.h"
 #include "kudu/util/async_util.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/blocking_queue.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/rw_mutex.h"
 #include "kudu/util/promise.h"
 #include "kudu/util/status.h"
@@ -128,6 +131,11 @@ class Log : public RefCountedThreadSafe<Log> {
 
   // Append the given commit message, asynchronously.
   //
+  // Commit messages may be held back briefly and appended as a single
+  // combined entry batch together with other commit messages (see
+  // --log_max_batched_commits). 'callback' is invoked once the message has
+  // been written and synced as part of whichever batch it ends up in.
+  //
   // Returns a bad status if the log is already shut down.
   Status AsyncAppendCommit(gscoped_ptr<consensus::CommitMsg> commit_msg,
                            const StatusCallback& callback);
@@ -173,6 +181,11 @@ class Log : public RefCountedThreadSafe<Log> {
     sync_disabled_ = true;
   }
 
+  // Returns true if the background append thread is currently running.
+  // With --log_appender_idle_shutdown_ms set, the thread exits while the
+  // log is idle and is restarted on the next append.
+  bool append_thread_active_for_tests() const;
+
   // If we previous called DisableSync(), we should restore the
   // default behavior and then call Sync() which will perform the
   // actual syncing if required.
@@ -299,6 +312,17 @@ class Log : public RefCountedThreadSafe<Log> {
   // Preallocates the space for a new segment.
   Status PreAllocateNewSegment();
 
+  // Create a placeholder segment file and, if configured, preallocate
+  // max_segment_size_ bytes of space for it. Factored out of
+  // PreAllocateNewSegment() so that the segment ring refill task can
+  // share it.
+  Status CreateAndPreallocateSegmentFile(std::string* path,
+                                         std::shared_ptr<WritableFile>* out);
+
+  // Runs on allocation_pool_: tops up 'segment_ring_' until it holds
+  // --log_segment_preallocation_ring spare segment files.
+  void RefillSegmentRingTask();
+
   // Writes serialized contents of 'entry' to the log. Called inside
   // AppenderThread. If 'caller_owns_operation' is true, then the
   // 'operation' field of the entry will be released after the entry
@@ -320,6 +344,32 @@ class Log : public RefCountedThreadSafe<Log> {
 
   Status Sync();
 
+  // Appends any COMMIT messages accumulated in the commit buffer to the
+  // log as a single combined COMMIT entry batch. Returns true if a batch
+  // was enqueued.
+  //
+  // This method is thread-safe.
+  bool FlushPendingCommits();
+
+  // Like FlushPendingCommits(), but returns the combined batch, already
+  // serialized and ready for DoAppend(), rather than enqueueing it.
+  // Returns NULL if the commit buffer is empty. Used by the append thread,
+  // which must never block on its own full entry queue.
+  LogEntryBatch* TakePendingCommitsAsBatch();
+
+  // Returns the deadline by which the currently-buffered COMMIT messages
+  // (if any) must be flushed, or an uninitialized MonoTime if the commit
+  // buffer is empty.
+  //
+  // This method is thread-safe.
+  MonoTime commit_buffer_flush_deadline() const;
+
+  // Return the amount of time for which the append thread should keep
+  // accumulating entry batches before issuing a single Sync(), once it has
+  // at least one batch in hand. Derived from --group_commit_window_us; when
+  // that flag is -1, auto-tuned from the observed sync latency.
+  MonoDelta group_commit_window() const;
+
   // Helper method to get the segment sequence to GC based on the provided 'retention' struct.
   Status GetSegmentsToGCUnlocked(RetentionIndexes retention_indexes,
                                  SegmentSequence* segments_to_gc) const;
@@ -360,6 +410,12 @@ class Log : public RefCountedThreadSafe<Log> {
   // The path for the next allocated segment.
   std::string next_segment_path_;
 
+  // Spare placeholder segment files created and preallocated in the
+  // background when --log_segment_preallocation_ring is non-zero. A
+  // rollover adopts the front of the ring instead of waiting for file
+  // creation and preallocation. Protected by 'allocation_lock_'.
+  std::deque<std::pair<std::string, std::shared_ptr<WritableFile> > > segment_ring_;
+
   // Lock to protect mutations to log_state_ and other shared state variables.
   mutable percpu_rwlock state_lock_;
 
@@ -393,6 +449,20 @@ class Log : public RefCountedThreadSafe<Log> {
   // Reserve() and the Log Appender thread
   LogEntryBatchQueue entry_batch_queue_;
 
+  // Protects the commit buffer below.
+  mutable simple_spinlock commit_buffer_lock_;
+
+  // COMMIT messages accumulated by AsyncAppendCommit() but not yet
+  // appended as a combined entry batch. NULL when the buffer is empty.
+  gscoped_ptr<LogEntryBatchPB> commit_buffer_;
+
+  // The callbacks corresponding to the entries in 'commit_buffer_',
+  // invoked once the combined batch is written and synced.
+  std::vector<StatusCallback> commit_buffer_callbacks_;
+
+  // The deadline by which 'commit_buffer_' must be flushed.
+  MonoTime commit_buffer_flush_deadline_;
+
   // Thread writing to the log
   gscoped_ptr<AppendThread> append_thread_;
 
@@ -405,6 +475,11 @@ class Log : public RefCountedThreadSafe<Log> {
   // This is used to disable fsync during bootstrap.
   bool sync_disabled_;
 
+  // Exponentially-weighted moving average of the time taken by Sync()
+  // when it actually fsyncs, in microseconds. Used to auto-tune the
+  // group commit window (see group_commit_window()).
+  AtomicInt<int64_t> sync_latency_ewma_us_;
+
   // The status of the most recent log-allocation action.
   Promise<Status> allocation_status_;
 
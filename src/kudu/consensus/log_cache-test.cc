@@ -33,6 +33,7 @@
 
 using std::shared_ptr;
 
+DECLARE_bool(log_cache_compress_entries);
 DECLARE_int32(log_cache_size_limit_mb);
 DECLARE_int32(global_log_cache_size_limit_mb);
 
@@ -352,5 +353,41 @@ TEST_F(LogCacheTest, TestTruncation) {
   }
 }
 
+// Test that when --log_cache_compress_entries is enabled, entries are
+// compacted to compressed blobs once they have been durably appended to the
+// local log, and are transparently inflated when read back.
+TEST_F(LogCacheTest, TestCompressedEntries) {
+  FLAGS_log_cache_compress_entries = true;
+  CloseAndReopenCache(MinimumOpId());
+
+  const int kNumMessages = 10;
+  const int kPayloadSize = 128 * 1024;
+  ASSERT_OK(AppendReplicateMessagesToCache(1, kNumMessages, kPayloadSize));
+  log_->WaitUntilAllFlushed();
+  ASSERT_EQ(kNumMessages, cache_->num_cached_ops());
+
+  // The zero-filled test payloads compress extremely well, so once the ops
+  // have been written through, the cache should be using far less memory
+  // than the deserialized messages would.
+  ASSERT_LT(cache_->BytesUsed(), kNumMessages * kPayloadSize / 10);
+
+  // Reading the ops back should transparently inflate them.
+  vector<ReplicateRefPtr> messages;
+  OpId preceding;
+  ASSERT_OK(cache_->ReadOps(0, 8 * 1024 * 1024, &messages, &preceding));
+  ASSERT_EQ(kNumMessages, messages.size());
+  for (int i = 0; i < kNumMessages; i++) {
+    ASSERT_EQ(i + 1, messages[i]->get()->id().index());
+    ASSERT_EQ(kPayloadSize,
+              messages[i]->get()->noop_request().payload_for_tests().size());
+  }
+
+  // Even with a small size limit, a read should still yield at least one
+  // (inflated) message.
+  messages.clear();
+  ASSERT_OK(cache_->ReadOps(0, 100, &messages, &preceding));
+  ASSERT_EQ(1, messages.size());
+}
+
 } // namespace consensus
 } // namespace kudu
@@ -22,9 +22,12 @@
 #include <google/protobuf/wire_format_lite.h>
 #include <google/protobuf/wire_format_lite_inl.h>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <utility>
 #include <vector>
 
+#include "kudu/cfile/compression_codec.h"
 #include "kudu/consensus/log.h"
 #include "kudu/consensus/log_reader.h"
 #include "kudu/consensus/ref_counted_replicate.h"
@@ -34,6 +37,7 @@
 #include "kudu/gutil/strings/human_readable.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/debug-util.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
@@ -53,6 +57,20 @@ DEFINE_int32(global_log_cache_size_limit_mb, 1024,
              "caching log entries across all tablets is kept under this threshold.");
 TAG_FLAG(global_log_cache_size_limit_mb, advanced);
 
+DEFINE_bool(log_cache_compress_entries, false,
+            "Whether to store log cache entries as LZ4-compressed copies of their "
+            "serialized form once they have been durably written to the local log, "
+            "re-inflating them on demand when read back for a lagging follower. "
+            "A deserialized entry can occupy several times the size of its "
+            "serialized form, so compression lets the same cache memory budget "
+            "retain several times more log history at the cost of some CPU when "
+            "compressed entries are read back.");
+TAG_FLAG(log_cache_compress_entries, advanced);
+TAG_FLAG(log_cache_compress_entries, experimental);
+
+using std::shared_ptr;
+using std::unique_ptr;
+using std::vector;
 using strings::Substitute;
 
 namespace kudu {
@@ -99,7 +117,12 @@ LogCache::LogCache(const scoped_refptr<MetricEntity>& metric_entity,
   // code paths elsewhere.
   auto zero_op = new ReplicateMsg();
   *zero_op->mutable_id() = MinimumOpId();
-  InsertOrDie(&cache_, 0, make_scoped_refptr_replicate(zero_op));
+  CachedMessage zero_entry;
+  zero_entry.msg = make_scoped_refptr_replicate(zero_op);
+  zero_entry.id = zero_op->id();
+  zero_entry.uncompressed_size = 0;
+  zero_entry.mem_usage = 0;
+  InsertOrDie(&cache_, 0, zero_entry);
 }
 
 LogCache::~LogCache() {
@@ -128,9 +151,10 @@ void LogCache::TruncateOpsAfterUnlocked(int64_t index) {
 
   // Now remove the overwritten operations.
   for (int64_t i = first_to_truncate; i < next_sequential_op_index_; ++i) {
-    ReplicateRefPtr msg = EraseKeyReturnValuePtr(&cache_, i);
-    if (msg != nullptr) {
-      AccountForMessageRemovalUnlocked(msg);
+    auto iter = cache_.find(i);
+    if (iter != cache_.end()) {
+      AccountForMessageRemovalUnlocked(iter->second);
+      cache_.erase(iter);
     }
   }
   next_sequential_op_index_ = index + 1;
@@ -183,7 +207,12 @@ Status LogCache::AppendOperations(const vector<ReplicateRefPtr>& msgs,
   }
 
   for (const auto& msg : msgs) {
-    InsertOrDie(&cache_,  msg->get()->id().index(), msg);
+    CachedMessage entry;
+    entry.msg = msg;
+    entry.id = msg->get()->id();
+    entry.uncompressed_size = 0;
+    entry.mem_usage = msg->get()->SpaceUsed();
+    InsertOrDie(&cache_, entry.id.index(), entry);
   }
 
   // We drop the lock during the AsyncAppendReplicates call, since it may block
@@ -233,6 +262,78 @@ void LogCache::LogCallback(int64_t last_idx_in_batch,
     }
   }
   user_callback.Run(log_status);
+
+  // Now that the batch is durable and the caller has been acked, compact the
+  // just-written entries down to their compressed serialized form.
+  if (log_status.ok() && FLAGS_log_cache_compress_entries) {
+    CompressOpsThrough(last_idx_in_batch);
+  }
+}
+
+void LogCache::CompressOpsThrough(int64_t max_index) {
+  const cfile::CompressionCodec* codec;
+  Status s = cfile::GetCompressionCodec(cfile::LZ4, &codec);
+  if (PREDICT_FALSE(!s.ok())) {
+    KLOG_EVERY_N_SECS(WARNING, 60) << LogPrefixUnlocked()
+        << "Unable to get LZ4 codec for log cache compression: " << s.ToString();
+    return;
+  }
+
+  // Collect the deserialized entries up to 'max_index' under the lock, then
+  // do the CPU-heavy serialization and compression without holding it.
+  vector<std::pair<int64_t, ReplicateRefPtr> > to_compress;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    for (auto iter = cache_.upper_bound(0); iter != cache_.end(); ++iter) {
+      if (static_cast<int64_t>(iter->first) > max_index) {
+        break;
+      }
+      if (iter->second.msg) {
+        to_compress.push_back(std::make_pair(iter->first, iter->second.msg));
+      }
+    }
+  }
+
+  for (const auto& entry : to_compress) {
+    const ReplicateMsg& msg = *entry.second->get();
+    int64_t uncompressed_size = msg.ByteSize();
+    faststring buf;
+    buf.resize(uncompressed_size);
+    msg.SerializeWithCachedSizesToArray(buf.data());
+
+    auto compressed = std::make_shared<faststring>();
+    compressed->resize(codec->MaxCompressedLength(uncompressed_size));
+    size_t compressed_size = 0;
+    s = codec->Compress(Slice(buf), compressed->data(), &compressed_size);
+    if (PREDICT_FALSE(!s.ok())) {
+      KLOG_EVERY_N_SECS(WARNING, 60) << LogPrefixUnlocked()
+          << "Unable to compress log cache entry: " << s.ToString();
+      continue;
+    }
+    // Copy into a right-sized buffer: the worst-case buffer above may be
+    // substantially larger than the compressed data.
+    auto shrunk = std::make_shared<faststring>();
+    shrunk->assign_copy(compressed->data(), compressed_size);
+
+    std::lock_guard<simple_spinlock> l(lock_);
+    auto iter = cache_.find(entry.first);
+    if (iter == cache_.end() || iter->second.msg.get() != entry.second.get()) {
+      // The entry was truncated or replaced while we were compressing it.
+      continue;
+    }
+    CachedMessage* cached = &iter->second;
+    int64_t new_usage = shrunk->capacity();
+    if (new_usage >= cached->mem_usage) {
+      // Not worth compacting (e.g. a tiny or incompressible op).
+      continue;
+    }
+    tracker_->Release(cached->mem_usage - new_usage);
+    metrics_.log_cache_size->DecrementBy(cached->mem_usage - new_usage);
+    cached->msg.reset();
+    cached->compressed = shrunk;
+    cached->uncompressed_size = uncompressed_size;
+    cached->mem_usage = new_usage;
+  }
 }
 
 bool LogCache::HasOpBeenWritten(int64_t index) const {
@@ -256,7 +357,7 @@ Status LogCache::LookupOpId(int64_t op_index, OpId* op_id) const {
     }
     auto iter = cache_.find(op_index);
     if (iter != cache_.end()) {
-      *op_id = iter->second->get()->id();
+      *op_id = iter->second.id;
       return Status::OK();
     }
   }
@@ -266,15 +367,38 @@ Status LogCache::LookupOpId(int64_t op_index, OpId* op_id) const {
 }
 
 namespace {
+
 // Calculate the total byte size that will be used on the wire to replicate
-// this message as part of a consensus update request. This accounts for the
-// length delimiting and tagging of the message.
-int64_t TotalByteSizeForMessage(const ReplicateMsg& msg) {
-  int msg_size = google::protobuf::internal::WireFormatLite::LengthDelimitedSize(
-    msg.ByteSize());
+// a message whose serialized form is 'serialized_size' bytes, as part of a
+// consensus update request. This accounts for the length delimiting and
+// tagging of the message.
+int64_t TotalByteSizeForSerializedSize(int64_t serialized_size) {
+  int64_t msg_size = google::protobuf::internal::WireFormatLite::LengthDelimitedSize(
+    serialized_size);
   msg_size += 1; // for the type tag
   return msg_size;
 }
+
+// Same, for an already-deserialized message.
+int64_t TotalByteSizeForMessage(const ReplicateMsg& msg) {
+  return TotalByteSizeForSerializedSize(msg.ByteSize());
+}
+
+// Inflate a compressed cache entry back into a deserialized message.
+Status InflateEntry(const Slice& compressed,
+                    uint32_t uncompressed_size,
+                    ReplicateMsg* msg) {
+  const cfile::CompressionCodec* codec;
+  RETURN_NOT_OK(cfile::GetCompressionCodec(cfile::LZ4, &codec));
+  faststring buf;
+  buf.resize(uncompressed_size);
+  RETURN_NOT_OK(codec->Uncompress(compressed, buf.data(), uncompressed_size));
+  if (PREDICT_FALSE(!msg->ParseFromArray(buf.data(), uncompressed_size))) {
+    return Status::Corruption("Unable to parse compressed log cache entry");
+  }
+  return Status::OK();
+}
+
 } // anonymous namespace
 
 Status LogCache::ReadOps(int64_t after_op_index,
@@ -329,23 +453,63 @@ Status LogCache::ReadOps(int64_t after_op_index,
         }
       }
 
-    } else {
-      // Pull contiguous messages from the cache until the size limit is achieved.
+    } else if (iter->second.msg) {
+      // Pull contiguous messages from the cache until the size limit is
+      // achieved, or until we hit an entry which was compacted to its
+      // compressed form (handled on the next pass around the loop).
       for (; iter != cache_.end(); ++iter) {
-        const ReplicateRefPtr& msg = iter->second;
-        int64_t index = msg->get()->id().index();
+        const CachedMessage& entry = iter->second;
+        if (!entry.msg) {
+          break;
+        }
+        int64_t index = entry.id.index();
         if (index != next_index) {
           continue;
         }
 
-        remaining_space -= TotalByteSizeForMessage(*msg->get());
+        remaining_space -= TotalByteSizeForMessage(*entry.msg->get());
         if (remaining_space < 0 && !messages->empty()) {
           break;
         }
 
-        messages->push_back(msg);
+        messages->push_back(entry.msg);
+        next_index++;
+      }
+    } else {
+      // The entries at the head of the range were compacted to their
+      // compressed form once they were durably written to the local log.
+      // Gather the contiguous run of compressed entries that fits in the
+      // size limit, then inflate them without holding the lock.
+      vector<std::pair<shared_ptr<faststring>, uint32_t> > compressed_entries;
+      int64_t budget = remaining_space;
+      for (; iter != cache_.end() && !iter->second.msg; ++iter) {
+        if (iter->first != next_index + compressed_entries.size()) {
+          break;
+        }
+        uint32_t uncompressed_size = iter->second.uncompressed_size;
+        budget -= TotalByteSizeForSerializedSize(uncompressed_size);
+        if (budget < 0 && !(messages->empty() && compressed_entries.empty())) {
+          break;
+        }
+        compressed_entries.push_back(
+            std::make_pair(iter->second.compressed, uncompressed_size));
+      }
+      if (compressed_entries.empty()) {
+        // No room for even one more message.
+        break;
+      }
+
+      l.unlock();
+      for (const auto& entry : compressed_entries) {
+        unique_ptr<ReplicateMsg> msg(new ReplicateMsg());
+        RETURN_NOT_OK_PREPEND(
+          InflateEntry(Slice(*entry.first), entry.second, msg.get()),
+          Substitute("Failed to inflate cached op $0", next_index));
+        remaining_space -= TotalByteSizeForSerializedSize(entry.second);
+        messages->push_back(make_scoped_refptr_replicate(msg.release()));
         next_index++;
       }
+      l.lock();
     }
   }
   return Status::OK();
@@ -367,9 +531,9 @@ void LogCache::EvictSomeUnlocked(int64_t stop_after_index, int64_t bytes_to_evic
 
   int64_t bytes_evicted = 0;
   for (auto iter = cache_.begin(); iter != cache_.end();) {
-    const ReplicateRefPtr& msg = (*iter).second;
-    VLOG_WITH_PREFIX_UNLOCKED(2) << "considering for eviction: " << msg->get()->id();
-    int64_t msg_index = msg->get()->id().index();
+    const CachedMessage& entry = (*iter).second;
+    VLOG_WITH_PREFIX_UNLOCKED(2) << "considering for eviction: " << entry.id;
+    int64_t msg_index = entry.id.index();
     if (msg_index == 0) {
       // Always keep our special '0' op.
       ++iter;
@@ -380,16 +544,18 @@ void LogCache::EvictSomeUnlocked(int64_t stop_after_index, int64_t bytes_to_evic
       break;
     }
 
-    if (!msg->HasOneRef()) {
-      VLOG_WITH_PREFIX_UNLOCKED(2) << "Evicting cache: cannot remove " << msg->get()->id()
+    // A compressed entry is always evictable: any in-progress read holds its
+    // own reference to the compressed blob.
+    if (entry.msg && !entry.msg->HasOneRef()) {
+      VLOG_WITH_PREFIX_UNLOCKED(2) << "Evicting cache: cannot remove " << entry.id
                                    << " because it is in-use by a peer.";
       ++iter;
       continue;
     }
 
-    VLOG_WITH_PREFIX_UNLOCKED(2) << "Evicting cache. Removing: " << msg->get()->id();
-    AccountForMessageRemovalUnlocked(msg);
-    bytes_evicted += msg->get()->SpaceUsed();
+    VLOG_WITH_PREFIX_UNLOCKED(2) << "Evicting cache. Removing: " << entry.id;
+    bytes_evicted += entry.mem_usage;
+    AccountForMessageRemovalUnlocked(entry);
     cache_.erase(iter++);
 
     if (bytes_evicted >= bytes_to_evict) {
@@ -399,9 +565,9 @@ void LogCache::EvictSomeUnlocked(int64_t stop_after_index, int64_t bytes_to_evic
   VLOG_WITH_PREFIX_UNLOCKED(1) << "Evicting log cache: after state: " << ToStringUnlocked();
 }
 
-void LogCache::AccountForMessageRemovalUnlocked(const ReplicateRefPtr& msg) {
-  tracker_->Release(msg->get()->SpaceUsed());
-  metrics_.log_cache_size->DecrementBy(msg->get()->SpaceUsed());
+void LogCache::AccountForMessageRemovalUnlocked(const LogCache::CachedMessage& entry) {
+  tracker_->Release(entry.mem_usage);
+  metrics_.log_cache_size->DecrementBy(entry.mem_usage);
   metrics_.log_cache_num_ops->Decrement();
 }
 
@@ -451,12 +617,20 @@ void LogCache::DumpToStrings(vector<string>* lines) const {
   lines->push_back(ToStringUnlocked());
   lines->push_back("Messages:");
   for (const MessageCache::value_type& entry : cache_) {
-    const ReplicateMsg* msg = entry.second->get();
-    lines->push_back(
-      Substitute("Message[$0] $1.$2 : REPLICATE. Type: $3, Size: $4",
-                 counter++, msg->id().term(), msg->id().index(),
-                 OperationType_Name(msg->op_type()),
-                 msg->ByteSize()));
+    const CachedMessage& cached = entry.second;
+    if (cached.msg) {
+      const ReplicateMsg* msg = cached.msg->get();
+      lines->push_back(
+        Substitute("Message[$0] $1.$2 : REPLICATE. Type: $3, Size: $4",
+                   counter++, msg->id().term(), msg->id().index(),
+                   OperationType_Name(msg->op_type()),
+                   msg->ByteSize()));
+    } else {
+      lines->push_back(
+        Substitute("Message[$0] $1.$2 : REPLICATE. Compressed, Size: $3",
+                   counter++, cached.id.term(), cached.id.index(),
+                   cached.uncompressed_size));
+    }
   }
 }
 
@@ -470,12 +644,21 @@ void LogCache::DumpToHtml(std::ostream& out) const {
 
   int counter = 0;
   for (const MessageCache::value_type& entry : cache_) {
-    const ReplicateMsg* msg = entry.second->get();
-    out << Substitute("<tr><th>$0</th><th>$1.$2</th><td>REPLICATE $3</td>"
-                      "<td>$4</td><td>$5</td></tr>",
-                      counter++, msg->id().term(), msg->id().index(),
-                      OperationType_Name(msg->op_type()),
-                      msg->ByteSize(), SecureShortDebugString(msg->id())) << endl;
+    const CachedMessage& cached = entry.second;
+    if (cached.msg) {
+      const ReplicateMsg* msg = cached.msg->get();
+      out << Substitute("<tr><th>$0</th><th>$1.$2</th><td>REPLICATE $3</td>"
+                        "<td>$4</td><td>$5</td></tr>",
+                        counter++, msg->id().term(), msg->id().index(),
+                        OperationType_Name(msg->op_type()),
+                        msg->ByteSize(), SecureShortDebugString(msg->id())) << endl;
+    } else {
+      out << Substitute("<tr><th>$0</th><th>$1.$2</th><td>REPLICATE (compressed)</td>"
+                        "<td>$3</td><td>$4</td></tr>",
+                        counter++, cached.id.term(), cached.id.index(),
+                        cached.uncompressed_size,
+                        SecureShortDebugString(cached.id)) << endl;
+    }
   }
   out << "</table>";
 }
@@ -36,6 +36,7 @@ namespace kudu {
 
 class MetricEntity;
 class MemTracker;
+class faststring;
 
 namespace log {
 class Log;
@@ -149,14 +150,51 @@ class LogCache {
   FRIEND_TEST(LogCacheTest, TestTruncation);
   friend class LogCacheTest;
 
+  // A cached message, stored either in deserialized form or as a compressed
+  // copy of its serialized form.
+  //
+  // Entries are inserted deserialized. When --log_cache_compress_entries is
+  // enabled, the deserialized message is replaced by a compressed blob once
+  // the op has been durably written to the local log, and ReadOps()
+  // re-inflates such entries on demand. A deserialized ReplicateMsg can
+  // occupy several times the size of its serialized form, so this lets the
+  // same memory budget retain several times more log history for followers
+  // which have fallen behind.
+  struct CachedMessage {
+    // The deserialized message. NULL if the entry has been compressed.
+    ReplicateRefPtr msg;
+
+    // The id of the message, retained so that lookups and eviction don't
+    // need to inflate compressed entries.
+    OpId id;
+
+    // The compressed serialized form. NULL while 'msg' is set. Held by
+    // shared_ptr so that ReadOps() can inflate a copy of the blob without
+    // holding 'lock_'.
+    std::shared_ptr<faststring> compressed;
+
+    // The size of the serialized message before compression.
+    uint32_t uncompressed_size;
+
+    // The number of bytes charged against 'tracker_' for this entry.
+    int64_t mem_usage;
+  };
+
   // Try to evict the oldest operations from the queue, stopping either when
   // 'bytes_to_evict' bytes have been evicted, or the op with index
   // 'stop_after_index' has been evicted, whichever comes first.
   void EvictSomeUnlocked(int64_t stop_after_index, int64_t bytes_to_evict);
 
+  // Replace the deserialized messages of cached ops with index <=
+  // 'max_index' by compressed copies of their serialized form. Called once
+  // the ops have been durably written to the local log, at which point the
+  // deserialized messages are no longer needed locally; concurrent readers
+  // hold their own references and are unaffected.
+  void CompressOpsThrough(int64_t max_index);
+
   // Update metrics and MemTracker to account for the removal of the
   // given message.
-  void AccountForMessageRemovalUnlocked(const ReplicateRefPtr& msg);
+  void AccountForMessageRemovalUnlocked(const CachedMessage& entry);
 
   void TruncateOpsAfterUnlocked(int64_t index);
 
@@ -183,8 +221,8 @@ class LogCache {
   mutable simple_spinlock lock_;
 
   // An ordered map that serves as the buffer for the cached messages.
-  // Maps from log index -> ReplicateMsg
-  typedef std::map<uint64_t, ReplicateRefPtr> MessageCache;
+  // Maps from log index -> CachedMessage
+  typedef std::map<uint64_t, CachedMessage> MessageCache;
   MessageCache cache_;
 
   // The next log index to append. Each append operation must either
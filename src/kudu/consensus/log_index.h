@@ -17,8 +17,9 @@
 #ifndef KUDU_CONSENSUS_LOG_INDEX_H
 #define KUDU_CONSENSUS_LOG_INDEX_H
 
-#include <string>
 #include <map>
+#include <memory>
+#include <string>
 
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/gutil/macros.h"
@@ -94,13 +95,19 @@ class LogIndex : public RefCountedThreadSafe<LogIndex> {
   // The base directory where index files are located.
   const std::string base_dir_;
 
+  // Serializes mutations of 'open_chunks_' (chunk creation and GC).
+  // Lookups don't take this lock; they read an immutable snapshot of the
+  // map instead.
   simple_spinlock open_chunks_lock_;
 
   // Map from chunk index to IndexChunk. The chunk index is the log index modulo
   // the number of entries per chunk (see docs in log_index.cc).
-  // Protected by open_chunks_lock_
+  //
+  // The map pointed to is immutable: mutators build a new map and swap it
+  // in with std::atomic_store() while holding 'open_chunks_lock_'; readers
+  // take a snapshot with std::atomic_load() and never need the lock.
   typedef std::map<int64_t, scoped_refptr<IndexChunk> > ChunkMap;
-  ChunkMap open_chunks_;
+  std::shared_ptr<const ChunkMap> open_chunks_;
 
   DISALLOW_COPY_AND_ASSIGN(LogIndex);
 };
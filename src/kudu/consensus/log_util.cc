@@ -107,11 +107,14 @@ LogOptions::LogOptions()
 // LogEntryReader
 ////////////////////////////////////////////////////////////
 
+const int64_t LogEntryReader::kReadAheadSize = 1024 * 1024;
+
 LogEntryReader::LogEntryReader(ReadableLogSegment* seg)
     : seg_(seg),
       num_batches_read_(0),
       num_entries_read_(0),
-      offset_(seg_->first_entry_offset()) {
+      offset_(seg_->first_entry_offset()),
+      buf_offset_(-1) {
 
   int64_t readable_to_offset = seg_->readable_to_offset_.Load();
 
@@ -149,7 +152,7 @@ Status LogEntryReader::ReadNextEntry(LogEntryPB* entry) {
     // Read and validate the entry header first.
     Status s;
     if (offset_ + kEntryHeaderSize < read_up_to_) {
-      s = seg_->ReadEntryHeaderAndBatch(&offset_, &tmp_buf_, &current_batch);
+      s = ReadEntryHeaderAndBatch(&current_batch);
     } else {
       s = Status::Corruption(Substitute("Truncated log entry at offset $0", offset_));
     }
@@ -185,6 +188,81 @@ Status LogEntryReader::ReadNextEntry(LogEntryPB* entry) {
   return Status::OK();
 }
 
+Status LogEntryReader::ReadEntryHeaderAndBatch(gscoped_ptr<LogEntryBatchPB>* batch) {
+  // Decode the entry header out of the readahead buffer.
+  RETURN_NOT_OK(EnsureBuffered(offset_, kEntryHeaderSize));
+  ReadableLogSegment::EntryHeader header;
+  if (PREDICT_FALSE(!seg_->DecodeEntryHeader(
+          Slice(tmp_buf_.data() + (offset_ - buf_offset_), kEntryHeaderSize), &header))) {
+    return Status::Corruption("CRC mismatch in log entry header");
+  }
+
+  if (header.msg_length == 0) {
+    return Status::Corruption("Invalid 0 entry length");
+  }
+  int64_t batch_offset = offset_ + kEntryHeaderSize;
+  int64_t limit = seg_->readable_up_to();
+  if (PREDICT_FALSE(header.msg_length + batch_offset > limit)) {
+    // The log was likely truncated during writing.
+    return Status::Corruption(
+        Substitute("Could not read $0-byte log entry from offset $1 in $2: "
+                   "log only readable up to offset $3",
+                   header.msg_length, batch_offset, seg_->path_, limit));
+  }
+
+  // Buffering the batch may refill 'tmp_buf_', so compute the data pointer
+  // only afterwards.
+  RETURN_NOT_OK(EnsureBuffered(batch_offset, header.msg_length));
+  const uint8_t* batch_data = tmp_buf_.data() + (batch_offset - buf_offset_);
+
+  // Verify the CRC.
+  uint32_t read_crc = crc::Crc32c(batch_data, header.msg_length);
+  if (PREDICT_FALSE(read_crc != header.msg_crc)) {
+    return Status::Corruption(Substitute("Entry CRC mismatch in byte range $0-$1: "
+                                         "expected CRC=$2, computed=$3",
+                                         batch_offset, batch_offset + header.msg_length,
+                                         header.msg_crc, read_crc));
+  }
+
+  gscoped_ptr<LogEntryBatchPB> read_entry_batch(new LogEntryBatchPB());
+  Status s = pb_util::ParseFromArray(read_entry_batch.get(), batch_data, header.msg_length);
+  if (PREDICT_FALSE(!s.ok())) {
+    return Status::Corruption(Substitute("Could parse PB. Cause: $0", s.ToString()));
+  }
+
+  offset_ = batch_offset + header.msg_length;
+  batch->reset(read_entry_batch.release());
+  return Status::OK();
+}
+
+Status LogEntryReader::EnsureBuffered(int64_t offset, int64_t len) {
+  if (offset >= buf_offset_ &&
+      offset + len <= buf_offset_ + static_cast<int64_t>(tmp_buf_.size())) {
+    return Status::OK();
+  }
+
+  // Read ahead as far as the segment is readable, but always at least the
+  // requested range.
+  int64_t read_len = std::min<int64_t>(std::max(len, kReadAheadSize),
+                                       seg_->readable_up_to() - offset);
+  if (PREDICT_FALSE(read_len < len)) {
+    return Status::Corruption(Substitute("Truncated log entry at offset $0", offset));
+  }
+
+  tmp_buf_.resize(read_len);
+  Slice read_slice;
+  RETURN_NOT_OK_PREPEND(ReadFully(seg_->readable_file().get(), offset, read_len,
+                                  &read_slice, tmp_buf_.data()),
+                        "Unable to read ahead in log segment");
+  if (PREDICT_FALSE(read_slice.data() != tmp_buf_.data())) {
+    // The file implementation may return a slice that doesn't point into the
+    // provided scratch space; normalize so that 'tmp_buf_' holds the data.
+    memcpy(tmp_buf_.data(), read_slice.data(), read_slice.size());
+  }
+  buf_offset_ = offset;
+  return Status::OK();
+}
+
 Status LogEntryReader::HandleReadError(const Status& s) const {
   if (!s.IsCorruption()) {
     // IO errors should always propagate back
@@ -551,6 +629,12 @@ Status ReadableLogSegment::ParseFooterMagicAndFooterLength(const Slice &data,
 Status ReadableLogSegment::ReadEntries(vector<LogEntryPB*>* entries) {
   TRACE_EVENT1("log", "ReadableLogSegment::ReadEntries",
                "path", path_);
+
+  // Entries are replayed in a single sequential pass over the segment, so
+  // ask the OS to read ahead aggressively.
+  WARN_NOT_OK(readable_file()->HintAccessPattern(0, 0, ACCESS_PATTERN_SEQUENTIAL),
+              "Unable to hint sequential access pattern");
+
   LogEntryReader reader(this);
 
   while (true) {
@@ -106,6 +106,18 @@ class LogEntryReader {
  private:
   friend class ReadableLogSegment;
 
+  // Read the entry header and batch starting at 'offset_' out of the
+  // readahead buffer, refilling the buffer from the file as necessary,
+  // and advance 'offset_' past the batch on success.
+  Status ReadEntryHeaderAndBatch(gscoped_ptr<LogEntryBatchPB>* batch);
+
+  // Ensure that 'tmp_buf_' contains at least the byte range
+  // [offset, offset + len) of the segment. When a read is needed, up to
+  // 'kReadAheadSize' bytes are fetched in one go so that subsequent
+  // batches are served from memory rather than with a pair of preads
+  // per batch.
+  Status EnsureBuffered(int64_t offset, int64_t len);
+
   // Handle an error reading an entry.
   Status HandleReadError(const Status& s) const;
 
@@ -140,9 +152,17 @@ class LogEntryReader {
   // The offset at which this reader will stop reading entries.
   int64_t read_up_to_;
 
-  // Temporary buffer used for deserialization.
+  // Readahead buffer holding raw segment bytes starting at file offset
+  // 'buf_offset_'.
   faststring tmp_buf_;
 
+  // The file offset of the first byte in 'tmp_buf_', or -1 if the buffer
+  // is empty.
+  int64_t buf_offset_;
+
+  // The number of bytes to read ahead when refilling 'tmp_buf_'.
+  static const int64_t kReadAheadSize;
+
   DISALLOW_COPY_AND_ASSIGN(LogEntryReader);
 };
 
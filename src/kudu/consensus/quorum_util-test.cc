@@ -57,6 +57,30 @@ TEST(QuorumUtilTest, TestMemberExtraction) {
   ASSERT_EQ("B", peer_pb.permanent_uuid());
 }
 
+TEST(QuorumUtilTest, TestWitnessPeers) {
+  RaftConfigPB config;
+  config.set_opid_index(1);
+  SetPeerInfo("A", RaftPeerPB::VOTER, config.add_peers());
+  SetPeerInfo("B", RaftPeerPB::VOTER, config.add_peers());
+  SetPeerInfo("W", RaftPeerPB::VOTER, config.add_peers());
+  config.mutable_peers(2)->set_witness(true);
+
+  ASSERT_FALSE(IsRaftConfigWitness("A", config));
+  ASSERT_TRUE(IsRaftConfigWitness("W", config));
+  ASSERT_FALSE(IsRaftConfigWitness("invalid", config));
+
+  // A witness still counts toward the voter quorum.
+  ASSERT_EQ(3, CountVoters(config));
+  ASSERT_OK(VerifyRaftConfig(config, COMMITTED_QUORUM));
+
+  // A config in which every voter is a witness has no electable leader and
+  // must be rejected.
+  config.mutable_peers(0)->set_witness(true);
+  config.mutable_peers(1)->set_witness(true);
+  Status s = VerifyRaftConfig(config, COMMITTED_QUORUM);
+  ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+}
+
 TEST(QuorumUtilTest, TestDiffConsensusStates) {
   ConsensusStatePB old_cs;
   SetPeerInfo("A", RaftPeerPB::VOTER, old_cs.mutable_config()->add_peers());
@@ -55,6 +55,15 @@ bool IsRaftConfigVoter(const std::string& uuid, const RaftConfigPB& config) {
   return false;
 }
 
+bool IsRaftConfigWitness(const std::string& uuid, const RaftConfigPB& config) {
+  for (const RaftPeerPB& peer : config.peers()) {
+    if (peer.permanent_uuid() == uuid) {
+      return peer.witness();
+    }
+  }
+  return false;
+}
+
 Status GetRaftConfigMember(const RaftConfigPB& config,
                            const std::string& uuid,
                            RaftPeerPB* peer_pb) {
@@ -169,6 +178,25 @@ Status VerifyRaftConfig(const RaftConfigPB& config, RaftConfigState type) {
               "Peer: $0 is a NON_VOTER, but this isn't supported yet. RaftConfig: $1",
               peer.permanent_uuid(), SecureShortDebugString(config)));
     }
+    if (peer.witness() && peer.member_type() != RaftPeerPB::VOTER) {
+      return Status::IllegalState(
+          Substitute("Peer: $0 is a witness but not a VOTER. RaftConfig: $1",
+                     peer.permanent_uuid(), SecureShortDebugString(config)));
+    }
+  }
+
+  // At least one voter must be eligible to become leader.
+  bool has_electable_voter = false;
+  for (const RaftPeerPB& peer : config.peers()) {
+    if (peer.member_type() == RaftPeerPB::VOTER && !peer.witness()) {
+      has_electable_voter = true;
+      break;
+    }
+  }
+  if (!has_electable_voter) {
+    return Status::IllegalState(
+        Substitute("RaftConfig must have at least one non-witness voter. RaftConfig: $0",
+                   SecureShortDebugString(config)));
   }
 
   return Status::OK();
@@ -35,6 +35,11 @@ enum RaftConfigState {
 bool IsRaftConfigMember(const std::string& uuid, const RaftConfigPB& config);
 bool IsRaftConfigVoter(const std::string& uuid, const RaftConfigPB& config);
 
+// Returns true if the peer with the given uuid is a witness in the config:
+// a voter which participates in elections and acknowledgment but must never
+// become leader.
+bool IsRaftConfigWitness(const std::string& uuid, const RaftConfigPB& config);
+
 // Get the specified member of the config.
 // Returns Status::NotFound if a member with the specified uuid could not be
 // found in the config.
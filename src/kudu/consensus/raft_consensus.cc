@@ -408,6 +408,15 @@ Status RaftConsensus::StartElection(ElectionMode mode, ElectionReason reason) {
                                   "a non-participant in the raft config",
                                   SecureShortDebugString(state_->GetActiveConfigUnlocked()));
     }
+    if (PREDICT_FALSE(IsRaftConfigWitness(state_->GetPeerUuid(),
+                                          state_->GetActiveConfigUnlocked()))) {
+      // Witnesses vote and acknowledge log entries but must never become
+      // leader, so they never start elections.
+      SnoozeFailureDetectorUnlocked();
+      return Status::IllegalState("Not starting election: Node is a witness "
+                                  "in the raft config",
+                                  SecureShortDebugString(state_->GetActiveConfigUnlocked()));
+    }
     LOG_WITH_PREFIX_UNLOCKED(INFO)
         << "Starting " << mode_str
         << " (" << ReasonString(reason, state_->GetLeaderUuidUnlocked()) << ")";
@@ -1238,10 +1247,11 @@ Status RaftConsensus::UpdateReplica(const ConsensusRequestPB* request,
     }
 
     // All transactions that are going to be prepared were started, advance the safe timestamp.
-    // TODO(dralves) This is only correct because the queue only sets safe time when the request is
-    // an empty heartbeat. If we actually start setting this on a consensus request along with
-    // actual messages we need to be careful to ignore it if any of the messages fails to prepare.
-    if (request->has_safe_timestamp()) {
+    // When the safe timestamp is sent along with actual messages (which a leader holding a
+    // leader lease does), it is only valid if every one of them prepared successfully: a
+    // message that failed to prepare will be retried by the leader and may carry a timestamp
+    // below the request's safe time.
+    if (request->has_safe_timestamp() && PREDICT_TRUE(prepare_status.ok())) {
       time_manager_->AdvanceSafeTime(Timestamp(request->safe_timestamp()));
     }
 
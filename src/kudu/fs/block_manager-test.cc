@@ -1018,6 +1018,111 @@ TEST_F(LogBlockManagerTest, TestMetadataTruncation) {
                                      false));
 }
 
+// Test that the holes left by deleted blocks are punched out on the data
+// directory's thread pool, and that a burst of deletions actually frees the
+// blocks' disk space.
+TEST_F(LogBlockManagerTest, TestDeferredHolePunching) {
+  RETURN_NOT_LOG_BLOCK_MANAGER();
+
+  // Disable preallocation so that the data file's size on disk reflects
+  // only the blocks written to it.
+  FLAGS_log_container_preallocate_bytes = 0;
+
+  // Create a handful of adjacent blocks, each large enough to span at least
+  // one filesystem block.
+  string data(64 * 1024, 'x');
+  vector<BlockId> created_blocks;
+  for (int i = 0; i < 8; i++) {
+    gscoped_ptr<WritableBlock> writer;
+    ASSERT_OK(bm_->CreateBlock(&writer));
+    created_blocks.push_back(writer->id());
+    ASSERT_OK(writer->Append(data));
+    ASSERT_OK(writer->Close());
+  }
+  ASSERT_EQ(1, bm_->all_containers_.size());
+
+  string data_file;
+  NO_FATALS(GetOnlyContainerDataFile(&data_file));
+  uint64_t pre_delete_size;
+  ASSERT_OK(env_->GetFileSizeOnDisk(data_file, &pre_delete_size));
+  ASSERT_GE(pre_delete_size, data.size() * created_blocks.size());
+
+  // Delete all of the blocks, then wait for the deferred hole punching to
+  // finish. The deletions are adjacent, so they should coalesce into a
+  // small number of hole punches.
+  for (const BlockId& block_id : created_blocks) {
+    ASSERT_OK(bm_->DeleteBlock(block_id));
+  }
+  for (const auto& dd : bm_->dd_manager_.data_dirs()) {
+    dd->WaitOnClosures();
+  }
+
+  uint64_t post_delete_size;
+  ASSERT_OK(env_->GetFileSizeOnDisk(data_file, &post_delete_size));
+  ASSERT_LT(post_delete_size, pre_delete_size);
+}
+
+// Test that a container whose metadata is mostly dead records is compacted
+// when the block manager is restarted, and that the compacted metadata still
+// describes all of the live blocks.
+TEST_F(LogBlockManagerTest, TestStartupMetadataCompaction) {
+  RETURN_NOT_LOG_BLOCK_MANAGER();
+
+  // Create several blocks in one container.
+  vector<BlockId> created_blocks;
+  for (int i = 0; i < 10; i++) {
+    gscoped_ptr<WritableBlock> writer;
+    ASSERT_OK(bm_->CreateBlock(&writer));
+    created_blocks.push_back(writer->id());
+    ASSERT_OK(writer->Append("hello world"));
+    ASSERT_OK(writer->Close());
+  }
+  ASSERT_EQ(1, bm_->all_containers_.size());
+
+  // Delete all but the last block, dropping the container's ratio of live
+  // block records well below the compaction threshold. The last block is
+  // also the container's high-water mark, so after compaction the metadata
+  // should consist of just its CREATE record.
+  for (int i = 0; i < 9; i++) {
+    ASSERT_OK(bm_->DeleteBlock(created_blocks[i]));
+  }
+  ASSERT_EQ(1, bm_->CountBlocksForTests());
+
+  string path = LogBlockManager::ContainerPathForTests(bm_->all_containers_.front());
+  string metadata_path = path + LogBlockManager::kContainerMetadataFileSuffix;
+  uint64_t pre_compaction_size;
+  ASSERT_OK(env_->GetFileSize(metadata_path, &pre_compaction_size));
+
+  // Restarting the block manager should compact the metadata file.
+  ASSERT_OK(this->ReopenBlockManager(scoped_refptr<MetricEntity>(),
+                                     shared_ptr<MemTracker>(),
+                                     { this->test_dir_ },
+                                     false));
+  uint64_t post_compaction_size;
+  ASSERT_OK(env_->GetFileSize(metadata_path, &post_compaction_size));
+  ASSERT_LT(post_compaction_size, pre_compaction_size);
+
+  // The surviving block is still readable.
+  ASSERT_EQ(1, bm_->CountBlocksForTests());
+  gscoped_ptr<ReadableBlock> block;
+  ASSERT_OK(bm_->OpenBlock(created_blocks.back(), &block));
+  uint64_t size;
+  ASSERT_OK(block->Size(&size));
+  ASSERT_EQ(strlen("hello world"), size);
+  ASSERT_OK(block->Close());
+
+  // The compacted metadata file must also replay cleanly on a subsequent
+  // restart, and (being above the live ratio threshold) isn't rewritten.
+  ASSERT_OK(this->ReopenBlockManager(scoped_refptr<MetricEntity>(),
+                                     shared_ptr<MemTracker>(),
+                                     { this->test_dir_ },
+                                     false));
+  ASSERT_EQ(1, bm_->CountBlocksForTests());
+  uint64_t size_after_reopen;
+  ASSERT_OK(env_->GetFileSize(metadata_path, &size_after_reopen));
+  ASSERT_EQ(post_compaction_size, size_after_reopen);
+}
+
 // Regression test for a crash when a container's append offset exceeded its
 // preallocation offset.
 TEST_F(LogBlockManagerTest, TestAppendExceedsPreallocation) {
@@ -43,6 +43,14 @@ DEFINE_int64(block_manager_max_open_files, -1,
 TAG_FLAG(block_manager_max_open_files, advanced);
 TAG_FLAG(block_manager_max_open_files, evolving);
 
+DEFINE_int64(block_manager_reserved_open_files, -1,
+             "Number of open file descriptors to reserve for use outside the "
+             "data block file cache (e.g. sockets, WAL segments, and metadata "
+             "files) when block_manager_max_open_files is -1. If -1, half of "
+             "the process' resource limit as per getrlimit() is reserved.");
+TAG_FLAG(block_manager_reserved_open_files, advanced);
+TAG_FLAG(block_manager_reserved_open_files, evolving);
+
 using strings::Substitute;
 
 namespace kudu {
@@ -64,7 +72,21 @@ int64_t GetFileCacheCapacityForBlockManager(Env* env) {
 
   // See block_manager_max_open_files.
   if (FLAGS_block_manager_max_open_files == -1) {
-    return env->GetOpenFileLimit() / 2;
+    // Auto-size the cache from the process' open file limit, leaving some
+    // descriptors free for everything else (sockets, WAL segments, metadata
+    // files, etc.).
+    int64_t file_limit = env->GetOpenFileLimit();
+    int64_t reserved = FLAGS_block_manager_reserved_open_files;
+    if (reserved == -1) {
+      reserved = file_limit / 2;
+    }
+    LOG_IF(FATAL, reserved >= file_limit) <<
+        Substitute(
+            "Configured reserved open files "
+            "(block_manager_reserved_open_files) $0 must be less than the "
+            "process fd limit (ulimit) $1",
+            reserved, file_limit);
+    return file_limit - reserved;
   }
   if (FLAGS_block_manager_max_open_files == 0) {
     return kint64max;
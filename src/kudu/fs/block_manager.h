@@ -29,6 +29,7 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/env.h"
 #include "kudu/util/status.h"
 
 DECLARE_bool(block_coalesce_close);
@@ -153,6 +154,16 @@ class ReadableBlock : public Block {
   virtual Status Read(uint64_t offset, size_t length,
                       Slice* result, uint8_t* scratch) const = 0;
 
+  // Hints that the given byte range of the block will soon be read, so
+  // that the OS may begin readahead in the background. Best-effort; a
+  // subsequent Read() of the range is always required.
+  virtual Status Prefetch(uint64_t offset, size_t length) const = 0;
+
+  // Hints to the OS how the block's data will be accessed. When multiple
+  // blocks share an underlying file, the hint is scoped to this block's
+  // byte range. Best-effort; see FileAccessPatternHint.
+  virtual Status HintAccessPattern(FileAccessPatternHint hint) const = 0;
+
   // Returns the memory usage of this object including the object itself.
   virtual size_t memory_footprint() const = 0;
 };
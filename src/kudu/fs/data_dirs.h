@@ -29,6 +29,7 @@
 #include "kudu/util/atomic.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/semaphore.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
@@ -85,6 +86,13 @@ class DataDir {
   };
   Status RefreshIsFull(RefreshMode mode);
 
+  // Accounts the beginning and end of a block read issued against this
+  // directory. If the configured cap on concurrent reads (see
+  // --fs_data_dirs_max_concurrent_reads) has been reached, BeginRead()
+  // blocks until an in-flight read completes. No-ops if the cap is disabled.
+  void BeginRead();
+  void EndRead();
+
   const std::string& dir() const { return dir_; }
 
   const PathInstanceMetadataFile* instance() const {
@@ -105,6 +113,10 @@ class DataDir {
 
   bool is_shutdown_;
 
+  // Bounds the number of concurrent block reads against this directory.
+  // NULL if --fs_data_dirs_max_concurrent_reads is disabled.
+  const std::unique_ptr<Semaphore> read_semaphore_;
+
   // Protects 'last_check_is_full_' and 'is_full_'.
   mutable simple_spinlock lock_;
   MonoTime last_check_is_full_;
@@ -113,6 +125,30 @@ class DataDir {
   DISALLOW_COPY_AND_ASSIGN(DataDir);
 };
 
+// Scoped helper which accounts a block read against a data directory's
+// concurrent read cap for as long as it is in scope. A NULL directory is a
+// no-op, for callers which cannot resolve the directory their block lives in.
+class ScopedDataDirRead {
+ public:
+  explicit ScopedDataDirRead(DataDir* dir)
+      : dir_(dir) {
+    if (dir_) {
+      dir_->BeginRead();
+    }
+  }
+
+  ~ScopedDataDirRead() {
+    if (dir_) {
+      dir_->EndRead();
+    }
+  }
+
+ private:
+  DataDir* const dir_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedDataDirRead);
+};
+
 // Encapsulates knowledge of data directory management on behalf of block
 // managers.
 class DataDirManager {
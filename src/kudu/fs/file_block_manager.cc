@@ -369,7 +369,7 @@ Status FileWritableBlock::Close(SyncMode mode) {
 class FileReadableBlock : public ReadableBlock {
  public:
   FileReadableBlock(const FileBlockManager* block_manager, BlockId block_id,
-                    shared_ptr<RandomAccessFile> reader);
+                    DataDir* data_dir, shared_ptr<RandomAccessFile> reader);
 
   virtual ~FileReadableBlock();
 
@@ -382,6 +382,10 @@ class FileReadableBlock : public ReadableBlock {
   virtual Status Read(uint64_t offset, size_t length,
                       Slice* result, uint8_t* scratch) const OVERRIDE;
 
+  virtual Status Prefetch(uint64_t offset, size_t length) const OVERRIDE;
+
+  virtual Status HintAccessPattern(FileAccessPatternHint hint) const OVERRIDE;
+
   virtual size_t memory_footprint() const OVERRIDE;
 
  private:
@@ -391,6 +395,10 @@ class FileReadableBlock : public ReadableBlock {
   // The block's identifier.
   const BlockId block_id_;
 
+  // The data directory the block lives in. Used to account reads against
+  // the directory's concurrent read cap.
+  DataDir* const data_dir_;
+
   // The underlying opened file backing this block.
   shared_ptr<RandomAccessFile> reader_;
 
@@ -403,9 +411,11 @@ class FileReadableBlock : public ReadableBlock {
 
 FileReadableBlock::FileReadableBlock(const FileBlockManager* block_manager,
                                      BlockId block_id,
+                                     DataDir* data_dir,
                                      shared_ptr<RandomAccessFile> reader)
     : block_manager_(block_manager),
       block_id_(block_id),
+      data_dir_(data_dir),
       reader_(std::move(reader)),
       closed_(false) {
   if (block_manager_->metrics_) {
@@ -444,6 +454,7 @@ Status FileReadableBlock::Read(uint64_t offset, size_t length,
                                Slice* result, uint8_t* scratch) const {
   DCHECK(!closed_.Load());
 
+  ScopedDataDirRead read_slot(data_dir_);
   RETURN_NOT_OK(env_util::ReadFully(reader_.get(), offset, length, result, scratch));
   if (block_manager_->metrics_) {
     block_manager_->metrics_->total_bytes_read->IncrementBy(length);
@@ -452,6 +463,19 @@ Status FileReadableBlock::Read(uint64_t offset, size_t length,
   return Status::OK();
 }
 
+Status FileReadableBlock::Prefetch(uint64_t offset, size_t length) const {
+  DCHECK(!closed_.Load());
+
+  return reader_->Prefetch(offset, length);
+}
+
+Status FileReadableBlock::HintAccessPattern(FileAccessPatternHint hint) const {
+  DCHECK(!closed_.Load());
+
+  // The file backs only this block, so hint the entire file.
+  return reader_->HintAccessPattern(0, 0, hint);
+}
+
 size_t FileReadableBlock::memory_footprint() const {
   DCHECK(reader_);
   return kudu_malloc_usable_size(this) + reader_->memory_footprint();
@@ -627,7 +651,9 @@ Status FileBlockManager::OpenBlock(const BlockId& block_id,
   } else {
     RETURN_NOT_OK(env_util::OpenFileForRandom(env_, path, &reader));
   }
-  block->reset(new internal::FileReadableBlock(this, block_id, reader));
+  DataDir* dir = dd_manager_.FindDataDirByUuidIndex(
+      internal::FileBlockLocation::GetDataDirIdx(block_id));
+  block->reset(new internal::FileReadableBlock(this, block_id, dir, reader));
   return Status::OK();
 }
 
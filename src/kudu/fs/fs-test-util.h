@@ -66,6 +66,14 @@ class CountingReadableBlock : public ReadableBlock {
     return Status::OK();
   }
 
+  virtual Status Prefetch(uint64_t offset, size_t length) const OVERRIDE {
+    return block_->Prefetch(offset, length);
+  }
+
+  virtual Status HintAccessPattern(FileAccessPatternHint hint) const OVERRIDE {
+    return block_->HintAccessPattern(hint);
+  }
+
   virtual size_t memory_footprint() const OVERRIDE {
     return block_->memory_footprint();
   }
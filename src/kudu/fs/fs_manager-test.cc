@@ -61,6 +61,10 @@ class FsManagerTestBase : public KuduTest {
     FsManagerOpts opts;
     opts.wal_path = wal_path;
     opts.data_paths = data_paths;
+    ReinitFsManager(opts);
+  }
+
+  void ReinitFsManager(const FsManagerOpts& opts) {
     fs_manager_.reset(new FsManager(env_, opts));
   }
 
@@ -114,6 +118,38 @@ TEST_F(FsManagerTestBase, TestMultiplePaths) {
   ASSERT_OK(fs_manager()->Open());
 }
 
+TEST_F(FsManagerTestBase, TestFastWalDirPlacement) {
+  string wal_path = GetTestPath("wal");
+  string fast_wal_path = GetTestPath("fast-wal");
+  FsManagerOpts opts;
+  opts.wal_path = wal_path;
+  opts.fast_wal_path = fast_wal_path;
+  opts.data_paths = { GetTestPath("data") };
+  ReinitFsManager(opts);
+  ASSERT_OK(fs_manager()->CreateInitialFileSystemLayout());
+  ASSERT_OK(fs_manager()->Open());
+  ASSERT_TRUE(fs_manager()->has_fast_wal_root());
+
+  // A tablet with no WAL directory anywhere resolves to the default root.
+  const string kTabletA = "tablet-a";
+  const string kTabletB = "tablet-b";
+  ASSERT_STR_CONTAINS(fs_manager()->GetTabletWalDir(kTabletA),
+                      fs_manager()->GetWalsRootDir());
+
+  // A tablet placed on fast storage resolves to the fast root, and its
+  // recovery directory follows it there.
+  ASSERT_OK(fs_manager()->PlaceTabletWalOnFastStorage(kTabletB));
+  ASSERT_STR_CONTAINS(fs_manager()->GetTabletWalDir(kTabletB),
+                      fs_manager()->GetFastWalsRootDir());
+  ASSERT_STR_CONTAINS(fs_manager()->GetTabletWalRecoveryDir(kTabletB),
+                      fs_manager()->GetFastWalsRootDir());
+
+  // A tablet which already has a WAL under the default root can't be placed.
+  ASSERT_OK(env_->CreateDir(fs_manager()->GetTabletWalDir(kTabletA)));
+  Status s = fs_manager()->PlaceTabletWalOnFastStorage(kTabletA);
+  ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+}
+
 TEST_F(FsManagerTestBase, TestMatchingPathsWithMismatchedSlashes) {
   string wal_path = GetTestPath("foo");
   vector<string> data_paths = { wal_path + "/" };
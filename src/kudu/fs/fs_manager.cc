@@ -67,6 +67,13 @@ DEFINE_string(fs_wal_dir, "",
               "Directory with write-ahead logs. If this is not specified, the "
               "program will not start. May be the same as fs_data_dirs");
 TAG_FLAG(fs_wal_dir, stable);
+DEFINE_string(fs_wal_fast_dir, "",
+              "Optional directory on fast storage (e.g. NVMe) holding the "
+              "write-ahead logs of tablets explicitly placed there. If empty, "
+              "all write-ahead logs are stored under fs_wal_dir. Must be "
+              "configured when the filesystem layout is first created.");
+TAG_FLAG(fs_wal_fast_dir, advanced);
+TAG_FLAG(fs_wal_fast_dir, experimental);
 DEFINE_string(fs_data_dirs, "",
               "Comma-separated list of directories with data blocks. If this "
               "is not specified, fs_wal_dir will be used as the sole data "
@@ -104,6 +111,7 @@ const char *FsManager::kConsensusMetadataDirName = "consensus-meta";
 
 FsManagerOpts::FsManagerOpts()
   : wal_path(FLAGS_fs_wal_dir),
+    fast_wal_path(FLAGS_fs_wal_fast_dir),
     read_only(false) {
   data_paths = strings::Split(FLAGS_fs_data_dirs, ",", strings::SkipEmpty());
 }
@@ -125,6 +133,7 @@ FsManager::FsManager(Env* env,
   : env_(DCHECK_NOTNULL(env)),
     read_only_(opts.read_only),
     wal_fs_root_(opts.wal_path),
+    fast_wal_fs_root_(opts.fast_wal_path),
     data_fs_roots_(opts.data_paths),
     metric_entity_(opts.metric_entity),
     parent_mem_tracker_(opts.parent_mem_tracker),
@@ -147,6 +156,9 @@ Status FsManager::Init() {
   // Deduplicate all of the roots.
   set<string> all_roots;
   all_roots.insert(wal_fs_root_);
+  if (!fast_wal_fs_root_.empty()) {
+    all_roots.insert(fast_wal_fs_root_);
+  }
   for (const string& data_fs_root : data_fs_roots_) {
     all_roots.insert(data_fs_root);
   }
@@ -182,6 +194,9 @@ Status FsManager::Init() {
 
   // All done, use the map to set the canonicalized state.
   canonicalized_wal_fs_root_ = FindOrDie(canonicalized_roots, wal_fs_root_);
+  if (!fast_wal_fs_root_.empty()) {
+    canonicalized_fast_wal_fs_root_ = FindOrDie(canonicalized_roots, fast_wal_fs_root_);
+  }
   if (!data_fs_roots_.empty()) {
     canonicalized_metadata_fs_root_ = FindOrDie(canonicalized_roots, data_fs_roots_[0]);
     for (const string& data_fs_root : data_fs_roots_) {
@@ -300,6 +315,9 @@ Status FsManager::CreateInitialFileSystemLayout(boost::optional<string> uuid) {
   vector<string> ancillary_dirs = { GetWalsRootDir(),
                                     GetTabletMetadataDir(),
                                     GetConsensusMetadataDir() };
+  if (has_fast_wal_root()) {
+    ancillary_dirs.push_back(GetFastWalsRootDir());
+  }
   for (const string& dir : ancillary_dirs) {
     bool created;
     RETURN_NOT_OK_PREPEND(CreateDirIfMissing(dir, &created),
@@ -444,12 +462,41 @@ string FsManager::GetInstanceMetadataPath(const string& root) const {
   return JoinPathSegments(root, kInstanceMetadataFileName);
 }
 
+string FsManager::GetTabletWalDir(const string& tablet_id) const {
+  DCHECK(initted_);
+  if (has_fast_wal_root()) {
+    // Placement is self-describing: the tablet's WAL lives on the fast root
+    // iff its WAL directory exists there. The recovery directory is also
+    // checked since bootstrap renames the WAL directory aside before
+    // replaying it.
+    string fast_dir = JoinPathSegments(GetFastWalsRootDir(), tablet_id);
+    if (env_->FileExists(fast_dir) ||
+        env_->FileExists(fast_dir + kWalsRecoveryDirSuffix)) {
+      return fast_dir;
+    }
+  }
+  return JoinPathSegments(GetWalsRootDir(), tablet_id);
+}
+
 string FsManager::GetTabletWalRecoveryDir(const string& tablet_id) const {
-  string path = JoinPathSegments(GetWalsRootDir(), tablet_id);
+  string path = GetTabletWalDir(tablet_id);
   StrAppend(&path, kWalsRecoveryDirSuffix);
   return path;
 }
 
+Status FsManager::PlaceTabletWalOnFastStorage(const string& tablet_id) {
+  CHECK(!read_only_);
+  if (!has_fast_wal_root()) {
+    return Status::IllegalState("No fast WAL directory (fs_wal_fast_dir) configured");
+  }
+  string default_dir = JoinPathSegments(GetWalsRootDir(), tablet_id);
+  if (env_->FileExists(default_dir)) {
+    return Status::IllegalState(
+        Substitute("Tablet $0 already has a WAL under the default WAL root", tablet_id));
+  }
+  return CreateDirIfMissing(JoinPathSegments(GetFastWalsRootDir(), tablet_id));
+}
+
 string FsManager::GetWalSegmentFileName(const string& tablet_id,
                                         uint64_t sequence_number) const {
   return JoinPathSegments(GetTabletWalDir(tablet_id),
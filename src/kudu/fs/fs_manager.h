@@ -75,6 +75,11 @@ struct FsManagerOpts {
   // The path where WALs will be stored. Cannot be empty.
   std::string wal_path;
 
+  // Optional path on fast storage (e.g. NVMe) holding the WALs of tablets
+  // explicitly placed there. May be empty, in which case all WALs are
+  // stored under 'wal_path'.
+  std::string fast_wal_path;
+
   // The paths where data blocks will be stored. Cannot be empty.
   std::vector<std::string> data_paths;
 
@@ -148,12 +153,32 @@ class FsManager {
     return JoinPathSegments(canonicalized_wal_fs_root_, kWalDirName);
   }
 
-  std::string GetTabletWalDir(const std::string& tablet_id) const {
-    return JoinPathSegments(GetWalsRootDir(), tablet_id);
+  // Returns true if an additional WAL root on fast storage was configured
+  // (see --fs_wal_fast_dir).
+  bool has_fast_wal_root() const {
+    return !canonicalized_fast_wal_fs_root_.empty();
+  }
+
+  std::string GetFastWalsRootDir() const {
+    DCHECK(initted_);
+    DCHECK(has_fast_wal_root());
+    return JoinPathSegments(canonicalized_fast_wal_fs_root_, kWalDirName);
   }
 
+  // Returns the directory holding the given tablet's WAL segments. Placement
+  // is self-describing: the tablet's WAL lives on the fast WAL root iff its
+  // directory exists there (see PlaceTabletWalOnFastStorage()); otherwise it
+  // lives under the default WAL root.
+  std::string GetTabletWalDir(const std::string& tablet_id) const;
+
   std::string GetTabletWalRecoveryDir(const std::string& tablet_id) const;
 
+  // Arrange for the given tablet's WAL to be stored on the fast WAL root by
+  // creating its WAL directory there. Must be called before the tablet's log
+  // is first opened; a tablet which already has a WAL under the default root
+  // cannot be moved. Returns IllegalState if no fast WAL root is configured.
+  Status PlaceTabletWalOnFastStorage(const std::string& tablet_id);
+
   std::string GetWalSegmentFileName(const std::string& tablet_id,
                                     uint64_t sequence_number) const;
 
@@ -259,6 +284,7 @@ class FsManager {
   // These roots are the constructor input verbatim. None of them are used
   // as-is; they are first canonicalized during Init().
   const std::string wal_fs_root_;
+  const std::string fast_wal_fs_root_;
   const std::vector<std::string> data_fs_roots_;
 
   scoped_refptr<MetricEntity> metric_entity_;
@@ -271,6 +297,7 @@ class FsManager {
   // - The first data root is used as the metadata root.
   // - Common roots in the collections have been deduplicated.
   std::string canonicalized_wal_fs_root_;
+  std::string canonicalized_fast_wal_fs_root_;
   std::string canonicalized_metadata_fs_root_;
   std::set<std::string> canonicalized_data_fs_roots_;
   std::set<std::string> canonicalized_all_fs_roots_;
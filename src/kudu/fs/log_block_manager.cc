@@ -18,15 +18,18 @@
 #include "kudu/fs/log_block_manager.h"
 
 #include <algorithm>
+#include <iterator>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <unordered_set>
 
 #include "kudu/fs/block_manager_metrics.h"
 #include "kudu/fs/block_manager_util.h"
 #include "kudu/fs/data_dirs.h"
 #include "kudu/fs/fs.pb.h"
 #include "kudu/gutil/callback.h"
+#include "kudu/gutil/casts.h"
 #include "kudu/gutil/integral_types.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/numbers.h"
@@ -73,6 +76,14 @@ DEFINE_uint64(log_container_preallocate_bytes, 32LU * 1024 * 1024,
               "creating new blocks. Set to 0 to disable preallocation");
 TAG_FLAG(log_container_preallocate_bytes, advanced);
 
+DEFINE_double(log_container_live_metadata_before_compact_ratio, 0.50,
+              "Desired ratio of live block metadata in log containers. If a "
+              "container's ratio of live block records to total block records "
+              "falls below this threshold, the container's metadata file is "
+              "compacted at startup, dropping records which pertain to "
+              "deleted blocks.");
+TAG_FLAG(log_container_live_metadata_before_compact_ratio, experimental);
+
 DEFINE_bool(log_block_manager_test_hole_punching, true,
             "Ensure hole punching is supported by the underlying filesystem");
 TAG_FLAG(log_block_manager_test_hole_punching, advanced);
@@ -110,9 +121,11 @@ namespace fs {
 
 using internal::LogBlock;
 using internal::LogBlockContainer;
+using internal::LogWritableBlock;
 using pb_util::ReadablePBContainerFile;
 using pb_util::WritablePBContainerFile;
 using std::map;
+using std::unordered_set;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
@@ -206,6 +219,15 @@ class LogBlockContainer {
   // The on-disk effects of this call are made durable only after SyncData().
   Status DeleteBlock(int64_t offset, int64_t length);
 
+  // Queues the hole punch for a deleted block at 'offset' and 'length',
+  // coalescing it with any pending extents that it abuts. The punching
+  // itself happens asynchronously on the container's data directory thread
+  // pool, so a burst of deletions (e.g. blocks freed by a compaction, which
+  // tend to be adjacent in the container) collapses into far fewer
+  // fallocate() calls.
+  void DeferBlockDeletion(const BlockId& block_id,
+                          int64_t offset, int64_t length);
+
   // Preallocate enough space to ensure that an append of 'next_append_length'
   // can be satisfied by this container. The offset of the beginning of this
   // block must be provided in 'block_start_offset' (since container
@@ -224,6 +246,13 @@ class LogBlockContainer {
   Status ReadData(int64_t offset, size_t length,
                   Slice* result, uint8_t* scratch) const;
 
+  // See RWFile::Prefetch().
+  Status PrefetchData(int64_t offset, size_t length) const;
+
+  // See RWFile::HintAccessPattern().
+  Status HintDataAccessPattern(int64_t offset, size_t length,
+                               FileAccessPatternHint hint) const;
+
   // Appends 'pb' to this container's metadata file.
   //
   // The on-disk effects of this call are made durable only after SyncMetadata().
@@ -268,6 +297,15 @@ class LogBlockContainer {
   // returning the records.
   Status ReadContainerRecords(deque<BlockRecordPB>* records) const;
 
+  // Atomically replaces this container's metadata file with one containing
+  // only 'records'. Used at startup to compact away records belonging to
+  // deleted blocks. On success, the container's metadata writer refers to
+  // the new file.
+  //
+  // This function is thread unsafe; it must not be called while other
+  // threads may use the metadata file.
+  Status RewriteMetadataFile(const std::vector<BlockRecordPB>& records);
+
   // Updates 'total_bytes_written_' and 'total_blocks_written_', marking this
   // container as full if needed. Should only be called when a block is fully
   // written, as it will round up the container data file's position.
@@ -307,6 +345,10 @@ class LogBlockContainer {
                           uint64_t data_file_size,
                           uint64_t fs_block_size) const;
 
+  // Punches all of the extents accumulated via DeferBlockDeletion(). Runs
+  // on the container's data directory thread pool.
+  void PunchDeferredHoles();
+
   // The owning block manager. Must outlive the container itself.
   LogBlockManager* const block_manager_;
 
@@ -328,6 +370,18 @@ class LogBlockContainer {
   // The number of blocks written thus far in the container.
   int64_t total_blocks_written_ = 0;
 
+  // Protects 'deferred_holes_' and 'hole_punch_scheduled_'.
+  simple_spinlock deferred_holes_lock_;
+
+  // Coalesced extents of deleted blocks awaiting hole punching. Keys are
+  // extent start offsets; values are extent end offsets (exclusive). All
+  // offsets are aligned to the filesystem block size.
+  std::map<int64_t, int64_t> deferred_holes_;
+
+  // Whether a PunchDeferredHoles() task is currently queued on the data
+  // directory thread pool.
+  bool hole_punch_scheduled_ = false;
+
   // The metrics. Not owned by the log container; it has the same lifespan
   // as the block manager.
   const LogBlockManagerMetrics* metrics_;
@@ -589,6 +643,56 @@ Status LogBlockContainer::ReadContainerRecords(deque<BlockRecordPB>* records) co
   return read_status;
 }
 
+Status LogBlockContainer::RewriteMetadataFile(const vector<BlockRecordPB>& records) {
+  Env* env = block_manager_->env();
+  string metadata_path = metadata_file_->filename();
+
+  // Write the new records to a temporary file beside the existing one.
+  string tmp_template = StrCat(metadata_path, kTmpInfix, ".XXXXXX");
+  string tmp_path;
+  unique_ptr<RWFile> tmp_file;
+  RETURN_NOT_OK(env->NewTempRWFile(RWFileOptions(), tmp_template,
+                                   &tmp_path, &tmp_file));
+  env_util::ScopedFileDeleter tmp_deleter(env, tmp_path);
+  {
+    WritablePBContainerFile writer(std::move(tmp_file));
+    RETURN_NOT_OK(writer.Init(BlockRecordPB()));
+    for (const BlockRecordPB& r : records) {
+      RETURN_NOT_OK(writer.Append(r));
+    }
+    RETURN_NOT_OK(writer.Sync());
+    RETURN_NOT_OK(writer.Close());
+  }
+
+  // Close the existing metadata writer and invalidate any cached handle to
+  // the old file before renaming the new one into place.
+  metadata_file_.reset();
+  if (block_manager_->file_cache_) {
+    block_manager_->file_cache_->Invalidate(metadata_path);
+  }
+  RETURN_NOT_OK(env->RenameFile(tmp_path, metadata_path));
+  tmp_deleter.Cancel();
+  RETURN_NOT_OK(env->SyncDir(DirName(metadata_path)));
+
+  // Reopen the metadata writer, through the file cache if there is one.
+  unique_ptr<WritablePBContainerFile> new_writer;
+  if (block_manager_->file_cache_) {
+    shared_ptr<RWFile> cached_file;
+    RETURN_NOT_OK(block_manager_->file_cache_->OpenExistingFile(
+        metadata_path, &cached_file));
+    new_writer.reset(new WritablePBContainerFile(std::move(cached_file)));
+  } else {
+    RWFileOptions opts;
+    opts.mode = Env::OPEN_EXISTING;
+    unique_ptr<RWFile> f;
+    RETURN_NOT_OK(env->NewRWFile(opts, metadata_path, &f));
+    new_writer.reset(new WritablePBContainerFile(std::move(f)));
+  }
+  RETURN_NOT_OK(new_writer->Reopen());
+  metadata_file_ = std::move(new_writer);
+  return Status::OK();
+}
+
 Status LogBlockContainer::CheckBlockRecord(const BlockRecordPB& record,
                                            uint64_t data_file_size,
                                            uint64_t fs_block_size) const {
@@ -680,6 +784,67 @@ Status LogBlockContainer::DeleteBlock(int64_t offset, int64_t length) {
   return Status::OK();
 }
 
+void LogBlockContainer::DeferBlockDeletion(const BlockId& block_id,
+                                           int64_t offset, int64_t length) {
+  VLOG(3) << "Deferring free of space belonging to block " << block_id;
+
+  // Round the extent's end up to the nearest filesystem block so that
+  // extents belonging to adjacent blocks abut; DeleteBlock() performs the
+  // same rounding when it punches the hole.
+  int64_t end = KUDU_ALIGN_UP(offset + length,
+                              instance()->filesystem_block_size_bytes());
+  bool must_schedule = false;
+  {
+    std::lock_guard<simple_spinlock> l(deferred_holes_lock_);
+
+    // Merge with the pending extent immediately preceding this one, if the
+    // two touch.
+    auto it = deferred_holes_.upper_bound(offset);
+    if (it != deferred_holes_.begin()) {
+      auto prev = std::prev(it);
+      if (prev->second >= offset) {
+        offset = prev->first;
+        end = std::max(end, prev->second);
+        deferred_holes_.erase(prev);
+      }
+    }
+
+    // Likewise with the extent immediately following.
+    if (it != deferred_holes_.end() && it->first <= end) {
+      end = std::max(end, it->second);
+      deferred_holes_.erase(it);
+    }
+    deferred_holes_[offset] = end;
+
+    if (!hole_punch_scheduled_) {
+      hole_punch_scheduled_ = true;
+      must_schedule = true;
+    }
+  }
+  if (must_schedule) {
+    ExecClosure(Bind(&LogBlockContainer::PunchDeferredHoles,
+                     Unretained(this)));
+  }
+}
+
+void LogBlockContainer::PunchDeferredHoles() {
+  map<int64_t, int64_t> holes;
+  {
+    std::lock_guard<simple_spinlock> l(deferred_holes_lock_);
+    holes.swap(deferred_holes_);
+    hole_punch_scheduled_ = false;
+  }
+
+  // We don't call SyncData() to synchronize the hole punching because it's
+  // expensive, and in the worst case, we'll just leave orphaned data
+  // behind to be cleaned up in the next GC.
+  for (const auto& hole : holes) {
+    WARN_NOT_OK(DeleteBlock(hole.first, hole.second - hole.first),
+                Substitute("Could not punch hole at offset $0 in container $1",
+                           hole.first, ToString()));
+  }
+}
+
 Status LogBlockContainer::WriteData(int64_t offset, const Slice& data) {
   DCHECK_GE(offset, total_bytes_written_);
 
@@ -701,6 +866,19 @@ Status LogBlockContainer::ReadData(int64_t offset, size_t length,
   return data_file_->Read(offset, length, result, scratch);
 }
 
+Status LogBlockContainer::HintDataAccessPattern(int64_t offset, size_t length,
+                                                FileAccessPatternHint hint) const {
+  DCHECK_GE(offset, 0);
+
+  return data_file_->HintAccessPattern(offset, length, hint);
+}
+
+Status LogBlockContainer::PrefetchData(int64_t offset, size_t length) const {
+  DCHECK_GE(offset, 0);
+
+  return data_file_->Prefetch(offset, length);
+}
+
 Status LogBlockContainer::AppendMetadata(const BlockRecordPB& pb) {
   // Note: We don't check for sufficient disk space for metadata writes in
   // order to allow for block deletion on full disks.
@@ -860,22 +1038,9 @@ LogBlock::LogBlock(LogBlockContainer* container, BlockId block_id,
   DCHECK_GE(length, 0);
 }
 
-static void DeleteBlockAsync(LogBlockContainer* container,
-                             BlockId block_id,
-                             int64_t offset,
-                             int64_t length) {
-  // We don't call SyncData() to synchronize the deletion because it's
-  // expensive, and in the worst case, we'll just leave orphaned data
-  // behind to be cleaned up in the next GC.
-  VLOG(3) << "Freeing space belonging to block " << block_id;
-  WARN_NOT_OK(container->DeleteBlock(offset, length),
-              Substitute("Could not delete block $0", block_id.ToString()));
-}
-
 LogBlock::~LogBlock() {
   if (deleted_) {
-    container_->ExecClosure(Bind(&DeleteBlockAsync, container_, block_id_,
-                                 offset_, length_));
+    container_->DeferBlockDeletion(block_id_, offset_, length_);
   }
 }
 
@@ -929,6 +1094,9 @@ class LogWritableBlock : public WritableBlock {
   // Does not synchronize the written data; that takes place in Close().
   Status AppendMetadata();
 
+  // The container this block was written to.
+  LogBlockContainer* container() const { return container_; }
+
  private:
   // The owning container. Must outlive the block.
   LogBlockContainer* container_;
@@ -1020,7 +1188,7 @@ Status LogWritableBlock::Append(const Slice& data) {
 Status LogWritableBlock::FlushDataAsync() {
   DCHECK(state_ == CLEAN || state_ == DIRTY || state_ == FLUSHING)
       << "Invalid state: " << state_;
-  if (state_ == DIRTY) {
+  if (state_ == CLEAN || state_ == DIRTY) {
     VLOG(3) << "Flushing block " << id();
     RETURN_NOT_OK(container_->FlushData(block_offset_, block_length_));
 
@@ -1123,6 +1291,10 @@ class LogReadableBlock : public ReadableBlock {
   virtual Status Read(uint64_t offset, size_t length,
                       Slice* result, uint8_t* scratch) const OVERRIDE;
 
+  virtual Status Prefetch(uint64_t offset, size_t length) const OVERRIDE;
+
+  virtual Status HintAccessPattern(FileAccessPatternHint hint) const OVERRIDE;
+
   virtual size_t memory_footprint() const OVERRIDE;
 
  private:
@@ -1191,7 +1363,10 @@ Status LogReadableBlock::Read(uint64_t offset, size_t length,
                                       log_block_->offset() + log_block_->length()));
   }
 
+  // Both the wait for a read slot (if the per-directory concurrent read cap
+  // is enabled) and the read itself count towards the read time metrics.
   MicrosecondsInt64 start_time = GetMonoTimeMicros();
+  ScopedDataDirRead read_slot(container_->mutable_data_dir());
   RETURN_NOT_OK(container_->ReadData(read_offset, length, result, scratch));
   MicrosecondsInt64 end_time = GetMonoTimeMicros();
 
@@ -1207,8 +1382,34 @@ Status LogReadableBlock::Read(uint64_t offset, size_t length,
   return Status::OK();
 }
 
+Status LogReadableBlock::Prefetch(uint64_t offset, size_t length) const {
+  DCHECK(!closed_.Load());
+
+  uint64_t prefetch_offset = log_block_->offset() + offset;
+  if (log_block_->length() < offset + length) {
+    return Status::IOError("Out-of-bounds prefetch",
+                           Substitute("prefetch of [$0-$1) in block [$2-$3)",
+                                      prefetch_offset,
+                                      prefetch_offset + length,
+                                      log_block_->offset(),
+                                      log_block_->offset() + log_block_->length()));
+  }
+
+  return container_->PrefetchData(prefetch_offset, length);
+}
+
+Status LogReadableBlock::HintAccessPattern(FileAccessPatternHint hint) const {
+  DCHECK(!closed_.Load());
+
+  // The container's data file is shared with other blocks, so scope the
+  // hint to this block's byte range.
+  return container_->HintDataAccessPattern(log_block_->offset(),
+                                           log_block_->length(), hint);
+}
+
 size_t LogReadableBlock::memory_footprint() const {
-  return kudu_malloc_usable_size(this);
+  DCHECK(log_block_);
+  return kudu_malloc_usable_size(this) + kudu_malloc_usable_size(log_block_.get());
 }
 
 } // namespace internal
@@ -1413,7 +1614,7 @@ Status LogBlockManager::OpenBlock(const BlockId& block_id,
                                   gscoped_ptr<ReadableBlock>* block) {
   scoped_refptr<LogBlock> lb;
   {
-    std::lock_guard<simple_spinlock> l(lock_);
+    shared_lock<rw_spinlock> l(blocks_lock_);
     lb = FindPtrOrNull(blocks_by_block_id_, block_id);
   }
   if (!lb) {
@@ -1459,24 +1660,36 @@ Status LogBlockManager::DeleteBlock(const BlockId& block_id) {
 
 Status LogBlockManager::CloseBlocks(const std::vector<WritableBlock*>& blocks) {
   VLOG(3) << "Closing " << blocks.size() << " blocks";
-  if (FLAGS_block_coalesce_close) {
-    // Ask the kernel to begin writing out each block's dirty data. This is
-    // done up-front to give the kernel opportunities to coalesce contiguous
-    // dirty pages.
-    for (WritableBlock* block : blocks) {
-      RETURN_NOT_OK(block->FlushDataAsync());
-    }
+
+  // Ask the kernel to begin writing out each block's dirty data and append
+  // each block's metadata record. Doing this up-front gives the kernel
+  // opportunities to coalesce contiguous dirty pages, and ensures the syncs
+  // below cover all of the batch's data and metadata.
+  unordered_set<LogBlockContainer*> containers;
+  for (WritableBlock* block : blocks) {
+    RETURN_NOT_OK(block->FlushDataAsync());
+    containers.insert(down_cast<LogWritableBlock*>(block)->container());
+  }
+
+  // Sync each distinct container exactly once rather than once per block.
+  // A batch often includes multiple blocks from the same container (e.g. a
+  // rowset flush closes all of its blocks together); this collapses their
+  // data and metadata fsyncs into a single pair per container.
+  for (LogBlockContainer* container : containers) {
+    RETURN_NOT_OK(container->SyncData());
+    RETURN_NOT_OK(container->SyncMetadata());
   }
 
-  // Now close each block, waiting for each to become durable.
+  // The entire batch is durable; close the blocks without further syncing.
   for (WritableBlock* block : blocks) {
-    RETURN_NOT_OK(block->Close());
+    RETURN_NOT_OK(down_cast<LogWritableBlock*>(block)->DoClose(
+        LogWritableBlock::NO_SYNC));
   }
   return Status::OK();
 }
 
 int64_t LogBlockManager::CountBlocksForTests() const {
-  std::lock_guard<simple_spinlock> l(lock_);
+  shared_lock<rw_spinlock> l(blocks_lock_);
   return blocks_by_block_id_.size();
 }
 
@@ -1564,7 +1777,7 @@ bool LogBlockManager::TryUseBlockId(const BlockId& block_id) {
     return false;
   }
 
-  std::lock_guard<simple_spinlock> l(lock_);
+  std::lock_guard<rw_spinlock> l(blocks_lock_);
   if (ContainsKey(blocks_by_block_id_, block_id)) {
     return false;
   }
@@ -1575,16 +1788,14 @@ bool LogBlockManager::AddLogBlock(LogBlockContainer* container,
                                   const BlockId& block_id,
                                   int64_t offset,
                                   int64_t length) {
-  std::lock_guard<simple_spinlock> l(lock_);
   scoped_refptr<LogBlock> lb(new LogBlock(container, block_id, offset, length));
   mem_tracker_->Consume(kudu_malloc_usable_size(lb.get()));
 
+  std::lock_guard<rw_spinlock> l(blocks_lock_);
   return AddLogBlockUnlocked(lb);
 }
 
 bool LogBlockManager::AddLogBlockUnlocked(const scoped_refptr<LogBlock>& lb) {
-  DCHECK(lock_.is_locked());
-
   if (!InsertIfNotPresent(&blocks_by_block_id_, lb->block_id(), lb)) {
     return false;
   }
@@ -1603,7 +1814,7 @@ bool LogBlockManager::AddLogBlockUnlocked(const scoped_refptr<LogBlock>& lb) {
 }
 
 scoped_refptr<LogBlock> LogBlockManager::RemoveLogBlock(const BlockId& block_id) {
-  std::lock_guard<simple_spinlock> l(lock_);
+  std::lock_guard<rw_spinlock> l(blocks_lock_);
   scoped_refptr<LogBlock> result =
       EraseKeyReturnValuePtr(&blocks_by_block_id_, block_id);
   if (result) {
@@ -1695,12 +1906,57 @@ void LogBlockManager::OpenDataDir(DataDir* dir,
       }
     }
 
+    // If most of the container's metadata records pertain to deleted blocks,
+    // rewrite (compact) the metadata file so that subsequent startups don't
+    // pay to read and process them. To preserve the container's high-water
+    // mark (byte ranges in a container may never be reused), the records
+    // belonging to the block with the greatest extent are always retained,
+    // even if that block was deleted.
+    if (!read_only_ && !records.empty()) {
+      double live_ratio =
+          static_cast<double>(blocks_in_container.size()) / records.size();
+      if (live_ratio < FLAGS_log_container_live_metadata_before_compact_ratio) {
+        BlockId max_extent_block_id;
+        int64_t max_extent = -1;
+        for (const BlockRecordPB& r : records) {
+          if (r.op_type() == CREATE && r.offset() + r.length() > max_extent) {
+            max_extent = r.offset() + r.length();
+            max_extent_block_id = BlockId::FromPB(r.block_id());
+          }
+        }
+
+        vector<BlockRecordPB> live_records;
+        for (const BlockRecordPB& r : records) {
+          BlockId block_id(BlockId::FromPB(r.block_id()));
+          if (ContainsKey(blocks_in_container, block_id)) {
+            DCHECK_EQ(CREATE, r.op_type());
+            live_records.push_back(r);
+          } else if (block_id == max_extent_block_id) {
+            // Deleted, but defines the container's high-water mark; keep
+            // both its CREATE and DELETE records.
+            live_records.push_back(r);
+          }
+        }
+
+        s = container->RewriteMetadataFile(live_records);
+        if (!s.ok()) {
+          *result_status = s.CloneAndPrepend(Substitute(
+              "Could not compact metadata of container $0", container->ToString()));
+          return;
+        }
+        LOG(INFO) << Substitute(
+            "Compacted metadata of container $0 (kept $1 of $2 records)",
+            container->ToString(), live_records.size(), records.size());
+      }
+    }
+
     next_block_id_.StoreMax(max_block_id + 1);
 
     // Under the lock, merge this map into the main block map and add
     // the container.
     {
       std::lock_guard<simple_spinlock> l(lock_);
+      std::lock_guard<rw_spinlock> bl(blocks_lock_);
       // To avoid cacheline contention during startup, we aggregate all of the
       // memory in a local and add it to the mem-tracker in a single increment
       // at the end of this loop.
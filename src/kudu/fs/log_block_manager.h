@@ -54,6 +54,7 @@ namespace fs {
 namespace internal {
 class LogBlock;
 class LogBlockContainer;
+class LogWritableBlock;
 
 struct LogBlockManagerMetrics;
 } // namespace internal
@@ -184,10 +185,12 @@ class LogBlockManager : public BlockManager {
   int64_t CountBlocksForTests() const;
 
  private:
+  FRIEND_TEST(LogBlockManagerTest, TestDeferredHolePunching);
   FRIEND_TEST(LogBlockManagerTest, TestLookupBlockLimit);
   FRIEND_TEST(LogBlockManagerTest, TestMetadataTruncation);
   FRIEND_TEST(LogBlockManagerTest, TestParseKernelRelease);
   FRIEND_TEST(LogBlockManagerTest, TestReuseBlockIds);
+  FRIEND_TEST(LogBlockManagerTest, TestStartupMetadataCompaction);
 
   friend class internal::LogBlockContainer;
 
@@ -244,7 +247,7 @@ class LogBlockManager : public BlockManager {
                    int64_t length);
 
   // Unlocked variant of AddLogBlock() for an already-constructed LogBlock object.
-  // Must hold 'lock_'.
+  // Must hold 'blocks_lock_' for writing.
   bool AddLogBlockUnlocked(const scoped_refptr<internal::LogBlock>& lb);
 
   // Removes a LogBlock from in-memory data structures.
@@ -293,9 +296,16 @@ class LogBlockManager : public BlockManager {
   // interesting (e.g. LogBlocks).
   std::shared_ptr<MemTracker> mem_tracker_;
 
-  // Protects the block map, container structures, and 'dirty_dirs'.
+  // Protects the container structures and 'dirty_dirs'.
   mutable simple_spinlock lock_;
 
+  // Protects 'blocks_by_block_id_' and 'open_block_ids_'. A separate
+  // reader-writer lock so that the read path's per-block lookups in
+  // OpenBlock() can proceed concurrently instead of contending with each
+  // other and with container bookkeeping on 'lock_'. When both locks are
+  // needed, 'lock_' must be acquired first.
+  mutable rw_spinlock blocks_lock_;
+
   // Manages and owns all of the block manager's data directories.
   DataDirManager dd_manager_;
 
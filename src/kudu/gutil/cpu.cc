@@ -38,6 +38,7 @@ CPU::CPU()
     has_sse42_(false),
     has_avx_(false),
     has_avx2_(false),
+    has_avx512_(false),
     has_aesni_(false),
     has_non_stop_time_stamp_counter_(false),
     has_broken_neon_(false),
@@ -242,6 +243,14 @@ void CPU::Initialize() {
         (_xgetbv(0) & 6) == 6 /* XSAVE enabled by kernel */;
     has_aesni_ = (cpu_info[2] & 0x02000000) != 0;
     has_avx2_ = has_avx_ && (cpu_info7[1] & 0x00000020) != 0;
+    // AVX-512 additionally requires that the kernel save/restore the
+    // opmask and ZMM register state (XCR0 bits 5-7). We require both the
+    // foundation (AVX512F, EBX bit 16) and byte/word (AVX512BW, EBX bit 30)
+    // instruction subsets, which ship together on all known CPUs.
+    has_avx512_ = has_avx_ &&
+        (cpu_info7[1] & 0x00010000) != 0 /* AVX512F */ &&
+        (cpu_info7[1] & 0x40000000) != 0 /* AVX512BW */ &&
+        (_xgetbv(0) & 0xe0) == 0xe0 /* ZMM state enabled by kernel */;
   }
 
   // Get the brand string of the cpu.
@@ -275,6 +284,7 @@ void CPU::Initialize() {
 }
 
 CPU::IntelMicroArchitecture CPU::GetIntelMicroArchitecture() const {
+  if (has_avx512()) return AVX512;
   if (has_avx2()) return AVX2;
   if (has_avx()) return AVX;
   if (has_sse42()) return SSE42;
@@ -25,6 +25,7 @@ class CPU {
     SSE42,
     AVX,
     AVX2,
+    AVX512,
     MAX_INTEL_MICRO_ARCHITECTURE
   };
 
@@ -46,6 +47,9 @@ class CPU {
   bool has_sse42() const { return has_sse42_; }
   bool has_avx() const { return has_avx_; }
   bool has_avx2() const { return has_avx2_; }
+  // True if the CPU and OS support the AVX-512 foundation and byte/word
+  // instructions (AVX512F and AVX512BW) and the ZMM register state.
+  bool has_avx512() const { return has_avx512_; }
   bool has_aesni() const { return has_aesni_; }
   bool has_non_stop_time_stamp_counter() const {
     return has_non_stop_time_stamp_counter_;
@@ -78,6 +82,7 @@ class CPU {
   bool has_sse42_;
   bool has_avx_;
   bool has_avx2_;
+  bool has_avx512_;
   bool has_aesni_;
   bool has_non_stop_time_stamp_counter_;
   bool has_broken_neon_;
@@ -0,0 +1,397 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Single-process stress benchmark for the CatalogManager's heartbeat path.
+//
+// This simulates a cluster of fake tablet servers which repeatedly send
+// tablet reports through the real TSHeartbeat RPC path, while other threads
+// concurrently look up tablet locations. The latency histograms printed at
+// the end make regressions in catalog locking visible without needing a
+// full cluster.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gflags/gflags.h>
+
+#include "kudu/common/partial_row.h"
+#include "kudu/common/row_operations.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/wire_protocol.h"
+#include "kudu/consensus/metadata.pb.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/master/catalog_manager.h"
+#include "kudu/master/master.h"
+#include "kudu/master/master.pb.h"
+#include "kudu/master/master.proxy.h"
+#include "kudu/master/master-test-util.h"
+#include "kudu/master/mini_master.h"
+#include "kudu/rpc/messenger.h"
+#include "kudu/tablet/metadata.pb.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/jsonwriter.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/pb_util.h"
+#include "kudu/util/status.h"
+#include "kudu/util/stopwatch.h"
+#include "kudu/util/test_util.h"
+#include "kudu/util/thread.h"
+
+DEFINE_int32(runtime_secs, 10,
+             "Number of seconds to let the heartbeater and lookup threads run "
+             "before stopping them and reporting latencies.");
+DEFINE_int32(num_tablet_servers, 8,
+             "Number of fake tablet servers to register. Each one runs a "
+             "thread which continuously sends tablet reports.");
+DEFINE_int32(num_tablets, 32,
+             "Number of tablets in the test table. Every fake tablet server "
+             "re-reports all of them in each heartbeat.");
+DEFINE_int32(num_lookup_threads, 4,
+             "Number of threads concurrently calling GetTableLocations.");
+
+DECLARE_bool(catalog_manager_check_ts_count_for_create_table);
+
+METRIC_DEFINE_histogram(test, heartbeat_latency,
+                        "Heartbeat Latency",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Latency of TSHeartbeat RPCs carrying tablet reports.",
+                        10000000,
+                        2);
+
+METRIC_DEFINE_histogram(test, table_locations_latency,
+                        "GetTableLocations Latency",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Latency of GetTableLocations RPCs issued concurrently "
+                        "with tablet reports.",
+                        10000000,
+                        2);
+
+METRIC_DECLARE_entity(server);
+
+using kudu::consensus::ConsensusStatePB;
+using kudu::consensus::RaftConfigPB;
+using kudu::consensus::RaftPeerPB;
+using kudu::rpc::Messenger;
+using kudu::rpc::MessengerBuilder;
+using kudu::rpc::RpcController;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace master {
+
+static const char kTableName[] = "catalog-stress-table";
+
+class CatalogManagerStressTest : public KuduTest {
+ public:
+  CatalogManagerStressTest()
+      : metric_entity_(METRIC_ENTITY_server.Instantiate(
+            &metric_registry_, "test.catalog_manager-stress-test")),
+        start_latch_(FLAGS_num_tablet_servers + FLAGS_num_lookup_threads),
+        stop_latch_(1) {
+    OverrideFlagForSlowTests("runtime_secs", "60");
+  }
+
+  virtual void SetUp() OVERRIDE {
+    KuduTest::SetUp();
+
+    // The "tablet servers" in this test are fake, so the usual check that
+    // enough of them have registered before creating a table must be
+    // disabled.
+    FLAGS_catalog_manager_check_ts_count_for_create_table = false;
+
+    mini_master_.reset(new MiniMaster(Env::Default(), GetTestPath("Master"), 0));
+    ASSERT_OK(mini_master_->Start());
+    master_ = mini_master_->master();
+    ASSERT_OK(master_->WaitUntilCatalogManagerIsLeaderAndReadyForTests(MonoDelta::FromSeconds(5)));
+
+    MessengerBuilder bld("Client");
+    ASSERT_OK(bld.Build(&client_messenger_));
+    proxy_.reset(new MasterServiceProxy(client_messenger_, mini_master_->bound_rpc_addr()));
+
+    heartbeat_histogram_ = METRIC_heartbeat_latency.Instantiate(metric_entity_);
+    lookup_histogram_ = METRIC_table_locations_latency.Instantiate(metric_entity_);
+  }
+
+  virtual void TearDown() OVERRIDE {
+    mini_master_->Shutdown();
+    KuduTest::TearDown();
+  }
+
+ protected:
+  static string TsUuid(int idx) {
+    return Substitute("fake-ts-$0", idx);
+  }
+
+  static void FillCommon(int ts_idx, TSHeartbeatRequestPB* req) {
+    TSToMasterCommonPB* common = req->mutable_common();
+    common->mutable_ts_instance()->set_permanent_uuid(TsUuid(ts_idx));
+    common->mutable_ts_instance()->set_instance_seqno(1);
+  }
+
+  // Register a fake tablet server. The registered addresses are bogus, so
+  // any RPCs the master sends to it (e.g. CreateTablet) will fail and be
+  // retried in the background; the tablets are instead driven to RUNNING by
+  // the reports we send below.
+  void RegisterFakeTS(int idx) {
+    TSHeartbeatRequestPB req;
+    TSHeartbeatResponsePB resp;
+    RpcController rpc;
+    FillCommon(idx, &req);
+    ServerRegistrationPB* reg = req.mutable_registration();
+    HostPortPB* rpc_addr = reg->add_rpc_addresses();
+    rpc_addr->set_host("localhost");
+    rpc_addr->set_port(1000 + idx);
+    HostPortPB* http_addr = reg->add_http_addresses();
+    http_addr->set_host("localhost");
+    http_addr->set_port(2000 + idx);
+    ASSERT_OK(proxy_->TSHeartbeat(req, &resp, &rpc));
+    ASSERT_FALSE(resp.needs_reregister());
+  }
+
+  void CreateTestTable() {
+    Schema schema({ ColumnSchema("key", INT32) }, 1);
+    CreateTableRequestPB req;
+    CreateTableResponsePB resp;
+    RpcController rpc;
+    req.set_name(kTableName);
+    req.set_num_replicas(std::min(3, FLAGS_num_tablet_servers));
+    ASSERT_OK(SchemaToPB(schema, req.mutable_schema()));
+    RowOperationsPBEncoder encoder(req.mutable_split_rows_range_bounds());
+    for (int i = 1; i < FLAGS_num_tablets; i++) {
+      KuduPartialRow split(&schema);
+      ASSERT_OK(split.SetInt32("key", i * 1000));
+      encoder.Add(RowOperationsPB::SPLIT_ROW, split);
+    }
+    ASSERT_OK(proxy_->CreateTable(req, &resp, &rpc));
+    ASSERT_FALSE(resp.has_error()) << SecureShortDebugString(resp);
+  }
+
+  // Wait until the background assignment task has transitioned all of the
+  // table's tablets to CREATING, and collect their IDs for use in reports.
+  // Reports for tablets which are still PREPARING would be ignored (or, in
+  // debug builds, trip a DCHECK on the state transition).
+  void WaitForTabletAssignment() {
+    AssertEventually([&]() {
+      vector<scoped_refptr<TabletInfo>> tablets;
+      {
+        CatalogManager* catalog = master_->catalog_manager();
+        CatalogManager::ScopedLeaderSharedLock l(catalog);
+        ASSERT_OK(l.first_failed_status());
+        vector<scoped_refptr<TableInfo>> tables;
+        ASSERT_OK(catalog->GetAllTables(&tables));
+        ASSERT_EQ(1, tables.size());
+        tables[0]->GetAllTablets(&tablets);
+      }
+      ASSERT_EQ(FLAGS_num_tablets, tablets.size());
+      tablet_ids_.clear();
+      for (const scoped_refptr<TabletInfo>& tablet : tablets) {
+        TabletMetadataLock l(tablet.get(), TabletMetadataLock::READ);
+        ASSERT_EQ(SysTabletsEntryPB::CREATING, l.data().pb.state());
+        tablet_ids_.push_back(tablet->tablet_id());
+      }
+    });
+  }
+
+  // Fill in a report covering every tablet in the table. All reporters claim
+  // the same leader, term, and config opid_index, so after the first report
+  // is processed, subsequent ones exercise the read/locking path without
+  // writing to the sys catalog -- the steady state we want to measure.
+  void FillTabletReport(bool incremental, int64_t seq_no, TabletReportPB* report) {
+    report->set_is_incremental(incremental);
+    report->set_sequence_number(seq_no);
+    for (const string& tablet_id : tablet_ids_) {
+      ReportedTabletPB* reported = report->add_updated_tablets();
+      reported->set_tablet_id(tablet_id);
+      reported->set_state(tablet::RUNNING);
+      reported->set_schema_version(0);
+      ConsensusStatePB* cstate = reported->mutable_committed_consensus_state();
+      cstate->set_current_term(1);
+      cstate->set_leader_uuid(TsUuid(0));
+      RaftConfigPB* config = cstate->mutable_config();
+      config->set_opid_index(1);
+      for (int i = 0; i < std::min(3, FLAGS_num_tablet_servers); i++) {
+        RaftPeerPB* peer = config->add_peers();
+        peer->set_permanent_uuid(TsUuid(i));
+        peer->set_member_type(RaftPeerPB::VOTER);
+      }
+    }
+  }
+
+  // Send one full report to transition every tablet to RUNNING, then wait
+  // for the locations to become visible.
+  void MarkTabletsRunning() {
+    TSHeartbeatRequestPB req;
+    TSHeartbeatResponsePB resp;
+    RpcController rpc;
+    FillCommon(0, &req);
+    FillTabletReport(/* incremental= */ false, 0, req.mutable_tablet_report());
+    ASSERT_OK(proxy_->TSHeartbeat(req, &resp, &rpc));
+
+    GetTableLocationsResponsePB locs;
+    ASSERT_OK(WaitForRunningTabletCount(mini_master_.get(), kTableName,
+                                        FLAGS_num_tablets, &locs));
+  }
+
+  void StartThreads() {
+    for (int i = 0; i < FLAGS_num_tablet_servers; i++) {
+      scoped_refptr<kudu::Thread> new_thread;
+      CHECK_OK(kudu::Thread::Create("test", Substitute("heartbeat$0", i),
+                                    &CatalogManagerStressTest::HeartbeaterThread, this, i,
+                                    &new_thread));
+      threads_.push_back(new_thread);
+    }
+    for (int i = 0; i < FLAGS_num_lookup_threads; i++) {
+      scoped_refptr<kudu::Thread> new_thread;
+      CHECK_OK(kudu::Thread::Create("test", Substitute("lookup$0", i),
+                                    &CatalogManagerStressTest::LookupThread, this,
+                                    &new_thread));
+      threads_.push_back(new_thread);
+    }
+  }
+
+  void JoinThreads() {
+    for (scoped_refptr<kudu::Thread> thr : threads_) {
+      CHECK_OK(ThreadJoiner(thr.get()).Join());
+    }
+  }
+
+  void HeartbeaterThread(int ts_idx);
+  void LookupThread();
+
+  MetricRegistry metric_registry_;
+  scoped_refptr<MetricEntity> metric_entity_;
+  scoped_refptr<Histogram> heartbeat_histogram_;
+  scoped_refptr<Histogram> lookup_histogram_;
+
+  shared_ptr<Messenger> client_messenger_;
+  gscoped_ptr<MiniMaster> mini_master_;
+  Master* master_;
+  gscoped_ptr<MasterServiceProxy> proxy_;
+
+  vector<string> tablet_ids_;
+  CountDownLatch start_latch_;
+  CountDownLatch stop_latch_;
+  vector<scoped_refptr<kudu::Thread>> threads_;
+};
+
+void CatalogManagerStressTest::HeartbeaterThread(int ts_idx) {
+  // Wait for all the threads to be ready before we start.
+  start_latch_.CountDown();
+  start_latch_.Wait();
+
+  int64_t seq_no = 0;
+  while (stop_latch_.count() > 0) {
+    TSHeartbeatRequestPB req;
+    TSHeartbeatResponsePB resp;
+    RpcController rpc;
+    FillCommon(ts_idx, &req);
+    // The first report from each server must be a full one; after that the
+    // server re-reports all of its tablets incrementally, which is the worst
+    // case for report processing.
+    FillTabletReport(/* incremental= */ seq_no > 0, seq_no, req.mutable_tablet_report());
+    seq_no++;
+
+    MonoTime before = MonoTime::Now();
+    CHECK_OK(proxy_->TSHeartbeat(req, &resp, &rpc));
+    MonoDelta delta = MonoTime::Now() - before;
+    heartbeat_histogram_->Increment(delta.ToMicroseconds());
+    CHECK(!resp.needs_reregister());
+  }
+  LOG(INFO) << "Heartbeater thread " << ts_idx << " complete";
+}
+
+void CatalogManagerStressTest::LookupThread() {
+  start_latch_.CountDown();
+  start_latch_.Wait();
+
+  while (stop_latch_.count() > 0) {
+    GetTableLocationsRequestPB req;
+    GetTableLocationsResponsePB resp;
+    RpcController rpc;
+    req.mutable_table()->set_table_name(kTableName);
+    req.set_max_returned_locations(FLAGS_num_tablets);
+
+    MonoTime before = MonoTime::Now();
+    CHECK_OK(proxy_->GetTableLocations(req, &resp, &rpc));
+    MonoDelta delta = MonoTime::Now() - before;
+    lookup_histogram_->Increment(delta.ToMicroseconds());
+    CHECK(!resp.has_error()) << SecureShortDebugString(resp);
+    CHECK_EQ(FLAGS_num_tablets, resp.tablet_locations_size());
+  }
+  LOG(INFO) << "Lookup thread complete";
+}
+
+TEST_F(CatalogManagerStressTest, TestConcurrentReportsAndLookups) {
+  for (int i = 0; i < FLAGS_num_tablet_servers; i++) {
+    NO_FATALS(RegisterFakeTS(i));
+  }
+  NO_FATALS(CreateTestTable());
+  NO_FATALS(WaitForTabletAssignment());
+  NO_FATALS(MarkTabletsRunning());
+
+  std::thread timeout_thread;
+  StartThreads();
+  Stopwatch s(Stopwatch::ALL_THREADS);
+  s.start();
+
+  // Start a thread to fire 'stop_latch_' after the prescribed number of seconds.
+  if (FLAGS_runtime_secs > 0) {
+    timeout_thread = std::thread([&]() {
+      stop_latch_.WaitFor(MonoDelta::FromSeconds(FLAGS_runtime_secs));
+      stop_latch_.CountDown();
+    });
+  }
+  JoinThreads();
+  s.stop();
+
+  int64_t num_heartbeats = heartbeat_histogram_->TotalCount();
+  int64_t num_lookups = lookup_histogram_->TotalCount();
+  ASSERT_GT(num_heartbeats, 0);
+  ASSERT_GT(num_lookups, 0);
+  LOG(INFO) << "Processed " << num_heartbeats << " tablet reports ("
+            << num_heartbeats * FLAGS_num_tablets << " reported tablets) and "
+            << num_lookups << " location lookups in "
+            << s.elapsed().wall_millis() << " ms";
+  LOG(INFO) << "Report throughput: "
+            << (num_heartbeats * 1000 / s.elapsed().wall_millis()) << " reports/sec";
+  LOG(INFO) << "Lookup throughput: "
+            << (num_lookups * 1000 / s.elapsed().wall_millis()) << " lookups/sec";
+
+  // Generate the JSON.
+  std::ostringstream out;
+  JsonWriter writer(&out, JsonWriter::PRETTY);
+  ASSERT_OK(heartbeat_histogram_->WriteAsJson(&writer, MetricJsonOptions()));
+  ASSERT_OK(lookup_histogram_->WriteAsJson(&writer, MetricJsonOptions()));
+  LOG(INFO) << out.str();
+
+  // Ensure the timeout thread is stopped before exiting.
+  stop_latch_.CountDown();
+  if (timeout_thread.joinable()) timeout_thread.join();
+}
+
+} // namespace master
+} // namespace kudu
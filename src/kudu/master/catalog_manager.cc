@@ -1977,13 +1977,85 @@ Status CatalogManager::ProcessTabletReport(TSDescriptor* ts_desc,
   // the server should have, compare vs the ones being reported, and somehow mark
   // any that have been "lost" (eg somehow the tablet metadata got corrupted or something).
 
+  // Fast path for the common case: an incremental report with no updated
+  // tablets. With short heartbeat intervals and many tablet servers, the vast
+  // majority of reports are empty.
+  if (report.updated_tablets_size() == 0) {
+    return Status::OK();
+  }
+
+  TabletReportState state;
+
+  // Look up all of the reported tablets in one pass over 'lock_'. Tablets
+  // which aren't found here are handled as unknown tablets below.
+  {
+    shared_lock<LockType> l(lock_);
+    for (const ReportedTabletPB& reported : report.updated_tablets()) {
+      scoped_refptr<TabletInfo> tablet = FindPtrOrNull(tablet_map_, reported.tablet_id());
+      if (tablet) {
+        state.tablets.emplace(reported.tablet_id(), std::move(tablet));
+      }
+    }
+  }
+
+  // Take write locks on all of the reported tablets. The locks are acquired
+  // in tablet ID order (consistent with ScopedTabletInfoCommitter) so that
+  // two overlapping reports cannot deadlock, and held until the report's
+  // mutations have been persisted in a single sys catalog write below.
+  {
+    vector<string> tablet_ids;
+    tablet_ids.reserve(state.tablets.size());
+    for (const auto& entry : state.tablets) {
+      tablet_ids.push_back(entry.first);
+    }
+    std::sort(tablet_ids.begin(), tablet_ids.end());
+    for (const string& tablet_id : tablet_ids) {
+      TabletInfo* tablet = FindOrDie(state.tablets, tablet_id).get();
+      state.tablet_locks.emplace(
+          tablet_id, unique_ptr<TabletMetadataLock>(
+              new TabletMetadataLock(tablet, TabletMetadataLock::WRITE)));
+    }
+  }
+
   for (const ReportedTabletPB& reported : report.updated_tablets()) {
     ReportedTabletUpdatesPB *tablet_report = report_update->add_tablets();
     tablet_report->set_tablet_id(reported.tablet_id());
-    RETURN_NOT_OK_PREPEND(HandleReportedTablet(ts_desc, reported, tablet_report),
+    RETURN_NOT_OK_PREPEND(HandleReportedTablet(ts_desc, reported, tablet_report, &state),
                           Substitute("Error handling $0", SecureShortDebugString(reported)));
   }
 
+  // Write all of the updates collected above to the sys catalog in a single
+  // batch, rather than issuing one write per reported tablet. On a large
+  // cluster a heartbeat may carry updates for many tablets, and serializing
+  // a sys catalog write per tablet makes the master the bottleneck.
+  if (!state.mutated_tablets.empty()) {
+    SysCatalogTable::Actions actions;
+    actions.tablets_to_update = state.mutated_tablets;
+    Status s = sys_catalog_->Write(actions);
+    if (!s.ok()) {
+      LOG(WARNING) << "Error updating tablets: " << s.ToString()
+                   << ". Tablet report was: " << SecureShortDebugString(report);
+      // The tablet lock destructors will abort the in-memory mutations; the
+      // tablet server will retry the report.
+      return s;
+    }
+  }
+
+  // Commit the new state of every reported tablet. Tablets whose dirty state
+  // was never modified commit a no-op.
+  for (const auto& entry : state.tablet_locks) {
+    entry.second->Commit();
+  }
+
+  // Follow-up actions which depend on the newly committed tablet state (e.g.
+  // the AlterTable RPC needs to know the most recent leader).
+  for (const scoped_refptr<TabletInfo>& tablet : state.needs_alter_rpc) {
+    SendAlterTabletRequest(tablet);
+  }
+  for (const auto& entry : state.reported_schema_versions) {
+    HandleTabletSchemaVersionReport(entry.first.get(), entry.second);
+  }
+
   if (report.updated_tablets_size() > 0) {
     background_tasks_->WakeIfHasPendingUpdates();
   }
@@ -2011,14 +2083,12 @@ bool ShouldTransitionTabletToRunning(const ReportedTabletPB& report) {
 
 Status CatalogManager::HandleReportedTablet(TSDescriptor* ts_desc,
                                             const ReportedTabletPB& report,
-                                            ReportedTabletUpdatesPB *report_updates) {
+                                            ReportedTabletUpdatesPB *report_updates,
+                                            TabletReportState* state) {
   TRACE_EVENT1("master", "HandleReportedTablet",
                "tablet_id", report.tablet_id());
-  scoped_refptr<TabletInfo> tablet;
-  {
-    shared_lock<LockType> l(lock_);
-    tablet = FindPtrOrNull(tablet_map_, report.tablet_id());
-  }
+  scoped_refptr<TabletInfo> tablet =
+      FindWithDefault(state->tablets, report.tablet_id(), nullptr);
   if (!tablet) {
     // It'd be unsafe to ask the tserver to delete this tablet without first
     // replicating something to our followers (i.e. to guarantee that we're the
@@ -2046,7 +2116,7 @@ Status CatalogManager::HandleReportedTablet(TSDescriptor* ts_desc,
   // TODO: we don't actually need to do the COW here until we see we're going
   // to change the state. Can we change CowedObject to lazily do the copy?
   TableMetadataLock table_lock(tablet->table().get(), TableMetadataLock::READ);
-  TabletMetadataLock tablet_lock(tablet.get(), TabletMetadataLock::WRITE);
+  TabletMetadataLock& tablet_lock = *FindOrDie(state->tablet_locks, report.tablet_id());
 
   // If the TS is reporting a tablet which has been deleted, or a tablet from
   // a table which has been deleted, send it an RPC to delete it.
@@ -2217,23 +2287,19 @@ Status CatalogManager::HandleReportedTablet(TSDescriptor* ts_desc,
   table_lock.Unlock();
   // We update the tablets each time that someone reports it.
   // This shouldn't be very frequent and should only happen when something in fact changed.
-  SysCatalogTable::Actions actions;
-  actions.tablets_to_update.push_back(tablet.get());
-  Status s = sys_catalog_->Write(actions);
-  if (!s.ok()) {
-    LOG(WARNING) << "Error updating tablets: " << s.ToString() << ". Tablet report was: "
-                 << SecureShortDebugString(report);
-    return s;
-  }
-  tablet_lock.Commit();
+  //
+  // The sys catalog write and the commit of the new tablet state are deferred
+  // to the end of the report, so that all of the reported tablets are
+  // persisted in a single batched write.
+  state->mutated_tablets.push_back(tablet.get());
 
   // Need to defer the AlterTable command to after we've committed the new tablet data,
   // since the tablet report may also be updating the raft config, and the Alter Table
   // request needs to know who the most recent leader is.
   if (tablet_needs_alter) {
-    SendAlterTabletRequest(tablet);
+    state->needs_alter_rpc.push_back(tablet);
   } else if (report.has_schema_version()) {
-    HandleTabletSchemaVersionReport(tablet.get(), report.schema_version());
+    state->reported_schema_versions.emplace_back(tablet, report.schema_version());
   }
 
   return Status::OK();
@@ -3482,8 +3548,10 @@ void CatalogManager::SelectReplicas(const TSDescriptorVector& ts_descs,
   }
 }
 
-Status CatalogManager::BuildLocationsForTablet(const scoped_refptr<TabletInfo>& tablet,
-                                               TabletLocationsPB* locs_pb) {
+Status CatalogManager::BuildLocationsForTablet(
+    const scoped_refptr<TabletInfo>& tablet,
+    TabletLocationsPB* locs_pb,
+    unordered_map<string, TSInfoPB>* ts_info_cache) {
   TabletMetadataLock l_tablet(tablet.get(), TabletMetadataLock::READ);
   if (PREDICT_FALSE(l_tablet.data().is_deleted())) {
     return Status::NotFound("Tablet deleted", l_tablet.data().pb.state_msg());
@@ -3504,6 +3572,17 @@ Status CatalogManager::BuildLocationsForTablet(const scoped_refptr<TabletInfo>&
     replica_pb->set_role(GetConsensusRole(peer.permanent_uuid(), cstate));
 
     TSInfoPB* tsinfo_pb = replica_pb->mutable_ts_info();
+
+    // A request spanning many tablets typically places their replicas on the
+    // same handful of servers; serve repeated lookups from the cache.
+    if (ts_info_cache) {
+      const TSInfoPB* cached = FindOrNull(*ts_info_cache, peer.permanent_uuid());
+      if (cached) {
+        tsinfo_pb->CopyFrom(*cached);
+        continue;
+      }
+    }
+
     tsinfo_pb->set_permanent_uuid(peer.permanent_uuid());
 
     shared_ptr<TSDescriptor> ts_desc;
@@ -3518,6 +3597,10 @@ Status CatalogManager::BuildLocationsForTablet(const scoped_refptr<TabletInfo>&
       // TODO: We should track these RPC addresses in the master table itself.
       tsinfo_pb->add_rpc_addresses()->CopyFrom(peer.last_known_addr());
     }
+
+    if (ts_info_cache) {
+      InsertOrDie(ts_info_cache, peer.permanent_uuid(), *tsinfo_pb);
+    }
   }
 
   locs_pb->mutable_partition()->CopyFrom(tablet->metadata().state().pb.partition());
@@ -3576,8 +3659,9 @@ Status CatalogManager::GetTableLocations(const GetTableLocationsRequestPB* req,
   vector<scoped_refptr<TabletInfo> > tablets_in_range;
   table->GetTabletsInRange(req, &tablets_in_range);
 
+  unordered_map<string, TSInfoPB> ts_info_cache;
   for (const scoped_refptr<TabletInfo>& tablet : tablets_in_range) {
-    Status s = BuildLocationsForTablet(tablet, resp->add_tablet_locations());
+    Status s = BuildLocationsForTablet(tablet, resp->add_tablet_locations(), &ts_info_cache);
     if (s.ok()) {
       continue;
     } else if (s.IsNotFound()) {
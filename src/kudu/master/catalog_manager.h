@@ -19,10 +19,12 @@
 
 #include <boost/optional/optional_fwd.hpp>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "kudu/common/partition.h"
@@ -572,17 +574,49 @@ class CatalogManager : public tserver::TabletPeerLookupIf {
   // Builds the TabletLocationsPB for a tablet based on the provided TabletInfo.
   // Populates locs_pb and returns true on success.
   // Returns Status::ServiceUnavailable if tablet is not running.
-  Status BuildLocationsForTablet(const scoped_refptr<TabletInfo>& tablet,
-                                 TabletLocationsPB* locs_pb);
+  // Builds the TabletLocationsPB for a tablet, including its replicas'
+  // addresses. 'ts_info_cache', if not null, caches the TSInfoPB built for
+  // each tablet server so that a request spanning many tablets doesn't
+  // repeatedly look up and copy the registration of the same servers.
+  Status BuildLocationsForTablet(
+      const scoped_refptr<TabletInfo>& tablet,
+      TabletLocationsPB* locs_pb,
+      std::unordered_map<std::string, TSInfoPB>* ts_info_cache = nullptr);
 
   Status FindTable(const TableIdentifierPB& table_identifier,
                    scoped_refptr<TableInfo>* table_info);
 
-  // Handle one of the tablets in a tablet reported.
-  // Requires that the lock is already held.
+  // State accumulated while handling the individual tablets in a tablet
+  // report. The sys catalog updates and follow-up actions collected here are
+  // performed in a single batch at the end of the report rather than once per
+  // reported tablet.
+  struct TabletReportState {
+    // The reported tablets which exist in 'tablet_map_', keyed by tablet ID.
+    TabletInfoMap tablets;
+
+    // Write locks on the above tablets, held until the report's sys catalog
+    // write has completed.
+    std::unordered_map<std::string, std::unique_ptr<TabletMetadataLock>> tablet_locks;
+
+    // Tablets whose mutations must be persisted to the sys catalog.
+    std::vector<TabletInfo*> mutated_tablets;
+
+    // Tablets which require an AlterTable RPC once the report has been
+    // committed.
+    std::vector<scoped_refptr<TabletInfo>> needs_alter_rpc;
+
+    // Tablets (and their reported schema versions) to check for alter
+    // completion once the report has been committed.
+    std::vector<std::pair<scoped_refptr<TabletInfo>, uint32_t>> reported_schema_versions;
+  };
+
+  // Handle one of the tablets in a tablet report. The tablet's write lock in
+  // 'state' must already be held; sys catalog updates and follow-up actions
+  // are deferred into 'state' rather than performed immediately.
   Status HandleReportedTablet(TSDescriptor* ts_desc,
                               const ReportedTabletPB& report,
-                              ReportedTabletUpdatesPB *report_updates);
+                              ReportedTabletUpdatesPB *report_updates,
+                              TabletReportState* state);
 
   Status HandleRaftConfigChanged(const ReportedTabletPB& report,
                                  const scoped_refptr<TabletInfo>& tablet,
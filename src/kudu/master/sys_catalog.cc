@@ -281,6 +281,7 @@ Status SysCatalogTable::SetupTablet(const scoped_refptr<tablet::TabletMetadata>&
       metadata,
       local_peer_pb_,
       apply_pool_.get(),
+      nullptr, // no follower write apply pool: the sys catalog is single-node
       Bind(&SysCatalogTable::SysCatalogStateChanged, Unretained(this), metadata->tablet_id())));
 
   consensus::ConsensusBootstrapInfo consensus_info;
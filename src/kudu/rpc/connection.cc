@@ -57,9 +57,40 @@ using strings::Substitute;
 
 DECLARE_bool(server_require_kerberos);
 
+DEFINE_int32(rpc_writev_batch_bytes, 1024 * 1024,
+             "Maximum number of bytes from multiple queued outbound RPC "
+             "transfers to coalesce into a single writev() system call on a "
+             "connection. Coalescing cuts per-message syscall overhead for "
+             "workloads with many small requests or responses, and lets the "
+             "kernel send full network segments without socket option "
+             "toggling.");
+TAG_FLAG(rpc_writev_batch_bytes, advanced);
+TAG_FLAG(rpc_writev_batch_bytes, runtime);
+
+DEFINE_int32(rpc_small_response_queue_jump_bytes, 16 * 1024,
+             "Maximum size of an RPC response which may be sent ahead of "
+             "larger responses already queued on the same connection. "
+             "Responses to different calls may be delivered in any order, so "
+             "letting small responses (e.g. write acks) jump ahead of large "
+             "ones (e.g. scan batches) avoids head-of-line blocking of "
+             "latency-sensitive calls on connections shared by mixed "
+             "workloads. Set to 0 to always send responses in completion "
+             "order.");
+TAG_FLAG(rpc_small_response_queue_jump_bytes, advanced);
+TAG_FLAG(rpc_small_response_queue_jump_bytes, runtime);
+
 namespace kudu {
 namespace rpc {
 
+namespace {
+
+// Maximum number of iovec entries batched into a single writev() call.
+// Comfortably below typical IOV_MAX (1024) while still large enough to
+// hold the largest single transfer (OutboundTransfer::kMaxPayloadSlices).
+const int kMaxWritevIovecs = 512;
+
+} // anonymous namespace
+
 ///
 /// Connection
 ///
@@ -185,7 +216,37 @@ void Connection::QueueOutbound(gscoped_ptr<OutboundTransfer> transfer) {
 
   DVLOG(3) << "Queueing transfer: " << transfer->HexDump();
 
-  outbound_transfers_.push_back(*transfer.release());
+  OutboundTransfer* t = transfer.release();
+  if (!t->is_for_outbound_call() &&
+      FLAGS_rpc_small_response_queue_jump_bytes > 0 &&
+      t->TotalLength() <= FLAGS_rpc_small_response_queue_jump_bytes) {
+    // Responses to different calls may be sent in any order -- clients match
+    // responses to calls by call ID, not by arrival order. So, a small
+    // response (e.g. a write ack) is inserted ahead of any larger responses
+    // (e.g. multi-megabyte scan batches) which are queued but haven't yet put
+    // any bytes on the wire. Otherwise, a small response sharing the
+    // connection with a large scan sees its latency inflated by the full
+    // serialization time of the scan payload.
+    //
+    // A transfer which has started sending can't be bypassed: its frame must
+    // be contiguous on the stream. Small responses also never jump each
+    // other, and each large response bounds the number of times it may be
+    // jumped, so nothing is starved indefinitely.
+    auto insert_pos = outbound_transfers_.end();
+    while (insert_pos != outbound_transfers_.begin()) {
+      auto prev = insert_pos;
+      --prev;
+      if (prev->TransferStarted() ||
+          prev->TotalLength() <= FLAGS_rpc_small_response_queue_jump_bytes ||
+          !prev->IncrementQueueJumps()) {
+        break;
+      }
+      insert_pos = prev;
+    }
+    outbound_transfers_.insert(insert_pos, *t);
+  } else {
+    outbound_transfers_.push_back(*t);
+  }
 
   if (negotiation_complete_ && !write_io_.is_active()) {
     // If we weren't currently in the middle of sending anything,
@@ -199,18 +260,19 @@ Connection::CallAwaitingResponse::~CallAwaitingResponse() {
   DCHECK(conn->reactor_thread_->IsCurrentThread());
 }
 
-void Connection::CallAwaitingResponse::HandleTimeout(ev::timer &watcher, int revents) {
+void Connection::CallAwaitingResponse::OnTimerWheelExpired() {
   if (remaining_timeout > 0) {
-    if (watcher.remaining() < -1.0) {
+    double lateness = (MonoTime::Now() - deadline()).ToSeconds();
+    if (lateness > 1.0) {
       LOG(WARNING) << "RPC call timeout handler was delayed by "
-                   << -watcher.remaining() << "s! This may be due to a process-wide "
+                   << lateness << "s! This may be due to a process-wide "
                    << "pause such as swapping, logging-related delays, or allocator lock "
                    << "contention. Will allow an additional "
                    << remaining_timeout << "s for a response.";
     }
 
-    watcher.set(remaining_timeout, 0);
-    watcher.start();
+    conn->reactor_thread_->ScheduleCallTimeout(
+        this, MonoTime::Now() + MonoDelta::FromSeconds(remaining_timeout));
     remaining_timeout = 0;
     return;
   }
@@ -221,7 +283,7 @@ void Connection::CallAwaitingResponse::HandleTimeout(ev::timer &watcher, int rev
 void Connection::HandleOutboundCallTimeout(CallAwaitingResponse *car) {
   DCHECK(reactor_thread_->IsCurrentThread());
   DCHECK(car->call);
-  // The timeout timer is stopped by the car destructor exiting Connection::HandleCallResponse()
+  // The wheel entry is cancelled by the car destructor exiting Connection::HandleCallResponse()
   DCHECK(!car->call->IsFinished());
 
   // Mark the call object as failed.
@@ -244,7 +306,7 @@ void Connection::HandleOutboundCallTimeout(CallAwaitingResponse *car) {
 // has been fully transmitted.
 struct CallTransferCallbacks : public TransferCallbacks {
  public:
-  explicit CallTransferCallbacks(shared_ptr<OutboundCall> call)
+  explicit CallTransferCallbacks(scoped_refptr<OutboundCall> call)
       : call_(std::move(call)) {}
 
   virtual void NotifyTransferFinished() OVERRIDE {
@@ -266,10 +328,10 @@ struct CallTransferCallbacks : public TransferCallbacks {
   }
 
  private:
-  shared_ptr<OutboundCall> call_;
+  scoped_refptr<OutboundCall> call_;
 };
 
-void Connection::QueueOutboundCall(const shared_ptr<OutboundCall> &call) {
+void Connection::QueueOutboundCall(const scoped_refptr<OutboundCall> &call) {
   DCHECK(call);
   DCHECK_EQ(direction_, CLIENT);
   DCHECK(reactor_thread_->IsCurrentThread());
@@ -288,9 +350,16 @@ void Connection::QueueOutboundCall(const shared_ptr<OutboundCall> &call) {
   int32_t call_id = GetNextCallId();
   call->set_call_id(call_id);
 
-  // Serialize the actual bytes to be put on the wire.
+  // Serialize the actual bytes to be put on the wire. The negotiated server
+  // feature set may only be consulted once negotiation has completed (before
+  // that, the negotiation thread may still be mutating it); calls serialized
+  // earlier go out uncompressed, so compression of requests kicks in once
+  // the connection is warm.
+  static const set<RpcFeatureFlag> kNoFeatures;
   slices_tmp_.clear();
-  Status s = call->SerializeTo(&slices_tmp_);
+  Status s = call->SerializeTo(
+      negotiation_complete_ ? sasl_client_.server_features() : kNoFeatures,
+      &slices_tmp_);
   if (PREDICT_FALSE(!s.ok())) {
     call->SetFailed(s);
     return;
@@ -302,13 +371,9 @@ void Connection::QueueOutboundCall(const shared_ptr<OutboundCall> &call) {
   car->conn = this;
   car->call = call;
 
-  // Set up the timeout timer.
+  // Set up the timeout on the reactor's timer wheel.
   const MonoDelta &timeout = call->controller()->timeout();
   if (timeout.Initialized()) {
-    reactor_thread_->RegisterTimeout(&car->timeout_timer);
-    car->timeout_timer.set<CallAwaitingResponse, // NOLINT(*)
-                           &CallAwaitingResponse::HandleTimeout>(car.get());
-
     // For calls with a timeout of at least 500ms, we actually run the timeout
     // handler in two stages. The first timeout fires with a timeout 10% less
     // than the user-specified one. It then schedules a second timeout for the
@@ -342,8 +407,8 @@ void Connection::QueueOutboundCall(const shared_ptr<OutboundCall> &call) {
       car->remaining_timeout = 0;
     }
 
-    car->timeout_timer.set(time, 0);
-    car->timeout_timer.start();
+    reactor_thread_->ScheduleCallTimeout(
+        car.get(), MonoTime::Now() + MonoDelta::FromSeconds(time));
   }
 
   TransferCallbacks *cb = new CallTransferCallbacks(call);
@@ -528,7 +593,7 @@ void Connection::HandleCallResponse(gscoped_ptr<InboundTransfer> transfer) {
     return;
   }
 
-  // The car->timeout_timer ev::timer will be stopped automatically by its destructor.
+  // The car's timer wheel entry is cancelled automatically by its destructor.
   scoped_car car(car_pool_.make_scoped_ptr(car_ptr));
 
   if (PREDICT_FALSE(car->call.get() == nullptr)) {
@@ -550,7 +615,6 @@ void Connection::WriteHandler(ev::io &watcher, int revents) {
   }
   DVLOG(3) << ToString() << ": writeHandler: revents = " << revents;
 
-  OutboundTransfer *transfer;
   if (outbound_transfers_.empty()) {
     LOG(WARNING) << ToString() << " got a ready-to-write callback, but there is "
       "nothing to write.";
@@ -559,16 +623,24 @@ void Connection::WriteHandler(ev::io &watcher, int revents) {
   }
 
   while (!outbound_transfers_.empty()) {
-    transfer = &(outbound_transfers_.front());
-
-    if (!transfer->TransferStarted()) {
-
-      if (transfer->is_for_outbound_call()) {
+    // Gather a batch of queued transfers to send with a single writev(),
+    // bounded by the iovec capacity and --rpc_writev_batch_bytes. As each
+    // transfer joins the batch, run its pre-send checks.
+    struct iovec iov[kMaxWritevIovecs];
+    int n_iovs = 0;
+    int64_t batched_bytes = 0;
+    auto it = outbound_transfers_.begin();
+    while (it != outbound_transfers_.end() &&
+           n_iovs < kMaxWritevIovecs &&
+           batched_bytes < FLAGS_rpc_writev_batch_bytes) {
+      OutboundTransfer* transfer = &*it;
+
+      if (!transfer->TransferStarted() && transfer->is_for_outbound_call()) {
         CallAwaitingResponse* car = FindOrDie(awaiting_response_, transfer->call_id());
         if (!car->call) {
           // If the call has already timed out, then the 'call' field will have been nulled.
           // In that case, we don't need to bother sending it.
-          outbound_transfers_.pop_front();
+          it = outbound_transfers_.erase(it);
           transfer->Abort(Status::Aborted("already timed out"));
           delete transfer;
           continue;
@@ -582,7 +654,7 @@ void Connection::WriteHandler(ev::io &watcher, int revents) {
         const set<RpcFeatureFlag>& server_features = sasl_client_.server_features();
         if (!includes(server_features.begin(), server_features.end(),
                       required_features.begin(), required_features.end())) {
-          outbound_transfers_.pop_front();
+          it = outbound_transfers_.erase(it);
           Status s = Status::NotSupported("server does not support the required RPC features");
           transfer->Abort(s);
           car->call->SetFailed(s);
@@ -591,25 +663,56 @@ void Connection::WriteHandler(ev::io &watcher, int revents) {
           continue;
         }
 
+        // NOTE: SetSending() is idempotent; a transfer which joined a batch
+        // but received none of the written bytes is re-checked here on the
+        // next write.
         car->call->SetSending();
       }
+
+      int n = transfer->FillIovecs(&iov[n_iovs], kMaxWritevIovecs - n_iovs);
+      if (n == 0) break;
+      for (int i = 0; i < n; i++) {
+        batched_bytes += iov[n_iovs + i].iov_len;
+      }
+      n_iovs += n;
+      ++it;
+    }
+
+    if (n_iovs == 0) {
+      // Every queued transfer was aborted above.
+      break;
     }
 
     last_activity_time_ = reactor_thread_->cur_time();
-    Status status = transfer->SendBuffer(*socket_);
+    int32_t written = 0;
+    Status status = socket_->Writev(iov, n_iovs, &written);
     if (PREDICT_FALSE(!status.ok())) {
+      if (Socket::IsTemporarySocketError(status.posix_code())) {
+        // The socket stopped accepting data partway through the batch;
+        // we'll pick up where we left off on the next writable event.
+        return;
+      }
       LOG(WARNING) << ToString() << " send error: " << status.ToString();
       reactor_thread_->DestroyConnection(this, status);
       return;
     }
 
-    if (!transfer->TransferFinished()) {
-      DVLOG(3) << ToString() << ": writeHandler: xfer not finished.";
-      return;
+    // Attribute the written bytes to the batched transfers in queue order,
+    // retiring those which completed.
+    while (!outbound_transfers_.empty()) {
+      OutboundTransfer* transfer = &outbound_transfers_.front();
+      written -= transfer->AdvanceSentBytes(written);
+      if (!transfer->TransferFinished()) {
+        DCHECK_EQ(0, written);
+        DVLOG(3) << ToString() << ": writeHandler: xfer not finished.";
+        return;
+      }
+      outbound_transfers_.pop_front();
+      delete transfer;
+      if (written == 0) {
+        break;
+      }
     }
-
-    outbound_transfers_.pop_front();
-    delete transfer;
   }
 
   // If we were able to write all of our outbound transfers,
@@ -29,9 +29,11 @@
 #include <vector>
 
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/rpc/outbound_call.h"
 #include "kudu/rpc/sasl_client.h"
+#include "kudu/rpc/timer_wheel.h"
 #include "kudu/rpc/sasl_server.h"
 #include "kudu/rpc/inbound_call.h"
 #include "kudu/rpc/transfer.h"
@@ -109,7 +111,7 @@ class Connection : public RefCountedThreadSafe<Connection> {
   // marked failed.
   // Takes ownership of the 'call' object regardless of whether it succeeds or fails.
   // This may be called from a non-reactor thread.
-  void QueueOutboundCall(const std::shared_ptr<OutboundCall> &call);
+  void QueueOutboundCall(const scoped_refptr<OutboundCall> &call);
 
   // Queue a call response back to the client on the server side.
   //
@@ -128,6 +130,12 @@ class Connection : public RefCountedThreadSafe<Connection> {
   // Get the user credentials which will be used to log in.
   const UserCredentials &user_credentials() const { return user_credentials_; }
 
+  // The connection shard index from the ConnectionId which established this
+  // client connection (see ConnectionId::idx()). Used to reconstruct the map
+  // key when unregistering the connection from the reactor.
+  void set_conn_idx(int conn_idx) { conn_idx_ = conn_idx; }
+  int conn_idx() const { return conn_idx_; }
+
   RpczStore* rpcz_store();
 
   // libev callback when data is available to read.
@@ -176,15 +184,18 @@ class Connection : public RefCountedThreadSafe<Connection> {
 
   // A call which has been fully sent to the server, which we're waiting for
   // the server to process. This is used on the client side only.
-  struct CallAwaitingResponse {
-    ~CallAwaitingResponse();
+  //
+  // The timeout, if any, is tracked on the reactor thread's timer wheel;
+  // destroying the object cancels it.
+  struct CallAwaitingResponse : public TimerWheelEntry {
+    virtual ~CallAwaitingResponse();
 
-    // Notification from libev that the call has timed out.
-    void HandleTimeout(ev::timer &watcher, int revents);
+    // Notification from the reactor's timer wheel that the call has timed
+    // out.
+    virtual void OnTimerWheelExpired() OVERRIDE;
 
     Connection *conn;
-    std::shared_ptr<OutboundCall> call;
-    ev::timer timeout_timer;
+    scoped_refptr<OutboundCall> call;
 
     // We time out RPC calls in two stages. This is set to the amount of timeout
     // remaining after the next timeout fires. See Connection::QueueOutboundCall().
@@ -237,6 +248,9 @@ class Connection : public RefCountedThreadSafe<Connection> {
   // The credentials of the user operating on this connection (if a client user).
   UserCredentials user_credentials_;
 
+  // The connection shard index, for client connections. See ConnectionId::idx().
+  int conn_idx_ = 0;
+
   // whether we are client or server
   Direction direction_;
 
@@ -17,9 +17,12 @@
 
 #include "kudu/rpc/inbound_call.h"
 
+#include <cstring>
+#include <gflags/gflags.h>
 #include <glog/stl_logging.h>
 #include <memory>
 
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/connection.h"
 #include "kudu/rpc/rpc_introspection.pb.h"
@@ -27,10 +30,21 @@
 #include "kudu/rpc/rpcz_store.h"
 #include "kudu/rpc/serialization.h"
 #include "kudu/rpc/service_if.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/debug/trace_event.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/trace.h"
 
+DEFINE_int32(rpc_trace_sample_period, 1,
+             "Record trace messages for only one in this many inbound RPCs. "
+             "Sampled calls carry a full trace; the rest skip message "
+             "recording entirely, keeping always-on tracing cheap under "
+             "load. A value of 1 (the default) traces every call. Trace "
+             "metrics are collected for all calls regardless.");
+TAG_FLAG(rpc_trace_sample_period, advanced);
+TAG_FLAG(rpc_trace_sample_period, runtime);
+
 using google::protobuf::FieldDescriptor;
 using google::protobuf::io::CodedOutputStream;
 using google::protobuf::Message;
@@ -42,11 +56,23 @@ using strings::Substitute;
 namespace kudu {
 namespace rpc {
 
+namespace {
+
+// Counter used to pick which inbound calls record trace messages when
+// --rpc_trace_sample_period is greater than 1.
+AtomicInt<uint64_t> g_trace_sample_counter(0);
+
+} // anonymous namespace
+
 InboundCall::InboundCall(Connection* conn)
   : conn_(conn),
     sidecars_deleter_(&sidecars_),
     trace_(new Trace),
     method_info_(nullptr) {
+  int32_t sample_period = FLAGS_rpc_trace_sample_period;
+  if (PREDICT_FALSE(sample_period > 1)) {
+    trace_->set_enabled(g_trace_sample_counter.Increment() % sample_period == 0);
+  }
   RecordCallReceived();
 }
 
@@ -57,6 +83,20 @@ Status InboundCall::ParseFrom(gscoped_ptr<InboundTransfer> transfer) {
   TRACE_EVENT0("rpc", "InboundCall::ParseFrom");
   RETURN_NOT_OK(serialization::ParseMessage(transfer->data(), &header_, &serialized_request_));
 
+  // If the client compressed the request body, decompress it before handing
+  // the parameter protobuf to the service.
+  if (PREDICT_FALSE(header_.body_compression_codec() != COMPRESSION_NONE)) {
+    if (header_.body_compression_codec() != COMPRESSION_LZ4 ||
+        !header_.has_uncompressed_body_length()) {
+      return Status::Corruption(Substitute(
+          "Request body compressed with unsupported codec $0",
+          header_.body_compression_codec()));
+    }
+    RETURN_NOT_OK(serialization::DecompressBody(
+        serialized_request_, header_.uncompressed_body_length(), &uncompressed_body_buf_));
+    serialized_request_ = Slice(uncompressed_body_buf_);
+  }
+
   // Adopt the service/method info from the header as soon as it's available.
   if (PREDICT_FALSE(!header_.has_remote_method())) {
     return Status::Corruption("Non-connection context request header must specify remote_method");
@@ -157,6 +197,33 @@ void InboundCall::SerializeResponseBuffer(const MessageLite& response,
   }
 
   int additional_size = absolute_sidecar_offset - protobuf_msg_size;
+
+  // If the client supports it, try to compress the response body (the
+  // response protobuf together with any sidecars) as a single frame. The
+  // sidecar offsets above refer to the uncompressed body, so they need no
+  // adjustment. The client's feature set was fixed when negotiation
+  // completed, before any calls were accepted on this connection.
+  if (ContainsKey(conn_->sasl_server().client_features(), WIRE_COMPRESSION) &&
+      serialization::ShouldCompressBody(absolute_sidecar_offset)) {
+    faststring body;
+    body.resize(absolute_sidecar_offset);
+    uint8_t* dst = response.SerializeWithCachedSizesToArray(body.data());
+    for (RpcSidecar* car : sidecars_) {
+      Slice s = car->AsSlice();
+      memcpy(dst, s.data(), s.size());
+      dst += s.size();
+    }
+    DCHECK_EQ(dst, body.data() + body.size());
+    if (serialization::CompressBody(Slice(body), &response_msg_buf_)) {
+      resp_hdr.set_body_compression_codec(COMPRESSION_LZ4);
+      resp_hdr.set_uncompressed_body_length(body.size());
+      response_compressed_ = true;
+      serialization::SerializeHeader(resp_hdr, response_msg_buf_.size(),
+                                     &response_hdr_buf_);
+      return;
+    }
+  }
+
   serialization::SerializeMessage(response, &response_msg_buf_,
                                   additional_size, true);
   int main_msg_size = additional_size + response_msg_buf_.size();
@@ -171,8 +238,12 @@ void InboundCall::SerializeResponseTo(vector<Slice>* slices) const {
   slices->reserve(slices->size() + 2 + sidecars_.size());
   slices->push_back(Slice(response_hdr_buf_));
   slices->push_back(Slice(response_msg_buf_));
-  for (RpcSidecar* car : sidecars_) {
-    slices->push_back(car->AsSlice());
+  // When the response was compressed, the sidecars are part of the
+  // compressed frame in 'response_msg_buf_'.
+  if (!response_compressed_) {
+    for (RpcSidecar* car : sidecars_) {
+      slices->push_back(car->AsSlice());
+    }
   }
 }
 
@@ -209,7 +280,7 @@ void InboundCall::DumpPB(const DumpRunningRpcsRequestPB& req,
   if (req.include_traces() && trace_) {
     resp->set_trace_buffer(trace_->DumpToString());
   }
-  resp->set_micros_elapsed((MonoTime::Now() - timing_.time_received)
+  resp->set_micros_elapsed((MonoTime::NowCoarse() - timing_.time_received)
                            .ToMicroseconds());
 }
 
@@ -232,20 +303,22 @@ Trace* InboundCall::trace() {
 void InboundCall::RecordCallReceived() {
   TRACE_EVENT_ASYNC_BEGIN0("rpc", "InboundCall", this);
   DCHECK(!timing_.time_received.Initialized());  // Protect against multiple calls.
-  timing_.time_received = MonoTime::Now();
+  // The RPC timing metrics only need tick-level resolution, so use the
+  // coarse clock: these stamps are taken for every inbound call.
+  timing_.time_received = MonoTime::NowCoarse();
 }
 
 void InboundCall::RecordHandlingStarted(scoped_refptr<Histogram> incoming_queue_time) {
   DCHECK(incoming_queue_time != nullptr);
   DCHECK(!timing_.time_handled.Initialized());  // Protect against multiple calls.
-  timing_.time_handled = MonoTime::Now();
+  timing_.time_handled = MonoTime::NowCoarse();
   incoming_queue_time->Increment(
       (timing_.time_handled - timing_.time_received).ToMicroseconds());
 }
 
 void InboundCall::RecordHandlingCompleted() {
   DCHECK(!timing_.time_completed.Initialized());  // Protect against multiple calls.
-  timing_.time_completed = MonoTime::Now();
+  timing_.time_completed = MonoTime::NowCoarse();
 
   if (!timing_.time_handled.Initialized()) {
     // Sometimes we respond to a call before we begin handling it (e.g. due to queue
@@ -264,7 +337,7 @@ bool InboundCall::ClientTimedOut() const {
     return false;
   }
 
-  MonoTime now = MonoTime::Now();
+  MonoTime now = MonoTime::NowCoarse();
   int total_time = (now - timing_.time_received).ToMilliseconds();
   return total_time > header_.timeout_millis();
 }
@@ -213,7 +213,8 @@ class InboundCall {
   RequestHeader header_;
 
   // The serialized bytes of the request param protobuf. Set by ParseFrom().
-  // This references memory held by 'transfer_'.
+  // This references memory held by 'transfer_' (or 'uncompressed_body_buf_'
+  // if the request was sent compressed).
   Slice serialized_request_;
 
   // The transfer that produced the call.
@@ -221,9 +222,17 @@ class InboundCall {
   // by 'serialized_request_' above.
   gscoped_ptr<InboundTransfer> transfer_;
 
+  // If the request body was compressed for the wire, holds the decompressed
+  // body which 'serialized_request_' refers into.
+  faststring uncompressed_body_buf_;
+
   // The buffers for serialized response. Set by SerializeResponseBuffer().
+  // If the response body was compressed for the wire,
+  // 'response_msg_buf_' holds the compressed frame covering both the
+  // response protobuf and the sidecars.
   faststring response_hdr_buf_;
   faststring response_msg_buf_;
+  bool response_compressed_ = false;
 
   // Vector of additional sidecars that are tacked on to the call's response
   // after serialization of the protobuf. See rpc/rpc_sidecar.h for more info.
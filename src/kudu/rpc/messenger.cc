@@ -24,6 +24,7 @@
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
+#include <algorithm>
 #include <list>
 #include <mutex>
 #include <set>
@@ -83,6 +84,15 @@ DEFINE_bool(server_require_kerberos, false,
 // it's a useful stop-gap.
 TAG_FLAG(server_require_kerberos, experimental);
 
+DEFINE_int32(rpc_connections_per_remote, 1,
+             "Number of TCP connections to open to each remote server, spread "
+             "across the reactor threads. Each Proxy is assigned one of these "
+             "connections round-robin at creation, so the calls made through "
+             "a single proxy stay on one connection (preserving their relative "
+             "ordering, as consensus requires) while independent proxies to "
+             "the same remote fan out over separate connections and reactors.");
+TAG_FLAG(rpc_connections_per_remote, advanced);
+
 namespace kudu {
 namespace rpc {
 
@@ -239,8 +249,8 @@ Status Messenger::UnregisterService(const string& service_name) {
   }
 }
 
-void Messenger::QueueOutboundCall(const shared_ptr<OutboundCall> &call) {
-  Reactor *reactor = RemoteToReactor(call->conn_id().remote());
+void Messenger::QueueOutboundCall(const scoped_refptr<OutboundCall> &call) {
+  Reactor *reactor = RemoteToReactor(call->conn_id().remote(), call->conn_id().idx());
   reactor->QueueOutboundCall(call);
 }
 
@@ -270,6 +280,7 @@ void Messenger::RegisterInboundSocket(Socket *new_socket, const Sockaddr &remote
 Messenger::Messenger(const MessengerBuilder &bld)
   : name_(bld.name_),
     closing_(false),
+    next_connection_idx_(0),
     rpcz_store_(new RpczStore()),
     metric_entity_(bld.metric_entity_),
     retain_self_(this) {
@@ -288,14 +299,19 @@ Messenger::~Messenger() {
   STLDeleteElements(&reactors_);
 }
 
-Reactor* Messenger::RemoteToReactor(const Sockaddr &remote) {
+Reactor* Messenger::RemoteToReactor(const Sockaddr &remote, int conn_idx) {
   uint32_t hashCode = remote.HashCode();
-  int reactor_idx = hashCode % reactors_.size();
+  int reactor_idx = (hashCode + conn_idx) % reactors_.size();
   // This is just a static partitioning; we could get a lot
   // fancier with assigning Sockaddrs to Reactors.
   return reactors_[reactor_idx];
 }
 
+int Messenger::NextConnectionIdx() {
+  int num_conns = std::max(1, FLAGS_rpc_connections_per_remote);
+  return next_connection_idx_.Increment() % num_conns;
+}
+
 
 Status Messenger::Init() {
   Status status;
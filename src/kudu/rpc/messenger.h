@@ -30,6 +30,7 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/rpc/response_callback.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
@@ -163,7 +164,7 @@ class Messenger {
 
   // Queue a call for transmission. This will pick the appropriate reactor,
   // and enqueue a task on that reactor to assign and send the call.
-  void QueueOutboundCall(const std::shared_ptr<OutboundCall> &call);
+  void QueueOutboundCall(const scoped_refptr<OutboundCall> &call);
 
   // Enqueue a call for processing on the server.
   void QueueInboundCall(gscoped_ptr<InboundCall> call);
@@ -190,6 +191,13 @@ class Messenger {
 
   int num_reactors() const { return reactors_.size(); }
 
+  // Return the connection shard index which a newly created Proxy should
+  // assign to its ConnectionId. Indexes rotate round-robin over
+  // --rpc_connections_per_remote, so proxies to the same remote fan out over
+  // separate connections (and thus reactors) while the calls made through any
+  // one proxy keep connection affinity.
+  int NextConnectionIdx();
+
   std::string name() const {
     return name_;
   }
@@ -207,10 +215,11 @@ class Messenger {
 
  private:
   FRIEND_TEST(TestRpc, TestConnectionKeepalive);
+  FRIEND_TEST(TestRpc, TestConnectionsPerRemote);
 
   explicit Messenger(const MessengerBuilder &bld);
 
-  Reactor* RemoteToReactor(const Sockaddr &remote);
+  Reactor* RemoteToReactor(const Sockaddr &remote, int conn_idx = 0);
   Status Init();
   void RunTimeoutThread();
   void UpdateCurTime();
@@ -239,6 +248,9 @@ class Messenger {
 
   std::vector<Reactor*> reactors_;
 
+  // Round-robin counter backing NextConnectionIdx().
+  AtomicInt<int32_t> next_connection_idx_;
+
   gscoped_ptr<ThreadPool> negotiation_pool_;
 
   gscoped_ptr<SSLFactory> ssl_factory_;
@@ -18,11 +18,16 @@
 #include <algorithm>
 #include <boost/functional/hash.hpp>
 #include <gflags/gflags.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <memory>
 #include <mutex>
+#include <set>
 #include <string>
 #include <unordered_set>
 #include <vector>
 
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/once.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/walltime.h"
 #include "kudu/rpc/outbound_call.h"
@@ -44,31 +49,138 @@ DEFINE_int64(rpc_callback_max_cycles, 100 * 1000 * 1000,
 TAG_FLAG(rpc_callback_max_cycles, advanced);
 TAG_FLAG(rpc_callback_max_cycles, runtime);
 
+DEFINE_int32(rpc_outbound_call_pool_size, 256,
+             "Maximum number of finished outbound RPC call objects retained "
+             "for reuse by subsequent calls. Recycled calls keep the capacity "
+             "of their serialization buffers, making the steady-state client "
+             "call path nearly allocation-free. Set to 0 to disable pooling.");
+TAG_FLAG(rpc_outbound_call_pool_size, advanced);
+
 namespace kudu {
 namespace rpc {
 
 using google::protobuf::Message;
+using google::protobuf::io::CodedInputStream;
+using std::set;
 using strings::Substitute;
 
 static const double kMicrosPerSecond = 1000000.0;
 
+namespace {
+
+// Calls whose request serialization buffer has grown beyond this many bytes
+// are freed rather than pooled, so that a burst of large requests does not
+// pin memory indefinitely.
+const size_t kMaxPooledCallBufferSize = 1024 * 1024;
+
+// Process-wide pool of finished OutboundCall instances, kept so that the
+// serialization buffers allocated for one call can be reused by the next.
+// Calls are allocated and released on client threads, so a single
+// spinlock-guarded freelist suffices; the critical section is a vector
+// push/pop.
+struct OutboundCallPool {
+  simple_spinlock lock;
+  std::vector<OutboundCall*> calls;
+};
+
+OutboundCallPool* g_call_pool = nullptr;
+GoogleOnceType g_call_pool_once = GOOGLE_ONCE_INIT;
+
+void CreateCallPool() {
+  g_call_pool = new OutboundCallPool();
+}
+
+OutboundCallPool* GetCallPool() {
+  GoogleOnceInit(&g_call_pool_once, &CreateCallPool);
+  return g_call_pool;
+}
+
+} // anonymous namespace
+
 ///
 /// OutboundCall
 ///
 
+scoped_refptr<OutboundCall> OutboundCall::Create(
+    const ConnectionId& conn_id,
+    const RemoteMethod& remote_method,
+    google::protobuf::Message* response_storage,
+    RpcController* controller, ResponseCallback callback) {
+  OutboundCall* call = nullptr;
+  if (PREDICT_TRUE(FLAGS_rpc_outbound_call_pool_size > 0)) {
+    OutboundCallPool* pool = GetCallPool();
+    std::lock_guard<simple_spinlock> l(pool->lock);
+    if (!pool->calls.empty()) {
+      call = pool->calls.back();
+      pool->calls.pop_back();
+    }
+  }
+  if (call != nullptr) {
+    call->Reset(conn_id, remote_method, response_storage, controller,
+                std::move(callback));
+  } else {
+    call = new OutboundCall(conn_id, remote_method, response_storage,
+                            controller, std::move(callback));
+  }
+  return scoped_refptr<OutboundCall>(call);
+}
+
+void OutboundCall::ReturnToPool(OutboundCall* call) {
+  DCHECK(call->IsFinished());
+  DCHECK(base::RefCountIsZero(&call->ref_count_));
+  // Release per-call state eagerly: the response may hold large transfer
+  // buffers and the callback may own bound state, neither of which should
+  // sit in the pool.
+  call->call_response_.reset();
+  call->error_pb_.reset();
+  call->callback_ = ResponseCallback();
+  call->header_.Clear();
+  call->controller_ = nullptr;
+  call->response_ = nullptr;
+  if (call->request_buf_.capacity() <= kMaxPooledCallBufferSize &&
+      FLAGS_rpc_outbound_call_pool_size > 0) {
+    OutboundCallPool* pool = GetCallPool();
+    std::lock_guard<simple_spinlock> l(pool->lock);
+    if (pool->calls.size() < static_cast<size_t>(FLAGS_rpc_outbound_call_pool_size)) {
+      pool->calls.push_back(call);
+      return;
+    }
+  }
+  delete call;
+}
+
 OutboundCall::OutboundCall(const ConnectionId& conn_id,
                            const RemoteMethod& remote_method,
                            google::protobuf::Message* response_storage,
                            RpcController* controller, ResponseCallback callback)
     : state_(READY),
-      remote_method_(remote_method),
-      conn_id_(conn_id),
-      callback_(std::move(callback)),
-      controller_(DCHECK_NOTNULL(controller)),
-      response_(DCHECK_NOTNULL(response_storage)) {
-  DVLOG(4) << "OutboundCall " << this << " constructed with state_: " << StateName(state_)
+      ref_count_(0) {
+  Reset(conn_id, remote_method, response_storage, controller, std::move(callback));
+}
+
+void OutboundCall::Reset(const ConnectionId& conn_id,
+                         const RemoteMethod& remote_method,
+                         google::protobuf::Message* response_storage,
+                         RpcController* controller, ResponseCallback callback) {
+  state_ = READY;
+  status_ = Status::OK();
+  error_pb_.reset();
+  remote_method_ = remote_method;
+  required_rpc_features_.clear();
+  conn_id_.CopyFrom(conn_id);
+  callback_ = std::move(callback);
+  controller_ = DCHECK_NOTNULL(controller);
+  response_ = DCHECK_NOTNULL(response_storage);
+  // The buffers keep any capacity from a previous use of this instance.
+  header_buf_.clear();
+  request_buf_.clear();
+  compressed_request_buf_.clear();
+  call_response_.reset();
+
+  DVLOG(4) << "OutboundCall " << this << " initialized with state_: " << StateName(state_)
            << " and RPC timeout: "
            << (controller->timeout().Initialized() ? controller->timeout().ToString() : "none");
+  header_.Clear();
   header_.set_call_id(kInvalidCallId);
   remote_method.ToPB(header_.mutable_remote_method());
   start_time_ = MonoTime::Now();
@@ -87,9 +199,9 @@ OutboundCall::~OutboundCall() {
   DVLOG(4) << "OutboundCall " << this << " destroyed with state_: " << StateName(state_);
 }
 
-Status OutboundCall::SerializeTo(vector<Slice>* slices) {
-  size_t param_len = request_buf_.size();
-  if (PREDICT_FALSE(param_len == 0)) {
+Status OutboundCall::SerializeTo(const set<RpcFeatureFlag>& server_features,
+                                 vector<Slice>* slices) {
+  if (PREDICT_FALSE(request_buf_.size() == 0)) {
     return Status::InvalidArgument("Must call SetRequestParam() before SerializeTo()");
   }
 
@@ -102,11 +214,31 @@ Status OutboundCall::SerializeTo(vector<Slice>* slices) {
     header_.add_required_feature_flags(feature);
   }
 
-  serialization::SerializeHeader(header_, param_len, &header_buf_);
+  // If the server supports it, try to compress the request body. The body in
+  // 'request_buf_' is the parameter protobuf preceded by a varint delimiter;
+  // strip the delimiter to get at the protobuf itself, since the compressed
+  // frame carries its own delimiter.
+  Slice body(request_buf_);
+  {
+    CodedInputStream in(body.data(), body.size());
+    uint32_t uncompressed_len;
+    CHECK(in.ReadVarint32(&uncompressed_len));
+    body.remove_prefix(body.size() - uncompressed_len);
+  }
+  if (ContainsKey(server_features, WIRE_COMPRESSION) &&
+      serialization::ShouldCompressBody(body.size()) &&
+      serialization::CompressBody(body, &compressed_request_buf_)) {
+    header_.set_body_compression_codec(COMPRESSION_LZ4);
+    header_.set_uncompressed_body_length(body.size());
+  }
+  const faststring& body_buf = header_.has_body_compression_codec() ?
+      compressed_request_buf_ : request_buf_;
+
+  serialization::SerializeHeader(header_, body_buf.size(), &header_buf_);
 
   // Return the concatenated packet.
   slices->push_back(Slice(header_buf_));
-  slices->push_back(Slice(request_buf_));
+  slices->push_back(Slice(body_buf));
   return Status::OK();
 }
 
@@ -253,6 +385,7 @@ void OutboundCall::SetSent() {
   // which allocated it -- this lets it keep to thread-local operations instead
   // of taking a mutex to put memory back on the global freelist.
   delete [] header_buf_.release();
+  delete [] compressed_request_buf_.release();
 
   // request_buf_ is also done being used here, but since it was allocated by
   // the caller thread, we would rather let that thread free it whenever it
@@ -407,6 +540,10 @@ void ConnectionId::set_remote(const Sockaddr& remote) {
   remote_ = remote;
 }
 
+void ConnectionId::set_idx(int idx) {
+  idx_ = idx;
+}
+
 void ConnectionId::set_user_credentials(const UserCredentials& user_credentials) {
   user_credentials_.CopyFrom(user_credentials);
 }
@@ -417,26 +554,30 @@ void ConnectionId::CopyFrom(const ConnectionId& other) {
 
 string ConnectionId::ToString() const {
   // Does not print the password.
-  return StringPrintf("{remote=%s, user_credentials=%s}",
+  return StringPrintf("{remote=%s, user_credentials=%s, idx=%d}",
       remote_.ToString().c_str(),
-      user_credentials_.ToString().c_str());
+      user_credentials_.ToString().c_str(),
+      idx_);
 }
 
 void ConnectionId::DoCopyFrom(const ConnectionId& other) {
   remote_ = other.remote_;
   user_credentials_.CopyFrom(other.user_credentials_);
+  idx_ = other.idx_;
 }
 
 size_t ConnectionId::HashCode() const {
   size_t seed = 0;
   boost::hash_combine(seed, remote_.HashCode());
   boost::hash_combine(seed, user_credentials_.HashCode());
+  boost::hash_combine(seed, idx_);
   return seed;
 }
 
 bool ConnectionId::Equals(const ConnectionId& other) const {
   return (remote() == other.remote()
-       && user_credentials().Equals(other.user_credentials()));
+       && user_credentials().Equals(other.user_credentials())
+       && idx() == other.idx());
 }
 
 size_t ConnectionIdHash::operator() (const ConnectionId& conn_id) const {
@@ -471,6 +612,21 @@ Status CallResponse::ParseFrom(gscoped_ptr<InboundTransfer> transfer) {
   RETURN_NOT_OK(serialization::ParseMessage(transfer->data(), &header_,
                                             &entire_message));
 
+  // If the server compressed the body, decompress it before slicing out the
+  // sidecars: the sidecar offsets in the header refer to the uncompressed
+  // body.
+  if (PREDICT_FALSE(header_.body_compression_codec() != COMPRESSION_NONE)) {
+    if (header_.body_compression_codec() != COMPRESSION_LZ4 ||
+        !header_.has_uncompressed_body_length()) {
+      return Status::Corruption(strings::Substitute(
+          "Response body compressed with unsupported codec $0",
+          header_.body_compression_codec()));
+    }
+    RETURN_NOT_OK(serialization::DecompressBody(
+        entire_message, header_.uncompressed_body_length(), &uncompressed_body_buf_));
+    entire_message = Slice(uncompressed_body_buf_);
+  }
+
   // Use information from header to extract the payload slices.
   int last = header_.sidecar_offsets_size() - 1;
 
@@ -481,6 +637,7 @@ Status CallResponse::ParseFrom(gscoped_ptr<InboundTransfer> transfer) {
   }
 
   if (last >= 0) {
+    sidecar_slices_.resize(last + 1);
     serialized_response_ = Slice(entire_message.data(),
                                  header_.sidecar_offsets(0));
     for (int i = 0; i < last; ++i) {
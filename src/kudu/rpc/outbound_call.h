@@ -17,14 +17,17 @@
 #ifndef KUDU_RPC_CLIENT_CALL_H
 #define KUDU_RPC_CLIENT_CALL_H
 
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
 
 #include <glog/logging.h>
 
+#include "kudu/gutil/atomic_refcount.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
 #include "kudu/rpc/constants.h"
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/rpc/remote_method.h"
@@ -99,6 +102,16 @@ class ConnectionId {
   void set_remote(const Sockaddr& remote);
   const Sockaddr& remote() const { return remote_; }
 
+  // The connection shard index. Traffic to the same remote (and credentials)
+  // but with different shard indexes uses distinct TCP connections, typically
+  // on distinct reactor threads, so that one busy peer link is not limited to
+  // a single connection and reactor. Calls which require mutual ordering
+  // should use the same shard index (each Proxy keeps a fixed index, so
+  // calls through one proxy retain affinity). See
+  // --rpc_connections_per_remote.
+  void set_idx(int idx);
+  int idx() const { return idx_; }
+
   // The credentials of the user associated with this connection, if any.
   void set_user_credentials(const UserCredentials& user_credentials);
   const UserCredentials& user_credentials() const { return user_credentials_; }
@@ -117,6 +130,7 @@ class ConnectionId {
   // Remember to update HashCode() and Equals() when new fields are added.
   Sockaddr remote_;
   UserCredentials user_credentials_;
+  int idx_ = 0;
 
   // Implementation of CopyFrom that can be shared with copy constructor.
   void DoCopyFrom(const ConnectionId& other);
@@ -141,11 +155,40 @@ class ConnectionIdEqual {
 // RpcController class.
 //
 // This is allocated by the Proxy when a call is first created,
-// then passed to the reactor thread to send on the wire. It's typically
-// kept using a shared_ptr because a call may terminate in any number
-// of different threads, making it tricky to enforce single ownership.
+// then passed to the reactor thread to send on the wire. It's kept using
+// scoped_refptr because a call may terminate in any number of different
+// threads, making it tricky to enforce single ownership. The refcount is
+// intrusive so that the call, its references, and its serialization buffers
+// are all carried by a single (pooled) allocation rather than a web of
+// shared_ptr control blocks.
 class OutboundCall {
  public:
+  // Obtain a call instance, either recycled from the process-wide pool of
+  // finished calls or newly allocated. Recycled instances retain the capacity
+  // of their serialization buffers, so a client issuing a steady stream of
+  // calls (including retries of the same call) reuses the same buffers
+  // rather than allocating fresh ones per RPC. When the last reference is
+  // dropped the instance is handed back to the pool. See
+  // --rpc_outbound_call_pool_size.
+  static scoped_refptr<OutboundCall> Create(
+      const ConnectionId& conn_id, const RemoteMethod& remote_method,
+      google::protobuf::Message* response_storage,
+      RpcController* controller, ResponseCallback callback);
+
+  // Intrusive refcounting, compatible with scoped_refptr. We don't inherit
+  // RefCountedThreadSafe because its debug-build bookkeeping assumes an
+  // object is destroyed when its count reaches zero, which is not true for
+  // pooled instances: dropping the last reference returns the call to the
+  // pool, from which it may be handed out (and ref'd) again.
+  void AddRef() const {
+    base::RefCountInc(&ref_count_);
+  }
+  void Release() const {
+    if (!base::RefCountDec(&ref_count_)) {
+      ReturnToPool(const_cast<OutboundCall*>(this));
+    }
+  }
+
   OutboundCall(const ConnectionId& conn_id, const RemoteMethod& remote_method,
                google::protobuf::Message* response_storage,
                RpcController* controller, ResponseCallback callback);
@@ -167,7 +210,13 @@ class OutboundCall {
 
   // Serialize the call for the wire. Requires that SetRequestParam()
   // is called first. This is called from the Reactor thread.
-  Status SerializeTo(std::vector<Slice>* slices);
+  //
+  // 'server_features' is the set of RPC features negotiated with the server,
+  // used to decide whether the request body may be compressed. Calls which
+  // are serialized before negotiation completes see an empty set and are
+  // sent uncompressed.
+  Status SerializeTo(const std::set<RpcFeatureFlag>& server_features,
+                     std::vector<Slice>* slices);
 
   // Callback after the call has been put on the outbound connection queue.
   void SetQueued();
@@ -243,6 +292,18 @@ class OutboundCall {
 
   static std::string StateName(State state);
 
+  // Initialize this instance for a new call. Used both by the constructor
+  // and to recycle a pooled instance; in the latter case the serialization
+  // buffers keep their capacity from the previous call.
+  void Reset(const ConnectionId& conn_id, const RemoteMethod& remote_method,
+             google::protobuf::Message* response_storage,
+             RpcController* controller, ResponseCallback callback);
+
+  // Called by Release() when the last reference is dropped: releases the
+  // call's per-call state and returns the instance to the pool (or frees it
+  // if the pool is full).
+  static void ReturnToPool(OutboundCall* call);
+
   void set_state(State new_state);
   State state() const;
 
@@ -293,10 +354,18 @@ class OutboundCall {
   faststring header_buf_;
   faststring request_buf_;
 
+  // If the request body was compressed for the wire, holds the compressed
+  // body which is sent in place of 'request_buf_'. Populated by
+  // SerializeTo() on the reactor thread.
+  faststring compressed_request_buf_;
+
   // Once a response has been received for this call, contains that response.
   // Otherwise NULL.
   gscoped_ptr<CallResponse> call_response_;
 
+  // Intrusive reference count; see AddRef()/Release().
+  mutable Atomic32 ref_count_;
+
   DISALLOW_COPY_AND_ASSIGN(OutboundCall);
 };
 
@@ -346,11 +415,18 @@ class CallResponse {
   ResponseHeader header_;
 
   // The slice of data for the encoded protobuf response.
-  // This slice refers to memory allocated by transfer_
+  // This slice refers to memory allocated by transfer_ (or
+  // uncompressed_body_buf_ if the response was sent compressed).
   Slice serialized_response_;
 
-  // Slices of data for rpc sidecars. They point into memory owned by transfer_.
-  Slice sidecar_slices_[OutboundTransfer::kMaxPayloadSlices];
+  // Slices of data for rpc sidecars. They point into memory owned by
+  // transfer_ (or uncompressed_body_buf_ if the response was sent
+  // compressed).
+  std::vector<Slice> sidecar_slices_;
+
+  // If the response body was compressed for the wire, holds the decompressed
+  // body which serialized_response_ and sidecar_slices_ refer into.
+  faststring uncompressed_body_buf_;
 
   // The incoming transfer data - retained because serialized_response_
   // and sidecar_slices_ refer into its data.
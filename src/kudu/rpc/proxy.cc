@@ -66,6 +66,10 @@ Proxy::Proxy(const std::shared_ptr<Messenger>& messenger,
 
   conn_id_.set_remote(remote);
   conn_id_.mutable_user_credentials()->set_real_user(real_user);
+  // Assign this proxy a connection shard so that proxies to the same remote
+  // spread over multiple connections and reactors, while all the calls made
+  // through this proxy keep their affinity to a single connection.
+  conn_id_.set_idx(messenger->NextConnectionIdx());
 }
 
 Proxy::~Proxy() {
@@ -79,9 +83,9 @@ void Proxy::AsyncRequest(const string& method,
   CHECK(controller->call_.get() == nullptr) << "Controller should be reset";
   base::subtle::NoBarrier_Store(&is_started_, true);
   RemoteMethod remote_method(service_name_, method);
-  OutboundCall* call = new OutboundCall(conn_id_, remote_method, response, controller, callback);
-  controller->call_.reset(call);
-  call->SetRequestParam(req);
+  controller->call_ = OutboundCall::Create(conn_id_, remote_method, response,
+                                           controller, callback);
+  controller->call_->SetRequestParam(req);
 
   // If this fails to queue, the callback will get called immediately
   // and the controller will be in an ERROR state.
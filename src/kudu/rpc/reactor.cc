@@ -31,6 +31,7 @@
 
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/connection.h"
 #include "kudu/rpc/messenger.h"
 #include "kudu/rpc/negotiation.h"
@@ -64,6 +65,7 @@ static const int kDefaultLibEvFlags = ev::AUTO;
 
 using std::string;
 using std::shared_ptr;
+using strings::Substitute;
 
 // TODO(KUDU-1580). This timeout has been bumped from 3 seconds up to
 // 15 seconds to workaround a bug. We should drop it back down when
@@ -73,6 +75,8 @@ DEFINE_int64(rpc_negotiation_timeout_ms, 15000,
 TAG_FLAG(rpc_negotiation_timeout_ms, advanced);
 TAG_FLAG(rpc_negotiation_timeout_ms, runtime);
 
+DECLARE_bool(rpc_shard_per_core);
+
 namespace kudu {
 namespace rpc {
 
@@ -83,10 +87,18 @@ Status ShutdownError(bool aborted) {
       Status::Aborted(msg, "", ESHUTDOWN) :
       Status::ServiceUnavailable(msg, "", ESHUTDOWN);
 }
+// Granularity and span of the call timeout wheel. A 1ms tick bounds how
+// late a timeout can fire; with 512 buckets a timeout more than ~half a
+// second out waits in its bucket across revolutions of the wheel.
+const MonoDelta kCallTimeoutWheelTick = MonoDelta::FromMilliseconds(1);
+const int kCallTimeoutWheelBuckets = 512;
+
 } // anonymous namespace
 
 ReactorThread::ReactorThread(Reactor *reactor, const MessengerBuilder &bld)
   : loop_(kDefaultLibEvFlags),
+    call_timeout_wheel_(kCallTimeoutWheelTick, kCallTimeoutWheelBuckets,
+                        MonoTime::Now()),
     cur_time_(MonoTime::Now()),
     last_unused_tcp_scan_(cur_time_),
     reactor_(reactor),
@@ -110,6 +122,12 @@ Status ReactorThread::Init() {
   timer_.start(coarse_timer_granularity_.ToSeconds(),
                coarse_timer_granularity_.ToSeconds());
 
+  // Register the timer which drives the call timeout wheel. It is only
+  // started once a call timeout is scheduled.
+  call_timeout_timer_.set(loop_);
+  call_timeout_timer_.set<ReactorThread, // NOLINT(*)
+                          &ReactorThread::CallTimeoutWheelHandler>(this);
+
   // Create Reactor thread.
   return kudu::Thread::Create("reactor", "rpc reactor", &ReactorThread::RunThread, this, &thread_);
 }
@@ -222,7 +240,7 @@ void ReactorThread::RegisterConnection(const scoped_refptr<Connection>& conn) {
   server_conns_.push_back(conn);
 }
 
-void ReactorThread::AssignOutboundCall(const shared_ptr<OutboundCall> &call) {
+void ReactorThread::AssignOutboundCall(const scoped_refptr<OutboundCall> &call) {
   DCHECK(IsCurrentThread());
   scoped_refptr<Connection> conn;
 
@@ -255,8 +273,28 @@ void ReactorThread::TimerHandler(ev::timer &watcher, int revents) {
   ScanIdleConnections();
 }
 
-void ReactorThread::RegisterTimeout(ev::timer *watcher) {
-  watcher->set(loop_);
+void ReactorThread::CallTimeoutWheelHandler(ev::timer &watcher, int revents) {
+  DCHECK(IsCurrentThread());
+  if (EV_ERROR & revents) {
+    LOG(WARNING) << "Reactor " << name() << " got an error in "
+      "the call timeout wheel handler.";
+    return;
+  }
+  call_timeout_wheel_.AdvanceTo(MonoTime::Now());
+  if (call_timeout_wheel_.empty()) {
+    // Nothing left to time out; stop ticking until the next call timeout
+    // is scheduled.
+    call_timeout_timer_.stop();
+  }
+}
+
+void ReactorThread::ScheduleCallTimeout(TimerWheelEntry* entry, MonoTime deadline) {
+  DCHECK(IsCurrentThread());
+  call_timeout_wheel_.Schedule(entry, deadline);
+  if (!call_timeout_timer_.is_active()) {
+    call_timeout_timer_.start(kCallTimeoutWheelTick.ToSeconds(),
+                              kCallTimeoutWheelTick.ToSeconds());
+  }
 }
 
 void ReactorThread::ScanIdleConnections() {
@@ -312,6 +350,13 @@ bool ReactorThread::IsCurrentThread() const {
 void ReactorThread::RunThread() {
   ThreadRestrictions::SetWaitAllowed(false);
   ThreadRestrictions::SetIOAllowed(false);
+  if (PREDICT_FALSE(FLAGS_rpc_shard_per_core)) {
+    // Pin the reactor to the CPU whose service-pool shard handles the
+    // connections that RemoteToReactor() assigns to this reactor, so that
+    // a connection's network processing and request handling share a core.
+    WARN_NOT_OK(PinCurrentThreadToCpu(reactor_->index()),
+                Substitute("Unable to pin $0 to a CPU", name()));
+  }
   DVLOG(6) << "Calling ReactorThread::RunThread()...";
   loop_.run(0);
   VLOG(1) << name() << " thread exiting.";
@@ -350,6 +395,7 @@ Status ReactorThread::FindOrStartConnection(const ConnectionId &conn_id,
   // Register the new connection in our map.
   *conn = new Connection(this, conn_id.remote(), new_socket.release(), Connection::CLIENT);
   (*conn)->set_user_credentials(conn_id.user_credentials());
+  (*conn)->set_conn_idx(conn_id.idx());
 
   // Kick off blocking client connection negotiation.
   Status s = StartConnectionNegotiation(*conn);
@@ -440,6 +486,7 @@ void ReactorThread::DestroyConnection(Connection *conn,
   // Unlink connection from lists.
   if (conn->direction() == Connection::CLIENT) {
     ConnectionId conn_id(conn->remote(), conn->user_credentials());
+    conn_id.set_idx(conn->conn_idx());
     auto it = client_conns_.find(conn_id);
     CHECK(it != client_conns_.end()) << "Couldn't find connection " << conn->ToString();
     client_conns_.erase(it);
@@ -495,6 +542,7 @@ Reactor::Reactor(const shared_ptr<Messenger>& messenger,
                  int index, const MessengerBuilder &bld)
   : messenger_(messenger),
     name_(StringPrintf("%s_R%03d", messenger->name().c_str(), index)),
+    index_(index),
     closing_(false),
     thread_(this, bld) {
 }
@@ -622,7 +670,7 @@ void Reactor::RegisterInboundSocket(Socket *socket, const Sockaddr &remote) {
 // to a connection.
 class AssignOutboundCallTask : public ReactorTask {
  public:
-  explicit AssignOutboundCallTask(shared_ptr<OutboundCall> call)
+  explicit AssignOutboundCallTask(scoped_refptr<OutboundCall> call)
       : call_(std::move(call)) {}
 
   virtual void Run(ReactorThread *reactor) OVERRIDE {
@@ -636,10 +684,10 @@ class AssignOutboundCallTask : public ReactorTask {
   }
 
  private:
-  shared_ptr<OutboundCall> call_;
+  scoped_refptr<OutboundCall> call_;
 };
 
-void Reactor::QueueOutboundCall(const shared_ptr<OutboundCall> &call) {
+void Reactor::QueueOutboundCall(const scoped_refptr<OutboundCall> &call) {
   DVLOG(3) << name_ << ": queueing outbound call "
            << call->ToString() << " to remote " << call->conn_id().remote().ToString();
   AssignOutboundCallTask *task = new AssignOutboundCallTask(call);
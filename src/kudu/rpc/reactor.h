@@ -29,6 +29,7 @@
 
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/rpc/connection.h"
+#include "kudu/rpc/timer_wheel.h"
 #include "kudu/rpc/transfer.h"
 #include "kudu/util/thread.h"
 #include "kudu/util/locks.h"
@@ -149,9 +150,14 @@ class ReactorThread {
   // libev callback for handling timer events in our epoll thread.
   void TimerHandler(ev::timer &watcher, int revents);
 
-  // Register an epoll timer watcher with our event loop.
-  // Does not set a timeout or start it.
-  void RegisterTimeout(ev::timer *watcher);
+  // libev callback which drives the call timeout wheel.
+  void CallTimeoutWheelHandler(ev::timer &watcher, int revents);
+
+  // Schedule 'entry' on the call timeout wheel, to fire shortly after
+  // 'deadline'. Scheduling and cancelling (see TimerWheelEntry::Cancel())
+  // are O(1) regardless of the number of pending timeouts.
+  // Must be called from the reactor thread.
+  void ScheduleCallTimeout(TimerWheelEntry* entry, MonoTime deadline);
 
   // This may be called from another thread.
   const std::string &name() const;
@@ -214,7 +220,7 @@ class ReactorThread {
 
   // Assign a new outbound call to the appropriate connection object.
   // If this fails, the call is marked failed and completed.
-  void AssignOutboundCall(const std::shared_ptr<OutboundCall> &call);
+  void AssignOutboundCall(const scoped_refptr<OutboundCall> &call);
 
   // Register a new connection.
   void RegisterConnection(const scoped_refptr<Connection>& conn);
@@ -234,6 +240,16 @@ class ReactorThread {
   // Handles the periodic timer.
   ev::timer timer_;
 
+  // Drives 'call_timeout_wheel_'. Only active while the wheel has
+  // scheduled entries.
+  ev::timer call_timeout_timer_;
+
+  // Pending timeouts for outbound calls. Using a hashed wheel rather than
+  // per-call ev::timers keeps timeout arming and cancellation out of the
+  // libev timer heap, which otherwise dominates reactor CPU at high call
+  // rates.
+  TimerWheel call_timeout_wheel_;
+
   // Scheduled (but not yet run) delayed tasks.
   //
   // Each task owns its own memory and must be freed by its TaskRun and
@@ -290,7 +306,7 @@ class Reactor {
 
   // Queue a new call to be sent. If the reactor is already shut down, marks
   // the call as failed.
-  void QueueOutboundCall(const std::shared_ptr<OutboundCall> &call);
+  void QueueOutboundCall(const scoped_refptr<OutboundCall> &call);
 
   // Schedule the given task's Run() method to be called on the
   // reactor thread.
@@ -310,6 +326,11 @@ class Reactor {
     return messenger_.get();
   }
 
+  // The index of this reactor within its messenger.
+  int index() const {
+    return index_;
+  }
+
   // Indicates whether the reactor is shutting down.
   //
   // This method is thread-safe.
@@ -330,6 +351,9 @@ class Reactor {
 
   const std::string name_;
 
+  // The index of this reactor within its messenger.
+  const int index_;
+
   // Whether the reactor is shutting down.
   // Guarded by lock_.
   bool closing_;
@@ -18,8 +18,11 @@
 #include "kudu/rpc/result_tracker.h"
 
 #include <algorithm>
+#include <functional>
 #include <limits>
 
+#include <lz4.h>
+
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/inbound_call.h"
@@ -63,6 +66,19 @@ using std::unique_ptr;
 using strings::Substitute;
 using strings::SubstituteAndAppend;
 
+namespace {
+
+// The number of shards the client state map is split into. Sixteen shards
+// keeps the fixed overhead of an idle tracker small while spreading the lock
+// traffic of concurrent writers.
+const int kNumShards = 16;
+
+// Cached responses below this size are stored uncompressed: tiny protobufs
+// rarely shrink enough to pay for the decompression on a retry.
+const uint32_t kCompressCachedResponseMinBytes = 256;
+
+} // anonymous namespace
+
 // This tracks the size changes of anything that has a memory_footprint() method.
 // It must be instantiated before the updates, and it makes sure that the MemTracker
 // is updated on scope exit.
@@ -92,9 +108,12 @@ struct ScopedMemTrackerUpdater {
 
 ResultTracker::ResultTracker(shared_ptr<MemTracker> mem_tracker)
     : mem_tracker_(std::move(mem_tracker)),
-      clients_(ClientStateMap::key_compare(),
-               ClientStateMapAllocator(mem_tracker_)),
-      gc_thread_stop_latch_(1) {}
+      gc_thread_stop_latch_(1) {
+  shards_.reserve(kNumShards);
+  for (int i = 0; i < kNumShards; i++) {
+    shards_.emplace_back(new Shard(mem_tracker_));
+  }
+}
 
 ResultTracker::~ResultTracker() {
   if (gc_thread_) {
@@ -102,27 +121,35 @@ ResultTracker::~ResultTracker() {
     gc_thread_->Join();
   }
 
-  lock_guard<simple_spinlock> l(lock_);
-  // Release all the memory for the stuff we'll delete on destruction.
-  for (auto& client_state : clients_) {
-    client_state.second->GCCompletionRecords(
-        mem_tracker_, [] (SequenceNumber, CompletionRecord*){ return true; });
-    mem_tracker_->Release(client_state.second->memory_footprint());
+  for (auto& shard : shards_) {
+    lock_guard<simple_spinlock> l(shard->lock);
+    // Release all the memory for the stuff we'll delete on destruction.
+    for (auto& client_state : shard->clients) {
+      client_state.second->GCCompletionRecords(
+          mem_tracker_, [] (SequenceNumber, CompletionRecord*){ return true; });
+      mem_tracker_->Release(client_state.second->memory_footprint());
+    }
   }
 }
 
+ResultTracker::Shard* ResultTracker::ShardForClient(const string& client_id) {
+  return shards_[std::hash<string>()(client_id) % kNumShards].get();
+}
+
 ResultTracker::RpcState ResultTracker::TrackRpc(const RequestIdPB& request_id,
                                                 Message* response,
                                                 RpcContext* context) {
-  lock_guard<simple_spinlock> l(lock_);
-  return TrackRpcUnlocked(request_id, response, context);
+  Shard* shard = ShardForClient(request_id.client_id());
+  lock_guard<simple_spinlock> l(shard->lock);
+  return TrackRpcUnlocked(request_id, response, context, shard);
 }
 
 ResultTracker::RpcState ResultTracker::TrackRpcUnlocked(const RequestIdPB& request_id,
                                                         Message* response,
-                                                        RpcContext* context) {
+                                                        RpcContext* context,
+                                                        Shard* shard) {
   ClientState* client_state = ComputeIfAbsent(
-      &clients_,
+      &shard->clients,
       request_id.client_id(),
       [&]{
         unique_ptr<ClientState> client_state(new ClientState(mem_tracker_));
@@ -185,7 +212,7 @@ ResultTracker::RpcState ResultTracker::TrackRpcUnlocked(const RequestIdPB& reque
       // non-null) copy the response and reply immediately. If there is no context/response
       // do nothing.
       if (context != nullptr) {
-        DCHECK_NOTNULL(response)->CopyFrom(*completion_record->response);
+        completion_record->DecodeCachedResponse(DCHECK_NOTNULL(response));
         context->call_->RespondSuccess(*response);
         delete context;
       }
@@ -209,12 +236,13 @@ ResultTracker::RpcState ResultTracker::TrackRpcUnlocked(const RequestIdPB& reque
 }
 
 ResultTracker::RpcState ResultTracker::TrackRpcOrChangeDriver(const RequestIdPB& request_id) {
-  lock_guard<simple_spinlock> l(lock_);
-  RpcState state = TrackRpcUnlocked(request_id, nullptr, nullptr);
+  Shard* shard = ShardForClient(request_id.client_id());
+  lock_guard<simple_spinlock> l(shard->lock);
+  RpcState state = TrackRpcUnlocked(request_id, nullptr, nullptr, shard);
 
   if (state != RpcState::IN_PROGRESS) return state;
 
-  CompletionRecord* completion_record = FindCompletionRecordOrDieUnlocked(request_id);
+  CompletionRecord* completion_record = FindCompletionRecordOrDieUnlocked(request_id, shard);
   ScopedMemTrackerUpdater<CompletionRecord> updater(mem_tracker_.get(), completion_record);
 
   // ... if we did find a CompletionRecord change the driver and return true.
@@ -229,8 +257,9 @@ ResultTracker::RpcState ResultTracker::TrackRpcOrChangeDriver(const RequestIdPB&
 }
 
 bool ResultTracker::IsCurrentDriver(const RequestIdPB& request_id) {
-  lock_guard<simple_spinlock> l(lock_);
-  CompletionRecord* completion_record = FindCompletionRecordOrNullUnlocked(request_id);
+  Shard* shard = ShardForClient(request_id.client_id());
+  lock_guard<simple_spinlock> l(shard->lock);
+  CompletionRecord* completion_record = FindCompletionRecordOrNullUnlocked(request_id, shard);
 
   // If we couldn't find the CompletionRecord, someone might have called FailAndRespond() so
   // just return false.
@@ -275,14 +304,16 @@ void ResultTracker::LogAndTraceFailure(RpcContext* context,
 }
 
 ResultTracker::CompletionRecord* ResultTracker::FindCompletionRecordOrDieUnlocked(
-    const RequestIdPB& request_id) {
-  ClientState* client_state = DCHECK_NOTNULL(FindPointeeOrNull(clients_, request_id.client_id()));
+    const RequestIdPB& request_id, Shard* shard) {
+  ClientState* client_state = DCHECK_NOTNULL(
+      FindPointeeOrNull(shard->clients, request_id.client_id()));
   return DCHECK_NOTNULL(FindPointeeOrNull(client_state->completion_records, request_id.seq_no()));
 }
 
 pair<ResultTracker::ClientState*, ResultTracker::CompletionRecord*>
-ResultTracker::FindClientStateAndCompletionRecordOrNullUnlocked(const RequestIdPB& request_id) {
-  ClientState* client_state = FindPointeeOrNull(clients_, request_id.client_id());
+ResultTracker::FindClientStateAndCompletionRecordOrNullUnlocked(const RequestIdPB& request_id,
+                                                                Shard* shard) {
+  ClientState* client_state = FindPointeeOrNull(shard->clients, request_id.client_id());
   CompletionRecord* completion_record = nullptr;
   if (client_state != nullptr) {
     completion_record = FindPointeeOrNull(client_state->completion_records, request_id.seq_no());
@@ -291,26 +322,27 @@ ResultTracker::FindClientStateAndCompletionRecordOrNullUnlocked(const RequestIdP
 }
 
 ResultTracker::CompletionRecord*
-ResultTracker::FindCompletionRecordOrNullUnlocked(const RequestIdPB& request_id) {
-  return FindClientStateAndCompletionRecordOrNullUnlocked(request_id).second;
+ResultTracker::FindCompletionRecordOrNullUnlocked(const RequestIdPB& request_id, Shard* shard) {
+  return FindClientStateAndCompletionRecordOrNullUnlocked(request_id, shard).second;
 }
 
 void ResultTracker::RecordCompletionAndRespond(const RequestIdPB& request_id,
                                                const Message* response) {
   vector<OnGoingRpcInfo> to_respond;
   {
-    lock_guard<simple_spinlock> l(lock_);
+    Shard* shard = ShardForClient(request_id.client_id());
+    lock_guard<simple_spinlock> l(shard->lock);
 
-    CompletionRecord* completion_record = FindCompletionRecordOrDieUnlocked(request_id);
+    CompletionRecord* completion_record = FindCompletionRecordOrDieUnlocked(request_id, shard);
     ScopedMemTrackerUpdater<CompletionRecord> updater(mem_tracker_.get(), completion_record);
 
     CHECK_EQ(completion_record->driver_attempt_no, request_id.attempt_no())
         << "Called RecordCompletionAndRespond() from an executor identified with an "
         << "attempt number that was not marked as the driver for the RPC. RequestId: "
-        << SecureShortDebugString(request_id) << "\nTracker state:\n " << ToStringUnlocked();
+        << SecureShortDebugString(request_id) << "\nTracker state:\n "
+        << ToStringUnlocked(*shard);
     DCHECK_EQ(completion_record->state, RpcState::IN_PROGRESS);
-    completion_record->response.reset(DCHECK_NOTNULL(response)->New());
-    completion_record->response->CopyFrom(*response);
+    completion_record->CacheResponse(*DCHECK_NOTNULL(response));
     completion_record->state = RpcState::COMPLETED;
     completion_record->last_updated = MonoTime::Now();
 
@@ -351,11 +383,12 @@ void ResultTracker::FailAndRespondInternal(const RequestIdPB& request_id,
                                            HandleOngoingRpcFunc func) {
   vector<OnGoingRpcInfo> to_handle;
   {
-    lock_guard<simple_spinlock> l(lock_);
-    auto state_and_record = FindClientStateAndCompletionRecordOrNullUnlocked(request_id);
+    Shard* shard = ShardForClient(request_id.client_id());
+    lock_guard<simple_spinlock> l(shard->lock);
+    auto state_and_record = FindClientStateAndCompletionRecordOrNullUnlocked(request_id, shard);
     if (PREDICT_FALSE(state_and_record.first == nullptr)) {
       LOG(FATAL) << "Couldn't find ClientState for request: " << SecureShortDebugString(request_id)
-                 << ". \nTracker state:\n" << ToStringUnlocked();
+                 << ". \nTracker state:\n" << ToStringUnlocked(*shard);
     }
 
     CompletionRecord* completion_record = state_and_record.second;
@@ -458,7 +491,6 @@ void ResultTracker::RunGCThread() {
 }
 
 void ResultTracker::GCResults() {
-  lock_guard<simple_spinlock> l(lock_);
   MonoTime now = MonoTime::Now();
   // Calculate the instants before which we'll start GCing ClientStates and CompletionRecords.
   MonoTime time_to_gc_clients_from = now;
@@ -468,52 +500,63 @@ void ResultTracker::GCResults() {
   time_to_gc_responses_from.AddDelta(
       MonoDelta::FromMilliseconds(-FLAGS_remember_responses_ttl_ms));
 
-  // Now go through the ClientStates. If we haven't heard from a client in a while
-  // GC it and all its completion records (making sure there isn't actually one in progress first).
-  // If we've heard from a client recently, but some of its responses are old, GC those responses.
-  for (auto iter = clients_.begin(); iter != clients_.end();) {
-    auto& client_state = iter->second;
-    if (client_state->last_heard_from < time_to_gc_clients_from) {
-      // Client should be GCed.
-      bool ongoing_request = false;
-      client_state->GCCompletionRecords(
-          mem_tracker_,
-          [&] (SequenceNumber, CompletionRecord* completion_record) {
-            if (PREDICT_FALSE(completion_record->state == RpcState::IN_PROGRESS)) {
-              ongoing_request = true;
-              return false;
-            }
-            return true;
-          });
-      // Don't delete the client state if there is still a request in execution.
-      if (PREDICT_FALSE(ongoing_request)) {
+  // Now go through the ClientStates, one shard at a time so that writers to
+  // other shards are not blocked while we scan. If we haven't heard from a
+  // client in a while GC it and all its completion records (making sure there
+  // isn't actually one in progress first). If we've heard from a client
+  // recently, but some of its responses are old, GC those responses.
+  for (auto& shard : shards_) {
+    lock_guard<simple_spinlock> l(shard->lock);
+    for (auto iter = shard->clients.begin(); iter != shard->clients.end();) {
+      auto& client_state = iter->second;
+      if (client_state->last_heard_from < time_to_gc_clients_from) {
+        // Client should be GCed.
+        bool ongoing_request = false;
+        client_state->GCCompletionRecords(
+            mem_tracker_,
+            [&] (SequenceNumber, CompletionRecord* completion_record) {
+              if (PREDICT_FALSE(completion_record->state == RpcState::IN_PROGRESS)) {
+                ongoing_request = true;
+                return false;
+              }
+              return true;
+            });
+        // Don't delete the client state if there is still a request in execution.
+        if (PREDICT_FALSE(ongoing_request)) {
+          ++iter;
+          continue;
+        }
+        mem_tracker_->Release(client_state->memory_footprint());
+        iter = shard->clients.erase(iter);
+      } else {
+        // Client can't be GCed, but its calls might be GCable.
+        iter->second->GCCompletionRecords(
+            mem_tracker_,
+            [&] (SequenceNumber, CompletionRecord* completion_record) {
+              return completion_record->state != RpcState::IN_PROGRESS &&
+                  completion_record->last_updated < time_to_gc_responses_from;
+            });
         ++iter;
-        continue;
       }
-      mem_tracker_->Release(client_state->memory_footprint());
-      iter = clients_.erase(iter);
-    } else {
-      // Client can't be GCed, but its calls might be GCable.
-      iter->second->GCCompletionRecords(
-          mem_tracker_,
-          [&] (SequenceNumber, CompletionRecord* completion_record) {
-            return completion_record->state != RpcState::IN_PROGRESS &&
-                completion_record->last_updated < time_to_gc_responses_from;
-          });
-      ++iter;
     }
   }
 }
 
 string ResultTracker::ToString() {
-  lock_guard<simple_spinlock> l(lock_);
-  return ToStringUnlocked();
+  string result = Substitute("ResultTracker[this: $0, Shards:\n", this);
+  for (auto& shard : shards_) {
+    lock_guard<simple_spinlock> l(shard->lock);
+    result.append(ToStringUnlocked(*shard));
+    result.append("\n");
+  }
+  result.append("]");
+  return result;
 }
 
-string ResultTracker::ToStringUnlocked() const {
-  string result = Substitute("ResultTracker[this: $0, Num. Client States: $1, Client States:\n",
-                             this, clients_.size());
-  for (auto& cs : clients_) {
+string ResultTracker::ToStringUnlocked(const Shard& shard) const {
+  string result = Substitute("Shard[Num. Client States: $0, Client States:\n",
+                             shard.clients.size());
+  for (auto& cs : shard.clients) {
     SubstituteAndAppend(&result, Substitute("\n\tClient: $0, $1", cs.first, cs.second->ToString()));
   }
   result.append("]");
@@ -558,12 +601,53 @@ string ResultTracker::ClientState::ToString() const {
   return result;
 }
 
+void ResultTracker::CompletionRecord::CacheResponse(const Message& response) {
+  uint32_t uncompressed_len = response.ByteSize();
+  faststring scratch;
+  scratch.resize(uncompressed_len);
+  response.SerializeWithCachedSizesToArray(scratch.data());
+
+  if (uncompressed_len >= kCompressCachedResponseMinBytes) {
+    int bound = LZ4_compressBound(uncompressed_len);
+    faststring compressed;
+    compressed.resize(bound);
+    int compressed_len = LZ4_compress_default(
+        reinterpret_cast<const char*>(scratch.data()),
+        reinterpret_cast<char*>(compressed.data()),
+        uncompressed_len, bound);
+    if (compressed_len > 0 && compressed_len < static_cast<int>(uncompressed_len)) {
+      // Copy out of the bound-sized scratch buffer so we only retain the
+      // compressed bytes.
+      response_buf.assign_copy(compressed.data(), compressed_len);
+      uncompressed_response_len = uncompressed_len;
+      return;
+    }
+  }
+  response_buf.assign_copy(scratch.data(), uncompressed_len);
+  uncompressed_response_len = 0;
+}
+
+void ResultTracker::CompletionRecord::DecodeCachedResponse(Message* response) const {
+  if (uncompressed_response_len == 0) {
+    CHECK(response->ParseFromArray(response_buf.data(), response_buf.size()));
+    return;
+  }
+  faststring uncompressed;
+  uncompressed.resize(uncompressed_response_len);
+  int n = LZ4_decompress_safe(reinterpret_cast<const char*>(response_buf.data()),
+                              reinterpret_cast<char*>(uncompressed.data()),
+                              response_buf.size(), uncompressed_response_len);
+  CHECK_EQ(uncompressed_response_len, n) << "Corrupt cached response";
+  CHECK(response->ParseFromArray(uncompressed.data(), uncompressed.size()));
+}
+
 string ResultTracker::CompletionRecord::ToString() const {
   string result = Substitute("Completion Record[State: $0, Driver: $1, "
                              "Cached response: $2, $3 OngoingRpcs:",
                              state,
                              driver_attempt_no,
-                             response ? SecureShortDebugString(*response) : "None",
+                             response_buf.size() > 0 ?
+                                 Substitute("$0 bytes", response_buf.size()) : "None",
                              ongoing_rpcs.size());
   for (auto& orpc : ongoing_rpcs) {
     SubstituteAndAppend(&result, Substitute("\n\t$0", orpc.ToString()));
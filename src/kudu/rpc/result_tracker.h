@@ -18,6 +18,7 @@
 
 #include <functional>
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -27,6 +28,7 @@
 #include "kudu/rpc/request_tracker.h"
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/util/countdown_latch.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/malloc.h"
 #include "kudu/util/mem_tracker.h"
@@ -269,8 +271,24 @@ class ResultTracker : public RefCountedThreadSafe<ResultTracker> {
     // The timestamp of the last CompletionRecord update.
     MonoTime last_updated;
 
-    // The cached response, if this RPC is in COMPLETED state.
-    std::unique_ptr<google::protobuf::Message> response;
+    // Serialize 'response' into 'response_buf', LZ4-compressing it if that
+    // makes it smaller. Called when the RPC completes.
+    void CacheResponse(const google::protobuf::Message& response);
+
+    // Deserialize the cached response into 'response'. May only be called
+    // once the RPC is in COMPLETED state.
+    void DecodeCachedResponse(google::protobuf::Message* response) const;
+
+    // The cached response, if this RPC is in COMPLETED state. The response
+    // protobuf is kept serialized (and LZ4-compressed when compression
+    // shrinks it) rather than as a live message: busy servers retain many of
+    // these until client GC, and the serialized form is considerably more
+    // compact.
+    faststring response_buf;
+
+    // If 'response_buf' is compressed, the original serialized length of the
+    // response. Zero if it is stored uncompressed.
+    uint32_t uncompressed_response_len = 0;
 
     // The set of ongoing RPCs that correspond to this record.
     std::vector<OnGoingRpcInfo> ongoing_rpcs;
@@ -281,7 +299,7 @@ class ResultTracker : public RefCountedThreadSafe<ResultTracker> {
     int64_t memory_footprint() const {
       return kudu_malloc_usable_size(this)
           + (ongoing_rpcs.capacity() > 0 ? kudu_malloc_usable_size(ongoing_rpcs.data()) : 0)
-          + (response.get() != nullptr ? response->SpaceUsed() : 0);
+          + response_buf.capacity();
     }
   };
 
@@ -331,9 +349,35 @@ class ResultTracker : public RefCountedThreadSafe<ResultTracker> {
     }
   };
 
+  typedef MemTrackerAllocator<std::pair<const std::string,
+                                        std::unique_ptr<ClientState>>> ClientStateMapAllocator;
+  typedef std::map<std::string,
+                   std::unique_ptr<ClientState>,
+                   std::less<std::string>,
+                   ClientStateMapAllocator> ClientStateMap;
+
+  // A shard of the client state map. The map is sharded by a hash of the
+  // client id to reduce contention on the lock, which is taken at least once
+  // per tracked RPC.
+  struct Shard {
+    explicit Shard(std::shared_ptr<kudu::MemTracker> mem_tracker)
+        : clients(ClientStateMap::key_compare(),
+                  ClientStateMapAllocator(std::move(mem_tracker))) {}
+
+    // Lock that protects access to 'clients' and to the state contained in
+    // each of its ClientStates.
+    simple_spinlock lock;
+
+    ClientStateMap clients;
+  };
+
+  // Returns the shard responsible for 'client_id'.
+  Shard* ShardForClient(const std::string& client_id);
+
   RpcState TrackRpcUnlocked(const RequestIdPB& request_id,
                             google::protobuf::Message* response,
-                            RpcContext* context);
+                            RpcContext* context,
+                            Shard* shard);
 
   typedef std::function<void (const OnGoingRpcInfo&)> HandleOngoingRpcFunc;
 
@@ -342,10 +386,12 @@ class ResultTracker : public RefCountedThreadSafe<ResultTracker> {
   void FailAndRespondInternal(const rpc::RequestIdPB& request_id,
                               HandleOngoingRpcFunc func);
 
-  CompletionRecord* FindCompletionRecordOrNullUnlocked(const RequestIdPB& request_id);
-  CompletionRecord* FindCompletionRecordOrDieUnlocked(const RequestIdPB& request_id);
+  CompletionRecord* FindCompletionRecordOrNullUnlocked(const RequestIdPB& request_id,
+                                                       Shard* shard);
+  CompletionRecord* FindCompletionRecordOrDieUnlocked(const RequestIdPB& request_id,
+                                                      Shard* shard);
   std::pair<ClientState*, CompletionRecord*> FindClientStateAndCompletionRecordOrNullUnlocked(
-      const RequestIdPB& request_id);
+      const RequestIdPB& request_id, Shard* shard);
 
   // A handler must handle an RPC attempt if:
   // 1 - It's its own attempt. I.e. it has the same attempt number of the handler.
@@ -367,26 +413,18 @@ class ResultTracker : public RefCountedThreadSafe<ResultTracker> {
   void LogAndTraceFailure(RpcContext* context, ErrorStatusPB_RpcErrorCodePB err,
                           const Status& status);
 
-  std::string ToStringUnlocked() const;
+  // Returns a string representation of the given shard. Must be called with
+  // the shard's lock held.
+  std::string ToStringUnlocked(const Shard& shard) const;
 
   void RunGCThread();
 
   // The memory tracker that tracks this ResultTracker's memory consumption.
   std::shared_ptr<kudu::MemTracker> mem_tracker_;
 
-  // Lock that protects access to 'clients_' and to the state contained in each
-  // ClientState.
-  // TODO consider a per-ClientState lock if we find this too coarse grained.
-  simple_spinlock lock_;
-
-  typedef MemTrackerAllocator<std::pair<const std::string,
-                                        std::unique_ptr<ClientState>>> ClientStateMapAllocator;
-  typedef std::map<std::string,
-                   std::unique_ptr<ClientState>,
-                   std::less<std::string>,
-                   ClientStateMapAllocator> ClientStateMap;
-
-  ClientStateMap clients_;
+  // The shards of the client state map. Sized at construction time and never
+  // resized, so the vector itself may be accessed without synchronization.
+  std::vector<std::unique_ptr<Shard>> shards_;
 
   // The thread which runs GC, and a latch to stop it.
   scoped_refptr<Thread> gc_thread_;
@@ -17,14 +17,18 @@
 
 #include "kudu/rpc/rpc-test-base.h"
 
+#include <cstring>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 #include <boost/bind.hpp>
+#include <gflags/gflags.h>
+#include <google/protobuf/io/coded_stream.h>
 #include <gtest/gtest.h>
 
+#include "kudu/gutil/casts.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -38,7 +42,10 @@
 METRIC_DECLARE_histogram(handler_latency_kudu_rpc_test_CalculatorService_Sleep);
 METRIC_DECLARE_histogram(rpc_incoming_queue_time);
 
+DECLARE_bool(rpc_wire_compression);
+DECLARE_int32(rpc_connections_per_remote);
 DECLARE_int32(rpc_negotiation_inject_delay_ms);
+DECLARE_int32(rpc_wire_compression_min_size);
 
 using std::shared_ptr;
 using std::string;
@@ -55,6 +62,35 @@ class TestRpc : public RpcTestBase, public ::testing::WithParamInterface<bool> {
 // This is used to run all parameterized tests with and without SSL.
 INSTANTIATE_TEST_CASE_P(OptionalSSL, TestRpc, testing::Values(false, true));
 
+// Test that RpcMethodInfo recycles request/response messages through its
+// per-method pools, and refuses to pool messages which have grown too large.
+TEST_F(TestRpc, TestRpcMethodInfoMessagePool) {
+  scoped_refptr<RpcMethodInfo> info(new RpcMethodInfo());
+  info->req_prototype.reset(new rpc_test::EchoRequestPB());
+  info->resp_prototype.reset(new rpc_test::EchoResponsePB());
+
+  google::protobuf::Message* req = info->NewRequest();
+  google::protobuf::Message* resp = info->NewResponse();
+  info->ReleaseRequest(req);
+  info->ReleaseResponse(resp);
+
+  // The next call should get back the recycled messages, cleared.
+  google::protobuf::Message* req2 = info->NewRequest();
+  ASSERT_EQ(req, req2);
+  ASSERT_EQ(0, req2->ByteSize());
+  google::protobuf::Message* resp2 = info->NewResponse();
+  ASSERT_EQ(resp, resp2);
+  info->ReleaseResponse(resp2);
+
+  // A message with a large amount of retained storage should be deleted
+  // rather than pooled, so the next request comes back empty either way.
+  down_cast<rpc_test::EchoRequestPB*>(req2)->set_data(string(1024 * 1024, 'x'));
+  info->ReleaseRequest(req2);
+  google::protobuf::Message* req3 = info->NewRequest();
+  ASSERT_EQ(0, req3->ByteSize());
+  info->ReleaseRequest(req3);
+}
+
 TEST_F(TestRpc, TestSockaddr) {
   Sockaddr addr1, addr2;
   addr1.set_port(1000);
@@ -248,6 +284,35 @@ TEST_P(TestRpc, TestConnectionKeepalive) {
   ASSERT_EQ(0, metrics.num_client_connections_) << "Client should have 0 client connections";
 }
 
+// Test that proxies to the same remote fan out over multiple connections
+// when --rpc_connections_per_remote is set.
+TEST_P(TestRpc, TestConnectionsPerRemote) {
+  google::FlagSaver saver;
+  FLAGS_rpc_connections_per_remote = 3;
+  n_server_reactor_threads_ = 1;
+
+  // Set up server.
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  StartTestServer(&server_addr, enable_ssl);
+
+  // Use a single client reactor so that all of the connections are counted
+  // by the same reactor's metrics.
+  shared_ptr<Messenger> client_messenger(CreateMessenger("Client", 1, enable_ssl));
+
+  // Each proxy is assigned its own connection shard, so three proxies to the
+  // same remote should establish three distinct connections.
+  for (int i = 0; i < 3; i++) {
+    Proxy p(client_messenger, server_addr, GenericCalculatorService::static_service_name());
+    ASSERT_OK(DoTestSyncCall(p, GenericCalculatorService::kAddMethodName));
+  }
+
+  ReactorMetrics metrics;
+  ASSERT_OK(client_messenger->reactors_[0]->GetMetrics(&metrics));
+  ASSERT_EQ(3, metrics.num_client_connections_)
+      << "Client should have one connection per shard";
+}
+
 // Test that a call which takes longer than the keepalive time
 // succeeds -- i.e that we don't consider a connection to be "idle" on the
 // server if there is a call outstanding on it.
@@ -293,6 +358,93 @@ TEST_P(TestRpc, TestRpcSidecar) {
   DoTestSidecar(p, 3000 * 1024, 2000 * 1024);
 }
 
+// Test the compress/decompress round trip for wire compression at the
+// serialization level, including the varint delimiter on the compressed
+// frame and the incompressible-input fallback.
+TEST_F(TestRpc, TestWireCompressionRoundTrip) {
+  google::FlagSaver saver;
+  FLAGS_rpc_wire_compression = true;
+
+  // A repetitive body should compress.
+  faststring body;
+  body.resize(64 * 1024);
+  memset(body.data(), 'x', body.size());
+  ASSERT_TRUE(serialization::ShouldCompressBody(body.size()));
+
+  faststring wire_body;
+  ASSERT_TRUE(serialization::CompressBody(Slice(body), &wire_body));
+  ASSERT_LT(wire_body.size(), body.size());
+
+  // The compressed frame is delimited by a varint holding its length.
+  google::protobuf::io::CodedInputStream in(wire_body.data(), wire_body.size());
+  uint32_t compressed_len;
+  ASSERT_TRUE(in.ReadVarint32(&compressed_len));
+  Slice compressed(wire_body.data() + wire_body.size() - compressed_len,
+                   compressed_len);
+
+  faststring decompressed;
+  ASSERT_OK(serialization::DecompressBody(compressed, body.size(), &decompressed));
+  ASSERT_EQ(0, Slice(body).compare(Slice(decompressed)));
+
+  // A corrupt claimed length should be detected rather than crash.
+  Status s = serialization::DecompressBody(compressed, body.size() - 1, &decompressed);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+
+  // Random data should be reported as incompressible.
+  Random rng(SeedRandom());
+  RandomString(body.data(), body.size(), &rng);
+  ASSERT_FALSE(serialization::CompressBody(Slice(body), &wire_body));
+}
+
+// Test that calls round-trip correctly over a connection with wire
+// compression enabled. The first call is serialized before negotiation
+// completes and goes out uncompressed; subsequent calls ride the warm
+// connection and compress both the request and response bodies.
+TEST_P(TestRpc, TestRpcWireCompression) {
+  google::FlagSaver saver;
+  FLAGS_rpc_wire_compression = true;
+  FLAGS_rpc_wire_compression_min_size = 1024;
+
+  // Set up server.
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  StartTestServerWithGeneratedCode(&server_addr, enable_ssl);
+
+  // Set up client.
+  shared_ptr<Messenger> client_messenger(CreateMessenger("Client", 1, enable_ssl));
+  Proxy p(client_messenger, server_addr, CalculatorService::static_service_name());
+
+  string payload(128 * 1024, 'x');
+  for (int i = 0; i < 2; i++) {
+    EchoRequestPB req;
+    req.set_data(payload);
+    EchoResponsePB resp;
+    RpcController controller;
+    ASSERT_OK(p.SyncRequest("Echo", req, &resp, &controller));
+    ASSERT_EQ(payload, resp.data());
+  }
+}
+
+// Test that sidecars of incompressible data are passed through correctly
+// when wire compression is enabled, exercising the fallback to sending the
+// body uncompressed.
+TEST_P(TestRpc, TestRpcSidecarWireCompression) {
+  google::FlagSaver saver;
+  FLAGS_rpc_wire_compression = true;
+  FLAGS_rpc_wire_compression_min_size = 1024;
+
+  // Set up server.
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  StartTestServer(&server_addr, enable_ssl);
+
+  // Set up client.
+  shared_ptr<Messenger> client_messenger(CreateMessenger("Client", 1, enable_ssl));
+  Proxy p(client_messenger, server_addr, GenericCalculatorService::static_service_name());
+
+  DoTestSidecar(p, 3000 * 1024, 2000 * 1024);
+}
+
 // Test that timeouts are properly handled.
 TEST_P(TestRpc, TestCallTimeout) {
   Sockaddr server_addr;
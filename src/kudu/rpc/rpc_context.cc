@@ -51,6 +51,12 @@ RpcContext::RpcContext(InboundCall *call,
 }
 
 RpcContext::~RpcContext() {
+  if (method_info_) {
+    // The messages were created mutable by the service layer; request_pb_ is
+    // only const to keep handlers from mutating their input.
+    method_info_->ReleaseRequest(const_cast<Message*>(request_pb_.release()));
+    method_info_->ReleaseResponse(response_pb_.release());
+  }
 }
 
 void RpcContext::RespondSuccess() {
@@ -161,6 +167,10 @@ MonoTime RpcContext::GetClientDeadline() const {
   return call_->GetClientDeadline();
 }
 
+MonoTime RpcContext::GetTimeReceived() const {
+  return call_->GetTimeReceived();
+}
+
 Trace* RpcContext::trace() {
   return call_->trace();
 }
@@ -23,6 +23,7 @@
 #include <unordered_set>
 
 #include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
@@ -192,7 +193,7 @@ class RpcController {
   std::unique_ptr<RequestIdPB> request_id_;
 
   // Once the call is sent, it is tracked here.
-  std::shared_ptr<OutboundCall> call_;
+  scoped_refptr<OutboundCall> call_;
 
   DISALLOW_COPY_AND_ASSIGN(RpcController);
 };
@@ -0,0 +1,68 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/rpc/rpc_sidecar.h"
+
+#include <utility>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/port.h"
+
+namespace kudu {
+namespace rpc {
+
+namespace {
+
+// A sidecar which owns its data in a faststring.
+class FaststringSidecar : public RpcSidecar {
+ public:
+  explicit FaststringSidecar(gscoped_ptr<faststring> data)
+      : data_(std::move(data)) {}
+
+  Slice AsSlice() const OVERRIDE { return *data_; }
+
+ private:
+  const gscoped_ptr<faststring> data_;
+
+  DISALLOW_COPY_AND_ASSIGN(FaststringSidecar);
+};
+
+// A sidecar which merely references data owned by the caller.
+class SliceSidecar : public RpcSidecar {
+ public:
+  explicit SliceSidecar(Slice slice) : slice_(slice) {}
+
+  Slice AsSlice() const OVERRIDE { return slice_; }
+
+ private:
+  const Slice slice_;
+
+  DISALLOW_COPY_AND_ASSIGN(SliceSidecar);
+};
+
+} // anonymous namespace
+
+gscoped_ptr<RpcSidecar> RpcSidecar::FromFaststring(gscoped_ptr<faststring> data) {
+  return gscoped_ptr<RpcSidecar>(new FaststringSidecar(std::move(data)));
+}
+
+gscoped_ptr<RpcSidecar> RpcSidecar::FromSlice(Slice slice) {
+  return gscoped_ptr<RpcSidecar>(new SliceSidecar(slice));
+}
+
+} // namespace rpc
+} // namespace kudu
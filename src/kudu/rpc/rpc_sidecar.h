@@ -32,9 +32,9 @@ namespace rpc {
 // The RpcSidecar saves on an additional copy to/from the protobuf on both the
 // server and client side. The InboundCall class accepts RpcSidecars, ignorant
 // of the form that the sidecar's data is kept in, requiring only that it can
-// be represented as a Slice. Data is then immediately copied from the
-// Slice returned from AsSlice() to the socket that is responding to the original
-// RPC.
+// be represented as a Slice. Sidecar slices are appended to the response's
+// payload slice list and written to the socket with writev(), so the data is
+// never staged through an intermediate response buffer.
 //
 // In order to distinguish between separate sidecars, whenever a sidecar is
 // added to the RPC response on the server side, an index for that sidecar is
@@ -51,16 +51,22 @@ namespace rpc {
 // through the RpcContext wrapper) on the client side.
 class RpcSidecar {
  public:
-  // Generates a sidecar with the parameter faststring as its data.
-  explicit RpcSidecar(gscoped_ptr<faststring> data) : data_(std::move(data)) {}
+  // Generates a sidecar which takes ownership of the parameter faststring.
+  static gscoped_ptr<RpcSidecar> FromFaststring(gscoped_ptr<faststring> data);
 
-  // Returns a Slice representation of the sidecar's data.
-  Slice AsSlice() const { return *data_; }
+  // Generates a sidecar which references data owned by the caller. The caller
+  // must guarantee that the referenced data remains alive and unmodified
+  // until the response has been fully written to the socket (i.e. until the
+  // InboundCall is destroyed). This allows handlers to attach data which they
+  // already own -- e.g. buffers pinned in the block cache, or per-scanner
+  // scratch buffers -- without first copying it into a freshly allocated
+  // buffer.
+  static gscoped_ptr<RpcSidecar> FromSlice(Slice slice);
 
- private:
-  const gscoped_ptr<faststring> data_;
+  virtual ~RpcSidecar() {}
 
-  DISALLOW_COPY_AND_ASSIGN(RpcSidecar);
+  // Returns a Slice representation of the sidecar's data.
+  virtual Slice AsSlice() const = 0;
 };
 
 } // namespace rpc
@@ -17,19 +17,37 @@
 
 #include "kudu/rpc/serialization.h"
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <google/protobuf/message_lite.h>
 #include <google/protobuf/io/coded_stream.h>
+#include <lz4.h>
 
 #include "kudu/gutil/endian.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/constants.h"
 #include "kudu/util/faststring.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
+DEFINE_bool(rpc_wire_compression, false,
+            "Whether to LZ4-compress large RPC message bodies before sending "
+            "them on the wire. Compression is only applied on connections to "
+            "peers which advertise support for it; older peers continue to "
+            "receive uncompressed messages.");
+TAG_FLAG(rpc_wire_compression, experimental);
+TAG_FLAG(rpc_wire_compression, runtime);
+
+DEFINE_int32(rpc_wire_compression_min_size, 4096,
+             "Minimum size, in bytes, of an RPC message body to consider for "
+             "compression when --rpc_wire_compression is enabled. Small "
+             "messages rarely benefit enough to justify the CPU cost.");
+TAG_FLAG(rpc_wire_compression_min_size, experimental);
+TAG_FLAG(rpc_wire_compression_min_size, runtime);
+
 DECLARE_int32(rpc_max_message_size);
 
 using google::protobuf::MessageLite;
@@ -153,6 +171,64 @@ Status ParseMessage(const Slice& buf,
   return Status::OK();
 }
 
+bool ShouldCompressBody(size_t body_len) {
+  return FLAGS_rpc_wire_compression &&
+      body_len >= static_cast<size_t>(FLAGS_rpc_wire_compression_min_size) &&
+      body_len <= static_cast<size_t>(LZ4_MAX_INPUT_SIZE);
+}
+
+bool CompressBody(const Slice& body, faststring* wire_body) {
+  // The varint delimiter for the compressed length is at most 5 bytes.
+  static const int kMaxVarintLength = 5;
+
+  DCHECK_LE(body.size(), LZ4_MAX_INPUT_SIZE);
+  int bound = LZ4_compressBound(body.size());
+
+  // Compress past a maximum-length varint, then write the delimiter into the
+  // gap just before the compressed bytes and shift the result to the front of
+  // the buffer.
+  wire_body->resize(kMaxVarintLength + bound);
+  int compressed_len = LZ4_compress_default(
+      reinterpret_cast<const char*>(body.data()),
+      reinterpret_cast<char*>(wire_body->data() + kMaxVarintLength),
+      body.size(), bound);
+  if (PREDICT_FALSE(compressed_len <= 0) ||
+      compressed_len >= static_cast<int>(body.size())) {
+    // Incompressible data (e.g. already-compressed or encrypted payloads)
+    // is better sent as-is.
+    return false;
+  }
+
+  int varint_len = CodedOutputStream::VarintSize32(compressed_len);
+  uint8_t* start = wire_body->data() + kMaxVarintLength - varint_len;
+  CodedOutputStream::WriteVarint32ToArray(compressed_len, start);
+  memmove(wire_body->data(), start, varint_len + compressed_len);
+  wire_body->resize(varint_len + compressed_len);
+  return true;
+}
+
+Status DecompressBody(const Slice& compressed,
+                      uint32_t uncompressed_length,
+                      faststring* body) {
+  if (PREDICT_FALSE(uncompressed_length >
+                    static_cast<uint32_t>(FLAGS_rpc_max_message_size))) {
+    return Status::Corruption(Substitute(
+        "Invalid packet: claimed uncompressed body length $0 is larger than "
+        "the maximum RPC message size $1",
+        uncompressed_length, FLAGS_rpc_max_message_size));
+  }
+  body->resize(uncompressed_length);
+  int n = LZ4_decompress_safe(reinterpret_cast<const char*>(compressed.data()),
+                              reinterpret_cast<char*>(body->data()),
+                              compressed.size(), uncompressed_length);
+  if (PREDICT_FALSE(n != static_cast<int>(uncompressed_length))) {
+    return Status::Corruption(Substitute(
+        "Invalid packet: compressed body failed to decompress to the claimed "
+        "$0 bytes", uncompressed_length));
+  }
+  return Status::OK();
+}
+
 void SerializeConnHeader(uint8_t* buf) {
   memcpy(reinterpret_cast<char *>(buf), kMagicNumber, kMagicNumberLength);
   buf += kMagicNumberLength;
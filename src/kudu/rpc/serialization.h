@@ -19,6 +19,7 @@
 #define KUDU_RPC_SERIALIZATION_H
 
 #include <inttypes.h>
+#include <stddef.h>
 #include <string.h>
 
 namespace google {
@@ -74,6 +75,26 @@ Status ParseMessage(const Slice& buf,
                     google::protobuf::MessageLite* parsed_header,
                     Slice* parsed_main_message);
 
+// Return true if a message body of 'body_len' bytes should be compressed
+// before being put on the wire. Considers --rpc_wire_compression and the
+// configured minimum size. The caller is still responsible for checking that
+// the peer advertised the WIRE_COMPRESSION feature flag.
+bool ShouldCompressBody(size_t body_len);
+
+// Compress 'body' (an uncompressed RPC message body) with LZ4, producing the
+// varint-delimited compressed frame which follows the serialized header on
+// the wire. Returns false (leaving 'wire_body' undefined) if the body did not
+// shrink, in which case the caller should send it uncompressed.
+bool CompressBody(const Slice& body, faststring* wire_body);
+
+// Decompress a message body which was compressed by CompressBody().
+// 'compressed' is the body as sliced out by ParseMessage() (i.e. without the
+// varint delimiter), and 'uncompressed_length' is the value from the message
+// header. On success, 'body' holds the decompressed bytes.
+Status DecompressBody(const Slice& compressed,
+                      uint32_t uncompressed_length,
+                      faststring* body);
+
 // Serialize the RPC connection header (magic number + flags).
 // buf must have 7 bytes available (kMagicNumberLength + kHeaderFlagsLength).
 void SerializeConnHeader(uint8_t* buf);
@@ -18,9 +18,11 @@
 #include "kudu/rpc/service_if.h"
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <google/protobuf/descriptor.pb.h>
 
+#include "kudu/gutil/casts.h"
 #include "kudu/gutil/strings/substitute.h"
 
 #include "kudu/rpc/connection.h"
@@ -35,14 +37,80 @@
 DEFINE_bool(enable_exactly_once, true, "Whether to enable exactly once semantics.");
 TAG_FLAG(enable_exactly_once, hidden);
 
+DEFINE_int32(rpc_max_pooled_messages_per_method, 32,
+             "Maximum number of request (and response) protobuf messages kept "
+             "in each RPC method's reuse pool. Pooled messages retain their "
+             "allocated storage across calls, avoiding per-field allocations "
+             "on hot methods. Set to 0 to disable message reuse.");
+TAG_FLAG(rpc_max_pooled_messages_per_method, advanced);
+
 using google::protobuf::Message;
 using std::string;
-using std::unique_ptr;
 using strings::Substitute;
 
 namespace kudu {
 namespace rpc {
 
+namespace {
+
+// Messages whose retained storage has grown beyond this are deleted rather
+// than returned to the pool, so that one giant request doesn't pin its
+// buffers for the life of the server.
+const int kMaxPooledMessageSpaceUsed = 256 * 1024;
+
+} // anonymous namespace
+
+RpcMethodInfo::~RpcMethodInfo() {
+  for (Message* m : req_pool_) {
+    delete m;
+  }
+  for (Message* m : resp_pool_) {
+    delete m;
+  }
+}
+
+Message* RpcMethodInfo::NewFromPool(std::vector<Message*>* pool,
+                                    const Message& prototype) {
+  {
+    std::lock_guard<simple_spinlock> l(pool_lock_);
+    if (!pool->empty()) {
+      Message* m = pool->back();
+      pool->pop_back();
+      return m;
+    }
+  }
+  return prototype.New();
+}
+
+void RpcMethodInfo::ReleaseToPool(std::vector<Message*>* pool, Message* m) {
+  if (FLAGS_rpc_max_pooled_messages_per_method > 0 &&
+      m->SpaceUsed() <= kMaxPooledMessageSpaceUsed) {
+    m->Clear();
+    std::lock_guard<simple_spinlock> l(pool_lock_);
+    if (pool->size() < implicit_cast<size_t>(FLAGS_rpc_max_pooled_messages_per_method)) {
+      pool->push_back(m);
+      return;
+    }
+  }
+  delete m;
+}
+
+Message* RpcMethodInfo::NewRequest() {
+  return NewFromPool(&req_pool_, *req_prototype);
+}
+
+Message* RpcMethodInfo::NewResponse() {
+  return NewFromPool(&resp_pool_, *resp_prototype);
+}
+
+void RpcMethodInfo::ReleaseRequest(Message* req) {
+  ReleaseToPool(&req_pool_, req);
+}
+
+void RpcMethodInfo::ReleaseResponse(Message* resp) {
+  ReleaseToPool(&resp_pool_, resp);
+}
+
 ServiceIf::~ServiceIf() {
 }
 
@@ -88,24 +156,28 @@ GeneratedServiceIf::~GeneratedServiceIf() {
 
 
 void GeneratedServiceIf::Handle(InboundCall *call) {
-  const RpcMethodInfo* method_info = call->method_info();
+  RpcMethodInfo* method_info = call->method_info();
   if (!method_info) {
     RespondBadMethod(call);
     return;
   }
-  unique_ptr<Message> req(method_info->req_prototype->New());
-  if (PREDICT_FALSE(!ParseParam(call, req.get()))) {
+  Message* req = method_info->NewRequest();
+  if (PREDICT_FALSE(!ParseParam(call, req))) {
+    method_info->ReleaseRequest(req);
     return;
   }
-  Message* resp = method_info->resp_prototype->New();
+  Message* resp = method_info->NewResponse();
 
   bool track_result = call->header().has_request_id()
                       && method_info->track_result
                       && FLAGS_enable_exactly_once;
   RpcContext* ctx = new RpcContext(call,
-                                   req.release(),
+                                   req,
                                    resp,
                                    track_result ? result_tracker_ : nullptr);
+  // The context returns the messages to the method's pools when it is
+  // destroyed, after the response has been serialized.
+  ctx->set_method_info(make_scoped_refptr(method_info));
   if (track_result) {
     RequestIdPB request_id(call->header().request_id());
     ResultTracker::RpcState state = ctx->result_tracker()->TrackRpc(
@@ -19,9 +19,11 @@
 
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/rpc/result_tracker.h"
@@ -47,6 +49,8 @@ class RpcContext;
 // by GeneratedServiceIf look up the RpcMethodInfo in order to handle
 // each RPC.
 struct RpcMethodInfo : public RefCountedThreadSafe<RpcMethodInfo> {
+  ~RpcMethodInfo();
+
   // Prototype protobufs for requests and responses.
   // These are empty protobufs which are cloned in order to provide an
   // instance for each request.
@@ -62,6 +66,34 @@ struct RpcMethodInfo : public RefCountedThreadSafe<RpcMethodInfo> {
   std::function<void(const google::protobuf::Message* req,
                      google::protobuf::Message* resp,
                      RpcContext* ctx)> func;
+
+  // Obtain a request or response message for a new invocation of this
+  // method, either recycled from the per-method pool or freshly cloned from
+  // the prototype. Message::Clear() retains allocated storage (repeated
+  // field capacity, string buffers), so recycled messages avoid nearly all
+  // of protobuf's internal allocations for hot methods whose messages have
+  // many fields (e.g. a WriteRequestPB carrying thousands of operations).
+  google::protobuf::Message* NewRequest();
+  google::protobuf::Message* NewResponse();
+
+  // Return a message obtained from NewRequest()/NewResponse() to its pool
+  // once no other code references it. Messages which have grown very large
+  // are deleted rather than pooled, so a single huge request doesn't pin
+  // its buffers forever.
+  void ReleaseRequest(google::protobuf::Message* req);
+  void ReleaseResponse(google::protobuf::Message* resp);
+
+ private:
+  google::protobuf::Message* NewFromPool(std::vector<google::protobuf::Message*>* pool,
+                                         const google::protobuf::Message& prototype);
+  void ReleaseToPool(std::vector<google::protobuf::Message*>* pool,
+                     google::protobuf::Message* m);
+
+  // Pools of cleared messages previously used by calls to this method,
+  // protected by 'pool_lock_'.
+  simple_spinlock pool_lock_;
+  std::vector<google::protobuf::Message*> req_pool_;
+  std::vector<google::protobuf::Message*> resp_pool_;
 };
 
 // Handles incoming messages that initiate an RPC.
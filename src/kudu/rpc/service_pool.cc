@@ -29,6 +29,8 @@
 #include "kudu/rpc/service_if.h"
 #include "kudu/rpc/service_queue.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/sysinfo.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/status.h"
@@ -38,6 +40,20 @@
 using std::shared_ptr;
 using strings::Substitute;
 
+DEFINE_bool(rpc_shard_per_core, false,
+            "Whether to run RPC service handling in shard-per-core mode. "
+            "When enabled, each service pool runs one worker thread per CPU, "
+            "pinned to that CPU, with its own call queue; reactor threads are "
+            "pinned the same way. Inbound calls are routed to the shard "
+            "serving their connection, so a connection's network processing "
+            "and request handling stay on one core and never contend on a "
+            "shared queue. Intended for read-heavy tablet servers; writes and "
+            "background work still use unpinned thread pools. When enabled, "
+            "the configured service thread counts are ignored in favor of "
+            "one thread per CPU.");
+TAG_FLAG(rpc_shard_per_core, advanced);
+TAG_FLAG(rpc_shard_per_core, experimental);
+
 METRIC_DEFINE_histogram(server, rpc_incoming_queue_time,
                         "RPC Queue Time",
                         kudu::MetricUnit::kMicroseconds,
@@ -68,6 +84,13 @@ ServicePool::ServicePool(gscoped_ptr<ServiceIf> service,
     rpcs_timed_out_in_queue_(METRIC_rpcs_timed_out_in_queue.Instantiate(entity)),
     rpcs_queue_overflow_(METRIC_rpcs_queue_overflow.Instantiate(entity)),
     closing_(false) {
+  if (PREDICT_FALSE(FLAGS_rpc_shard_per_core)) {
+    int num_shards = base::NumCPUs();
+    shard_queues_.reserve(num_shards);
+    for (int i = 0; i < num_shards; i++) {
+      shard_queues_.emplace_back(new LifoServiceQueue(service_queue_length));
+    }
+  }
 }
 
 ServicePool::~ServicePool() {
@@ -75,6 +98,21 @@ ServicePool::~ServicePool() {
 }
 
 Status ServicePool::Init(int num_threads) {
+  if (PREDICT_FALSE(!shard_queues_.empty())) {
+    if (num_threads != static_cast<int>(shard_queues_.size())) {
+      LOG(INFO) << Substitute(
+          "$0: shard-per-core mode enabled; running $1 pinned worker threads "
+          "(one per CPU) instead of the configured $2",
+          service_->service_name(), shard_queues_.size(), num_threads);
+    }
+    for (int i = 0; i < static_cast<int>(shard_queues_.size()); i++) {
+      scoped_refptr<kudu::Thread> new_thread;
+      CHECK_OK(kudu::Thread::Create("service pool", Substitute("rpc worker shard-$0", i),
+          &ServicePool::RunShardThread, this, i, &new_thread));
+      threads_.push_back(new_thread);
+    }
+    return Status::OK();
+  }
   for (int i = 0; i < num_threads; i++) {
     scoped_refptr<kudu::Thread> new_thread;
     CHECK_OK(kudu::Thread::Create("service pool", "rpc worker",
@@ -86,6 +124,9 @@ Status ServicePool::Init(int num_threads) {
 
 void ServicePool::Shutdown() {
   service_queue_.Shutdown();
+  for (auto& q : shard_queues_) {
+    q->Shutdown();
+  }
 
   MutexLock lock(shutdown_lock_);
   if (closing_) return;
@@ -95,30 +136,45 @@ void ServicePool::Shutdown() {
     CHECK_OK(ThreadJoiner(thread.get()).Join());
   }
 
-  // Now we must drain the service queue.
+  // Now we must drain the service queues.
   Status status = Status::ServiceUnavailable("Service is shutting down");
   std::unique_ptr<InboundCall> incoming;
   while (service_queue_.BlockingGet(&incoming)) {
     incoming.release()->RespondFailure(ErrorStatusPB::FATAL_SERVER_SHUTTING_DOWN, status);
   }
+  for (auto& q : shard_queues_) {
+    while (q->BlockingGet(&incoming)) {
+      incoming.release()->RespondFailure(ErrorStatusPB::FATAL_SERVER_SHUTTING_DOWN, status);
+    }
+  }
 
   service_->Shutdown();
 }
 
-void ServicePool::RejectTooBusy(InboundCall* c) {
+void ServicePool::RejectTooBusy(InboundCall* c, LifoServiceQueue* queue) {
   string err_msg =
       Substitute("$0 request on $1 from $2 dropped due to backpressure. "
                  "The service queue is full; it has $3 items.",
                  c->remote_method().method_name(),
                  service_->service_name(),
                  c->remote_address().ToString(),
-                 service_queue_.max_size());
+                 queue->max_size());
   rpcs_queue_overflow_->Increment();
   KLOG_EVERY_N_SECS(WARNING, 1) << err_msg;
   c->RespondFailure(ErrorStatusPB::ERROR_SERVER_TOO_BUSY,
                     Status::ServiceUnavailable(err_msg));
   DLOG(INFO) << err_msg << " Contents of service queue:\n"
-             << service_queue_.ToString();
+             << queue->ToString();
+}
+
+LifoServiceQueue* ServicePool::QueueForCall(InboundCall* c) {
+  if (PREDICT_TRUE(shard_queues_.empty())) {
+    return &service_queue_;
+  }
+  // Use the same hash that Messenger::RemoteToReactor() uses to assign the
+  // call's connection to a reactor, so that with reactors pinned the same
+  // way the call is handled on the core that received it.
+  return shard_queues_[c->remote_address().HashCode() % shard_queues_.size()].get();
 }
 
 RpcMethodInfo* ServicePool::LookupMethod(const RemoteMethod& method) {
@@ -143,15 +199,16 @@ Status ServicePool::QueueInboundCall(gscoped_ptr<InboundCall> call) {
   TRACE_TO(c->trace(), "Inserting onto call queue");
 
   // Queue message on service queue
+  LifoServiceQueue* queue = QueueForCall(c);
   boost::optional<InboundCall*> evicted;
-  auto queue_status = service_queue_.Put(c, &evicted);
+  auto queue_status = queue->Put(c, &evicted);
   if (queue_status == QUEUE_FULL) {
-    RejectTooBusy(c);
+    RejectTooBusy(c, queue);
     return Status::OK();
   }
 
   if (PREDICT_FALSE(evicted != boost::none)) {
-    RejectTooBusy(*evicted);
+    RejectTooBusy(*evicted, queue);
   }
 
   if (PREDICT_TRUE(queue_status == QUEUE_SUCCESS)) {
@@ -173,9 +230,20 @@ Status ServicePool::QueueInboundCall(gscoped_ptr<InboundCall> call) {
 }
 
 void ServicePool::RunThread() {
+  RunQueueLoop(&service_queue_);
+}
+
+void ServicePool::RunShardThread(int shard) {
+  WARN_NOT_OK(PinCurrentThreadToCpu(shard),
+              Substitute("Unable to pin $0 worker thread to CPU $1",
+                         service_->service_name(), shard));
+  RunQueueLoop(shard_queues_[shard].get());
+}
+
+void ServicePool::RunQueueLoop(LifoServiceQueue* queue) {
   while (true) {
     std::unique_ptr<InboundCall> incoming;
-    if (!service_queue_.BlockingGet(&incoming)) {
+    if (!queue->BlockingGet(&incoming)) {
       VLOG(1) << "ServicePool: messenger shutting down.";
       return;
     }
@@ -18,6 +18,7 @@
 #ifndef KUDU_SERVICE_POOL_H
 #define KUDU_SERVICE_POOL_H
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -77,11 +78,30 @@ class ServicePool : public RpcService {
 
  private:
   void RunThread();
-  void RejectTooBusy(InboundCall* c);
+
+  // Body of a worker thread in shard-per-core mode: pins the thread to
+  // CPU 'shard' and then serves calls from that shard's queue.
+  void RunShardThread(int shard);
+
+  // Serve calls from 'queue' until it is shut down.
+  void RunQueueLoop(LifoServiceQueue* queue);
+
+  void RejectTooBusy(InboundCall* c, LifoServiceQueue* queue);
+
+  // Return the queue that 'c' should be placed on: the single shared
+  // queue, or in shard-per-core mode the queue of the shard handling
+  // the call's connection.
+  LifoServiceQueue* QueueForCall(InboundCall* c);
 
   gscoped_ptr<ServiceIf> service_;
   std::vector<scoped_refptr<kudu::Thread> > threads_;
   LifoServiceQueue service_queue_;
+
+  // In shard-per-core mode, one queue per shard; otherwise empty and
+  // all threads serve 'service_queue_'. Calls are routed to shards by
+  // the same remote-address hash that assigns connections to reactors,
+  // so a connection's reactor and its service handling share a core.
+  std::vector<std::unique_ptr<LifoServiceQueue>> shard_queues_;
   scoped_refptr<Histogram> incoming_queue_time_;
   scoped_refptr<Counter> rpcs_timed_out_in_queue_;
   scoped_refptr<Counter> rpcs_queue_overflow_;
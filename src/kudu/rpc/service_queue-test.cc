@@ -43,6 +43,8 @@ DEFINE_int32(num_consumers, 20,
 DEFINE_int32(max_queue_size, 50,
              "Max queue length");
 
+DECLARE_bool(rpc_service_queue_numa_affinity);
+
 namespace kudu {
 namespace rpc {
 
@@ -140,5 +142,37 @@ TEST(TestServiceQueue, LifoServiceQueuePerf) {
   LOG(INFO) << "Avg idle workers:     " << total_idle_workers / static_cast<double>(total_sample);
 }
 
+// Smoke test for NUMA-affine dispatch: with the flag enabled, calls must
+// still flow through the queue and every producer/consumer must shut down
+// cleanly regardless of the machine's topology.
+TEST(TestServiceQueue, LifoServiceQueueNumaAffinity) {
+  FLAGS_rpc_service_queue_numa_affinity = true;
+  LifoServiceQueue queue(FLAGS_max_queue_size);
+  vector<std::thread> producers;
+  vector<std::thread> consumers;
+
+  for (int i = 0; i < FLAGS_num_producers; i++) {
+    producers.emplace_back(&ProducerThread<LifoServiceQueue>, &queue);
+  }
+
+  for (int i = 0; i < FLAGS_num_consumers; i++) {
+    consumers.emplace_back(&ConsumerThread<LifoServiceQueue>, &queue);
+  }
+
+  int32_t before = total;
+  SleepFor(MonoDelta::FromMilliseconds(500));
+  queue.Shutdown();
+  for (int i = 0; i < FLAGS_num_producers; i++) {
+    producers[i].join();
+  }
+  for (int i = 0; i < FLAGS_num_consumers; i++) {
+    consumers[i].join();
+  }
+
+  int32_t delta = total - before;
+  ASSERT_GT(delta, 0);
+  FLAGS_rpc_service_queue_numa_affinity = false;
+}
+
 } // namespace rpc
 } // namespace kudu
@@ -153,6 +153,7 @@ class LifoServiceQueue {
         cond_(&lock_),
         call_(nullptr),
         should_wake_(false),
+        last_numa_node_(0),
         bound_queue_(queue) {
     }
 
@@ -179,17 +180,32 @@ class LifoServiceQueue {
       DCHECK_EQ(q, bound_queue_);
     }
 
+    // The NUMA node that this consumer was last seen running on before it
+    // began waiting for work. Only read and written while holding the
+    // queue's lock.
+    void set_last_numa_node(int node) { last_numa_node_ = node; }
+    int last_numa_node() const { return last_numa_node_; }
+
    private:
     Mutex lock_;
     ConditionVariable cond_;
     InboundCall* call_;
     bool should_wake_;
+    int last_numa_node_;
 
     // For the purpose of assertions, tracks the LifoServiceQueue instance that
     // this consumer is reading from.
     LifoServiceQueue* bound_queue_;
   };
 
+  // Pick the waiting consumer to hand a new call to, returning an index into
+  // 'waiting_consumers_'. When NUMA-aware dispatch is enabled, prefers a
+  // recently-parked consumer last seen running on the same NUMA node as the
+  // calling (producer) thread; otherwise returns the most recently parked
+  // consumer (the top of the stack). Must be called with 'lock_' held and
+  // 'waiting_consumers_' non-empty.
+  int SelectWaitingConsumer() const;
+
   static __thread ConsumerState* tl_consumer_;
 
   mutable simple_spinlock lock_;
@@ -0,0 +1,168 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include <gtest/gtest.h>
+
+#include "kudu/gutil/port.h"
+#include "kudu/rpc/timer_wheel.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/test_util.h"
+
+namespace kudu {
+namespace rpc {
+
+namespace {
+
+// Test entry which counts how many times it has expired.
+class CountingEntry : public TimerWheelEntry {
+ public:
+  CountingEntry() : expirations(0) {}
+
+  int expirations;
+
+ protected:
+  virtual void OnTimerWheelExpired() OVERRIDE {
+    expirations++;
+  }
+};
+
+// Test entry which re-schedules itself once when it expires.
+class ReschedulingEntry : public CountingEntry {
+ public:
+  ReschedulingEntry(TimerWheel* wheel, MonoDelta next_delay)
+      : wheel_(wheel),
+        next_delay_(next_delay) {
+  }
+
+ protected:
+  virtual void OnTimerWheelExpired() OVERRIDE {
+    if (expirations == 0) {
+      wheel_->Schedule(this, deadline() + next_delay_);
+    }
+    expirations++;
+  }
+
+ private:
+  TimerWheel* const wheel_;
+  const MonoDelta next_delay_;
+};
+
+} // anonymous namespace
+
+class TimerWheelTest : public KuduTest {
+};
+
+TEST_F(TimerWheelTest, TestScheduleAndExpire) {
+  MonoTime now = MonoTime::Now();
+  TimerWheel wheel(MonoDelta::FromMilliseconds(1), 64, now);
+  ASSERT_TRUE(wheel.empty());
+
+  CountingEntry early;
+  CountingEntry late;
+  wheel.Schedule(&early, now + MonoDelta::FromMilliseconds(10));
+  wheel.Schedule(&late, now + MonoDelta::FromMilliseconds(30));
+  ASSERT_TRUE(early.scheduled());
+  ASSERT_FALSE(wheel.empty());
+
+  // Nothing should fire before the first deadline.
+  wheel.AdvanceTo(now + MonoDelta::FromMilliseconds(5));
+  ASSERT_EQ(0, early.expirations);
+  ASSERT_EQ(0, late.expirations);
+
+  // Advancing past the first deadline fires only the first entry.
+  wheel.AdvanceTo(now + MonoDelta::FromMilliseconds(15));
+  ASSERT_EQ(1, early.expirations);
+  ASSERT_FALSE(early.scheduled());
+  ASSERT_EQ(0, late.expirations);
+
+  wheel.AdvanceTo(now + MonoDelta::FromMilliseconds(40));
+  ASSERT_EQ(1, late.expirations);
+  ASSERT_TRUE(wheel.empty());
+}
+
+TEST_F(TimerWheelTest, TestCancel) {
+  MonoTime now = MonoTime::Now();
+  TimerWheel wheel(MonoDelta::FromMilliseconds(1), 64, now);
+
+  CountingEntry entry;
+  wheel.Schedule(&entry, now + MonoDelta::FromMilliseconds(10));
+  entry.Cancel();
+  ASSERT_FALSE(entry.scheduled());
+  ASSERT_TRUE(wheel.empty());
+
+  wheel.AdvanceTo(now + MonoDelta::FromMilliseconds(20));
+  ASSERT_EQ(0, entry.expirations);
+
+  // A cancelled entry may be re-scheduled.
+  wheel.Schedule(&entry, now + MonoDelta::FromMilliseconds(30));
+  wheel.AdvanceTo(now + MonoDelta::FromMilliseconds(40));
+  ASSERT_EQ(1, entry.expirations);
+}
+
+// An entry whose deadline is further out than one revolution of the wheel
+// must survive intermediate passes over its bucket.
+TEST_F(TimerWheelTest, TestDeadlineBeyondOneRevolution) {
+  MonoTime now = MonoTime::Now();
+  TimerWheel wheel(MonoDelta::FromMilliseconds(1), 16, now);
+
+  CountingEntry entry;
+  wheel.Schedule(&entry, now + MonoDelta::FromMilliseconds(100));
+
+  for (int ms = 10; ms <= 90; ms += 10) {
+    wheel.AdvanceTo(now + MonoDelta::FromMilliseconds(ms));
+    ASSERT_EQ(0, entry.expirations) << "fired early at +" << ms << "ms";
+  }
+  wheel.AdvanceTo(now + MonoDelta::FromMilliseconds(110));
+  ASSERT_EQ(1, entry.expirations);
+}
+
+// An entry with an already-elapsed deadline must fire on the next advance,
+// not a full revolution later.
+TEST_F(TimerWheelTest, TestScheduleInThePast) {
+  MonoTime now = MonoTime::Now();
+  TimerWheel wheel(MonoDelta::FromMilliseconds(1), 64, now);
+
+  wheel.AdvanceTo(now + MonoDelta::FromMilliseconds(20));
+
+  CountingEntry entry;
+  wheel.Schedule(&entry, now + MonoDelta::FromMilliseconds(10));
+  wheel.AdvanceTo(now + MonoDelta::FromMilliseconds(22));
+  ASSERT_EQ(1, entry.expirations);
+}
+
+// The expiry callback may re-schedule its own entry, as the two-stage RPC
+// timeout does.
+TEST_F(TimerWheelTest, TestRescheduleFromCallback) {
+  MonoTime now = MonoTime::Now();
+  TimerWheel wheel(MonoDelta::FromMilliseconds(1), 64, now);
+
+  ReschedulingEntry entry(&wheel, MonoDelta::FromMilliseconds(20));
+  wheel.Schedule(&entry, now + MonoDelta::FromMilliseconds(10));
+
+  wheel.AdvanceTo(now + MonoDelta::FromMilliseconds(15));
+  ASSERT_EQ(1, entry.expirations);
+  ASSERT_TRUE(entry.scheduled());
+
+  wheel.AdvanceTo(now + MonoDelta::FromMilliseconds(25));
+  ASSERT_EQ(1, entry.expirations);
+
+  wheel.AdvanceTo(now + MonoDelta::FromMilliseconds(35));
+  ASSERT_EQ(2, entry.expirations);
+  ASSERT_TRUE(wheel.empty());
+}
+
+} // namespace rpc
+} // namespace kudu
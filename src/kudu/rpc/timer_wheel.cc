@@ -0,0 +1,93 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/rpc/timer_wheel.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/port.h"
+
+namespace kudu {
+namespace rpc {
+
+TimerWheel::TimerWheel(MonoDelta tick, int num_buckets, MonoTime now)
+    : tick_(tick),
+      epoch_(now),
+      last_tick_(0),
+      buckets_(num_buckets) {
+  DCHECK_GT(tick.ToNanoseconds(), 0);
+  DCHECK_GT(num_buckets, 0);
+}
+
+int64_t TimerWheel::TickFor(MonoTime t) const {
+  if (PREDICT_FALSE(t < epoch_)) {
+    return 0;
+  }
+  return (t - epoch_).ToNanoseconds() / tick_.ToNanoseconds();
+}
+
+void TimerWheel::Schedule(TimerWheelEntry* entry, MonoTime deadline) {
+  DCHECK(!entry->scheduled());
+  entry->deadline_ = deadline;
+  // A deadline in an already-processed tick goes into the next tick's
+  // bucket, so that it fires on the next advance instead of waiting for a
+  // full revolution of the wheel.
+  int64_t tick = std::max(TickFor(deadline), last_tick_ + 1);
+  buckets_[tick % buckets_.size()].push_back(*entry);
+}
+
+void TimerWheel::AdvanceTo(MonoTime now) {
+  int64_t now_tick = TickFor(now);
+  if (now_tick <= last_tick_) {
+    return;
+  }
+  // Process the buckets of every tick since the last advance. If more than a
+  // full revolution has elapsed, a single pass over the wheel covers them
+  // all.
+  int64_t n_ticks = std::min<int64_t>(now_tick - last_tick_, buckets_.size());
+  for (int64_t t = last_tick_ + 1; t <= last_tick_ + n_ticks; t++) {
+    EntryList& bucket = buckets_[t % buckets_.size()];
+    EntryList::iterator it = bucket.begin();
+    while (it != bucket.end()) {
+      TimerWheelEntry* entry = &*it;
+      ++it;
+      if (entry->deadline_ <= now) {
+        // Unlink before invoking the callback so it may re-schedule the
+        // entry. Entries the callback adds to this bucket have a future
+        // deadline and are skipped by the check above.
+        entry->unlink();
+        entry->OnTimerWheelExpired();
+      }
+      // Else: the entry's deadline is one or more revolutions away; leave
+      // it for a later pass.
+    }
+  }
+  last_tick_ = now_tick;
+}
+
+bool TimerWheel::empty() const {
+  for (const EntryList& bucket : buckets_) {
+    if (!bucket.empty()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace rpc
+} // namespace kudu
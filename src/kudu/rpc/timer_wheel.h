@@ -0,0 +1,123 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_RPC_TIMER_WHEEL_H
+#define KUDU_RPC_TIMER_WHEEL_H
+
+#include <vector>
+
+#include <boost/intrusive/list.hpp>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/monotime.h"
+
+namespace kudu {
+namespace rpc {
+
+class TimerWheel;
+
+// An entry in a TimerWheel. Objects with a deadline inherit from this and
+// implement OnTimerWheelExpired(), which the wheel invokes when the deadline
+// passes.
+//
+// An entry may be cancelled at any time by Cancel(), and is cancelled
+// automatically on destruction, both in O(1).
+class TimerWheelEntry : public boost::intrusive::list_base_hook<
+    boost::intrusive::link_mode<boost::intrusive::auto_unlink> > {
+ public:
+  virtual ~TimerWheelEntry() {}
+
+  // Whether the entry is currently scheduled in a wheel.
+  bool scheduled() const { return is_linked(); }
+
+  // Remove the entry from its wheel, if scheduled. The entry may be
+  // re-scheduled afterwards.
+  void Cancel() {
+    if (is_linked()) {
+      unlink();
+    }
+  }
+
+  // The deadline most recently passed to TimerWheel::Schedule().
+  const MonoTime& deadline() const { return deadline_; }
+
+ protected:
+  // Invoked by the wheel, after unlinking the entry, once 'deadline_' has
+  // passed. May re-schedule the entry.
+  virtual void OnTimerWheelExpired() = 0;
+
+ private:
+  friend class TimerWheel;
+
+  MonoTime deadline_;
+};
+
+// A hashed timer wheel with coarse fixed-width buckets.
+//
+// Scheduling and cancelling an entry are O(1) list operations, in contrast
+// to a timer heap whose add/remove cost grows with the number of pending
+// timers. The trade-off is precision: the owner drives expiry by calling
+// AdvanceTo() periodically, and an entry fires up to one bucket width after
+// its deadline (plus however late AdvanceTo() is called).
+//
+// Entries whose deadline lies more than tick * num_buckets in the future
+// simply stay in their bucket across multiple revolutions of the wheel;
+// each pass over the bucket skips them until their deadline has passed.
+//
+// This class is not thread-safe; it is intended to be owned and driven by
+// a single event loop thread.
+class TimerWheel {
+ public:
+  // Create a wheel of 'num_buckets' buckets, each covering a time span of
+  // 'tick'. 'now' anchors the wheel; deadlines passed to Schedule() must
+  // not precede it.
+  TimerWheel(MonoDelta tick, int num_buckets, MonoTime now);
+
+  // Schedule 'entry' to expire once 'deadline' has passed. The entry must
+  // not already be scheduled, and must outlive the wheel or be cancelled
+  // before the wheel is destroyed.
+  void Schedule(TimerWheelEntry* entry, MonoTime deadline);
+
+  // Expire all entries whose deadline is at or before 'now'. Expired
+  // entries are unlinked before their OnTimerWheelExpired() is invoked, so
+  // the callback may re-schedule the entry.
+  void AdvanceTo(MonoTime now);
+
+  // Whether any entries are scheduled. O(num_buckets).
+  bool empty() const;
+
+ private:
+  typedef boost::intrusive::list<
+      TimerWheelEntry,
+      boost::intrusive::constant_time_size<false> > EntryList;
+
+  // The index of the tick containing time 't'.
+  int64_t TickFor(MonoTime t) const;
+
+  const MonoDelta tick_;
+  const MonoTime epoch_;
+
+  // The last tick fully processed by AdvanceTo().
+  int64_t last_tick_;
+
+  std::vector<EntryList> buckets_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimerWheel);
+};
+
+} // namespace rpc
+} // namespace kudu
+#endif // KUDU_RPC_TIMER_WHEEL_H
@@ -19,6 +19,7 @@
 
 #include <stdint.h>
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
@@ -155,11 +156,18 @@ OutboundTransfer::OutboundTransfer(int32_t call_id,
     cur_offset_in_slice_(0),
     callbacks_(callbacks),
     call_id_(call_id),
+    n_queue_jumps_(0),
     aborted_(false) {
   CHECK(!payload.empty());
 
   n_payload_slices_ = payload.size();
-  CHECK_LE(n_payload_slices_, arraysize(payload_slices_));
+  CHECK_LE(n_payload_slices_, kMaxPayloadSlices);
+  if (PREDICT_TRUE(n_payload_slices_ <= arraysize(inline_slices_))) {
+    payload_slices_ = inline_slices_;
+  } else {
+    heap_slices_.reset(new Slice[n_payload_slices_]);
+    payload_slices_ = heap_slices_.get();
+  }
   for (int i = 0; i < payload.size(); i++) {
     payload_slices_[i] = payload[i];
   }
@@ -184,35 +192,48 @@ Status OutboundTransfer::SendBuffer(Socket &socket) {
 
   int n_iovecs = n_payload_slices_ - cur_slice_idx_;
   struct iovec iovec[n_iovecs];
-  {
-    int offset_in_slice = cur_offset_in_slice_;
-    for (int i = 0; i < n_iovecs; i++) {
-      Slice &slice = payload_slices_[cur_slice_idx_ + i];
-      iovec[i].iov_base = slice.mutable_data() + offset_in_slice;
-      iovec[i].iov_len = slice.size() - offset_in_slice;
-
-      offset_in_slice = 0;
-    }
-  }
+  n_iovecs = FillIovecs(iovec, n_iovecs);
 
   int32_t written;
   Status status = socket.Writev(iovec, n_iovecs, &written);
   RETURN_ON_ERROR_OR_SOCKET_NOT_READY(status);
 
+  AdvanceSentBytes(written);
+  return Status::OK();
+}
+
+int OutboundTransfer::FillIovecs(struct iovec* iov, int max) const {
+  int n = std::min<int>(max, n_payload_slices_ - cur_slice_idx_);
+  int offset_in_slice = cur_offset_in_slice_;
+  for (int i = 0; i < n; i++) {
+    const Slice& slice = payload_slices_[cur_slice_idx_ + i];
+    iov[i].iov_base = const_cast<uint8_t*>(slice.data()) + offset_in_slice;
+    iov[i].iov_len = slice.size() - offset_in_slice;
+
+    offset_in_slice = 0;
+  }
+  return n;
+}
+
+int64_t OutboundTransfer::AdvanceSentBytes(int64_t num_bytes) {
+  int64_t consumed = 0;
+
   // Adjust our accounting of current writer position.
   for (int i = cur_slice_idx_; i < n_payload_slices_; i++) {
     Slice &slice = payload_slices_[i];
     int rem_in_slice = slice.size() - cur_offset_in_slice_;
     DCHECK_GE(rem_in_slice, 0);
 
-    if (written >= rem_in_slice) {
+    if (num_bytes >= rem_in_slice) {
       // Used up this entire slice, advance to the next slice.
       cur_slice_idx_++;
       cur_offset_in_slice_ = 0;
-      written -= rem_in_slice;
+      num_bytes -= rem_in_slice;
+      consumed += rem_in_slice;
     } else {
       // Partially used up this slice, just advance the offset within it.
-      cur_offset_in_slice_ += written;
+      cur_offset_in_slice_ += num_bytes;
+      consumed += num_bytes;
       break;
     }
   }
@@ -225,7 +246,7 @@ Status OutboundTransfer::SendBuffer(Socket &socket) {
     DCHECK_LT(cur_offset_in_slice_, payload_slices_[cur_slice_idx_].size());
   }
 
-  return Status::OK();
+  return consumed;
 }
 
 bool OutboundTransfer::TransferStarted() const {
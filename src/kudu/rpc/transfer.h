@@ -25,6 +25,7 @@
 #include <string>
 #include <vector>
 
+#include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/rpc/constants.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/status.h"
@@ -37,6 +38,8 @@ class Message;
 } // namespace protobuf
 } // namespace google
 
+struct iovec;
+
 namespace kudu {
 
 class Socket;
@@ -94,7 +97,20 @@ class InboundTransfer {
 // Upon completion of the transfer, a callback is triggered.
 class OutboundTransfer : public boost::intrusive::list_base_hook<> {
  public:
-  enum { kMaxPayloadSlices = 10 };
+  // The maximum number of slices in a single transfer. This is large enough
+  // for a columnar scan result carrying a few sidecars per projected column
+  // on a wide table, while staying comfortably below IOV_MAX.
+  enum { kMaxPayloadSlices = 386 };
+
+  // The number of slices stored inline in the transfer object itself.
+  // Payloads with more slices (rare) fall back to a heap allocation.
+  enum { kInlinePayloadSlices = 10 };
+
+  // The maximum number of times a queued transfer may be jumped ahead of by
+  // later-queued small responses before it refuses further queue jumps.
+  // This bounds how long a large response can be delayed by a stream of
+  // small ones sharing the connection.
+  enum { kMaxQueueJumps = 128 };
 
   // Factory methods for creating transfers associated with call requests
   // or responses. The 'payload' slices will be concatenated and
@@ -130,6 +146,22 @@ class OutboundTransfer : public boost::intrusive::list_base_hook<> {
   // send from our buffers into the sock
   Status SendBuffer(Socket &socket);
 
+  // Fill 'iov' with up to 'max' entries describing the not-yet-sent portion
+  // of the payload, without changing the transfer's position. Returns the
+  // number of entries filled in.
+  //
+  // Used by the connection to batch several queued transfers into a single
+  // writev() call; see Connection::WriteHandler().
+  int FillIovecs(struct ::iovec* iov, int max) const;
+
+  // Advance the transfer's position by up to 'num_bytes' bytes which were
+  // written to the socket (e.g. by a writev() whose byte count spanned
+  // several batched transfers). Returns the number of bytes attributed to
+  // this transfer, which may be less than 'num_bytes' if the transfer
+  // completed. Invokes TransferCallbacks::NotifyTransferFinished() if this
+  // completes the transfer.
+  int64_t AdvanceSentBytes(int64_t num_bytes);
+
   // Return true if any bytes have yet been sent.
   bool TransferStarted() const;
 
@@ -139,6 +171,18 @@ class OutboundTransfer : public boost::intrusive::list_base_hook<> {
   // Return the total number of bytes to be sent (including those already sent)
   int32_t TotalLength() const;
 
+  // Account for a later-queued transfer being inserted ahead of this one in
+  // the outbound queue. Returns false (without counting the jump) if this
+  // transfer has already been jumped kMaxQueueJumps times, in which case it
+  // must not be bypassed again.
+  bool IncrementQueueJumps() {
+    if (n_queue_jumps_ >= kMaxQueueJumps) {
+      return false;
+    }
+    n_queue_jumps_++;
+    return true;
+  }
+
   std::string HexDump() const;
 
   bool is_for_outbound_call() const {
@@ -157,9 +201,14 @@ class OutboundTransfer : public boost::intrusive::list_base_hook<> {
                    const std::vector<Slice> &payload,
                    TransferCallbacks *callbacks);
 
-  // Slices to send. Uses an array here instead of a vector to avoid an expensive
-  // vector construction (improved performance a couple percent).
-  Slice payload_slices_[kMaxPayloadSlices];
+  // Slices to send. Uses an inline array instead of a vector to avoid an
+  // expensive vector construction in the common case (improved performance a
+  // couple percent); payloads with more than kInlinePayloadSlices slices
+  // spill to 'heap_slices_'.
+  Slice inline_slices_[kInlinePayloadSlices];
+  gscoped_ptr<Slice[]> heap_slices_;
+  // Points at either 'inline_slices_' or 'heap_slices_'.
+  Slice* payload_slices_;
   size_t n_payload_slices_;
 
   // The current slice that is being sent.
@@ -173,6 +222,10 @@ class OutboundTransfer : public boost::intrusive::list_base_hook<> {
   // In the case of call responses, kInvalidCallId
   int32_t call_id_;
 
+  // The number of times a later-queued transfer has been inserted ahead of
+  // this one. See IncrementQueueJumps().
+  int32_t n_queue_jumps_;
+
   bool aborted_;
 
   DISALLOW_COPY_AND_ASSIGN(OutboundTransfer);
@@ -129,6 +129,24 @@ TEST_F(HybridClockTest, TestNow_ValuesIncreaseMonotonically) {
   ASSERT_LT(now1.value(), now2.value());
 }
 
+// Test that a batched allocation claims a contiguous range of timestamps
+// which no subsequent read of the clock will re-issue.
+TEST_F(HybridClockTest, TestNowRange_ClaimsExclusiveRange) {
+  const uint64_t kNumTimestamps = 100;
+  Timestamp first;
+  uint64_t max_error;
+  clock_->NowRangeWithError(kNumTimestamps, &first, &max_error);
+
+  // A subsequent read must be past the end of the claimed range.
+  const Timestamp after = clock_->Now();
+  ASSERT_GE(after.value(), first.value() + kNumTimestamps);
+
+  // Consecutive ranges must not overlap.
+  Timestamp second;
+  clock_->NowRangeWithError(kNumTimestamps, &second, &max_error);
+  ASSERT_GE(second.value(), first.value() + kNumTimestamps);
+}
+
 // Tests the clock updates with the incoming value if it is higher.
 TEST_F(HybridClockTest, TestUpdate_LogicalValueIncreasesByAmount) {
   Timestamp now = clock_->Now();
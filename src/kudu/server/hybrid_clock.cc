@@ -19,7 +19,6 @@
 
 #include <algorithm>
 #include <glog/logging.h>
-#include <mutex>
 
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -27,7 +26,6 @@
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/errno.h"
 #include "kudu/util/flag_tags.h"
-#include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/status.h"
@@ -188,7 +186,6 @@ Timestamp HybridClock::Now() {
   Timestamp now;
   uint64_t error;
 
-  std::lock_guard<simple_spinlock> lock(lock_);
   NowWithError(&now, &error);
   return now;
 }
@@ -197,10 +194,7 @@ Timestamp HybridClock::NowLatest() {
   Timestamp now;
   uint64_t error;
 
-  {
-    std::lock_guard<simple_spinlock> lock(lock_);
-    NowWithError(&now, &error);
-  }
+  NowWithError(&now, &error);
 
   uint64_t now_latest = GetPhysicalValueMicros(now) + error;
   uint64_t now_logical = GetLogicalValue(now);
@@ -217,8 +211,15 @@ Status HybridClock::GetGlobalLatest(Timestamp* t) {
 }
 
 void HybridClock::NowWithError(Timestamp* timestamp, uint64_t* max_error_usec) {
+  NowRangeWithError(1, timestamp, max_error_usec);
+}
+
+void HybridClock::NowRangeWithError(uint64_t num_timestamps,
+                                    Timestamp* first_timestamp,
+                                    uint64_t* max_error_usec) {
 
   DCHECK_EQ(state_, kInitialized) << "Clock not initialized. Must call Init() first.";
+  DCHECK_GT(num_timestamps, 0);
 
   uint64_t now_usec;
   uint64_t error_usec;
@@ -228,49 +229,65 @@ void HybridClock::NowWithError(Timestamp* timestamp, uint64_t* max_error_usec) {
         "Status: $0", s.ToString());
   }
 
-  // If the physical time from the system clock is higher than our last-returned
-  // time, we should use the physical timestamp.
-  uint64_t candidate_phys_timestamp = now_usec << kBitsToShift;
-  if (PREDICT_TRUE(candidate_phys_timestamp > next_timestamp_)) {
-    next_timestamp_ = candidate_phys_timestamp;
-    *timestamp = Timestamp(next_timestamp_++);
-    *max_error_usec = error_usec;
+  // Claim the range [*first_timestamp, *first_timestamp + num_timestamps)
+  // with a single compare-and-swap on 'next_timestamp_', retrying on
+  // contention. The walltime read above is reused across retries: a slightly
+  // stale walltime is always safe, since at worst we take the
+  // increment-the-logical-value path where a fresher read would have allowed
+  // resetting to the physical clock.
+  while (true) {
+    uint64_t obs = next_timestamp_.Load();
+
+    // If the physical time from the system clock is higher than our
+    // last-returned time, we should use the physical timestamp.
+    uint64_t candidate_phys_timestamp = now_usec << kBitsToShift;
+    if (PREDICT_TRUE(candidate_phys_timestamp > obs)) {
+      if (PREDICT_FALSE(!next_timestamp_.CompareAndSet(
+              obs, candidate_phys_timestamp + num_timestamps))) {
+        continue;
+      }
+      *first_timestamp = Timestamp(candidate_phys_timestamp);
+      *max_error_usec = error_usec;
+      if (PREDICT_FALSE(VLOG_IS_ON(2))) {
+        VLOG(2) << "Current clock is higher than the last one. Resetting logical values."
+            << " Physical Value: " << now_usec << " usec Logical Value: 0  Error: "
+            << error_usec;
+      }
+      return;
+    }
+
+    // We don't have the last time read max error since it might have originated
+    // in another machine, but we can put a bound on the maximum error of the
+    // timestamp we are providing.
+    // In particular we know that the "true" time falls within the interval
+    // now_usec +- now.maxerror so we get the following situations:
+    //
+    // 1)
+    // --------|----------|----|---------|--------------------------> time
+    //     now - e       now  last   now + e
+    // 2)
+    // --------|----------|--------------|------|-------------------> time
+    //     now - e       now         now + e   last
+    //
+    // Assuming, in the worst case, that the "true" time is now - error we need to
+    // always return: last - (now - e) as the new maximum error.
+    // This broadens the error interval for both cases but always returns
+    // a correct error interval.
+    if (PREDICT_FALSE(!next_timestamp_.CompareAndSet(obs, obs + num_timestamps))) {
+      continue;
+    }
+    *max_error_usec = (obs >> kBitsToShift) - (now_usec - error_usec);
+    *first_timestamp = Timestamp(obs);
     if (PREDICT_FALSE(VLOG_IS_ON(2))) {
-      VLOG(2) << "Current clock is higher than the last one. Resetting logical values."
-          << " Physical Value: " << now_usec << " usec Logical Value: 0  Error: "
-          << error_usec;
+      VLOG(2) << "Current clock is lower than the last one. Returning last read and incrementing"
+          " logical values. Clock: " + Stringify(*first_timestamp) << " Error: "
+          << *max_error_usec;
     }
     return;
   }
-
-  // We don't have the last time read max error since it might have originated
-  // in another machine, but we can put a bound on the maximum error of the
-  // timestamp we are providing.
-  // In particular we know that the "true" time falls within the interval
-  // now_usec +- now.maxerror so we get the following situations:
-  //
-  // 1)
-  // --------|----------|----|---------|--------------------------> time
-  //     now - e       now  last   now + e
-  // 2)
-  // --------|----------|--------------|------|-------------------> time
-  //     now - e       now         now + e   last
-  //
-  // Assuming, in the worst case, that the "true" time is now - error we need to
-  // always return: last - (now - e) as the new maximum error.
-  // This broadens the error interval for both cases but always returns
-  // a correct error interval.
-
-  *max_error_usec = (next_timestamp_ >> kBitsToShift) - (now_usec - error_usec);
-  *timestamp = Timestamp(next_timestamp_++);
-  if (PREDICT_FALSE(VLOG_IS_ON(2))) {
-    VLOG(2) << "Current clock is lower than the last one. Returning last read and incrementing"
-        " logical values. Clock: " + Stringify(*timestamp) << " Error: " << *max_error_usec;
-  }
 }
 
 Status HybridClock::Update(const Timestamp& to_update) {
-  std::lock_guard<simple_spinlock> lock(lock_);
   Timestamp now;
   uint64_t error_ignored;
   NowWithError(&now, &error_ignored);
@@ -291,9 +308,10 @@ Status HybridClock::Update(const Timestamp& to_update) {
     return Status::InvalidArgument("Tried to update clock beyond the max. error.");
   }
 
-  // Our next timestamp must be higher than the one that we are updating
-  // from.
-  next_timestamp_ = to_update.value() + 1;
+  // Our next timestamp must be higher than the one that we are updating from.
+  // A concurrent caller may have advanced 'next_timestamp_' further in the
+  // meantime, in which case there's nothing left to do.
+  next_timestamp_.StoreMax(to_update.value() + 1);
   return Status::OK();
 }
 
@@ -314,10 +332,7 @@ Status HybridClock::WaitUntilAfter(const Timestamp& then,
   TRACE_EVENT0("clock", "HybridClock::WaitUntilAfter");
   Timestamp now;
   uint64_t error;
-  {
-    std::lock_guard<simple_spinlock> lock(lock_);
-    NowWithError(&now, &error);
-  }
+  NowWithError(&now, &error);
 
   // "unshift" the timestamps so that we can measure actual time
   uint64_t now_usec = GetPhysicalValueMicros(now);
@@ -358,10 +373,7 @@ Status HybridClock::WaitUntilAfterLocally(const Timestamp& then,
   while (true) {
     Timestamp now;
     uint64_t error;
-    {
-      std::lock_guard<simple_spinlock> lock(lock_);
-      NowWithError(&now, &error);
-    }
+    NowWithError(&now, &error);
     if (now > then) {
       return Status::OK();
     }
@@ -379,21 +391,15 @@ bool HybridClock::IsAfter(Timestamp t) {
   uint64_t error_usec;
   CHECK_OK(WalltimeWithError(&now_usec, &error_usec));
 
-  Timestamp now;
-  {
-    std::lock_guard<simple_spinlock> lock(lock_);
-    now = Timestamp(std::max(next_timestamp_, now_usec << kBitsToShift));
-  }
+  Timestamp now(std::max(next_timestamp_.Load(), now_usec << kBitsToShift));
   return t.value() < now.value();
 }
 
 kudu::Status HybridClock::WalltimeWithError(uint64_t* now_usec, uint64_t* error_usec) {
   if (PREDICT_FALSE(FLAGS_use_mock_wall_clock)) {
-    VLOG(1) << "Current clock time: " << mock_clock_time_usec_ << " error: "
-            << mock_clock_max_error_usec_ << ". Updating to time: " << now_usec
-            << " and error: " << error_usec;
-    *now_usec = mock_clock_time_usec_;
-    *error_usec = mock_clock_max_error_usec_;
+    *now_usec = mock_clock_time_usec_.Load();
+    *error_usec = mock_clock_max_error_usec_.Load();
+    VLOG(1) << "Current clock time: " << *now_usec << " error: " << *error_usec;
   } else {
 #if defined(__APPLE__)
     *now_usec = GetCurrentTimeMicros();
@@ -419,15 +425,13 @@ kudu::Status HybridClock::WalltimeWithError(uint64_t* now_usec, uint64_t* error_
 
 void HybridClock::SetMockClockWallTimeForTests(uint64_t now_usec) {
   CHECK(FLAGS_use_mock_wall_clock);
-  std::lock_guard<simple_spinlock> lock(lock_);
-  CHECK_GE(now_usec, mock_clock_time_usec_);
-  mock_clock_time_usec_ = now_usec;
+  CHECK_GE(now_usec, mock_clock_time_usec_.Load());
+  mock_clock_time_usec_.Store(now_usec);
 }
 
 void HybridClock::SetMockMaxClockErrorForTests(uint64_t max_error_usec) {
   CHECK(FLAGS_use_mock_wall_clock);
-  std::lock_guard<simple_spinlock> lock(lock_);
-  mock_clock_max_error_usec_ = max_error_usec;
+  mock_clock_max_error_usec_.Store(max_error_usec);
 }
 
 // Used to get the timestamp for metrics.
@@ -439,8 +443,6 @@ uint64_t HybridClock::NowForMetrics() {
 uint64_t HybridClock::ErrorForMetrics() {
   Timestamp now;
   uint64_t error;
-
-  std::lock_guard<simple_spinlock> lock(lock_);
   NowWithError(&now, &error);
   return error;
 }
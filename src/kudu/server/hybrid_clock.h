@@ -22,7 +22,7 @@
 
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/server/clock.h"
-#include "kudu/util/locks.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/status.h"
 
@@ -121,6 +121,19 @@ class HybridClock : public Clock {
   // LOG(FATAL)'s in that case.
   void NowWithError(Timestamp* timestamp, uint64_t* max_error_usec);
 
+  // Obtains a contiguous range of 'num_timestamps' timestamps in a single
+  // atomic operation, along with the maximum error associated with the first
+  // of them. The caller exclusively owns the range
+  // [*first_timestamp, *first_timestamp + num_timestamps): no concurrent
+  // caller and no future call to Now() will observe a timestamp in it.
+  //
+  // This costs the same as a single Now() call, so callers which need one
+  // timestamp per operation for a batch of operations should prefer it over
+  // per-operation calls.
+  void NowRangeWithError(uint64_t num_timestamps,
+                         Timestamp* first_timestamp,
+                         uint64_t* max_error_usec);
+
   virtual std::string Stringify(Timestamp timestamp) OVERRIDE;
 
   // Static encoding/decoding methods for timestamps. Public mostly
@@ -178,11 +191,11 @@ class HybridClock : public Clock {
 
   // Set by calls to SetMockClockWallTimeForTests().
   // For testing purposes only.
-  uint64_t mock_clock_time_usec_;
+  AtomicInt<uint64_t> mock_clock_time_usec_;
 
   // Set by calls to SetMockClockErrorForTests().
   // For testing purposes only.
-  uint64_t mock_clock_max_error_usec_;
+  AtomicInt<uint64_t> mock_clock_max_error_usec_;
 
 #if !defined(__APPLE__)
   uint64_t divisor_;
@@ -190,11 +203,11 @@ class HybridClock : public Clock {
 
   double tolerance_adjustment_;
 
-  mutable simple_spinlock lock_;
-
   // The next timestamp to be generated from this clock, assuming that
   // the physical clock hasn't advanced beyond the value stored here.
-  uint64_t next_timestamp_;
+  // Accessed lock-free: readers claim timestamps (or ranges of them) via
+  // compare-and-swap.
+  AtomicInt<uint64_t> next_timestamp_;
 
   // How many bits to left shift a microseconds clock read. The remainder
   // of the timestamp will be reserved for logical values.
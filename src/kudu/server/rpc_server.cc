@@ -112,14 +112,22 @@ Status RpcServer::Init(const shared_ptr<Messenger>& messenger) {
   return Status::OK();
 }
 
-Status RpcServer::RegisterService(gscoped_ptr<rpc::ServiceIf> service) {
+Status RpcServer::RegisterService(gscoped_ptr<rpc::ServiceIf> service,
+                                  int queue_length,
+                                  int num_threads) {
   CHECK(server_state_ == INITIALIZED ||
         server_state_ == BOUND) << "bad state: " << server_state_;
+  if (queue_length < 0) {
+    queue_length = options_.service_queue_length;
+  }
+  if (num_threads < 0) {
+    num_threads = options_.num_service_threads;
+  }
   const scoped_refptr<MetricEntity>& metric_entity = messenger_->metric_entity();
   string service_name = service->service_name();
   scoped_refptr<rpc::ServicePool> service_pool =
-    new rpc::ServicePool(std::move(service), metric_entity, options_.service_queue_length);
-  RETURN_NOT_OK(service_pool->Init(options_.num_service_threads));
+    new rpc::ServicePool(std::move(service), metric_entity, queue_length);
+  RETURN_NOT_OK(service_pool->Init(num_threads));
   RETURN_NOT_OK(messenger_->RegisterService(service_name, service_pool));
   return Status::OK();
 }
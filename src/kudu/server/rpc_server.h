@@ -53,7 +53,20 @@ class RpcServer {
   Status Init(const std::shared_ptr<rpc::Messenger>& messenger);
   // Services need to be registered after Init'ing, but before Start'ing.
   // The service's ownership will be given to a ServicePool.
-  Status RegisterService(gscoped_ptr<rpc::ServiceIf> service);
+  //
+  // 'queue_length' is the maximum number of requests that may be queued for
+  // the service before Put() responds with "server too busy"; if -1, the
+  // server-wide default (--rpc_service_queue_length) is used. Each service
+  // has its own pool and queue, so a dedicated length isolates the service's
+  // queue capacity from slower method classes on other services.
+  //
+  // 'num_threads' is the number of worker threads for the service's pool; if
+  // -1, the server-wide default (--rpc_num_service_threads) is used. A
+  // dedicated thread count similarly isolates the service's processing
+  // capacity from other services.
+  Status RegisterService(gscoped_ptr<rpc::ServiceIf> service,
+                         int queue_length = -1,
+                         int num_threads = -1);
   Status Bind();
   Status Start();
   void Shutdown();
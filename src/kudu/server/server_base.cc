@@ -257,8 +257,10 @@ Status ServerBase::DumpServerInfo(const string& path,
   return Status::OK();
 }
 
-Status ServerBase::RegisterService(gscoped_ptr<rpc::ServiceIf> rpc_impl) {
-  return rpc_server_->RegisterService(std::move(rpc_impl));
+Status ServerBase::RegisterService(gscoped_ptr<rpc::ServiceIf> rpc_impl,
+                                   int queue_length,
+                                   int num_threads) {
+  return rpc_server_->RegisterService(std::move(rpc_impl), queue_length, num_threads);
 }
 
 Status ServerBase::StartMetricsLogging() {
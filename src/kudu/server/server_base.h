@@ -95,7 +95,12 @@ class ServerBase {
   virtual ~ServerBase();
 
   Status Init();
-  Status RegisterService(gscoped_ptr<rpc::ServiceIf> rpc_impl);
+  // Register an RPC service with the server. 'queue_length' and 'num_threads'
+  // override the default RPC queue length and worker thread count for the
+  // service's pool; see RpcServer::RegisterService().
+  Status RegisterService(gscoped_ptr<rpc::ServiceIf> rpc_impl,
+                         int queue_length = -1,
+                         int num_threads = -1);
   Status Start();
   void Shutdown();
 
@@ -20,6 +20,7 @@
 #include <glog/logging.h>
 
 #include "kudu/common/generic_iterators.h"
+#include "kudu/gutil/stringprintf.h"
 #include "kudu/tablet/cfile_set.h"
 #include "kudu/tablet/diskrowset-test-base.h"
 #include "kudu/tablet/tablet-test-base.h"
@@ -27,6 +28,7 @@
 #include "kudu/util/test_util.h"
 
 DECLARE_int32(cfile_default_block_size);
+DECLARE_bool(cfile_set_index_only_key_scan);
 
 using std::shared_ptr;
 
@@ -291,6 +293,115 @@ TEST_F(TestCFileSet, TestRangeScan) {
   EXPECT_EQ(stats[2].data_blocks_read_from_disk, 1);
 }
 
+TEST_F(TestCFileSet, TestInListSkipScan) {
+  const int kNumRows = 10000;
+  WriteTestRowSet(kNumRows);
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), &fileset));
+
+  // Create iterator.
+  shared_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&schema_));
+  gscoped_ptr<RowwiseIterator> iter(new MaterializingIterator(cfile_iter));
+
+  // Create a scan with an IN-list predicate on the key column. The list
+  // mixes values which are present (the key column is rowidx * 2), values
+  // which fall between rows, and a value past the end of the data.
+  vector<int32_t> in_list = { 0, 1, 500, 2000, 2001, 19998, 50000 };
+  vector<const void*> in_list_ptrs;
+  for (const int32_t& v : in_list) {
+    in_list_ptrs.push_back(&v);
+  }
+  ScanSpec spec;
+  spec.AddPredicate(ColumnPredicate::InList(schema_.column(0), &in_list_ptrs));
+  ASSERT_OK(iter->Init(&spec));
+
+  // Each present value should have become its own skip scan range.
+  ASSERT_EQ(4, cfile_iter->skip_scan_ranges_.size());
+
+  // Read all the results and ensure only the matching rows came back.
+  vector<string> results;
+  ASSERT_OK(IterateToStringList(iter.get(), &results));
+  ASSERT_EQ(4, results.size());
+  EXPECT_EQ("(int32 c0=0, int32 c1=0, int32 c2=0)", results[0]);
+  EXPECT_EQ("(int32 c0=500, int32 c1=2500, int32 c2=25000)", results[1]);
+  EXPECT_EQ("(int32 c0=2000, int32 c1=10000, int32 c2=100000)", results[2]);
+  EXPECT_EQ("(int32 c0=19998, int32 c1=99990, int32 c2=999900)", results[3]);
+
+  // The narrow ranges should have read only a handful of data blocks per
+  // column, rather than scanning everything between the first and last
+  // value.
+  vector<IteratorStats> stats;
+  iter->GetIteratorStats(&stats);
+  EXPECT_LE(stats[0].data_blocks_read_from_disk, 4);
+}
+
+// Predicates on non-key columns whose range falls entirely outside the
+// stored min/max value statistics should collapse the scan to an empty
+// range, as long as the column is known to be delta-free.
+TEST_F(TestCFileSet, TestValueStatsPruning) {
+  const int kNumRows = 10000;
+  WriteTestRowSet(kNumRows);
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), &fileset));
+
+  // c1 contains rowidx * 10, so its stored value range is [0, 99990].
+  int32_t lower = 200000;
+  int32_t upper = 300000;
+
+  // With no delta-affected columns, a fully-excluded range should prune the
+  // whole rowset.
+  {
+    shared_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&schema_));
+    gscoped_ptr<RowwiseIterator> iter(new MaterializingIterator(cfile_iter));
+    cfile_iter->SetColumnsWithDeltas({});
+    ScanSpec spec;
+    spec.AddPredicate(ColumnPredicate::Range(schema_.column(1), &lower, &upper));
+    ASSERT_OK(iter->Init(&spec));
+    EXPECT_EQ(cfile_iter->lower_bound_idx_, cfile_iter->upper_bound_idx_);
+    EXPECT_FALSE(cfile_iter->HasNext());
+  }
+
+  // If the iterator isn't told which columns are delta-free, a delta could
+  // move a value into the predicate's range, so nothing may be pruned.
+  {
+    shared_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&schema_));
+    gscoped_ptr<RowwiseIterator> iter(new MaterializingIterator(cfile_iter));
+    ScanSpec spec;
+    spec.AddPredicate(ColumnPredicate::Range(schema_.column(1), &lower, &upper));
+    ASSERT_OK(iter->Init(&spec));
+    EXPECT_EQ(0, cfile_iter->lower_bound_idx_);
+    EXPECT_EQ(kNumRows, cfile_iter->upper_bound_idx_);
+  }
+
+  // Ditto when the predicate's column itself may be affected by deltas.
+  {
+    shared_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&schema_));
+    gscoped_ptr<RowwiseIterator> iter(new MaterializingIterator(cfile_iter));
+    cfile_iter->SetColumnsWithDeltas({ rowset_meta_->tablet_schema().column_id(1) });
+    ScanSpec spec;
+    spec.AddPredicate(ColumnPredicate::Range(schema_.column(1), &lower, &upper));
+    ASSERT_OK(iter->Init(&spec));
+    EXPECT_EQ(0, cfile_iter->lower_bound_idx_);
+    EXPECT_EQ(kNumRows, cfile_iter->upper_bound_idx_);
+  }
+
+  // A predicate which overlaps the stored range must not prune anything.
+  {
+    shared_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&schema_));
+    gscoped_ptr<RowwiseIterator> iter(new MaterializingIterator(cfile_iter));
+    cfile_iter->SetColumnsWithDeltas({});
+    int32_t overlap_upper = 1000;
+    ScanSpec spec;
+    spec.AddPredicate(ColumnPredicate::Range(schema_.column(1), nullptr, &overlap_upper));
+    ASSERT_OK(iter->Init(&spec));
+    vector<string> results;
+    ASSERT_OK(IterateToStringList(iter.get(), &results));
+    ASSERT_EQ(100, results.size());
+  }
+}
+
 // Several other black-box tests for range scans. These are similar to
 // TestRangeScan above, except don't inspect internal state.
 TEST_F(TestCFileSet, TestRangePredicates2) {
@@ -319,5 +430,123 @@ TEST_F(TestCFileSet, TestRangePredicates2) {
 }
 
 
+class TestCompositeKeyCFileSet : public KuduRowSetTest {
+ public:
+  TestCompositeKeyCFileSet() :
+    KuduRowSetTest(Schema({ ColumnSchema("k0", INT32),
+                            ColumnSchema("k1", STRING),
+                            ColumnSchema("val", INT32) }, 2))
+  {}
+
+ protected:
+  // Write out a test rowset with a two-column composite key.
+  // The first key column contains the row index, the second a
+  // zero-padded string form of it, and the value column index * 10.
+  void WriteTestRowSet(int nrows) {
+    DiskRowSetWriter rsw(rowset_meta_.get(), &schema_,
+                         BloomFilterSizing::BySizeAndFPRate(32*1024, 0.01f));
+
+    ASSERT_OK(rsw.Open());
+
+    RowBuilder rb(schema_);
+    for (int i = 0; i < nrows; i++) {
+      rb.Reset();
+      rb.AddInt32(i);
+      rb.AddString(StringPrintf("row_%08d", i));
+      rb.AddInt32(i * 10);
+      ASSERT_OK_FAST(WriteRow(rb.data(), &rsw));
+    }
+    ASSERT_OK(rsw.Finish());
+  }
+
+  // Scan the given key-only projection, appending the first key column of
+  // every selected row to 'results'.
+  void ScanFirstKeyColumn(const shared_ptr<CFileSet>& fileset,
+                          const Schema& key_proj,
+                          ScanSpec* spec,
+                          vector<int32_t>* results) {
+    shared_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&key_proj));
+    gscoped_ptr<RowwiseIterator> iter(new MaterializingIterator(cfile_iter));
+    ASSERT_OK(iter->Init(spec));
+
+    Arena arena(1024, 1024);
+    RowBlock block(key_proj, 100, &arena);
+    while (iter->HasNext()) {
+      ASSERT_OK_FAST(iter->NextBlock(&block));
+      for (size_t i = 0; i < block.nrows(); i++) {
+        if (!block.selection_vector()->IsRowSelected(i)) continue;
+        results->push_back(*key_proj.ExtractColumnFromRow<INT32>(block.row(i), 0));
+      }
+    }
+  }
+
+  google::FlagSaver saver_;
+};
+
+// Test that a projection containing only key columns is decoded correctly
+// from the composite key index cfile, and that it matches the result of
+// reading the per-column cfiles.
+TEST_F(TestCompositeKeyCFileSet, TestIndexOnlyScan) {
+  const int kNumRows = 1000;
+  WriteTestRowSet(kNumRows);
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), &fileset));
+
+  Schema key_proj = schema_.CreateKeyProjection();
+  shared_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&key_proj));
+  gscoped_ptr<RowwiseIterator> iter(new MaterializingIterator(cfile_iter));
+  ASSERT_OK(iter->Init(nullptr));
+
+  Arena arena(1024, 1024);
+  RowBlock block(key_proj, 100, &arena);
+  int row_idx = 0;
+  while (iter->HasNext()) {
+    ASSERT_OK_FAST(iter->NextBlock(&block));
+    for (size_t i = 0; i < block.nrows(); i++) {
+      RowBlockRow row = block.row(i);
+      ASSERT_EQ(row_idx, *key_proj.ExtractColumnFromRow<INT32>(row, 0));
+      ASSERT_EQ(StringPrintf("row_%08d", row_idx),
+                key_proj.ExtractColumnFromRow<STRING>(row, 1)->ToString());
+      row_idx++;
+    }
+  }
+  ASSERT_EQ(kNumRows, row_idx);
+
+  // The same scan with the index-only path disabled should yield the same
+  // first key column values.
+  vector<int32_t> with_index;
+  vector<int32_t> without_index;
+  NO_FATALS(ScanFirstKeyColumn(fileset, key_proj, nullptr, &with_index));
+  FLAGS_cfile_set_index_only_key_scan = false;
+  NO_FATALS(ScanFirstKeyColumn(fileset, key_proj, nullptr, &without_index));
+  ASSERT_EQ(without_index, with_index);
+  ASSERT_EQ(kNumRows, with_index.size());
+}
+
+// Test an index-only scan which starts mid-file: the key index cfile has no
+// positional index, so the iterator skips forward to the start of each skip
+// scan range.
+TEST_F(TestCompositeKeyCFileSet, TestIndexOnlySkipScan) {
+  const int kNumRows = 10000;
+  WriteTestRowSet(kNumRows);
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), &fileset));
+
+  Schema key_proj = schema_.CreateKeyProjection();
+  vector<int32_t> in_list = { 10, 500, 9999 };
+  vector<const void*> in_list_ptrs;
+  for (const int32_t& v : in_list) {
+    in_list_ptrs.push_back(&v);
+  }
+  ScanSpec spec;
+  spec.AddPredicate(ColumnPredicate::InList(key_proj.column(0), &in_list_ptrs));
+
+  vector<int32_t> found;
+  NO_FATALS(ScanFirstKeyColumn(fileset, key_proj, &spec, &found));
+  ASSERT_EQ(vector<int32_t>({ 10, 500, 9999 }), found);
+}
+
 } // namespace tablet
 } // namespace kudu
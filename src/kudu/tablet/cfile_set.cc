@@ -16,7 +16,9 @@
 // under the License.
 
 #include <algorithm>
+#include <cstring>
 #include <memory>
+#include <utility>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
@@ -24,27 +26,71 @@
 #include "kudu/cfile/bloomfile.h"
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/cfile/cfile_writer.h"
+#include "kudu/common/encoded_key.h"
+#include "kudu/common/key_util.h"
+#include "kudu/common/scan_deadline.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/column_materialization_context.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/gutil/bind.h"
 #include "kudu/gutil/dynamic_annotations.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/cfile_set.h"
+#include "kudu/util/countdown_latch.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/threadpool.h"
 
 DEFINE_bool(consult_bloom_filters, true, "Whether to consult bloom filters on row presence checks");
 TAG_FLAG(consult_bloom_filters, hidden);
 
+DEFINE_bool(cfile_set_parallel_column_prepare, false,
+            "Whether to issue the data block reads for all projected columns "
+            "of a batch concurrently on the shared cfile I/O pool, rather "
+            "than preparing each column lazily when it is first materialized. "
+            "This can substantially reduce the latency of cold scans over "
+            "wide projections, at the cost of reading columns which "
+            "predicate evaluation might otherwise skip entirely.");
+TAG_FLAG(cfile_set_parallel_column_prepare, advanced);
+TAG_FLAG(cfile_set_parallel_column_prepare, runtime);
+
+DEFINE_bool(cfile_set_inlist_skip_scan, true,
+            "Whether to convert an IN-list predicate on the first primary "
+            "key column into a skip scan, using the key index to seek to "
+            "the range of rows matching each value in turn rather than "
+            "scanning every row between the smallest and largest value.");
+TAG_FLAG(cfile_set_inlist_skip_scan, advanced);
+TAG_FLAG(cfile_set_inlist_skip_scan, runtime);
+
+DEFINE_bool(cfile_set_index_only_key_scan, true,
+            "Whether a scan whose projection contains only primary key "
+            "columns should be served from the rowset's composite key "
+            "index cfile, decoding the key columns from the stored "
+            "compound keys rather than reading each key column's own "
+            "cfile. Only applies to tablets with composite primary keys.");
+TAG_FLAG(cfile_set_index_only_key_scan, advanced);
+TAG_FLAG(cfile_set_index_only_key_scan, runtime);
+
+DEFINE_bool(cfile_set_value_stats_pruning, true,
+            "Whether to skip scanning a rowset entirely when a column "
+            "predicate excludes the column's whole stored value range, "
+            "based on the per-file min/max statistics in the column cfile "
+            "footers. Only applies to columns with no delta mutations.");
+TAG_FLAG(cfile_set_value_stats_pruning, advanced);
+TAG_FLAG(cfile_set_value_stats_pruning, runtime);
+
 namespace kudu {
 namespace tablet {
 
+using cfile::CFileWriter;
 using cfile::ReaderOptions;
 using cfile::DefaultColumnValueIterator;
 using fs::ReadableBlock;
 using std::shared_ptr;
+using std::string;
 using strings::Substitute;
 
 ////////////////////////////////////////////////////////////
@@ -240,6 +286,46 @@ Status CFileSet::FindRow(const RowSetKeyProbe &probe, rowid_t *idx,
   return Status::OK();
 }
 
+Status CFileSet::EstimateRowCountInRange(const EncodedKey* start_key,
+                                         const EncodedKey* stop_key,
+                                         rowid_t* count) const {
+  rowid_t total;
+  RETURN_NOT_OK(CountRows(&total));
+
+  rowid_t start_ord = 0;
+  if (start_key != nullptr) {
+    CFileIterator* key_iter = nullptr;
+    RETURN_NOT_OK(NewKeyIterator(&key_iter));
+    gscoped_ptr<CFileIterator> key_iter_scoped(key_iter); // free on return
+    bool exact;
+    Status s = key_iter->SeekAtOrAfter(*start_key, &exact);
+    if (s.IsNotFound()) {
+      // The entire rowset sorts before the start of the range.
+      *count = 0;
+      return Status::OK();
+    }
+    RETURN_NOT_OK(s);
+    start_ord = key_iter->GetCurrentOrdinal();
+  }
+
+  rowid_t end_ord = total;
+  if (stop_key != nullptr) {
+    CFileIterator* key_iter = nullptr;
+    RETURN_NOT_OK(NewKeyIterator(&key_iter));
+    gscoped_ptr<CFileIterator> key_iter_scoped(key_iter); // free on return
+    bool exact;
+    Status s = key_iter->SeekAtOrAfter(*stop_key, &exact);
+    if (!s.IsNotFound()) {
+      // NotFound means every row sorts before the (exclusive) stop key.
+      RETURN_NOT_OK(s);
+      end_ord = key_iter->GetCurrentOrdinal();
+    }
+  }
+
+  *count = end_ord > start_ord ? end_ord - start_ord : 0;
+  return Status::OK();
+}
+
 Status CFileSet::CheckRowPresent(const RowSetKeyProbe &probe, bool *present,
                                  rowid_t *rowid, ProbeStats* stats) const {
 
@@ -259,6 +345,110 @@ Status CFileSet::NewKeyIterator(CFileIterator **key_iter) const {
   return key_index_reader()->NewIterator(key_iter, CFileReader::CACHE_BLOCK);
 }
 
+////////////////////////////////////////////////////////////
+// KeyIndexColumnIterator
+////////////////////////////////////////////////////////////
+
+namespace {
+
+// A column iterator which serves a primary key column from the rowset's
+// ad-hoc key index cfile rather than from the column's own cfile. The index
+// stores every encoded compound key, so a projection which touches only key
+// columns (e.g. an existence check or a key-enumeration scan) can be
+// satisfied without reading any of the per-column cfiles.
+class KeyIndexColumnIterator : public ColumnIterator {
+ public:
+  KeyIndexColumnIterator(gscoped_ptr<CFileIterator> key_iter,
+                         const Schema& tablet_schema,
+                         size_t key_col_idx)
+      : key_iter_(std::move(key_iter)),
+        key_schema_(tablet_schema.CreateKeyProjection()),
+        key_col_idx_(key_col_idx),
+        arena_(1024, 256 * 1024) {
+    DCHECK_LT(key_col_idx_, key_schema_.num_key_columns());
+  }
+
+  Status SeekToOrdinal(rowid_t ord_idx) OVERRIDE {
+    if (!key_iter_->seeked() || key_iter_->GetCurrentOrdinal() > ord_idx) {
+      RETURN_NOT_OK(key_iter_->SeekToFirst());
+    }
+    // The index cfile is value-indexed and has no positional index, so skip
+    // forward batch by batch until we reach the target ordinal. No key data
+    // is decoded while skipping.
+    while (key_iter_->GetCurrentOrdinal() < ord_idx) {
+      size_t n = ord_idx - key_iter_->GetCurrentOrdinal();
+      RETURN_NOT_OK(key_iter_->PrepareBatch(&n));
+      if (PREDICT_FALSE(n == 0)) {
+        return Status::NotFound("trying to seek past highest ordinal in file");
+      }
+      RETURN_NOT_OK(key_iter_->FinishBatch());
+    }
+    return Status::OK();
+  }
+
+  bool seeked() const OVERRIDE { return key_iter_->seeked(); }
+
+  rowid_t GetCurrentOrdinal() const OVERRIDE {
+    return key_iter_->GetCurrentOrdinal();
+  }
+
+  Status PrepareBatch(size_t* n) OVERRIDE {
+    return key_iter_->PrepareBatch(n);
+  }
+
+  Status Scan(ColumnMaterializationContext* ctx) OVERRIDE;
+
+  Status FinishBatch() OVERRIDE { return key_iter_->FinishBatch(); }
+
+  const IteratorStats& io_statistics() const OVERRIDE {
+    return key_iter_->io_statistics();
+  }
+
+ private:
+  gscoped_ptr<CFileIterator> key_iter_;
+  const Schema key_schema_;
+  const size_t key_col_idx_;
+
+  // Scratch space for the encoded keys and their decoded cells. Reset on
+  // each Scan() call.
+  Arena arena_;
+};
+
+Status KeyIndexColumnIterator::Scan(ColumnMaterializationContext* ctx) {
+  ctx->SetDecoderEvalNotSupported();
+  ColumnBlock* dst = ctx->block();
+  size_t n = dst->nrows();
+  arena_.Reset();
+
+  // Fetch the raw encoded keys for the batch into scratch space.
+  vector<Slice> encoded_keys(n);
+  ColumnBlock scratch(GetTypeInfo(BINARY), nullptr, encoded_keys.data(), n, &arena_);
+  SelectionVector scratch_sel(n);
+  scratch_sel.SetAllTrue();
+  ColumnMaterializationContext scratch_ctx(0, nullptr, &scratch, &scratch_sel);
+  RETURN_NOT_OK(key_iter_->Scan(&scratch_ctx));
+
+  // Decode each compound key and copy out the cell for our column.
+  const TypeInfo* type_info = key_schema_.column(key_col_idx_).type_info();
+  for (size_t i = 0; i < n; i++) {
+    gscoped_ptr<EncodedKey> key;
+    RETURN_NOT_OK(EncodedKey::DecodeEncodedString(
+        key_schema_, &arena_, encoded_keys[i], &key));
+    const void* src = key->raw_keys()[key_col_idx_];
+    uint8_t* out = dst->mutable_cell_ptr(i);
+    if (type_info->physical_type() == BINARY) {
+      // Relocate the indirect data into the destination block's arena.
+      CHECK(dst->arena()->RelocateSlice(*reinterpret_cast<const Slice*>(src),
+                                        reinterpret_cast<Slice*>(out)));
+    } else {
+      memcpy(out, src, type_info->size());
+    }
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+
 ////////////////////////////////////////////////////////////
 // Iterator
 ////////////////////////////////////////////////////////////
@@ -277,11 +467,43 @@ Status CFileSet::Iterator::CreateColumnIterators(const ScanSpec* spec) {
     cache_blocks = CFileReader::DONT_CACHE_BLOCK;
   }
 
+  // If the projection touches only primary key columns and the rowset has a
+  // composite key index, serve every projected column from the key index
+  // cfile instead of from the per-column cfiles: existence checks and
+  // key-enumeration scans then read only the (much smaller) index file.
+  const Schema& tablet_schema = base_data_->tablet_schema();
+  bool use_key_index = FLAGS_cfile_set_index_only_key_scan &&
+                       base_data_->ad_hoc_idx_reader_ != nullptr &&
+                       projection_->num_columns() > 0;
+  if (use_key_index) {
+    for (int proj_col_idx = 0;
+         proj_col_idx < projection_->num_columns();
+         proj_col_idx++) {
+      int tablet_col_idx = tablet_schema.find_column_by_id(
+          projection_->column_id(proj_col_idx));
+      if (tablet_col_idx == Schema::kColumnNotFound ||
+          !tablet_schema.is_key_column(tablet_col_idx)) {
+        use_key_index = false;
+        break;
+      }
+    }
+  }
+
   for (int proj_col_idx = 0;
        proj_col_idx < projection_->num_columns();
        proj_col_idx++) {
     ColumnId col_id = projection_->column_id(proj_col_idx);
 
+    if (use_key_index) {
+      size_t key_col_idx = tablet_schema.find_column_by_id(col_id);
+      CFileIterator* key_iter;
+      RETURN_NOT_OK_PREPEND(base_data_->NewKeyIterator(&key_iter),
+                            "could not create iterator for key index");
+      ret_iters.push_back(new KeyIndexColumnIterator(
+          gscoped_ptr<CFileIterator>(key_iter), tablet_schema, key_col_idx));
+      continue;
+    }
+
     if (!base_data_->has_data_for_column_id(col_id)) {
       // If we have no data for a column, most likely it was added via an ALTER
       // operation after this CFileSet was flushed. In that case, we're guaranteed
@@ -321,6 +543,14 @@ Status CFileSet::Iterator::Init(ScanSpec *spec) {
   // ordinal range.
   RETURN_NOT_OK(PushdownRangeScanPredicate(spec));
 
+  // If there is an IN-list predicate on the first key column, convert it
+  // into a set of ordinal ranges to hop between.
+  RETURN_NOT_OK(PushdownSkipScanPredicate(spec));
+
+  // If a column predicate excludes the entire stored value range of a
+  // delta-free column, skip the rowset entirely.
+  RETURN_NOT_OK(PruneByValueStats(spec));
+
   initted_ = true;
 
   // Don't actually seek -- we'll seek when we first actually read the
@@ -390,6 +620,174 @@ Status CFileSet::Iterator::PushdownRangeScanPredicate(ScanSpec *spec) {
   return Status::OK();
 }
 
+Status CFileSet::Iterator::PushdownSkipScanPredicate(ScanSpec *spec) {
+  if (!FLAGS_cfile_set_inlist_skip_scan || spec == nullptr) {
+    return Status::OK();
+  }
+  if (lower_bound_idx_ >= upper_bound_idx_) {
+    // The range predicate pushdown already eliminated all rows.
+    return Status::OK();
+  }
+
+  // Skip scanning applies when there is an IN-list predicate on the first
+  // column of the primary key: the key index orders rows by the full encoded
+  // key, so the rows matching each IN-list value form a contiguous range
+  // which can be located with two index seeks.
+  const Schema& tablet_schema = base_data_->tablet_schema();
+  const ColumnSchema& prefix_col = tablet_schema.column(0);
+  const ColumnPredicate* pred = FindOrNull(spec->predicates(), prefix_col.name());
+  if (pred == nullptr || pred->predicate_type() != PredicateType::InList) {
+    return Status::OK();
+  }
+
+  // Note: the predicate is deliberately left in the scan spec. The ranges
+  // computed below may be conservative (e.g. a value's range extends to the
+  // iterator's upper bound if the value cannot be incremented), so the
+  // surviving rows must still be evaluated against the predicate.
+  Arena arena(1024, 32 * 1024);
+  EncodedKeyBuilder key_builder(&tablet_schema);
+  vector<std::pair<rowid_t, rowid_t>> ranges;
+  for (const void* value : pred->raw_values()) {
+    // The IN-list values are sorted, so the ranges are found in ascending
+    // ordinal order.
+    //
+    // Seek to the first row whose key is prefixed by 'value'.
+    key_builder.Reset();
+    key_builder.AddColumnKey(value);
+    gscoped_ptr<EncodedKey> start_key(key_builder.BuildEncodedKey());
+    bool exact;
+    Status s = key_iter_->SeekAtOrAfter(*start_key, &exact);
+    if (s.IsNotFound()) {
+      // This value (and, as the values are sorted, every subsequent one)
+      // lies beyond the end of the file.
+      break;
+    }
+    RETURN_NOT_OK(s);
+    rowid_t start = std::max<rowid_t>(key_iter_->GetCurrentOrdinal(),
+                                      lower_bound_idx_);
+
+    // The range ends at the first row whose key prefix is greater than
+    // 'value'. If the value cannot be incremented it is the greatest value
+    // of its type, and the range extends to the iterator's upper bound.
+    rowid_t end = upper_bound_idx_;
+    uint8_t scratch[kLargestTypeSize];
+    memcpy(scratch, value, prefix_col.type_info()->size());
+    if (key_util::IncrementCell(prefix_col, scratch, &arena)) {
+      key_builder.Reset();
+      key_builder.AddColumnKey(scratch);
+      gscoped_ptr<EncodedKey> end_key(key_builder.BuildEncodedKey());
+      s = key_iter_->SeekAtOrAfter(*end_key, &exact);
+      if (!s.IsNotFound()) {
+        RETURN_NOT_OK(s);
+        end = std::min<rowid_t>(key_iter_->GetCurrentOrdinal(),
+                                upper_bound_idx_);
+      }
+    }
+
+    if (start >= end) {
+      // No rows match this value.
+      continue;
+    }
+    if (!ranges.empty() && start <= ranges.back().second) {
+      ranges.back().second = std::max(ranges.back().second, end);
+    } else {
+      ranges.emplace_back(start, end);
+    }
+  }
+
+  if (ranges.empty()) {
+    // None of the values matched any rows.
+    lower_bound_idx_ = upper_bound_idx_;
+    return Status::OK();
+  }
+
+  lower_bound_idx_ = ranges.front().first;
+  upper_bound_idx_ = ranges.back().second;
+  VLOG(1) << "Pushed IN-list predicate on " << prefix_col.name()
+          << " as a skip scan over " << ranges.size() << " ordinal ranges";
+  skip_scan_ranges_ = std::move(ranges);
+  cur_range_idx_ = 0;
+  return Status::OK();
+}
+
+Status CFileSet::Iterator::PruneByValueStats(const ScanSpec* spec) {
+  if (!FLAGS_cfile_set_value_stats_pruning ||
+      !cols_with_deltas_known_ ||
+      spec == nullptr ||
+      lower_bound_idx_ >= upper_bound_idx_) {
+    return Status::OK();
+  }
+
+  const Schema& tablet_schema = base_data_->tablet_schema();
+  for (const auto& entry : spec->predicates()) {
+    const ColumnPredicate& pred = entry.second;
+    if (pred.predicate_type() != PredicateType::Range &&
+        pred.predicate_type() != PredicateType::Equality) {
+      continue;
+    }
+    int col_idx = tablet_schema.find_column(entry.first);
+    if (col_idx == Schema::kColumnNotFound) {
+      continue;
+    }
+    ColumnId col_id = tablet_schema.column_id(col_idx);
+    if (ContainsKey(cols_with_deltas_, col_id)) {
+      // A delta could change this column's values, so the base data
+      // statistics don't bound the values a scan might see.
+      continue;
+    }
+    const shared_ptr<CFileReader>* reader =
+        FindOrNull(base_data_->readers_by_col_id_, col_id);
+    if (reader == nullptr) {
+      continue;
+    }
+    RETURN_NOT_OK((*reader)->Init());
+    string min_val, max_val;
+    if (!(*reader)->GetMetadataEntry(CFileWriter::kMinValueMetaEntryName, &min_val) ||
+        !(*reader)->GetMetadataEntry(CFileWriter::kMaxValueMetaEntryName, &max_val)) {
+      // The file predates value statistics (or contains only nulls, which
+      // no Range or Equality predicate matches anyway when rows do have
+      // non-null values; without stats we simply can't tell).
+      continue;
+    }
+
+    // Reconstruct comparable cells from the stored statistics.
+    const TypeInfo* type_info = tablet_schema.column(col_idx).type_info();
+    Slice min_slice(min_val);
+    Slice max_slice(max_val);
+    const void* min_cell;
+    const void* max_cell;
+    if (type_info->physical_type() == BINARY) {
+      min_cell = &min_slice;
+      max_cell = &max_slice;
+    } else {
+      if (min_val.size() != type_info->size() || max_val.size() != type_info->size()) {
+        continue;
+      }
+      min_cell = min_val.data();
+      max_cell = max_val.data();
+    }
+
+    bool excluded;
+    if (pred.predicate_type() == PredicateType::Equality) {
+      excluded = type_info->Compare(pred.raw_lower(), min_cell) < 0 ||
+                 type_info->Compare(pred.raw_lower(), max_cell) > 0;
+    } else {
+      // Range predicates have an inclusive lower bound and an exclusive
+      // upper bound; either may be absent.
+      excluded =
+          (pred.raw_upper() != nullptr && type_info->Compare(pred.raw_upper(), min_cell) <= 0) ||
+          (pred.raw_lower() != nullptr && type_info->Compare(pred.raw_lower(), max_cell) > 0);
+    }
+    if (excluded) {
+      VLOG(1) << "Pruned rowset via value statistics on column " << entry.first
+              << ": no stored value can satisfy " << pred.ToString();
+      lower_bound_idx_ = upper_bound_idx_;
+      return Status::OK();
+    }
+  }
+  return Status::OK();
+}
+
 void CFileSet::Iterator::Unprepare() {
   prepared_count_ = 0;
   cols_prepared_.assign(col_iters_.size(), false);
@@ -398,24 +796,44 @@ void CFileSet::Iterator::Unprepare() {
 Status CFileSet::Iterator::PrepareBatch(size_t *n) {
   DCHECK_EQ(prepared_count_, 0) << "Already prepared";
 
+  // Preparing a batch seeks every projected column iterator; this is also
+  // the per-rowset boundary at which an expired scan can abort before
+  // issuing any further I/O.
+  RETURN_NOT_OK(ScopedScanDeadline::Check());
+
   size_t remaining = upper_bound_idx_ - cur_idx_;
+  if (!skip_scan_ranges_.empty()) {
+    // Clamp the batch to the current skip scan range; FinishBatch() hops
+    // to the next range once this one is exhausted.
+    remaining = skip_scan_ranges_[cur_range_idx_].second - cur_idx_;
+  }
   if (*n > remaining) {
     *n = remaining;
   }
 
   prepared_count_ = *n;
 
+  if (PREDICT_FALSE(FLAGS_cfile_set_parallel_column_prepare) &&
+      prepared_count_ > 0 && col_iters_.size() > 1) {
+    return PrepareAllColumnsParallel();
+  }
+
   // Lazily prepare the first column when it is materialized.
   return Status::OK();
 }
 
-Status CFileSet::Iterator::PrepareColumn(ColumnMaterializationContext *ctx) {
-  if (cols_prepared_[ctx->col_idx()]) {
+Status CFileSet::Iterator::PrepareColumn(size_t col_idx) {
+  if (cols_prepared_[col_idx]) {
     // Already prepared in this batch.
     return Status::OK();
   }
+  RETURN_NOT_OK(DoPrepareColumn(col_idx));
+  cols_prepared_[col_idx] = true;
+  return Status::OK();
+}
 
-  ColumnIterator* col_iter = col_iters_[ctx->col_idx()];
+Status CFileSet::Iterator::DoPrepareColumn(size_t col_idx) {
+  ColumnIterator* col_iter = col_iters_[col_idx];
   size_t n = prepared_count_;
 
   if (!col_iter->seeked() || col_iter->GetCurrentOrdinal() != cur_idx_) {
@@ -429,23 +847,60 @@ Status CFileSet::Iterator::PrepareColumn(ColumnMaterializationContext *ctx) {
 
   Status s = col_iter->PrepareBatch(&n);
   if (!s.ok()) {
-    LOG(WARNING) << "Unable to prepare column " << ctx->col_idx() << ": " << s.ToString();
+    LOG(WARNING) << "Unable to prepare column " << col_idx << ": " << s.ToString();
     return s;
   }
 
   if (n != prepared_count_) {
     return Status::Corruption(
             StringPrintf("Column %zd (%s) didn't yield enough rows at offset %zd: expected "
-                                 "%zd but only got %zd", ctx->col_idx(),
-                         projection_->column(ctx->col_idx()).ToString().c_str(),
+                                 "%zd but only got %zd", col_idx,
+                         projection_->column(col_idx).ToString().c_str(),
                          cur_idx_, prepared_count_, n));
   }
 
-  cols_prepared_[ctx->col_idx()] = true;
-
   return Status::OK();
 }
 
+Status CFileSet::Iterator::PrepareAllColumnsParallel() {
+  ThreadPool* pool = cfile::CFileIOPool();
+  vector<Status> statuses(col_iters_.size());
+  CountDownLatch latch(col_iters_.size());
+  for (size_t i = 0; i < col_iters_.size(); i++) {
+    if (cols_prepared_[i]) {
+      latch.CountDown();
+      continue;
+    }
+    Status submitted = pool->SubmitClosure(
+        Bind(&CFileSet::Iterator::PrepareColumnTask,
+             Unretained(this), i, &statuses[i], &latch));
+    if (PREDICT_FALSE(!submitted.ok())) {
+      // Fall back to preparing the column on this thread.
+      PrepareColumnTask(i, &statuses[i], &latch);
+    }
+  }
+  latch.Wait();
+
+  // Mark the successfully prepared columns even if another column failed,
+  // so that FinishBatch() can close out their batches.
+  Status ret;
+  for (size_t i = 0; i < col_iters_.size(); i++) {
+    if (cols_prepared_[i]) continue;
+    if (statuses[i].ok()) {
+      cols_prepared_[i] = true;
+    } else if (ret.ok()) {
+      ret = statuses[i];
+    }
+  }
+  return ret;
+}
+
+void CFileSet::Iterator::PrepareColumnTask(size_t col_idx, Status* status,
+                                           CountDownLatch* latch) {
+  *status = DoPrepareColumn(col_idx);
+  latch->CountDown();
+}
+
 Status CFileSet::Iterator::InitializeSelectionVector(SelectionVector *sel_vec) {
   sel_vec->SetAllTrue();
   return Status::OK();
@@ -455,7 +910,7 @@ Status CFileSet::Iterator::MaterializeColumn(ColumnMaterializationContext *ctx)
   CHECK_EQ(prepared_count_, ctx->block()->nrows());
   DCHECK_LT(ctx->col_idx(), col_iters_.size());
 
-  RETURN_NOT_OK(PrepareColumn(ctx));
+  RETURN_NOT_OK(PrepareColumn(ctx->col_idx()));
   ColumnIterator* iter = col_iters_[ctx->col_idx()];
 
   RETURN_NOT_OK(iter->Scan(ctx));
@@ -477,6 +932,15 @@ Status CFileSet::Iterator::FinishBatch() {
   }
 
   cur_idx_ += prepared_count_;
+
+  // If this batch exhausted the current skip scan range, hop over the
+  // non-matching rows to the start of the next range.
+  if (!skip_scan_ranges_.empty() &&
+      cur_idx_ >= skip_scan_ranges_[cur_range_idx_].second &&
+      cur_range_idx_ + 1 < skip_scan_ranges_.size()) {
+    cur_range_idx_++;
+    cur_idx_ = skip_scan_ranges_[cur_range_idx_].first;
+  }
   Unprepare();
 
   return Status::OK();
@@ -21,6 +21,8 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "kudu/cfile/bloomfile.h"
@@ -38,6 +40,8 @@
 
 namespace kudu {
 
+class CountDownLatch;
+
 namespace tablet {
 
 using kudu::cfile::BloomFileReader;
@@ -72,6 +76,14 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
   // Determine the index of the given row key.
   Status FindRow(const RowSetKeyProbe &probe, rowid_t *idx, ProbeStats* stats) const;
 
+  // Estimate the number of rows whose keys fall within the given encoded key
+  // range by seeking the key index to the ordinals of the two bounds. A null
+  // bound leaves that side of the range unbounded. Only the key index is
+  // consulted, so the estimate does not account for deleted rows.
+  Status EstimateRowCountInRange(const EncodedKey* start_key,
+                                 const EncodedKey* stop_key,
+                                 rowid_t* count) const;
+
   string ToString() const {
     return string("CFile base data in ") + rowset_metadata_->ToString();
   }
@@ -141,6 +153,23 @@ class CFileSet::Iterator : public ColumnwiseIterator {
 
   virtual Status Init(ScanSpec *spec) OVERRIDE;
 
+  // Inform the iterator which columns might be affected by delta mutations
+  // (updates in any delta store, reinserted rows, or entries in the delta
+  // memstore). Enables value-statistic pruning in Init(): a predicate on a
+  // column NOT in 'col_ids' whose range excludes the column's entire stored
+  // min/max range proves that no row in the rowset can match.
+  //
+  // If this is never called, value-statistic pruning is disabled, since a
+  // delta could move a row's value into the predicate's range after the
+  // base data was written.
+  //
+  // Must be called before Init().
+  void SetColumnsWithDeltas(std::unordered_set<int> col_ids) {
+    DCHECK(!initted_);
+    cols_with_deltas_ = std::move(col_ids);
+    cols_with_deltas_known_ = true;
+  }
+
   virtual Status PrepareBatch(size_t *nrows) OVERRIDE;
 
   virtual Status InitializeSelectionVector(SelectionVector *sel_vec) OVERRIDE;
@@ -175,6 +204,8 @@ class CFileSet::Iterator : public ColumnwiseIterator {
  private:
   DISALLOW_COPY_AND_ASSIGN(Iterator);
   FRIEND_TEST(TestCFileSet, TestRangeScan);
+  FRIEND_TEST(TestCFileSet, TestInListSkipScan);
+  FRIEND_TEST(TestCFileSet, TestValueStatsPruning);
   friend class CFileSet;
 
   // 'projection' must remain valid for the lifetime of this object.
@@ -183,7 +214,9 @@ class CFileSet::Iterator : public ColumnwiseIterator {
         projection_(projection),
         initted_(false),
         cur_idx_(0),
-        prepared_count_(0) {
+        prepared_count_(0),
+        cur_range_idx_(0),
+        cols_with_deltas_known_(false) {
     CHECK_OK(base_data_->CountRows(&row_count_));
   }
 
@@ -195,10 +228,38 @@ class CFileSet::Iterator : public ColumnwiseIterator {
   // store it in member fields.
   Status PushdownRangeScanPredicate(ScanSpec *spec);
 
+  // Look for an IN-list predicate on the first column of the primary key. If
+  // one exists, use the key index to convert it into a list of disjoint
+  // ordinal ranges (one per matching value), stored in 'skip_scan_ranges_'.
+  // Iteration then hops from range to range instead of scanning every row
+  // between the smallest and largest value.
+  //
+  // The predicate is left in the scan spec; the computed ranges are
+  // conservative and the remaining rows must still be evaluated against it.
+  Status PushdownSkipScanPredicate(ScanSpec *spec);
+
+  // If any column predicate excludes the entire stored min/max value range
+  // of a delta-free column (see SetColumnsWithDeltas()), collapse the
+  // iterator's bounds to an empty range. The statistics are stored in the
+  // column cfiles' footer metadata by CFileWriter when
+  // WriterOptions::write_value_stats is enabled.
+  Status PruneByValueStats(const ScanSpec* spec);
+
   void Unprepare();
 
   // Prepare the given column if not already prepared.
-  Status PrepareColumn(ColumnMaterializationContext *ctx);
+  Status PrepareColumn(size_t col_idx);
+
+  // Seek the given column to the current batch offset and prepare it.
+  // Does not consult or update cols_prepared_.
+  Status DoPrepareColumn(size_t col_idx);
+
+  // Eagerly prepare all projected columns for the current batch, issuing
+  // the underlying block reads concurrently on the shared cfile I/O pool.
+  Status PrepareAllColumnsParallel();
+
+  // Runs on the I/O pool: prepares one column and counts down 'latch'.
+  void PrepareColumnTask(size_t col_idx, Status* status, CountDownLatch* latch);
 
   const std::shared_ptr<CFileSet const> base_data_;
   const Schema* projection_;
@@ -222,6 +283,24 @@ class CFileSet::Iterator : public ColumnwiseIterator {
   rowid_t lower_bound_idx_;
   rowid_t upper_bound_idx_;
 
+  // When an IN-list predicate on the first key column has been converted
+  // into a skip scan, the disjoint ordinal ranges to visit, in ascending
+  // order. Empty if skip scanning is not in use. Each range is a
+  // [start, end) pair of ordinal indexes, and all ranges fall within
+  // [lower_bound_idx_, upper_bound_idx_).
+  std::vector<std::pair<rowid_t, rowid_t>> skip_scan_ranges_;
+
+  // The index of the range in 'skip_scan_ranges_' which contains 'cur_idx_'.
+  size_t cur_range_idx_;
+
+  // Whether SetColumnsWithDeltas() has been called. When false, value-statistic
+  // pruning is disabled.
+  bool cols_with_deltas_known_;
+
+  // IDs of the columns which might be affected by delta mutations. Only
+  // meaningful when 'cols_with_deltas_known_' is true.
+  std::unordered_set<int> cols_with_deltas_;
+
 
   // The underlying columns are prepared lazily, so that if a column is never
   // materialized, it doesn't need to be read off disk.
@@ -49,6 +49,7 @@ DEFINE_int32(merge_benchmark_num_rows_per_rowset, 500000,
              "Number of rowsets as input to the merge");
 
 DECLARE_string(block_manager);
+DECLARE_bool(compaction_pipelined_flush);
 
 using std::shared_ptr;
 
@@ -497,6 +498,35 @@ TEST_F(TestCompaction, TestFlushMRSWithRolling) {
             rows[1]);
 }
 
+// Flushing with the write stage on a separate thread must produce output
+// identical to the single-threaded path, including where the output rolls
+// over to new rowsets.
+TEST_F(TestCompaction, TestPipelinedFlushMatchesSingleThreaded) {
+  shared_ptr<MemRowSet> mrs;
+  ASSERT_OK(MemRowSet::Create(0, schema_, log_anchor_registry_.get(),
+                              mem_trackers_.tablet_tracker, &mrs));
+  InsertRows(mrs.get(), 30000, 0);
+  UpdateRows(mrs.get(), 30000, 0, 1);
+
+  vector<shared_ptr<DiskRowSet> > single_threaded_rowsets;
+  FlushMRSAndReopen(*mrs, schema_, kSmallRollThreshold, &single_threaded_rowsets);
+  ASSERT_GT(single_threaded_rowsets.size(), 1);
+
+  google::FlagSaver saver;
+  FLAGS_compaction_pipelined_flush = true;
+  vector<shared_ptr<DiskRowSet> > pipelined_rowsets;
+  FlushMRSAndReopen(*mrs, schema_, kSmallRollThreshold, &pipelined_rowsets);
+  ASSERT_EQ(single_threaded_rowsets.size(), pipelined_rowsets.size());
+
+  for (int i = 0; i < single_threaded_rowsets.size(); i++) {
+    vector<string> expected_rows;
+    vector<string> actual_rows;
+    single_threaded_rowsets[i]->DebugDump(&expected_rows);
+    pipelined_rowsets[i]->DebugDump(&actual_rows);
+    ASSERT_EQ(expected_rows, actual_rows);
+  }
+}
+
 TEST_F(TestCompaction, TestRowSetInput) {
   // Create a memrowset with a bunch of rows, flush and reopen.
   shared_ptr<DiskRowSet> rs;
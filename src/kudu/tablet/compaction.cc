@@ -37,7 +37,16 @@
 #include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/tablet/transactions/write_transaction.h"
+#include "kudu/util/blocking_queue.h"
 #include "kudu/util/debug/trace_event.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/thread.h"
+
+DEFINE_bool(compaction_pipelined_flush, false,
+            "Whether to run the write stage of flushes and compactions on a "
+            "separate thread from the read/merge stage, so that merging the "
+            "inputs and encoding/writing the output proceed in parallel.");
+TAG_FLAG(compaction_pipelined_flush, experimental);
 
 using kudu::server::HybridClock;
 using std::shared_ptr;
@@ -483,8 +492,16 @@ class MergeCompactionInput : public CompactionInput {
       }
       DCHECK_GE(smallest_idx, 0);
 
-      states_[smallest_idx]->pop_front();
+      MergeState* smallest_state = states_[smallest_idx];
+      smallest_state->pop_front();
       block->push_back(*smallest);
+
+      // Rows within each input's block are sorted, so any further rows of
+      // this input which sort strictly before every other input's next row
+      // form a run that can be appended without per-row comparisons. This
+      // makes merging non-overlapping or barely-overlapping key ranges (the
+      // common case after time-ordered ingest) nearly a concatenation.
+      AppendRunFromSmallest(smallest_state, block);
     }
 
     return Status::OK();
@@ -586,6 +603,56 @@ class MergeCompactionInput : public CompactionInput {
     }
   }
 
+  // Append to 'block' the longest prefix of 'state's pending rows which sort
+  // strictly before the next row of every other input, and advance 'state'
+  // past it. Since rows within a block are sorted, the end of the run is
+  // found with a binary search against the smallest next row among the other
+  // inputs rather than a comparison per row. Rows equal to that bound are
+  // left for the regular merge path so that duplicated keys are still
+  // linked up correctly.
+  void AppendRunFromSmallest(MergeState* state, vector<CompactionInputRow>* block) {
+    if (state->empty()) return;
+
+    // Find the tightest bound among the other inputs.
+    const CompactionInputRow* bound = nullptr;
+    for (MergeState* other : states_) {
+      if (other == state) continue;
+      if (other->empty()) {
+        // This input's next block may contain rows that belong inside the
+        // run, so don't extend past the row already taken.
+        return;
+      }
+      if (bound == nullptr ||
+          schema_->Compare(other->next()->row, bound->row) < 0) {
+        bound = other->next();
+      }
+    }
+
+    int run_end;
+    if (bound == nullptr) {
+      // This is the only input left: the rest of the block is a run.
+      run_end = state->pending.size();
+    } else {
+      // Binary search for the first pending row >= the bound.
+      int lo = state->pending_idx;
+      int hi = state->pending.size();
+      while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (schema_->Compare(state->pending[mid].row, bound->row) < 0) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      run_end = lo;
+    }
+
+    for (int i = state->pending_idx; i < run_end; i++) {
+      block->push_back(state->pending[i]);
+    }
+    state->pending_idx = run_end;
+  }
+
   // (Deep) clones a compaction input row, copying both the row data, all undo/redo mutations and
   // all previous ghosts to 'arena'.
   Status CloneCompactionInputRow(const CompactionInputRow* src,
@@ -1049,16 +1116,241 @@ Status ApplyMutationsAndGenerateUndos(const MvccSnapshot& snap,
   #undef ERROR_LOG_CONTEXT
 }
 
+namespace {
+
+// Number of rows in each RowBlock appended to the output of a flush or
+// compaction, and in each batch handed to the writer thread in pipelined
+// mode.
+const int kFlushBlockNRows = 100;
+
+// Maximum number of batches queued between the read/merge stage and the
+// write stage of a pipelined flush. This bounds the memory consumed by the
+// pipeline and applies back-pressure to the merge when the writer falls
+// behind.
+const int kFlushPipelineQueueDepth = 4;
+
+// Transform a single input row into the form in which it will be flushed:
+// apply its mutation history to produce the latest version of the row in
+// '*dst_row', generate the corresponding UNDO/REDO mutations, merge in the
+// histories of any previous ghosts of the row, and garbage-collect ancient
+// history.
+//
+// The returned mutation heads (and any indirect data referenced by
+// '*dst_row') are allocated from the input's prepared block arena and are
+// only valid until the current input block is finished.
+Status TransformFlushedRow(CompactionInput* input,
+                           const MvccSnapshot& snap,
+                           const HistoryGcOpts& history_gc_opts,
+                           CompactionInputRow* input_row,
+                           RowBlockRow* dst_row,
+                           Mutation** new_undos_head,
+                           Mutation** new_redos_head,
+                           bool* is_garbage_collected) {
+  RETURN_NOT_OK(CopyRow(input_row->row, dst_row, static_cast<Arena*>(nullptr)));
+
+  DVLOG(4) << "Input Row: " << CompactionInputRowToString(*input_row);
+
+  // Collect the new UNDO/REDO mutations.
+  RETURN_NOT_OK(ApplyMutationsAndGenerateUndos(snap,
+                                               *input_row,
+                                               new_undos_head,
+                                               new_redos_head,
+                                               input->PreparedBlockArena(),
+                                               dst_row));
+
+  // Merge the histories of 'input_row' with previous ghosts, if there are any.
+  RETURN_NOT_OK(MergeDuplicatedRowHistory(input_row,
+                                          new_undos_head,
+                                          input->PreparedBlockArena()));
+
+  // Remove ancient UNDOS and check whether the row should be garbage collected.
+  RemoveAncientUndos(history_gc_opts,
+                     new_undos_head,
+                     new_redos_head,
+                     is_garbage_collected);
+
+  DVLOG(4) << "Output Row: " << RowToString(*dst_row, *new_redos_head, *new_undos_head) <<
+      "; Was garbage collected? " << *is_garbage_collected;
+
+  return Status::OK();
+}
+
+// A batch of output-ready rows produced by the read/merge stage of a
+// pipelined flush. The row data and mutation lists are deep-copied into
+// 'arena' so that the batch is self-contained and remains valid after the
+// input block which produced it has been finished.
+struct PreparedFlushBatch {
+  explicit PreparedFlushBatch(const Schema& schema)
+      : arena(32 * 1024, 1024 * 1024),
+        block(schema, kFlushBlockNRows, &arena),
+        n(0),
+        undo_heads(kFlushBlockNRows),
+        redo_heads(kFlushBlockNRows) {
+  }
+
+  Arena arena;
+  RowBlock block;
+
+  // The number of valid rows in 'block'.
+  int n;
+
+  // The UNDO/REDO mutations to flush for each row of 'block', allocated
+  // from 'arena'. Entries are null for rows with no mutations of the
+  // corresponding type.
+  vector<Mutation*> undo_heads;
+  vector<Mutation*> redo_heads;
+};
+
+// The write stage of a pipelined flush: append a prepared batch to 'out'.
+Status FlushPreparedBatch(const PreparedFlushBatch& batch,
+                          RollingDiskRowSetWriter* out) {
+  for (int i = 0; i < batch.n; i++) {
+    RETURN_NOT_OK(out->RollIfNecessary());
+    RowBlockRow dst_row = batch.block.row(i);
+    rowid_t index_in_current_drs;
+    if (batch.undo_heads[i] != nullptr) {
+      out->AppendUndoDeltas(dst_row.row_index(), batch.undo_heads[i],
+                            &index_in_current_drs);
+    }
+    if (batch.redo_heads[i] != nullptr) {
+      out->AppendRedoDeltas(dst_row.row_index(), batch.redo_heads[i],
+                            &index_in_current_drs);
+    }
+  }
+  return out->AppendBlock(batch.block);
+}
+
+// Pipelined implementation of FlushCompactionInput(): the calling thread
+// reads and merges the input while a separate thread encodes and writes the
+// output, so that the two stages proceed in parallel.
+Status FlushCompactionInputPipelined(CompactionInput* input,
+                                     const MvccSnapshot& snap,
+                                     const HistoryGcOpts& history_gc_opts,
+                                     RollingDiskRowSetWriter* out) {
+  BlockingQueue<PreparedFlushBatch*> queue(kFlushPipelineQueueDepth);
+
+  // The writer thread drains the queue until it has been shut down and
+  // emptied. On a write error it shuts the queue down itself, which
+  // unblocks the BlockingPut() calls below.
+  Status writer_status;
+  scoped_refptr<Thread> writer;
+  RETURN_NOT_OK(Thread::Create("tablet", "flush-writer",
+      [&]() {
+        PreparedFlushBatch* raw;
+        while (queue.BlockingGet(&raw)) {
+          unique_ptr<PreparedFlushBatch> batch(raw);
+          Status s = FlushPreparedBatch(*batch, out);
+          if (!s.ok()) {
+            writer_status = s;
+            queue.Shutdown();
+            return;
+          }
+        }
+      },
+      &writer));
+
+  // Scratch block used to transform each input row. Its rows may reference
+  // memory in the input's prepared block arena, so each row is deep-copied
+  // into its batch before handoff to the writer.
+  RowBlock scratch_block(out->schema(), 1, nullptr);
+
+  Status producer_status;
+  bool writer_shut_down = false;
+  vector<CompactionInputRow> rows;
+  unique_ptr<PreparedFlushBatch> batch(new PreparedFlushBatch(out->schema()));
+
+  while (input->HasMoreBlocks()) {
+    producer_status = input->PrepareBlock(&rows);
+    if (!producer_status.ok()) break;
+
+    for (int i = 0; i < rows.size(); i++) {
+      CompactionInputRow* input_row = &rows[i];
+
+      const Schema* schema = input_row->row.schema();
+      DCHECK_SCHEMA_EQ(*schema, out->schema());
+      DCHECK(schema->has_column_ids());
+
+      RowBlockRow scratch_row = scratch_block.row(0);
+      Mutation* new_undos_head = nullptr;
+      Mutation* new_redos_head = nullptr;
+      bool is_garbage_collected;
+      producer_status = TransformFlushedRow(input, snap, history_gc_opts,
+                                            input_row, &scratch_row,
+                                            &new_undos_head, &new_redos_head,
+                                            &is_garbage_collected);
+      if (!producer_status.ok()) break;
+
+      if (is_garbage_collected) {
+        // Don't flush the row.
+        continue;
+      }
+
+      // Deep-copy the row and its mutations into the batch, so that the
+      // batch stays valid after FinishBlock() releases the input block.
+      RowBlockRow dst_row = batch->block.row(batch->n);
+      producer_status = CopyRow(scratch_row, &dst_row, &batch->arena);
+      if (!producer_status.ok()) break;
+      if (new_undos_head != nullptr) {
+        CopyMutations(new_undos_head, &batch->undo_heads[batch->n], &batch->arena);
+      }
+      if (new_redos_head != nullptr) {
+        CopyMutations(new_redos_head, &batch->redo_heads[batch->n], &batch->arena);
+      }
+
+      batch->n++;
+      if (batch->n == kFlushBlockNRows) {
+        if (!queue.BlockingPut(batch.get())) {
+          // The writer hit an error and shut down the queue.
+          writer_shut_down = true;
+          break;
+        }
+        batch.release();
+        batch.reset(new PreparedFlushBatch(out->schema()));
+      }
+    }
+    if (!producer_status.ok() || writer_shut_down) break;
+
+    producer_status = input->FinishBlock();
+    if (!producer_status.ok()) break;
+  }
+
+  // Hand off any final partial batch.
+  if (producer_status.ok() && !writer_shut_down && batch->n > 0) {
+    batch->block.Resize(batch->n);
+    if (queue.BlockingPut(batch.get())) {
+      batch.release();
+    }
+  }
+
+  queue.Shutdown();
+  writer->Join();
+
+  // Free any batches the writer abandoned when it hit an error.
+  PreparedFlushBatch* raw;
+  while (queue.BlockingGet(&raw)) {
+    delete raw;
+  }
+
+  RETURN_NOT_OK(producer_status);
+  return writer_status;
+}
+
+} // anonymous namespace
+
 Status FlushCompactionInput(CompactionInput* input,
                             const MvccSnapshot& snap,
                             const HistoryGcOpts& history_gc_opts,
                             RollingDiskRowSetWriter* out) {
   RETURN_NOT_OK(input->Init());
-  vector<CompactionInputRow> rows;
-
   DCHECK(out->schema().has_column_ids());
 
-  RowBlock block(out->schema(), 100, nullptr);
+  if (FLAGS_compaction_pipelined_flush) {
+    return FlushCompactionInputPipelined(input, snap, history_gc_opts, out);
+  }
+
+  vector<CompactionInputRow> rows;
+
+  RowBlock block(out->schema(), kFlushBlockNRows, nullptr);
 
   while (input->HasMoreBlocks()) {
     RETURN_NOT_OK(input->PrepareBlock(&rows));
@@ -1073,35 +1365,13 @@ Status FlushCompactionInput(CompactionInput* input,
       DCHECK(schema->has_column_ids());
 
       RowBlockRow dst_row = block.row(n);
-      RETURN_NOT_OK(CopyRow(input_row->row, &dst_row, static_cast<Arena*>(nullptr)));
-
-      DVLOG(4) << "Input Row: " << CompactionInputRowToString(*input_row);
-
-      // Collect the new UNDO/REDO mutations.
       Mutation* new_undos_head = nullptr;
       Mutation* new_redos_head = nullptr;
-
-      RETURN_NOT_OK(ApplyMutationsAndGenerateUndos(snap,
-                                                   *input_row,
-                                                   &new_undos_head,
-                                                   &new_redos_head,
-                                                   input->PreparedBlockArena(),
-                                                   &dst_row));
-
-      // Merge the histories of 'input_row' with previous ghosts, if there are any.
-      RETURN_NOT_OK(MergeDuplicatedRowHistory(input_row,
-                                              &new_undos_head,
-                                              input->PreparedBlockArena()));
-
-      // Remove ancient UNDOS and check whether the row should be garbage collected.
       bool is_garbage_collected;
-      RemoveAncientUndos(history_gc_opts,
-                         &new_undos_head,
-                         new_redos_head,
-                         &is_garbage_collected);
-
-      DVLOG(4) << "Output Row: " << RowToString(dst_row, new_redos_head, new_undos_head) <<
-          "; Was garbage collected? " << is_garbage_collected;
+      RETURN_NOT_OK(TransformFlushedRow(input, snap, history_gc_opts,
+                                        input_row, &dst_row,
+                                        &new_undos_head, &new_redos_head,
+                                        &is_garbage_collected));
 
       // Whether this row was garbage collected
       if (is_garbage_collected) {
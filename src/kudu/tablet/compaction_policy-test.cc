@@ -28,6 +28,7 @@
 #include "kudu/util/test_util.h"
 #include "kudu/tablet/mock-rowsets.h"
 #include "kudu/tablet/rowset.h"
+#include "kudu/tablet/rowset_info.h"
 #include "kudu/tablet/rowset_tree.h"
 #include "kudu/tablet/compaction_policy.h"
 
@@ -60,6 +61,68 @@ TEST(TestCompactionPolicy, TestBudgetedSelection) {
   ASSERT_GE(quality, 1.0);
 }
 
+// ChooseCompactionSplitKeys should partition equal-sized inputs at their
+// max-key bounds.
+TEST(TestCompactionPolicy, TestChooseCompactionSplitKeys) {
+  RowSetVector vec;
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("A", "b")));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("b", "d")));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("d", "f")));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("f", "h")));
+
+  vector<string> split_keys;
+  RowSetInfo::ChooseCompactionSplitKeys(vec, 2, &split_keys);
+  ASSERT_EQ(vector<string>({ "d" }), split_keys);
+
+  split_keys.clear();
+  RowSetInfo::ChooseCompactionSplitKeys(vec, 4, &split_keys);
+  ASSERT_EQ(vector<string>({ "b", "d", "f" }), split_keys);
+
+  // A single requested range yields no split keys.
+  split_keys.clear();
+  RowSetInfo::ChooseCompactionSplitKeys(vec, 1, &split_keys);
+  ASSERT_TRUE(split_keys.empty());
+}
+
+// A policy instance memoizes its result between runs: repeated selection over
+// an unchanged tree should yield the same answer, and a changed tree should
+// invalidate the memoized result.
+TEST(TestCompactionPolicy, TestMemoizedSelection) {
+  RowSetVector vec;
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("C", "c")));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("B", "a")));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("A", "b")));
+
+  RowSetTree tree;
+  ASSERT_OK(tree.Reset(vec));
+
+  const int kBudgetMb = 1000; // enough to select all
+  BudgetedCompactionPolicy policy(kBudgetMb);
+
+  unordered_set<RowSet*> picked;
+  double quality = 0;
+  ASSERT_OK(policy.PickRowSets(tree, &picked, &quality, nullptr));
+
+  // A second run over the same tree hits the memoized result and must
+  // return the same selection.
+  unordered_set<RowSet*> picked_again;
+  double quality_again = 0;
+  ASSERT_OK(policy.PickRowSets(tree, &picked_again, &quality_again, nullptr));
+  ASSERT_EQ(picked, picked_again);
+  ASSERT_EQ(quality, quality_again);
+
+  // Adding a rowset (as a flush would) invalidates the memoized result.
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("a", "d")));
+  RowSetTree new_tree;
+  ASSERT_OK(new_tree.Reset(vec));
+
+  unordered_set<RowSet*> picked_after_flush;
+  double quality_after_flush = 0;
+  ASSERT_OK(policy.PickRowSets(new_tree, &picked_after_flush,
+                               &quality_after_flush, nullptr));
+  ASSERT_EQ(4, picked_after_flush.size());
+}
+
 // Return the directory of the currently-running executable.
 static string GetExecutableDir() {
   string exec;
@@ -49,6 +49,15 @@ DEFINE_double(compaction_approximation_ratio, 1.05f,
               "if it is known to be within 5% of the optimal solution.");
 TAG_FLAG(compaction_approximation_ratio, experimental);
 
+DEFINE_bool(compaction_policy_reuse_unchanged_input, true,
+            "Whether the budgeted compaction policy may reuse the result of "
+            "its previous run if the set of rowsets under consideration is "
+            "unchanged since then. This avoids re-running the compaction "
+            "solver on every maintenance manager cycle for tablets which are "
+            "not actively flushing or compacting.");
+TAG_FLAG(compaction_policy_reuse_unchanged_input, advanced);
+TAG_FLAG(compaction_policy_reuse_unchanged_input, runtime);
+
 namespace kudu {
 namespace tablet {
 
@@ -347,12 +356,44 @@ void BudgetedCompactionPolicy::RunExact(
   }
 }
 
+// Capture the input which the compaction solution depends on: the sequence
+// of rowsets in 'tree', paired with whether each is currently available for
+// compaction.
+static vector<std::pair<RowSet*, bool>> SnapshotPolicyInput(const RowSetTree& tree) {
+  vector<std::pair<RowSet*, bool>> input;
+  input.reserve(tree.all_rowsets().size());
+  for (const auto& rs : tree.all_rowsets()) {
+    input.emplace_back(rs.get(), rs->IsAvailableForCompaction());
+  }
+  return input;
+}
+
 // See docs/design-docs/compaction-policy.md for an overview of the compaction
 // policy implemented in this function.
 Status BudgetedCompactionPolicy::PickRowSets(const RowSetTree &tree,
                                              unordered_set<RowSet*>* picked,
                                              double* quality,
                                              std::vector<std::string>* log) {
+  // The maintenance manager re-evaluates the compaction quality of every
+  // tablet on each scheduling cycle, so most calls here see exactly the same
+  // set of rowsets as the previous one. In that case the previously computed
+  // solution is still valid, and we can skip the solver entirely. A flush or
+  // compaction changes the rowset membership and thus invalidates the
+  // memoized result.
+  //
+  // When a verbose log is requested we always recompute, since the log is a
+  // by-product of the computation itself.
+  vector<std::pair<RowSet*, bool>> input = SnapshotPolicyInput(tree);
+  if (FLAGS_compaction_policy_reuse_unchanged_input &&
+      has_memoized_solution_ && log == nullptr &&
+      input == memoized_input_) {
+    *quality = memoized_solution_.value;
+    if (memoized_solution_.value > 0) {
+      *picked = memoized_solution_.rowsets;
+    }
+    return Status::OK();
+  }
+
   vector<RowSetInfo> asc_min_key, asc_max_key;
   SetupKnapsackInput(tree, &asc_min_key, &asc_max_key);
   if (asc_max_key.empty()) {
@@ -360,6 +401,9 @@ Status BudgetedCompactionPolicy::PickRowSets(const RowSetTree &tree,
       LOG_STRING(INFO, log) << "No rowsets to compact";
     }
     // nothing to compact.
+    memoized_input_ = std::move(input);
+    memoized_solution_ = SolutionAndValue();
+    has_memoized_solution_ = true;
     return Status::OK();
   }
 
@@ -436,6 +480,13 @@ Status BudgetedCompactionPolicy::PickRowSets(const RowSetTree &tree,
 
   *quality = best_solution.value;
 
+  // Remember the solution so that the next call can skip the solver if the
+  // input is still unchanged by then.
+  memoized_input_ = std::move(input);
+  memoized_solution_.rowsets = best_solution.rowsets;
+  memoized_solution_.value = best_solution.value;
+  has_memoized_solution_ = true;
+
   if (best_solution.value <= 0) {
     VLOG(1) << "Best compaction available makes things worse. Not compacting.";
     return Status::OK();
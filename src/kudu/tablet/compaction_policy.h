@@ -19,6 +19,7 @@
 
 #include <string>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "kudu/gutil/macros.h"
@@ -124,6 +125,24 @@ class BudgetedCompactionPolicy : public CompactionPolicy {
       SolutionAndValue* best_solution);
 
   size_t size_budget_mb_;
+
+  // Memoized result of the most recent PickRowSets() call, along with the
+  // input it was computed from. The input is captured as the sequence of
+  // rowset pointers in the tree paired with their availability for
+  // compaction: the solution only depends on that sequence, so if it is
+  // unchanged since the last call (i.e. no flush or compaction has swapped
+  // in a new RowSetTree), the previous solution is still valid and the
+  // solver can be skipped entirely.
+  //
+  // The rowset pointers in 'memoized_input_' may dangle once the rowsets
+  // they refer to have been compacted away; they are only ever compared by
+  // address, never dereferenced.
+  //
+  // Synchronization of this state is the caller's responsibility, per the
+  // contract on CompactionPolicy::PickRowSets().
+  std::vector<std::pair<RowSet*, bool>> memoized_input_;
+  SolutionAndValue memoized_solution_;
+  bool has_memoized_solution_ = false;
 };
 
 } // namespace tablet
@@ -59,7 +59,7 @@
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/status.h"
 
-//#define TRAVERSE_PREFETCH
+#define TRAVERSE_PREFETCH
 #define SCAN_PREFETCH
 
 
@@ -300,6 +300,30 @@ class ValueSlice {
     ptr_ = const_cast<const uint8_t*>(in_arena);
   }
 
+  // Allocate and length-prefix space for a value of 'size' bytes from
+  // 'alloc_arena', in the same layout used by set(). Returns a pointer to
+  // the value's (uninitialized) data bytes. The caller must fill these in
+  // before the value is published to a leaf with set_preallocated():
+  // callers such as the MemRowSet use this to construct a value in place
+  // and then insert it without a second copy.
+  template<class ArenaType>
+  static uint8_t* PreallocateInArena(size_t size, ArenaType* alloc_arena) {
+    uint8_t* in_arena = reinterpret_cast<uint8_t*>(
+      alloc_arena->AllocateBytesAligned(size + sizeof(size_type),
+                                        sizeof(uint8_t*)));
+    DCHECK_LE(size, MathLimits<size_type>::kMax)
+      << "Slice too large for btree";
+    size_type size_val = size;
+    memcpy(in_arena, &size_val, sizeof(size_val));
+    return in_arena + sizeof(size_type);
+  }
+
+  // Point this slice at a buffer previously returned by
+  // PreallocateInArena(). No data is copied.
+  void set_preallocated(const uint8_t* data) {
+    ptr_ = data - sizeof(size_type);
+  }
+
  private:
   const uint8_t* ptr_;
 } PACKED;
@@ -354,6 +378,19 @@ static void InsertInSliceArray(ISlice *array, size_t num_entries,
   array[idx].set(src, arena);
 }
 
+// Like InsertInSliceArray, but for a value whose bytes were already
+// formatted in the tree's arena with ValueSlice::PreallocateInArena().
+// The value is not copied again; the leaf's ValueSlice points directly
+// at 'src'.
+inline void InsertPreallocatedInValueArray(ValueSlice *array, size_t num_entries,
+                                           const Slice &src, size_t idx) {
+  DCHECK_LT(idx, num_entries);
+  for (size_t i = num_entries - 1; i > idx; i--) {
+    array[i] = array[i - 1];
+  }
+  array[idx].set_preallocated(src.data());
+}
+
 
 template<class Traits>
 class NodeBase {
@@ -696,7 +733,8 @@ class LeafNode : public NodeBase<Traits> {
   }
 
   // Insert a new entry into this leaf node.
-  InsertStatus Insert(PreparedMutation<Traits> *mut, const Slice &val) {
+  InsertStatus Insert(PreparedMutation<Traits> *mut, const Slice &val,
+                      bool val_preallocated) {
     DCHECK_EQ(this, mut->leaf());
     DCHECK(this->IsLocked());
 
@@ -704,13 +742,17 @@ class LeafNode : public NodeBase<Traits> {
       return INSERT_DUPLICATE;
     }
 
-    return InsertNew(mut->idx(), mut->key(), val, mut->arena());
+    return InsertNew(mut->idx(), mut->key(), val, mut->arena(), val_preallocated);
   }
 
   // Insert an entry at the given index, which is guaranteed to be
   // new.
+  //
+  // If 'val_preallocated' is true, 'val' already lives in the tree's
+  // arena in ValueSlice layout and is adopted without copying.
   InsertStatus InsertNew(size_t idx, const Slice &key, const Slice &val,
-                         typename Traits::ArenaType* arena) {
+                         typename Traits::ArenaType* arena,
+                         bool val_preallocated) {
     if (PREDICT_FALSE(num_entries_ == kMaxEntries)) {
       // Full due to metadata
       return INSERT_FULL;
@@ -725,7 +767,11 @@ class LeafNode : public NodeBase<Traits> {
     num_entries_++;
     InsertInSliceArray(keys_, num_entries_, key, idx, arena);
     DebugRacyPoint<Traits>();
-    InsertInSliceArray(vals_, num_entries_, val, idx, arena);
+    if (val_preallocated) {
+      InsertPreallocatedInValueArray(vals_, num_entries_, val, idx);
+    } else {
+      InsertInSliceArray(vals_, num_entries_, val, idx, arena);
+    }
 
     return INSERT_SUCCESS;
   }
@@ -866,7 +912,15 @@ class PreparedMutation {
 
   bool Insert(const Slice &val) {
     CHECK(prepared());
-    return tree_->Insert(this, val);
+    return tree_->Insert(this, val, false);
+  }
+
+  // Insert a new entry whose value bytes were already formatted in the
+  // tree's arena with ValueSlice::PreallocateInArena(). The leaf's
+  // ValueSlice points directly at 'val' rather than copying it again.
+  bool InsertPreallocated(const Slice &val) {
+    CHECK(prepared());
+    return tree_->Insert(this, val, true);
   }
 
   // Return a slice referencing the existing data in the row.
@@ -1164,9 +1218,6 @@ class CBTree {
     NodeBase<Traits> *node_base = node.base_ptr();
 
     while (node.type() != NodePtr<Traits>::LEAF_NODE) {
-#ifdef TRAVERSE_PREFETCH
-      PrefetchMemory(node.internal_node_ptr());
-#endif
       retry_in_node:
       int num_children = node.internal_node_ptr()->num_children_;
       NodePtr<Traits> child = node.internal_node_ptr()->FindChild(key);
@@ -1176,6 +1227,17 @@ class CBTree {
 
       if (PREDICT_TRUE(!child.is_null())) {
         child_base = child.base_ptr();
+#ifdef TRAVERSE_PREFETCH
+        // Prefetch the next level of the tree as soon as we know which child
+        // we'll descend into. The prefetch overlaps with the version
+        // re-validation of the current node below, so the child's cache lines
+        // are typically resident by the time they are searched.
+        if (child.type() == NodePtr<Traits>::LEAF_NODE) {
+          PrefetchMemory(child.leaf_node_ptr());
+        } else {
+          PrefetchMemory(child.internal_node_ptr());
+        }
+#endif
         child_version = child_base->StableVersion();
       }
       AtomicVersion new_node_version = node_base->AcquireVersion();
@@ -1300,7 +1362,8 @@ class CBTree {
   // Postcondition:
   //   'node' is unlocked
   bool Insert(PreparedMutation<Traits> *mutation,
-              const Slice &val) {
+              const Slice &val,
+              bool val_preallocated) {
     debug::ScopedTSANIgnoreReadsAndWrites ignore_tsan;
     CHECK(!frozen_);
     CHECK_NOTNULL(mutation);
@@ -1313,7 +1376,7 @@ class CBTree {
     // again.
     mutation->mark_done();
 
-    switch (node->Insert(mutation, val)) {
+    switch (node->Insert(mutation, val, val_preallocated)) {
       case INSERT_SUCCESS:
         node->Unlock();
         return true;
@@ -1321,7 +1384,7 @@ class CBTree {
         node->Unlock();
         return false;
       case INSERT_FULL:
-        return SplitLeafAndInsertUp(mutation, val);
+        return SplitLeafAndInsertUp(mutation, val, val_preallocated);
         // SplitLeafAndInsertUp takes care of unlocking
       default:
         CHECK(0) << "Unexpected result";
@@ -1466,7 +1529,8 @@ class CBTree {
   // The node should be locked on entrance to the function
   // and will be unlocked upon exit.
   bool SplitLeafAndInsertUp(PreparedMutation<Traits> *mutation,
-                            const Slice &val) {
+                            const Slice &val,
+                            bool val_preallocated) {
     LeafNode<Traits> *node = mutation->leaf();
     Slice key = mutation->key_;
 
@@ -1488,7 +1552,7 @@ class CBTree {
     // Re-prepare the mutation after the split.
     dst_leaf->PrepareMutation(mutation);
 
-    CHECK_EQ(INSERT_SUCCESS, dst_leaf->Insert(mutation, val))
+    CHECK_EQ(INSERT_SUCCESS, dst_leaf->Insert(mutation, val, val_preallocated))
       << "node split at " << KUDU_REDACT(split_key.ToDebugString())
       << " did not result in enough space for key " << KUDU_REDACT(key.ToDebugString())
       << " in left node";
@@ -1696,7 +1760,9 @@ class CBTreeIterator {
   void GetEntryInLeaf(size_t idx, Slice *key, Slice *val) {
     DCHECK(seeked_);
     DCHECK_LT(idx, leaf_to_scan_->num_entries());
-    leaf_to_scan_->Get(idx, key, val);
+    ValueSlice val_slice;
+    leaf_to_scan_->Get(idx, key, &val_slice);
+    *val = val_slice.as_slice();
   }
 
  private:
@@ -23,6 +23,7 @@
 #include "kudu/common/column_materialization_context.h"
 #include "kudu/common/iterator.h"
 #include "kudu/tablet/delta_store.h"
+#include "kudu/tablet/update_overlay.h"
 #include "kudu/util/status.h"
 
 using std::shared_ptr;
@@ -34,9 +35,13 @@ namespace tablet {
 
   // Construct. The base_iter and delta_iter should not be Initted.
 DeltaApplier::DeltaApplier(shared_ptr<CFileSet::Iterator> base_iter,
-                           unique_ptr<DeltaIterator> delta_iter)
+                           unique_ptr<DeltaIterator> delta_iter,
+                           const UpdateOverlay* update_overlay,
+                           MvccSnapshot snap)
     : base_iter_(std::move(base_iter)),
       delta_iter_(std::move(delta_iter)),
+      update_overlay_(update_overlay),
+      snap_(std::move(snap)),
       first_prepare_(true) {}
 
 DeltaApplier::~DeltaApplier() {
@@ -97,9 +102,20 @@ Status DeltaApplier::InitializeSelectionVector(SelectionVector *sel_vec) {
 Status DeltaApplier::MaterializeColumn(ColumnMaterializationContext *ctx) {
   DCHECK(!first_prepare_) << "PrepareBatch() must be called at least once";
   // Data with updates cannot be evaluated at the decoder-level.
-  if (delta_iter_->MayHaveDeltas()) {
+  if (delta_iter_->MayHaveDeltasForColumn(ctx->col_idx())) {
     ctx->SetDecoderEvalNotSupported();
     RETURN_NOT_OK(base_iter_->MaterializeColumn(ctx));
+    const Schema& projection = base_iter_->schema();
+    if (update_overlay_ != nullptr && projection.has_column_ids() &&
+        update_overlay_->TryApplyToColumn(snap_,
+                                          projection.column_id(ctx->col_idx()),
+                                          base_iter_->cur_ordinal_idx(),
+                                          ctx->block())) {
+      // The overlay patched the newest value of every updated cell onto the
+      // base data, so applying the deltas themselves would be a no-op.
+      // Deletes are still handled by InitializeSelectionVector().
+      return Status::OK();
+    }
     RETURN_NOT_OK(delta_iter_->ApplyUpdates(ctx->col_idx(), ctx->block()));
   } else {
     RETURN_NOT_OK(base_iter_->MaterializeColumn(ctx));
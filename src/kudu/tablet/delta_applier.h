@@ -28,11 +28,13 @@
 #include "kudu/gutil/macros.h"
 #include "kudu/util/status.h"
 #include "kudu/tablet/cfile_set.h"
+#include "kudu/tablet/mvcc.h"
 
 namespace kudu {
 namespace tablet {
 
 class DeltaIterator;
+class UpdateOverlay;
 
 ////////////////////////////////////////////////////////////
 // Delta-applying iterators
@@ -70,13 +72,25 @@ class DeltaApplier : public ColumnwiseIterator {
   DISALLOW_COPY_AND_ASSIGN(DeltaApplier);
 
   // Construct. The base_iter and delta_iter should not be Initted.
+  // 'update_overlay' may be NULL; if set, it must outlive this iterator and
+  // columns it can serve under 'snap' skip delta application (see
+  // UpdateOverlay).
   DeltaApplier(std::shared_ptr<CFileSet::Iterator> base_iter,
-               std::unique_ptr<DeltaIterator> delta_iter);
+               std::unique_ptr<DeltaIterator> delta_iter,
+               const UpdateOverlay* update_overlay,
+               MvccSnapshot snap);
   virtual ~DeltaApplier();
 
   std::shared_ptr<CFileSet::Iterator> base_iter_;
   std::unique_ptr<DeltaIterator> delta_iter_;
 
+  // The update overlay of the DeltaTracker which created this iterator,
+  // or NULL if the overlay is not enabled.
+  const UpdateOverlay* update_overlay_;
+
+  // The snapshot this iterator reads at.
+  const MvccSnapshot snap_;
+
   bool first_prepare_;
 };
 
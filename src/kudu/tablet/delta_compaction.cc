@@ -70,6 +70,7 @@ MajorDeltaCompaction::MajorDeltaCompaction(
       base_data_(base_data),
       included_stores_(std::move(included_stores)),
       delta_iter_(std::move(delta_iter)),
+      new_undo_delta_block_max_timestamp_(0),
       redo_delta_mutations_written_(0),
       undo_delta_mutations_written_(0),
       state_(kInitialized) {
@@ -222,6 +223,7 @@ Status MajorDeltaCompaction::FlushRowSetAndDeltas() {
 
   if (undo_delta_mutations_written_ > 0) {
     new_undo_delta_writer_->WriteDeltaStats(undo_stats);
+    new_undo_delta_block_max_timestamp_ = undo_stats.max_timestamp().ToUint64();
     RETURN_NOT_OK(new_undo_delta_writer_->Finish());
   }
 
@@ -302,7 +304,7 @@ Status MajorDeltaCompaction::CreateMetadataUpdate(
                                  new_delta_blocks);
 
   if (undo_delta_mutations_written_ > 0) {
-    update->SetNewUndoBlock(new_undo_delta_block_);
+    update->SetNewUndoBlock(new_undo_delta_block_, new_undo_delta_block_max_timestamp_);
   }
 
   // Replace old column blocks with new ones
@@ -124,6 +124,10 @@ class MajorDeltaCompaction {
   gscoped_ptr<DeltaFileWriter> new_undo_delta_writer_;
   BlockId new_undo_delta_block_;
 
+  // The maximum delta timestamp written to the new UNDO block, recorded in
+  // the rowset metadata so readers can cull the block without opening it.
+  uint64_t new_undo_delta_block_max_timestamp_;
+
   size_t redo_delta_mutations_written_;
   size_t undo_delta_mutations_written_;
 
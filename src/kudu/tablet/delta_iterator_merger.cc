@@ -120,6 +120,15 @@ bool DeltaIteratorMerger::MayHaveDeltas() {
   return false;
 }
 
+bool DeltaIteratorMerger::MayHaveDeltasForColumn(size_t col_to_apply) {
+  for (const unique_ptr<DeltaIterator>& iter : iters_) {
+    if (iter->MayHaveDeltasForColumn(col_to_apply)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 string DeltaIteratorMerger::ToString() const {
   string ret;
   ret.append("DeltaIteratorMerger(");
@@ -58,6 +58,7 @@ class DeltaIteratorMerger : public DeltaIterator {
                                                  Arena* arena) OVERRIDE;
   virtual bool HasNext() OVERRIDE;
   bool MayHaveDeltas() override;
+  bool MayHaveDeltasForColumn(size_t col_to_apply) override;
   virtual std::string ToString() const OVERRIDE;
 
  private:
@@ -32,11 +32,15 @@ using std::vector;
 
 namespace tablet {
 
+const rowid_t DeltaStats::kRowsPerHistogramBucket;
+
 DeltaStats::DeltaStats()
     : delete_count_(0),
       reinsert_count_(0),
       max_timestamp_(Timestamp::kMin),
-      min_timestamp_(Timestamp::kMax) {
+      min_timestamp_(Timestamp::kMax),
+      min_row_idx_(MathLimits<rowid_t>::kMax),
+      max_row_idx_(0) {
 }
 
 void DeltaStats::IncrUpdateCount(ColumnId col_id, int64_t update_count) {
@@ -93,6 +97,9 @@ string DeltaStats::ToString() const {
       "ts range=[$0, $1]",
       min_timestamp_.ToString(),
       max_timestamp_.ToString());
+  if (min_row_idx_ <= max_row_idx_) {
+    ret.append(Substitute(", row range=[$0, $1]", min_row_idx_, max_row_idx_));
+  }
   ret.append(Substitute(", delete_count=[$0]", delete_count_));
   ret.append(Substitute(", reinsert_count=[$0]", reinsert_count_));
   ret.append(", update_counts_by_col_id=[");
@@ -116,6 +123,20 @@ void DeltaStats::ToPB(DeltaStatsPB* pb) const {
 
   pb->set_max_timestamp(max_timestamp_.ToUint64());
   pb->set_min_timestamp(min_timestamp_.ToUint64());
+
+  if (min_row_idx_ <= max_row_idx_) {
+    pb->set_min_row_idx(min_row_idx_);
+    pb->set_max_row_idx(max_row_idx_);
+  }
+
+  if (!mutation_counts_by_row_bucket_.empty()) {
+    pb->set_rows_per_bucket(kRowsPerHistogramBucket);
+    for (const auto& e : mutation_counts_by_row_bucket_) {
+      DeltaStatsPB::RowBucketStats* bucket = pb->add_row_bucket_stats();
+      bucket->set_bucket(e.first);
+      bucket->set_mutation_count(e.second);
+    }
+  }
 }
 
 Status DeltaStats::InitFromPB(const DeltaStatsPB& pb) {
@@ -127,6 +148,25 @@ Status DeltaStats::InitFromPB(const DeltaStatsPB& pb) {
   }
   max_timestamp_.FromUint64(pb.max_timestamp());
   min_timestamp_.FromUint64(pb.min_timestamp());
+  if (pb.has_min_row_idx() && pb.has_max_row_idx()) {
+    min_row_idx_ = pb.min_row_idx();
+    max_row_idx_ = pb.max_row_idx();
+  } else {
+    // Older files didn't persist the row range; leave it unknown so that the
+    // accessors report an unbounded range.
+    min_row_idx_ = MathLimits<rowid_t>::kMax;
+    max_row_idx_ = 0;
+  }
+  mutation_counts_by_row_bucket_.clear();
+  // Only adopt the histogram if its bucket width matches our own, so that
+  // histograms from different stores are always directly comparable. A file
+  // written with a different width is treated as having an unknown
+  // distribution.
+  if (pb.has_rows_per_bucket() && pb.rows_per_bucket() == kRowsPerHistogramBucket) {
+    for (const DeltaStatsPB::RowBucketStats& bucket : pb.row_bucket_stats()) {
+      mutation_counts_by_row_bucket_[bucket.bucket()] += bucket.mutation_count();
+    }
+  }
   return Status::OK();
 }
 
@@ -20,6 +20,7 @@
 #include <glog/logging.h>
 #include <boost/function.hpp>
 
+#include <algorithm>
 #include <set>
 #include <stdint.h>
 #include <string>
@@ -27,7 +28,9 @@
 
 #include "kudu/gutil/atomicops.h"
 #include "kudu/gutil/map-util.h"
+#include "kudu/gutil/mathlimits.h"
 #include "kudu/common/row_changelist.h"
+#include "kudu/common/rowid.h"
 #include "kudu/tablet/mvcc.h"
 
 namespace kudu {
@@ -39,6 +42,10 @@ class DeltaStatsPB;
 // A wrapper class for describing data statistics.
 class DeltaStats {
  public:
+  // The number of consecutive row indexes covered by each bucket of the
+  // row-range mutation histogram (see IncrRowBucketCount()).
+  static const rowid_t kRowsPerHistogramBucket = 4096;
+
   DeltaStats();
 
   // Increment update count for column 'col_id' by 'update_count'.
@@ -86,6 +93,38 @@ class DeltaStats {
     min_timestamp_ = timestamp;
   }
 
+  // Expand the range of row indexes covered by this store to include
+  // 'row_idx'.
+  void UpdateRowRange(rowid_t row_idx) {
+    min_row_idx_ = std::min(min_row_idx_, row_idx);
+    max_row_idx_ = std::max(max_row_idx_, row_idx);
+  }
+
+  // Account for a mutation to 'row_idx' in the row-range mutation histogram.
+  void IncrRowBucketCount(rowid_t row_idx) {
+    mutation_counts_by_row_bucket_[row_idx / kRowsPerHistogramBucket]++;
+  }
+
+  // The number of mutations in each kRowsPerHistogramBucket-row bucket of
+  // the row index space. Empty if the distribution is unknown (e.g. the
+  // stats were loaded from an older file which did not persist it).
+  const std::unordered_map<uint32_t, int64_t>& mutation_counts_by_row_bucket() const {
+    return mutation_counts_by_row_bucket_;
+  }
+
+  // Return the minimum row index of any mutation in a delta file. If the
+  // range is unknown (e.g. the stats were loaded from an older file which
+  // did not persist it), returns an unbounded range.
+  rowid_t min_row_idx() const {
+    return min_row_idx_ <= max_row_idx_ ? min_row_idx_ : 0;
+  }
+
+  // Return the maximum row index of any mutation in a delta file. See
+  // the note on min_row_idx() about unknown ranges.
+  rowid_t max_row_idx() const {
+    return min_row_idx_ <= max_row_idx_ ? max_row_idx_ : MathLimits<rowid_t>::kMax;
+  }
+
   std::string ToString() const;
 
   // Convert this object to the protobuf which is stored in the DeltaFile footer.
@@ -104,6 +143,15 @@ class DeltaStats {
   uint64_t reinsert_count_;
   Timestamp max_timestamp_;
   Timestamp min_timestamp_;
+
+  // The range of row indexes covered by this store. min > max (the initial
+  // state) indicates that the range is unknown, in which case the accessors
+  // above return an unbounded range.
+  rowid_t min_row_idx_;
+  rowid_t max_row_idx_;
+
+  // Histogram of mutation counts keyed by row index bucket.
+  std::unordered_map<uint32_t, int64_t> mutation_counts_by_row_bucket_;
 };
 
 
@@ -184,6 +184,12 @@ class DeltaIterator {
   // Must have called PrepareBatch() with flag = PREPARE_FOR_APPLY.
   virtual bool MayHaveDeltas() = 0;
 
+  // Returns true if the deltas prepared by the last PrepareBatch() might
+  // include mutations relevant to the projected column 'col_to_apply'.
+  // As with MayHaveDeltas(), it is safe to conservatively return true.
+  // Must have called PrepareBatch() with flag = PREPARE_FOR_APPLY.
+  virtual bool MayHaveDeltasForColumn(size_t col_to_apply) = 0;
+
   // Return a string representation suitable for debug printouts.
   virtual std::string ToString() const = 0;
 
@@ -19,7 +19,12 @@
 
 #include <mutex>
 #include <set>
+#include <unordered_map>
+#include <utility>
 
+#include <gflags/gflags.h>
+
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/strip.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -30,8 +35,29 @@
 #include "kudu/tablet/deltafile.h"
 #include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/tablet.pb.h"
+#include "kudu/tablet/update_overlay.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/status.h"
 
+DEFINE_double(tablet_delta_store_minor_compact_size_ratio, 10,
+              "Size-tiering ratio used when picking REDO delta files for minor delta "
+              "compaction. An older delta file is only included in a compaction if it "
+              "is no larger than this multiple of the total size of the newer delta "
+              "files already picked. Smaller values reduce write amplification on "
+              "update-heavy tables by not rewriting already-compacted files until a "
+              "comparable volume of new deltas has accumulated behind them.");
+TAG_FLAG(tablet_delta_store_minor_compact_size_ratio, experimental);
+
+DEFINE_bool(tablet_update_overlay, false,
+            "Whether to maintain an in-memory overlay of the newest values of "
+            "updated fixed-width non-key columns over each rowset's base data. "
+            "Scans at a current snapshot can then materialize such columns "
+            "without merging deltas, at the cost of extra memory. Intended for "
+            "update-heavy workloads. See "
+            "--tablet_update_overlay_max_memory_bytes.");
+TAG_FLAG(tablet_update_overlay, advanced);
+TAG_FLAG(tablet_update_overlay, experimental);
+
 namespace kudu {
 namespace tablet {
 
@@ -67,7 +93,11 @@ DeltaTracker::DeltaTracker(shared_ptr<RowSetMetadata> rowset_metadata,
       open_(false),
       log_anchor_registry_(log_anchor_registry),
       mem_trackers_(mem_trackers),
-      dms_empty_(true) {}
+      dms_empty_(true) {
+  if (FLAGS_tablet_update_overlay) {
+    update_overlay_.reset(new UpdateOverlay());
+  }
+}
 
 Status DeltaTracker::OpenDeltaReaders(const vector<BlockId>& blocks,
                                       vector<shared_ptr<DeltaStore> >* stores,
@@ -97,6 +127,15 @@ Status DeltaTracker::OpenDeltaReaders(const vector<BlockId>& blocks,
       return s;
     }
 
+    if (type == UNDO) {
+      // If the metadata recorded this UNDO file's maximum delta timestamp,
+      // pass it down so the file can be culled before it's ever opened.
+      uint64_t max_timestamp;
+      if (rowset_metadata_->undo_delta_block_max_timestamp(block_id, &max_timestamp)) {
+        dfr->set_max_timestamp_hint(Timestamp(max_timestamp));
+      }
+    }
+
     VLOG(1) << "Successfully opened " << DeltaType_Name(type)
             << " delta file " << block_id.ToString();
     stores->push_back(dfr);
@@ -118,9 +157,18 @@ Status DeltaTracker::DoOpen() {
                                  &undo_delta_stores_,
                                  UNDO));
 
+  // REDO files which already existed when the rowset was opened (e.g. after
+  // a restart) contain mutations which never passed through the overlay, so
+  // it cannot serve any column until a major delta compaction folds them
+  // into new base data.
+  if (update_overlay_ && !redo_delta_stores_.empty()) {
+    update_overlay_->Disable();
+  }
+
   // the id of the first DeltaMemStore is the max id of the current ones +1
   RETURN_NOT_OK(DeltaMemStore::Create(rowset_metadata_->last_durable_redo_dms_id() + 1,
                                       rowset_metadata_->id(),
+                                      num_rows_,
                                       log_anchor_registry_,
                                       mem_trackers_.dms_tracker,
                                       &dms_));
@@ -217,6 +265,78 @@ Status DeltaTracker::Compact() {
   return CompactStores(0, -1);
 }
 
+int DeltaTracker::PickRedoDeltaStoresForMinorCompaction(int* start_idx,
+                                                        int* end_idx) const {
+  shared_lock<rw_spinlock> lock(component_lock_);
+  const int num_stores = redo_delta_stores_.size();
+  if (num_stores < 2) {
+    return 0;
+  }
+
+  // Walk from the newest store towards the oldest, accumulating stores into
+  // the tier while each older store is within the configured size ratio of
+  // the stores picked so far.
+  uint64_t tier_size = redo_delta_stores_[num_stores - 1]->EstimateSize();
+  int start = num_stores - 1;
+  while (start > 0) {
+    uint64_t store_size = redo_delta_stores_[start - 1]->EstimateSize();
+    if (store_size > FLAGS_tablet_delta_store_minor_compact_size_ratio *
+        static_cast<double>(tier_size)) {
+      break;
+    }
+    tier_size += store_size;
+    start--;
+  }
+  if (num_stores - start < 2) {
+    return 0;
+  }
+  *start_idx = start;
+  *end_idx = num_stores - 1;
+  return num_stores - start;
+}
+
+double DeltaTracker::EstimateRedoStoreRowOverlap(int start_idx, int end_idx) const {
+  shared_lock<rw_spinlock> lock(component_lock_);
+  // The store list may have changed since the caller picked the range (e.g. a
+  // concurrent flush appended a new store). The result is only advisory, so
+  // just bail out rather than trying to re-pick.
+  if (start_idx < 0 || end_idx >= static_cast<int>(redo_delta_stores_.size()) ||
+      start_idx >= end_idx) {
+    return 1.0;
+  }
+
+  // For each row bucket touched by any of the stores, count the total number
+  // of mutations and the number of distinct stores which mutated it.
+  std::unordered_map<uint32_t, std::pair<int64_t, int> > buckets;
+  for (int i = start_idx; i <= end_idx; i++) {
+    const shared_ptr<DeltaStore>& store = redo_delta_stores_[i];
+    if (!store->Initted()) {
+      return 1.0;
+    }
+    const auto& histogram = store->delta_stats().mutation_counts_by_row_bucket();
+    if (histogram.empty()) {
+      // The store predates the histogram; its distribution is unknown.
+      return 1.0;
+    }
+    for (const auto& e : histogram) {
+      std::pair<int64_t, int>& bucket = buckets[e.first];
+      bucket.first += e.second;
+      bucket.second++;
+    }
+  }
+
+  int64_t total_mutations = 0;
+  int64_t overlapped_mutations = 0;
+  for (const auto& e : buckets) {
+    total_mutations += e.second.first;
+    if (e.second.second > 1) {
+      overlapped_mutations += e.second.first;
+    }
+  }
+  DCHECK_GT(total_mutations, 0);
+  return static_cast<double>(overlapped_mutations) / total_mutations;
+}
+
 Status DeltaTracker::CompactStores(int start_idx, int end_idx) {
   // Prevent concurrent compactions or a compaction concurrent with a flush
   //
@@ -230,7 +350,12 @@ Status DeltaTracker::CompactStores(int start_idx, int end_idx) {
   }
 
   if (end_idx == -1) {
-    end_idx = redo_delta_stores_.size() - 1;
+    // Pick the size tier of stores to merge. If no worthwhile tier exists
+    // (e.g. a single large store followed by one small one), don't compact
+    // at all rather than rewriting the large store.
+    if (PickRedoDeltaStoresForMinorCompaction(&start_idx, &end_idx) < 2) {
+      return Status::OK();
+    }
   }
 
   CHECK_LE(start_idx, end_idx);
@@ -273,6 +398,82 @@ Status DeltaTracker::CompactStores(int start_idx, int end_idx) {
   return Status::OK();
 }
 
+int64_t DeltaTracker::EstimateBytesInAncientUndoDeltas(
+    Timestamp ancient_history_mark) const {
+  shared_lock<rw_spinlock> lock(component_lock_);
+  int64_t bytes = 0;
+  // UNDO stores are kept in decreasing timestamp order, so the ancient ones
+  // form a suffix of the list.
+  for (auto it = undo_delta_stores_.rbegin(); it != undo_delta_stores_.rend(); ++it) {
+    const DeltaFileReader* dfr = down_cast<DeltaFileReader*>(it->get());
+    uint64_t max_timestamp;
+    if (!rowset_metadata_->undo_delta_block_max_timestamp(dfr->block_id(), &max_timestamp) ||
+        Timestamp(max_timestamp) >= ancient_history_mark) {
+      break;
+    }
+    bytes += dfr->EstimateSize();
+  }
+  return bytes;
+}
+
+Status DeltaTracker::DeleteAncientUndoDeltas(Timestamp ancient_history_mark,
+                                             int64_t* blocks_deleted,
+                                             int64_t* bytes_deleted) {
+  *blocks_deleted = 0;
+  *bytes_deleted = 0;
+
+  // Prevent concurrent flushes or compactions from restructuring the store
+  // lists underneath us. If one is already running, skip the GC rather than
+  // blocking a maintenance thread; the op will pick this rowset up again on
+  // a later pass.
+  if (!compact_flush_lock_.TryAcquire()) {
+    return Status::OK();
+  }
+  std::lock_guard<Mutex> l(compact_flush_lock_, std::adopt_lock);
+  CHECK(open_);
+
+  // Select the ancient suffix of the UNDO store list (see
+  // EstimateBytesInAncientUndoDeltas()), keeping the selected stores in
+  // their original order so they form a contiguous subsequence.
+  SharedDeltaStoreVector ancient_stores;
+  vector<BlockId> ancient_blocks;
+  int64_t bytes = 0;
+  {
+    shared_lock<rw_spinlock> lock(component_lock_);
+    for (auto it = undo_delta_stores_.rbegin(); it != undo_delta_stores_.rend(); ++it) {
+      DeltaFileReader* dfr = down_cast<DeltaFileReader*>(it->get());
+      uint64_t max_timestamp;
+      if (!rowset_metadata_->undo_delta_block_max_timestamp(dfr->block_id(), &max_timestamp) ||
+          Timestamp(max_timestamp) >= ancient_history_mark) {
+        break;
+      }
+      ancient_stores.insert(ancient_stores.begin(), *it);
+      ancient_blocks.insert(ancient_blocks.begin(), dfr->block_id());
+      bytes += dfr->EstimateSize();
+    }
+  }
+  if (ancient_stores.empty()) {
+    return Status::OK();
+  }
+
+  // Remove the stores from the in-memory list, then persist the removal.
+  // CommitUpdate() orphans the underlying blocks, which are deleted once
+  // the metadata flush makes the removal durable.
+  RETURN_NOT_OK(AtomicUpdateStores(ancient_stores, {}, UNDO));
+  RowSetMetadataUpdate update;
+  update.RemoveUndoDeltaBlocks(ancient_blocks);
+  RETURN_NOT_OK_PREPEND(rowset_metadata_->CommitUpdate(update),
+                        "Unable to remove ancient UNDO delta blocks from metadata");
+  RETURN_NOT_OK_PREPEND(rowset_metadata_->Flush(),
+                        "Unable to flush metadata after removing ancient UNDO deltas");
+
+  LOG(INFO) << "Deleted " << ancient_blocks.size() << " ancient UNDO delta blocks ("
+            << bytes << " bytes) from " << rowset_metadata_->ToString();
+  *blocks_deleted = ancient_blocks.size();
+  *bytes_deleted = bytes;
+  return Status::OK();
+}
+
 Status DeltaTracker::DoCompactStores(size_t start_idx, size_t end_idx,
          gscoped_ptr<WritableBlock> block,
          vector<shared_ptr<DeltaStore> > *compacted_stores,
@@ -354,7 +555,8 @@ Status DeltaTracker::WrapIterator(const shared_ptr<CFileSet::Iterator> &base,
   unique_ptr<DeltaIterator> iter;
   RETURN_NOT_OK(NewDeltaIterator(&base->schema(), mvcc_snap, &iter));
 
-  out->reset(new DeltaApplier(base, std::move(iter)));
+  out->reset(new DeltaApplier(base, std::move(iter),
+                              update_overlay_.get(), mvcc_snap));
   return Status::OK();
 }
 
@@ -372,6 +574,11 @@ Status DeltaTracker::Update(Timestamp timestamp,
   if (s.ok()) {
     dms_empty_.Store(false);
 
+    if (update_overlay_) {
+      update_overlay_->RecordUpdate(rowset_metadata_->tablet_schema(),
+                                    timestamp, row_idx, update);
+    }
+
     MemStoreTargetPB* target = result->add_mutated_stores();
     target->set_rs_id(rowset_metadata_->id());
     target->set_dms_id(dms_->id());
@@ -464,6 +671,7 @@ Status DeltaTracker::Flush(MetadataFlushType flush_type) {
     old_dms = dms_;
     RETURN_NOT_OK(DeltaMemStore::Create(old_dms->id() + 1,
                                         rowset_metadata_->id(),
+                                        num_rows_,
                                         log_anchor_registry_,
                                         mem_trackers_.dms_tracker,
                                         &dms_));
@@ -549,5 +757,141 @@ void DeltaTracker::GetColumnIdsWithUpdates(std::vector<ColumnId>* col_ids) const
   col_ids->assign(column_ids_with_updates.begin(), column_ids_with_updates.end());
 }
 
+bool DeltaTracker::GetColumnIdsWithDeltas(std::unordered_set<int>* col_ids) const {
+  // Holding the compact/flush lock guarantees that no delta memstore is
+  // transiently present in 'redo_delta_stores_': a DMS being flushed sits in
+  // that list until the flush completes, and its stats do not reflect its
+  // contents. If a flush or compaction is in progress, conservatively report
+  // that the set can't be determined rather than blocking.
+  if (!compact_flush_lock_.TryAcquire()) {
+    return false;
+  }
+
+  bool determined = true;
+  set<ColumnId> column_ids;
+  {
+    shared_lock<rw_spinlock> lock(component_lock_);
+    // Any mutation still sitting in the delta memstore could affect any
+    // column.
+    if (!dms_->Empty()) {
+      determined = false;
+    }
+    for (const SharedDeltaStoreVector* stores :
+             { &undo_delta_stores_, &redo_delta_stores_ }) {
+      if (!determined) break;
+      for (const shared_ptr<DeltaStore>& ds : *stores) {
+        // We won't force open files just to read their stats, and an
+        // unopened store could contain anything.
+        if (!ds->Initted()) {
+          determined = false;
+          break;
+        }
+        const DeltaStats& stats = ds->delta_stats();
+        // A reinsert can restore arbitrary prior values in any column.
+        if (stats.reinsert_count() > 0) {
+          determined = false;
+          break;
+        }
+        stats.AddColumnIdsWithUpdates(&column_ids);
+      }
+    }
+  }
+  compact_flush_lock_.Release();
+
+  if (!determined) {
+    return false;
+  }
+  col_ids->clear();
+  for (const ColumnId& col_id : column_ids) {
+    col_ids->insert(col_id);
+  }
+  return true;
+}
+
+bool DeltaTracker::CanSkipDeltaApplication(const MvccSnapshot& snap) const {
+  // A snapshot with no upper bound (see MayIncludeFutureCommits()) may come
+  // to depend on deltas which look irrelevant at the time of this call, so
+  // it can never skip delta application.
+  if (snap.MayIncludeFutureCommits()) {
+    return false;
+  }
+
+  // As in GetColumnIdsWithDeltas() above, holding the compact/flush lock
+  // guarantees that 'redo_delta_stores_' contains only delta file readers,
+  // not a delta memstore whose flush is in progress.
+  if (!compact_flush_lock_.TryAcquire()) {
+    return false;
+  }
+
+  bool can_skip = true;
+  {
+    shared_lock<rw_spinlock> lock(component_lock_);
+    // Mutations arriving after this check carry timestamps above the
+    // snapshot's upper bound, so only the current contents of the DMS
+    // matter.
+    if (!dms_->Empty()) {
+      can_skip = false;
+    }
+    for (const SharedDeltaStoreVector* stores :
+             { &undo_delta_stores_, &redo_delta_stores_ }) {
+      if (!can_skip) break;
+      for (const shared_ptr<DeltaStore>& ds : *stores) {
+        // IsRelevantForSnapshot() is conservative for files which haven't
+        // been opened yet; we won't force open a file just to answer this.
+        if (down_cast<DeltaFileReader*>(ds.get())->IsRelevantForSnapshot(snap)) {
+          can_skip = false;
+          break;
+        }
+      }
+    }
+  }
+  compact_flush_lock_.Release();
+  return can_skip;
+}
+
+bool DeltaTracker::MayHaveMutationsAtOrAfter(Timestamp ts) const {
+  // Anything in the DMS was written recently; report it as potentially
+  // in-range rather than walking its contents.
+  if (!dms_empty_.Load()) {
+    return true;
+  }
+
+  // As in GetColumnIdsWithDeltas() above, holding the compact/flush lock
+  // guarantees that 'redo_delta_stores_' contains no delta memstore whose
+  // flush is in progress (its stats would not reflect its contents).
+  if (!compact_flush_lock_.TryAcquire()) {
+    return true;
+  }
+
+  bool may_have = false;
+  {
+    shared_lock<rw_spinlock> lock(component_lock_);
+    if (!dms_->Empty()) {
+      may_have = true;
+    }
+    for (const SharedDeltaStoreVector* stores :
+             { &undo_delta_stores_, &redo_delta_stores_ }) {
+      if (may_have) break;
+      for (const shared_ptr<DeltaStore>& ds : *stores) {
+        // We won't force open files just to read their stats.
+        if (!ds->Initted() || ds->delta_stats().max_timestamp() >= ts) {
+          may_have = true;
+          break;
+        }
+      }
+    }
+  }
+  compact_flush_lock_.Release();
+  return may_have;
+}
+
+bool DeltaTracker::MayHaveUpdatesForColumn(ColumnId col_id) const {
+  std::unordered_set<int> col_ids;
+  if (!GetColumnIdsWithDeltas(&col_ids)) {
+    return true;
+  }
+  return ContainsKey(col_ids, col_id);
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -20,6 +20,7 @@
 #include <gtest/gtest_prod.h>
 #include <memory>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "kudu/common/iterator.h"
@@ -50,6 +51,7 @@ class DeltaMemStore;
 class DeltaFileReader;
 class OperationResultPB;
 class MemStoreTargetPB;
+class UpdateOverlay;
 struct ProbeStats;
 
 // The DeltaTracker is the part of a DiskRowSet which is responsible for
@@ -75,6 +77,29 @@ class DeltaTracker {
                       const MvccSnapshot &mvcc_snap,
                       gscoped_ptr<ColumnwiseIterator>* out) const;
 
+  // Return true if none of the stores tracked by this DeltaTracker contains
+  // (or can come to contain) a mutation relevant to 'snap', i.e. iterating
+  // over the base data directly would produce the same rows as applying the
+  // deltas. Callers may then skip delta application entirely. Snapshot scans
+  // of rowsets with no recent mutation activity -- e.g. backup and export
+  // scans of cold tablets -- commonly satisfy this for every rowset.
+  //
+  // The result is conservative: false may be returned even though delta
+  // application could in fact be skipped (e.g. while a flush or compaction
+  // is in progress, or for delta files which haven't been opened yet).
+  bool CanSkipDeltaApplication(const MvccSnapshot& snap) const;
+
+  // Return true if any store tracked by this DeltaTracker may contain a
+  // mutation with a timestamp at or after 'ts'. Row insertions are covered
+  // as well: flushing turns each row's insertion into an UNDO DELETE
+  // carrying the insertion timestamp, so the UNDO stats span insertion
+  // times. Incremental ("diff") scans use this to cull rowsets with no
+  // activity in the time range of interest.
+  //
+  // The result is conservative: true is returned for stores whose stats
+  // haven't been loaded yet and while a flush or compaction is in progress.
+  bool MayHaveMutationsAtOrAfter(Timestamp ts) const;
+
   // Enum used for NewDeltaIterator() and CollectStores() below.
   // Determines whether all types of stores should be considered,
   // or just UNDO or REDO stores.
@@ -137,17 +162,41 @@ class DeltaTracker {
   // Sets *deleted to true if so; otherwise sets it to false.
   Status CheckRowDeleted(rowid_t row_idx, bool *deleted, ProbeStats* stats) const;
 
-  // Compacts all REDO delta files.
-  //
-  // TODO keep metadata in the delta stores to indicate whether or not
-  // a minor (or -- when implemented -- major) compaction is warranted
-  // and if so, compact the stores.
+  // Runs a minor compaction on the size tier of REDO delta files picked by
+  // PickRedoDeltaStoresForMinorCompaction(). A no-op if no worthwhile tier
+  // exists.
   Status Compact();
 
+  // Picks the range of consecutive REDO delta stores (inclusive on both ends)
+  // which should be merged by the next minor compaction. Starting from the
+  // newest store, older stores are added to the tier while each is no larger
+  // than --tablet_delta_store_minor_compact_size_ratio times the total size
+  // of the newer stores already picked. This keeps minor compaction from
+  // repeatedly rewriting the large output of a previous compaction: such a
+  // store is only merged again once a comparable volume of newer deltas has
+  // accumulated behind it.
+  //
+  // Returns the number of stores picked. If fewer than 2, there is nothing
+  // worth compacting and the output indexes are not set.
+  int PickRedoDeltaStoresForMinorCompaction(int* start_idx, int* end_idx) const;
+
+  // Estimate the fraction of the mutations in the REDO delta stores in
+  // positions [start_idx, end_idx] (inclusive) which fall in a row range
+  // also mutated by at least one other store in that set. Merging stores
+  // which mutated disjoint row ranges does not reduce the number of deltas
+  // applied to any given scanned row, so a low return value indicates a
+  // minor compaction of little benefit to scans.
+  //
+  // Returns 1.0 (full overlap) if any of the stores lacks a row histogram
+  // (e.g. it was written by an older version or is not yet initialized), or
+  // if the given range no longer refers to valid store indexes.
+  double EstimateRedoStoreRowOverlap(int start_idx, int end_idx) const;
+
   // Performs minor compaction on all REDO delta files between index
   // "start_idx" and "end_idx" (inclusive) and writes this to a
-  // new REDO delta block. If "end_idx" is set to -1, then delta files at
-  // all indexes starting with "start_idx" will be compacted.
+  // new REDO delta block. If "end_idx" is set to -1, then "start_idx" is
+  // ignored and the range is picked by
+  // PickRedoDeltaStoresForMinorCompaction().
   Status CompactStores(int start_idx, int end_idx);
 
   // Replace the subsequence of stores that matches 'stores_to_replace' with
@@ -181,15 +230,51 @@ class DeltaTracker {
   // Retrieves the list of column indexes that currently have updates.
   void GetColumnIdsWithUpdates(std::vector<ColumnId>* col_ids) const;
 
+  // Strict variant of the above, used for value-statistic pruning: retrieves
+  // the full set of column IDs which may be affected by any delta mutation
+  // (updates in any redo or undo store, or entries in the delta memstore).
+  //
+  // Returns false if the set cannot be cheaply and exactly determined --
+  // e.g. if a flush or compaction is in progress, a store's stats haven't
+  // been loaded yet, or some store contains reinserts (which can restore
+  // any column's prior value). Callers must treat a false return as "any
+  // column may be affected".
+  bool GetColumnIdsWithDeltas(std::unordered_set<int>* col_ids) const;
+
+  // Return true if any delta store in this tracker may contain mutations
+  // affecting 'col_id'. Conservative: returns true whenever the set of
+  // mutated columns cannot be cheaply and exactly determined.
+  bool MayHaveUpdatesForColumn(ColumnId col_id) const;
+
+  // Estimate the number of bytes in UNDO delta stores whose deltas are all
+  // older than 'ancient_history_mark', i.e. which DeleteAncientUndoDeltas()
+  // could delete. Stores whose maximum delta timestamp was not recorded in
+  // the rowset metadata are never considered ancient.
+  int64_t EstimateBytesInAncientUndoDeltas(Timestamp ancient_history_mark) const;
+
+  // Delete UNDO delta stores whose deltas are all older than
+  // 'ancient_history_mark'. Such stores can never be read by an allowed
+  // snapshot, so they are removed without being rewritten. On success,
+  // sets 'blocks_deleted' and 'bytes_deleted' to the number and total size
+  // of the removed stores (possibly zero).
+  //
+  // Acquires 'compact_flush_lock_', so this cannot run concurrently with a
+  // flush or compaction of this rowset.
+  Status DeleteAncientUndoDeltas(Timestamp ancient_history_mark,
+                                 int64_t* blocks_deleted,
+                                 int64_t* bytes_deleted);
+
   Mutex* compact_flush_lock() {
     return &compact_flush_lock_;
   }
 
  private:
   FRIEND_TEST(TestRowSet, TestRowSetUpdate);
+  FRIEND_TEST(TestRowSet, TestUpdateOverlay);
   FRIEND_TEST(TestRowSet, TestDMSFlush);
   FRIEND_TEST(TestRowSet, TestMakeDeltaIteratorMergerUnlocked);
   FRIEND_TEST(TestRowSet, TestCompactStores);
+  FRIEND_TEST(TestRowSet, TestSizeTieredMinorCompaction);
   FRIEND_TEST(TestMajorDeltaCompaction, TestCompact);
 
   DeltaTracker(std::shared_ptr<RowSetMetadata> rowset_metadata,
@@ -252,6 +337,12 @@ class DeltaTracker {
 
   // The current DeltaMemStore into which updates should be written.
   std::shared_ptr<DeltaMemStore> dms_;
+
+  // If --tablet_update_overlay is enabled, tracks the newest values of
+  // updated fixed-width columns so that scans can skip delta application.
+  // NULL otherwise. See UpdateOverlay. Unlike the DMS, the overlay is not
+  // swapped out by Flush(): it covers flushed REDO stores as well.
+  gscoped_ptr<UpdateOverlay> update_overlay_;
   // The set of tracked REDO delta stores, in increasing timestamp order.
   SharedDeltaStoreVector redo_delta_stores_;
   // The set of tracked UNDO delta stores, in decreasing timestamp order.
@@ -328,6 +328,75 @@ TEST_F(TestDeltaFile, TestSkipsDeltasOutOfRange) {
   iter.reset(raw_iter);
 }
 
+TEST_F(TestDeltaFile, TestSkipsRowsOutOfRange) {
+  WriteTestFile();
+  shared_ptr<DeltaFileReader> reader;
+  ASSERT_OK(OpenDeltaFileReader(test_block_, &reader));
+
+  // The persisted stats should reflect the range of updated rows.
+  ASSERT_EQ(FLAGS_first_row_to_update, reader->delta_stats().min_row_idx());
+  ASSERT_EQ(FLAGS_last_row_to_update, reader->delta_stats().max_row_idx());
+
+  // The persisted row histogram should account for every appended delta and
+  // only cover buckets within the updated range.
+  int64_t histogram_total = 0;
+  for (const auto& e : reader->delta_stats().mutation_counts_by_row_bucket()) {
+    ASSERT_GE(e.first, FLAGS_first_row_to_update / DeltaStats::kRowsPerHistogramBucket);
+    ASSERT_LE(e.first, FLAGS_last_row_to_update / DeltaStats::kRowsPerHistogramBucket);
+    histogram_total += e.second;
+  }
+  ASSERT_EQ(((FLAGS_last_row_to_update - FLAGS_first_row_to_update) / 2) + 1,
+            histogram_total);
+
+  gscoped_ptr<DeltaIterator> it;
+  ASSERT_OK(OpenDeltaFileIteratorFromReader(REDO, reader, &it));
+  ASSERT_OK(it->Init(nullptr));
+
+  // A batch entirely before the first updated row should be known to have
+  // no deltas.
+  ASSERT_OK(it->SeekToOrdinal(0));
+  ASSERT_OK(it->PrepareBatch(FLAGS_first_row_to_update,
+                             DeltaIterator::PREPARE_FOR_APPLY));
+  ASSERT_FALSE(it->MayHaveDeltas());
+
+  // Likewise a batch entirely after the last updated row.
+  ASSERT_OK(it->SeekToOrdinal(FLAGS_last_row_to_update + 1));
+  ASSERT_OK(it->PrepareBatch(100, DeltaIterator::PREPARE_FOR_APPLY));
+  ASSERT_FALSE(it->MayHaveDeltas());
+
+  // A batch overlapping the updated range should see deltas.
+  ASSERT_OK(it->SeekToOrdinal(FLAGS_first_row_to_update));
+  ASSERT_OK(it->PrepareBatch(100, DeltaIterator::PREPARE_FOR_APPLY));
+  ASSERT_TRUE(it->MayHaveDeltas());
+}
+
+TEST_F(TestDeltaFile, TestSkipsColumnsWithoutUpdates) {
+  WriteTestFile();
+  shared_ptr<DeltaFileReader> reader;
+  ASSERT_OK(OpenDeltaFileReader(test_block_, &reader));
+
+  // Project an extra column which the file has no updates for.
+  SchemaBuilder builder;
+  ASSERT_OK(builder.AddColumn("val", UINT32));
+  ASSERT_OK(builder.AddColumn("other_val", UINT32));
+  Schema projection = builder.Build();
+
+  DeltaIterator* raw_iter;
+  ASSERT_OK(reader->NewDeltaIterator(
+      &projection, MvccSnapshot::CreateSnapshotIncludingAllTransactions(), &raw_iter));
+  gscoped_ptr<DeltaIterator> it(raw_iter);
+  ASSERT_OK(it->Init(nullptr));
+
+  ASSERT_OK(it->SeekToOrdinal(FLAGS_first_row_to_update));
+  ASSERT_OK(it->PrepareBatch(100, DeltaIterator::PREPARE_FOR_APPLY));
+  ASSERT_TRUE(it->MayHaveDeltas());
+
+  // The file only contains updates to 'val': the per-column stats should
+  // prove that 'other_val' is untouched.
+  ASSERT_TRUE(it->MayHaveDeltasForColumn(0));
+  ASSERT_FALSE(it->MayHaveDeltasForColumn(1));
+}
+
 TEST_F(TestDeltaFile, TestLazyInit) {
   WriteTestFile();
 
@@ -18,6 +18,7 @@
 #include "kudu/tablet/deltafile.h"
 
 #include <arpa/inet.h>
+#include <algorithm>
 #include <memory>
 #include <string>
 
@@ -66,10 +67,12 @@ namespace {
 } // namespace
 
 DeltaFileWriter::DeltaFileWriter(gscoped_ptr<WritableBlock> block)
+ :
 #ifndef NDEBUG
- : has_appended_(false)
+   has_appended_(false),
 #endif
-{ // NOLINT(*)
+   min_row_idx_(MathLimits<rowid_t>::kMax),
+   max_row_idx_(0) { // NOLINT(*)
   cfile::WriterOptions opts;
   opts.write_validx = true;
   opts.storage_attributes.cfile_block_size = FLAGS_deltafile_default_block_size;
@@ -99,6 +102,10 @@ Status DeltaFileWriter::FinishAndReleaseBlock(ScopedWritableBlockCloser* closer)
 
 Status DeltaFileWriter::DoAppendDelta(const DeltaKey &key,
                                       const RowChangeList &delta) {
+  min_row_idx_ = std::min(min_row_idx_, key.row_idx());
+  max_row_idx_ = std::max(max_row_idx_, key.row_idx());
+  mutations_per_row_bucket_[key.row_idx() / DeltaStats::kRowsPerHistogramBucket]++;
+
   Slice delta_slice(delta.slice());
   tmp_buf_.clear();
 
@@ -153,6 +160,23 @@ void DeltaFileWriter::WriteDeltaStats(const DeltaStats& stats) {
   DeltaStatsPB delta_stats_pb;
   stats.ToPB(&delta_stats_pb);
 
+  // The writer itself tracks the range of row indexes which have been
+  // appended, so that the persisted range always matches the file contents
+  // regardless of how the caller accumulated 'stats'.
+  if (min_row_idx_ <= max_row_idx_) {
+    delta_stats_pb.set_min_row_idx(min_row_idx_);
+    delta_stats_pb.set_max_row_idx(max_row_idx_);
+  }
+  if (!mutations_per_row_bucket_.empty()) {
+    delta_stats_pb.clear_row_bucket_stats();
+    delta_stats_pb.set_rows_per_bucket(DeltaStats::kRowsPerHistogramBucket);
+    for (const auto& e : mutations_per_row_bucket_) {
+      DeltaStatsPB::RowBucketStats* bucket = delta_stats_pb.add_row_bucket_stats();
+      bucket->set_bucket(e.first);
+      bucket->set_mutation_count(e.second);
+    }
+  }
+
   faststring buf;
   pb_util::SerializeToString(delta_stats_pb, &buf);
   writer_->AddMetadataPair(DeltaFileReader::kDeltaStatsEntryName, buf.ToString());
@@ -200,7 +224,8 @@ Status DeltaFileReader::OpenNoInit(gscoped_ptr<ReadableBlock> block,
 DeltaFileReader::DeltaFileReader(gscoped_ptr<CFileReader> cf_reader,
                                  DeltaType delta_type)
     : reader_(cf_reader.release()),
-      delta_type_(delta_type) {}
+      delta_type_(delta_type),
+      has_max_timestamp_hint_(false) {}
 
 Status DeltaFileReader::Init() {
   return init_once_.Init(&DeltaFileReader::InitOnce, this);
@@ -239,8 +264,13 @@ Status DeltaFileReader::ReadDeltaStats() {
 
 bool DeltaFileReader::IsRelevantForSnapshot(const MvccSnapshot& snap) const {
   if (!init_once_.initted()) {
-    // If we're not initted, it means we have no delta stats and must
-    // assume that this file is relevant for every snapshot.
+    // If the rowset metadata recorded the maximum timestamp of this file's
+    // deltas, we can cull UNDO files without opening them at all.
+    if (delta_type_ == UNDO && has_max_timestamp_hint_) {
+      return snap.MayHaveUncommittedTransactionsAtOrBefore(max_timestamp_hint_);
+    }
+    // Otherwise we have no delta stats and must assume that this file is
+    // relevant for every snapshot.
     return true;
   }
   if (delta_type_ == REDO) {
@@ -416,7 +446,7 @@ Status DeltaFileIterator::ReadCurrentBlockOntoQueue() {
   unique_ptr<PreparedDeltaBlock> pdb(new PreparedDeltaBlock());
   BlockPointer dblk_ptr = index_iter_->GetCurrentBlockPointer();
   RETURN_NOT_OK(dfr_->cfile_reader()->ReadBlock(
-      dblk_ptr, cache_blocks_, &pdb->block_));
+      dblk_ptr, cache_blocks_, cfile::BlockCache::DATA_BLOCK, &pdb->block_));
 
   // The data has been successfully read. Finish creating the decoder.
   pdb->prepared_block_start_idx_ = 0;
@@ -481,6 +511,20 @@ Status DeltaFileIterator::PrepareBatch(size_t nrows, PrepareFlag flag) {
     delta_blocks_.pop_front();
   }
 
+  // If the file's stats indicate that it has no deltas for this row range,
+  // prepare an empty batch without consulting the index or reading any
+  // blocks. This makes scans cheap on tablets which carry many delta files
+  // covering disjoint row ranges.
+  const DeltaStats& stats = dfr_->delta_stats();
+  if (PREDICT_FALSE(stop_row < stats.min_row_idx() ||
+                    start_row > stats.max_row_idx())) {
+    DCHECK(delta_blocks_.empty());
+    prepared_idx_ = start_row;
+    prepared_count_ = nrows;
+    prepared_ = true;
+    return Status::OK();
+  }
+
   while (!exhausted_) {
     rowid_t next_block_rowidx;
     RETURN_NOT_OK(GetFirstRowIndexInCurrentBlock(&next_block_rowidx));
@@ -813,8 +857,6 @@ bool DeltaFileIterator::HasNext() {
 }
 
 bool DeltaFileIterator::MayHaveDeltas() {
-  // TODO: change the API to take in the col_to_apply and check for deltas on
-  // that column only.
   DCHECK(prepared_) << "must Prepare";
   for (auto& block : delta_blocks_) {
     BinaryPlainBlockDecoder& bpd = *block->decoder_;
@@ -828,6 +870,22 @@ bool DeltaFileIterator::MayHaveDeltas() {
   return false;
 }
 
+bool DeltaFileIterator::MayHaveDeltasForColumn(size_t col_to_apply) {
+  DCHECK(prepared_) << "must Prepare";
+  if (!MayHaveDeltas()) {
+    return false;
+  }
+  // Consult the per-column statistics in the file footer: if the file
+  // contains no updates to this column, nothing in the prepared blocks can
+  // modify it. Deletes and reinserts are counted conservatively since they
+  // affect entire rows rather than a single column.
+  const DeltaStats& stats = dfr_->delta_stats();
+  if (stats.delete_count() > 0 || stats.reinsert_count() > 0) {
+    return true;
+  }
+  return stats.update_count_for_col_id(projection_->column_id(col_to_apply)) > 0;
+}
+
 string DeltaFileIterator::ToString() const {
   return "DeltaFileIterator(" + dfr_->ToString() + ")";
 }
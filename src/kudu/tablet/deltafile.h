@@ -20,6 +20,7 @@
 #include <deque>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "kudu/cfile/block_handle.h"
@@ -91,6 +92,19 @@ class DeltaFileWriter {
   // of the deltas
   faststring tmp_buf_;
 
+  // The range of row indexes which have been appended to this writer.
+  // Tracked by the writer itself (rather than relying on the caller's
+  // DeltaStats) so that the range persisted by WriteDeltaStats() always
+  // matches the file contents. min > max indicates that nothing has been
+  // appended yet.
+  rowid_t min_row_idx_;
+  rowid_t max_row_idx_;
+
+  // Histogram of appended mutation counts keyed by row index bucket (see
+  // DeltaStats::kRowsPerHistogramBucket). Like the row range above, this is
+  // tracked by the writer itself and persisted by WriteDeltaStats().
+  std::unordered_map<uint32_t, int64_t> mutations_per_row_bucket_;
+
   #ifndef NDEBUG
   // The index of the previously written row.
   // This is used in debug mode to make sure that rows are appended
@@ -155,8 +169,21 @@ class DeltaFileReader : public DeltaStore,
   // Returns true if this delta file may include any deltas which need to be
   // applied when scanning the given snapshot, or if the file has not yet
   // been fully initialized.
+  //
+  // If the file has not been initialized but a max-timestamp hint was
+  // provided (see set_max_timestamp_hint()), UNDO files may be culled
+  // without incurring any I/O.
   bool IsRelevantForSnapshot(const MvccSnapshot& snap) const;
 
+  // Provide the maximum delta timestamp of this file, as recorded in the
+  // rowset metadata. This allows IsRelevantForSnapshot() to cull UNDO files
+  // before they have been initialized. Must be called before the reader is
+  // shared between threads.
+  void set_max_timestamp_hint(Timestamp max_timestamp) {
+    max_timestamp_hint_ = max_timestamp;
+    has_max_timestamp_hint_ = true;
+  }
+
  private:
   friend class DeltaFileIterator;
 
@@ -180,6 +207,12 @@ class DeltaFileReader : public DeltaStore,
   // The type of this delta, i.e. UNDO or REDO.
   const DeltaType delta_type_;
 
+  // The maximum delta timestamp recorded in the rowset metadata, if any.
+  // Only consulted before initialization; afterwards delta_stats_ is
+  // authoritative.
+  bool has_max_timestamp_hint_;
+  Timestamp max_timestamp_hint_;
+
   KuduOnceDynamic init_once_;
 };
 
@@ -202,6 +235,8 @@ class DeltaFileIterator : public DeltaIterator {
   virtual bool HasNext() OVERRIDE;
   bool MayHaveDeltas() override;
 
+  bool MayHaveDeltasForColumn(size_t col_to_apply) override;
+
  private:
   friend class DeltaFileReader;
   friend struct ApplyingVisitor<REDO>;
@@ -50,7 +50,7 @@ class TestDeltaMemStore : public KuduTest {
     : op_id_(consensus::MaximumOpId()),
       schema_(CreateSchema()),
       clock_(server::LogicalClock::CreateStartingAt(Timestamp::kInitialTimestamp)) {
-    CHECK_OK(DeltaMemStore::Create(0, 0,
+    CHECK_OK(DeltaMemStore::Create(0, 0, 1024,
                                    new log::LogAnchorRegistry(),
                                    MemTracker::GetRootTracker(), &dms_));
     CHECK_OK(dms_->Init());
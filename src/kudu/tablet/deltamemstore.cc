@@ -15,8 +15,11 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
 #include <utility>
 
+#include <gflags/gflags.h>
+
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/gutil/port.h"
 #include "kudu/tablet/deltafile.h"
@@ -24,10 +27,20 @@
 #include "kudu/tablet/delta_tracker.h"
 #include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/tablet.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/hexdump.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/status.h"
 
+DEFINE_int32(dms_shard_count, 4,
+             "Number of shards to split each delta memstore into. Each shard "
+             "covers a contiguous range of the rowset's row indexes and has "
+             "its own concurrent B-tree and arena, so that update-heavy "
+             "workloads spread across the row space don't serialize on a "
+             "single tree.");
+TAG_FLAG(dms_shard_count, advanced);
+TAG_FLAG(dms_shard_count, experimental);
+
 namespace kudu {
 namespace tablet {
 
@@ -44,10 +57,11 @@ static const int kMaxArenaBufferSize = 5*1024*1024;
 
 Status DeltaMemStore::Create(int64_t id,
                              int64_t rs_id,
+                             rowid_t num_rows,
                              LogAnchorRegistry* log_anchor_registry,
                              shared_ptr<MemTracker> parent_tracker,
                              shared_ptr<DeltaMemStore>* dms) {
-  shared_ptr<DeltaMemStore> local_dms(new DeltaMemStore(id, rs_id,
+  shared_ptr<DeltaMemStore> local_dms(new DeltaMemStore(id, rs_id, num_rows,
                                                         log_anchor_registry,
                                                         std::move(parent_tracker)));
 
@@ -55,20 +69,30 @@ Status DeltaMemStore::Create(int64_t id,
   return Status::OK();
 }
 
+DeltaMemStore::Shard::Shard(const shared_ptr<MemoryTrackingBufferAllocator>& allocator)
+  : arena(new ThreadSafeMemoryTrackingArena(
+        kInitialArenaSize, kMaxArenaBufferSize, allocator)),
+    tree(arena) {
+}
+
 DeltaMemStore::DeltaMemStore(int64_t id,
                              int64_t rs_id,
+                             rowid_t num_rows,
                              LogAnchorRegistry* log_anchor_registry,
                              shared_ptr<MemTracker> parent_tracker)
   : id_(id),
     rs_id_(rs_id),
     allocator_(new MemoryTrackingBufferAllocator(
         HeapBufferAllocator::Get(), std::move(parent_tracker))),
-    arena_(new ThreadSafeMemoryTrackingArena(
-        kInitialArenaSize, kMaxArenaBufferSize, allocator_)),
-    tree_(arena_),
     anchorer_(log_anchor_registry,
               Substitute("Rowset-$0/DeltaMemStore-$1", rs_id_, id_)),
     disambiguator_sequence_number_(0) {
+  int num_shards = std::max(1, FLAGS_dms_shard_count);
+  rows_per_shard_ = std::max<rowid_t>(
+      1, (num_rows + num_shards - 1) / num_shards);
+  for (int i = 0; i < num_shards; i++) {
+    shards_.emplace_back(new Shard(allocator_));
+  }
 }
 
 Status DeltaMemStore::Init() {
@@ -85,9 +109,11 @@ Status DeltaMemStore::Update(Timestamp timestamp,
 
   key.EncodeTo(&buf);
 
+  DMSTree* tree = &shards_[ShardOf(row_idx)]->tree;
+
   Slice key_slice(buf);
   btree::PreparedMutation<DMSTreeTraits> mutation(key_slice);
-  mutation.Prepare(&tree_);
+  mutation.Prepare(tree);
   if (PREDICT_FALSE(mutation.exists())) {
     // We already have a delta for this row at the same timestamp.
     // Try again with a disambiguating sequence number appended to the key.
@@ -95,7 +121,7 @@ Status DeltaMemStore::Update(Timestamp timestamp,
     PutMemcmpableVarint64(&buf, seq);
     key_slice = Slice(buf);
     mutation.Reset(key_slice);
-    mutation.Prepare(&tree_);
+    mutation.Prepare(tree);
     CHECK(!mutation.exists())
       << "Appended a sequence number but still hit a duplicate "
       << "for rowid " << row_idx << " at timestamp " << timestamp;
@@ -113,17 +139,21 @@ Status DeltaMemStore::FlushToFile(DeltaFileWriter *dfw,
                                   gscoped_ptr<DeltaStats>* stats_ret) {
   gscoped_ptr<DeltaStats> stats(new DeltaStats());
 
-  gscoped_ptr<DMSTreeIter> iter(tree_.NewIterator());
-  iter->SeekToStart();
-  while (iter->IsValid()) {
-    Slice key_slice, val;
-    iter->GetCurrentEntry(&key_slice, &val);
-    DeltaKey key;
-    RETURN_NOT_OK(key.DecodeFrom(&key_slice));
-    RowChangeList rcl(val);
-    RETURN_NOT_OK_PREPEND(dfw->AppendDelta<REDO>(key, rcl), "Failed to append delta");
-    stats->UpdateStats(key.timestamp(), rcl);
-    iter->Next();
+  // Since the shards cover contiguous, ordered ranges of row indexes,
+  // draining them in order yields the deltas in global key order.
+  for (const auto& shard : shards_) {
+    gscoped_ptr<DMSTreeIter> iter(shard->tree.NewIterator());
+    iter->SeekToStart();
+    while (iter->IsValid()) {
+      Slice key_slice, val;
+      iter->GetCurrentEntry(&key_slice, &val);
+      DeltaKey key;
+      RETURN_NOT_OK(key.DecodeFrom(&key_slice));
+      RowChangeList rcl(val);
+      RETURN_NOT_OK_PREPEND(dfw->AppendDelta<REDO>(key, rcl), "Failed to append delta");
+      stats->UpdateStats(key.timestamp(), rcl);
+      iter->Next();
+    }
   }
   dfw->WriteDeltaStats(*stats);
 
@@ -149,7 +179,7 @@ Status DeltaMemStore::CheckRowDeleted(rowid_t row_idx, bool *deleted) const {
   bool exact;
 
   // TODO(unknown): can we avoid the allocation here?
-  gscoped_ptr<DMSTreeIter> iter(tree_.NewIterator());
+  gscoped_ptr<DMSTreeIter> iter(shards_[ShardOf(row_idx)]->tree.NewIterator());
   if (!iter->SeekAtOrAfter(key_slice, &exact)) {
     return Status::OK();
   }
@@ -175,7 +205,9 @@ Status DeltaMemStore::CheckRowDeleted(rowid_t row_idx, bool *deleted) const {
 }
 
 void DeltaMemStore::DebugPrint() const {
-  tree_.DebugPrint();
+  for (const auto& shard : shards_) {
+    shard->tree.DebugPrint();
+  }
 }
 
 ////////////////////////////////////////////////////////////
@@ -186,13 +218,16 @@ DMSIterator::DMSIterator(const shared_ptr<const DeltaMemStore>& dms,
                          const Schema* projection, MvccSnapshot snapshot)
     : dms_(dms),
       mvcc_snapshot_(std::move(snapshot)),
-      iter_(dms->tree_.NewIterator()),
       initted_(false),
       prepared_idx_(0),
       prepared_count_(0),
       prepared_for_(NOT_PREPARED),
       seeked_(false),
-      projection_(projection) {}
+      projection_(projection) {
+  for (const auto& shard : dms->shards_) {
+    iters_.emplace_back(shard->tree.NewIterator());
+  }
+}
 
 Status DMSIterator::Init(ScanSpec *spec) {
   initted_ = true;
@@ -205,7 +240,9 @@ Status DMSIterator::SeekToOrdinal(rowid_t row_idx) {
   key.EncodeTo(&buf);
 
   bool exact; /* unused */
-  iter_->SeekAtOrAfter(Slice(buf), &exact);
+  for (const auto& iter : iters_) {
+    iter->SeekAtOrAfter(Slice(buf), &exact);
+  }
   prepared_idx_ = row_idx;
   prepared_count_ = 0;
   prepared_for_ = NOT_PREPARED;
@@ -239,69 +276,77 @@ Status DMSIterator::PrepareBatch(size_t nrows, PrepareFlag flag) {
   deleted_.clear();
   prepared_deltas_.clear();
 
-  while (iter_->IsValid()) {
-    Slice key_slice, val;
-    iter_->GetCurrentEntry(&key_slice, &val);
-    DeltaKey key;
-    RETURN_NOT_OK(key.DecodeFrom(&key_slice));
-    DCHECK_GE(key.row_idx(), start_row);
-    if (key.row_idx() > stop_row) break;
-
-    if (!mvcc_snapshot_.IsCommitted(key.timestamp())) {
-      // The transaction which applied this update is not yet committed
-      // in this iterator's MVCC snapshot. Hence, skip it.
-      iter_->Next();
-      continue;
-    }
-
-    if (flag == PREPARE_FOR_APPLY) {
-      RowChangeListDecoder decoder((RowChangeList(val)));
-      decoder.InitNoSafetyChecks();
-      DCHECK(!decoder.is_reinsert()) << "Reinserts are not supported in the DeltaMemStore.";
-      if (decoder.is_delete()) {
-        deleted_.push_back(key.row_idx());
-      } else {
-        DCHECK(decoder.is_update());
-        while (decoder.HasNext()) {
-          RowChangeListDecoder::DecodedUpdate dec;
-          RETURN_NOT_OK(decoder.DecodeNext(&dec));
-          int col_idx;
-          const void* col_val;
-          RETURN_NOT_OK(dec.Validate(*projection_, &col_idx, &col_val));
-          if (col_idx == -1) {
-            // This column isn't being projected.
-            continue;
-          }
-          int col_size = projection_->column(col_idx).type_info()->size();
-
-          // If we already have an earlier update for the same column, we can
-          // just overwrite that one.
-          if (updates_by_col_[col_idx].empty() ||
-              updates_by_col_[col_idx].back().row_id != key.row_idx()) {
-            updates_by_col_[col_idx].push_back(ColumnUpdate());
-          }
+  // Drain the iterators of the shards overlapping this batch's row range,
+  // in shard order. The shards cover contiguous, ordered row ranges, so
+  // this visits the deltas in global key order; only the last overlapping
+  // shard can contain entries past 'stop_row'.
+  size_t stop_shard = dms_->ShardOf(stop_row);
+  for (size_t s = dms_->ShardOf(start_row); s <= stop_shard; s++) {
+    DeltaMemStore::DMSTreeIter* iter = iters_[s].get();
+    while (iter->IsValid()) {
+      Slice key_slice, val;
+      iter->GetCurrentEntry(&key_slice, &val);
+      DeltaKey key;
+      RETURN_NOT_OK(key.DecodeFrom(&key_slice));
+      DCHECK_GE(key.row_idx(), start_row);
+      if (key.row_idx() > stop_row) break;
+
+      if (!mvcc_snapshot_.IsCommitted(key.timestamp())) {
+        // The transaction which applied this update is not yet committed
+        // in this iterator's MVCC snapshot. Hence, skip it.
+        iter->Next();
+        continue;
+      }
 
-          ColumnUpdate& cu = updates_by_col_[col_idx].back();
-          cu.row_id = key.row_idx();
-          if (col_val == nullptr) {
-            cu.new_val_ptr = nullptr;
-          } else {
-            memcpy(cu.new_val_buf, col_val, col_size);
-            // NOTE: we're constructing a pointer here to an element inside the deque.
-            // This is safe because deques never invalidate pointers to their elements.
-            cu.new_val_ptr = cu.new_val_buf;
+      if (flag == PREPARE_FOR_APPLY) {
+        RowChangeListDecoder decoder((RowChangeList(val)));
+        decoder.InitNoSafetyChecks();
+        DCHECK(!decoder.is_reinsert()) << "Reinserts are not supported in the DeltaMemStore.";
+        if (decoder.is_delete()) {
+          deleted_.push_back(key.row_idx());
+        } else {
+          DCHECK(decoder.is_update());
+          while (decoder.HasNext()) {
+            RowChangeListDecoder::DecodedUpdate dec;
+            RETURN_NOT_OK(decoder.DecodeNext(&dec));
+            int col_idx;
+            const void* col_val;
+            RETURN_NOT_OK(dec.Validate(*projection_, &col_idx, &col_val));
+            if (col_idx == -1) {
+              // This column isn't being projected.
+              continue;
+            }
+            int col_size = projection_->column(col_idx).type_info()->size();
+
+            // If we already have an earlier update for the same column, we can
+            // just overwrite that one.
+            if (updates_by_col_[col_idx].empty() ||
+                updates_by_col_[col_idx].back().row_id != key.row_idx()) {
+              updates_by_col_[col_idx].push_back(ColumnUpdate());
+            }
+
+            ColumnUpdate& cu = updates_by_col_[col_idx].back();
+            cu.row_id = key.row_idx();
+            if (col_val == nullptr) {
+              cu.new_val_ptr = nullptr;
+            } else {
+              memcpy(cu.new_val_buf, col_val, col_size);
+              // NOTE: we're constructing a pointer here to an element inside the deque.
+              // This is safe because deques never invalidate pointers to their elements.
+              cu.new_val_ptr = cu.new_val_buf;
+            }
           }
         }
+      } else {
+        DCHECK_EQ(flag, PREPARE_FOR_COLLECT);
+        PreparedDelta d;
+        d.key = key;
+        d.val = val;
+        prepared_deltas_.push_back(d);
       }
-    } else {
-      DCHECK_EQ(flag, PREPARE_FOR_COLLECT);
-      PreparedDelta d;
-      d.key = key;
-      d.val = val;
-      prepared_deltas_.push_back(d);
-    }
 
-    iter_->Next();
+      iter->Next();
+    }
   }
   prepared_idx_ = start_row;
   prepared_count_ = nrows;
@@ -378,6 +423,15 @@ bool DMSIterator::MayHaveDeltas() {
   return false;
 }
 
+bool DMSIterator::MayHaveDeltasForColumn(size_t col_to_apply) {
+  // Deletes are counted conservatively since they affect entire rows.
+  if (!deleted_.empty()) {
+    return true;
+  }
+  DCHECK_LT(col_to_apply, updates_by_col_.size());
+  return !updates_by_col_[col_to_apply].empty();
+}
+
 string DMSIterator::ToString() const {
   return "DMSIterator";
 }
@@ -61,7 +61,11 @@ struct DMSTreeTraits : public btree::BTreeTraits {
 class DeltaMemStore : public DeltaStore,
                       public std::enable_shared_from_this<DeltaMemStore> {
  public:
+  // 'num_rows' is the number of rows in the rowset which this DMS belongs
+  // to; it determines how the row index space is divided among the internal
+  // shards (see --dms_shard_count).
   static Status Create(int64_t id, int64_t rs_id,
+                       rowid_t num_rows,
                        log::LogAnchorRegistry* log_anchor_registry,
                        std::shared_ptr<MemTracker> parent_tracker,
                        std::shared_ptr<DeltaMemStore>* dms);
@@ -80,11 +84,20 @@ class DeltaMemStore : public DeltaStore,
                 const consensus::OpId& op_id);
 
   size_t Count() const {
-    return tree_.count();
+    size_t count = 0;
+    for (const auto& shard : shards_) {
+      count += shard->tree.count();
+    }
+    return count;
   }
 
   bool Empty() const {
-    return tree_.empty();
+    for (const auto& shard : shards_) {
+      if (!shard->tree.empty()) {
+        return false;
+      }
+    }
+    return true;
   }
 
   // Dump a debug version of the tree to the logs. This is not thread-safe, so
@@ -114,7 +127,11 @@ class DeltaMemStore : public DeltaStore,
   virtual Status CheckRowDeleted(rowid_t row_idx, bool *deleted) const OVERRIDE;
 
   virtual uint64_t EstimateSize() const OVERRIDE {
-    return arena_->memory_footprint();
+    uint64_t size = 0;
+    for (const auto& shard : shards_) {
+      size += shard->arena->memory_footprint();
+    }
+    return size;
   }
 
   const int64_t id() const { return id_; }
@@ -139,13 +156,30 @@ class DeltaMemStore : public DeltaStore,
  private:
   friend class DMSIterator;
 
+  // A shard of the delta memstore: a concurrent B-tree covering a
+  // contiguous range of row indexes, backed by its own arena. Sharding
+  // spreads mutations of different rows across independent trees so that
+  // concurrent writers don't contend on a single tree.
+  struct Shard {
+    explicit Shard(const std::shared_ptr<MemoryTrackingBufferAllocator>& allocator);
+
+    std::shared_ptr<ThreadSafeMemoryTrackingArena> arena;
+
+    // Concurrent B-Tree storing <key index> -> RowChangeList
+    DMSTree tree;
+  };
+
   DeltaMemStore(int64_t id,
                 int64_t rs_id,
+                rowid_t num_rows,
                 log::LogAnchorRegistry* log_anchor_registry,
                 std::shared_ptr<MemTracker> parent_tracker);
 
-  const DMSTree& tree() const {
-    return tree_;
+  // Return the index of the shard covering 'row_idx'. Row indexes past the
+  // end of the rowset clamp to the last shard.
+  size_t ShardOf(rowid_t row_idx) const {
+    size_t s = row_idx / rows_per_shard_;
+    return s < shards_.size() ? s : shards_.size() - 1;
   }
 
   const int64_t id_;    // DeltaMemStore ID.
@@ -153,10 +187,12 @@ class DeltaMemStore : public DeltaStore,
 
   std::shared_ptr<MemoryTrackingBufferAllocator> allocator_;
 
-  std::shared_ptr<ThreadSafeMemoryTrackingArena> arena_;
+  // Number of rows covered by each shard. The last shard additionally
+  // covers any remainder of the row index space.
+  rowid_t rows_per_shard_;
 
-  // Concurrent B-Tree storing <key index> -> RowChangeList
-  DMSTree tree_;
+  // The shards, ordered by the row index ranges they cover.
+  std::vector<std::unique_ptr<Shard>> shards_;
 
   log::MinLogIndexAnchorer anchorer_;
 
@@ -206,6 +242,8 @@ class DMSIterator : public DeltaIterator {
 
   bool MayHaveDeltas() override;
 
+  bool MayHaveDeltasForColumn(size_t col_to_apply) override;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(DMSIterator);
   FRIEND_TEST(TestDeltaMemStore, TestIteratorDoesUpdates);
@@ -224,7 +262,11 @@ class DMSIterator : public DeltaIterator {
   // MVCC state which allows us to ignore uncommitted transactions.
   const MvccSnapshot mvcc_snapshot_;
 
-  gscoped_ptr<DeltaMemStore::DMSTreeIter> iter_;
+  // One iterator per DMS shard, in shard (i.e. row index) order. Each
+  // batch is prepared by draining the iterators of the shards overlapping
+  // the batch's row range; since the shards cover contiguous, ordered row
+  // ranges, this visits the deltas in global key order.
+  std::vector<std::unique_ptr<DeltaMemStore::DMSTreeIter>> iters_;
 
   bool initted_;
 
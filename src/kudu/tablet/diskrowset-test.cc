@@ -38,6 +38,8 @@ DECLARE_bool(cfile_lazy_open);
 DECLARE_int32(cfile_default_block_size);
 DECLARE_double(tablet_delta_store_major_compact_min_ratio);
 DECLARE_int32(tablet_delta_store_minor_compact_max);
+DECLARE_double(tablet_delta_store_minor_compact_size_ratio);
+DECLARE_bool(tablet_update_overlay);
 
 using std::is_sorted;
 using std::shared_ptr;
@@ -165,6 +167,52 @@ TEST_F(TestRowSet, TestRowSetUpdate) {
   VerifyUpdates(*rs, updated);
 }
 
+// Test that scans return correct results when the update overlay is
+// enabled, both from the overlay fast path and from the delta-application
+// fallback used by older snapshots.
+TEST_F(TestRowSet, TestUpdateOverlay) {
+  FLAGS_tablet_update_overlay = true;
+  WriteTestRowSet(100);
+
+  shared_ptr<DiskRowSet> rs;
+  ASSERT_OK(OpenTestRowSet(&rs));
+
+  MvccSnapshot snap_before_update(mvcc_);
+  OperationResultPB result;
+  ASSERT_OK(UpdateRow(rs.get(), 50, 12345, &result));
+  ASSERT_GT(rs->delta_tracker_->update_overlay_->memory_footprint(), 0);
+
+  for (int i = 0; i < 2; i++) {
+    // A current scan should see the new value, both while the update sits
+    // in the DMS and after it has been flushed to a REDO delta file --
+    // the overlay covers flushed deltas as well.
+    VerifyRandomRead(*rs, "hello 000000000000050",
+                     R"((string key="hello 000000000000050", uint32 val=12345))");
+    NO_FATALS();
+
+    // A snapshot from before the update doesn't include the overlay's
+    // newest mutation, so the scan falls back to delta application and
+    // sees the original value.
+    vector<string> rows;
+    ASSERT_OK(DumpRowSet(*rs, schema_, snap_before_update, &rows));
+    ASSERT_EQ(100, rows.size());
+    EXPECT_EQ(R"((string key="hello 000000000000050", uint32 val=50))", rows[50]);
+
+    if (i == 0) {
+      ASSERT_OK(rs->FlushDeltas());
+    }
+  }
+
+  // A rowset opened with pre-existing REDO files disables its overlay,
+  // since those files contain mutations the overlay never saw. Reads
+  // still return correct results through delta application.
+  shared_ptr<DiskRowSet> reopened;
+  ASSERT_OK(OpenTestRowSet(&reopened));
+  VerifyRandomRead(*reopened, "hello 000000000000050",
+                   R"((string key="hello 000000000000050", uint32 val=12345))");
+  NO_FATALS();
+}
+
 TEST_F(TestRowSet, TestRandomRead) {
   // Write 100 rows.
   WriteTestRowSet(100);
@@ -255,6 +303,31 @@ TEST_F(TestRowSet, TestDelete) {
 }
 
 
+TEST_F(TestRowSet, TestMayHaveMutationsAtOrAfter) {
+  WriteTestRowSet();
+
+  shared_ptr<DiskRowSet> rs;
+  ASSERT_OK(OpenTestRowSet(&rs));
+
+  // A rowset with no delta stores has no mutations in any time range.
+  ASSERT_FALSE(rs->MayHaveMutationsAtOrAfter(Timestamp::kInitialTimestamp));
+
+  // Updates sitting in the DMS are always considered in-range.
+  unordered_set<uint32_t> updated;
+  UpdateExistingRows(rs.get(), FLAGS_update_fraction, &updated);
+  ASSERT_TRUE(rs->MayHaveMutationsAtOrAfter(Timestamp::kInitialTimestamp));
+
+  // Once flushed, the delta file's stats bound the answer: the updates are
+  // in-range for a bound at or before them, but not for a bound after the
+  // last update. Read the updates back first so that the flushed delta
+  // file's stats are loaded; an unopened file is conservatively in-range.
+  ASSERT_OK(rs->FlushDeltas());
+  Timestamp after_updates = clock_->Now();
+  VerifyUpdates(*rs, updated);
+  ASSERT_TRUE(rs->MayHaveMutationsAtOrAfter(Timestamp::kInitialTimestamp));
+  ASSERT_FALSE(rs->MayHaveMutationsAtOrAfter(after_updates));
+}
+
 TEST_F(TestRowSet, TestDMSFlush) {
   WriteTestRowSet();
 
@@ -535,5 +608,48 @@ TEST_F(TestRowSet, TestCompactStores) {
   ASSERT_TRUE(is_sorted(results.begin(), results.end()));
 }
 
+TEST_F(TestRowSet, TestSizeTieredMinorCompaction) {
+  FLAGS_cfile_lazy_open = false;
+
+  WriteTestRowSet();
+  shared_ptr<DiskRowSet> rs;
+  ASSERT_OK(OpenTestRowSet(&rs));
+
+  // Write three similarly-sized delta files.
+  for (int i = 0; i < 3; i++) {
+    UpdateExistingRows(rs.get(), FLAGS_update_fraction, nullptr);
+    ASSERT_OK(rs->FlushDeltas());
+  }
+
+  // With a size ratio below 1, similarly-sized stores don't form a tier, so
+  // minor compaction should neither score nor do anything.
+  DeltaTracker *dt = rs->delta_tracker();
+  FLAGS_tablet_delta_store_minor_compact_size_ratio = 0.01;
+  int start_idx, end_idx;
+  ASSERT_EQ(0, dt->PickRedoDeltaStoresForMinorCompaction(&start_idx, &end_idx));
+  ASSERT_EQ(0, rs->DeltaStoresCompactionPerfImprovementScore(RowSet::MINOR_DELTA_COMPACTION));
+  ASSERT_OK(rs->MinorCompactDeltaStores());
+  ASSERT_EQ(3, dt->redo_delta_stores_.size());
+
+  // With the default ratio, all three stores form a single tier and get
+  // merged into one file.
+  FLAGS_tablet_delta_store_minor_compact_size_ratio = 10;
+  ASSERT_EQ(3, dt->PickRedoDeltaStoresForMinorCompaction(&start_idx, &end_idx));
+  ASSERT_EQ(0, start_idx);
+  ASSERT_EQ(2, end_idx);
+  ASSERT_OK(rs->MinorCompactDeltaStores());
+  ASSERT_EQ(1, dt->redo_delta_stores_.size());
+
+  // A single new delta file after the compacted one isn't worth merging into
+  // it at a low ratio: the picker should refuse to rewrite the large store
+  // for it.
+  UpdateExistingRows(rs.get(), FLAGS_update_fraction, nullptr);
+  ASSERT_OK(rs->FlushDeltas());
+  FLAGS_tablet_delta_store_minor_compact_size_ratio = 0.01;
+  ASSERT_EQ(0, dt->PickRedoDeltaStoresForMinorCompaction(&start_idx, &end_idx));
+  ASSERT_OK(rs->MinorCompactDeltaStores());
+  ASSERT_EQ(2, dt->redo_delta_stores_.size());
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -18,6 +18,7 @@
 #include <algorithm>
 #include <glog/logging.h>
 #include <mutex>
+#include <unordered_set>
 #include <vector>
 
 #include "kudu/cfile/bloomfile.h"
@@ -34,6 +35,7 @@
 #include "kudu/tablet/delta_compaction.h"
 #include "kudu/tablet/delta_store.h"
 #include "kudu/tablet/diskrowset.h"
+#include "kudu/tablet/maintenance_io_throttle.h"
 #include "kudu/tablet/multi_column_writer.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/flag_tags.h"
@@ -85,6 +87,7 @@ Status DiskRowSetWriter::Open() {
 
   FsManager* fs = rowset_metadata_->fs_manager();
   col_writer_.reset(new MultiColumnWriter(fs, schema_));
+  col_writer_->SetSkippedColumns(skipped_col_ids_);
   RETURN_NOT_OK(col_writer_->Open());
 
   // Open bloom filter.
@@ -151,17 +154,21 @@ Status DiskRowSetWriter::AppendBlock(const RowBlock &block) {
   DCHECK_EQ(block.schema().num_columns(), schema_->num_columns());
   CHECK(!finished_);
 
+  bool first_block = written_count_ == 0;
+
+  // Write the batch to each of the columns. This must happen before touching
+  // key_index_writer() below: the column writers may not be created until the
+  // first block is appended (see MultiColumnWriter::Open()).
+  RETURN_NOT_OK(col_writer_->AppendBlock(block));
+
   // If this is the very first block, encode the first key and save it as metadata
   // in the index column.
-  if (written_count_ == 0) {
+  if (first_block) {
     Slice enc_key = schema_->EncodeComparableKey(block.row(0), &last_encoded_key_);
     key_index_writer()->AddMetadataPair(DiskRowSet::kMinKeyMetaEntryName, enc_key);
     last_encoded_key_.clear();
   }
 
-  // Write the batch to each of the columns
-  RETURN_NOT_OK(col_writer_->AppendBlock(block));
-
 #ifndef NDEBUG
     faststring prev_key;
 #endif
@@ -282,12 +289,15 @@ RollingDiskRowSetWriter::RollingDiskRowSetWriter(
     : state_(kInitialized),
       tablet_metadata_(DCHECK_NOTNULL(tablet_metadata)),
       schema_(schema),
+      next_roll_boundary_(0),
       bloom_sizing_(std::move(bloom_sizing)),
       target_rowset_size_(target_rowset_size),
       row_idx_in_cur_drs_(0),
       can_roll_(false),
       written_count_(0),
-      written_size_(0) {
+      written_size_(0),
+      io_throttle_(nullptr),
+      last_throttled_size_(0) {
   CHECK(schema.has_column_ids());
 }
 
@@ -308,6 +318,7 @@ Status RollingDiskRowSetWriter::RollWriter() {
   RETURN_NOT_OK(tablet_metadata_->CreateRowSet(&cur_drs_metadata_, schema_));
 
   cur_writer_.reset(new DiskRowSetWriter(cur_drs_metadata_.get(), &schema_, bloom_sizing_));
+  cur_writer_->SetSkippedColumns(skipped_col_ids_);
   RETURN_NOT_OK(cur_writer_->Open());
 
   FsManager* fs = tablet_metadata_->fs_manager();
@@ -331,12 +342,34 @@ Status RollingDiskRowSetWriter::RollWriter() {
 
 Status RollingDiskRowSetWriter::RollIfNecessary() {
   DCHECK_EQ(state_, kStarted);
-  if (can_roll_ && cur_writer_->written_size() > target_rowset_size_) {
+  if (can_roll_ &&
+      (cur_writer_->written_size() > target_rowset_size_ || CrossedRollBoundary())) {
     RETURN_NOT_OK(RollWriter());
   }
   return Status::OK();
 }
 
+bool RollingDiskRowSetWriter::CrossedRollBoundary() {
+  if (next_roll_boundary_ == roll_boundaries_.size()) {
+    return false;
+  }
+  const faststring& last_key = cur_writer_->last_encoded_key();
+  if (last_key.size() == 0) {
+    return false;
+  }
+  Slice last(last_key);
+  if (last.compare(Slice(roll_boundaries_[next_roll_boundary_])) < 0) {
+    return false;
+  }
+  // Skip any further boundaries which the last key has also reached, so that
+  // a key range left empty by the input doesn't produce an empty rowset.
+  do {
+    next_roll_boundary_++;
+  } while (next_roll_boundary_ < roll_boundaries_.size() &&
+           last.compare(Slice(roll_boundaries_[next_roll_boundary_])) >= 0);
+  return true;
+}
+
 Status RollingDiskRowSetWriter::AppendBlock(const RowBlock &block) {
   DCHECK_EQ(state_, kStarted);
   RETURN_NOT_OK(cur_writer_->AppendBlock(block));
@@ -345,6 +378,17 @@ Status RollingDiskRowSetWriter::AppendBlock(const RowBlock &block) {
 
   row_idx_in_cur_drs_ += block.nrows();
   can_roll_ = true;
+
+  if (io_throttle_) {
+    // Pay for the bytes produced since the last block. This throttles after
+    // the write rather than before it, which keeps the accounting exact
+    // while still smoothing the overall rate.
+    uint64_t total = written_size_ + cur_writer_->written_size();
+    if (total > last_throttled_size_) {
+      io_throttle_->AcquireBytes(total - last_throttled_size_);
+      last_throttled_size_ = total;
+    }
+  }
   return Status::OK();
 }
 
@@ -409,7 +453,9 @@ Status RollingDiskRowSetWriter::FinishCurrentWriter() {
     Status s = cur_undo_writer_->FinishAndReleaseBlock(&block_closer_);
     if (!s.IsAborted()) {
       RETURN_NOT_OK(s);
-      cur_drs_metadata_->CommitUndoDeltaDataBlock(cur_undo_ds_block_id_);
+      cur_drs_metadata_->CommitUndoDeltaDataBlock(
+          cur_undo_ds_block_id_,
+          cur_undo_delta_stats->max_timestamp().ToUint64());
     } else {
       DCHECK_EQ(cur_undo_delta_stats->min_timestamp(), Timestamp::kMax);
     }
@@ -587,6 +633,23 @@ Status DiskRowSet::NewRowIterator(const Schema *projection,
   shared_lock<rw_spinlock> l(component_lock_.get_lock());
 
   shared_ptr<CFileSet::Iterator> base_iter(base_data_->NewIterator(projection));
+
+  // If we can prove exactly which columns have delta mutations, enable
+  // value-statistic pruning on the base data iterator for the others.
+  std::unordered_set<int> cols_with_deltas;
+  if (delta_tracker_->GetColumnIdsWithDeltas(&cols_with_deltas)) {
+    base_iter->SetColumnsWithDeltas(std::move(cols_with_deltas));
+  }
+
+  // If no delta store holds a mutation relevant to this snapshot (and none
+  // can become relevant), stream the base data directly rather than wrapping
+  // it in a DeltaApplier. Whole-tablet snapshot scans of rarely-updated data
+  // -- e.g. backup/export scans -- commonly hit this path on every rowset.
+  if (delta_tracker_->CanSkipDeltaApplication(mvcc_snap)) {
+    out->reset(new MaterializingIterator(base_iter));
+    return Status::OK();
+  }
+
   gscoped_ptr<ColumnwiseIterator> col_iter;
   RETURN_NOT_OK(delta_tracker_->WrapIterator(base_iter, mvcc_snap, &col_iter));
 
@@ -678,6 +741,49 @@ uint64_t DiskRowSet::EstimateOnDiskSize() const {
   return base_data_->EstimateOnDiskSize() + delta_tracker_->EstimateOnDiskSize();
 }
 
+Status DiskRowSet::EstimateRowsAndBytesInRange(const EncodedKey* start_key,
+                                               const EncodedKey* stop_key,
+                                               uint64_t* row_count,
+                                               uint64_t* bytes) const {
+  DCHECK(open_);
+  shared_lock<rw_spinlock> l(component_lock_.get_lock());
+
+  rowid_t total;
+  RETURN_NOT_OK(base_data_->CountRows(&total));
+  rowid_t in_range;
+  RETURN_NOT_OK(base_data_->EstimateRowCountInRange(start_key, stop_key, &in_range));
+  *row_count = in_range;
+
+  uint64_t size = base_data_->EstimateOnDiskSize() + delta_tracker_->EstimateOnDiskSize();
+  *bytes = total > 0 ? size * in_range / total : 0;
+  return Status::OK();
+}
+
+bool DiskRowSet::MayHaveDataForColumn(ColumnId col_id) const {
+  DCHECK(open_);
+  shared_lock<rw_spinlock> l(component_lock_.get_lock());
+  return base_data_->has_data_for_column_id(col_id) ||
+         delta_tracker_->MayHaveUpdatesForColumn(col_id);
+}
+
+bool DiskRowSet::MayHaveMutationsAtOrAfter(Timestamp ts) const {
+  DCHECK(open_);
+  return delta_tracker_->MayHaveMutationsAtOrAfter(ts);
+}
+
+int64_t DiskRowSet::EstimateBytesInAncientUndoDeltas(Timestamp ancient_history_mark) const {
+  DCHECK(open_);
+  return delta_tracker_->EstimateBytesInAncientUndoDeltas(ancient_history_mark);
+}
+
+Status DiskRowSet::DeleteAncientUndoDeltas(Timestamp ancient_history_mark,
+                                           int64_t* blocks_deleted,
+                                           int64_t* bytes_deleted) {
+  DCHECK(open_);
+  return delta_tracker_->DeleteAncientUndoDeltas(ancient_history_mark,
+                                                 blocks_deleted, bytes_deleted);
+}
+
 size_t DiskRowSet::DeltaMemStoreSize() const {
   DCHECK(open_);
   return delta_tracker_->DeltaMemStoreSize();
@@ -706,10 +812,14 @@ size_t DiskRowSet::CountDeltaStores() const {
 //                       it is smaller than tablet_delta_store_major_compact_min_ratio or if the
 //                       delta files are only composed of deletes, in which case the score is
 //                       brought down to zero.
-//  - Minor compactions: the score will be zero if there's only 1 redo file, else it will be the
-//                       result of redo_files_count/tablet_delta_store_minor_compact_max. The
+//  - Minor compactions: the score will be zero if the size-tiered policy doesn't find at least
+//                       2 redo files worth merging, else it will be the result of
+//                       compactable_redo_files_count/tablet_delta_store_minor_compact_max. The
 //                       latter is meant to be high since minor compactions don't give us much, so
-//                       we only consider it a gain if it gets rid of many tiny files.
+//                       we only consider it a gain if it gets rid of many tiny files. The result
+//                       is further weighted by how much the picked files' mutations overlap in
+//                       row space, so that rowsets whose hot rows are fragmented across many
+//                       files are compacted ahead of those with disjoint, cold delta files.
 double DiskRowSet::DeltaStoresCompactionPerfImprovementScore(DeltaCompactionType type) const {
   DCHECK(open_);
   double perf_improv = 0;
@@ -732,7 +842,20 @@ double DiskRowSet::DeltaStoresCompactionPerfImprovementScore(DeltaCompactionType
     }
   } else if (type == RowSet::MINOR_DELTA_COMPACTION) {
     if (store_count > 1) {
-      perf_improv = static_cast<double>(store_count) / FLAGS_tablet_delta_store_minor_compact_max;
+      int start_idx, end_idx;
+      int num_compactable =
+          delta_tracker_->PickRedoDeltaStoresForMinorCompaction(&start_idx, &end_idx);
+      perf_improv =
+          static_cast<double>(num_compactable) / FLAGS_tablet_delta_store_minor_compact_max;
+      if (num_compactable > 1) {
+        // Weight the score by how much the picked stores' mutations overlap in
+        // row space. When updates cluster on a hot range of rows, the rowsets
+        // whose delta files repeatedly hit that range fragment scan-time delta
+        // application the most, while stores which mutated disjoint ranges
+        // gain little from being merged. Stores without a row histogram are
+        // assumed to fully overlap, preserving the pre-histogram score.
+        perf_improv *= 0.2 + 0.8 * delta_tracker_->EstimateRedoStoreRowOverlap(start_idx, end_idx);
+      }
     }
   } else {
     LOG(FATAL) << "Unknown delta compaction type " << type;
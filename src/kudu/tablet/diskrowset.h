@@ -25,6 +25,7 @@
 #include <gtest/gtest_prod.h>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -64,6 +65,7 @@ class DeltaFileWriter;
 class DeltaStats;
 class DeltaTracker;
 class HistoryGcOpts;
+class MaintenanceIoThrottle;
 class MultiColumnWriter;
 class Mutation;
 class OperationResultPB;
@@ -76,6 +78,13 @@ class DiskRowSetWriter {
 
   ~DiskRowSetWriter();
 
+  // Skip writing cfiles for the given non-key columns, leaving them sparse
+  // in the output rowset; see MultiColumnWriter::SetSkippedColumns().
+  // Must be called before Open().
+  void SetSkippedColumns(std::set<ColumnId> col_ids) {
+    skipped_col_ids_ = std::move(col_ids);
+  }
+
   Status Open();
 
   // The block is written to all column writers as well as the bloom filter,
@@ -105,6 +114,10 @@ class DiskRowSetWriter {
   // a reasonable estimate for the total data size.
   size_t written_size() const;
 
+  // Return the encoded key of the last row appended, or an empty faststring
+  // if no rows have been appended yet.
+  const faststring& last_encoded_key() const { return last_encoded_key_; }
+
   const Schema& schema() const { return *schema_; }
 
  private:
@@ -125,6 +138,9 @@ class DiskRowSetWriter {
 
   BloomFilterSizing bloom_sizing_;
 
+  // Column IDs to leave sparse; see SetSkippedColumns().
+  std::set<ColumnId> skipped_col_ids_;
+
   bool finished_;
   rowid_t written_count_;
   gscoped_ptr<MultiColumnWriter> col_writer_;
@@ -151,6 +167,22 @@ class RollingDiskRowSetWriter {
                           size_t target_rowset_size);
   ~RollingDiskRowSetWriter();
 
+  // Skip writing cfiles for the given non-key columns in every rowset this
+  // writer produces; see DiskRowSetWriter::SetSkippedColumns().
+  // Must be called before Open().
+  void SetSkippedColumns(std::set<ColumnId> col_ids) {
+    skipped_col_ids_ = std::move(col_ids);
+  }
+
+  // Set encoded key boundaries at which the output must roll to a new rowset,
+  // in addition to the size-based rolls. 'boundaries' must be sorted in
+  // ascending order. The writer rolls after the first block whose last row's
+  // key reaches a boundary, so the output rowsets on either side of a boundary
+  // cover disjoint key ranges. Must be called before appending any rows.
+  void SetRollBoundaries(std::vector<std::string> boundaries) {
+    roll_boundaries_ = std::move(boundaries);
+  }
+
   Status Open();
 
   // The block is written to all column writers as well as the bloom filter,
@@ -198,9 +230,20 @@ class RollingDiskRowSetWriter {
 
   uint64_t written_size() const { return written_size_; }
 
+  // Set a throttle from which byte tokens are acquired as data is appended.
+  // May be NULL (the default) to disable throttling. The throttle must
+  // outlive this writer.
+  void SetIoThrottle(MaintenanceIoThrottle* io_throttle) {
+    io_throttle_ = io_throttle;
+  }
+
  private:
   Status RollWriter();
 
+  // Return true if the last appended row's key has reached the next entry in
+  // 'roll_boundaries_', advancing past all boundaries it has reached.
+  bool CrossedRollBoundary();
+
   // Close the current DRS and delta writers, releasing their finished blocks
   // into block_closer_.
   Status FinishCurrentWriter();
@@ -221,6 +264,16 @@ class RollingDiskRowSetWriter {
 
   TabletMetadata* tablet_metadata_;
   const Schema schema_;
+
+  // Column IDs to leave sparse in each output rowset; see SetSkippedColumns().
+  std::set<ColumnId> skipped_col_ids_;
+
+  // Sorted encoded keys at which the output rolls regardless of size; see
+  // SetRollBoundaries(). 'next_roll_boundary_' indexes the first boundary
+  // not yet reached by the appended rows.
+  std::vector<std::string> roll_boundaries_;
+  size_t next_roll_boundary_;
+
   std::shared_ptr<RowSetMetadata> cur_drs_metadata_;
   const BloomFilterSizing bloom_sizing_;
   const size_t target_rowset_size_;
@@ -249,6 +302,14 @@ class RollingDiskRowSetWriter {
   int64_t written_count_;
   uint64_t written_size_;
 
+  // Optional maintenance I/O throttle. See SetIoThrottle().
+  MaintenanceIoThrottle* io_throttle_;
+
+  // Total bytes (rolled rowsets plus the in-progress writer) for which
+  // tokens had been acquired from 'io_throttle_' at the last AppendBlock()
+  // call.
+  uint64_t last_throttled_size_;
+
   // Syncs and closes all outstanding blocks when the rolling writer is
   // destroyed.
   fs::ScopedWritableBlockCloser block_closer_;
@@ -338,6 +399,24 @@ class DiskRowSet : public RowSet {
   // TODO Offer a version that has the real total disk space usage.
   uint64_t EstimateOnDiskSize() const OVERRIDE;
 
+  // See RowSet::EstimateRowsAndBytesInRange(...). The row count comes from
+  // key index seeks; bytes are attributed proportionally to the fraction of
+  // the rowset's rows falling in the range.
+  Status EstimateRowsAndBytesInRange(const EncodedKey* start_key,
+                                     const EncodedKey* stop_key,
+                                     uint64_t* row_count,
+                                     uint64_t* bytes) const OVERRIDE;
+
+  bool MayHaveDataForColumn(ColumnId col_id) const OVERRIDE;
+
+  bool MayHaveMutationsAtOrAfter(Timestamp ts) const OVERRIDE;
+
+  int64_t EstimateBytesInAncientUndoDeltas(Timestamp ancient_history_mark) const OVERRIDE;
+
+  Status DeleteAncientUndoDeltas(Timestamp ancient_history_mark,
+                                 int64_t* blocks_deleted,
+                                 int64_t* bytes_deleted) OVERRIDE;
+
   size_t DeltaMemStoreSize() const OVERRIDE;
 
   bool DeltaMemStoreEmpty() const OVERRIDE;
@@ -371,6 +450,7 @@ class DiskRowSet : public RowSet {
 
  private:
   FRIEND_TEST(TestRowSet, TestRowSetUpdate);
+  FRIEND_TEST(TestRowSet, TestUpdateOverlay);
   FRIEND_TEST(TestRowSet, TestDMSFlush);
   FRIEND_TEST(TestCompaction, TestOneToOne);
   FRIEND_TEST(TabletHistoryGcTest, TestMajorDeltaCompactionOnSubsetOfColumns);
@@ -92,6 +92,23 @@ TEST_F(LockManagerTest, TestRelockSameRow) {
   VerifyAlreadyLocked(key_a);
 }
 
+// Test batch acquisition: all of the locks should be held on return,
+// regardless of the order in which the keys are supplied, and duplicate
+// keys should behave like repeated acquisitions by the same transaction.
+TEST_F(LockManagerTest, TestLockBatch) {
+  Slice key_a("a"), key_b("b"), key_c("c");
+  vector<Slice> keys = { key_c, key_a, key_b, key_a };
+  vector<ScopedRowLock> locks;
+  lock_manager_.LockBatch(keys, kFakeTransaction, LockManager::LOCK_EXCLUSIVE, &locks);
+  ASSERT_EQ(keys.size(), locks.size());
+  for (ScopedRowLock& lock : locks) {
+    ASSERT_TRUE(lock.acquired());
+  }
+  VerifyAlreadyLocked(key_a);
+  VerifyAlreadyLocked(key_b);
+  VerifyAlreadyLocked(key_c);
+}
+
 TEST_F(LockManagerTest, TestMoveLock) {
   // Acquire a lock.
   Slice key_a("a");
@@ -155,15 +172,16 @@ class LmTestThread {
     tid_ = Env::Default()->gettid();
     const TransactionState* my_txn = reinterpret_cast<TransactionState*>(tid_);
 
-    std::sort(keys_.begin(), keys_.end());
+    // Note: the keys are deliberately not sorted here. LockBatch() is
+    // responsible for ordering the acquisitions so that threads locking
+    // overlapping key sets in different orders don't deadlock.
+    vector<Slice> keys;
+    for (const Slice* key : keys_) {
+      keys.push_back(*key);
+    }
     for (int i = 0; i < FLAGS_num_iterations; i++) {
-      std::vector<shared_ptr<ScopedRowLock> > locks;
-      // TODO: We don't have an API for multi-row
-      for (const Slice* key : keys_) {
-        locks.push_back(shared_ptr<ScopedRowLock>(
-                          new ScopedRowLock(manager_, my_txn,
-                                            *key, LockManager::LOCK_EXCLUSIVE)));
-      }
+      vector<ScopedRowLock> locks;
+      manager_->LockBatch(keys, my_txn, LockManager::LOCK_EXCLUSIVE, &locks);
 
       for (LmTestResource* r : resources_) {
         r->acquire(tid_);
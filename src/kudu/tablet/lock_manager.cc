@@ -17,10 +17,12 @@
 
 #include "kudu/tablet/lock_manager.h"
 
+#include <algorithm>
 #include <glog/logging.h>
 #include <mutex>
 #include <semaphore.h>
 #include <string>
+#include <vector>
 
 #include "kudu/gutil/dynamic_annotations.h"
 #include "kudu/gutil/gscoped_ptr.h"
@@ -324,6 +326,31 @@ LockManager::~LockManager() {
   delete locks_;
 }
 
+void LockManager::LockBatch(const std::vector<Slice>& keys,
+                            const TransactionState* tx,
+                            LockManager::LockMode mode,
+                            std::vector<ScopedRowLock>* locks) {
+  locks->clear();
+  locks->resize(keys.size());
+
+  // Acquire the locks in sorted key order: since every transaction which
+  // takes multiple locks does so in the same canonical order, two
+  // transactions locking overlapping sets of keys can never end up waiting
+  // on each other in a cycle.
+  std::vector<size_t> sorted_idxs(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    sorted_idxs[i] = i;
+  }
+  std::sort(sorted_idxs.begin(), sorted_idxs.end(),
+            [&keys](size_t a, size_t b) {
+              return keys[a].compare(keys[b]) < 0;
+            });
+
+  for (size_t idx : sorted_idxs) {
+    (*locks)[idx] = ScopedRowLock(this, tx, keys[idx], mode);
+  }
+}
+
 LockManager::LockStatus LockManager::Lock(const Slice& key,
                                           const TransactionState* tx,
                                           LockManager::LockMode mode,
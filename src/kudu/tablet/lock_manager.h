@@ -17,6 +17,8 @@
 #ifndef KUDU_TABLET_LOCK_MANAGER_H
 #define KUDU_TABLET_LOCK_MANAGER_H
 
+#include <vector>
+
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/move.h"
 #include "kudu/util/slice.h"
@@ -26,11 +28,13 @@ namespace kudu { namespace tablet {
 class LockManager;
 class LockTable;
 class LockEntry;
+class ScopedRowLock;
 class TransactionState;
 
 // Super-simple lock manager implementation. This only supports exclusive
-// locks, and makes no attempt to prevent deadlocks if a single thread
-// takes multiple locks.
+// locks. Transactions which take multiple locks should acquire them
+// through LockBatch(), which orders the acquisitions so that concurrent
+// transactions cannot deadlock; no other deadlock prevention is attempted.
 //
 // In the future when we want to support multi-row transactions of some kind
 // we'll have to implement a proper lock manager with all its trappings,
@@ -49,6 +53,20 @@ class LockManager {
     LOCK_EXCLUSIVE
   };
 
+  // Acquire a lock on each key in 'keys' on behalf of 'tx', storing the
+  // resulting holders in '*locks' (parallel to 'keys').
+  //
+  // The locks are internally acquired in sorted key order. Since every
+  // caller uses the same canonical order, two transactions which lock
+  // overlapping sets of keys cannot deadlock waiting on each other,
+  // regardless of the order in which each supplies its keys. Duplicate
+  // keys are handled like repeated acquisitions by the same transaction.
+  //
+  // The key slices must remain valid and unchanged until the corresponding
+  // locks are released.
+  void LockBatch(const std::vector<Slice>& keys, const TransactionState* tx,
+                 LockMode mode, std::vector<ScopedRowLock>* locks);
+
  private:
   friend class ScopedRowLock;
   friend class LockManagerTest;
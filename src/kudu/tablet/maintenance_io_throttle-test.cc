@@ -0,0 +1,140 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/maintenance_io_throttle.h"
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#include "kudu/tablet/tablet_metrics.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/test_util.h"
+
+DECLARE_int64(maintenance_io_bytes_per_sec_max);
+DECLARE_int64(maintenance_io_bytes_per_sec_min);
+DECLARE_int32(maintenance_io_target_write_latency_ms);
+
+METRIC_DECLARE_entity(tablet);
+
+namespace kudu {
+namespace tablet {
+
+class MaintenanceIoThrottleTest : public KuduTest {
+ public:
+  MaintenanceIoThrottleTest()
+      : entity_(METRIC_ENTITY_tablet.Instantiate(&registry_, "test-tablet")),
+        metrics_(entity_),
+        throttle_(&metrics_) {
+  }
+
+ protected:
+  // Advance the adjustment clock by one interval and re-run the feedback
+  // loop.
+  void Adjust() {
+    now_ += MonoDelta::FromSeconds(2);
+    throttle_.AdjustBudget(now_);
+  }
+
+  // Record 'count' foreground writes with the given latency.
+  void RecordWrites(int count, int64_t latency_us) {
+    for (int i = 0; i < count; i++) {
+      metrics_.write_op_duration_client_propagated_consistency->Increment(latency_us);
+    }
+  }
+
+  MetricRegistry registry_;
+  scoped_refptr<MetricEntity> entity_;
+  TabletMetrics metrics_;
+  MaintenanceIoThrottle throttle_;
+  MonoTime now_ = MonoTime::Now();
+};
+
+TEST_F(MaintenanceIoThrottleTest, TestDisabledByDefault) {
+  Adjust();
+  ASSERT_EQ(0, throttle_.budget_bytes_per_sec());
+  // AcquireBytes() should return immediately without blocking.
+  throttle_.AcquireBytes(1024 * 1024 * 1024);
+}
+
+TEST_F(MaintenanceIoThrottleTest, TestFeedbackLoop) {
+  google::FlagSaver saver;
+  const uint64_t kMax = 100 * 1024 * 1024;
+  const uint64_t kMin = 1024 * 1024;
+  FLAGS_maintenance_io_bytes_per_sec_max = kMax;
+  FLAGS_maintenance_io_bytes_per_sec_min = kMin;
+  FLAGS_maintenance_io_target_write_latency_ms = 50;
+
+  // On enabling, the budget starts at the maximum.
+  Adjust();
+  ASSERT_EQ(kMax, throttle_.budget_bytes_per_sec());
+
+  // Slow foreground writes halve the budget.
+  RecordWrites(10, 100 * 1000); // 100ms
+  Adjust();
+  ASSERT_EQ(kMax / 2, throttle_.budget_bytes_per_sec());
+  RecordWrites(10, 100 * 1000);
+  Adjust();
+  ASSERT_EQ(kMax / 4, throttle_.budget_bytes_per_sec());
+
+  // Fast writes grow the budget back additively.
+  RecordWrites(10, 1000); // 1ms
+  Adjust();
+  ASSERT_EQ(kMax / 4 + kMax / 16, throttle_.budget_bytes_per_sec());
+
+  // An interval with no foreground traffic also grows the budget...
+  uint64_t prev = throttle_.budget_bytes_per_sec();
+  Adjust();
+  ASSERT_EQ(prev + prev / 4, throttle_.budget_bytes_per_sec());
+
+  // ...but never past the maximum.
+  for (int i = 0; i < 20; i++) {
+    Adjust();
+  }
+  ASSERT_EQ(kMax, throttle_.budget_bytes_per_sec());
+
+  // And sustained slow writes never shrink it below the minimum.
+  for (int i = 0; i < 20; i++) {
+    RecordWrites(10, 100 * 1000);
+    Adjust();
+  }
+  ASSERT_EQ(kMin, throttle_.budget_bytes_per_sec());
+
+  // Disabling the flag at runtime drops the throttle entirely.
+  FLAGS_maintenance_io_bytes_per_sec_max = 0;
+  Adjust();
+  ASSERT_EQ(0, throttle_.budget_bytes_per_sec());
+}
+
+TEST_F(MaintenanceIoThrottleTest, TestAcquireThrottles) {
+  google::FlagSaver saver;
+  FLAGS_maintenance_io_bytes_per_sec_max = 1024 * 1024;
+  FLAGS_maintenance_io_bytes_per_sec_min = 1024 * 1024;
+  // Adjust with the real time so that the throttler's refill clock isn't
+  // ahead of the AcquireBytes() calls below.
+  throttle_.AdjustBudget(MonoTime::Now());
+
+  // Acquiring more than a full second's budget must take a measurable
+  // amount of time.
+  MonoTime start = MonoTime::Now();
+  throttle_.AcquireBytes(2 * 1024 * 1024);
+  MonoDelta elapsed = MonoTime::Now() - start;
+  ASSERT_GE(elapsed.ToMilliseconds(), 500);
+}
+
+} // namespace tablet
+} // namespace kudu
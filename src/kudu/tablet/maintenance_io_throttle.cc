@@ -0,0 +1,165 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/maintenance_io_throttle.h"
+
+#include <algorithm>
+#include <mutex>
+
+#include <gflags/gflags.h>
+
+#include "kudu/tablet/tablet_metrics.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/metrics.h"
+
+DEFINE_int64(maintenance_io_bytes_per_sec_max, 0,
+             "Maximum number of bytes per second that maintenance operations "
+             "(memrowset flushes and rowset compactions) on a tablet may "
+             "write. Set to 0 to disable maintenance I/O throttling.");
+TAG_FLAG(maintenance_io_bytes_per_sec_max, experimental);
+TAG_FLAG(maintenance_io_bytes_per_sec_max, runtime);
+
+DEFINE_int64(maintenance_io_bytes_per_sec_min, 8 * 1024 * 1024,
+             "Lower bound on the maintenance I/O budget when throttling is "
+             "enabled. The feedback loop will not shrink the budget below "
+             "this rate, so that maintenance operations always make "
+             "progress.");
+TAG_FLAG(maintenance_io_bytes_per_sec_min, experimental);
+TAG_FLAG(maintenance_io_bytes_per_sec_min, runtime);
+
+DEFINE_int32(maintenance_io_target_write_latency_ms, 50,
+             "Target mean latency of foreground write operations. When the "
+             "observed latency exceeds this value, the maintenance I/O "
+             "budget is halved; otherwise it grows back towards "
+             "--maintenance_io_bytes_per_sec_max.");
+TAG_FLAG(maintenance_io_target_write_latency_ms, experimental);
+TAG_FLAG(maintenance_io_target_write_latency_ms, runtime);
+
+namespace kudu {
+namespace tablet {
+
+namespace {
+
+// How often the feedback loop re-evaluates the budget.
+const int kAdjustIntervalMs = 1000;
+
+// How long to sleep when the budget is exhausted before retrying.
+const int kBackoffMs = 10;
+
+} // anonymous namespace
+
+MaintenanceIoThrottle::MaintenanceIoThrottle(TabletMetrics* metrics)
+    : metrics_(metrics),
+      budget_bytes_per_sec_(0),
+      last_write_count_(0),
+      last_write_sum_us_(0) {
+}
+
+void MaintenanceIoThrottle::AcquireBytes(uint64_t bytes) {
+  uint64_t remaining = bytes;
+  while (remaining > 0) {
+    MonoTime now = MonoTime::Now();
+
+    bool needs_adjust;
+    {
+      std::lock_guard<simple_spinlock> l(lock_);
+      needs_adjust = !next_adjust_.Initialized() || now >= next_adjust_;
+    }
+    if (needs_adjust) {
+      AdjustBudget(now);
+    }
+
+    {
+      std::lock_guard<simple_spinlock> l(lock_);
+      if (!throttler_) return;
+      // Take at most one refill period's worth of tokens at a time, so that
+      // requests larger than the throttler's burst capacity can still be
+      // satisfied incrementally.
+      uint64_t chunk = std::min(remaining,
+                                std::max<uint64_t>(budget_bytes_per_sec_ / 10, 1));
+      if (throttler_->Take(now, 0, chunk)) {
+        remaining -= chunk;
+        continue;
+      }
+    }
+    SleepFor(MonoDelta::FromMilliseconds(kBackoffMs));
+  }
+}
+
+void MaintenanceIoThrottle::AdjustBudget(MonoTime now) {
+  uint64_t write_count = 0;
+  uint64_t write_sum_us = 0;
+  if (metrics_) {
+    GetForegroundWriteLatency(&write_count, &write_sum_us);
+  }
+
+  std::lock_guard<simple_spinlock> l(lock_);
+  next_adjust_ = now + MonoDelta::FromMilliseconds(kAdjustIntervalMs);
+
+  uint64_t max_budget = FLAGS_maintenance_io_bytes_per_sec_max;
+  if (max_budget == 0 || !metrics_) {
+    budget_bytes_per_sec_ = 0;
+    throttler_.reset();
+    last_write_count_ = write_count;
+    last_write_sum_us_ = write_sum_us;
+    return;
+  }
+  uint64_t min_budget = std::min<uint64_t>(FLAGS_maintenance_io_bytes_per_sec_min,
+                                           max_budget);
+
+  uint64_t delta_count = write_count - last_write_count_;
+  uint64_t delta_sum_us = write_sum_us - last_write_sum_us_;
+  last_write_count_ = write_count;
+  last_write_sum_us_ = write_sum_us;
+
+  uint64_t new_budget;
+  if (budget_bytes_per_sec_ == 0) {
+    // Throttling was just enabled: start from the full budget.
+    new_budget = max_budget;
+  } else if (delta_count > 0 &&
+             delta_sum_us / delta_count >
+                 static_cast<uint64_t>(FLAGS_maintenance_io_target_write_latency_ms) * 1000) {
+    // Foreground writes are suffering: back off multiplicatively.
+    new_budget = budget_bytes_per_sec_ / 2;
+  } else {
+    // There's headroom (or no foreground traffic at all): grow back
+    // additively.
+    new_budget = budget_bytes_per_sec_ + budget_bytes_per_sec_ / 4;
+  }
+  new_budget = std::min(std::max(new_budget, min_budget), max_budget);
+
+  if (new_budget != budget_bytes_per_sec_ || !throttler_) {
+    budget_bytes_per_sec_ = new_budget;
+    throttler_.reset(new Throttler(now, 0, new_budget, 1.0));
+  }
+}
+
+uint64_t MaintenanceIoThrottle::budget_bytes_per_sec() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return budget_bytes_per_sec_;
+}
+
+void MaintenanceIoThrottle::GetForegroundWriteLatency(uint64_t* count,
+                                                      uint64_t* sum_us) const {
+  *count = metrics_->write_op_duration_client_propagated_consistency->TotalCount() +
+      metrics_->write_op_duration_commit_wait_consistency->TotalCount();
+  *sum_us = metrics_->write_op_duration_client_propagated_consistency->TotalSum() +
+      metrics_->write_op_duration_commit_wait_consistency->TotalSum();
+}
+
+} // namespace tablet
+} // namespace kudu
@@ -0,0 +1,91 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TABLET_MAINTENANCE_IO_THROTTLE_H
+#define KUDU_TABLET_MAINTENANCE_IO_THROTTLE_H
+
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/throttler.h"
+
+namespace kudu {
+namespace tablet {
+
+struct TabletMetrics;
+
+// A feedback-driven throttle for a tablet's maintenance I/O (memrowset
+// flushes and rowset compactions).
+//
+// When enabled via --maintenance_io_bytes_per_sec_max, maintenance writers
+// acquire byte tokens from this throttle as they produce output. The
+// available budget is adjusted periodically based on the latency of
+// foreground write operations observed since the last adjustment: when the
+// mean latency exceeds --maintenance_io_target_write_latency_ms the budget
+// is halved, and when there is headroom it grows back additively. This
+// smooths background work out over time instead of letting a flush or
+// compaction issue I/O as fast as the disks allow, starving foreground
+// operations.
+//
+// This class is thread-safe.
+class MaintenanceIoThrottle {
+ public:
+  // 'metrics' may be NULL (e.g. if the tablet was created without a metric
+  // registry), in which case no feedback is available and throttling is
+  // disabled.
+  explicit MaintenanceIoThrottle(TabletMetrics* metrics);
+
+  // Block until 'bytes' of maintenance I/O budget are available. Returns
+  // immediately when throttling is disabled.
+  void AcquireBytes(uint64_t bytes);
+
+  // Re-evaluate the I/O budget based on the foreground write latency
+  // observed since the last call. This is invoked automatically from
+  // AcquireBytes() once per adjustment interval; it is public so that tests
+  // can drive the feedback loop directly.
+  void AdjustBudget(MonoTime now);
+
+  // The current budget in bytes/sec, or 0 if throttling is disabled.
+  uint64_t budget_bytes_per_sec() const;
+
+ private:
+  // Retrieve the cumulative count and sum (in microseconds) of foreground
+  // write operation latencies.
+  void GetForegroundWriteLatency(uint64_t* count, uint64_t* sum_us) const;
+
+  TabletMetrics* const metrics_;
+
+  mutable simple_spinlock lock_;
+
+  // Current budget. 0 means throttling is disabled and 'throttler_' is NULL.
+  uint64_t budget_bytes_per_sec_;
+  gscoped_ptr<Throttler> throttler_;
+
+  // The next time at which AcquireBytes() should re-run AdjustBudget().
+  MonoTime next_adjust_;
+
+  // Snapshot of the foreground write latency totals at the last adjustment.
+  uint64_t last_write_count_;
+  uint64_t last_write_sum_us_;
+
+  DISALLOW_COPY_AND_ASSIGN(MaintenanceIoThrottle);
+};
+
+} // namespace tablet
+} // namespace kudu
+
+#endif
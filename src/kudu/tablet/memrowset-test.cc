@@ -422,6 +422,52 @@ TEST_F(TestMemRowSet, TestDelete) {
   EXPECT_EQ(R"((string key="hello world", uint32 val=2))", rows[0]);
 }
 
+// Test a row which is repeatedly deleted and reinserted with identical
+// contents. Identical REINSERTs share a single payload copy in the arena
+// (see Mutation::CreateInArenaSharingPayload()), so this exercises reading
+// back through the shared payload reference.
+TEST_F(TestMemRowSet, TestReinsertIdenticalContents) {
+  const char kRowKey[] = "hello world";
+
+  shared_ptr<MemRowSet> mrs;
+  ASSERT_OK(MemRowSet::Create(0, schema_, log_anchor_registry_.get(),
+                              MemTracker::GetRootTracker(), &mrs));
+
+  ASSERT_OK(InsertRow(mrs.get(), kRowKey, 1));
+  OperationResultPB result;
+  ASSERT_OK(DeleteRow(mrs.get(), kRowKey, &result));
+
+  // First reinsert with the same contents as the original row.
+  ASSERT_OK(InsertRow(mrs.get(), kRowKey, 1));
+  MvccSnapshot snapshot_after_first_reinsert(mvcc_);
+
+  result.Clear();
+  ASSERT_OK(DeleteRow(mrs.get(), kRowKey, &result));
+  MvccSnapshot snapshot_after_second_delete(mvcc_);
+
+  // Second reinsert, again with identical contents: its payload is shared
+  // with the first REINSERT rather than copied.
+  ASSERT_OK(InsertRow(mrs.get(), kRowKey, 1));
+
+  vector<string> rows;
+  ASSERT_OK(mrs->DebugDump(&rows));
+  ASSERT_EQ(1, rows.size());
+  EXPECT_EQ(R"(@1: row (string key="hello world", uint32 val=1) mutations=)"
+            "[@2(DELETE), @3(REINSERT val=1), @4(DELETE), @5(REINSERT val=1)]",
+            rows[0]);
+
+  ASSERT_OK(DumpRowSet(*mrs, schema_, snapshot_after_first_reinsert, &rows));
+  ASSERT_EQ(1, rows.size());
+  EXPECT_EQ(R"((string key="hello world", uint32 val=1))", rows[0]);
+
+  ASSERT_OK(DumpRowSet(*mrs, schema_, snapshot_after_second_delete, &rows));
+  ASSERT_EQ(0, rows.size());
+
+  bool present;
+  ASSERT_OK(CheckRowPresent(*mrs, kRowKey, &present));
+  EXPECT_TRUE(present);
+}
+
 // Test for basic operations.
 // Can operate as a benchmark by setting --roundtrip_num_rows to a high value like 10M
 TEST_F(TestMemRowSet, TestMemRowSetInsertCountAndScan) {
@@ -17,6 +17,7 @@
 
 #include "kudu/tablet/memrowset.h"
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
@@ -137,6 +138,23 @@ Status MemRowSet::DebugDump(vector<string> *lines) {
 }
 
 
+namespace {
+
+// Returns the total number of bytes of indirect (string) data referenced by
+// the cells of 'row'.
+size_t IndirectDataSize(const ConstContiguousRow& row) {
+  size_t size = 0;
+  for (int i = 0; i < row.schema()->num_columns(); i++) {
+    ConstContiguousRow::Cell cell = row.cell(i);
+    if (cell.typeinfo()->physical_type() != BINARY) continue;
+    if (cell.is_nullable() && cell.is_null()) continue;
+    size += reinterpret_cast<const Slice*>(cell.ptr())->size();
+  }
+  return size;
+}
+
+} // anonymous namespace
+
 Status MemRowSet::Insert(Timestamp timestamp,
                          const ConstContiguousRow& row,
                          const OpId& op_id) {
@@ -168,14 +186,25 @@ Status MemRowSet::Insert(Timestamp timestamp,
       return Reinsert(timestamp, row, &ms_row);
     }
 
-    // Copy the non-encoded key onto the stack since we need
-    // to mutate it when we relocate its Slices into our arena.
-    DEFINE_MRSROW_ON_STACK(this, mrsrow, mrsrow_slice);
+    // Build the MRSRow value directly in the tree's arena, so that the
+    // btree adopts it in place rather than copying the row a second time
+    // out of a temporary buffer. Indirect (string) data is laid out in the
+    // same allocation, immediately following the row, rather than behind
+    // per-cell arena allocations: for the short strings which dominate
+    // most schemas, reading a cell then stays within the row's own cache
+    // lines.
+    size_t mrsrow_size = sizeof(MRSRow::Header) +
+        ContiguousRowHelper::row_size(schema_nonvirtual());
+    size_t indirect_size = IndirectDataSize(row);
+    uint8_t* in_arena = btree::ValueSlice::PreallocateInArena(
+        mrsrow_size + indirect_size, arena_.get());
+    Slice mrsrow_slice(in_arena, mrsrow_size);
+    MRSRow mrsrow(this, mrsrow_slice);
     mrsrow.header_->insertion_timestamp = timestamp;
     mrsrow.header_->redo_head = nullptr;
-    RETURN_NOT_OK(mrsrow.CopyRow(row, arena_.get()));
+    mrsrow.CopyRowIndirectDataInline(row, in_arena + mrsrow_size);
 
-    CHECK(mutation.Insert(mrsrow_slice))
+    CHECK(mutation.InsertPreallocated(Slice(in_arena, mrsrow_size + indirect_size)))
     << "Expected to be able to insert, since the prepared mutation "
     << "succeeded!";
   }
@@ -194,8 +223,30 @@ Status MemRowSet::Reinsert(Timestamp timestamp, const ConstContiguousRow& row, M
   RowChangeListEncoder encoder(&buf);
   encoder.SetToReinsert(row);
 
+  // A REINSERT carries a full copy of the row, so a workload which cycles
+  // the same contents through delete/reinsert would store that copy once
+  // per reinsert. Before storing another one, find the most recent REINSERT
+  // on this row: if its payload is byte-identical, the new mutation can
+  // share it. We hold the row's leaf lock here, so only this thread can be
+  // appending; AppendToListAtomic() below walks the full list anyway, so the
+  // extra walk doesn't change the complexity of the reinsert path.
+  const Mutation* prior_reinsert = nullptr;
+  for (const Mutation* m = ms_row->header_->redo_head;
+       m != nullptr;
+       m = m->acquire_next()) {
+    if (m->changelist().is_reinsert()) {
+      prior_reinsert = m;
+    }
+  }
+
   // Move the REINSERT mutation itself into our Arena.
-  Mutation *mut = Mutation::CreateInArena(arena_.get(), timestamp, encoder.as_changelist());
+  Mutation *mut;
+  if (prior_reinsert != nullptr &&
+      prior_reinsert->changelist().slice() == encoder.as_changelist().slice()) {
+    mut = Mutation::CreateInArenaSharingPayload(arena_.get(), timestamp, prior_reinsert);
+  } else {
+    mut = Mutation::CreateInArena(arena_.get(), timestamp, encoder.as_changelist());
+  }
 
   // Append the mutation into the row's mutation list.
   // This function has "release" semantics which ensures that the memory writes
@@ -400,6 +451,14 @@ Status MemRowSet::Iterator::Init(ScanSpec *spec) {
   RETURN_NOT_OK(projector_->Init());
   RETURN_NOT_OK(delta_projector_.Init());
 
+  // Build the reverse mapping from memrowset schema column index to
+  // projection column index, used when applying mutations.
+  base_to_proj_idx_.assign(memrowset_->schema_nonvirtual().num_columns(), -1);
+  for (const RowProjector::ProjectionIdxMapping& mapping :
+           projector_->base_cols_mapping()) {
+    base_to_proj_idx_[mapping.second] = mapping.first;
+  }
+
   if (spec && spec->lower_bound_key()) {
     bool exact;
     const Slice &lower_bound = spec->lower_bound_key()->encoded_key();
@@ -478,46 +537,86 @@ Status MemRowSet::Iterator::NextBlock(RowBlock *dst) {
 
 Status MemRowSet::Iterator::FetchRows(RowBlock* dst, size_t* fetched) {
   *fetched = 0;
-  do {
-    Slice k, v;
-    RowBlockRow dst_row = dst->row(*fetched);
-
-    // Copy the row into the destination, including projection
-    // and relocating slices.
-    // TODO: can we share some code here with CopyRowToArena() from row.h
-    // or otherwise put this elsewhere?
-    iter_->GetCurrentEntry(&k, &v);
-    MRSRow row(memrowset_.get(), v);
-
-    if (mvcc_snap_.IsCommitted(row.insertion_timestamp())) {
-      if (has_upper_bound() && out_of_bounds(k)) {
-        state_ = kFinished;
+  while (*fetched < dst->nrows()) {
+    // Process the rest of the current leaf (or as much of it as fits in
+    // 'dst') as one batch, rather than interleaving visibility checks,
+    // bound checks and row copies row-at-a-time.
+    size_t run_len = std::min(iter_->remaining_in_leaf(),
+                              dst->nrows() - *fetched);
+    const size_t start_idx = iter_->index_in_leaf();
+
+    // Keys within a leaf are sorted, so the upper bound only needs to be
+    // checked once per run: if the last key is in bounds, so is every
+    // preceding key. Otherwise, truncate the run at the first key past the
+    // bound.
+    if (has_upper_bound() &&
+        out_of_bounds(iter_->GetKeyInLeaf(start_idx + run_len - 1))) {
+      while (run_len > 0 &&
+             out_of_bounds(iter_->GetKeyInLeaf(start_idx + run_len - 1))) {
+        run_len--;
+      }
+      state_ = kFinished;
+      if (run_len == 0) {
         break;
-      } else {
-        RETURN_NOT_OK(projector_->ProjectRowForRead(row, &dst_row, dst->arena()));
+      }
+    }
 
-        Mutation* redo_head = reinterpret_cast<Mutation*>(
-            base::subtle::Acquire_Load(reinterpret_cast<AtomicWord*>(&row.header_->redo_head)));
-        // Roll-forward MVCC for committed updates.
-        RETURN_NOT_OK(ApplyMutationsToProjectedRow(
-            redo_head, &dst_row, dst->arena()));
+    // First pass: check snapshot visibility for the whole run in a tight
+    // loop over the insertion timestamps, filling in the block's selection
+    // vector.
+    for (size_t i = 0; i < run_len; i++) {
+      Slice k, v;
+      iter_->GetEntryInLeaf(start_idx + i, &k, &v);
+      MRSRow row(memrowset_.get(), v);
+      if (!mvcc_snap_.IsCommitted(row.insertion_timestamp())) {
+        // This row was not yet committed in the current MVCC snapshot.
+        dst->selection_vector()->SetRowUnselected(*fetched + i);
       }
-    } else {
-      // This row was not yet committed in the current MVCC snapshot
-      dst->selection_vector()->SetRowUnselected(*fetched);
+    }
 
-      // In debug mode, fill the row data for easy debugging
-      #ifndef NDEBUG
-      if (state_ != kFinished) {
+    // Second pass: copy out the visible rows, skipping over deselected ones
+    // without touching their data.
+    for (size_t i = 0; i < run_len; i++) {
+      RowBlockRow dst_row = dst->row(*fetched + i);
+      if (!dst->selection_vector()->IsRowSelected(*fetched + i)) {
+        // In debug mode, fill the row data for easy debugging
+        #ifndef NDEBUG
         dst_row.OverwriteWithPattern("MVCCMVCCMVCCMVCCMVCCMVCC"
                                      "MVCCMVCCMVCCMVCCMVCCMVCC"
                                      "MVCCMVCCMVCCMVCCMVCCMVCC");
+        #endif
+        continue;
       }
-      #endif
+
+      // Copy the row into the destination, including projection
+      // and relocating slices.
+      // TODO: can we share some code here with CopyRowToArena() from row.h
+      // or otherwise put this elsewhere?
+      Slice k, v;
+      iter_->GetEntryInLeaf(start_idx + i, &k, &v);
+      MRSRow row(memrowset_.get(), v);
+      RETURN_NOT_OK(projector_->ProjectRowForRead(row, &dst_row, dst->arena()));
+
+      Mutation* redo_head = reinterpret_cast<Mutation*>(
+          base::subtle::Acquire_Load(reinterpret_cast<AtomicWord*>(&row.header_->redo_head)));
+      // Roll-forward MVCC for committed updates.
+      RETURN_NOT_OK(ApplyMutationsToProjectedRow(
+          redo_head, &dst_row, dst->arena()));
+    }
+
+    *fetched += run_len;
+    if (state_ == kFinished) {
+      break;
     }
 
-    ++*fetched;
-  } while (iter_->Next() && *fetched < dst->nrows());
+    // Advance the iterator past the processed run. The last processed entry
+    // is at a valid index, so rewind to it and step forward; Next() handles
+    // crossing into the next leaf.
+    iter_->RewindToIndexInLeaf(start_idx + run_len - 1);
+    if (!iter_->Next()) {
+      break;
+    }
+  }
 
   return Status::OK();
 }
@@ -553,15 +652,24 @@ Status MemRowSet::Iterator::ApplyMutationsToProjectedRow(
         decoder.TwiddleDeleteStatus(&is_deleted);
       }
 
-      // TODO(todd): this is slow, since it makes multiple passes through the rowchangelist.
-      // Instead, we should keep the backwards mapping of columns.
-      for (const RowProjector::ProjectionIdxMapping& mapping : projector_->base_cols_mapping()) {
-        RowChangeListDecoder decoder(mut->changelist());
-        RETURN_NOT_OK(decoder.Init());
-        ColumnBlock dst_col = dst_row->column_block(mapping.first);
-        RETURN_NOT_OK(decoder.ApplyToOneColumn(dst_row->row_index(), &dst_col,
-                                               memrowset_->schema_nonvirtual(),
-                                               mapping.second, dst_arena));
+      // Apply the updates in a single pass over the changelist, mapping each
+      // decoded column ID back to the projection.
+      const Schema& base_schema = memrowset_->schema_nonvirtual();
+      while (decoder.HasNext()) {
+        RowChangeListDecoder::DecodedUpdate dec;
+        RETURN_NOT_OK(decoder.DecodeNext(&dec));
+        int base_col_idx;
+        const void* new_val;
+        RETURN_NOT_OK(dec.Validate(base_schema, &base_col_idx, &new_val));
+        if (base_col_idx == Schema::kColumnNotFound ||
+            base_to_proj_idx_[base_col_idx] == -1) {
+          // The column isn't part of the projection; skip the update.
+          continue;
+        }
+        SimpleConstCell src(&base_schema.column(base_col_idx), new_val);
+        ColumnBlock dst_col = dst_row->column_block(base_to_proj_idx_[base_col_idx]);
+        ColumnBlock::Cell dst_cell = dst_col.cell(dst_row->row_index());
+        RETURN_NOT_OK(CopyCell(src, &dst_cell, dst_arena));
       }
     }
   }
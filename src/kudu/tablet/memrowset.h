@@ -129,13 +129,26 @@ class MRSRow {
  private:
   friend class MemRowSet;
 
-  template <class ArenaType>
-  Status CopyRow(const ConstContiguousRow& row, ArenaType *arena) {
-    // the representation of the MRSRow and ConstContiguousRow is the same.
-    // so, instead of using CopyRow we can just do a memcpy.
+  // Copy 'row' into this MRSRow, copying any indirect (string) data to
+  // 'indirect_dst' rather than allocating it from an arena. The caller must
+  // have reserved enough space at 'indirect_dst' for all of the row's
+  // indirect data. MemRowSet::Insert() reserves it contiguously with the
+  // row itself, so that short string cells land on the same or a nearby
+  // cache line as the row instead of behind a pointer into a separate
+  // arena chunk.
+  void CopyRowIndirectDataInline(const ConstContiguousRow& row, uint8_t* indirect_dst) {
+    // The representation of the MRSRow and ConstContiguousRow is the same,
+    // so the direct data can be copied with a single memcpy.
     memcpy(row_slice_.mutable_data(), row.row_data(), row_slice_.size());
-    // Copy any referred-to memory to arena.
-    return kudu::RelocateIndirectDataToArena(this, arena);
+    for (int i = 0; i < schema()->num_columns(); i++) {
+      Cell cell = this->cell(i);
+      if (cell.typeinfo()->physical_type() != BINARY) continue;
+      if (cell.is_nullable() && cell.is_null()) continue;
+      Slice *slice = reinterpret_cast<Slice *>(cell.mutable_ptr());
+      memcpy(indirect_dst, slice->data(), slice->size());
+      *slice = Slice(indirect_dst, slice->size());
+      indirect_dst += slice->size();
+    }
   }
 
   struct Header {
@@ -501,6 +514,11 @@ class MemRowSet::Iterator : public RowwiseIterator {
   gscoped_ptr<MRSRowProjector> projector_;
   DeltaProjector delta_projector_;
 
+  // Maps a column index in the memrowset schema to the corresponding index
+  // in the projection, or -1 if the column is not projected. Used to apply
+  // mutations to a projected row in a single pass over each changelist.
+  std::vector<int> base_to_proj_idx_;
+
   // Temporary buffer used for RowChangeList projection.
   faststring delta_buf_;
 
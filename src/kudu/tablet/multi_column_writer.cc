@@ -17,11 +17,44 @@
 
 #include "kudu/tablet/multi_column_writer.h"
 
+#include <algorithm>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <gflags/gflags.h>
+
 #include "kudu/cfile/cfile_writer.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/fs/block_id.h"
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/once.h"
+#include "kudu/gutil/port.h"
 #include "kudu/gutil/stl_util.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/threadpool.h"
+
+DEFINE_bool(tablet_auto_select_column_encodings, false,
+            "Whether to select each column's cfile encoding at flush time from "
+            "a sample of the data being written, rather than using the encoding "
+            "specified in the table schema. The choice is made independently "
+            "for each flushed file from its first block of rows.");
+TAG_FLAG(tablet_auto_select_column_encodings, advanced);
+TAG_FLAG(tablet_auto_select_column_encodings, experimental);
+
+DEFINE_int32(tablet_flush_write_threads, 0,
+             "Number of threads used to encode and write columns when flushing "
+             "or compacting a rowset. When set, the columns of each written "
+             "block are partitioned across the threads, which can substantially "
+             "reduce flush wall time on wide tables. The pool is shared by all "
+             "concurrent flushes and compactions. 0 writes the columns serially "
+             "on the flushing thread.");
+TAG_FLAG(tablet_flush_write_threads, advanced);
+TAG_FLAG(tablet_flush_write_threads, evolving);
 
 namespace kudu {
 namespace tablet {
@@ -30,6 +63,106 @@ using cfile::CFileWriter;
 using fs::ScopedWritableBlockCloser;
 using fs::WritableBlock;
 
+namespace {
+
+// Lazily-created pool shared by all MultiColumnWriters for parallel column
+// writing; NULL if --tablet_flush_write_threads is not set.
+ThreadPool* g_column_write_pool = nullptr;
+GoogleOnceType g_column_write_pool_once = GOOGLE_ONCE_INIT;
+
+void InitColumnWritePool() {
+  gscoped_ptr<ThreadPool> pool;
+  CHECK_OK(ThreadPoolBuilder("col-write")
+           .set_max_threads(FLAGS_tablet_flush_write_threads)
+           .Build(&pool));
+  g_column_write_pool = pool.release();
+}
+
+ThreadPool* ColumnWritePool() {
+  if (FLAGS_tablet_flush_write_threads <= 0) {
+    return nullptr;
+  }
+  GoogleOnceInit(&g_column_write_pool_once, &InitColumnWritePool);
+  return g_column_write_pool;
+}
+
+// Maximum number of distinct string values tracked while sampling a column.
+// A sample with more distinct values than this is treated as high
+// cardinality.
+const size_t kMaxDistinctStringsSampled = 512;
+
+// Select an encoding for 'col' based on the cells of 'sample'.
+//
+// The heuristics only need to be roughly right: dictionary encoding already
+// falls back to plain within a file if the dictionary grows too large, and
+// bitshuffle degrades gracefully on incompressible data.
+EncodingType SelectEncoding(const ColumnSchema& col, const ColumnBlock& sample) {
+  const TypeInfo* type_info = col.type_info();
+
+  // Gather simple statistics from the sample: the number of non-null
+  // values, the number of runs of equal adjacent values, whether the values
+  // are in ascending order, and (for strings) an estimate of the number of
+  // distinct values.
+  size_t n_values = 0;
+  size_t n_runs = 0;
+  bool ascending = true;
+  std::unordered_set<std::string> distinct;
+  const void* prev_cell = nullptr;
+  for (size_t i = 0; i < sample.nrows(); i++) {
+    if (sample.is_nullable() && sample.is_null(i)) continue;
+    const void* cell = sample.cell_ptr(i);
+    n_values++;
+    int cmp = prev_cell != nullptr ? type_info->Compare(cell, prev_cell) : 1;
+    if (cmp != 0) {
+      n_runs++;
+    }
+    if (cmp < 0) {
+      ascending = false;
+    }
+    prev_cell = cell;
+    if (type_info->physical_type() == BINARY &&
+        distinct.size() <= kMaxDistinctStringsSampled) {
+      distinct.insert(reinterpret_cast<const Slice*>(cell)->ToString());
+    }
+  }
+
+  if (n_values == 0) {
+    // An all-null sample says nothing; keep the schema's encoding.
+    return col.attributes().encoding;
+  }
+
+  switch (type_info->physical_type()) {
+    case BINARY:
+      // Dictionary encoding wins whenever values repeat.
+      if (distinct.size() <= kMaxDistinctStringsSampled &&
+          distinct.size() <= n_values * 3 / 4) {
+        return DICT_ENCODING;
+      }
+      // High cardinality: sorted values (e.g. a string key column) share
+      // prefixes with their neighbors; unsorted ones are best left plain.
+      return ascending ? PREFIX_ENCODING : PLAIN_ENCODING;
+    case BOOL:
+      return RLE;
+    case INT8:
+    case INT16:
+    case INT32:
+    case INT64:
+      // Long runs of identical values compress best with RLE; otherwise
+      // bitshuffle exploits sortedness and narrow value ranges.
+      if (n_runs <= n_values / 4) {
+        return RLE;
+      }
+      return BIT_SHUFFLE;
+    case FLOAT:
+    case DOUBLE:
+      return BIT_SHUFFLE;
+    default:
+      return col.attributes().encoding;
+  }
+}
+
+} // anonymous namespace
+
 MultiColumnWriter::MultiColumnWriter(FsManager* fs,
                                      const Schema* schema)
   : fs_(fs),
@@ -43,16 +176,29 @@ MultiColumnWriter::~MultiColumnWriter() {
 
 Status MultiColumnWriter::Open() {
   CHECK(cfile_writers_.empty());
+  if (FLAGS_tablet_auto_select_column_encodings) {
+    // Defer creating the writers until the first appended block, so that
+    // each column's encoding can be selected from a sample of the data.
+    return Status::OK();
+  }
+  return OpenWriters(nullptr);
+}
+
+Status MultiColumnWriter::OpenWriters(const RowBlock* sample) {
+  CHECK(cfile_writers_.empty());
 
   // Open columns.
   for (int i = 0; i < schema_->num_columns(); i++) {
     const ColumnSchema &col = schema_->column(i);
 
-    // TODO: allow options to be configured, perhaps on a per-column
-    // basis as part of the schema. For now use defaults.
-    //
-    // Also would be able to set encoding here, or do something smart
-    // to figure out the encoding on the fly.
+    if (ContainsKey(skipped_col_ids_, schema_->column_id(i))) {
+      // The column stays sparse in the output rowset; readers serve it from
+      // its default value.
+      cfile_writers_.push_back(nullptr);
+      block_ids_.push_back(BlockId());
+      continue;
+    }
+
     cfile::WriterOptions opts;
 
     // Index all columns by ordinal position, so we can match up
@@ -61,12 +207,25 @@ Status MultiColumnWriter::Open() {
 
     /// Set the column storage attributes.
     opts.storage_attributes = col.attributes();
+    if (sample != nullptr) {
+      EncodingType enc = SelectEncoding(col, sample->column_block(i));
+      if (enc != opts.storage_attributes.encoding) {
+        LOG(INFO) << "Selected " << EncodingType_Name(enc) << " encoding for column "
+                  << col.ToString() << " (schema specifies "
+                  << EncodingType_Name(opts.storage_attributes.encoding) << ")";
+        opts.storage_attributes.encoding = enc;
+      }
+    }
 
     // If the schema has a single PK and this is the PK col
     if (i == 0 && schema_->num_key_columns() == 1) {
       opts.write_validx = true;
     }
 
+    // Track per-file min/max value statistics so scans whose predicates
+    // exclude a column's entire value range can skip the rowset.
+    opts.write_value_stats = true;
+
     // Open file for write.
     gscoped_ptr<WritableBlock> block;
     RETURN_NOT_OK_PREPEND(fs_->CreateNewBlock(&block),
@@ -91,16 +250,62 @@ Status MultiColumnWriter::Open() {
 }
 
 Status MultiColumnWriter::AppendBlock(const RowBlock& block) {
-  for (int i = 0; i < schema_->num_columns(); i++) {
-    ColumnBlock column = block.column_block(i);
+  if (PREDICT_FALSE(cfile_writers_.empty())) {
+    RETURN_NOT_OK(OpenWriters(&block));
+  }
+
+  const int n_cols = schema_->num_columns();
+  ThreadPool* pool = ColumnWritePool();
+  if (pool == nullptr || n_cols == 1) {
+    Status s;
+    AppendColumnRange(&block, 0, n_cols, &s, nullptr);
+    return s;
+  }
+
+  // Partition the columns into contiguous ranges and write one range per
+  // task. The calling thread writes the first range itself, so that progress
+  // is made even when the shared pool is saturated by other flushes.
+  int n_tasks = std::min(FLAGS_tablet_flush_write_threads + 1, n_cols);
+  std::vector<Status> statuses(n_tasks);
+  CountDownLatch latch(n_tasks - 1);
+  for (int t = 1; t < n_tasks; t++) {
+    Status submit_status = pool->SubmitFunc(boost::bind(
+        &MultiColumnWriter::AppendColumnRange, this, &block,
+        t * n_cols / n_tasks, (t + 1) * n_cols / n_tasks,
+        &statuses[t], &latch));
+    if (PREDICT_FALSE(!submit_status.ok())) {
+      // The pool is shutting down; write this range inline.
+      AppendColumnRange(&block, t * n_cols / n_tasks, (t + 1) * n_cols / n_tasks,
+                        &statuses[t], &latch);
+    }
+  }
+  AppendColumnRange(&block, 0, n_cols / n_tasks, &statuses[0], nullptr);
+  latch.Wait();
+  for (const Status& s : statuses) {
+    RETURN_NOT_OK(s);
+  }
+  return Status::OK();
+}
+
+void MultiColumnWriter::AppendColumnRange(const RowBlock* block,
+                                          int start_col, int end_col,
+                                          Status* status, CountDownLatch* latch) {
+  Status s;
+  for (int i = start_col; i < end_col && s.ok(); i++) {
+    CFileWriter* writer = cfile_writers_[i];
+    if (writer == nullptr) continue;
+    ColumnBlock column = block->column_block(i);
     if (column.is_nullable()) {
-      RETURN_NOT_OK(cfile_writers_[i]->AppendNullableEntries(column.null_bitmap(),
-          column.data(), column.nrows()));
+      s = writer->AppendNullableEntries(column.null_bitmap(),
+                                        column.data(), column.nrows());
     } else {
-      RETURN_NOT_OK(cfile_writers_[i]->AppendEntries(column.data(), column.nrows()));
+      s = writer->AppendEntries(column.data(), column.nrows());
     }
   }
-  return Status::OK();
+  *status = s;
+  if (latch != nullptr) {
+    latch->CountDown();
+  }
 }
 
 Status MultiColumnWriter::Finish() {
@@ -111,8 +316,14 @@ Status MultiColumnWriter::Finish() {
 
 Status MultiColumnWriter::FinishAndReleaseBlocks(ScopedWritableBlockCloser* closer) {
   CHECK(!finished_);
+  if (PREDICT_FALSE(cfile_writers_.empty())) {
+    // No data was ever appended; create the writers with the schema's
+    // encodings so that an (empty) cfile still exists for each column.
+    RETURN_NOT_OK(OpenWriters(nullptr));
+  }
   for (int i = 0; i < schema_->num_columns(); i++) {
     CFileWriter *writer = cfile_writers_[i];
+    if (writer == nullptr) continue;
     Status s = writer->FinishAndReleaseBlock(closer);
     if (!s.ok()) {
       LOG(WARNING) << "Unable to Finish writer for column " <<
@@ -128,6 +339,7 @@ void MultiColumnWriter::GetFlushedBlocksByColumnId(std::map<ColumnId, BlockId>*
   CHECK(finished_);
   ret->clear();
   for (int i = 0; i < schema_->num_columns(); i++) {
+    if (cfile_writers_[i] == nullptr) continue;
     (*ret)[schema_->column_id(i)] = block_ids_[i];
   }
 }
@@ -135,6 +347,7 @@ void MultiColumnWriter::GetFlushedBlocksByColumnId(std::map<ColumnId, BlockId>*
 size_t MultiColumnWriter::written_size() const {
   size_t size = 0;
   for (const CFileWriter *writer : cfile_writers_) {
+    if (writer == nullptr) continue;
     size += writer->written_size();
   }
   return size;
@@ -19,6 +19,7 @@
 
 #include <glog/logging.h>
 #include <map>
+#include <set>
 #include <vector>
 
 #include "kudu/common/schema.h"
@@ -27,6 +28,7 @@
 
 namespace kudu {
 
+class CountDownLatch;
 class RowBlock;
 class Schema;
 
@@ -49,7 +51,21 @@ class MultiColumnWriter {
 
   virtual ~MultiColumnWriter();
 
+  // Skip writing cfiles for the given columns: no block is created for them
+  // and they are omitted from GetFlushedBlocksByColumnId(), so the output
+  // rowset stays sparse and readers serve these columns from their default
+  // values. Must be called before Open().
+  void SetSkippedColumns(std::set<ColumnId> col_ids) {
+    DCHECK(cfile_writers_.empty()) << "must be called before Open()";
+    skipped_col_ids_ = std::move(col_ids);
+  }
+
   // Open and start writing the columns.
+  //
+  // If --tablet_auto_select_column_encodings is enabled, the underlying
+  // cfile writers are not created until the first block is appended, so
+  // that each column's encoding can be selected from a sample of the
+  // actual data.
   Status Open();
 
   // Append the given block to the output columns.
@@ -71,6 +87,7 @@ class MultiColumnWriter {
 
   cfile::CFileWriter* writer_for_col_idx(int i) {
     DCHECK_LT(i, cfile_writers_.size());
+    DCHECK(cfile_writers_[i]) << "column " << i << " is being skipped";
     return cfile_writers_[i];
   }
 
@@ -80,11 +97,27 @@ class MultiColumnWriter {
   void GetFlushedBlocksByColumnId(std::map<ColumnId, BlockId>* ret) const;
 
  private:
+  // Create and start the per-column cfile writers. If 'sample' is non-NULL,
+  // each column's encoding is selected from the sampled cells instead of
+  // using the encoding in the schema's storage attributes.
+  Status OpenWriters(const RowBlock* sample);
+
+  // Append columns [start_col, end_col) of 'block' to their cfile writers,
+  // setting 'status' to the first error encountered. Counts down 'latch'
+  // (if non-NULL) when done. Used both inline and as a threadpool task when
+  // --tablet_flush_write_threads is set.
+  void AppendColumnRange(const RowBlock* block, int start_col, int end_col,
+                         Status* status, CountDownLatch* latch);
+
   FsManager* const fs_;
   const Schema* const schema_;
 
   bool finished_;
 
+  // Column IDs for which no cfile is written; see SetSkippedColumns().
+  std::set<ColumnId> skipped_col_ids_;
+
+  // Entries for skipped columns are NULL.
   std::vector<cfile::CFileWriter *> cfile_writers_;
   std::vector<BlockId> block_ids_;
 
@@ -46,7 +46,24 @@ class Mutation {
   static Mutation *CreateInArena(
     ArenaType *arena, Timestamp timestamp, const RowChangeList &rcl);
 
+  // Like CreateInArena(), but the new Mutation references the changelist
+  // payload of 'other' rather than storing its own copy. 'other' must be
+  // allocated from the same arena (or one with at least as long a lifetime)
+  // so that the shared payload outlives both mutations.
+  //
+  // This is used to deduplicate REINSERT mutations, which carry a full copy
+  // of the row: a workload which repeatedly deletes and reinserts identical
+  // row contents would otherwise store that copy once per reinsert.
+  template<class ArenaType>
+  static Mutation *CreateInArenaSharingPayload(
+    ArenaType *arena, Timestamp timestamp, const Mutation *other);
+
   RowChangeList changelist() const {
+    if (PREDICT_FALSE(changelist_size_ == kSharedPayloadSentinel)) {
+      SharedPayload sp;
+      memcpy(&sp, changelist_data_, sizeof(sp));
+      return RowChangeList(Slice(sp.data, sp.size));
+    }
     return RowChangeList(Slice(changelist_data_, changelist_size_));
   }
 
@@ -93,6 +110,18 @@ class Mutation {
   template<bool ATOMIC>
   void DoAppendToList(Mutation **list);
 
+  // Sentinel value of 'changelist_size_' indicating that 'changelist_data_'
+  // holds a SharedPayload referencing another mutation's changelist rather
+  // than an inline copy. Encoded changelists are bounded far below this.
+  enum { kSharedPayloadSentinel = 0xffffffff };
+
+  // Out-of-line payload reference. Stored in 'changelist_data_' via memcpy,
+  // since the flexible array member is not suitably aligned for a pointer.
+  struct SharedPayload {
+    const char* data;
+    uint32_t size;
+  };
+
   // The transaction ID which made this mutation. If this transaction is not
   // committed in the snapshot of the reader, this mutation should be ignored.
   Timestamp timestamp_;
@@ -124,6 +153,27 @@ inline Mutation *Mutation::CreateInArena(
   return ret;
 }
 
+template<class ArenaType>
+inline Mutation *Mutation::CreateInArenaSharingPayload(
+  ArenaType *arena, Timestamp timestamp, const Mutation *other) {
+  // changelist() resolves a shared payload to the underlying bytes, so
+  // sharing never chains through intermediate mutations.
+  RowChangeList rcl = other->changelist();
+  DCHECK(!rcl.is_null());
+
+  size_t size = sizeof(Mutation) + sizeof(SharedPayload);
+  void *storage = arena->AllocateBytesAligned(size, BASE_PORT_H_ALIGN_OF(Mutation));
+  CHECK(storage) << "failed to allocate storage from arena";
+  auto ret = new (storage) Mutation();
+  ret->timestamp_ = timestamp;
+  ret->next_ = NULL;
+  ret->changelist_size_ = kSharedPayloadSentinel;
+  SharedPayload sp = { reinterpret_cast<const char*>(rcl.slice().data()),
+                       static_cast<uint32_t>(rcl.slice().size()) };
+  memcpy(ret->changelist_data_, &sp, sizeof(sp));
+  return ret;
+}
+
 inline void Mutation::ReverseMutationList(Mutation** list) {
   Mutation* prev = nullptr;
   Mutation* cur = *list;
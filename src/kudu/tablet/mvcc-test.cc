@@ -368,6 +368,31 @@ TEST_F(MvccTest, TestMayHaveUncommittedTransactionsBefore) {
   ASSERT_FALSE(snap2.MayHaveUncommittedTransactionsAtOrBefore(Timestamp(10)));
 }
 
+TEST_F(MvccTest, TestMayIncludeFutureCommits) {
+  // A snapshot bounded by a real timestamp has a fixed set of visible
+  // transactions.
+  MvccSnapshot clean_snap(Timestamp(10));
+  ASSERT_FALSE(clean_snap.MayIncludeFutureCommits());
+
+  MvccManager mgr;
+  Timestamp tx1 = clock_->Now();
+  mgr.StartTransaction(tx1);
+  MvccSnapshot snap_with_in_flights(mgr);
+  ASSERT_FALSE(snap_with_in_flights.MayIncludeFutureCommits());
+  mgr.StartApplyingTransaction(tx1);
+  mgr.CommitTransaction(tx1);
+
+  // The special snapshot which includes all transactions considers even
+  // transactions which commit after its creation to be committed.
+  MvccSnapshot all_committed =
+      MvccSnapshot::CreateSnapshotIncludingAllTransactions();
+  ASSERT_TRUE(all_committed.MayIncludeFutureCommits());
+
+  MvccSnapshot none_committed =
+      MvccSnapshot::CreateSnapshotIncludingNoTransactions();
+  ASSERT_FALSE(none_committed.MayIncludeFutureCommits());
+}
+
 TEST_F(MvccTest, TestAreAllTransactionsCommitted) {
   MvccManager mgr;
 
@@ -41,6 +41,7 @@ MvccManager::MvccManager()
     earliest_in_flight_(Timestamp::kMax) {
   cur_snap_.all_committed_before_ = Timestamp::kInitialTimestamp;
   cur_snap_.none_committed_at_or_after_ = Timestamp::kInitialTimestamp;
+  published_snap_ = new SnapshotContainer(cur_snap_);
 }
 
 void MvccManager::StartTransaction(Timestamp timestamp) {
@@ -113,6 +114,8 @@ void MvccManager::CommitTransaction(Timestamp timestamp) {
     // the "clean" timestamp.
     AdjustCleanTime();
   }
+
+  PublishSnapshotUnlocked();
 }
 
 MvccManager::TxnState MvccManager::RemoveInFlightAndGetStateUnlocked(Timestamp ts) {
@@ -152,8 +155,8 @@ void MvccManager::AdvanceEarliestInFlightTimestamp() {
   if (timestamps_in_flight_.empty()) {
     earliest_in_flight_ = Timestamp::kMax;
   } else {
-    earliest_in_flight_ = Timestamp(std::min_element(timestamps_in_flight_.begin(),
-                                                     timestamps_in_flight_.end())->first);
+    // The map is ordered by timestamp, so the first entry is the minimum.
+    earliest_in_flight_ = Timestamp(timestamps_in_flight_.begin()->first);
   }
 }
 
@@ -177,6 +180,7 @@ void MvccManager::AdjustSafeTime(Timestamp safe_time) {
   }
 
   AdjustCleanTime();
+  PublishSnapshotUnlocked();
 }
 
 // Remove any elements from 'v' which are < the given watermark.
@@ -296,9 +300,24 @@ bool MvccManager::AnyApplyingAtOrBeforeUnlocked(Timestamp ts) const {
   return false;
 }
 
+void MvccManager::PublishSnapshotUnlocked() {
+  DCHECK(lock_.is_locked());
+  scoped_refptr<SnapshotContainer> snap(new SnapshotContainer(cur_snap_));
+  std::lock_guard<rw_spinlock> l(snap_lock_);
+  published_snap_.swap(snap);
+  // NOTE: the old snapshot (now held by 'snap') is destructed after the
+  // lock_guard releases 'snap_lock_'.
+}
+
 void MvccManager::TakeSnapshot(MvccSnapshot *snap) const {
-  std::lock_guard<LockType> l(lock_);
-  *snap = cur_snap_;
+  scoped_refptr<SnapshotContainer> latest;
+  {
+    shared_lock<rw_spinlock> l(snap_lock_);
+    latest = published_snap_;
+  }
+  // Copy outside of any lock: a long copy (many recently-committed
+  // timestamps) no longer stalls concurrent committers or other readers.
+  *snap = latest->snap;
 }
 
 Status MvccManager::WaitForSnapshotWithAllCommitted(Timestamp timestamp,
@@ -412,6 +431,16 @@ bool MvccSnapshot::MayHaveUncommittedTransactionsAtOrBefore(const Timestamp& tim
       (timestamp == all_committed_before_ && !IsCommittedFallback(timestamp));
 }
 
+bool MvccSnapshot::MayIncludeFutureCommits() const {
+  // Timestamps are assigned monotonically, so a snapshot bounded by a real
+  // timestamp can never consider committed a transaction which starts after
+  // the snapshot was created. Only the special snapshot which includes all
+  // transactions (see MvccSnapshot::CreateSnapshotIncludingAllTransactions())
+  // has no such bound: its watermarks are set to the maximum possible
+  // timestamp.
+  return all_committed_before_ == Timestamp::kMax;
+}
+
 std::string MvccSnapshot::ToString() const {
   string ret("MvccSnapshot[committed={T|");
 
@@ -20,10 +20,11 @@
 #include <gtest/gtest_prod.h>
 #include <mutex>
 #include <string>
-#include <unordered_map>
+#include <map>
 #include <vector>
 
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/ref_counted.h"
 #include "kudu/server/clock.h"
 #include "kudu/util/locks.h"
 
@@ -88,6 +89,12 @@ class MvccSnapshot {
   // transactions that need to be undone.
   bool MayHaveUncommittedTransactionsAtOrBefore(const Timestamp& timestamp) const;
 
+  // Returns true if this snapshot may come to consider committed a transaction
+  // which commits after the snapshot was created. This is never the case for a
+  // snapshot bounded by a real timestamp, but is the case for the special
+  // snapshot which includes all transactions.
+  bool MayIncludeFutureCommits() const;
+
   // Return a string representation of the set of committed transactions
   // in this snapshot, suitable for debug printouts.
   string ToString() const;
@@ -323,6 +330,11 @@ class MvccManager {
   // Returns its state.
   TxnState RemoveInFlightAndGetStateUnlocked(Timestamp ts);
 
+  // Publish an immutable copy of 'cur_snap_' for readers. Must be called,
+  // with 'lock_' held, at the end of any public method which modified
+  // 'cur_snap_'.
+  void PublishSnapshotUnlocked();
+
   // Adjusts the clean time, i.e. the timestamp such that all transactions with
   // lower timestamps are committed or aborted, based on which transactions are
   // currently in flight and on what is the latest value of 'safe_time_'.
@@ -341,10 +353,33 @@ class MvccManager {
   typedef simple_spinlock LockType;
   mutable LockType lock_;
 
+  // The current snapshot. Only accessed with 'lock_' held; readers taking a
+  // snapshot copy from 'published_snap_' instead, so that they never contend
+  // with the commit path on 'lock_'.
   MvccSnapshot cur_snap_;
 
+  // A refcounted, immutable copy of 'cur_snap_'.
+  struct SnapshotContainer : public RefCountedThreadSafe<SnapshotContainer> {
+    explicit SnapshotContainer(const MvccSnapshot& s) : snap(s) {}
+    const MvccSnapshot snap;
+  };
+
+  // The latest published snapshot, replaced (copy-on-write) by writers each
+  // time 'cur_snap_' changes. 'snap_lock_' is held in shared mode by readers
+  // only long enough to obtain a reference, and exclusively by writers only
+  // long enough to swap the pointer, so snapshot acquisition is a constant
+  // amount of work regardless of how long a concurrent commit holds 'lock_'.
+  mutable rw_spinlock snap_lock_;
+  scoped_refptr<SnapshotContainer> published_snap_;
+
   // The set of timestamps corresponding to currently in-flight transactions.
-  typedef std::unordered_map<Timestamp::val_type, TxnState> InFlightMap;
+  // Kept ordered by timestamp so that the earliest in-flight transaction is
+  // found in constant time: commits arrive roughly in timestamp order, so
+  // nearly every commit removes the earliest entry and has to re-establish
+  // the minimum. With a deep apply queue (e.g. a follower catching up) a
+  // linear scan per commit would make the apply path quadratic in the number
+  // of in-flight transactions.
+  typedef std::map<Timestamp::val_type, TxnState> InFlightMap;
   InFlightMap timestamps_in_flight_;
 
   // A transaction timestamp below which all transactions are either committed or in-flight,
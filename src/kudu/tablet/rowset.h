@@ -35,6 +35,7 @@
 
 namespace kudu {
 
+class EncodedKey;
 class RowChangeList;
 
 namespace consensus {
@@ -117,6 +118,34 @@ class RowSet {
   // Estimate the number of bytes on-disk
   virtual uint64_t EstimateOnDiskSize() const = 0;
 
+  // Estimate the number of rows and on-disk bytes within the given encoded
+  // key range, consulting only key index and footer statistics -- no data
+  // blocks are read. A null bound leaves that side of the range unbounded.
+  // Rowsets which cannot produce a cheap estimate (e.g. the MemRowSet)
+  // report zeros.
+  virtual Status EstimateRowsAndBytesInRange(const EncodedKey* start_key,
+                                             const EncodedKey* stop_key,
+                                             uint64_t* row_count,
+                                             uint64_t* bytes) const {
+    *row_count = 0;
+    *bytes = 0;
+    return Status::OK();
+  }
+
+  // Return true if this rowset may contain stored data for the given column,
+  // either in its base data or in any of its delta stores. A column which
+  // has never been materialized in a rowset (e.g. one added by an ALTER
+  // after the rowset was written) is served from its default value on read,
+  // and compactions use this to preserve that sparseness in their output.
+  // Implementations must be conservative: return true when unsure.
+  virtual bool MayHaveDataForColumn(ColumnId col_id) const { return true; }
+
+  // Return true if this rowset may contain rows which were inserted or
+  // mutated at or after 'ts'. Incremental ("diff") scans use this to cull
+  // rowsets which have seen no activity in the time range of interest.
+  // Implementations must be conservative: return true when unsure.
+  virtual bool MayHaveMutationsAtOrAfter(Timestamp ts) const { return true; }
+
   // Return the lock used for including this DiskRowSet in a compaction.
   // This prevents multiple compactions and flushes from trying to include
   // the same rowset.
@@ -137,6 +166,26 @@ class RowSet {
   // The returned score ranges between 0 and 1 inclusively.
   virtual double DeltaStoresCompactionPerfImprovementScore(DeltaCompactionType type) const = 0;
 
+  // Estimate the number of bytes in UNDO delta stores whose deltas are all
+  // older than 'ancient_history_mark' and which could therefore be deleted
+  // by DeleteAncientUndoDeltas(). Rowsets without on-disk UNDO stores
+  // return 0.
+  virtual int64_t EstimateBytesInAncientUndoDeltas(Timestamp ancient_history_mark) const {
+    return 0;
+  }
+
+  // Delete UNDO delta stores whose deltas are all older than
+  // 'ancient_history_mark', setting 'blocks_deleted' and 'bytes_deleted'
+  // to what was removed (possibly zero). A no-op for rowsets without
+  // on-disk UNDO stores.
+  virtual Status DeleteAncientUndoDeltas(Timestamp ancient_history_mark,
+                                         int64_t* blocks_deleted,
+                                         int64_t* bytes_deleted) {
+    *blocks_deleted = 0;
+    *bytes_deleted = 0;
+    return Status::OK();
+  }
+
   // Flush the DMS if there's one
   virtual Status FlushDeltas() = 0;
 
@@ -181,6 +230,15 @@ class RowSetKeyProbe {
     bloom_probe_ = BloomKeyProbe(encoded_key_slice());
   }
 
+  // As above, but accepts a previously-encoded key for 'row_key' rather than
+  // encoding it again (e.g. one produced by EncodedKey::BatchFromContiguousRows()).
+  RowSetKeyProbe(ConstContiguousRow row_key,
+                 gscoped_ptr<EncodedKey> encoded_key)
+      : row_key_(std::move(row_key)),
+        encoded_key_(encoded_key.Pass()) {
+    bloom_probe_ = BloomKeyProbe(encoded_key_slice());
+  }
+
   // RowSetKeyProbes are usually allocated on the stack, which means that we
   // must copy it if we require it later (e.g. Table::Mutate()).
   //
@@ -252,6 +252,47 @@ void RowSetInfo::CollectOrdered(const RowSetTree& tree,
   FinalizeCDFVector(max_key, total_width);
 }
 
+void RowSetInfo::ChooseCompactionSplitKeys(const vector<shared_ptr<RowSet> >& rowsets,
+                                           int num_ranges,
+                                           vector<std::string>* split_keys) {
+  DCHECK_GT(num_ranges, 0);
+  if (num_ranges < 2) return;
+
+  // Collect the max-key bound of every bounded input along with its size.
+  // Sorted by key, these approximate the cumulative distribution of the
+  // merged data across the key space, in the same spirit as the CDF
+  // computation in CollectOrdered() but at rowset granularity.
+  vector<std::pair<std::string, uint64_t> > candidates;
+  uint64_t total_size = 0;
+  for (const shared_ptr<RowSet>& rs : rowsets) {
+    uint64_t size = rs->EstimateOnDiskSize();
+    total_size += size;
+    std::string min_key, max_key;
+    if (rs->GetBounds(&min_key, &max_key).ok()) {
+      candidates.emplace_back(std::move(max_key), size);
+    }
+  }
+  if (candidates.empty() || total_size == 0) return;
+  std::sort(candidates.begin(), candidates.end());
+
+  // Walk the candidates in key order, accumulating size. Each time the
+  // accumulated size crosses another 1/num_ranges of the total, the
+  // candidate's key becomes a split point. The last candidate never does:
+  // all keys at or above it belong to the final range.
+  uint64_t cumulative = 0;
+  int boundaries_emitted = 0;
+  for (size_t i = 0; i + 1 < candidates.size(); i++) {
+    cumulative += candidates[i].second;
+    uint64_t next_target =
+        total_size * (boundaries_emitted + 1) / num_ranges;
+    if (cumulative < next_target) continue;
+    if (split_keys->empty() || split_keys->back() != candidates[i].first) {
+      split_keys->push_back(candidates[i].first);
+    }
+    if (++boundaries_emitted == num_ranges - 1) break;
+  }
+}
+
 RowSetInfo::RowSetInfo(RowSet* rs, double init_cdf)
   : rowset_(rs),
     size_bytes_(rs->EstimateOnDiskSize()),
@@ -17,6 +17,7 @@
 #ifndef KUDU_TABLET_ROWSET_INFO_H_
 #define KUDU_TABLET_ROWSET_INFO_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -41,6 +42,18 @@ class RowSetInfo {
                              std::vector<RowSetInfo>* min_key,
                              std::vector<RowSetInfo>* max_key);
 
+  // Choose up to 'num_ranges' - 1 encoded split keys which partition the data
+  // in 'rowsets' into key ranges of roughly equal on-disk size, appending
+  // them to 'split_keys' in ascending order. The split keys are drawn from
+  // the max-key bounds of the input rowsets, so every emitted key falls
+  // within the covered key space. Rowsets without known bounds (e.g.
+  // MemRowSets) contribute their size to the distribution but no candidate
+  // keys; if no input has bounds, no keys are emitted.
+  static void ChooseCompactionSplitKeys(
+      const std::vector<std::shared_ptr<RowSet> >& rowsets,
+      int num_ranges,
+      std::vector<std::string>* split_keys);
+
   int size_bytes() const { return size_bytes_; }
   int size_mb() const { return size_mb_; }
 
@@ -84,7 +84,11 @@ Status RowSetMetadata::InitFromPB(const RowSetDataPB& pb) {
 
   // Load undo delta files
   for (const DeltaDataPB& undo_delta_pb : pb.undo_deltas()) {
-    undo_delta_blocks_.push_back(BlockId::FromPB(undo_delta_pb.block()));
+    BlockId block_id = BlockId::FromPB(undo_delta_pb.block());
+    undo_delta_blocks_.push_back(block_id);
+    if (undo_delta_pb.has_max_timestamp()) {
+      InsertOrDie(&undo_block_max_timestamps_, block_id, undo_delta_pb.max_timestamp());
+    }
   }
 
   initted_ = true;
@@ -117,6 +121,10 @@ void RowSetMetadata::ToProtobuf(RowSetDataPB *pb) {
   for (const BlockId& undo_delta_block : undo_delta_blocks_) {
     DeltaDataPB *undo_delta_pb = pb->add_undo_deltas();
     undo_delta_block.CopyToPB(undo_delta_pb->mutable_block());
+    const uint64_t* max_ts = FindOrNull(undo_block_max_timestamps_, undo_delta_block);
+    if (max_ts != nullptr) {
+      undo_delta_pb->set_max_timestamp(*max_ts);
+    }
   }
 
   // Write Bloom File
@@ -147,9 +155,11 @@ Status RowSetMetadata::CommitRedoDeltaDataBlock(int64_t dms_id,
   return Status::OK();
 }
 
-Status RowSetMetadata::CommitUndoDeltaDataBlock(const BlockId& block_id) {
+Status RowSetMetadata::CommitUndoDeltaDataBlock(const BlockId& block_id,
+                                                uint64_t max_timestamp) {
   std::lock_guard<LockType> l(lock_);
   undo_delta_blocks_.push_back(block_id);
+  InsertOrDie(&undo_block_max_timestamps_, block_id, max_timestamp);
   return Status::OK();
 }
 
@@ -186,9 +196,31 @@ Status RowSetMetadata::CommitUpdate(const RowSetMetadataUpdate& update) {
       redo_delta_blocks_.push_back(b);
     }
 
+    if (!update.remove_undo_blocks_.empty()) {
+      auto start_it = std::find(undo_delta_blocks_.begin(),
+                                undo_delta_blocks_.end(),
+                                update.remove_undo_blocks_[0]);
+      auto end_it = start_it;
+      for (const BlockId& b : update.remove_undo_blocks_) {
+        if (end_it == undo_delta_blocks_.end() || *end_it != b) {
+          return Status::InvalidArgument(
+              Substitute("Cannot find UNDO subsequence <$0> in <$1>",
+                         BlockId::JoinStrings(update.remove_undo_blocks_),
+                         BlockId::JoinStrings(undo_delta_blocks_)));
+        }
+        undo_block_max_timestamps_.erase(b);
+        ++end_it;
+      }
+
+      removed.insert(removed.end(), start_it, end_it);
+      undo_delta_blocks_.erase(start_it, end_it);
+    }
+
     if (!update.new_undo_block_.IsNull()) {
       // Front-loading to keep the UNDO files in their natural order.
       undo_delta_blocks_.insert(undo_delta_blocks_.begin(), update.new_undo_block_);
+      InsertOrDie(&undo_block_max_timestamps_, update.new_undo_block_,
+                  update.new_undo_block_max_timestamp_);
     }
 
     for (const ColumnIdToBlockIdMap::value_type& e : update.cols_to_replace_) {
@@ -233,7 +265,8 @@ vector<BlockId> RowSetMetadata::GetAllBlocks() {
   return blocks;
 }
 
-RowSetMetadataUpdate::RowSetMetadataUpdate() {
+RowSetMetadataUpdate::RowSetMetadataUpdate()
+  : new_undo_block_max_timestamp_(0) {
 }
 
 RowSetMetadataUpdate::~RowSetMetadataUpdate() {
@@ -259,8 +292,16 @@ RowSetMetadataUpdate& RowSetMetadataUpdate::ReplaceRedoDeltaBlocks(
   return *this;
 }
 
-RowSetMetadataUpdate& RowSetMetadataUpdate::SetNewUndoBlock(const BlockId& undo_block) {
+RowSetMetadataUpdate& RowSetMetadataUpdate::SetNewUndoBlock(const BlockId& undo_block,
+                                                            uint64_t max_timestamp) {
   new_undo_block_ = undo_block;
+  new_undo_block_max_timestamp_ = max_timestamp;
+  return *this;
+}
+
+RowSetMetadataUpdate& RowSetMetadataUpdate::RemoveUndoDeltaBlocks(
+    const std::vector<BlockId>& to_remove) {
+  remove_undo_blocks_ = to_remove;
   return *this;
 }
 
@@ -101,7 +101,10 @@ class RowSetMetadata {
 
   Status CommitRedoDeltaDataBlock(int64_t dms_id, const BlockId& block_id);
 
-  Status CommitUndoDeltaDataBlock(const BlockId& block_id);
+  // Commit a new UNDO delta block. 'max_timestamp' is the maximum timestamp
+  // of any delta in the block; it is persisted alongside the block ID so
+  // readers can cull the block for recent snapshots without opening it.
+  Status CommitUndoDeltaDataBlock(const BlockId& block_id, uint64_t max_timestamp);
 
   BlockId bloom_block() const {
     std::lock_guard<LockType> l(lock_);
@@ -138,6 +141,18 @@ class RowSetMetadata {
     return undo_delta_blocks_;
   }
 
+  // If the maximum delta timestamp of the given UNDO block was recorded in
+  // the metadata, sets '*max_timestamp' and returns true. Returns false for
+  // blocks committed before the timestamp was tracked.
+  bool undo_delta_block_max_timestamp(const BlockId& block_id,
+                                      uint64_t* max_timestamp) const {
+    std::lock_guard<LockType> l(lock_);
+    const uint64_t* ts = FindOrNull(undo_block_max_timestamps_, block_id);
+    if (ts == nullptr) return false;
+    *max_timestamp = *ts;
+    return true;
+  }
+
   TabletMetadata *tablet_metadata() const { return tablet_metadata_; }
 
   int64_t last_durable_redo_dms_id() const {
@@ -209,6 +224,10 @@ class RowSetMetadata {
   std::vector<BlockId> redo_delta_blocks_;
   std::vector<BlockId> undo_delta_blocks_;
 
+  // Maximum delta timestamp of each UNDO block, where known. Blocks loaded
+  // from metadata written before the timestamp was tracked have no entry.
+  std::map<BlockId, uint64_t> undo_block_max_timestamps_;
+
   int64_t last_durable_redo_dms_id_;
 
   DISALLOW_COPY_AND_ASSIGN(RowSetMetadata);
@@ -237,14 +256,22 @@ class RowSetMetadataUpdate {
   RowSetMetadataUpdate& RemoveColumnId(ColumnId col_id);
 
   // Add a new UNDO delta block to the list of UNDO files.
-  // We'll need to replace them instead when we start GCing.
-  RowSetMetadataUpdate& SetNewUndoBlock(const BlockId& undo_block);
+  // 'max_timestamp' is the maximum timestamp of any delta in the block.
+  RowSetMetadataUpdate& SetNewUndoBlock(const BlockId& undo_block,
+                                        uint64_t max_timestamp);
+
+  // Remove the given UNDO delta blocks, with no replacement. Used by history
+  // GC once every delta in a block has aged past the ancient history mark.
+  // The removed blocks must be a contiguous subsequence of the full UNDO
+  // block list.
+  RowSetMetadataUpdate& RemoveUndoDeltaBlocks(const std::vector<BlockId>& to_remove);
 
  private:
   friend class RowSetMetadata;
   RowSetMetadata::ColumnIdToBlockIdMap cols_to_replace_;
   std::vector<ColumnId> col_ids_to_remove_;
   std::vector<BlockId> new_redo_blocks_;
+  std::vector<BlockId> remove_undo_blocks_;
 
   struct ReplaceDeltaBlocks {
     std::vector<BlockId> to_remove;
@@ -252,6 +279,7 @@ class RowSetMetadataUpdate {
   };
   std::vector<ReplaceDeltaBlocks> replace_redo_blocks_;
   BlockId new_undo_block_;
+  uint64_t new_undo_block_max_timestamp_;
 
   DISALLOW_COPY_AND_ASSIGN(RowSetMetadataUpdate);
 };
@@ -104,6 +104,52 @@ TEST_F(TestRowSetTree, TestTree) {
   ASSERT_EQ(vec[2].get(), out[3]);
 }
 
+// The stack-allocated small-vector overload used on the write hot path
+// must return the same results as the std::vector overload.
+TEST_F(TestRowSetTree, TestSmallVectorQuery) {
+  RowSetVector vec;
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("0", "5")));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("3", "5")));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("5", "9")));
+  vec.push_back(shared_ptr<RowSet>(new MockMemRowSet()));
+
+  RowSetTree tree;
+  ASSERT_OK(tree.Reset(vec));
+
+  RowSetTree::SmallRowSetVector out;
+  tree.FindRowSetsWithKeyInRange("4", &out);
+  ASSERT_EQ(3, out.size());
+  ASSERT_EQ(vec[3].get(), out[0]); // MemRowSet
+  ASSERT_EQ(vec[0].get(), out[1]);
+  ASSERT_EQ(vec[1].get(), out[2]);
+}
+
+// Keys above the maximum bound of every rowset are provably absent, but only
+// when no rowset has unknown bounds.
+TEST_F(TestRowSetTree, TestIsKeyBeyondMaxRowSet) {
+  RowSetVector vec;
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("0", "5")));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("3", "9")));
+
+  RowSetTree tree;
+  ASSERT_OK(tree.Reset(vec));
+
+  ASSERT_FALSE(tree.IsKeyBeyondMaxRowSet("4"));
+  ASSERT_FALSE(tree.IsKeyBeyondMaxRowSet("9"));
+  ASSERT_TRUE(tree.IsKeyBeyondMaxRowSet("91"));
+
+  // A MemRowSet has unknown bounds, so no key is provably absent.
+  vec.push_back(shared_ptr<RowSet>(new MockMemRowSet()));
+  RowSetTree tree_with_mrs;
+  ASSERT_OK(tree_with_mrs.Reset(vec));
+  ASSERT_FALSE(tree_with_mrs.IsKeyBeyondMaxRowSet("91"));
+
+  // An empty tree can't contain any key.
+  RowSetTree empty_tree;
+  ASSERT_OK(empty_tree.Reset(RowSetVector()));
+  ASSERT_TRUE(empty_tree.IsKeyBeyondMaxRowSet("0"));
+}
+
 TEST_F(TestRowSetTree, TestPerformance) {
   const int kNumRowSets = 200;
   const int kNumQueries = AllowSlowTests() ? 1000000 : 10000;
@@ -133,6 +133,11 @@ Status RowSetTree::Reset(const RowSetVector &rowsets) {
   key_endpoints_.swap(endpoints);
   all_rowsets_.assign(rowsets.begin(), rowsets.end());
 
+  // The endpoints are sorted, so the last one is the maximum STOP key of
+  // any bounded rowset (a rowset's STOP key is always >= its START key).
+  max_bounded_stop_key_ = key_endpoints_.empty() ?
+      "" : key_endpoints_.back().slice_.ToString();
+
   // Build the mapping from DRS ID to DRS.
   drs_by_id_.clear();
   for (auto& rs : all_rowsets_) {
@@ -171,8 +176,9 @@ void RowSetTree::FindRowSetsIntersectingInterval(const Slice &lower_bound,
   }
 }
 
-void RowSetTree::FindRowSetsWithKeyInRange(const Slice &encoded_key,
-                                           vector<RowSet *> *rowsets) const {
+template<class Collection>
+void RowSetTree::FindRowSetsWithKeyInRangeImpl(const Slice &encoded_key,
+                                               Collection *rowsets) const {
   DCHECK(initted_);
 
   // All rowsets with unknown bounds need to be checked.
@@ -181,16 +187,32 @@ void RowSetTree::FindRowSetsWithKeyInRange(const Slice &encoded_key,
   }
 
   // Query the interval tree to efficiently find rowsets with known bounds
-  // whose ranges overlap the probe key.
-  vector<RowSetWithBounds *> from_tree;
-  from_tree.reserve(all_rowsets_.size());
+  // whose ranges overlap the probe key. The intermediate result is held in
+  // a stack-allocated small vector so that the common case does no heap
+  // allocation.
+  boost::container::small_vector<RowSetWithBounds*, kQueryInlineEntries> from_tree;
   tree_->FindContainingPoint(encoded_key, &from_tree);
-  rowsets->reserve(rowsets->size() + from_tree.size());
   for (RowSetWithBounds *rs : from_tree) {
     rowsets->push_back(rs->rowset);
   }
 }
 
+bool RowSetTree::IsKeyBeyondMaxRowSet(const Slice &encoded_key) const {
+  DCHECK(initted_);
+  return unbounded_rowsets_.empty() &&
+      encoded_key.compare(Slice(max_bounded_stop_key_)) > 0;
+}
+
+void RowSetTree::FindRowSetsWithKeyInRange(const Slice &encoded_key,
+                                           vector<RowSet *> *rowsets) const {
+  FindRowSetsWithKeyInRangeImpl(encoded_key, rowsets);
+}
+
+void RowSetTree::FindRowSetsWithKeyInRange(const Slice &encoded_key,
+                                           SmallRowSetVector *rowsets) const {
+  FindRowSetsWithKeyInRangeImpl(encoded_key, rowsets);
+}
+
 RowSetTree::~RowSetTree() {
   STLDeleteElements(&entries_);
 }
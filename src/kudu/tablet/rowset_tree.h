@@ -17,10 +17,13 @@
 #ifndef KUDU_TABLET_ROWSET_MANAGER_H
 #define KUDU_TABLET_ROWSET_MANAGER_H
 
+#include <string>
 #include <unordered_map>
 #include <vector>
 #include <utility>
 
+#include <boost/container/small_vector.hpp>
+
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/util/status.h"
@@ -62,6 +65,17 @@ class RowSetTree {
     Slice slice_;
   };
 
+  // Number of point-query results which can be returned without any heap
+  // allocation. Chosen to comfortably cover the number of rowsets which
+  // typically overlap a probe key in a well-compacted tablet.
+  enum { kQueryInlineEntries = 8 };
+
+  // Result vector for hot-path point queries: the first kQueryInlineEntries
+  // results are stored inline in the vector object itself (typically on the
+  // caller's stack), falling back to the heap only for unusually deep
+  // overlaps.
+  typedef boost::container::small_vector<RowSet*, kQueryInlineEntries> SmallRowSetVector;
+
   RowSetTree();
   Status Reset(const RowSetVector &rowsets);
   ~RowSetTree();
@@ -73,10 +87,26 @@ class RowSetTree {
   void FindRowSetsWithKeyInRange(const Slice &encoded_key,
                                  std::vector<RowSet *> *rowsets) const;
 
+  // As above, but appends into a stack-allocated small vector. This is the
+  // variant used on the per-write hot path, where the query must not
+  // allocate.
+  void FindRowSetsWithKeyInRange(const Slice &encoded_key,
+                                 SmallRowSetVector *rowsets) const;
+
   void FindRowSetsIntersectingInterval(const Slice &lower_bound,
                                        const Slice &upper_bound,
                                        std::vector<RowSet *> *rowsets) const;
 
+  // Return true if the given encoded key is provably absent from every
+  // rowset in this tree, because it sorts above the maximum bound of all
+  // bounded rowsets and there are no rowsets with unknown bounds.
+  //
+  // This is a cheap negative-existence check for workloads which insert in
+  // increasing key order: such keys never require bloom or key-file lookups.
+  // Since a RowSetTree is immutable once Reset(), the answer can't go stale --
+  // flushes and compactions install a new tree.
+  bool IsKeyBeyondMaxRowSet(const Slice &encoded_key) const;
+
   const RowSetVector &all_rowsets() const { return all_rowsets_; }
 
   RowSet* drs_by_id(int64_t drs_id) const {
@@ -89,6 +119,12 @@ class RowSetTree {
   const std::vector<RSEndpoint>& key_endpoints() const { return key_endpoints_; }
 
  private:
+  // Shared implementation of the FindRowSetsWithKeyInRange() overloads.
+  // 'Collection' is any container of RowSet* with a vector-like push_back API.
+  template<class Collection>
+  void FindRowSetsWithKeyInRangeImpl(const Slice &encoded_key,
+                                     Collection *rowsets) const;
+
   // Interval tree of the rowsets. Used to efficiently find rowsets which might contain
   // a probe row.
   gscoped_ptr<IntervalTree<RowSetIntervalTraits> > tree_;
@@ -109,6 +145,11 @@ class RowSetTree {
   // The DiskRowSets in this RowSetTree, keyed by their id.
   std::unordered_map<int64_t, RowSet*> drs_by_id_;
 
+  // The largest STOP key across all of the bounded rowsets, i.e. the upper
+  // bound of the key space known to potentially contain data. Empty if there
+  // are no bounded rowsets.
+  std::string max_bounded_stop_key_;
+
   // Rowsets for which the bounds are unknown -- e.g because they
   // are mutable (MemRowSets).
   //
@@ -16,10 +16,12 @@
 // under the License.
 
 #include <ctime>
+#include <memory>
 
 #include <glog/logging.h>
 
 #include "kudu/cfile/cfile_util.h"
+#include "kudu/common/encoded_key.h"
 #include "kudu/common/iterator.h"
 #include "kudu/common/row.h"
 #include "kudu/common/scan_spec.h"
@@ -92,6 +94,119 @@ TYPED_TEST(TestTablet, TestFlush) {
   ASSERT_EQ(dfr->delta_stats().delete_count(), max_rows);
 }
 
+// Test that a frozen memrowset stays scannable and mutable, and that a
+// later flush merges all frozen memrowsets together with the active one
+// into a single DiskRowSet.
+TYPED_TEST(TestTablet, TestFreezeMemRowSet) {
+  const int kRowsPerBatch = 100;
+
+  this->InsertTestRows(0, kRowsPerBatch, 0);
+  ASSERT_OK(this->tablet()->FreezeMemRowSet());
+
+  // The frozen memrowset counts as a rowset and remains scannable.
+  ASSERT_EQ(1, this->tablet()->num_rowsets());
+  ASSERT_GT(this->tablet()->FrozenMemRowSetsSize(), 0);
+  this->VerifyTestRows(0, kRowsPerBatch);
+
+  // Rows in a frozen memrowset can still be mutated.
+  LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
+  ASSERT_OK(this->UpdateTestRow(&writer, 0, 12345));
+
+  // Freeze a second batch, then leave a third in the active memrowset.
+  this->InsertTestRows(kRowsPerBatch, kRowsPerBatch, 0);
+  ASSERT_OK(this->tablet()->FreezeMemRowSet());
+  ASSERT_EQ(2, this->tablet()->num_rowsets());
+  this->InsertTestRows(kRowsPerBatch * 2, kRowsPerBatch, 0);
+
+  // All three batches flush together into one DiskRowSet.
+  ASSERT_OK(this->tablet()->Flush());
+  ASSERT_EQ(1, this->tablet()->num_rowsets());
+  ASSERT_EQ(0, this->tablet()->FrozenMemRowSetsSize());
+  this->VerifyTestRows(0, kRowsPerBatch * 3);
+}
+
+// Test that SplitKeyRange() produces ordered, contiguous ranges which
+// together cover the tablet's whole key space.
+TYPED_TEST(TestTablet, TestSplitKeyRange) {
+  // With no rowsets flushed there are no candidate split points, so we
+  // should get back a single unbounded range.
+  vector<KeyRange> ranges;
+  this->tablet()->SplitKeyRange(Slice(), Slice(), 1, &ranges);
+  ASSERT_EQ(1, ranges.size());
+  ASSERT_EQ("", ranges[0].start_primary_key);
+  ASSERT_EQ("", ranges[0].stop_primary_key);
+
+  // Create several disk rowsets.
+  const int kBatches = 4;
+  uint64_t max_rows = this->ClampRowCount(400);
+  uint64_t rows_per_batch = max_rows / kBatches;
+  for (int i = 0; i < kBatches; i++) {
+    this->InsertTestRows(i * rows_per_batch, rows_per_batch, 0);
+    ASSERT_OK(this->tablet()->Flush());
+  }
+
+  // A tiny target size should cut the key space at every rowset bound: one
+  // range ending at each rowset's maximum key, plus a final range covering
+  // the rest of the key space.
+  ranges.clear();
+  this->tablet()->SplitKeyRange(Slice(), Slice(), 1, &ranges);
+  ASSERT_EQ(kBatches + 1, ranges.size());
+  ASSERT_EQ("", ranges.front().start_primary_key);
+  ASSERT_EQ("", ranges.back().stop_primary_key);
+  for (size_t i = 1; i < ranges.size(); i++) {
+    ASSERT_EQ(ranges[i - 1].stop_primary_key, ranges[i].start_primary_key);
+    ASSERT_GT(ranges[i].start_primary_key, ranges[i - 1].start_primary_key);
+  }
+
+  // A huge target size should return a single range covering everything.
+  ranges.clear();
+  this->tablet()->SplitKeyRange(Slice(), Slice(), 64 * 1024 * 1024, &ranges);
+  ASSERT_EQ(1, ranges.size());
+  ASSERT_EQ("", ranges[0].start_primary_key);
+  ASSERT_EQ("", ranges[0].stop_primary_key);
+}
+
+// Test that EstimateRowsAndBytesInRange() produces index-only estimates
+// which partition cleanly at a split key.
+TYPED_TEST(TestTablet, TestKeyRangeEstimate) {
+  const int kBatches = 4;
+  uint64_t max_rows = this->ClampRowCount(400);
+  uint64_t rows_per_batch = max_rows / kBatches;
+  for (int i = 0; i < kBatches; i++) {
+    this->InsertTestRows(i * rows_per_batch, rows_per_batch, 0);
+    ASSERT_OK(this->tablet()->Flush());
+  }
+
+  // An unbounded range should account for every flushed row.
+  uint64_t total_rows, total_bytes;
+  ASSERT_OK(this->tablet()->EstimateRowsAndBytesInRange(
+      nullptr, nullptr, &total_rows, &total_bytes));
+  ASSERT_EQ(kBatches * rows_per_batch, total_rows);
+  ASSERT_GT(total_bytes, 0);
+
+  // Pick a mid-tablet split point from the rowset bounds.
+  vector<KeyRange> ranges;
+  this->tablet()->SplitKeyRange(Slice(), Slice(), 1, &ranges);
+  ASSERT_GT(ranges.size(), 1);
+  const string& mid_key = ranges[1].start_primary_key;
+
+  Arena arena(256, 4096);
+  gscoped_ptr<EncodedKey> mid;
+  ASSERT_OK(EncodedKey::DecodeEncodedString(
+      *this->tablet()->schema(), &arena, mid_key, &mid));
+
+  // The two halves should partition the unbounded estimate exactly, since
+  // each rowset's ordinal range is split at the same key.
+  uint64_t lo_rows, lo_bytes, hi_rows, hi_bytes;
+  ASSERT_OK(this->tablet()->EstimateRowsAndBytesInRange(
+      nullptr, mid.get(), &lo_rows, &lo_bytes));
+  ASSERT_OK(this->tablet()->EstimateRowsAndBytesInRange(
+      mid.get(), nullptr, &hi_rows, &hi_bytes));
+  ASSERT_GT(lo_rows, 0);
+  ASSERT_GT(hi_rows, 0);
+  ASSERT_EQ(total_rows, lo_rows + hi_rows);
+}
+
 // Test that historical data for a row is maintained even after the row
 // is flushed from the memrowset.
 TYPED_TEST(TestTablet, TestInsertsAndMutationsAreUndoneWithMVCCAfterFlush) {
@@ -219,6 +334,48 @@ TYPED_TEST(TestTablet, TestInsertDuplicateKey) {
   ASSERT_EQ(1, this->TabletCount());
 }
 
+// Write a single batch whose operations arrive in descending key order and
+// include an insert followed by an update of the same row. The server applies
+// batches sorted by encoded key (see --tablet_apply_writes_in_key_order);
+// this must not change the outcome: operations on the same key keep their
+// original relative order.
+TYPED_TEST(TestTablet, TestOutOfOrderBatch) {
+  LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
+
+  vector<std::unique_ptr<KuduPartialRow>> rows;
+  vector<LocalTabletWriter::Op> ops;
+  for (int i = 4; i >= 0; i--) {
+    std::unique_ptr<KuduPartialRow> row(new KuduPartialRow(&this->client_schema_));
+    this->setup_.BuildRow(row.get(), i);
+    ops.push_back(LocalTabletWriter::Op(RowOperationsPB::INSERT, row.get()));
+    rows.push_back(std::move(row));
+  }
+
+  // Insert one more row and update it within the same batch.
+  {
+    std::unique_ptr<KuduPartialRow> row(new KuduPartialRow(&this->client_schema_));
+    this->setup_.BuildRow(row.get(), 5);
+    ops.push_back(LocalTabletWriter::Op(RowOperationsPB::INSERT, row.get()));
+    rows.push_back(std::move(row));
+  }
+  {
+    std::unique_ptr<KuduPartialRow> row(new KuduPartialRow(&this->client_schema_));
+    this->setup_.BuildRowKey(row.get(), 5);
+    int col_idx = this->schema_.num_key_columns() == 1 ? 2 : 3;
+    CHECK_OK(row->SetInt32(col_idx, 12345));
+    ops.push_back(LocalTabletWriter::Op(RowOperationsPB::UPDATE, row.get()));
+    rows.push_back(std::move(row));
+  }
+
+  ASSERT_OK(writer.WriteBatch(ops));
+  ASSERT_EQ(6, this->TabletCount());
+
+  // A duplicate insert in a later batch must still be rejected.
+  Status s = this->InsertTestRow(&writer, 3, 0);
+  ASSERT_STR_CONTAINS(s.ToString(), "key already present");
+  ASSERT_EQ(6, this->TabletCount());
+}
+
 // Tests that we are able to handle reinserts properly.
 //
 // Namely tests that:
@@ -23,16 +23,19 @@
 #include <memory>
 #include <mutex>
 #include <ostream>
+#include <set>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "kudu/cfile/cfile_writer.h"
+#include "kudu/common/encoded_key.h"
 #include "kudu/common/iterator.h"
 #include "kudu/common/row_changelist.h"
 #include "kudu/common/row_operations.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
+#include "kudu/common/wire_protocol.h"
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/consensus/opid_util.h"
@@ -46,6 +49,7 @@
 #include "kudu/tablet/compaction_policy.h"
 #include "kudu/tablet/delta_compaction.h"
 #include "kudu/tablet/diskrowset.h"
+#include "kudu/tablet/maintenance_io_throttle.h"
 #include "kudu/tablet/row_op.h"
 #include "kudu/tablet/rowset_info.h"
 #include "kudu/tablet/rowset_tree.h"
@@ -72,6 +76,25 @@ DEFINE_int32(tablet_compaction_budget_mb, 128,
              "Budget for a single compaction");
 TAG_FLAG(tablet_compaction_budget_mb, experimental);
 
+DEFINE_int32(tablet_compaction_num_output_key_ranges, 1,
+             "Number of roughly equal-sized key ranges to partition the output "
+             "of a compaction into. When greater than 1, compaction output "
+             "additionally rolls to a new rowset at computed key boundaries, "
+             "so the resulting rowsets cover disjoint key ranges of similar "
+             "size. Size-based rolls still apply within each range.");
+TAG_FLAG(tablet_compaction_num_output_key_ranges, advanced);
+TAG_FLAG(tablet_compaction_num_output_key_ranges, experimental);
+
+DEFINE_bool(tablet_apply_writes_in_key_order, true,
+            "Whether to apply the operations of a write batch in primary key "
+            "order rather than in the order the client supplied them. Sorted "
+            "application makes bloom filter and memory b-tree accesses for "
+            "adjacent keys near-sequential. Has no effect on the results of "
+            "the operations or on the order in which they are reported back "
+            "to the client.");
+TAG_FLAG(tablet_apply_writes_in_key_order, advanced);
+TAG_FLAG(tablet_apply_writes_in_key_order, runtime);
+
 DEFINE_int32(tablet_bloom_block_size, 4096,
              "Block size of the bloom filters used for tablet keys.");
 TAG_FLAG(tablet_bloom_block_size, advanced);
@@ -145,6 +168,7 @@ using kudu::consensus::OpId;
 using kudu::consensus::MaximumOpId;
 using kudu::log::LogAnchorRegistry;
 using kudu::server::HybridClock;
+using std::pair;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
@@ -210,6 +234,8 @@ Tablet::Tablet(const scoped_refptr<TabletMetadata>& metadata,
                                    FLAGS_tablet_throttler_bytes_per_sec,
                                    FLAGS_tablet_throttler_burst_factor));
   }
+
+  maintenance_io_throttle_.reset(new MaintenanceIoThrottle(metrics_.get()));
 }
 
 Tablet::~Tablet() {
@@ -307,6 +333,31 @@ Status Tablet::NewRowIterator(const Schema &projection,
   return Status::OK();
 }
 
+Status Tablet::GetCachedClientSchema(const SchemaPB& pb, SchemaPtr* schema) {
+  // Serializing the PB and comparing the bytes is much cheaper than a full
+  // SchemaFromPB() decode (which builds column schemas and the name-to-index
+  // map), so use the serialized bytes as the cache key.
+  string key = pb.SerializeAsString();
+  {
+    std::lock_guard<simple_spinlock> l(client_schema_cache_lock_);
+    if (PREDICT_TRUE(client_schema_cache_ && client_schema_cache_key_ == key)) {
+      *schema = client_schema_cache_;
+      return Status::OK();
+    }
+  }
+
+  SchemaPtr decoded(std::make_shared<Schema>());
+  RETURN_NOT_OK(SchemaFromPB(pb, decoded.get()));
+
+  {
+    std::lock_guard<simple_spinlock> l(client_schema_cache_lock_);
+    client_schema_cache_key_ = std::move(key);
+    client_schema_cache_ = decoded;
+  }
+  *schema = std::move(decoded);
+  return Status::OK();
+}
+
 Status Tablet::DecodeWriteOperations(const Schema* client_schema,
                                      WriteTransactionState* tx_state) {
   TRACE_EVENT0("tablet", "Tablet::DecodeWriteOperations");
@@ -349,9 +400,62 @@ Status Tablet::AcquireRowLocks(WriteTransactionState* tx_state) {
   TRACE_EVENT1("tablet", "Tablet::AcquireRowLocks",
                "num_locks", tx_state->row_ops().size());
   TRACE("PREPARE: Acquiring locks for $0 operations", tx_state->row_ops().size());
+
+  // Encode all of the row keys in one pass: this dispatches on the key
+  // column types once per column rather than once per cell.
+  vector<ConstContiguousRow> row_keys;
+  row_keys.reserve(tx_state->row_ops().size());
+  for (RowOp* op : tx_state->row_ops()) {
+    row_keys.emplace_back(&key_schema_, op->decoded_op.row_data);
+  }
+  vector<EncodedKey*> enc_keys;
+  EncodedKey::BatchFromContiguousRows(key_schema_, row_keys, &enc_keys);
+
+  // Hand each op its probe before doing any checks which may fail, so that
+  // the ops take ownership of all of the encoded keys. The probe caches the
+  // encoded key: it's used for the bloom and presence checks, locking, and
+  // apply without being recomputed.
+  int j = 0;
   for (RowOp* op : tx_state->row_ops()) {
-    RETURN_NOT_OK(AcquireLockForOp(tx_state, op));
+    op->key_probe.reset(new tablet::RowSetKeyProbe(
+        row_keys[j], make_gscoped_ptr(enc_keys[j])));
+    j++;
   }
+
+  // If the tablet has a split key fence, enforce it in addition to the
+  // partition check: until compaction physically separates the data, both
+  // children of a split cover the parent's partition, so the partition
+  // check alone would accept rows belonging to the sibling.
+  string fence_lower, fence_upper;
+  bool has_fence = metadata_->GetSplitKeyFence(&fence_lower, &fence_upper);
+
+  vector<Slice> keys;
+  keys.reserve(tx_state->row_ops().size());
+  for (RowOp* op : tx_state->row_ops()) {
+    RETURN_NOT_OK(CheckRowInTablet(op->key_probe->row_key()));
+    const Slice& enc_key = op->key_probe->encoded_key_slice();
+    if (PREDICT_FALSE(has_fence)) {
+      if ((!fence_lower.empty() && enc_key.compare(Slice(fence_lower)) < 0) ||
+          (!fence_upper.empty() && enc_key.compare(Slice(fence_upper)) >= 0)) {
+        return Status::NotFound(
+            Substitute("Row not within the tablet's split key fence. Row: '$0'.",
+                       metadata_->partition_schema().PartitionKeyDebugString(
+                           op->key_probe->row_key())));
+      }
+    }
+    keys.push_back(enc_key);
+  }
+
+  // Acquire all of the locks in one batch: the lock manager orders the
+  // acquisitions so that concurrent transactions locking overlapping sets
+  // of rows can't deadlock.
+  vector<ScopedRowLock> locks;
+  lock_manager_.LockBatch(keys, tx_state, LockManager::LOCK_EXCLUSIVE, &locks);
+  int i = 0;
+  for (RowOp* op : tx_state->row_ops()) {
+    op->row_lock = std::move(locks[i++]);
+  }
+
   TRACE("PREPARE: locks acquired");
   return Status::OK();
 }
@@ -372,18 +476,6 @@ Status Tablet::CheckRowInTablet(const ConstContiguousRow& row) const {
   return Status::OK();
 }
 
-Status Tablet::AcquireLockForOp(WriteTransactionState* tx_state, RowOp* op) {
-  ConstContiguousRow row_key(&key_schema_, op->decoded_op.row_data);
-  op->key_probe.reset(new tablet::RowSetKeyProbe(row_key));
-  RETURN_NOT_OK(CheckRowInTablet(row_key));
-
-  op->row_lock = ScopedRowLock(&lock_manager_,
-                               tx_state,
-                               op->key_probe->encoded_key_slice(),
-                               LockManager::LOCK_EXCLUSIVE);
-  return Status::OK();
-}
-
 void Tablet::AssignTimestampAndStartTransactionForTests(WriteTransactionState* tx_state) {
   CHECK(!tx_state->has_timestamp());
   // Don't support COMMIT_WAIT for tests that don't boot a tablet server.
@@ -486,7 +578,21 @@ Status Tablet::InsertOrUpsertUnlocked(WriteTransactionState *tx_state,
   const TabletComponents* comps = DCHECK_NOTNULL(tx_state->tablet_components());
 
   // First, ensure that it is a unique key by checking all the open RowSets.
-  vector<RowSet *> to_check = FindRowSetsToCheck(op, comps);
+  RowSetTree::SmallRowSetVector to_check;
+  if (PREDICT_TRUE(!op->orig_result_from_log_) &&
+      comps->rowsets->IsKeyBeyondMaxRowSet(op->key_probe->encoded_key_slice())) {
+    // Workloads which insert in increasing key order continually probe keys
+    // above the bounds of every existing rowset. The rowset tree proves such
+    // keys absent without consulting any bloom filters, and since the tree is
+    // rebuilt whenever a flush or compaction changes the rowsets, the proof
+    // can't go stale. Leave 'to_check' empty and fall through to the
+    // MemRowSet insert, which does its own uniqueness check.
+    if (metrics_) {
+      metrics_->insertions_above_rowset_bounds->Increment();
+    }
+  } else {
+    FindRowSetsToCheck(op, comps, &to_check);
+  }
   for (RowSet *rowset : to_check) {
     bool present = false;
     RETURN_NOT_OK(rowset->CheckRowPresent(*op->key_probe, &present, stats));
@@ -575,35 +681,36 @@ Status Tablet::ApplyUpsertAsUpdate(WriteTransactionState* tx_state,
   return s;
 }
 
-vector<RowSet*> Tablet::FindRowSetsToCheck(RowOp* op,
-                                           const TabletComponents* comps) {
-  vector<RowSet*> to_check;
+void Tablet::FindRowSetsToCheck(RowOp* op,
+                                const TabletComponents* comps,
+                                RowSetTree::SmallRowSetVector* to_check) {
+  to_check->clear();
   if (PREDICT_TRUE(!op->orig_result_from_log_)) {
     // TODO: could iterate the rowsets in a smart order
     // based on recent statistics - eg if a rowset is getting
     // updated frequently, pick that one first.
     comps->rowsets->FindRowSetsWithKeyInRange(op->key_probe->encoded_key_slice(),
-                                              &to_check);
+                                              to_check);
 #ifndef NDEBUG
     // The order in which the rowset tree returns its results doesn't have semantic
     // relevance. We've had bugs in the past (eg KUDU-1341) which were obscured by
     // relying on the order of rowsets here. So, in debug builds, we shuffle the
     // order to encourage finding such bugs more easily.
-    std::random_shuffle(to_check.begin(), to_check.end());
+    std::random_shuffle(to_check->begin(), to_check->end());
 #endif
-    return to_check;
+    return;
   }
 
   // If we are replaying an operation during bootstrap, then we already have a
   // COMMIT message which tells us specifically which memory store to apply it to.
   for (const auto& store : op->orig_result_from_log_->mutated_stores()) {
     if (store.has_mrs_id()) {
-      to_check.push_back(comps->memrowset.get());
+      to_check->push_back(comps->memrowset.get());
     } else {
       DCHECK(store.has_rs_id());
       RowSet* drs = comps->rowsets->drs_by_id(store.rs_id());
       if (PREDICT_TRUE(drs)) {
-        to_check.push_back(drs);
+        to_check->push_back(drs);
       }
 
       // If for some reason we didn't find any stores that the COMMIT message indicated,
@@ -612,7 +719,6 @@ vector<RowSet*> Tablet::FindRowSetsToCheck(RowOp* op,
       // corruption.
     }
   }
-  return to_check;
 }
 
 Status Tablet::MutateRowUnlocked(WriteTransactionState *tx_state,
@@ -647,7 +753,8 @@ Status Tablet::MutateRowUnlocked(WriteTransactionState *tx_state,
 
   // Next, check the disk rowsets.
 
-  vector<RowSet *> to_check = FindRowSetsToCheck(mutate, comps);
+  RowSetTree::SmallRowSetVector to_check;
+  FindRowSetsToCheck(mutate, comps, &to_check);
   for (RowSet *rs : to_check) {
     s = rs->MutateRow(ts,
                       *mutate->key_probe,
@@ -684,9 +791,24 @@ void Tablet::ApplyRowOperations(WriteTransactionState* tx_state) {
       tx_state->arena()->AllocateBytesAligned(sizeof(ProbeStats) * num_ops,
                                               alignof(ProbeStats)));
 
+  // Client batches arrive in arbitrary key order. Applying them sorted by
+  // encoded key makes the presence checks walk each rowset's bloom filter
+  // blocks and the memrowset b-tree near-sequentially, so adjacent keys
+  // reuse the blocks they share. The stable sort keeps multiple operations
+  // against the same row in their original order, and results are recorded
+  // on the RowOp objects (whose list order is untouched), so neither the
+  // commit message nor the client response is affected.
+  vector<RowOp*> ops(tx_state->row_ops());
+  if (PREDICT_TRUE(FLAGS_tablet_apply_writes_in_key_order)) {
+    std::stable_sort(ops.begin(), ops.end(), [](const RowOp* a, const RowOp* b) {
+      return a->key_probe->encoded_key_slice().compare(
+          b->key_probe->encoded_key_slice()) < 0;
+    });
+  }
+
   StartApplying(tx_state);
   int i = 0;
-  for (RowOp* row_op : tx_state->row_ops()) {
+  for (RowOp* row_op : ops) {
     ProbeStats* stats = &stats_array[i++];
     // Manually run the constructor to clear the stats to 0 before collecting
     // them.
@@ -814,12 +936,86 @@ HistoryGcOpts Tablet::GetHistoryGcOpts() const {
   return HistoryGcOpts::Disabled();
 }
 
+int64_t Tablet::EstimateBytesInAncientUndoDeltas() const {
+  Timestamp ancient_history_mark;
+  if (!GetTabletAncientHistoryMark(&ancient_history_mark)) {
+    return 0;
+  }
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  if (!comps) {
+    return 0;
+  }
+  int64_t bytes = 0;
+  for (const shared_ptr<RowSet>& rowset : comps->rowsets->all_rowsets()) {
+    bytes += rowset->EstimateBytesInAncientUndoDeltas(ancient_history_mark);
+  }
+  return bytes;
+}
+
+Status Tablet::DeleteAncientUndoDeltas(int64_t* blocks_deleted, int64_t* bytes_deleted) {
+  *blocks_deleted = 0;
+  *bytes_deleted = 0;
+
+  Timestamp ancient_history_mark;
+  if (!GetTabletAncientHistoryMark(&ancient_history_mark)) {
+    return Status::OK();
+  }
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  if (!comps) {
+    return Status::OK();
+  }
+  for (const shared_ptr<RowSet>& rowset : comps->rowsets->all_rowsets()) {
+    int64_t rowset_blocks_deleted;
+    int64_t rowset_bytes_deleted;
+    RETURN_NOT_OK(rowset->DeleteAncientUndoDeltas(ancient_history_mark,
+                                                  &rowset_blocks_deleted,
+                                                  &rowset_bytes_deleted));
+    *blocks_deleted += rowset_blocks_deleted;
+    *bytes_deleted += rowset_bytes_deleted;
+  }
+  if (metrics_ && *bytes_deleted > 0) {
+    metrics_->undo_delta_block_gc_bytes_deleted->IncrementBy(*bytes_deleted);
+  }
+  return Status::OK();
+}
+
 Status Tablet::Flush() {
   TRACE_EVENT1("tablet", "Tablet::Flush", "id", tablet_id());
   std::lock_guard<Semaphore> lock(rowsets_flush_sem_);
   return FlushUnlocked();
 }
 
+Status Tablet::FreezeMemRowSet() {
+  TRACE_EVENT1("tablet", "Tablet::FreezeMemRowSet", "id", tablet_id());
+  std::lock_guard<Semaphore> lock(rowsets_flush_sem_);
+  return FreezeMemRowSetUnlocked();
+}
+
+Status Tablet::AdoptRowSet(const shared_ptr<RowSetMetadata>& rowset_meta) {
+  TRACE_EVENT1("tablet", "Tablet::AdoptRowSet", "id", tablet_id());
+  CHECK_EQ(state_, kOpen);
+
+  shared_ptr<DiskRowSet> rowset;
+  RETURN_NOT_OK_PREPEND(DiskRowSet::Open(rowset_meta, log_anchor_registry_.get(),
+                                         mem_trackers_, &rowset),
+                        "Failed to open ingested rowset");
+
+  // Hold the flush semaphore so that the metadata flush below can't
+  // interleave with a concurrent MRS flush or compaction committing its own
+  // metadata update.
+  std::lock_guard<Semaphore> lock(rowsets_flush_sem_);
+  AtomicSwapRowSets(RowSetVector(), { rowset });
+  RETURN_NOT_OK_PREPEND(FlushMetadata(RowSetVector(), { rowset_meta },
+                                      TabletMetadata::kNoMrsFlushed),
+                        "Failed to flush new tablet metadata");
+
+  LOG_WITH_PREFIX(INFO) << "Adopted ingested rowset " << rowset_meta->id()
+                        << " (" << rowset->EstimateOnDiskSize() << " bytes)";
+  return Status::OK();
+}
+
 Status Tablet::FlushUnlocked() {
   TRACE_EVENT0("tablet", "Tablet::FlushUnlocked");
   RowSetsInCompaction input;
@@ -828,16 +1024,63 @@ Status Tablet::FlushUnlocked() {
     // Create a new MRS with the latest schema.
     std::lock_guard<rw_spinlock> lock(component_lock_);
     RETURN_NOT_OK(ReplaceMemRowSetUnlocked(&input, &old_mrs));
+
+    // Include any frozen memrowsets whose flush was deferred: they are
+    // flushed together with the active one into a single DiskRowSet.
+    for (size_t i = 0; i < frozen_mrss_.size(); i++) {
+      input.AddRowSet(frozen_mrss_[i], std::move(frozen_mrs_locks_[i]));
+    }
+    frozen_mrss_.clear();
+    frozen_mrs_locks_.clear();
   }
 
   // Wait for any in-flight transactions to finish against the old MRS
   // before we flush it.
   mvcc_.WaitForApplyingTransactionsToCommit();
 
-  // Note: "input" should only contain old_mrs.
+  // Note: "input" contains old_mrs and any frozen memrowsets.
   return FlushInternal(input, old_mrs);
 }
 
+Status Tablet::FreezeMemRowSetUnlocked() {
+  TRACE_EVENT0("tablet", "Tablet::FreezeMemRowSetUnlocked");
+
+  std::lock_guard<rw_spinlock> lock(component_lock_);
+  shared_ptr<MemRowSet> old_mrs = components_->memrowset;
+  if (old_mrs->empty()) {
+    return Status::OK();
+  }
+
+  // Mark the frozen memrowset as locked, so compactions won't consider it
+  // for inclusion in any concurrent compactions. The lock is held until the
+  // memrowset is handed off to a flush in FlushUnlocked().
+  std::unique_lock<std::mutex> ms_lock(*old_mrs->compact_flush_lock(), std::try_to_lock);
+  CHECK(ms_lock.owns_lock());
+
+  shared_ptr<MemRowSet> new_mrs;
+  RETURN_NOT_OK(MemRowSet::Create(next_mrs_id_++, *schema(),
+                                  log_anchor_registry_.get(),
+                                  mem_trackers_.tablet_tracker,
+                                  &new_mrs));
+  shared_ptr<RowSetTree> new_rst(new RowSetTree());
+  ModifyRowSetTree(*components_->rowsets,
+                   RowSetVector(), // remove nothing
+                   { old_mrs }, // add the old MRS
+                   new_rst.get());
+  frozen_mrss_.push_back(old_mrs);
+  frozen_mrs_locks_.push_back(std::move(ms_lock));
+
+  // Swap it in. The frozen memrowset remains scannable (and can still
+  // receive updates and deletes) through the rowset tree; its disk flush
+  // happens with the next FlushUnlocked().
+  components_ = new TabletComponents(new_mrs, new_rst);
+
+  LOG_WITH_PREFIX(INFO) << "Froze memrowset (mrs_id=" << old_mrs->mrs_id()
+                        << ", " << old_mrs->memory_footprint()
+                        << " bytes); deferring flush";
+  return Status::OK();
+}
+
 Status Tablet::ReplaceMemRowSetUnlocked(RowSetsInCompaction *compaction,
                                         shared_ptr<MemRowSet> *old_ms) {
   *old_ms = components_->memrowset;
@@ -885,11 +1128,11 @@ Status Tablet::FlushInternal(const RowSetsInCompaction& input,
   uint64_t start_insert_count = old_ms->debug_insert_count();
   int64_t mrs_being_flushed = old_ms->mrs_id();
 
-  if (old_ms->empty()) {
-    // If we're flushing an empty RowSet, we can short circuit here rather than
-    // waiting until the check at the end of DoCompactionAndFlush(). This avoids
-    // the need to create cfiles and write their headers only to later delete
-    // them.
+  if (old_ms->empty() && input.rowsets().size() == 1) {
+    // If we're flushing an empty RowSet (and no frozen memrowsets are
+    // waiting), we can short circuit here rather than waiting until the
+    // check at the end of DoCompactionAndFlush(). This avoids the need to
+    // create cfiles and write their headers only to later delete them.
     LOG(INFO) << "MemRowSet was empty: no flush needed.";
     return HandleEmptyCompactionOrFlush(input.rowsets(), mrs_being_flushed);
   }
@@ -957,6 +1200,15 @@ Status Tablet::AlterSchema(AlterSchemaTransactionState *tx_state) {
                         << " version " << tx_state->schema_version();
   DCHECK(schema_lock_.is_locked());
   metadata_->SetSchema(*tx_state->schema(), tx_state->schema_version());
+
+  // Drop any cached client schema decode. The cache is keyed purely on the
+  // request bytes, so this isn't needed for correctness, but it releases
+  // the old schema promptly: writers will start sending the new one.
+  {
+    std::lock_guard<simple_spinlock> l(client_schema_cache_lock_);
+    client_schema_cache_key_.clear();
+    client_schema_cache_.reset();
+  }
   if (tx_state->has_new_table_name()) {
     metadata_->SetTableName(tx_state->new_table_name());
     if (metric_entity_) {
@@ -1117,6 +1369,10 @@ void Tablet::RegisterMaintenanceOps(MaintenanceManager* maint_mgr) {
   gscoped_ptr<MaintenanceOp> major_delta_compact_op(new MajorDeltaCompactionOp(this));
   maint_mgr->RegisterOp(major_delta_compact_op.get());
   maintenance_ops_.push_back(major_delta_compact_op.release());
+
+  gscoped_ptr<MaintenanceOp> undo_delta_block_gc_op(new UndoDeltaBlockGCOp(this));
+  maint_mgr->RegisterOp(undo_delta_block_gc_op.get());
+  maintenance_ops_.push_back(undo_delta_block_gc_op.release());
 }
 
 void Tablet::UnregisterMaintenanceOps() {
@@ -1167,8 +1423,47 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   shared_ptr<CompactionInput> merge;
   RETURN_NOT_OK(input.CreateCompactionInput(flush_snap, schema(), &merge));
 
+  // Columns which none of the input rowsets have ever materialized -- neither
+  // in base data nor in any delta store -- are all-default in the merged
+  // output, so there is no need to write a cfile full of defaults for them.
+  // Leaving them sparse means that adding a column doesn't cause every
+  // subsequent compaction to materialize its default for every row; readers
+  // keep serving such columns from the schema defaults. MemRowSet inputs
+  // always report that they may have data, so flushes are unaffected.
+  std::set<ColumnId> skipped_cols;
+  const Schema& out_schema = merge->schema();
+  for (size_t col_idx = out_schema.num_key_columns();
+       col_idx < out_schema.num_columns(); col_idx++) {
+    const ColumnSchema& col = out_schema.column(col_idx);
+    // Mirror the read path's requirement for sparse columns.
+    if (!col.is_nullable() && !col.has_read_default()) continue;
+    ColumnId col_id = out_schema.column_id(col_idx);
+    bool may_have_data = false;
+    for (const shared_ptr<RowSet>& rs : input.rowsets()) {
+      if (rs->MayHaveDataForColumn(col_id)) {
+        may_have_data = true;
+        break;
+      }
+    }
+    if (!may_have_data) {
+      InsertOrDie(&skipped_cols, col_id);
+    }
+  }
+
   RollingDiskRowSetWriter drsw(metadata_.get(), merge->schema(), bloom_sizing(),
                                compaction_policy_->target_rowset_size());
+  drsw.SetSkippedColumns(std::move(skipped_cols));
+  if (FLAGS_tablet_compaction_num_output_key_ranges > 1) {
+    // Partition the output at key boundaries so that the resulting rowsets
+    // cover disjoint key ranges of roughly equal size. A flush has only the
+    // MemRowSet as input, which has no bounds, so this is a no-op there.
+    vector<string> split_keys;
+    RowSetInfo::ChooseCompactionSplitKeys(input.rowsets(),
+                                          FLAGS_tablet_compaction_num_output_key_ranges,
+                                          &split_keys);
+    drsw.SetRollBoundaries(std::move(split_keys));
+  }
+  drsw.SetIoThrottle(maintenance_io_throttle_.get());
   RETURN_NOT_OK_PREPEND(drsw.Open(), "Failed to open DiskRowSet for flush");
 
   HistoryGcOpts history_gc_opts = GetHistoryGcOpts();
@@ -1456,6 +1751,10 @@ Status Tablet::CaptureConsistentIterators(
         spec->exclusive_upper_bound_key()->encoded_key(),
         &interval_sets);
     for (const RowSet *rs : interval_sets) {
+      if (spec->has_mutated_since() &&
+          !rs->MayHaveMutationsAtOrAfter(spec->mutated_since())) {
+        continue;
+      }
       gscoped_ptr<RowwiseIterator> row_it;
       RETURN_NOT_OK_PREPEND(rs->NewRowIterator(projection, snap, order, &row_it),
                             Substitute("Could not create iterator for rowset $0",
@@ -1469,6 +1768,12 @@ Status Tablet::CaptureConsistentIterators(
   // If there are no encoded predicates or they represent an open-ended range, then
   // fall back to grabbing all rowset iterators
   for (const shared_ptr<RowSet> &rs : components_->rowsets->all_rowsets()) {
+    // Cull rowsets with no activity in the time range of an incremental
+    // (diff) scan.
+    if (spec != nullptr && spec->has_mutated_since() &&
+        !rs->MayHaveMutationsAtOrAfter(spec->mutated_since())) {
+      continue;
+    }
     gscoped_ptr<RowwiseIterator> row_it;
     RETURN_NOT_OK_PREPEND(rs->NewRowIterator(projection, snap, order, &row_it),
                           Substitute("Could not create iterator for rowset $0",
@@ -1497,6 +1802,83 @@ Status Tablet::CountRows(uint64_t *count) const {
   return Status::OK();
 }
 
+Status Tablet::EstimateRowsAndBytesInRange(const EncodedKey* start_key,
+                                           const EncodedKey* stop_key,
+                                           uint64_t* row_count,
+                                           uint64_t* bytes) const {
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+
+  // Sum the per-rowset estimates. The MemRowSet contributes zeros (see
+  // RowSet::EstimateRowsAndBytesInRange()), and rows which appear in several
+  // rowsets are counted once per rowset, so this is an estimate of scan
+  // effort rather than an exact count of live rows.
+  *row_count = 0;
+  *bytes = 0;
+  for (const shared_ptr<RowSet>& rowset : comps->rowsets->all_rowsets()) {
+    uint64_t rs_rows, rs_bytes;
+    RETURN_NOT_OK(rowset->EstimateRowsAndBytesInRange(start_key, stop_key,
+                                                      &rs_rows, &rs_bytes));
+    *row_count += rs_rows;
+    *bytes += rs_bytes;
+  }
+  return Status::OK();
+}
+
+void Tablet::SplitKeyRange(const Slice& start_key,
+                           const Slice& stop_key,
+                           uint64_t target_chunk_size_bytes,
+                           vector<KeyRange>* ranges) const {
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+
+  // Gather the maximum keys and size estimates of the rowsets which overlap
+  // the requested range. Rowsets without known bounds (i.e. the MemRowSet)
+  // are skipped: in-memory data is small relative to on-disk data and has no
+  // cheap way to provide split points.
+  //
+  // Each rowset's size is attributed to its maximum key, which then becomes
+  // a candidate split point.
+  vector<pair<string, uint64_t>> candidates;
+  for (const shared_ptr<RowSet> &rowset : comps->rowsets->all_rowsets()) {
+    string min_key, max_key;
+    if (!rowset->GetBounds(&min_key, &max_key).ok()) {
+      continue;
+    }
+    if (!stop_key.empty() && Slice(min_key).compare(stop_key) >= 0) {
+      continue;
+    }
+    if (!start_key.empty() && Slice(max_key).compare(start_key) < 0) {
+      continue;
+    }
+    candidates.emplace_back(std::move(max_key), rowset->EstimateOnDiskSize());
+  }
+  std::sort(candidates.begin(), candidates.end());
+
+  // Walk the candidate split points in key order, accumulating sizes and
+  // cutting a new range whenever the accumulated size reaches the target.
+  string cur_start = start_key.ToString();
+  uint64_t cur_size = 0;
+  for (const auto& candidate : candidates) {
+    cur_size += candidate.second;
+    if (target_chunk_size_bytes == 0 || cur_size < target_chunk_size_bytes) {
+      continue;
+    }
+    const string& split_key = candidate.first;
+    // Only split at keys which actually advance the range and fall strictly
+    // inside the requested bounds; otherwise keep accumulating.
+    if (split_key.empty() ||
+        (!cur_start.empty() && split_key <= cur_start) ||
+        (!stop_key.empty() && Slice(split_key).compare(stop_key) >= 0)) {
+      continue;
+    }
+    ranges->push_back(KeyRange{cur_start, split_key, cur_size});
+    cur_start = split_key;
+    cur_size = 0;
+  }
+  ranges->push_back(KeyRange{std::move(cur_start), stop_key.ToString(), cur_size});
+}
+
 size_t Tablet::MemRowSetSize() const {
   scoped_refptr<TabletComponents> comps;
   GetComponents(&comps);
@@ -1515,10 +1897,30 @@ bool Tablet::MemRowSetEmpty() const {
 }
 
 size_t Tablet::MemRowSetLogReplaySize(const ReplaySizeMap& replay_size_map) const {
-  scoped_refptr<TabletComponents> comps;
-  GetComponents(&comps);
+  // A frozen memrowset retains its log anchors until it is flushed, so the
+  // minimum unflushed index must consider frozen memrowsets as well as the
+  // active one.
+  int64_t min_index;
+  {
+    shared_lock<rw_spinlock> l(component_lock_);
+    min_index = components_->memrowset->MinUnflushedLogIndex();
+    for (const shared_ptr<MemRowSet>& mrs : frozen_mrss_) {
+      int64_t idx = mrs->MinUnflushedLogIndex();
+      if (idx != -1 && (min_index == -1 || idx < min_index)) {
+        min_index = idx;
+      }
+    }
+  }
+  return GetReplaySizeForIndex(min_index, replay_size_map);
+}
 
-  return GetReplaySizeForIndex(comps->memrowset->MinUnflushedLogIndex(), replay_size_map);
+size_t Tablet::FrozenMemRowSetsSize() const {
+  shared_lock<rw_spinlock> l(component_lock_);
+  size_t ret = 0;
+  for (const shared_ptr<MemRowSet>& mrs : frozen_mrss_) {
+    ret += mrs->memory_footprint();
+  }
+  return ret;
 }
 
 size_t Tablet::EstimateOnDiskSize() const {
@@ -1756,7 +2158,8 @@ Tablet::Iterator::Iterator(const Tablet* tablet, const Schema& projection,
     : tablet_(tablet),
       projection_(projection),
       snap_(std::move(snap)),
-      order_(order) {}
+      order_(order),
+      fence_arena_(256, 4 * 1024) {}
 
 Tablet::Iterator::~Iterator() {}
 
@@ -1765,6 +2168,31 @@ Status Tablet::Iterator::Init(ScanSpec *spec) {
 
   RETURN_NOT_OK(tablet_->GetMappedReadProjection(projection_, &projection_));
 
+  // If the tablet was created by a logical split, constrain the scan to its
+  // split key fence: rowsets inherited from the pre-split parent still
+  // contain rows which now belong to the sibling tablet. The fence is
+  // intersected with any bounds the client supplied (the Set*BoundKey()
+  // calls keep the tighter of the two), and the key columns push the bounds
+  // down into the underlying rowset iterators.
+  string fence_lower, fence_upper;
+  if (tablet_->metadata()->GetSplitKeyFence(&fence_lower, &fence_upper)) {
+    if (spec == nullptr) {
+      fence_spec_.reset(new ScanSpec);
+      spec = fence_spec_.get();
+    }
+    const Schema& tablet_schema = *tablet_->schema();
+    if (!fence_lower.empty()) {
+      RETURN_NOT_OK(EncodedKey::DecodeEncodedString(
+          tablet_schema, &fence_arena_, fence_lower, &fence_lower_));
+      spec->SetLowerBoundKey(fence_lower_.get());
+    }
+    if (!fence_upper.empty()) {
+      RETURN_NOT_OK(EncodedKey::DecodeEncodedString(
+          tablet_schema, &fence_arena_, fence_upper, &fence_upper_));
+      spec->SetExclusiveUpperBoundKey(fence_upper_.get());
+    }
+  }
+
   vector<shared_ptr<RowwiseIterator>> iters;
 
   RETURN_NOT_OK(tablet_->CaptureConsistentIterators(&projection_, snap_, spec, order_, &iters));
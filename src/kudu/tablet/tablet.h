@@ -33,9 +33,11 @@
 #include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_metadata.h"
+#include "kudu/tablet/rowset_tree.h"
 #include "kudu/tablet/tablet_mem_trackers.h"
 #include "kudu/tablet/tablet_metadata.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/semaphore.h"
 #include "kudu/util/slice.h"
@@ -44,9 +46,11 @@
 
 namespace kudu {
 
+class EncodedKey;
 class MemTracker;
 class MetricEntity;
 class RowChangeList;
+class SchemaPB;
 class UnionIterator;
 
 namespace log {
@@ -66,6 +70,7 @@ namespace tablet {
 class AlterSchemaTransactionState;
 class CompactionPolicy;
 class HistoryGcOpts;
+class MaintenanceIoThrottle;
 class MemRowSet;
 class MvccSnapshot;
 struct RowOp;
@@ -75,6 +80,17 @@ struct TabletComponents;
 struct TabletMetrics;
 class WriteTransactionState;
 
+// A range of encoded primary keys, along with an estimate of the amount of
+// on-disk data it covers. Produced by Tablet::SplitKeyRange().
+struct KeyRange {
+  // Encoded start key (inclusive). Empty means the start of the tablet.
+  std::string start_primary_key;
+  // Encoded stop key (exclusive). Empty means the end of the tablet.
+  std::string stop_primary_key;
+  // Estimated on-disk size of the data in the range.
+  uint64_t size_bytes;
+};
+
 class Tablet {
  public:
   typedef std::map<int64_t, int64_t> ReplaySizeMap;
@@ -108,6 +124,15 @@ class Tablet {
 
   void Shutdown();
 
+  // Decode the client schema from 'pb' into '*schema', consulting a small
+  // per-tablet cache of previously decoded schemas.
+  //
+  // Nearly all clients send an identical schema on every write request, so
+  // this keys a single-entry cache on the serialized bytes of 'pb', letting
+  // the hot write path skip the full SchemaFromPB() decode. The cache is
+  // dropped when the tablet's schema is altered.
+  Status GetCachedClientSchema(const SchemaPB& pb, SchemaPtr* schema);
+
   // Decode the Write (insert/mutate) operations from within a user's
   // request.
   Status DecodeWriteOperations(const Schema* client_schema,
@@ -131,24 +156,6 @@ class Tablet {
   // don't boot a tablet server.
   void AssignTimestampAndStartTransactionForTests(WriteTransactionState* tx_state);
 
-  // Insert a new row into the tablet.
-  //
-  // The provided 'data' slice should have length equivalent to this
-  // tablet's Schema.byte_size().
-  //
-  // After insert, the row and any referred-to memory (eg for strings)
-  // have been copied into internal memory, and thus the provided memory
-  // buffer may safely be re-used or freed.
-  //
-  // Returns Status::AlreadyPresent() if an entry with the same key is already
-  // present in the tablet.
-  // Returns Status::OK unless allocation fails.
-  //
-  // Acquires the row lock for the given operation, setting it in the
-  // RowOp struct. This also sets the row op's RowSetKeyProbe.
-  Status AcquireLockForOp(WriteTransactionState* tx_state,
-                          RowOp* op);
-
   // Signal that the given transaction is about to Apply.
   void StartApplying(WriteTransactionState* tx_state);
 
@@ -180,6 +187,20 @@ class Tablet {
   // To do that, call FlushBiggestDMS() for example.
   Status Flush();
 
+  // Freeze the current MemRowSet in memory rather than flushing it: the
+  // frozen MemRowSet stays scannable in the rowset tree, and is written to
+  // disk together with later MemRowSets by the next Flush(). See
+  // FreezeMemRowSetUnlocked().
+  Status FreezeMemRowSet();
+
+  // Open the DiskRowSet described by 'rowset_meta', whose blocks must
+  // already be written and closed, and atomically insert it into the rowset
+  // tree. The new rowset is made durable by flushing the tablet metadata
+  // before returning. Used by the bulk ingest path to adopt externally
+  // written rowsets; the ingested rows have no associated MVCC history, so
+  // they are visible to snapshot scans at any timestamp.
+  Status AdoptRowSet(const std::shared_ptr<RowSetMetadata>& rowset_meta);
+
   // Prepares the transaction context for the alter schema operation.
   // An error will be returned if the specified schema is invalid (e.g.
   // key mismatch, or missing IDs)
@@ -234,6 +255,11 @@ class Tablet {
   // the current MRS.
   size_t MemRowSetLogReplaySize(const ReplaySizeMap& replay_size_map) const;
 
+  // Returns the combined memory footprint of frozen MemRowSets whose flush
+  // has been deferred. See FreezeMemRowSetUnlocked().
+  // This method takes a read lock on component_lock_ and is thread-safe.
+  size_t FrozenMemRowSetsSize() const;
+
   // Estimate the total on-disk size of this tablet, in bytes.
   size_t EstimateOnDiskSize() const;
 
@@ -278,6 +304,33 @@ class Tablet {
   // memrowset in the current implementation.
   Status CountRows(uint64_t *count) const;
 
+  // Split the primary key range ['start_key', 'stop_key') into ranges of
+  // roughly 'target_chunk_size_bytes' of on-disk data each, appending them
+  // to 'ranges' in ascending key order. An empty 'start_key' or 'stop_key'
+  // means the start or end of the tablet, respectively.
+  //
+  // Split points are limited to the bounds of the tablet's rowsets, so the
+  // returned ranges are estimates: they may be arbitrarily larger or smaller
+  // than the target size, and in-memory data is not accounted for. If no
+  // split points are available (or 'target_chunk_size_bytes' is zero), a
+  // single range covering the whole request is returned.
+  //
+  // This method takes a read lock on component_lock_ and is thread-safe.
+  void SplitKeyRange(const Slice& start_key,
+                     const Slice& stop_key,
+                     uint64_t target_chunk_size_bytes,
+                     std::vector<KeyRange>* ranges) const;
+
+  // Estimate the number of rows and on-disk bytes in the given encoded
+  // primary key range using only key index and footer statistics; no data
+  // blocks are read. A null bound leaves that side unbounded. The estimate
+  // ignores in-memory data and deletions, and counts rows which appear in
+  // multiple rowsets once per rowset.
+  Status EstimateRowsAndBytesInRange(const EncodedKey* start_key,
+                                     const EncodedKey* stop_key,
+                                     uint64_t* row_count,
+                                     uint64_t* bytes) const;
+
 
   // Verbosely dump this entire tablet to the logs. This is only
   // really useful when debugging unit tests failures where the tablet
@@ -326,6 +379,18 @@ class Tablet {
   // Calculates history GC options based on properties of the Clock implementation.
   HistoryGcOpts GetHistoryGcOpts() const;
 
+  // Estimate the total number of bytes in UNDO delta stores, across all
+  // rowsets, which are older than the ancient history mark and could be
+  // deleted by DeleteAncientUndoDeltas(). Returns 0 if history GC is
+  // disabled.
+  int64_t EstimateBytesInAncientUndoDeltas() const;
+
+  // Delete UNDO delta stores which are entirely older than the ancient
+  // history mark, without rewriting any other data. Sets 'blocks_deleted'
+  // and 'bytes_deleted' to what was removed across all rowsets. A no-op
+  // if history GC is disabled.
+  Status DeleteAncientUndoDeltas(int64_t* blocks_deleted, int64_t* bytes_deleted);
+
   // Method used by tests to retrieve all rowsets of this table. This
   // will be removed once code for selecting the appropriate RowSet is
   // finished and delta files is finished is part of Tablet class.
@@ -344,6 +409,11 @@ class Tablet {
   // May be NULL in unit tests, etc.
   TabletMetrics* metrics() { return metrics_.get(); }
 
+  // Return the feedback throttle applied to this tablet's maintenance I/O.
+  MaintenanceIoThrottle* maintenance_io_throttle() {
+    return maintenance_io_throttle_.get();
+  }
+
   // Return handle to the metric entity of this tablet.
   const scoped_refptr<MetricEntity>& GetMetricEntity() const {
     return metric_entity_;
@@ -367,6 +437,16 @@ class Tablet {
 
   Status FlushUnlocked();
 
+  // Like FlushUnlocked(), but rather than writing the current MemRowSet to
+  // disk, swaps it into the rowset tree as a frozen, still-scannable rowset
+  // and defers the disk flush. The next FlushUnlocked() flushes all frozen
+  // MemRowSets together with the active one into a single DiskRowSet,
+  // producing fewer, larger rowsets than flushing each MemRowSet
+  // individually would.
+  //
+  // Requires that the caller holds 'rowsets_flush_sem_'.
+  Status FreezeMemRowSetUnlocked();
+
   // Validate the given insert/upsert operation. In particular, checks that the size
   // of any cells is not too large given the configured maximum on the server, and
   // that the encoded key is not too large.
@@ -397,10 +477,13 @@ class Tablet {
                              RowSet* rowset,
                              ProbeStats* stats);
 
-  // Return the list of RowSets that need to be consulted when processing the
-  // given insertion or mutation.
-  static std::vector<RowSet*> FindRowSetsToCheck(RowOp* op,
-                                                 const TabletComponents* comps);
+  // Populate the list of RowSets that need to be consulted when processing
+  // the given insertion or mutation. 'to_check' is cleared first. The result
+  // is written into a stack-allocated small vector so that the per-write
+  // candidate lookup does no heap allocation in the common case.
+  static void FindRowSetsToCheck(RowOp* op,
+                                 const TabletComponents* comps,
+                                 RowSetTree::SmallRowSetVector* to_check);
 
 
   // Capture a set of iterators which, together, reflect all of the data in the tablet.
@@ -504,6 +587,12 @@ class Tablet {
   // released after the schema change has been applied.
   mutable rw_semaphore schema_lock_;
 
+  // Single-entry cache of the most recently decoded client schema, keyed
+  // by the serialized bytes of its SchemaPB. See GetCachedClientSchema().
+  mutable simple_spinlock client_schema_cache_lock_;
+  std::string client_schema_cache_key_;
+  SchemaPtr client_schema_cache_;
+
   const Schema key_schema_;
 
   scoped_refptr<TabletMetadata> metadata_;
@@ -540,8 +629,19 @@ class Tablet {
 
   std::unique_ptr<Throttler> throttler_;
 
+  // Feedback throttle for maintenance I/O (flushes and compactions). See
+  // MaintenanceIoThrottle. Always non-NULL, but disabled by default.
+  gscoped_ptr<MaintenanceIoThrottle> maintenance_io_throttle_;
+
   int64_t next_mrs_id_;
 
+  // MemRowSets frozen by FreezeMemRowSetUnlocked() but not yet flushed,
+  // along with their held compact_flush_lock()s (which keep concurrent
+  // compactions from selecting them). Reads are protected by
+  // 'component_lock_'; mutations additionally require 'rowsets_flush_sem_'.
+  std::vector<std::shared_ptr<MemRowSet> > frozen_mrss_;
+  std::vector<std::unique_lock<std::mutex> > frozen_mrs_locks_;
+
   // A pointer to the server's clock.
   scoped_refptr<server::Clock> clock_;
 
@@ -637,6 +737,14 @@ class Tablet::Iterator : public RowwiseIterator {
   const MvccSnapshot snap_;
   const OrderMode order_;
   gscoped_ptr<RowwiseIterator> iter_;
+
+  // Storage for the split key fence bounds applied to the scan spec in
+  // Init(), if the tablet was created by a logical split. The decoded keys
+  // must outlive the underlying iterators, which retain pointers to them.
+  Arena fence_arena_;
+  gscoped_ptr<EncodedKey> fence_lower_;
+  gscoped_ptr<EncodedKey> fence_upper_;
+  gscoped_ptr<ScanSpec> fence_spec_;
 };
 
 // Structure which represents the components of the tablet's storage.
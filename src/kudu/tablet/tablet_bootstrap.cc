@@ -37,7 +37,6 @@
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stl_util.h"
-#include "kudu/gutil/strings/human_readable.h"
 #include "kudu/gutil/strings/strcat.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/strings/util.h"
@@ -51,6 +50,7 @@
 #include "kudu/tablet/tablet_peer.h"
 #include "kudu/tablet/transactions/alter_schema_transaction.h"
 #include "kudu/tablet/transactions/write_transaction.h"
+#include "kudu/util/countdown_latch.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
@@ -59,6 +59,7 @@
 #include "kudu/util/path_util.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/stopwatch.h"
+#include "kudu/util/threadpool.h"
 
 DEFINE_bool(skip_remove_old_recovery_dir, false,
             "Skip removing WAL recovery dir after startup. (useful for debugging)");
@@ -222,6 +223,27 @@ class TabletBootstrap {
   // later on when then tablet is rebuilt and starts accepting writes from clients.
   Status PlaySegments(ConsensusBootstrapInfo* results);
 
+  // The result of reading and parsing all of the entries of a single log
+  // segment, filled in by ReadSegmentEntries().
+  struct SegmentEntries {
+    SegmentEntries() : ready(1) {}
+
+    // Counted down once 'status' and 'entries' have been fully filled in.
+    CountDownLatch ready;
+    Status status;
+    vector<unique_ptr<LogEntryPB>> entries;
+  };
+
+  // Reads and parses all of the entries of 'segment' into 'out->entries',
+  // then sets 'out->status' and counts down 'out->ready'. On a corrupt or
+  // unreadable entry, 'out->status' describes how far the read got; the
+  // successfully-parsed preceding entries are retained.
+  //
+  // Runs on the WAL read pool so that reading segment N+1 is pipelined
+  // with replaying segment N.
+  void ReadSegmentEntries(const scoped_refptr<ReadableLogSegment>& segment,
+                          const shared_ptr<SegmentEntries>& out);
+
   // Append the given commit message to the log.
   // Does not support writing a TxResult.
   Status AppendCommitMsg(const CommitMsg& commit_msg);
@@ -1021,6 +1043,33 @@ void TabletBootstrap::DumpReplayStateToLog(const ReplayState& state) {
   }
 }
 
+void TabletBootstrap::ReadSegmentEntries(const scoped_refptr<ReadableLogSegment>& segment,
+                                         const shared_ptr<SegmentEntries>& out) {
+  log::LogEntryReader reader(segment.get());
+  Status s;
+  while (true) {
+    unique_ptr<LogEntryPB> entry(new LogEntryPB);
+    s = reader.ReadNextEntry(entry.get());
+    if (PREDICT_FALSE(!s.ok())) {
+      if (s.IsEndOfFile()) {
+        s = Status::OK();
+      } else {
+        s = Status::Corruption(Substitute("Error reading Log Segment of tablet $0: $1 "
+                                          "(Read up to entry $2 of segment $3, in path $4)",
+                                          tablet_->tablet_id(),
+                                          s.ToString(),
+                                          out->entries.size(),
+                                          segment->header().sequence_number(),
+                                          segment->path()));
+      }
+      break;
+    }
+    out->entries.push_back(std::move(entry));
+  }
+  out->status = s;
+  out->ready.CountDown();
+}
+
 Status TabletBootstrap::PlaySegments(ConsensusBootstrapInfo* consensus_info) {
   ReplayState state;
   log::SegmentSequence segments;
@@ -1049,29 +1098,48 @@ Status TabletBootstrap::PlaySegments(ConsensusBootstrapInfo* consensus_info) {
   const auto kStatusUpdateInterval = MonoDelta::FromSeconds(5);
   int segment_count = 0;
 
-  for (const scoped_refptr<ReadableLogSegment>& segment : segments) {
-    log::LogEntryReader reader(segment.get());
+  // While the entries of one segment are being replayed, a background thread
+  // reads and parses the following segment, so that replay doesn't stall on
+  // I/O between segments.
+  gscoped_ptr<ThreadPool> read_pool;
+  RETURN_NOT_OK_PREPEND(ThreadPoolBuilder("wal-read")
+                        .set_max_threads(1)
+                        .Build(&read_pool),
+                        "Failed to create WAL read pool");
+
+  // Kick off the read of the first segment.
+  shared_ptr<SegmentEntries> next_entries;
+  if (!segments.empty()) {
+    next_entries = std::make_shared<SegmentEntries>();
+    scoped_refptr<ReadableLogSegment> seg = segments[0];
+    shared_ptr<SegmentEntries> out = next_entries;
+    RETURN_NOT_OK(read_pool->SubmitFunc([this, seg, out]() {
+      ReadSegmentEntries(seg, out);
+    }));
+  }
 
-    int entry_count = 0;
-    while (true) {
-      unique_ptr<LogEntryPB> entry(new LogEntryPB);
+  for (int seg_idx = 0; seg_idx < segments.size(); seg_idx++) {
+    const scoped_refptr<ReadableLogSegment>& segment = segments[seg_idx];
+    shared_ptr<SegmentEntries> cur_entries = next_entries;
+
+    // Start reading the next segment before replaying this one.
+    if (seg_idx + 1 < segments.size()) {
+      next_entries = std::make_shared<SegmentEntries>();
+      scoped_refptr<ReadableLogSegment> seg = segments[seg_idx + 1];
+      shared_ptr<SegmentEntries> out = next_entries;
+      RETURN_NOT_OK(read_pool->SubmitFunc([this, seg, out]() {
+        ReadSegmentEntries(seg, out);
+      }));
+    }
 
-      Status s = reader.ReadNextEntry(entry.get());
-      if (PREDICT_FALSE(!s.ok())) {
-        if (s.IsEndOfFile()) {
-          break;
-        }
-        return Status::Corruption(Substitute("Error reading Log Segment of tablet $0: $1 "
-                                             "(Read up to entry $2 of segment $3, in path $4)",
-                                             tablet_->tablet_id(),
-                                             s.ToString(),
-                                             entry_count,
-                                             segment->header().sequence_number(),
-                                             segment->path()));
-      }
+    cur_entries->ready.Wait();
+    RETURN_NOT_OK(cur_entries->status);
+
+    int entry_count = 0;
+    for (unique_ptr<LogEntryPB>& entry : cur_entries->entries) {
       entry_count++;
 
-      s = HandleEntry(&state, entry.get());
+      Status s = HandleEntry(&state, entry.get());
       if (!s.ok()) {
         DumpReplayStateToLog(state);
         RETURN_NOT_OK_PREPEND(s, DebugInfo(tablet_->tablet_id(),
@@ -1086,10 +1154,9 @@ Status TabletBootstrap::PlaySegments(ConsensusBootstrapInfo* consensus_info) {
       auto now = MonoTime::Now();
       if (now - last_status_update > kStatusUpdateInterval) {
         StatusMessage(Substitute("Bootstrap replaying log segment $0/$1 "
-                                 "($2/$3 this segment, stats: $4)",
+                                 "(entry $2/$3 this segment, stats: $4)",
                                  segment_count + 1, log_reader_->num_segments(),
-                                 HumanReadableNumBytes::ToString(reader.offset()),
-                                 HumanReadableNumBytes::ToString(reader.read_up_to_offset()),
+                                 entry_count, cur_entries->entries.size(),
                                  stats_.ToString()));
         last_status_update = now;
       }
@@ -15,16 +15,22 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <boost/optional.hpp>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
+#include <vector>
 
 #include "kudu/common/schema.h"
 #include "kudu/common/wire_protocol-test-util.h"
+#include "kudu/fs/block_id.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/tablet/local_tablet_writer.h"
 #include "kudu/tablet/tablet-test-util.h"
 #include "kudu/util/pb_util.h"
 
+DECLARE_bool(tablet_deferred_block_deletion);
+
 namespace kudu {
 namespace tablet {
 
@@ -94,6 +100,38 @@ TEST_F(TestTabletMetadata, TestLoadFromSuperBlock) {
             << SecureDebugString(superblock_pb_1);
 }
 
+// Test that with --tablet_deferred_block_deletion enabled, deleting the
+// tablet data only persists the tombstone and the orphaned block list,
+// leaving the blocks on disk until ReclaimOrphanedBlocks() runs.
+TEST_F(TestTabletMetadata, TestDeferredBlockDeletion) {
+  FLAGS_tablet_deferred_block_deletion = true;
+
+  // Write some data to the tablet and flush so there are data blocks.
+  gscoped_ptr<KuduPartialRow> row;
+  BuildPartialRow(0, 0, "foo", &row);
+  writer_->Insert(*row);
+  ASSERT_OK(harness_->tablet()->Flush());
+  harness_->tablet()->Shutdown();
+
+  TabletMetadata* meta = harness_->tablet()->metadata();
+  TabletSuperBlockPB superblock;
+  ASSERT_OK(meta->ToSuperBlock(&superblock));
+  std::vector<BlockIdPB> block_id_pbs;
+  TabletMetadata::CollectBlockIdPBs(superblock, &block_id_pbs);
+  ASSERT_FALSE(block_id_pbs.empty());
+
+  // A deferred delete should return with the blocks still on disk.
+  ASSERT_OK(meta->DeleteTabletData(TABLET_DATA_TOMBSTONED, boost::none));
+  for (const BlockIdPB& block_id_pb : block_id_pbs) {
+    ASSERT_TRUE(fs_manager()->BlockExists(BlockId::FromPB(block_id_pb)));
+  }
+
+  // The background reclaim task deletes the orphans and prunes the list.
+  ASSERT_OK(meta->ReclaimOrphanedBlocks());
+  for (const BlockIdPB& block_id_pb : block_id_pbs) {
+    ASSERT_FALSE(fs_manager()->BlockExists(BlockId::FromPB(block_id_pb)));
+  }
+}
 
 } // namespace tablet
 } // namespace kudu
@@ -31,12 +31,12 @@
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/dynamic_annotations.h"
 #include "kudu/gutil/map-util.h"
-#include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/rowset_metadata.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/status.h"
 #include "kudu/util/trace.h"
@@ -48,6 +48,28 @@ TAG_FLAG(enable_tablet_orphaned_block_deletion, advanced);
 TAG_FLAG(enable_tablet_orphaned_block_deletion, hidden);
 TAG_FLAG(enable_tablet_orphaned_block_deletion, runtime);
 
+DEFINE_bool(tablet_deferred_block_deletion, false,
+            "Whether deleting or tombstoning a tablet only persists a "
+            "tombstone marker and the list of orphaned blocks before "
+            "returning, leaving the blocks to be reclaimed lazily by a "
+            "throttled background task. Makes DeleteTablet O(1) in the "
+            "number of blocks at the cost of disk space being freed later.");
+TAG_FLAG(tablet_deferred_block_deletion, advanced);
+TAG_FLAG(tablet_deferred_block_deletion, experimental);
+
+DEFINE_int32(tablet_orphaned_block_deletion_batch_size, 128,
+             "Number of orphaned blocks deleted per batch by the background "
+             "reclaim task used with --tablet_deferred_block_deletion.");
+TAG_FLAG(tablet_orphaned_block_deletion_batch_size, advanced);
+TAG_FLAG(tablet_orphaned_block_deletion_batch_size, runtime);
+
+DEFINE_int32(tablet_orphaned_block_deletion_batch_interval_ms, 50,
+             "Time to sleep between batches of orphaned block deletions by "
+             "the background reclaim task used with "
+             "--tablet_deferred_block_deletion.");
+TAG_FLAG(tablet_orphaned_block_deletion_batch_interval_ms, advanced);
+TAG_FLAG(tablet_orphaned_block_deletion_batch_interval_ms, runtime);
+
 using std::shared_ptr;
 
 using base::subtle::Barrier_AtomicIncrement;
@@ -176,6 +198,14 @@ Status TabletMetadata::DeleteTabletData(TabletDataState delete_type,
     }
   }
 
+  // In deferred mode, only sync the new tablet_data_state_ and the orphaned
+  // block list to disk: the blocks are reclaimed later, in batches, by
+  // ReclaimOrphanedBlocks(). This keeps deletion O(1) in the number of
+  // blocks.
+  if (FLAGS_tablet_deferred_block_deletion) {
+    return DoFlush(false);
+  }
+
   // Flushing will sync the new tablet_data_state_ to disk and will now also
   // delete all the data.
   RETURN_NOT_OK(Flush());
@@ -187,6 +217,31 @@ Status TabletMetadata::DeleteTabletData(TabletDataState delete_type,
   return Flush();
 }
 
+Status TabletMetadata::ReclaimOrphanedBlocks() {
+  vector<BlockId> orphaned;
+  {
+    std::lock_guard<LockType> l(data_lock_);
+    orphaned.assign(orphaned_blocks_.begin(), orphaned_blocks_.end());
+  }
+
+  const size_t batch_size =
+      std::max(1, FLAGS_tablet_orphaned_block_deletion_batch_size);
+  for (size_t off = 0; off < orphaned.size(); off += batch_size) {
+    vector<BlockId> batch(
+        orphaned.begin() + off,
+        orphaned.begin() + std::min(off + batch_size, orphaned.size()));
+    DeleteOrphanedBlocks(batch);
+    if (off + batch_size < orphaned.size()) {
+      SleepFor(MonoDelta::FromMilliseconds(
+          FLAGS_tablet_orphaned_block_deletion_batch_interval_ms));
+    }
+  }
+
+  // Persist the pruned orphan list, so that restarts don't re-walk the
+  // blocks we just deleted.
+  return DoFlush(false);
+}
+
 bool TabletMetadata::IsTombstonedWithNoBlocks() const {
   std::lock_guard<LockType> l(data_lock_);
   return tablet_data_state_ == TABLET_DATA_TOMBSTONED &&
@@ -230,6 +285,7 @@ TabletMetadata::TabletMetadata(FsManager* fs_manager, string tablet_id,
       next_rowset_idx_(0),
       last_durable_mrs_id_(kNoDurableMemStore),
       schema_(new Schema(schema)),
+      schema_ptr_(schema_),
       schema_version_(0),
       table_name_(std::move(table_name)),
       partition_schema_(std::move(partition_schema)),
@@ -243,8 +299,8 @@ TabletMetadata::TabletMetadata(FsManager* fs_manager, string tablet_id,
 }
 
 TabletMetadata::~TabletMetadata() {
-  STLDeleteElements(&old_schemas_);
-  delete schema_;
+  // 'schema_' and 'old_schemas_' are owned by reference-counted handles;
+  // any SchemaPtr handed out by schema_ptr() keeps its schema alive.
 }
 
 TabletMetadata::TabletMetadata(FsManager* fs_manager, string tablet_id)
@@ -349,6 +405,9 @@ Status TabletMetadata::LoadFromSuperBlock(const TabletSuperBlockPB& superblock)
     } else {
       tombstone_last_logged_opid_ = MinimumOpId();
     }
+
+    split_lower_bound_pk_ = superblock.split_lower_bound_pk();
+    split_upper_bound_pk_ = superblock.split_upper_bound_pk();
   }
 
   // Now is a good time to clean up any orphaned blocks that may have been
@@ -430,6 +489,10 @@ Status TabletMetadata::UnPinFlush() {
 }
 
 Status TabletMetadata::Flush() {
+  return DoFlush(true);
+}
+
+Status TabletMetadata::DoFlush(bool delete_orphaned_blocks) {
   TRACE_EVENT1("tablet", "TabletMetadata::Flush",
                "tablet_id", tablet_id_);
 
@@ -465,7 +528,9 @@ Status TabletMetadata::Flush() {
   //
   // If we crash just before the deletion, we'll retry when reloading from
   // disk; the orphaned blocks were persisted as part of the superblock.
-  DeleteOrphanedBlocks(orphaned);
+  if (delete_orphaned_blocks) {
+    DeleteOrphanedBlocks(orphaned);
+  }
 
   return Status::OK();
 }
@@ -569,10 +634,30 @@ Status TabletMetadata::ToSuperBlockUnlocked(TabletSuperBlockPB* super_block,
     block_id.CopyToPB(pb.mutable_orphaned_blocks()->Add());
   }
 
+  if (!split_lower_bound_pk_.empty()) {
+    pb.set_split_lower_bound_pk(split_lower_bound_pk_);
+  }
+  if (!split_upper_bound_pk_.empty()) {
+    pb.set_split_upper_bound_pk(split_upper_bound_pk_);
+  }
+
   super_block->Swap(&pb);
   return Status::OK();
 }
 
+void TabletMetadata::SetSplitKeyFence(string lower, string upper) {
+  std::lock_guard<LockType> l(data_lock_);
+  split_lower_bound_pk_ = std::move(lower);
+  split_upper_bound_pk_ = std::move(upper);
+}
+
+bool TabletMetadata::GetSplitKeyFence(string* lower, string* upper) const {
+  std::lock_guard<LockType> l(data_lock_);
+  lower->assign(split_lower_bound_pk_);
+  upper->assign(split_upper_bound_pk_);
+  return !split_lower_bound_pk_.empty() || !split_upper_bound_pk_.empty();
+}
+
 Status TabletMetadata::CreateRowSet(shared_ptr<RowSetMetadata> *rowset,
                                     const Schema& schema) {
   AtomicWord rowset_idx = Barrier_AtomicIncrement(&next_rowset_idx_, 1) - 1;
@@ -610,14 +695,15 @@ void TabletMetadata::SetSchema(const Schema& schema, uint32_t version) {
 void TabletMetadata::SetSchemaUnlocked(gscoped_ptr<Schema> new_schema, uint32_t version) {
   DCHECK(new_schema->has_column_ids());
 
-  Schema* old_schema = schema_;
+  SchemaPtr new_schema_ptr(new_schema.release());
   // "Release" barrier ensures that, when we publish the new Schema object,
   // all of its initialization is also visible.
   base::subtle::Release_Store(reinterpret_cast<AtomicWord*>(&schema_),
-                              reinterpret_cast<AtomicWord>(new_schema.release()));
-  if (PREDICT_TRUE(old_schema)) {
-    old_schemas_.push_back(old_schema);
+                              reinterpret_cast<AtomicWord>(new_schema_ptr.get()));
+  if (PREDICT_TRUE(schema_ptr_)) {
+    old_schemas_.push_back(std::move(schema_ptr_));
   }
+  schema_ptr_ = std::move(new_schema_ptr);
   schema_version_ = version;
 }
 
@@ -19,6 +19,7 @@
 
 #include <boost/optional/optional_fwd.hpp>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_set>
 #include <vector>
@@ -127,6 +128,14 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
     return *s;
   }
 
+  // Return a reference-counted handle to the current schema. The handle
+  // stays valid across schema changes and even past the destruction of this
+  // TabletMetadata, and costs only a refcount bump instead of a Schema copy.
+  SchemaPtr schema_ptr() const {
+    std::lock_guard<LockType> l(data_lock_);
+    return schema_ptr_;
+  }
+
   // Returns the partition schema of the tablet's table.
   const PartitionSchema& partition_schema() const {
     return partition_schema_;
@@ -181,10 +190,23 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
   // last_logged_opid is not modified. This is important for roll-forward of
   // partially-tombstoned tablets during crash recovery.
   //
-  // Returns only once all data has been removed.
+  // By default, returns only once all data has been removed. If
+  // --tablet_deferred_block_deletion is enabled, only the tombstone marker
+  // and the orphaned block list are synced to disk before returning; the
+  // blocks themselves are reclaimed later by ReclaimOrphanedBlocks(), making
+  // deletion O(1) in the number of blocks.
   Status DeleteTabletData(TabletDataState delete_type,
                           const boost::optional<consensus::OpId>& last_logged_opid);
 
+  // Delete all currently orphaned blocks in small batches, sleeping between
+  // batches so that reclaiming a large tablet does not monopolize the disks
+  // (see --tablet_orphaned_block_deletion_batch_size and
+  // --tablet_orphaned_block_deletion_batch_interval_ms), then flush the
+  // pruned orphan list so restarts don't re-walk the deleted blocks.
+  // Intended to run on a background thread; see
+  // TSTabletManager::SubmitDeferredTabletReclaim().
+  Status ReclaimOrphanedBlocks();
+
   // Return true if this metadata references no blocks (either live or orphaned) and is
   // already marked as tombstoned. If this is the case, then calling DeleteTabletData
   // would be a no-op.
@@ -214,6 +236,18 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
 
   consensus::OpId tombstone_last_logged_opid() const { return tombstone_last_logged_opid_; }
 
+  // Set the primary key fence bounding the rows this tablet serves. Used when
+  // a tablet is logically split: both children inherit the parent's rowsets
+  // unchanged and each serves only the keys within its fence until compaction
+  // physically separates the data. The bounds are encoded primary keys;
+  // 'lower' is inclusive and 'upper' exclusive, and either may be empty to
+  // leave that side unbounded. The caller must Flush() to persist the fence.
+  void SetSplitKeyFence(std::string lower, std::string upper);
+
+  // Retrieve the split key fence into 'lower'/'upper'. Returns false (leaving
+  // the outputs empty) if this tablet has never been split.
+  bool GetSplitKeyFence(std::string* lower, std::string* upper) const;
+
   // Loads the currently-flushed superblock from disk into the given protobuf.
   Status ReadSuperBlockFromDisk(TabletSuperBlockPB* superblock) const;
 
@@ -263,6 +297,12 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
   // Requires 'flush_lock_'.
   Status ReplaceSuperBlockUnlocked(const TabletSuperBlockPB &pb);
 
+  // The body of Flush(). If 'delete_orphaned_blocks' is false, the orphaned
+  // block list is persisted in the new superblock but the blocks themselves
+  // are not deleted; used by the deferred deletion path so that writing the
+  // tombstone marker is not gated on walking every block.
+  Status DoFlush(bool delete_orphaned_blocks);
+
   // Requires 'data_lock_'.
   Status UpdateUnlocked(const RowSetMetadataIds& to_remove,
                         const RowSetMetadataVector& to_add,
@@ -313,19 +353,25 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
 
   int64_t last_durable_mrs_id_;
 
-  // The current schema version. This is owned by this class.
-  // We don't use gscoped_ptr so that we can do an atomic swap.
+  // Raw pointer to the current schema, published with an atomic swap so
+  // that schema() is lock-free. The pointee is owned by 'schema_ptr_'.
   Schema* schema_;
+
+  // Owning handle to the current schema; schema_ptr() hands out copies of
+  // this. Protected by 'data_lock_'.
+  SchemaPtr schema_ptr_;
+
   uint32_t schema_version_;
   std::string table_name_;
   PartitionSchema partition_schema_;
 
-  // Previous values of 'schema_'.
-  // These are currently kept alive forever, under the assumption that
-  // a given tablet won't have thousands of "alter table" calls.
-  // They are kept alive so that callers of schema() don't need to
-  // worry about reference counting or locking.
-  std::vector<Schema*> old_schemas_;
+  // Previous values of 'schema_ptr_'.
+  // These are kept alive until the metadata is destroyed, under the
+  // assumption that a given tablet won't have thousands of "alter table"
+  // calls, so that callers of schema() don't need to worry about reference
+  // counting or locking. Handles returned by schema_ptr() may additionally
+  // outlive the metadata itself.
+  std::vector<SchemaPtr> old_schemas_;
 
   // Protected by 'data_lock_'.
   std::unordered_set<BlockId, BlockIdHash, BlockIdEqual> orphaned_blocks_;
@@ -337,6 +383,11 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
   // tombstoned. Has no meaning for non-tombstoned tablets.
   consensus::OpId tombstone_last_logged_opid_;
 
+  // Encoded primary key fence for a tablet created by a logical split.
+  // Empty strings when no fence is set. See SetSplitKeyFence().
+  std::string split_lower_bound_pk_;
+  std::string split_upper_bound_pk_;
+
   // If this counter is > 0 then Flush() will not write any data to
   // disk.
   int32_t num_flush_pins_;
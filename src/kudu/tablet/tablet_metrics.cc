@@ -91,6 +91,12 @@ METRIC_DEFINE_counter(tablet, scanner_bytes_scanned_from_disk, "Scanner Bytes Sc
 METRIC_DEFINE_counter(tablet, insertions_failed_dup_key, "Duplicate Key Inserts",
                       kudu::MetricUnit::kRows,
                       "Number of inserts which failed because the key already existed");
+METRIC_DEFINE_counter(tablet, insertions_above_rowset_bounds, "Inserts Above Rowset Bounds",
+                      kudu::MetricUnit::kRows,
+                      "Number of inserts whose key sorted above the bounds of every "
+                      "rowset, so the uniqueness check skipped all rowset lookups. "
+                      "High values indicate a workload which inserts in increasing "
+                      "key order.");
 METRIC_DEFINE_counter(tablet, scans_started, "Scans Started",
                       kudu::MetricUnit::kScanners,
                       "Number of scanners which have been started on this tablet");
@@ -197,6 +203,21 @@ METRIC_DEFINE_histogram(tablet, compact_rs_duration,
   kudu::MetricUnit::kMilliseconds,
   "Time spent compacting RowSets.", 60000LU, 1);
 
+METRIC_DEFINE_gauge_uint32(tablet, undo_delta_block_gc_running,
+  "Undo Delta Block GC Running",
+  kudu::MetricUnit::kMaintenanceOperations,
+  "Number of UNDO delta block GC operations currently running.");
+
+METRIC_DEFINE_histogram(tablet, undo_delta_block_gc_duration,
+  "Undo Delta Block GC Duration",
+  kudu::MetricUnit::kMilliseconds,
+  "Time spent deleting ancient UNDO delta blocks.", 60000LU, 1);
+
+METRIC_DEFINE_counter(tablet, undo_delta_block_gc_bytes_deleted,
+  "Undo Delta Block GC Bytes Deleted",
+  kudu::MetricUnit::kBytes,
+  "Number of bytes deleted by removing ancient UNDO delta blocks.");
+
 METRIC_DEFINE_histogram(tablet, delta_minor_compact_rs_duration,
   "Minor Delta Compaction Duration",
   kudu::MetricUnit::kMilliseconds,
@@ -227,6 +248,7 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(rows_updated),
     MINIT(rows_deleted),
     MINIT(insertions_failed_dup_key),
+    MINIT(insertions_above_rowset_bounds),
     MINIT(scanner_rows_returned),
     MINIT(scanner_cells_returned),
     MINIT(scanner_bytes_returned),
@@ -251,6 +273,9 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     GINIT(compact_rs_running),
     GINIT(delta_minor_compact_rs_running),
     GINIT(delta_major_compact_rs_running),
+    GINIT(undo_delta_block_gc_running),
+    MINIT(undo_delta_block_gc_duration),
+    MINIT(undo_delta_block_gc_bytes_deleted),
     MINIT(flush_dms_duration),
     MINIT(flush_mrs_duration),
     MINIT(compact_rs_duration),
@@ -17,6 +17,7 @@
 
 #include "kudu/tablet/tablet_mm_ops.h"
 
+#include <algorithm>
 #include <mutex>
 
 #include "kudu/util/locks.h"
@@ -237,5 +238,53 @@ scoped_refptr<AtomicGauge<uint32_t> > MajorDeltaCompactionOp::RunningGauge() con
   return tablet_->metrics()->delta_major_compact_rs_running;
 }
 
+////////////////////////////////////////////////////////////
+// UndoDeltaBlockGCOp
+////////////////////////////////////////////////////////////
+
+UndoDeltaBlockGCOp::UndoDeltaBlockGCOp(Tablet* tablet)
+  : MaintenanceOp(Substitute("UndoDeltaBlockGCOp($0)", tablet->tablet_id()),
+                  MaintenanceOp::LOW_IO_USAGE),
+    tablet_(tablet) {
+}
+
+void UndoDeltaBlockGCOp::UpdateStats(MaintenanceOpStats* stats) {
+  // The estimate only consults in-memory metadata, and the ancient history
+  // mark moves forward with time, so the stats are recomputed on every pass
+  // rather than cached.
+  int64_t ancient_bytes = tablet_->EstimateBytesInAncientUndoDeltas();
+
+  // Score the op by the fraction of the tablet's on-disk data which is
+  // ancient undo history: deleting it removes the same fraction of per-scan
+  // undo merging work.
+  int64_t on_disk_bytes = tablet_->EstimateOnDiskSize();
+  double perf_improvement = 0;
+  if (ancient_bytes > 0 && on_disk_bytes > 0) {
+    perf_improvement = std::min(1.0, static_cast<double>(ancient_bytes) /
+                                     static_cast<double>(on_disk_bytes));
+  }
+  stats->set_perf_improvement(perf_improvement);
+  stats->set_runnable(ancient_bytes > 0);
+}
+
+bool UndoDeltaBlockGCOp::Prepare() {
+  return true;
+}
+
+void UndoDeltaBlockGCOp::Perform() {
+  int64_t blocks_deleted;
+  int64_t bytes_deleted;
+  WARN_NOT_OK(tablet_->DeleteAncientUndoDeltas(&blocks_deleted, &bytes_deleted),
+              Substitute("Undo delta block GC failed on $0", tablet_->tablet_id()));
+}
+
+scoped_refptr<Histogram> UndoDeltaBlockGCOp::DurationHistogram() const {
+  return tablet_->metrics()->undo_delta_block_gc_duration;
+}
+
+scoped_refptr<AtomicGauge<uint32_t> > UndoDeltaBlockGCOp::RunningGauge() const {
+  return tablet_->metrics()->undo_delta_block_gc_running;
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -117,6 +117,31 @@ class MajorDeltaCompactionOp : public MaintenanceOp {
   Tablet* const tablet_;
 };
 
+// MaintenanceOp to delete UNDO delta blocks which are entirely older than
+// the tablet's ancient history mark.
+//
+// Unlike major delta compaction, which also removes ancient history as a side
+// effect, this op deletes whole UNDO blocks without rewriting any data, so it
+// reclaims disk space and removes per-scan undo merging cost even on
+// append-mostly tables where compactions rarely trigger.
+class UndoDeltaBlockGCOp : public MaintenanceOp {
+ public:
+  explicit UndoDeltaBlockGCOp(Tablet* tablet);
+
+  virtual void UpdateStats(MaintenanceOpStats* stats) OVERRIDE;
+
+  virtual bool Prepare() OVERRIDE;
+
+  virtual void Perform() OVERRIDE;
+
+  virtual scoped_refptr<Histogram> DurationHistogram() const OVERRIDE;
+
+  virtual scoped_refptr<AtomicGauge<uint32_t> > RunningGauge() const OVERRIDE;
+
+ private:
+  Tablet* const tablet_;
+};
+
 } // namespace tablet
 } // namespace kudu
 
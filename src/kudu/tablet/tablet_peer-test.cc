@@ -109,6 +109,7 @@ class TabletPeerTest : public KuduTabletTest {
       new TabletPeer(make_scoped_refptr(tablet()->metadata()),
                      config_peer,
                      apply_pool_.get(),
+                     nullptr,
                      Bind(&TabletPeerTest::TabletPeerStateChangedCallback,
                           Unretained(this),
                           tablet()->tablet_id())));
@@ -109,6 +109,7 @@ using tserver::TabletServerErrorPB;
 TabletPeer::TabletPeer(const scoped_refptr<TabletMetadata>& meta,
                        const consensus::RaftPeerPB& local_peer_pb,
                        ThreadPool* apply_pool,
+                       ThreadPool* follower_write_apply_pool,
                        Callback<void(const std::string& reason)> mark_dirty_clbk)
     : meta_(meta),
       tablet_id_(meta->tablet_id()),
@@ -116,6 +117,7 @@ TabletPeer::TabletPeer(const scoped_refptr<TabletMetadata>& meta,
       state_(NOT_STARTED),
       last_status_("Tablet initializing..."),
       apply_pool_(apply_pool),
+      follower_write_apply_pool_(follower_write_apply_pool),
       log_anchor_registry_(new LogAnchorRegistry()),
       mark_dirty_clbk_(std::move(mark_dirty_clbk)) {}
 
@@ -566,12 +568,24 @@ Status TabletPeer::NewLeaderTransactionDriver(gscoped_ptr<Transaction> transacti
 
 Status TabletPeer::NewReplicaTransactionDriver(gscoped_ptr<Transaction> transaction,
                                                scoped_refptr<TransactionDriver>* driver) {
+  // Replicated writes may be applied on a dedicated pool so they are not
+  // queued behind other apply work (e.g. alter-schema ops or a backlog of
+  // leader applies). Durability is already guaranteed by the leader's
+  // commit, and the commit message is appended to the WAL asynchronously,
+  // so the fast lane never waits on an fsync. This keeps follower apply
+  // lag low, which is what makes bounded-staleness follower reads usable
+  // under load.
+  ThreadPool* apply_pool = apply_pool_;
+  if (follower_write_apply_pool_ != nullptr &&
+      transaction->tx_type() == Transaction::WRITE_TXN) {
+    apply_pool = follower_write_apply_pool_;
+  }
   scoped_refptr<TransactionDriver> tx_driver = new TransactionDriver(
     &txn_tracker_,
     consensus_.get(),
     log_.get(),
     prepare_pool_.get(),
-    apply_pool_,
+    apply_pool,
     &txn_order_verifier_);
   RETURN_NOT_OK(tx_driver->Init(std::move(transaction), consensus::REPLICA));
   driver->swap(tx_driver);
@@ -80,8 +80,12 @@ class TabletPeer : public RefCountedThreadSafe<TabletPeer>,
                    public consensus::ReplicaTransactionFactory,
                    public TabletStatusListener {
  public:
+  // 'follower_write_apply_pool' is an optional dedicated pool for applying
+  // replicated write operations when this peer is a follower; if NULL,
+  // follower writes are applied on 'apply_pool' like everything else.
   TabletPeer(const scoped_refptr<TabletMetadata>& meta,
              const consensus::RaftPeerPB& local_peer_pb, ThreadPool* apply_pool,
+             ThreadPool* follower_write_apply_pool,
              Callback<void(const std::string& reason)> mark_dirty_clbk);
 
   // Initializes the TabletPeer, namely creating the Log and initializing
@@ -330,6 +334,11 @@ class TabletPeer : public RefCountedThreadSafe<TabletPeer>,
   // the Tablet server.
   ThreadPool* apply_pool_;
 
+  // Optional dedicated pool for applying replicated write operations when
+  // this peer is a follower, so that follower writes are not queued behind
+  // other apply work. May be NULL, in which case 'apply_pool_' is used.
+  ThreadPool* follower_write_apply_pool_;
+
   scoped_refptr<server::Clock> clock_;
 
   scoped_refptr<log::LogAnchorRegistry> log_anchor_registry_;
@@ -27,6 +27,7 @@
 #include "kudu/tablet/tablet_metrics.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/maintenance_manager.h"
+#include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
 
 DEFINE_int32(flush_threshold_mb, 1024,
@@ -40,6 +41,17 @@ DEFINE_int32(flush_threshold_secs, 2 * 60,
              "even if it is not large.");
 TAG_FLAG(flush_threshold_secs, experimental);
 
+DEFINE_int32(flush_mrs_accumulation_target_mb, 0,
+             "When nonzero, a triggered MemRowSet flush first freezes the MemRowSet in "
+             "memory instead of writing it to disk, and the disk flush is deferred until "
+             "the combined size of frozen MemRowSets reaches this target. This produces "
+             "fewer, larger DiskRowSets (and thus less compaction work downstream) at "
+             "the cost of holding more data, and the WAL segments covering it, in "
+             "memory. Frozen MemRowSets are still flushed once the time-based flush "
+             "threshold expires or when the process is under memory pressure. "
+             "If zero, every triggered flush goes straight to disk.");
+TAG_FLAG(flush_mrs_accumulation_target_mb, experimental);
+
 
 METRIC_DEFINE_gauge_uint32(tablet, log_gc_running,
                            "Log GCs Running",
@@ -97,7 +109,8 @@ void FlushMRSOp::UpdateStats(MaintenanceOpStats* stats) {
   std::lock_guard<simple_spinlock> l(lock_);
 
   map<int64_t, int64_t> replay_size_map;
-  if (tablet_peer_->tablet()->MemRowSetEmpty() ||
+  if ((tablet_peer_->tablet()->MemRowSetEmpty() &&
+       tablet_peer_->tablet()->FrozenMemRowSetsSize() == 0) ||
       !tablet_peer_->GetReplaySizeMap(&replay_size_map).ok()) {
     return;
   }
@@ -107,7 +120,10 @@ void FlushMRSOp::UpdateStats(MaintenanceOpStats* stats) {
     stats->set_runnable(lock.try_lock());
   }
 
-  stats->set_ram_anchored(tablet_peer_->tablet()->MemRowSetSize());
+  // Frozen memrowsets awaiting a deferred flush are released by the same
+  // flush as the active one, so they count towards the anchored RAM.
+  stats->set_ram_anchored(tablet_peer_->tablet()->MemRowSetSize() +
+                          tablet_peer_->tablet()->FrozenMemRowSetsSize());
   stats->set_logs_retained_bytes(
       tablet_peer_->tablet()->MemRowSetLogReplaySize(replay_size_map));
 
@@ -128,12 +144,36 @@ bool FlushMRSOp::Prepare() {
 void FlushMRSOp::Perform() {
   CHECK(!tablet_peer_->tablet()->rowsets_flush_sem_.try_lock());
 
-  KUDU_CHECK_OK_PREPEND(tablet_peer_->tablet()->FlushUnlocked(),
-                        Substitute("FlushMRS failed on $0", tablet_peer_->tablet_id()));
-
-  {
+  bool freeze_only = false;
+  if (FLAGS_flush_mrs_accumulation_target_mb > 0) {
+    // Accumulate frozen memrowsets in memory until the target size is
+    // reached, so that the eventual flush produces one large DiskRowSet
+    // instead of several small ones. Don't defer if the time-based flush
+    // threshold has expired (bounding WAL retention), or if the process is
+    // under memory pressure (the point of flushing then is to free RAM).
+    size_t combined_size = tablet_peer_->tablet()->MemRowSetSize() +
+        tablet_peer_->tablet()->FrozenMemRowSetsSize();
+    double capacity_pct;
     std::lock_guard<simple_spinlock> l(lock_);
-    time_since_flush_.start();
+    freeze_only =
+        combined_size < FLAGS_flush_mrs_accumulation_target_mb * 1024 * 1024 &&
+        time_since_flush_.elapsed().wall_millis() < FLAGS_flush_threshold_secs * 1000 &&
+        !MemTracker::GetRootTracker()->AnySoftLimitExceeded(&capacity_pct);
+  }
+
+  if (freeze_only) {
+    KUDU_CHECK_OK_PREPEND(tablet_peer_->tablet()->FreezeMemRowSetUnlocked(),
+                          Substitute("FreezeMemRowSet failed on $0", tablet_peer_->tablet_id()));
+    // Don't restart 'time_since_flush_': the frozen data is still
+    // unpersisted and still anchors the WAL.
+  } else {
+    KUDU_CHECK_OK_PREPEND(tablet_peer_->tablet()->FlushUnlocked(),
+                          Substitute("FlushMRS failed on $0", tablet_peer_->tablet_id()));
+
+    {
+      std::lock_guard<simple_spinlock> l(lock_);
+      time_since_flush_.start();
+    }
   }
   tablet_peer_->tablet()->rowsets_flush_sem_.unlock();
 }
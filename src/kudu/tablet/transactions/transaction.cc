@@ -17,11 +17,41 @@
 
 #include "kudu/tablet/transactions/transaction.h"
 
+#include "kudu/gutil/once.h"
+#include "kudu/util/memory/memory.h"
+
 namespace kudu {
 namespace tablet {
 
 using consensus::DriverType;
 
+namespace {
+
+// Size of the chunks drawn by transaction scratch arenas, and the maximum
+// number of free chunks retained by the process-wide slab pool (8MB in
+// total). Transactions whose row data outgrows the first chunk fall back to
+// regular heap allocations for the larger chunks.
+const size_t kTransactionArenaSlabSize = 8 * 1024;
+const size_t kTransactionArenaMaxFreeSlabs = 1024;
+
+SlabPoolBufferAllocator* g_transaction_arena_allocator = nullptr;
+GoogleOnceType g_transaction_arena_allocator_once = GOOGLE_ONCE_INIT;
+
+void InitTransactionArenaAllocator() {
+  g_transaction_arena_allocator = new SlabPoolBufferAllocator(
+      HeapBufferAllocator::Get(), kTransactionArenaSlabSize, kTransactionArenaMaxFreeSlabs);
+}
+
+// Process-wide pool backing the scratch arenas of all transactions, so that
+// a steady-state write load recycles arena chunks instead of continuously
+// allocating and freeing them.
+BufferAllocator* TransactionArenaAllocator() {
+  GoogleOnceInit(&g_transaction_arena_allocator_once, &InitTransactionArenaAllocator);
+  return g_transaction_arena_allocator;
+}
+
+} // anonymous namespace
+
 Transaction::Transaction(TransactionState* state, DriverType type, TransactionType tx_type)
     : state_(state),
       type_(type),
@@ -32,7 +62,7 @@ TransactionState::TransactionState(TabletPeer* tablet_peer)
     : tablet_peer_(tablet_peer),
       completion_clbk_(new TransactionCompletionCallback()),
       timestamp_error_(0),
-      arena_(1024, 4 * 1024 * 1024),
+      arena_(TransactionArenaAllocator(), kTransactionArenaSlabSize, 4 * 1024 * 1024),
       external_consistency_mode_(CLIENT_PROPAGATED) {
 }
 
@@ -102,7 +102,7 @@ class TransactionTracker;
 //
 // On the leader side, starting the mvcc transaction for writes
 // (calling tablet_->StartTransaction()) must always be done _after_ any relevant row locks are
-// acquired (using AcquireLockForOp). This ensures that, within each row, timestamps only move
+// acquired (using AcquireRowLocks). This ensures that, within each row, timestamps only move
 // forward. If we took a timestamp before getting the row lock, we could have the following
 // situation:
 //
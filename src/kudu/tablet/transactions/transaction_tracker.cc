@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <limits>
+#include <stdint.h>
 #include <vector>
 
 #include "kudu/gutil/map-util.h"
@@ -81,12 +82,24 @@ TransactionTracker::State::State()
   : memory_footprint(0) {
 }
 
-TransactionTracker::TransactionTracker() {
+TransactionTracker::TransactionTracker()
+    : num_pending_(0),
+      pending_bytes_(0) {
 }
 
 TransactionTracker::~TransactionTracker() {
-  std::lock_guard<simple_spinlock> l(lock_);
-  CHECK_EQ(pending_txns_.size(), 0);
+  for (const TxnMapShard& shard : txn_map_shards_) {
+    std::lock_guard<simple_spinlock> l(shard.lock);
+    CHECK_EQ(shard.pending_txns.size(), 0);
+  }
+}
+
+TransactionTracker::TxnMapShard* TransactionTracker::ShardForDriver(
+    const TransactionDriver* driver) const {
+  // Drivers are individually heap-allocated, so the low-order bits of the
+  // pointer carry no entropy (they reflect allocator alignment).
+  uintptr_t p = reinterpret_cast<uintptr_t>(driver);
+  return &txn_map_shards_[(p >> 4) % kNumShards];
 }
 
 Status TransactionTracker::Add(TransactionDriver* driver) {
@@ -111,13 +124,16 @@ Status TransactionTracker::Add(TransactionDriver* driver) {
   }
 
   IncrementCounters(*driver);
+  num_pending_.Increment();
+  pending_bytes_.IncrementBy(driver_mem_footprint);
 
   // Cache the transaction memory footprint so we needn't refer to the request
   // again, as it may disappear between now and then.
   State st;
   st.memory_footprint = driver_mem_footprint;
-  std::lock_guard<simple_spinlock> l(lock_);
-  InsertOrDie(&pending_txns_, driver, st);
+  TxnMapShard* shard = ShardForDriver(driver);
+  std::lock_guard<simple_spinlock> l(shard->lock);
+  InsertOrDie(&shard->pending_txns, driver, st);
   return Status::OK();
 }
 
@@ -161,34 +177,52 @@ void TransactionTracker::Release(TransactionDriver* driver) {
 
   State st;
   {
-    // Remove the transaction from the map, retaining the state for use
+    // Remove the transaction from its shard, retaining the state for use
     // below.
-    std::lock_guard<simple_spinlock> l(lock_);
-    st = FindOrDie(pending_txns_, driver);
-    if (PREDICT_FALSE(pending_txns_.erase(driver) != 1)) {
+    TxnMapShard* shard = ShardForDriver(driver);
+    std::lock_guard<simple_spinlock> l(shard->lock);
+    st = FindOrDie(shard->pending_txns, driver);
+    if (PREDICT_FALSE(shard->pending_txns.erase(driver) != 1)) {
       LOG(FATAL) << "Could not remove pending transaction from map: "
           << driver->ToStringUnlocked();
     }
   }
 
+  num_pending_.IncrementBy(-1);
+  pending_bytes_.IncrementBy(-st.memory_footprint);
+
   if (mem_tracker_) {
     mem_tracker_->Release(st.memory_footprint);
   }
 }
 
+int64_t TransactionTracker::NumPending() const {
+  return num_pending_.Load();
+}
+
+int64_t TransactionTracker::PendingBytes() const {
+  return pending_bytes_.Load();
+}
+
 void TransactionTracker::GetPendingTransactions(
     vector<scoped_refptr<TransactionDriver> >* pending_out) const {
   DCHECK(pending_out->empty());
-  std::lock_guard<simple_spinlock> l(lock_);
-  for (const TxnMap::value_type& e : pending_txns_) {
-    // Increments refcount of each transaction.
-    pending_out->push_back(e.first);
+  for (const TxnMapShard& shard : txn_map_shards_) {
+    std::lock_guard<simple_spinlock> l(shard.lock);
+    for (const TxnMap::value_type& e : shard.pending_txns) {
+      // Increments refcount of each transaction.
+      pending_out->push_back(e.first);
+    }
   }
 }
 
 int TransactionTracker::GetNumPendingForTests() const {
-  std::lock_guard<simple_spinlock> l(lock_);
-  return pending_txns_.size();
+  int num_pending = 0;
+  for (const TxnMapShard& shard : txn_map_shards_) {
+    std::lock_guard<simple_spinlock> l(shard.lock);
+    num_pending += shard.pending_txns.size();
+  }
+  return num_pending;
 }
 
 void TransactionTracker::WaitForAllToFinish() const {
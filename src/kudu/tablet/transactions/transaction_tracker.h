@@ -26,6 +26,7 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/tablet/transactions/transaction.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/locks.h"
 
 namespace kudu {
@@ -63,6 +64,13 @@ class TransactionTracker {
   // Returns number of pending transactions.
   int GetNumPendingForTests() const;
 
+  // Returns the number of transactions currently being tracked, and the
+  // total approximate memory footprint of their requests, respectively.
+  // These are cheap (single atomic load) and suitable for admission-control
+  // checks on the write hot path.
+  int64_t NumPending() const;
+  int64_t PendingBytes() const;
+
   void WaitForAllToFinish() const;
   Status WaitForAllToFinish(const MonoDelta& timeout) const;
 
@@ -86,8 +94,6 @@ class TransactionTracker {
   // Decrements relevant metric counters.
   void DecrementCounters(const TransactionDriver& driver) const;
 
-  mutable simple_spinlock lock_;
-
   // Per-transaction state that is tracked along with the transaction itself.
   struct State {
     State();
@@ -96,12 +102,34 @@ class TransactionTracker {
     int64_t memory_footprint;
   };
 
-  // Protected by 'lock_'.
   typedef std::unordered_map<scoped_refptr<TransactionDriver>,
       State,
       ScopedRefPtrHashFunctor<TransactionDriver>,
       ScopedRefPtrEqualToFunctor<TransactionDriver> > TxnMap;
-  TxnMap pending_txns_;
+
+  // A shard of the tracked-transaction map. The map is sharded by the hash
+  // of the driver pointer so that concurrent Add() and Release() calls from
+  // different RPC and apply threads don't all serialize on a single lock.
+  struct TxnMapShard {
+    mutable simple_spinlock lock;
+
+    // Protected by 'lock'.
+    TxnMap pending_txns;
+  };
+
+  enum { kNumShards = 8 };
+
+  // Returns the shard which tracks 'driver'.
+  TxnMapShard* ShardForDriver(const TransactionDriver* driver) const;
+
+  mutable TxnMapShard txn_map_shards_[kNumShards];
+
+  // Cheap approximations of the total number and memory footprint of the
+  // tracked transactions, maintained by Add() and Release(). Unlike the
+  // metrics above, these are kept regardless of whether instrumentation
+  // has been started.
+  AtomicInt<int64_t> num_pending_;
+  AtomicInt<int64_t> pending_bytes_;
 
   gscoped_ptr<Metrics> metrics_;
 
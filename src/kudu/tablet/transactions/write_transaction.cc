@@ -18,6 +18,7 @@
 #include "kudu/tablet/transactions/write_transaction.h"
 
 #include <algorithm>
+#include <memory>
 #include <vector>
 
 #include "kudu/common/row_operations.h"
@@ -74,11 +75,16 @@ void WriteTransaction::NewReplicateMsg(gscoped_ptr<ReplicateMsg>* replicate_msg)
 Status WriteTransaction::Prepare() {
   TRACE_EVENT0("txn", "WriteTransaction::Prepare");
   TRACE("PREPARE: Starting");
+  Tablet* tablet = state()->tablet_peer()->tablet();
+
   // Decode everything first so that we give up if something major is wrong.
-  Schema client_schema;
-  RETURN_NOT_OK_PREPEND(SchemaFromPB(state_->request()->schema(), &client_schema),
+  // The tablet caches the most recently decoded client schema, so writers
+  // sending the same schema on every request skip the full decode.
+  SchemaPtr client_schema;
+  RETURN_NOT_OK_PREPEND(tablet->GetCachedClientSchema(state_->request()->schema(),
+                                                      &client_schema),
                         "Cannot decode client schema");
-  if (client_schema.has_column_ids()) {
+  if (client_schema->has_column_ids()) {
     // TODO: we have this kind of code a lot - add a new SchemaFromPB variant which
     // does this check inline.
     Status s = Status::InvalidArgument("User requests should not have Column IDs");
@@ -86,9 +92,7 @@ Status WriteTransaction::Prepare() {
     return s;
   }
 
-  Tablet* tablet = state()->tablet_peer()->tablet();
-
-  Status s = tablet->DecodeWriteOperations(&client_schema, state());
+  Status s = tablet->DecodeWriteOperations(client_schema.get(), state());
   if (!s.ok()) {
     // TODO: is MISMATCHED_SCHEMA always right here? probably not.
     state()->completion_callback()->set_error(s, TabletServerErrorPB::MISMATCHED_SCHEMA);
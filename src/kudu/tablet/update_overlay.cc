@@ -0,0 +1,194 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/update_overlay.h"
+
+#include <algorithm>
+#include <mutex>
+#include <string.h>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/common/columnblock.h"
+#include "kudu/common/row_changelist.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/map-util.h"
+#include "kudu/tablet/mvcc.h"
+#include "kudu/util/flag_tags.h"
+
+DEFINE_int64(tablet_update_overlay_max_memory_bytes, 16 * 1024 * 1024,
+             "Maximum amount of memory a single rowset's update overlay may "
+             "use to track in-place values of updated fixed-width columns. "
+             "When exceeded, the overlay disables itself and scans fall back "
+             "to ordinary delta application.");
+TAG_FLAG(tablet_update_overlay_max_memory_bytes, advanced);
+TAG_FLAG(tablet_update_overlay_max_memory_bytes, experimental);
+
+namespace kudu {
+namespace tablet {
+
+namespace {
+
+// Return true if updates to 'col' may be recorded in the overlay: the
+// column must be a non-key, non-nullable, fixed-width column whose values
+// fit in a CellEntry.
+bool IsEligibleColumn(const Schema& schema, int col_idx, size_t max_size) {
+  if (schema.is_key_column(col_idx)) {
+    return false;
+  }
+  const ColumnSchema& col = schema.column(col_idx);
+  return !col.is_nullable() &&
+      col.type_info()->physical_type() != BINARY &&
+      col.type_info()->size() <= max_size;
+}
+
+} // anonymous namespace
+
+UpdateOverlay::UpdateOverlay()
+    : mem_usage_(0),
+      disabled_(false) {
+}
+
+UpdateOverlay::~UpdateOverlay() {
+}
+
+void UpdateOverlay::RecordUpdate(const Schema& schema,
+                                 Timestamp timestamp,
+                                 rowid_t row_idx,
+                                 const RowChangeList& update) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (disabled_) {
+    return;
+  }
+
+  RowChangeListDecoder decoder(update);
+  if (!decoder.Init().ok()) {
+    DisableUnlocked();
+    return;
+  }
+  if (decoder.is_delete()) {
+    // Deletes don't change column values; deleted rows are excluded by the
+    // selection vector regardless of whether delta application is skipped.
+    return;
+  }
+  if (!decoder.is_update()) {
+    // Reinserts can restore any column's prior value and shouldn't reach a
+    // DiskRowSet; be conservative if one does.
+    DisableUnlocked();
+    return;
+  }
+
+  while (decoder.HasNext()) {
+    RowChangeListDecoder::DecodedUpdate dec;
+    if (!decoder.DecodeNext(&dec).ok()) {
+      DisableUnlocked();
+      return;
+    }
+    int col_idx = schema.find_column_by_id(dec.col_id);
+    if (col_idx == Schema::kColumnNotFound) {
+      // A mutation of a column no longer in the schema can't affect scans.
+      continue;
+    }
+    if (dec.null ||
+        !IsEligibleColumn(schema, col_idx, sizeof(CellEntry::value)) ||
+        dec.raw_value.size() != schema.column(col_idx).type_info()->size()) {
+      MarkColumnIncompleteUnlocked(dec.col_id);
+      continue;
+    }
+
+    ColumnState& state = LookupOrInsert(&columns_, dec.col_id, ColumnState());
+    state.newest_timestamp = std::max(state.newest_timestamp, timestamp);
+    if (!state.complete) {
+      // No point tracking cells for a column we'll never serve.
+      continue;
+    }
+    CellEntry& entry = LookupOrInsert(
+        &state.cells, row_idx, CellEntry());
+    if (entry.timestamp == Timestamp::kMin) {
+      mem_usage_ += sizeof(std::pair<const rowid_t, CellEntry>) + 16;
+      if (mem_usage_ > FLAGS_tablet_update_overlay_max_memory_bytes) {
+        DisableUnlocked();
+        return;
+      }
+    }
+    // Mutations are applied to scans in timestamp order, so the newest
+    // timestamp's value wins.
+    if (timestamp >= entry.timestamp) {
+      entry.timestamp = timestamp;
+      memcpy(entry.value, dec.raw_value.data(), dec.raw_value.size());
+    }
+  }
+}
+
+bool UpdateOverlay::TryApplyToColumn(const MvccSnapshot& snap,
+                                     ColumnId col_id,
+                                     rowid_t start_row,
+                                     ColumnBlock* dst) const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (disabled_) {
+    return false;
+  }
+  const ColumnState* state = FindOrNull(columns_, col_id);
+  if (state == nullptr || !state->complete) {
+    return false;
+  }
+  // The snapshot must include every transaction up to the newest recorded
+  // mutation. This implies that it also includes every mutation which
+  // predates the overlay -- e.g. UNDO history written when the rowset was
+  // flushed -- since timestamps are assigned in increasing order, so no
+  // UNDO delta is relevant to 'snap' and the overlaid values are exactly
+  // what full delta application would produce.
+  if (snap.MayHaveUncommittedTransactionsAtOrBefore(state->newest_timestamp)) {
+    return false;
+  }
+
+  const size_t size = dst->type_info()->size();
+  DCHECK_LE(size, sizeof(CellEntry::value));
+  for (size_t i = 0; i < dst->nrows(); i++) {
+    const CellEntry* entry = FindOrNull(state->cells, start_row + i);
+    if (entry != nullptr) {
+      memcpy(dst->mutable_cell_ptr(i), entry->value, size);
+    }
+  }
+  return true;
+}
+
+void UpdateOverlay::Disable() {
+  std::lock_guard<simple_spinlock> l(lock_);
+  DisableUnlocked();
+}
+
+void UpdateOverlay::DisableUnlocked() {
+  disabled_ = true;
+  columns_.clear();
+  mem_usage_ = 0;
+}
+
+size_t UpdateOverlay::memory_footprint() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return mem_usage_;
+}
+
+void UpdateOverlay::MarkColumnIncompleteUnlocked(ColumnId col_id) {
+  ColumnState& state = LookupOrInsert(&columns_, col_id, ColumnState());
+  state.complete = false;
+  state.cells.clear();
+}
+
+} // namespace tablet
+} // namespace kudu
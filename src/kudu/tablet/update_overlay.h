@@ -0,0 +1,143 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TABLET_UPDATE_OVERLAY_H
+#define KUDU_TABLET_UPDATE_OVERLAY_H
+
+#include <unordered_map>
+
+#include "kudu/common/rowid.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/timestamp.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/locks.h"
+
+namespace kudu {
+
+class ColumnBlock;
+class RowChangeList;
+
+namespace tablet {
+
+class MvccSnapshot;
+
+// An in-memory copy-on-write overlay over a DiskRowSet's base data which
+// tracks the newest value of each updated cell for fixed-width, non-nullable,
+// non-key columns.
+//
+// Updates still enter the DeltaMemStore as today, preserving MVCC history,
+// durability and flushes. In addition, eligible SET operations are recorded
+// here. A scan whose snapshot is known to include every mutation ever made
+// to a column of this rowset can then materialize the column by patching the
+// overlaid values directly onto the base data, skipping delta application
+// for that column entirely -- including deltas that have long since been
+// flushed to REDO files. For update-heavy workloads dominated by fixed-width
+// counter columns, this removes the per-scan delta merge cost that otherwise
+// persists until the next major delta compaction.
+//
+// A column is only served from the overlay while it is "complete": every
+// mutation of the column since the overlay was created has been recorded.
+// Updates to ineligible columns (variable-length, nullable, or too large),
+// or mutations predating the overlay (e.g. REDO files found on disk at
+// startup) permanently mark the affected columns (or the whole overlay)
+// as incomplete, and scans fall back to ordinary delta application.
+//
+// This class is thread-safe.
+class UpdateOverlay {
+ public:
+  UpdateOverlay();
+  ~UpdateOverlay();
+
+  // Record the eligible SET operations of the UPDATE changelist 'update',
+  // applied to row 'row_idx' at 'timestamp'. 'schema' is the schema the
+  // changelist was encoded against. Ineligible operations mark their columns
+  // as incomplete. No-op if the overlay is disabled.
+  void RecordUpdate(const Schema& schema,
+                    Timestamp timestamp,
+                    rowid_t row_idx,
+                    const RowChangeList& update);
+
+  // If column 'col_id' can be served from base data plus this overlay under
+  // 'snap' -- the overlay is complete for the column and 'snap' includes
+  // every recorded mutation -- patch the overlaid values for rows
+  // [start_row, start_row + dst->nrows()) onto 'dst' and return true.
+  // The caller may then skip delta application for the column.
+  //
+  // Otherwise, leaves 'dst' untouched and returns false.
+  bool TryApplyToColumn(const MvccSnapshot& snap,
+                        ColumnId col_id,
+                        rowid_t start_row,
+                        ColumnBlock* dst) const;
+
+  // Permanently disable the overlay and release its memory. Used when some
+  // mutations did not pass through RecordUpdate(), e.g. REDO delta files
+  // found on disk when the rowset was opened.
+  void Disable();
+
+  // Approximate memory usage of the recorded cells.
+  size_t memory_footprint() const;
+
+ private:
+  // The newest recorded value of a single cell.
+  struct CellEntry {
+    CellEntry() : timestamp(Timestamp::kMin) {}
+
+    Timestamp timestamp;
+    // The value, little-endian, occupying the column's type size. Large
+    // enough for the widest fixed-width type.
+    uint8_t value[8];
+  };
+
+  // Overlay state for a single column.
+  struct ColumnState {
+    ColumnState() : complete(true), newest_timestamp(Timestamp::kMin) {}
+
+    // True if every mutation of the column since the overlay was created
+    // has been recorded in 'cells'.
+    bool complete;
+
+    // The timestamp of the newest recorded mutation.
+    Timestamp newest_timestamp;
+
+    // Maps row index to the newest recorded value for this column.
+    std::unordered_map<rowid_t, CellEntry> cells;
+  };
+
+  // Marks the column as incomplete and drops its cells. Must be called
+  // with 'lock_' held.
+  void MarkColumnIncompleteUnlocked(ColumnId col_id);
+
+  // Disable() without acquiring 'lock_'. Must be called with 'lock_' held.
+  void DisableUnlocked();
+
+  mutable simple_spinlock lock_;
+
+  // Keyed by column ID.
+  std::unordered_map<int, ColumnState> columns_;
+
+  // Approximate bytes used by 'columns_'. When this exceeds
+  // --tablet_update_overlay_max_memory_bytes the overlay disables itself.
+  size_t mem_usage_;
+
+  bool disabled_;
+
+  DISALLOW_COPY_AND_ASSIGN(UpdateOverlay);
+};
+
+} // namespace tablet
+} // namespace kudu
+
+#endif // KUDU_TABLET_UPDATE_OVERLAY_H
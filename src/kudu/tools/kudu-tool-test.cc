@@ -336,6 +336,7 @@ TEST_F(ToolTest, TestModeHelp) {
   {
     const vector<string> kClusterModeRegexes = {
         "ksck.*Check the health of a Kudu cluster",
+        "list_tablets.*List tablet replicas on every tablet server",
     };
     NO_FATALS(RunTestHelp("cluster", kClusterModeRegexes));
   }
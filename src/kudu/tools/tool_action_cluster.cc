@@ -24,11 +24,19 @@
 
 #include <gflags/gflags.h>
 
+#include "kudu/common/wire_protocol.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/rpc/rpc_controller.h"
+#include "kudu/tablet/tablet.pb.h"
 #include "kudu/tools/ksck.h"
 #include "kudu/tools/ksck_remote.h"
 #include "kudu/tools/tool_action_common.h"
+#include "kudu/tserver/tablet_server.h"
+#include "kudu/tserver/tserver.pb.h"
+#include "kudu/tserver/tserver_service.proxy.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 
 #define PUSH_PREPEND_NOT_OK(s, statuses, msg) do { \
@@ -50,6 +58,8 @@ DEFINE_string(tablets, "",
               "Tablets to check (comma-separated list of IDs) "
               "If not specified, checks all tablets.");
 
+DECLARE_int64(timeout_ms); // defined in tool_action_common
+
 namespace kudu {
 namespace tools {
 
@@ -60,6 +70,10 @@ using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 using std::vector;
+using strings::Substitute;
+using tserver::ListTabletsRequestPB;
+using tserver::ListTabletsResponsePB;
+using tserver::TabletServerServiceProxy;
 
 namespace {
 
@@ -115,6 +129,41 @@ Status RunKsck(const RunnerContext& context) {
   return Status::RuntimeError("ksck discovered errors");
 }
 
+Status ListTabletsOnTS(const string& address, string* out) {
+  unique_ptr<TabletServerServiceProxy> proxy;
+  RETURN_NOT_OK(BuildProxy(address, tserver::TabletServer::kDefaultPort,
+                           &proxy));
+
+  ListTabletsRequestPB req;
+  ListTabletsResponsePB resp;
+  rpc::RpcController rpc;
+  rpc.set_timeout(MonoDelta::FromMilliseconds(FLAGS_timeout_ms));
+  RETURN_NOT_OK(proxy->ListTablets(req, &resp, &rpc));
+  if (resp.has_error()) {
+    return StatusFromPB(resp.error().status());
+  }
+
+  for (const auto& replica : resp.status_and_schema()) {
+    const tablet::TabletStatusPB& ts = replica.tablet_status();
+    *out += Substitute("$0\t$1\t$2\n",
+                       ts.tablet_id(),
+                       ts.table_name(),
+                       tablet::TabletStatePB_Name(ts.state()));
+  }
+  return Status::OK();
+}
+
+Status ListTablets(const RunnerContext& context) {
+  const string& master_addresses_str = FindOrDie(context.required_args,
+                                                 kMasterAddressesArg);
+  vector<string> master_addresses = strings::Split(master_addresses_str, ",");
+
+  vector<string> ts_addresses;
+  RETURN_NOT_OK(GetTabletServerAddresses(master_addresses, &ts_addresses));
+
+  return RunAcrossServers(ts_addresses, &ListTabletsOnTS);
+}
+
 } // anonymous namespace
 
 unique_ptr<Mode> BuildClusterMode() {
@@ -138,9 +187,22 @@ unique_ptr<Mode> BuildClusterMode() {
       .AddOptionalParameter("tablets")
       .Build();
 
+  unique_ptr<Action> list_tablets =
+      ActionBuilder("list_tablets", &ListTablets)
+      .Description("List tablet replicas on every tablet server in the cluster")
+      .ExtraDescription("Contacts up to 'fanout_concurrency' tablet servers "
+          "in parallel and streams each server's replica listing as it "
+          "arrives, so fleet-wide inspections complete quickly even on "
+          "large clusters.")
+      .AddRequiredParameter({ kMasterAddressesArg, kMasterAddressesArgDesc })
+      .AddOptionalParameter("fanout_concurrency")
+      .AddOptionalParameter("timeout_ms")
+      .Build();
+
   return ModeBuilder("cluster")
       .Description("Operate on a Kudu cluster")
       .AddAction(std::move(ksck))
+      .AddAction(std::move(list_tablets))
       .Build();
 }
 
@@ -17,14 +17,17 @@
 
 #include "kudu/tools/tool_action_common.h"
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/client/client.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/row_operations.h"
@@ -34,7 +37,10 @@
 #include "kudu/consensus/log.pb.h"
 #include "kudu/consensus/log_util.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/messenger.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/rpc/rpc_header.pb.h"
@@ -43,13 +49,19 @@
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/tserver/tserver_admin.proxy.h"
 #include "kudu/tserver/tserver_service.proxy.h"
+#include "kudu/util/condition_variable.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/status.h"
+#include "kudu/util/threadpool.h"
 
+DEFINE_int32(fanout_concurrency, 32,
+             "Maximum number of servers to contact in parallel when running "
+             "an operation against every server in the cluster.");
 DEFINE_bool(force, false, "If true, allows the set_flag command to set a flag "
             "which is not explicitly marked as runtime-settable. Such flag "
             "changes may be simply ignored on the server, or may cause the "
@@ -69,6 +81,9 @@ DEFINE_int32(truncate_data, 100,
 namespace kudu {
 namespace tools {
 
+using client::KuduClient;
+using client::KuduClientBuilder;
+using client::KuduTabletServer;
 using consensus::ConsensusServiceProxy;
 using consensus::ReplicateMsg;
 using log::LogEntryPB;
@@ -92,6 +107,7 @@ using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 using std::vector;
+using strings::Substitute;
 using tserver::TabletServerAdminServiceProxy;
 using tserver::TabletServerServiceProxy;
 using tserver::WriteRequestPB;
@@ -342,5 +358,98 @@ Status PrintServerTimestamp(const string& address, uint16_t default_port) {
   return Status::OK();
 }
 
+Status GetTabletServerAddresses(const vector<string>& master_addresses,
+                                vector<string>* ts_addresses) {
+  client::sp::shared_ptr<KuduClient> client;
+  RETURN_NOT_OK_PREPEND(KuduClientBuilder()
+                        .master_server_addrs(master_addresses)
+                        .Build(&client),
+                        "unable to connect to the cluster's masters");
+
+  vector<KuduTabletServer*> servers;
+  ElementDeleter deleter(&servers);
+  RETURN_NOT_OK_PREPEND(client->ListTabletServers(&servers),
+                        "unable to list tablet servers");
+
+  ts_addresses->clear();
+  for (const KuduTabletServer* s : servers) {
+    ts_addresses->push_back(Substitute("$0:$1", s->hostname(), s->port()));
+  }
+  return Status::OK();
+}
+
+Status RunAcrossServers(
+    const vector<string>& addresses,
+    const std::function<Status(const string& address, string* out)>& task) {
+  if (addresses.empty()) {
+    return Status::NotFound("no servers to contact");
+  }
+
+  gscoped_ptr<ThreadPool> pool;
+  RETURN_NOT_OK(ThreadPoolBuilder("tool-fanout")
+                .set_max_threads(std::max<int>(
+                    1, std::min<int>(FLAGS_fanout_concurrency,
+                                     addresses.size())))
+                .Build(&pool));
+
+  struct TaskResult {
+    TaskResult() : done(false) {}
+
+    bool done;
+    Status status;
+    string output;
+  };
+  vector<TaskResult> results(addresses.size());
+  Mutex lock;
+  ConditionVariable results_cv(&lock);
+
+  for (size_t i = 0; i < addresses.size(); i++) {
+    CHECK_OK(pool->SubmitFunc([&, i]() {
+          string out;
+          Status s = task(addresses[i], &out);
+          MutexLock l(lock);
+          results[i].status = s;
+          results[i].output = std::move(out);
+          results[i].done = true;
+          results_cv.Broadcast();
+        }));
+  }
+
+  // Stream each server's output in input order as its result (and those of
+  // all servers before it) arrives, rather than waiting for the whole
+  // fan-out to complete.
+  vector<string> failed;
+  for (size_t i = 0; i < addresses.size(); i++) {
+    Status s;
+    string output;
+    {
+      MutexLock l(lock);
+      while (!results[i].done) {
+        results_cv.Wait();
+      }
+      s = results[i].status;
+      output = std::move(results[i].output);
+    }
+
+    cout << "-- " << addresses[i] << endl;
+    if (s.ok()) {
+      cout << output;
+    } else {
+      cout << "Error: " << s.ToString() << endl;
+      failed.push_back(addresses[i]);
+    }
+    cout << endl;
+  }
+  pool->Wait();
+
+  if (!failed.empty()) {
+    return Status::RuntimeError(
+        Substitute("failed on $0 of $1 servers: $2",
+                   failed.size(), addresses.size(),
+                   JoinStrings(failed, ", ")));
+  }
+  return Status::OK();
+}
+
 } // namespace tools
 } // namespace kudu
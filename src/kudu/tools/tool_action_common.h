@@ -17,8 +17,10 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/util/status.h"
@@ -84,5 +86,25 @@ Status PrintServerTimestamp(const std::string& address, uint16_t default_port);
 Status SetServerFlag(const std::string& address, uint16_t default_port,
                      const std::string& flag, const std::string& value);
 
+// Retrieves the RPC addresses of all tablet servers registered with the
+// cluster whose masters are given by 'master_addresses', storing them in
+// 'ts_addresses'.
+Status GetTabletServerAddresses(
+    const std::vector<std::string>& master_addresses,
+    std::vector<std::string>* ts_addresses);
+
+// Runs 'task' against each address in 'addresses', contacting up to
+// --fanout_concurrency servers at a time. Each task returns its printable
+// output through 'out'; outputs are streamed to stdout in 'addresses' order
+// as results arrive, under a per-server header.
+//
+// An individual task failure doesn't stop the remaining tasks; if any task
+// failed, an error identifying the failed servers is returned once all
+// tasks have completed.
+Status RunAcrossServers(
+    const std::vector<std::string>& addresses,
+    const std::function<Status(const std::string& address,
+                               std::string* out)>& task);
+
 } // namespace tools
 } // namespace kudu
@@ -18,13 +18,16 @@
 
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/tablet_peer.h"
 #include "kudu/tserver/scanner_metrics.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/test_util.h"
 
 DECLARE_int32(scanner_ttl_ms);
+DECLARE_int32(scanner_compiled_spec_cache_capacity);
 
 namespace kudu {
 
@@ -81,5 +84,38 @@ TEST(ScannerTest, TestExpire) {
   ASSERT_EQ(s2->id(), active_scanners[0]->id());
 }
 
+TEST(ScannersTest, TestCompiledSpecCache) {
+  google::FlagSaver saver;
+  ScannerManager mgr(nullptr);
+
+  // A miss returns null.
+  ASSERT_EQ(nullptr, mgr.LookupCompiledSpec("key-a"));
+
+  // An inserted entry is returned by later lookups.
+  std::shared_ptr<CompiledScanSpec> compiled(new CompiledScanSpec);
+  mgr.InsertCompiledSpec("key-a", compiled);
+  ASSERT_EQ(compiled.get(), mgr.LookupCompiledSpec("key-a").get());
+  ASSERT_EQ(nullptr, mgr.LookupCompiledSpec("key-b"));
+
+  // Filling the cache past its capacity evicts, but never grows it.
+  FLAGS_scanner_compiled_spec_cache_capacity = 4;
+  for (int i = 0; i < 100; i++) {
+    std::shared_ptr<CompiledScanSpec> c(new CompiledScanSpec);
+    mgr.InsertCompiledSpec(strings::Substitute("key-$0", i), c);
+  }
+  int cached = 0;
+  for (int i = 0; i < 100; i++) {
+    if (mgr.LookupCompiledSpec(strings::Substitute("key-$0", i))) {
+      cached++;
+    }
+  }
+  ASSERT_EQ(4, cached);
+
+  // A capacity of zero disables insertion.
+  FLAGS_scanner_compiled_spec_cache_capacity = 0;
+  mgr.InsertCompiledSpec("key-z", compiled);
+  ASSERT_EQ(nullptr, mgr.LookupCompiledSpec("key-z"));
+}
+
 } // namespace tserver
 } // namespace kudu
@@ -20,6 +20,7 @@
 #include <mutex>
 
 #include "kudu/common/iterator.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/gutil/hash/string_hash.h"
 #include "kudu/gutil/map-util.h"
@@ -36,6 +37,31 @@ DEFINE_int32(scanner_gc_check_interval_us, 5 * 1000L *1000L, // 5 seconds
              "Number of microseconds in the interval at which we remove expired scanners");
 TAG_FLAG(scanner_gc_check_interval_us, hidden);
 
+DEFINE_int32(scanner_shared_scan_window_ms, 0,
+             "Time window, after a shareable snapshot scan starts, during which new "
+             "scans with an identical specification attach to the running scan and "
+             "replay its results instead of re-reading the tablet. A value of 0 "
+             "disables scan sharing.");
+TAG_FLAG(scanner_shared_scan_window_ms, advanced);
+TAG_FLAG(scanner_shared_scan_window_ms, experimental);
+TAG_FLAG(scanner_shared_scan_window_ms, runtime);
+
+DEFINE_int64(scanner_shared_scan_max_retained_bytes, 8 * 1024 * 1024,
+             "Maximum number of result bytes a shared scan group retains for replay "
+             "before it stops accepting new member scans. Members which have already "
+             "attached continue to be served, so a group may retain more than this "
+             "budget until its members catch up.");
+TAG_FLAG(scanner_shared_scan_max_retained_bytes, advanced);
+TAG_FLAG(scanner_shared_scan_max_retained_bytes, experimental);
+
+DEFINE_int32(scanner_compiled_spec_cache_capacity, 128,
+             "Maximum number of compiled scan specs cached per tablet server. "
+             "Repeated scans whose plan-relevant request fields (projection, "
+             "predicates, key bounds) are byte-identical reuse the cached spec "
+             "rather than re-deriving it per RPC. Set to 0 to disable the cache.");
+TAG_FLAG(scanner_compiled_spec_cache_capacity, advanced);
+TAG_FLAG(scanner_compiled_spec_cache_capacity, runtime);
+
 // TODO: would be better to scope this at a tablet level instead of
 // server level.
 METRIC_DEFINE_gauge_size(server, active_scanners,
@@ -115,27 +141,27 @@ void ScannerManager::NewScanner(const scoped_refptr<TabletPeer>& tablet_peer,
     scanner->reset(new Scanner(id, tablet_peer, requestor_string, metrics_.get()));
 
     ScannerMapStripe& stripe = GetStripeByScannerId(id);
-    std::lock_guard<RWMutex> l(stripe.lock_);
+    std::lock_guard<percpu_rwlock> l(stripe.lock_);
     success = InsertIfNotPresent(&stripe.scanners_by_id_, id, *scanner);
   }
 }
 
 bool ScannerManager::LookupScanner(const string& scanner_id, SharedScanner* scanner) {
   ScannerMapStripe& stripe = GetStripeByScannerId(scanner_id);
-  shared_lock<RWMutex> l(stripe.lock_);
+  shared_lock<rw_spinlock> l(stripe.lock_.get_lock());
   return FindCopy(stripe.scanners_by_id_, scanner_id, scanner);
 }
 
 bool ScannerManager::UnregisterScanner(const string& scanner_id) {
   ScannerMapStripe& stripe = GetStripeByScannerId(scanner_id);
-  std::lock_guard<RWMutex> l(stripe.lock_);
+  std::lock_guard<percpu_rwlock> l(stripe.lock_);
   return stripe.scanners_by_id_.erase(scanner_id) > 0;
 }
 
 size_t ScannerManager::CountActiveScanners() const {
   size_t total = 0;
   for (const ScannerMapStripe* e : scanner_maps_) {
-    shared_lock<RWMutex> l(e->lock_);
+    shared_lock<rw_spinlock> l(e->lock_.get_lock());
     total += e->scanners_by_id_.size();
   }
   return total;
@@ -143,53 +169,226 @@ size_t ScannerManager::CountActiveScanners() const {
 
 void ScannerManager::ListScanners(std::vector<SharedScanner>* scanners) {
   for (const ScannerMapStripe* stripe : scanner_maps_) {
-    shared_lock<RWMutex> l(stripe->lock_);
+    shared_lock<rw_spinlock> l(stripe->lock_.get_lock());
     for (const ScannerMapEntry& se : stripe->scanners_by_id_) {
       scanners->push_back(se.second);
     }
   }
 }
 
+scoped_refptr<ScanShareGroup> ScannerManager::TryJoinShareGroup(
+    const string& signature,
+    const Timestamp& snap_timestamp,
+    const string& scanner_id) {
+  scoped_refptr<ScanShareGroup> group;
+  {
+    std::lock_guard<simple_spinlock> l(share_group_lock_);
+    const scoped_refptr<ScanShareGroup>* g = FindOrNull(share_groups_by_signature_, signature);
+    if (!g) {
+      return nullptr;
+    }
+    group = *g;
+  }
+  if (group->ShouldRetire(MonoTime::NowCoarse())) {
+    // Left for the removal thread to sweep.
+    return nullptr;
+  }
+  if (snap_timestamp != Timestamp::kInvalidTimestamp &&
+      snap_timestamp != group->snap_timestamp()) {
+    return nullptr;
+  }
+  if (!group->AddMember(scanner_id)) {
+    return nullptr;
+  }
+  return group;
+}
+
+void ScannerManager::RegisterShareGroup(const scoped_refptr<ScanShareGroup>& group) {
+  std::lock_guard<simple_spinlock> l(share_group_lock_);
+  share_groups_by_signature_[group->signature()] = group;
+}
+
+void ScannerManager::UnregisterShareGroup(const ScanShareGroup& group) {
+  std::lock_guard<simple_spinlock> l(share_group_lock_);
+  auto it = share_groups_by_signature_.find(group.signature());
+  if (it != share_groups_by_signature_.end() && it->second.get() == &group) {
+    share_groups_by_signature_.erase(it);
+  }
+}
+
+std::shared_ptr<CompiledScanSpec> ScannerManager::LookupCompiledSpec(const std::string& key) {
+  std::lock_guard<simple_spinlock> l(compiled_spec_lock_);
+  std::shared_ptr<CompiledScanSpec>* compiled = FindOrNull(compiled_spec_cache_, key);
+  return compiled ? *compiled : nullptr;
+}
+
+void ScannerManager::InsertCompiledSpec(const std::string& key,
+                                        const std::shared_ptr<CompiledScanSpec>& compiled) {
+  int32_t capacity = FLAGS_scanner_compiled_spec_cache_capacity;
+  if (capacity <= 0) return;
+  std::lock_guard<simple_spinlock> l(compiled_spec_lock_);
+  // Crude eviction: drop an arbitrary entry once at capacity. The cache is
+  // small and misses only cost the per-RPC setup work this cache avoids.
+  if (compiled_spec_cache_.size() >= static_cast<size_t>(capacity) &&
+      !ContainsKey(compiled_spec_cache_, key)) {
+    compiled_spec_cache_.erase(compiled_spec_cache_.begin());
+  }
+  compiled_spec_cache_[key] = compiled;
+}
+
 void ScannerManager::RemoveExpiredScanners() {
   MonoDelta scanner_ttl = MonoDelta::FromMilliseconds(FLAGS_scanner_ttl_ms);
 
+  // Drop share groups which can no longer accept new members. Groups with
+  // live members stay alive through the members' own references.
+  {
+    MonoTime now = MonoTime::NowCoarse();
+    std::lock_guard<simple_spinlock> l(share_group_lock_);
+    for (auto it = share_groups_by_signature_.begin();
+         it != share_groups_by_signature_.end();) {
+      if (it->second->ShouldRetire(now)) {
+        it = share_groups_by_signature_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
   for (ScannerMapStripe* stripe : scanner_maps_) {
-    std::lock_guard<RWMutex> l(stripe->lock_);
-    for (auto it = stripe->scanners_by_id_.begin(); it != stripe->scanners_by_id_.end();) {
+    // First pass under the read lock: find the scanners which have expired.
+    // In the common case there are none and the sweep never takes the write
+    // side of the stripe lock, so it can't stall concurrent scan
+    // continuations.
+    std::vector<string> expired_ids;
+    {
+      shared_lock<rw_spinlock> l(stripe->lock_.get_lock());
+      for (const ScannerMapEntry& se : stripe->scanners_by_id_) {
+        if (se.second->TimeSinceLastAccess(MonoTime::NowCoarse()) > scanner_ttl) {
+          expired_ids.push_back(se.first);
+        }
+      }
+    }
+    if (expired_ids.empty()) continue;
+
+    std::lock_guard<percpu_rwlock> l(stripe->lock_);
+    for (const string& id : expired_ids) {
+      auto it = stripe->scanners_by_id_.find(id);
+      if (it == stripe->scanners_by_id_.end()) {
+        // Unregistered between the two passes.
+        continue;
+      }
       SharedScanner& scanner = it->second;
       MonoDelta time_live =
-          scanner->TimeSinceLastAccess(MonoTime::Now());
-      if (time_live > scanner_ttl) {
-        // TODO: once we have a metric for the number of scanners expired, make this a
-        // VLOG(1).
-        LOG(INFO) << "Expiring scanner id: " << it->first << ", of tablet " << scanner->tablet_id()
-                  << ", after " << time_live.ToMicroseconds()
-                  << " us of inactivity, which is > TTL ("
-                  << scanner_ttl.ToMicroseconds() << " us).";
-        it = stripe->scanners_by_id_.erase(it);
-        if (metrics_) {
-          metrics_->scanners_expired->Increment();
-        }
-      } else {
-        ++it;
+          scanner->TimeSinceLastAccess(MonoTime::NowCoarse());
+      if (time_live <= scanner_ttl) {
+        // Accessed again between the two passes.
+        continue;
+      }
+      // TODO: once we have a metric for the number of scanners expired, make this a
+      // VLOG(1).
+      LOG(INFO) << "Expiring scanner id: " << id << ", of tablet " << scanner->tablet_id()
+                << ", after " << time_live.ToMicroseconds()
+                << " us of inactivity, which is > TTL ("
+                << scanner_ttl.ToMicroseconds() << " us).";
+      stripe->scanners_by_id_.erase(it);
+      if (metrics_) {
+        metrics_->scanners_expired->Increment();
       }
     }
   }
 }
 
+ScanShareGroup::ScanShareGroup(string signature,
+                               Timestamp snap_timestamp,
+                               gscoped_ptr<RowwiseIterator> iter)
+    : signature_(std::move(signature)),
+      snap_timestamp_(snap_timestamp),
+      create_time_(MonoTime::NowCoarse()),
+      closed_(false),
+      iter_(iter.release()),
+      complete_(false),
+      retained_bytes_(0),
+      row_block_arena_(32 * 1024, 1024 * 1024) {
+}
+
+ScanShareGroup::~ScanShareGroup() {
+}
+
+bool ScanShareGroup::AddMember(const string& scanner_id) {
+  std::lock_guard<simple_spinlock> l(members_lock_);
+  if (closed_) {
+    return false;
+  }
+  InsertOrDie(&members_, scanner_id);
+  return true;
+}
+
+void ScanShareGroup::RemoveMember(const string& scanner_id) {
+  std::lock_guard<simple_spinlock> l(members_lock_);
+  members_.erase(scanner_id);
+}
+
+int ScanShareGroup::num_members() const {
+  std::lock_guard<simple_spinlock> l(members_lock_);
+  return members_.size();
+}
+
+void ScanShareGroup::Close() {
+  std::lock_guard<simple_spinlock> l(members_lock_);
+  closed_ = true;
+}
+
+bool ScanShareGroup::ShouldRetire(const MonoTime& now) const {
+  std::lock_guard<simple_spinlock> l(members_lock_);
+  return closed_ ||
+      now - create_time_ > MonoDelta::FromMilliseconds(FLAGS_scanner_shared_scan_window_ms);
+}
+
+gscoped_ptr<RowwiseIterator> ScanShareGroup::ReleaseIter() {
+  return iter_.Pass();
+}
+
+void ScanShareGroup::SetComplete() {
+  complete_ = true;
+  iter_.reset();
+  row_block_.reset();
+}
+
+void ScanShareGroup::AppendBatch(SharedScanBatch batch) {
+  retained_bytes_ += batch.size_bytes();
+  batches_.emplace_back(std::move(batch));
+  if (retained_bytes_ > FLAGS_scanner_shared_scan_max_retained_bytes) {
+    Close();
+  }
+}
+
+RowBlock* ScanShareGroup::PrepareRowBlock(size_t nrows) {
+  if (PREDICT_FALSE(!row_block_ || row_block_->row_capacity() != nrows)) {
+    row_block_arena_.Reset();
+    row_block_.reset(new RowBlock(iter()->schema(), nrows, &row_block_arena_));
+  }
+  return row_block_.get();
+}
+
 Scanner::Scanner(string id, const scoped_refptr<TabletPeer>& tablet_peer,
                  string requestor_string, ScannerMetrics* metrics)
     : id_(std::move(id)),
       tablet_peer_(tablet_peer),
       requestor_string_(std::move(requestor_string)),
+      row_format_(ROWWISE),
       call_seq_id_(0),
-      start_time_(MonoTime::Now()),
+      start_time_(MonoTime::NowCoarse()),
       metrics_(metrics),
-      arena_(1024, 1024 * 1024) {
+      shared_scan_position_(0),
+      arena_(1024, 1024 * 1024),
+      row_block_arena_(32 * 1024, 1024 * 1024) {
   UpdateAccessTime();
 }
 
 Scanner::~Scanner() {
+  if (share_group_) {
+    share_group_->RemoveMember(id_);
+  }
   if (metrics_) {
     metrics_->SubmitScannerDuration(start_time_);
   }
@@ -197,22 +396,54 @@ Scanner::~Scanner() {
 
 void Scanner::UpdateAccessTime() {
   std::lock_guard<simple_spinlock> l(lock_);
-  last_access_time_ = MonoTime::Now();
+  // Scanner expiry is checked against a TTL measured in seconds, so the
+  // cheap coarse clock is plenty; this is called on every scan RPC.
+  last_access_time_ = MonoTime::NowCoarse();
 }
 
 void Scanner::Init(gscoped_ptr<RowwiseIterator> iter,
                    gscoped_ptr<ScanSpec> spec) {
   std::lock_guard<simple_spinlock> l(lock_);
-  CHECK(!iter_) << "Already initialized";
+  CHECK(!iter_ && !share_group_) << "Already initialized";
   iter_.reset(iter.release());
   spec_.reset(spec.release());
 }
 
+void Scanner::InitShared(scoped_refptr<ScanShareGroup> group,
+                         gscoped_ptr<ScanSpec> spec) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  CHECK(!iter_ && !share_group_) << "Already initialized";
+  share_group_ = std::move(group);
+  spec_.reset(spec.release());
+}
+
+void Scanner::AdoptIterator(gscoped_ptr<RowwiseIterator> iter) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  CHECK(share_group_ && !iter_);
+  iter_.reset(iter.release());
+  share_group_->RemoveMember(id_);
+  share_group_ = nullptr;
+}
+
 const ScanSpec& Scanner::spec() const {
   return *spec_;
 }
 
+RowBlock* Scanner::PrepareRowBlock(size_t nrows) {
+  if (PREDICT_FALSE(!row_block_ || row_block_->row_capacity() != nrows)) {
+    row_block_arena_.Reset();
+    row_block_.reset(new RowBlock(iter()->schema(), nrows, &row_block_arena_));
+  }
+  return row_block_.get();
+}
+
 void Scanner::GetIteratorStats(vector<IteratorStats>* stats) const {
+  if (!iter_) {
+    // Scanners attached to a share group have no iterator of their own, and
+    // the I/O done through the shared iterator is not attributed per-scanner.
+    stats->clear();
+    return;
+  }
   iter_->GetIteratorStats(stats);
 }
 
@@ -17,29 +17,36 @@
 #ifndef KUDU_TSERVER_SCANNERS_H
 #define KUDU_TSERVER_SCANNERS_H
 
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "kudu/common/iterator_stats.h"
+#include "kudu/common/scan_spec.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/timestamp.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/tablet/tablet_peer.h"
+#include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/auto_release_pool.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/mutex.h"
 #include "kudu/util/oid_generator.h"
-#include "kudu/util/rw_mutex.h"
 
 namespace kudu {
 
 class MetricEntity;
+class RowBlock;
 class RowwiseIterator;
 class ScanSpec;
 class Schema;
@@ -54,6 +61,117 @@ class Scanner;
 struct ScannerMetrics;
 typedef std::shared_ptr<Scanner> SharedScanner;
 
+// A batch of serialized rowwise scan results, retained by a ScanShareGroup
+// so that it can be replayed to every member of the group.
+struct SharedScanBatch {
+  int64_t num_rows;
+  std::string rows_data;
+  std::string indirect_data;
+
+  int64_t size_bytes() const {
+    return rows_data.size() + indirect_data.size();
+  }
+};
+
+// A set of equivalent scanners (same tablet, projection, predicates, bounds
+// and snapshot timestamp) cooperatively sharing a single tablet iterator.
+//
+// The group owns the iterator and retains every batch it produces: whichever
+// member first asks for batch N drives the iterator under lock() and archives
+// the serialized result, and every other member replays the retained copy at
+// its own pace. New members may attach (starting from batch 0) until the
+// group has either retained more than the configured byte budget or outlived
+// the sharing window; once a group is down to a single member and can no
+// longer accept new ones, that member takes the iterator back and reverts to
+// a plain scan.
+//
+// Membership changes are internally synchronized; the iterator and batch
+// state must be accessed with lock() held.
+class ScanShareGroup : public RefCountedThreadSafe<ScanShareGroup> {
+ public:
+  ScanShareGroup(std::string signature,
+                 Timestamp snap_timestamp,
+                 gscoped_ptr<RowwiseIterator> iter);
+
+  // Attempt to add a member. Returns false if the group is no longer
+  // accepting members.
+  bool AddMember(const std::string& scanner_id);
+
+  // Remove a member, e.g. when its scanner is unregistered.
+  void RemoveMember(const std::string& scanner_id);
+
+  int num_members() const;
+
+  // Close the group to new members.
+  void Close();
+
+  // Returns true once the group should be dropped from the manager's index:
+  // it is closed to new members, or past the sharing window.
+  bool ShouldRetire(const MonoTime& now) const;
+
+  const std::string& signature() const { return signature_; }
+  Timestamp snap_timestamp() const { return snap_timestamp_; }
+
+  Mutex* lock() { return &batch_lock_; }
+
+  // --- All methods below require lock() to be held. ---
+
+  RowwiseIterator* iter() { return DCHECK_NOTNULL(iter_.get()); }
+
+  // Transfer the iterator out of the group, when the sole remaining member
+  // reverts to a plain scan.
+  gscoped_ptr<RowwiseIterator> ReleaseIter();
+
+  bool complete() const { return complete_; }
+
+  // Mark the scan complete and release the iterator (and the resources it
+  // pins); retained batches remain replayable.
+  void SetComplete();
+
+  int64_t num_batches() const { return batches_.size(); }
+
+  const SharedScanBatch& batch(int64_t idx) const { return batches_[idx]; }
+
+  // Archive a batch produced by the driving member. If the retained bytes
+  // now exceed the configured budget, the group is closed to new members.
+  void AppendBatch(SharedScanBatch batch);
+
+  // Reusable row block for driving the shared iterator; same contract as
+  // Scanner::PrepareRowBlock().
+  RowBlock* PrepareRowBlock(size_t nrows);
+
+ private:
+  friend class RefCountedThreadSafe<ScanShareGroup>;
+  ~ScanShareGroup();
+
+  const std::string signature_;
+  const Timestamp snap_timestamp_;
+  const MonoTime create_time_;
+
+  // Protects members_ and closed_.
+  mutable simple_spinlock members_lock_;
+  std::unordered_set<std::string> members_;
+  bool closed_;
+
+  // Serializes batch production and replay. Held for the duration of an I/O
+  // batch by the driving member.
+  Mutex batch_lock_;
+
+  // --- The state below is protected by batch_lock_. ---
+
+  gscoped_ptr<RowwiseIterator> iter_;
+  bool complete_;
+  std::deque<SharedScanBatch> batches_;
+  int64_t retained_bytes_;
+
+  // Arena backing the indirect row data of 'row_block_'. Reset by the
+  // iterator on each NextBlock() call.
+  Arena row_block_arena_;
+  gscoped_ptr<RowBlock> row_block_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScanShareGroup);
+};
+
 // Manages the live scanners within a Tablet Server.
 //
 // When a scanner is created by a client, it is assigned a unique scanner ID.
@@ -62,6 +180,33 @@ typedef std::shared_ptr<Scanner> SharedScanner;
 //
 // Since scanners keep resources on the server, the manager periodically
 // removes any scanners which have not been accessed since a configurable TTL.
+// A scan spec compiled from the plan-relevant fields of a new scan request:
+// decoded predicates merged per column, encoded key bounds, and the result
+// of ScanSpec::OptimizeScan(). All constants referenced by the spec are
+// owned by the entry's own arena and pool, so the entry may be shared by
+// every scanner whose request carries byte-identical plan fields. A scanner
+// holds a reference for as long as its iterator may dereference the entry's
+// predicate values.
+struct CompiledScanSpec {
+  CompiledScanSpec() : arena(256, 64 * 1024) {}
+
+  Arena arena;
+  AutoReleasePool pool;
+  ScanSpec spec;
+
+  // Columns referenced by predicates (or needed as key columns) which are
+  // not part of the client's projection.
+  std::vector<ColumnSchema> missing_cols;
+
+  // Disjoint primary key ranges decomposed from the key predicates, in
+  // ascending key order; empty if the predicates describe at most one
+  // contiguous range. The bound keys are owned by 'pool' and 'arena'.
+  std::vector<ScanSpec::KeyRange> key_ranges;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(CompiledScanSpec);
+};
+
 class ScannerManager {
  public:
   explicit ScannerManager(const scoped_refptr<MetricEntity>& metric_entity);
@@ -93,6 +238,32 @@ class ScannerManager {
   // of all active scanners if under concurrent modifications.
   void ListScanners(std::vector<SharedScanner>* scanners);
 
+  // Attempt to join the scan share group matching 'signature'. If
+  // 'snap_timestamp' is initialized, it must also match the group's
+  // snapshot. On success, adds 'scanner_id' as a member and returns the
+  // group; otherwise returns nullptr.
+  scoped_refptr<ScanShareGroup> TryJoinShareGroup(const std::string& signature,
+                                                  const Timestamp& snap_timestamp,
+                                                  const std::string& scanner_id);
+
+  // Index a newly created share group so that later equivalent scans may
+  // join it. Replaces any previous group with the same signature.
+  void RegisterShareGroup(const scoped_refptr<ScanShareGroup>& group);
+
+  // Drop 'group' from the index, e.g. when its sole member reverts to a
+  // plain scan. No-op if the index already points at a different group with
+  // the same signature.
+  void UnregisterShareGroup(const ScanShareGroup& group);
+
+  // Look up a previously compiled scan spec by its cache key, or return
+  // null if none is cached. See CompiledScanSpec.
+  std::shared_ptr<CompiledScanSpec> LookupCompiledSpec(const std::string& key);
+
+  // Cache 'compiled' under 'key', replacing any existing entry. A no-op if
+  // the cache is disabled (--scanner_compiled_spec_cache_capacity=0).
+  void InsertCompiledSpec(const std::string& key,
+                          const std::shared_ptr<CompiledScanSpec>& compiled);
+
   // Iterate through scanners and remove any which are past their TTL.
   void RemoveExpiredScanners();
 
@@ -108,8 +279,11 @@ class ScannerManager {
   typedef std::pair<std::string, SharedScanner> ScannerMapEntry;
 
   struct ScannerMapStripe {
-    // Lock protecting the scanner map.
-    mutable RWMutex lock_;
+    // Lock protecting the scanner map. This is a per-CPU reader lock:
+    // lookups on the scan continuation hot path take only the local CPU's
+    // reader lock, so concurrent lookups never contend on a shared cache
+    // line. Registration, unregistration and expiry take the write side.
+    mutable percpu_rwlock lock_;
     // Map of the currently active scanners.
     ScannerMap scanners_by_id_;
   };
@@ -130,6 +304,25 @@ class ScannerManager {
 
   std::vector<ScannerMapStripe*> scanner_maps_;
 
+  // Protects share_groups_by_signature_.
+  mutable simple_spinlock share_group_lock_;
+
+  // Index of joinable scan share groups by scan signature. Groups are
+  // dropped from the index once they stop accepting members; live members
+  // keep their group alive via their own references.
+  std::unordered_map<std::string, scoped_refptr<ScanShareGroup>>
+      share_groups_by_signature_;
+
+  // Protects compiled_spec_cache_.
+  mutable simple_spinlock compiled_spec_lock_;
+
+  // Cache of compiled scan specs, keyed on the plan-relevant request bytes
+  // (plus the tablet id and schema version). Bounded by
+  // --scanner_compiled_spec_cache_capacity; schema changes age out
+  // naturally since the key changes with the schema version.
+  std::unordered_map<std::string, std::shared_ptr<CompiledScanSpec>>
+      compiled_spec_cache_;
+
   // Generator for scanner IDs.
   ObjectIdGenerator oid_generator_;
 
@@ -177,14 +370,37 @@ class Scanner {
   void Init(gscoped_ptr<RowwiseIterator> iter,
             gscoped_ptr<ScanSpec> spec);
 
+  // Attach this scanner to a scan share group instead of a private
+  // iterator. The scanner must already be a member of 'group'.
+  // Takes ownership of 'spec'.
+  void InitShared(scoped_refptr<ScanShareGroup> group,
+                  gscoped_ptr<ScanSpec> spec);
+
   // Return true if the scanner has been initialized (i.e has an iterator).
   // Once a Scanner is initialized, it is safe to assume that iter() and spec()
   // return non-NULL for the lifetime of the Scanner object.
   bool IsInitialized() const {
     std::lock_guard<simple_spinlock> l(lock_);
-    return iter_ != NULL;
+    return iter_ != NULL || share_group_;
   }
 
+  // Return the share group this scanner is attached to, or nullptr for a
+  // scanner with a private iterator.
+  scoped_refptr<ScanShareGroup> share_group() const {
+    std::lock_guard<simple_spinlock> l(lock_);
+    return share_group_;
+  }
+
+  // Detach from the share group, taking private ownership of 'iter' (the
+  // group's released iterator). Called when this scanner is the group's
+  // sole member and the group has stopped accepting new ones.
+  void AdoptIterator(gscoped_ptr<RowwiseIterator> iter);
+
+  // The index of the next shared batch this scanner should receive.
+  // Only accessed while holding the share group's lock().
+  int64_t shared_scan_position() const { return shared_scan_position_; }
+  void set_shared_scan_position(int64_t pos) { shared_scan_position_ = pos; }
+
   RowwiseIterator* iter() {
     return DCHECK_NOTNULL(iter_.get());
   }
@@ -209,6 +425,13 @@ class Scanner {
     return &arena_;
   }
 
+  // Keep 'compiled' alive for the lifetime of this scanner. Set when the
+  // scanner's spec was copied from (or inserted into) the compiled scan
+  // spec cache, since the spec's predicates point into the entry's arena.
+  void set_compiled_spec(std::shared_ptr<CompiledScanSpec> compiled) {
+    compiled_spec_ = std::move(compiled);
+  }
+
   const std::string& id() const { return id_; }
 
   // Return the ScanSpec associated with this Scanner.
@@ -244,15 +467,14 @@ class Scanner {
   // Returns the time this scan was started.
   const MonoTime& start_time() const { return start_time_; }
 
-  // Associate a projection schema with the Scanner. The scanner takes
-  // ownership of 'client_projection_schema'.
+  // Associate a projection schema with the Scanner.
   //
   // Note: 'client_projection_schema' is set if the client's
   // projection is a subset of the iterator's schema -- the iterator's
   // schema needs to include all columns that have predicates, whereas
   // the client may not want to project all of them.
-  void set_client_projection_schema(gscoped_ptr<Schema> client_projection_schema) {
-    client_projection_schema_.swap(client_projection_schema);
+  void set_client_projection_schema(SchemaPtr client_projection_schema) {
+    client_projection_schema_ = std::move(client_projection_schema);
   }
 
   // Returns request's projection schema if it differs from the schema
@@ -262,6 +484,21 @@ class Scanner {
   // See the note about 'set_client_projection_schema' above.
   const Schema* client_projection_schema() const { return client_projection_schema_.get(); }
 
+  // Set the wire format in which this scanner's results are returned.
+  // Only set during scanner setup.
+  void set_row_format(RowFormatPB row_format) { row_format_ = row_format; }
+
+  // The wire format in which this scanner's results are returned.
+  RowFormatPB row_format() const { return row_format_; }
+
+  // Return a reusable row block for copying rows out of iter(), sized to
+  // 'nrows' rows and lazily created on the first call. Reusing the block
+  // (and the arena backing its indirect data) across continuation calls
+  // avoids a large allocation on every scan RPC. The iterator resets the
+  // arena on each NextBlock() call, so data from the previous batch is
+  // invalidated by the next one.
+  RowBlock* PrepareRowBlock(size_t nrows);
+
   // Get per-column stats for each iterator.
   void GetIteratorStats(std::vector<IteratorStats>* stats) const;
 
@@ -285,6 +522,9 @@ class Scanner {
   // RpcContext::requestor_string().
   const std::string requestor_string_;
 
+  // The wire format in which results are returned to the client.
+  RowFormatPB row_format_;
+
   // The last time that the scanner was accessed.
   MonoTime last_access_time_;
 
@@ -308,12 +548,21 @@ class Scanner {
   // The spec used by 'iter_'
   gscoped_ptr<ScanSpec> spec_;
 
+  // See set_compiled_spec().
+  std::shared_ptr<CompiledScanSpec> compiled_spec_;
+
   // Stores the request's projection schema, if it differs from the
   // schema used by the iterator.
-  gscoped_ptr<Schema> client_projection_schema_;
+  SchemaPtr client_projection_schema_;
 
   gscoped_ptr<RowwiseIterator> iter_;
 
+  // Set instead of 'iter_' for scanners attached to a shared scan.
+  scoped_refptr<ScanShareGroup> share_group_;
+
+  // See shared_scan_position().
+  int64_t shared_scan_position_;
+
   AutoReleasePool autorelease_pool_;
 
   // Arena used for allocations which must last as long as the scanner
@@ -321,6 +570,14 @@ class Scanner {
   // response.
   Arena arena_;
 
+  // Arena backing the indirect row data of 'row_block_'. Reset by the
+  // iterator on each NextBlock() call.
+  Arena row_block_arena_;
+
+  // Reusable row block for copying rows out of 'iter_'. Lazily created on
+  // the first scan call. See PrepareRowBlock().
+  gscoped_ptr<RowBlock> row_block_;
+
   DISALLOW_COPY_AND_ASSIGN(Scanner);
 };
 
@@ -17,9 +17,12 @@
 
 #include "kudu/tserver/tablet_copy_client.h"
 
+#include <algorithm>
+#include <boost/bind.hpp>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <memory>
+#include <vector>
 
 #include "kudu/common/wire_protocol.h"
 #include "kudu/consensus/consensus_meta.h"
@@ -45,6 +48,7 @@
 #include "kudu/util/logging.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/pb_util.h"
+#include "kudu/util/threadpool.h"
 
 DEFINE_int32(tablet_copy_begin_session_timeout_ms, 3000,
              "Tablet server RPC client timeout for BeginTabletCopySession calls. "
@@ -58,6 +62,13 @@ TAG_FLAG(tablet_copy_save_downloaded_metadata, advanced);
 TAG_FLAG(tablet_copy_save_downloaded_metadata, hidden);
 TAG_FLAG(tablet_copy_save_downloaded_metadata, runtime);
 
+DEFINE_int32(tablet_copy_download_threads_per_session, 4,
+             "Number of threads used to download data blocks concurrently "
+             "during a tablet copy. The source session supports concurrent "
+             "readers, so this keeps multiple data chunks in flight at once "
+             "rather than single-streaming the network link.");
+TAG_FLAG(tablet_copy_download_threads_per_session, advanced);
+
 DEFINE_int32(tablet_copy_dowload_file_inject_latency_ms, 0,
              "Injects latency into the loop that downloads files, causing tablet copy "
              "to take much longer. For use in tests only.");
@@ -253,7 +264,7 @@ Status TabletCopyClient::FetchAll(TabletStatusListener* status_listener) {
   CHECK(started_);
   status_listener_ = status_listener;
 
-  // Download all the files (serially, for now, but in parallel in the future).
+  // Download all the files (data blocks in parallel, WAL segments serially).
   RETURN_NOT_OK(DownloadBlocks());
   RETURN_NOT_OK(DownloadWALs());
 
@@ -380,34 +391,60 @@ Status TabletCopyClient::DownloadBlocks() {
     }
   }
 
-  // Download each block, writing the new block IDs into the new superblock
-  // as each block downloads.
+  // Collect the blocks to download. Each entry points at a block ID in the
+  // new superblock, which is rewritten in place as its block downloads.
   gscoped_ptr<TabletSuperBlockPB> new_sb(new TabletSuperBlockPB());
   new_sb->CopyFrom(*superblock_);
-  int block_count = 0;
-  LOG_WITH_PREFIX(INFO) << "Starting download of " << num_blocks << " data blocks...";
+  vector<BlockIdPB*> blocks;
+  blocks.reserve(num_blocks);
   for (RowSetDataPB& rowset : *new_sb->mutable_rowsets()) {
     for (ColumnDataPB& col : *rowset.mutable_columns()) {
-      RETURN_NOT_OK(DownloadAndRewriteBlock(col.mutable_block(),
-                                            &block_count, num_blocks));
+      blocks.push_back(col.mutable_block());
     }
     for (DeltaDataPB& redo : *rowset.mutable_redo_deltas()) {
-      RETURN_NOT_OK(DownloadAndRewriteBlock(redo.mutable_block(),
-                                            &block_count, num_blocks));
+      blocks.push_back(redo.mutable_block());
     }
     for (DeltaDataPB& undo : *rowset.mutable_undo_deltas()) {
-      RETURN_NOT_OK(DownloadAndRewriteBlock(undo.mutable_block(),
-                                            &block_count, num_blocks));
+      blocks.push_back(undo.mutable_block());
     }
     if (rowset.has_bloom_block()) {
-      RETURN_NOT_OK(DownloadAndRewriteBlock(rowset.mutable_bloom_block(),
-                                            &block_count, num_blocks));
+      blocks.push_back(rowset.mutable_bloom_block());
     }
     if (rowset.has_adhoc_index_block()) {
-      RETURN_NOT_OK(DownloadAndRewriteBlock(rowset.mutable_adhoc_index_block(),
-                                            &block_count, num_blocks));
+      blocks.push_back(rowset.mutable_adhoc_index_block());
+    }
+  }
+  DCHECK_EQ(num_blocks, blocks.size());
+
+  // Download the blocks in parallel. The source session supports concurrent
+  // readers and each chunk fetch is an independent RPC, so multiple chunks
+  // stay in flight and the network link isn't single-streamed.
+  int num_threads = std::max(1, FLAGS_tablet_copy_download_threads_per_session);
+  gscoped_ptr<ThreadPool> pool;
+  RETURN_NOT_OK(ThreadPoolBuilder("tablet-copy")
+                    .set_max_threads(num_threads)
+                    .Build(&pool));
+
+  LOG_WITH_PREFIX(INFO) << "Starting download of " << num_blocks
+                        << " data blocks on " << num_threads << " threads...";
+  AtomicInt<int32_t> block_count(0);
+  simple_spinlock error_lock;
+  Status end_status;
+  for (BlockIdPB* block_id : blocks) {
+    Status s = pool->SubmitFunc(boost::bind(&TabletCopyClient::DownloadBlockTask,
+                                            this, block_id, num_blocks,
+                                            &block_count, &error_lock, &end_status));
+    if (PREDICT_FALSE(!s.ok())) {
+      std::lock_guard<simple_spinlock> l(error_lock);
+      if (end_status.ok()) {
+        end_status = s;
+      }
+      break;
     }
   }
+  pool->Wait();
+  pool->Shutdown();
+  RETURN_NOT_OK(end_status);
 
   // The orphaned physical block ids at the remote have no meaning to us.
   new_sb->clear_orphaned_blocks();
@@ -418,6 +455,27 @@ Status TabletCopyClient::DownloadBlocks() {
   return Status::OK();
 }
 
+void TabletCopyClient::DownloadBlockTask(BlockIdPB* block_id,
+                                         int num_blocks,
+                                         AtomicInt<int32_t>* block_count,
+                                         simple_spinlock* error_lock,
+                                         Status* end_status) {
+  {
+    std::lock_guard<simple_spinlock> l(*error_lock);
+    if (PREDICT_FALSE(!end_status->ok())) {
+      // Another download already failed; don't bother fetching more blocks.
+      return;
+    }
+  }
+  Status s = DownloadAndRewriteBlock(block_id, num_blocks, block_count);
+  if (PREDICT_FALSE(!s.ok())) {
+    std::lock_guard<simple_spinlock> l(*error_lock);
+    if (end_status->ok()) {
+      *end_status = s;
+    }
+  }
+}
+
 Status TabletCopyClient::DownloadWAL(uint64_t wal_segment_seqno) {
   VLOG_WITH_PREFIX(1) << "Downloading WAL segment with seqno " << wal_segment_seqno;
   DataIdPB data_id;
@@ -463,17 +521,18 @@ Status TabletCopyClient::WriteConsensusMetadata() {
 }
 
 Status TabletCopyClient::DownloadAndRewriteBlock(BlockIdPB* block_id,
-                                                      int* block_count, int num_blocks) {
+                                                      int num_blocks,
+                                                      AtomicInt<int32_t>* block_count) {
   BlockId old_block_id(BlockId::FromPB(*block_id));
   UpdateStatusMessage(Substitute("Downloading block $0 ($1/$2)",
-                                 old_block_id.ToString(), *block_count,
+                                 old_block_id.ToString(), block_count->Load(),
                                  num_blocks));
   BlockId new_block_id;
   RETURN_NOT_OK_PREPEND(DownloadBlock(old_block_id, &new_block_id),
       "Unable to download block with id " + old_block_id.ToString());
 
   new_block_id.CopyToPB(block_id);
-  (*block_count)++;
+  block_count->Increment();
   return Status::OK();
 }
 
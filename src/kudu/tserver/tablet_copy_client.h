@@ -26,6 +26,8 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/util/atomic.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
@@ -64,7 +66,7 @@ class TabletCopyServiceProxy;
 // This class is not thread-safe.
 //
 // TODO:
-// * Parallelize download of blocks and WAL segments.
+// * Parallelize download of WAL segments.
 //
 class TabletCopyClient {
  public:
@@ -137,19 +139,34 @@ class TabletCopyClient {
   // downloaded as part of initiating the tablet copy session.
   Status WriteConsensusMetadata();
 
-  // Download all blocks belonging to a tablet sequentially.
+  // Download all blocks belonging to a tablet.
+  //
+  // Blocks are downloaded in parallel on a thread pool sized by
+  // --tablet_copy_download_threads_per_session; the source session supports
+  // concurrent readers, so this keeps multiple data chunks in flight at once.
   //
   // Blocks are given new IDs upon creation. On success, 'new_superblock_'
   // is populated to reflect the new block IDs and should be used in lieu
   // of 'superblock_' henceforth.
   Status DownloadBlocks();
 
+  // Thread pool task which downloads a single block via
+  // DownloadAndRewriteBlock(), recording the first error encountered by any
+  // task in 'end_status' (protected by 'error_lock'). Tasks are no-ops once
+  // an error has been recorded, so a failure aborts the copy promptly.
+  void DownloadBlockTask(BlockIdPB* block_id, int num_blocks,
+                         AtomicInt<int32_t>* block_count,
+                         simple_spinlock* error_lock, Status* end_status);
+
   // Download the block specified by 'block_id'.
   //
   // On success:
   // - 'block_id' is set to the new ID of the downloaded block.
   // - 'block_count' is incremented.
-  Status DownloadAndRewriteBlock(BlockIdPB* block_id, int* block_count, int num_blocks);
+  //
+  // This method is thread-safe.
+  Status DownloadAndRewriteBlock(BlockIdPB* block_id, int num_blocks,
+                                 AtomicInt<int32_t>* block_count);
 
   // Download a single block.
   // Data block is opened with options so that it will fsync() on close.
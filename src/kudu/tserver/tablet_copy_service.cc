@@ -35,6 +35,7 @@
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/pb_util.h"
+#include "kudu/util/throttler.h"
 
 // Note, this macro assumes the existence of a local var named 'context'.
 #define RPC_RETURN_APP_ERROR(app_err, message, s) \
@@ -61,6 +62,21 @@ DEFINE_uint64(tablet_copy_timeout_poll_period_ms, 10000,
               "tablet copy sessions, in millis");
 TAG_FLAG(tablet_copy_timeout_poll_period_ms, hidden);
 
+DEFINE_int32(tablet_copy_max_concurrent_sessions, 0,
+             "Maximum number of tablet copy sessions this server will serve "
+             "concurrently. New sessions beyond the limit are rejected with a "
+             "retriable error, bounding the I/O and log retention impact of "
+             "many replicas being copied off one server at once, e.g. during "
+             "rebalancing. 0 means no limit.");
+TAG_FLAG(tablet_copy_max_concurrent_sessions, advanced);
+TAG_FLAG(tablet_copy_max_concurrent_sessions, runtime);
+
+DEFINE_int64(tablet_copy_transfer_throttler_bytes_per_sec, 0,
+             "Maximum aggregate rate, in bytes per second, at which this "
+             "server sends tablet copy data across all sessions. Rates below "
+             "1 MB/sec are not supported. 0 disables throttling.");
+TAG_FLAG(tablet_copy_transfer_throttler_bytes_per_sec, advanced);
+
 DEFINE_double(fault_crash_on_handle_tc_fetch_data, 0.0,
               "Fraction of the time when the tablet will crash while "
               "servicing a TabletCopyService FetchData() RPC call. "
@@ -97,6 +113,13 @@ TabletCopyServiceImpl::TabletCopyServiceImpl(
       fs_manager_(CHECK_NOTNULL(fs_manager)),
       tablet_peer_lookup_(CHECK_NOTNULL(tablet_peer_lookup)),
       shutdown_latch_(1) {
+  if (FLAGS_tablet_copy_transfer_throttler_bytes_per_sec > 0) {
+    transfer_throttler_.reset(
+        new Throttler(MonoTime::Now(),
+                      0,
+                      FLAGS_tablet_copy_transfer_throttler_bytes_per_sec,
+                      1.0));
+  }
   CHECK_OK(Thread::Create("tablet-copy", "tc-session-exp",
                           &TabletCopyServiceImpl::EndExpiredSessions, this,
                           &session_expiration_thread_));
@@ -122,6 +145,17 @@ void TabletCopyServiceImpl::BeginTabletCopySession(
   {
     MutexLock l(sessions_lock_);
     if (!FindCopy(sessions_, session_id, &session)) {
+      if (FLAGS_tablet_copy_max_concurrent_sessions > 0 &&
+          sessions_.size() >= FLAGS_tablet_copy_max_concurrent_sessions) {
+        RPC_RETURN_APP_ERROR(
+            TabletCopyErrorPB::UNKNOWN_ERROR,
+            "Too many concurrent tablet copy sessions",
+            Status::ServiceUnavailable(
+                Substitute("Already serving $0 tablet copy sessions "
+                           "(--tablet_copy_max_concurrent_sessions=$1)",
+                           sessions_.size(),
+                           FLAGS_tablet_copy_max_concurrent_sessions)));
+      }
       LOG(INFO) << Substitute(
           "Beginning new tablet copy session on tablet $0 from peer $1"
           " at $2: session id = $3",
@@ -225,6 +259,22 @@ void TabletCopyServiceImpl::FetchData(const FetchDataRequestPB* req,
                       error_code, "Unable to get piece of log segment");
   }
 
+  if (transfer_throttler_) {
+    // Consume throttler tokens for the chunk before sending it. Tokens are
+    // taken in small steps since a whole chunk (4MB by default) can exceed
+    // the tokens accumulated in a single refill period; 64KB steps keep the
+    // throttler usable down to rates of about 1 MB/sec.
+    const int64_t kThrottleStepBytes = 64 * 1024;
+    int64_t remaining = data->length();
+    while (remaining > 0) {
+      int64_t step = std::min(remaining, kThrottleStepBytes);
+      while (!transfer_throttler_->Take(MonoTime::Now(), 0, step)) {
+        SleepFor(MonoDelta::FromMicroseconds(Throttler::kRefillPeriodMicros / 2));
+      }
+      remaining -= step;
+    }
+  }
+
   data_chunk->set_total_data_length(total_data_length);
   data_chunk->set_offset(offset);
 
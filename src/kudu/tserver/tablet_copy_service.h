@@ -32,6 +32,7 @@
 
 namespace kudu {
 class FsManager;
+class Throttler;
 
 namespace log {
 class ReadableLogSegment;
@@ -95,6 +96,10 @@ class TabletCopyServiceImpl : public TabletCopyServiceIf {
   FsManager* fs_manager_;
   TabletPeerLookupIf* tablet_peer_lookup_;
 
+  // Throttles the aggregate outbound data rate of all tablet copy sessions.
+  // NULL if --tablet_copy_transfer_throttler_bytes_per_sec is not set.
+  gscoped_ptr<Throttler> transfer_throttler_;
+
   // Protects sessions_ and session_expirations_ maps.
   mutable Mutex sessions_lock_;
   SessionMap sessions_;
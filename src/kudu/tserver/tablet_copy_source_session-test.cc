@@ -110,6 +110,7 @@ class TabletCopyTest : public KuduTabletTest {
         new TabletPeer(tablet()->metadata(),
                        config_peer,
                        apply_pool_.get(),
+                       nullptr,
                        Bind(&TabletCopyTest::TabletPeerStateChangedCallback,
                             Unretained(this),
                             tablet()->tablet_id())));
@@ -55,6 +55,12 @@ class TabletPeerLookupIf {
   virtual void StartTabletCopy(
       const consensus::StartTabletCopyRequestPB* req,
       std::function<void(const Status&, TabletServerErrorPB::Code)> cb) = 0;
+
+  // Hint that a caller tried to access 'tablet_id' before it was running.
+  // Implementations which queue tablets for opening at startup may use this
+  // to open tablets with observed demand first. The default implementation
+  // does nothing.
+  virtual void PrioritizeTabletForOpen(const std::string& /* tablet_id */) {}
 };
 
 } // namespace tserver
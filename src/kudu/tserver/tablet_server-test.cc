@@ -61,6 +61,7 @@ DEFINE_int32(single_threaded_insert_latency_bench_insert_rows, 1000,
 DECLARE_bool(fail_dns_resolution);
 DECLARE_int32(metrics_retirement_age_ms);
 DECLARE_int32(scanner_batch_size_rows);
+DECLARE_int32(scanner_batch_time_budget_ms);
 DECLARE_string(block_manager);
 
 // Declare these metrics prototypes for simpler unit testing of their behavior.
@@ -1056,6 +1057,94 @@ TEST_F(TabletServerTest, TestScan) {
   }
 }
 
+TEST_F(TabletServerTest, TestMultiGet) {
+  const int kNumRows = 100;
+  InsertTestRowsDirect(0, kNumRows);
+  // Flush so that some lookups hit the on-disk path, then insert more rows
+  // which stay in the MemRowSet.
+  ASSERT_OK(tablet_peer_->tablet()->Flush());
+  InsertTestRowsDirect(kNumRows, kNumRows);
+
+  MultiGetRequestPB req;
+  MultiGetResponsePB resp;
+  rpc::RpcController rpc;
+  req.set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToColumnPBs(schema_, req.mutable_projected_columns()));
+
+  // Look up a row in a DiskRowSet, a row in the MemRowSet, and a key
+  // which was never inserted.
+  vector<int> keys = { 7, 150, 5000 };
+  for (int key : keys) {
+    KuduPartialRow row(&schema_);
+    BuildTestRow(key, &row);
+    string encoded;
+    ASSERT_OK(row.EncodeRowKey(&encoded));
+    req.add_primary_keys(encoded);
+  }
+
+  ASSERT_OK(proxy_->MultiGet(req, &resp, &rpc));
+  SCOPED_TRACE(SecureDebugString(resp));
+  ASSERT_FALSE(resp.has_error());
+  ASSERT_EQ(1, resp.not_found_key_indexes_size());
+  EXPECT_EQ(2, resp.not_found_key_indexes(0));
+  ASSERT_EQ(2, resp.data().num_rows());
+
+  Slice direct, indirect;
+  ASSERT_OK(rpc.GetSidecar(resp.data().rows_sidecar(), &direct));
+  if (resp.data().has_indirect_data_sidecar()) {
+    ASSERT_OK(rpc.GetSidecar(resp.data().indirect_data_sidecar(), &indirect));
+  }
+  vector<const uint8_t*> rows;
+  ASSERT_OK(ExtractRowsFromRowBlockPB(schema_, resp.data(), indirect, &direct, &rows));
+  ASSERT_EQ(2, rows.size());
+
+  // Rows come back in the same order as the requested keys.
+  for (int i = 0; i < 2; i++) {
+    KuduPartialRow expected(&schema_);
+    BuildTestRow(keys[i], &expected);
+    ConstContiguousRow row(&schema_, rows[i]);
+    ASSERT_EQ("(" + expected.ToString() + ")", schema_.DebugRow(row));
+  }
+}
+
+// Test that when the server's per-batch time budget expires before the
+// requested batch size is reached, the response carries a hint with the
+// number of bytes produced within the budget.
+TEST_F(TabletServerTest, TestScanBatchTimeBudgetHint) {
+  // Make each internal block tiny and the time budget zero, so that the
+  // budget expires after the first block of every continuation call.
+  FLAGS_scanner_batch_size_rows = 1;
+  FLAGS_scanner_batch_time_budget_ms = 0;
+  InsertTestRowsDirect(0, 100);
+
+  ScanResponsePB resp;
+  ASSERT_NO_FATAL_FAILURE(OpenScannerWithAllColumns(&resp));
+
+  // Fetch a batch: the budget should cut it short and produce a hint much
+  // smaller than the (default) requested batch size.
+  ScanRequestPB req;
+  RpcController rpc;
+  req.set_scanner_id(resp.scanner_id());
+  req.set_call_seq_id(1);
+  ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+  ASSERT_FALSE(resp.has_error());
+  ASSERT_TRUE(resp.has_more_results());
+  ASSERT_TRUE(resp.has_batch_size_bytes_hint());
+  ASSERT_GT(resp.batch_size_bytes_hint(), 0);
+
+  // With a generous budget, the scan completes within the requested batch
+  // size and no hint is returned.
+  FLAGS_scanner_batch_time_budget_ms = 60 * 1000;
+  rpc.Reset();
+  req.set_call_seq_id(2);
+  ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+  ASSERT_FALSE(resp.has_error());
+  ASSERT_FALSE(resp.has_more_results());
+  ASSERT_FALSE(resp.has_batch_size_bytes_hint());
+
+  FLAGS_scanner_batch_time_budget_ms = 500;
+}
+
 TEST_F(TabletServerTest, TestScannerOpenWhenServerShutsDown) {
   InsertTestRowsDirect(0, 1);
 
@@ -1338,6 +1427,90 @@ TEST_F(TabletServerTest, TestSnapshotScan_LastRow) {
 }
 
 
+// Test a stateless scan: every batch is fetched with a fresh new scan request
+// which resumes from the last primary key of the previous response, and the
+// server retains no scanner state between RPCs.
+TEST_F(TabletServerTest, TestStatelessScan) {
+  // Set the internal batching within the tserver to be small so that each
+  // RPC returns only part of the data.
+  FLAGS_scanner_batch_size_rows = 5;
+  const int num_rows = 100;
+
+  // Generate data in a few overlapping rowsets to exercise the merge.
+  for (int i = 0; i < 5; i++) {
+    ASSERT_OK(tablet_peer_->tablet()->Flush());
+    for (int j = 0; j < num_rows; j++) {
+      if (j % 5 == i) {
+        InsertTestRowsDirect(j, 1);
+      }
+    }
+  }
+
+  const Schema& projection = schema_;
+
+  // A stateless scan must be ordered; anything else is rejected.
+  {
+    ScanRequestPB req;
+    ScanResponsePB resp;
+    RpcController rpc;
+    NewScanRequestPB* scan = req.mutable_new_scan_request();
+    scan->set_tablet_id(kTabletId);
+    scan->set_stateless(true);
+    ASSERT_OK(SchemaToColumnPBs(projection, scan->mutable_projected_columns()));
+    req.set_call_seq_id(0);
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_TRUE(resp.has_error());
+    ASSERT_EQ(TabletServerErrorPB::INVALID_SCAN_SPEC, resp.error().code());
+  }
+
+  ScanResponsePB resp;
+  ScanRequestPB req;
+
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  scan->set_stateless(true);
+  ASSERT_OK(SchemaToColumnPBs(projection, scan->mutable_projected_columns()));
+  req.set_call_seq_id(0);
+  req.set_batch_size_bytes(100);
+  scan->set_read_mode(READ_AT_SNAPSHOT);
+  scan->set_order_mode(ORDERED);
+
+  vector<string> results;
+  do {
+    RpcController rpc;
+    {
+      SCOPED_TRACE(SecureDebugString(req));
+      ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+      SCOPED_TRACE(SecureDebugString(resp));
+      ASSERT_FALSE(resp.has_error());
+    }
+
+    // The server must not have handed back a scanner ID nor kept any
+    // scanner registered.
+    ASSERT_FALSE(resp.has_scanner_id());
+    ASSERT_EQ(0, mini_server_->server()->scanner_manager()->CountActiveScanners());
+
+    StringifyRowsFromResponse(projection, rpc, resp, &results);
+
+    // Resume the scan from the position returned in the response.
+    scan->set_last_primary_key(resp.last_primary_key());
+    scan->set_snap_timestamp(resp.snap_timestamp());
+  } while (resp.has_more_results());
+
+  ASSERT_EQ(num_rows, results.size());
+
+  // Verify that we got the rows back in order.
+  KuduPartialRow row(&projection);
+  for (int j = 0; j < num_rows; j++) {
+    ASSERT_OK(row.SetInt32(0, j));
+    ASSERT_OK(row.SetInt32(1, j * 2));
+    ASSERT_OK(row.SetStringCopy(2, StringPrintf("hello %d", j)));
+    string expected = "(" + row.ToString() + ")";
+    ASSERT_EQ(expected, results[j]);
+  }
+}
+
 // Tests that a read in the future succeeds if a propagated_timestamp (that is even
 // further in the future) follows along. Also tests that the clock was updated so
 // that no writes will ever have a timestamp post this snapshot.
@@ -2037,6 +2210,115 @@ TEST_F(TabletServerTest, TestDeleteTablet_TabletNotCreated) {
   }
 }
 
+// Exercise the bulk ingest session lifecycle and its validation errors.
+// A successful commit requires client-side generation of complete cfile
+// blocks, which is covered by the DiskRowSet-level tests; here we verify
+// the RPC surface: session management, schema version checks, and the
+// rejection of incomplete block sets.
+TEST_F(TabletServerTest, TestBulkIngestSessionErrors) {
+  const string& uuid = mini_server_->server()->fs_manager()->uuid();
+  uint32_t schema_version = tablet_peer_->tablet_metadata()->schema_version();
+
+  // Opening a session against a mismatched schema version is rejected.
+  {
+    BeginBulkIngestRequestPB req;
+    BeginBulkIngestResponsePB resp;
+    RpcController rpc;
+    req.set_dest_uuid(uuid);
+    req.set_tablet_id(kTabletId);
+    req.set_schema_version(schema_version + 1);
+    ASSERT_OK(admin_proxy_->BeginBulkIngest(req, &resp, &rpc));
+    ASSERT_TRUE(resp.has_error());
+    ASSERT_EQ(TabletServerErrorPB::MISMATCHED_SCHEMA, resp.error().code());
+  }
+
+  // Uploading data against an unknown session is rejected.
+  {
+    BulkIngestDataRequestPB req;
+    BulkIngestDataResponsePB resp;
+    RpcController rpc;
+    req.set_dest_uuid(uuid);
+    req.set_session_id("no-such-session");
+    req.set_block_type(BulkIngestDataRequestPB::BLOOM);
+    req.set_data("x");
+    ASSERT_OK(admin_proxy_->BulkIngestData(req, &resp, &rpc));
+    ASSERT_TRUE(resp.has_error());
+    ASSERT_STR_CONTAINS(resp.error().status().message(), "Unknown bulk ingest session");
+  }
+
+  // Open a session and upload data for only one column. The commit is
+  // rejected since the block set is incomplete, and the failed commit
+  // destroys the session.
+  string session_id;
+  {
+    BeginBulkIngestRequestPB req;
+    BeginBulkIngestResponsePB resp;
+    RpcController rpc;
+    req.set_dest_uuid(uuid);
+    req.set_tablet_id(kTabletId);
+    req.set_schema_version(schema_version);
+    ASSERT_OK(admin_proxy_->BeginBulkIngest(req, &resp, &rpc));
+    ASSERT_FALSE(resp.has_error()) << SecureDebugString(resp);
+    session_id = resp.session_id();
+  }
+  {
+    BulkIngestDataRequestPB req;
+    BulkIngestDataResponsePB resp;
+    RpcController rpc;
+    req.set_dest_uuid(uuid);
+    req.set_session_id(session_id);
+    req.set_block_type(BulkIngestDataRequestPB::COLUMN);
+    req.set_column_idx(0);
+    req.set_data("some cfile data");
+    ASSERT_OK(admin_proxy_->BulkIngestData(req, &resp, &rpc));
+    ASSERT_FALSE(resp.has_error()) << SecureDebugString(resp);
+  }
+  {
+    FinishBulkIngestRequestPB req;
+    FinishBulkIngestResponsePB resp;
+    RpcController rpc;
+    req.set_dest_uuid(uuid);
+    req.set_session_id(session_id);
+    ASSERT_OK(admin_proxy_->FinishBulkIngest(req, &resp, &rpc));
+    ASSERT_TRUE(resp.has_error());
+    ASSERT_STR_CONTAINS(resp.error().status().message(), "No data uploaded for column");
+
+    rpc.Reset();
+    ASSERT_OK(admin_proxy_->FinishBulkIngest(req, &resp, &rpc));
+    ASSERT_TRUE(resp.has_error());
+    ASSERT_STR_CONTAINS(resp.error().status().message(), "Unknown bulk ingest session");
+  }
+
+  // An explicit abort discards the session and its blocks.
+  {
+    BeginBulkIngestRequestPB req;
+    BeginBulkIngestResponsePB resp;
+    RpcController rpc;
+    req.set_dest_uuid(uuid);
+    req.set_tablet_id(kTabletId);
+    req.set_schema_version(schema_version);
+    ASSERT_OK(admin_proxy_->BeginBulkIngest(req, &resp, &rpc));
+    ASSERT_FALSE(resp.has_error()) << SecureDebugString(resp);
+    session_id = resp.session_id();
+  }
+  {
+    FinishBulkIngestRequestPB req;
+    FinishBulkIngestResponsePB resp;
+    RpcController rpc;
+    req.set_dest_uuid(uuid);
+    req.set_session_id(session_id);
+    req.set_abort(true);
+    ASSERT_OK(admin_proxy_->FinishBulkIngest(req, &resp, &rpc));
+    ASSERT_FALSE(resp.has_error()) << SecureDebugString(resp);
+
+    rpc.Reset();
+    req.set_abort(false);
+    ASSERT_OK(admin_proxy_->FinishBulkIngest(req, &resp, &rpc));
+    ASSERT_TRUE(resp.has_error());
+    ASSERT_STR_CONTAINS(resp.error().status().message(), "Unknown bulk ingest session");
+  }
+}
+
 // Test that with concurrent requests to delete the same tablet, one wins and
 // the other fails, with no assertion failures. Regression test for KUDU-345.
 TEST_F(TabletServerTest, TestConcurrentDeleteTablet) {
@@ -17,6 +17,7 @@
 
 #include "kudu/tserver/tablet_server.h"
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <list>
 #include <vector>
@@ -33,11 +34,28 @@
 #include "kudu/tserver/ts_tablet_manager.h"
 #include "kudu/tserver/tserver-path-handlers.h"
 #include "kudu/tserver/tablet_copy_service.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/maintenance_manager.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/status.h"
 
+DEFINE_int32(consensus_service_queue_length, 256,
+             "Length of the queue for incoming consensus service requests. "
+             "Consensus requests are small and cheap to process, so this is "
+             "sized larger than the default RPC queue length "
+             "(--rpc_service_queue_length) to avoid dropping them (and "
+             "triggering elections) when the server is under heavy load.");
+TAG_FLAG(consensus_service_queue_length, advanced);
+
+DEFINE_int32(consensus_service_num_threads, 10,
+             "Number of RPC worker threads dedicated to the consensus service. "
+             "The consensus service has its own pool so that heartbeats and "
+             "other consensus traffic, which drive follower safe time forward, "
+             "are not queued behind data-plane requests handled by the shared "
+             "worker pool (--rpc_num_service_threads).");
+TAG_FLAG(consensus_service_num_threads, advanced);
+
 using kudu::rpc::ServiceIf;
 using kudu::tablet::TabletPeer;
 using std::shared_ptr;
@@ -119,7 +137,9 @@ Status TabletServer::Start() {
 
   RETURN_NOT_OK(ServerBase::RegisterService(std::move(ts_service)));
   RETURN_NOT_OK(ServerBase::RegisterService(std::move(admin_service)));
-  RETURN_NOT_OK(ServerBase::RegisterService(std::move(consensus_service)));
+  RETURN_NOT_OK(ServerBase::RegisterService(std::move(consensus_service),
+                                            FLAGS_consensus_service_queue_length,
+                                            FLAGS_consensus_service_num_threads));
   RETURN_NOT_OK(ServerBase::RegisterService(std::move(tablet_copy_service)));
   RETURN_NOT_OK(ServerBase::Start());
 
@@ -19,16 +19,23 @@
 
 #include <algorithm>
 #include <boost/optional.hpp>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include "kudu/common/generic_iterators.h"
 #include "kudu/common/iterator.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/scan_deadline.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/consensus/consensus.h"
 #include "kudu/consensus/time_manager.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/stl_util.h"
@@ -39,10 +46,13 @@
 #include "kudu/server/hybrid_clock.h"
 #include "kudu/tablet/compaction.h"
 #include "kudu/tablet/metadata.pb.h"
+#include "kudu/tablet/rowset_metadata.h"
+#include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet_bootstrap.h"
 #include "kudu/tablet/tablet_metrics.h"
 #include "kudu/tablet/tablet_peer.h"
 #include "kudu/tablet/transactions/alter_schema_transaction.h"
+#include "kudu/tablet/transactions/transaction_tracker.h"
 #include "kudu/tablet/transactions/write_transaction.h"
 #include "kudu/tserver/tablet_copy_service.h"
 #include "kudu/tserver/scanners.h"
@@ -56,9 +66,12 @@
 #include "kudu/util/logging.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/oid_generator.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/status.h"
 #include "kudu/util/status_callback.h"
+#include "kudu/util/stopwatch.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
 
 DEFINE_int32(scanner_default_batch_size_bytes, 1024 * 1024,
@@ -87,6 +100,64 @@ DEFINE_int32(scanner_max_wait_ms, 1000,
              "longer.");
 TAG_FLAG(scanner_max_wait_ms, advanced);
 
+DEFINE_int32(scanner_batch_time_budget_ms, 500,
+             "The maximum amount of time (in milliseconds) to spend filling a single "
+             "batch of scan results before responding to the client. If the budget "
+             "expires before the requested batch size is reached, the response "
+             "includes a hint so that the client can size its next request to fit "
+             "within the budget.");
+TAG_FLAG(scanner_batch_time_budget_ms, advanced);
+TAG_FLAG(scanner_batch_time_budget_ms, runtime);
+
+DEFINE_int32(scanner_bulk_pool_num_threads, 2,
+             "Number of threads dedicated to servicing continuations of "
+             "long-running scans. Running these on a separate pool keeps the "
+             "shared RPC worker pool available for short requests such as "
+             "point reads and writes. If 0, all scans run on the shared pool.");
+TAG_FLAG(scanner_bulk_pool_num_threads, advanced);
+
+DEFINE_int32(scanner_bulk_scan_threshold_calls, 4,
+             "Number of batches a scanner must have already served before its "
+             "subsequent continuation calls are considered part of a "
+             "long-running scan and moved to the bulk scan pool.");
+TAG_FLAG(scanner_bulk_scan_threshold_calls, advanced);
+TAG_FLAG(scanner_bulk_scan_threshold_calls, runtime);
+
+DEFINE_int32(scanner_max_key_ranges, 64,
+             "Maximum number of disjoint primary key ranges that the key "
+             "predicates of a scan may be decomposed into. When predicates "
+             "on a prefix of the key columns constrain the scan to multiple "
+             "point values (e.g. an IN-list on the leading key column), each "
+             "combination is scanned as its own tight key range, skipping "
+             "the keyspace in between. Scans whose predicates would "
+             "decompose into more ranges than this fall back to a single "
+             "range. If 1 or less, range decomposition is disabled.");
+TAG_FLAG(scanner_max_key_ranges, advanced);
+TAG_FLAG(scanner_max_key_ranges, runtime);
+
+DEFINE_int32(bulk_ingest_session_idle_timeout_ms, 60000,
+             "Amount of time (in milliseconds) a bulk ingest session may sit "
+             "idle before it is aborted and its uploaded blocks are deleted.");
+TAG_FLAG(bulk_ingest_session_idle_timeout_ms, advanced);
+TAG_FLAG(bulk_ingest_session_idle_timeout_ms, runtime);
+
+DEFINE_int32(tablet_max_pending_write_ops, -1,
+             "Maximum number of write transactions that may be queued or "
+             "in-flight on a single tablet before further writes are rejected "
+             "with SERVER_TOO_BUSY. Rejected clients back off and retry. "
+             "If -1, no limit is enforced on the number of pending writes.");
+TAG_FLAG(tablet_max_pending_write_ops, advanced);
+TAG_FLAG(tablet_max_pending_write_ops, runtime);
+
+DEFINE_int64(tablet_max_pending_write_bytes, -1,
+             "Maximum total request size, in bytes, of the write transactions "
+             "that may be queued or in-flight on a single tablet before "
+             "further writes are rejected with SERVER_TOO_BUSY. Rejected "
+             "clients back off and retry. If -1, no limit is enforced on the "
+             "size of pending writes.");
+TAG_FLAG(tablet_max_pending_write_bytes, advanced);
+TAG_FLAG(tablet_max_pending_write_bytes, runtime);
+
 // Fault injection flags.
 DEFINE_int32(scanner_inject_latency_on_each_batch_ms, 0,
              "If set, the scanner will pause the specified number of milliesconds "
@@ -95,6 +166,7 @@ DEFINE_int32(scanner_inject_latency_on_each_batch_ms, 0,
 TAG_FLAG(scanner_inject_latency_on_each_batch_ms, unsafe);
 
 DECLARE_int32(memory_limit_warn_threshold_percentage);
+DECLARE_int32(scanner_shared_scan_window_ms);
 DECLARE_int32(tablet_history_max_age_sec);
 
 using google::protobuf::RepeatedPtrField;
@@ -117,10 +189,13 @@ using kudu::consensus::StartTabletCopyRequestPB;
 using kudu::consensus::StartTabletCopyResponsePB;
 using kudu::consensus::VoteRequestPB;
 using kudu::consensus::VoteResponsePB;
+using kudu::fs::WritableBlock;
 using kudu::rpc::ResultTracker;
 using kudu::rpc::RpcContext;
 using kudu::server::HybridClock;
 using kudu::tablet::AlterSchemaTransactionState;
+using kudu::tablet::KeyRange;
+using kudu::tablet::RowSetMetadata;
 using kudu::tablet::Tablet;
 using kudu::tablet::TabletPeer;
 using kudu::tablet::TabletStatusPB;
@@ -164,6 +239,11 @@ bool LookupTabletPeerOrRespond(TabletPeerLookupIf* tablet_manager,
   // Check RUNNING state.
   tablet::TabletStatePB state = (*peer)->state();
   if (PREDICT_FALSE(state != tablet::RUNNING)) {
+    if (state == tablet::NOT_STARTED) {
+      // A caller is waiting on a tablet which hasn't begun bootstrapping
+      // yet; move it towards the front of the startup open queue.
+      tablet_manager->PrioritizeTabletForOpen(tablet_id);
+    }
     Status s = Status::IllegalState("Tablet not RUNNING",
                                     tablet::TabletStatePB_Name(state));
     if (state == tablet::FAILED) {
@@ -334,6 +414,20 @@ class ScanResultCollector {
 
   // Return the number of rows actually returned to the client.
   virtual int64_t NumRowsReturned() const = 0;
+
+  // Returns true if this collector's serialized output may be archived by a
+  // ScanShareGroup and replayed verbatim to other members of the group.
+  virtual bool SupportsBatchSharing() const { return false; }
+
+  // Copy the accumulated response data into 'batch' for later replay.
+  // Only called when SupportsBatchSharing() returns true.
+  virtual void ArchiveBatch(SharedScanBatch* batch) const {}
+
+  // Append a previously archived batch to the response. The batch must be the
+  // only data in the response: its indirect-data offsets are relative to the
+  // start of its own indirect buffer. Only called when SupportsBatchSharing()
+  // returns true.
+  virtual void AppendArchivedBatch(const SharedScanBatch& batch) {}
 };
 
 namespace {
@@ -399,6 +493,27 @@ class ScanResultCopier : public ScanResultCollector {
     return num_rows_returned_;
   }
 
+  virtual bool SupportsBatchSharing() const OVERRIDE { return true; }
+
+  virtual void ArchiveBatch(SharedScanBatch* batch) const OVERRIDE {
+    batch->num_rows = rowblock_pb_->num_rows();
+    batch->rows_data.assign(reinterpret_cast<const char*>(rows_data_->data()),
+                            rows_data_->size());
+    batch->indirect_data.assign(reinterpret_cast<const char*>(indirect_data_->data()),
+                                indirect_data_->size());
+  }
+
+  virtual void AppendArchivedBatch(const SharedScanBatch& batch) OVERRIDE {
+    // The archived batch's indirect-data offsets are relative to the start of
+    // its own indirect buffer, so it must be the only data in the response.
+    DCHECK_EQ(0, ResponseSize());
+    rowblock_pb_->set_num_rows(rowblock_pb_->num_rows() + batch.num_rows);
+    rows_data_->append(batch.rows_data.data(), batch.rows_data.size());
+    indirect_data_->append(batch.indirect_data.data(), batch.indirect_data.size());
+    blocks_processed_++;
+    num_rows_returned_ += batch.num_rows;
+  }
+
  private:
   RowwiseRowBlockPB* const rowblock_pb_;
   faststring* const rows_data_;
@@ -410,6 +525,56 @@ class ScanResultCopier : public ScanResultCollector {
   DISALLOW_COPY_AND_ASSIGN(ScanResultCopier);
 };
 
+// Copies the scan result into a column-major batch, for scanners created
+// with the COLUMNAR row format. The batch's per-column buffers are attached
+// to the response as sidecars.
+class ScanResultColumnarCopier : public ScanResultCollector {
+ public:
+  ScanResultColumnarCopier()
+      : blocks_processed_(0),
+        num_rows_returned_(0) {
+  }
+
+  virtual void HandleRowBlock(const Schema* client_projection_schema,
+                              const RowBlock& row_block) OVERRIDE {
+    blocks_processed_++;
+    num_rows_returned_ += row_block.selection_vector()->CountSelected();
+    SerializeRowBlockColumnar(row_block, client_projection_schema, &batch_);
+    SetLastRow(row_block, &last_primary_key_);
+  }
+
+  virtual int BlocksProcessed() const OVERRIDE { return blocks_processed_; }
+
+  // Returns number of bytes buffered to return.
+  virtual int64_t ResponseSize() const OVERRIDE {
+    int64_t size = 0;
+    for (const auto& col : batch_.columns) {
+      if (col.data) size += col.data->size();
+      if (col.varlen_data) size += col.varlen_data->size();
+      if (col.non_null_bitmap) size += col.non_null_bitmap->size();
+    }
+    return size;
+  }
+
+  virtual const faststring& last_primary_key() const OVERRIDE {
+    return last_primary_key_;
+  }
+
+  virtual int64_t NumRowsReturned() const OVERRIDE {
+    return num_rows_returned_;
+  }
+
+  ColumnarSerializedBatch* batch() { return &batch_; }
+
+ private:
+  ColumnarSerializedBatch batch_;
+  int blocks_processed_;
+  int64_t num_rows_returned_;
+  faststring last_primary_key_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScanResultColumnarCopier);
+};
+
 // Checksums the scan result.
 class ScanResultChecksummer : public ScanResultCollector {
  public:
@@ -511,6 +676,11 @@ static size_t GetMaxBatchSizeBytesHint(const ScanRequestPB* req) {
 TabletServiceImpl::TabletServiceImpl(TabletServer* server)
   : TabletServerServiceIf(server->metric_entity(), server->result_tracker()),
     server_(server) {
+  if (FLAGS_scanner_bulk_pool_num_threads > 0) {
+    CHECK_OK(ThreadPoolBuilder("bulk-scan")
+             .set_max_threads(FLAGS_scanner_bulk_pool_num_threads)
+             .Build(&bulk_scan_pool_));
+  }
 }
 
 void TabletServiceImpl::Ping(const PingRequestPB* req,
@@ -519,11 +689,63 @@ void TabletServiceImpl::Ping(const PingRequestPB* req,
   context->RespondSuccess();
 }
 
+// State for an open bulk ingest session: the destination tablet and the
+// writable blocks opened so far. A session is only ever operated on by one
+// RPC at a time (see TakeBulkIngestSession()), so no locking is needed on
+// the session itself. Dropping a session aborts any blocks which have not
+// been closed (see the WritableBlock destructor), deleting their data.
+struct TabletServiceAdminImpl::BulkIngestSession {
+  scoped_refptr<TabletPeer> tablet_peer;
+
+  // The tablet's schema version when the session was opened.
+  uint32_t schema_version;
+
+  // Open destination blocks, keyed by column index in the tablet schema.
+  std::map<int, unique_ptr<WritableBlock>> column_blocks;
+  unique_ptr<WritableBlock> bloom_block;
+  unique_ptr<WritableBlock> adhoc_index_block;
+
+  // Time of the last successful call against this session.
+  MonoTime last_active;
+};
+
 TabletServiceAdminImpl::TabletServiceAdminImpl(TabletServer* server)
   : TabletServerAdminServiceIf(server->metric_entity(), server->result_tracker()),
     server_(server) {
 }
 
+TabletServiceAdminImpl::~TabletServiceAdminImpl() {
+  std::lock_guard<simple_spinlock> l(bulk_ingest_lock_);
+  bulk_ingest_sessions_.clear();
+}
+
+std::unique_ptr<TabletServiceAdminImpl::BulkIngestSession>
+TabletServiceAdminImpl::TakeBulkIngestSession(const string& session_id) {
+  std::lock_guard<simple_spinlock> l(bulk_ingest_lock_);
+  auto it = bulk_ingest_sessions_.find(session_id);
+  if (it == bulk_ingest_sessions_.end()) {
+    return nullptr;
+  }
+  unique_ptr<BulkIngestSession> session = std::move(it->second);
+  bulk_ingest_sessions_.erase(it);
+  return session;
+}
+
+void TabletServiceAdminImpl::ExpireIdleBulkIngestSessions() {
+  MonoDelta timeout = MonoDelta::FromMilliseconds(FLAGS_bulk_ingest_session_idle_timeout_ms);
+  MonoTime now = MonoTime::Now();
+  std::lock_guard<simple_spinlock> l(bulk_ingest_lock_);
+  for (auto it = bulk_ingest_sessions_.begin(); it != bulk_ingest_sessions_.end();) {
+    if (now - it->second->last_active > timeout) {
+      LOG(INFO) << "Expiring idle bulk ingest session " << it->first
+                << " on tablet " << it->second->tablet_peer->tablet_id();
+      it = bulk_ingest_sessions_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
 void TabletServiceAdminImpl::AlterSchema(const AlterSchemaRequestPB* req,
                                          AlterSchemaResponsePB* resp,
                                          rpc::RpcContext* context) {
@@ -552,7 +774,7 @@ void TabletServiceAdminImpl::AlterSchema(const AlterSchemaRequestPB* req,
       return;
     }
 
-    Schema tablet_schema = tablet_peer->tablet_metadata()->schema();
+    const Schema& tablet_schema = tablet_peer->tablet_metadata()->schema();
     if (req_schema.Equals(tablet_schema)) {
       context->RespondSuccess();
       return;
@@ -691,6 +913,244 @@ void TabletServiceAdminImpl::DeleteTablet(const DeleteTabletRequestPB* req,
   context->RespondSuccess();
 }
 
+void TabletServiceAdminImpl::BeginBulkIngest(const BeginBulkIngestRequestPB* req,
+                                             BeginBulkIngestResponsePB* resp,
+                                             rpc::RpcContext* context) {
+  if (!CheckUuidMatchOrRespond(server_->tablet_manager(), "BeginBulkIngest", req, resp, context)) {
+    return;
+  }
+  TRACE_EVENT1("tserver", "BeginBulkIngest",
+               "tablet_id", req->tablet_id());
+
+  // Piggy-back garbage collection of abandoned sessions on new session
+  // creation rather than running a dedicated expiry thread.
+  ExpireIdleBulkIngestSessions();
+
+  scoped_refptr<TabletPeer> tablet_peer;
+  if (!LookupTabletPeerOrRespond(server_->tablet_manager(), req->tablet_id(), resp, context,
+                                 &tablet_peer)) {
+    return;
+  }
+  shared_ptr<Tablet> tablet;
+  TabletServerErrorPB::Code error_code;
+  Status s = GetTabletRef(tablet_peer, &tablet, &error_code);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+    return;
+  }
+
+  uint32_t schema_version = tablet_peer->tablet_metadata()->schema_version();
+  if (schema_version != req->schema_version()) {
+    SetupErrorAndRespond(resp->mutable_error(),
+                         Status::InvalidArgument(
+                             Substitute("Blocks were encoded against schema version $0 but the "
+                                        "tablet is at version $1",
+                                        req->schema_version(), schema_version)),
+                         TabletServerErrorPB::MISMATCHED_SCHEMA, context);
+    return;
+  }
+
+  unique_ptr<BulkIngestSession> session(new BulkIngestSession);
+  session->tablet_peer = tablet_peer;
+  session->schema_version = schema_version;
+  session->last_active = MonoTime::Now();
+
+  string session_id = bulk_ingest_oid_generator_.Next();
+  {
+    std::lock_guard<simple_spinlock> l(bulk_ingest_lock_);
+    bulk_ingest_sessions_.emplace(session_id, std::move(session));
+  }
+
+  LOG(INFO) << "Opened bulk ingest session " << session_id
+            << " on tablet " << req->tablet_id()
+            << " from " << context->requestor_string();
+  resp->set_session_id(session_id);
+  context->RespondSuccess();
+}
+
+void TabletServiceAdminImpl::BulkIngestData(const BulkIngestDataRequestPB* req,
+                                            BulkIngestDataResponsePB* resp,
+                                            rpc::RpcContext* context) {
+  if (!CheckUuidMatchOrRespond(server_->tablet_manager(), "BulkIngestData", req, resp, context)) {
+    return;
+  }
+
+  unique_ptr<BulkIngestSession> session = TakeBulkIngestSession(req->session_id());
+  if (!session) {
+    SetupErrorAndRespond(resp->mutable_error(),
+                         Status::NotFound("Unknown bulk ingest session", req->session_id()),
+                         TabletServerErrorPB::UNKNOWN_ERROR, context);
+    return;
+  }
+
+  // Pick the destination block, opening it on first use. Any failure below
+  // drops the session, aborting all of its blocks: a partially written
+  // block set cannot be committed.
+  unique_ptr<WritableBlock>* block = nullptr;
+  switch (req->block_type()) {
+    case BulkIngestDataRequestPB::COLUMN: {
+      const Schema& schema = session->tablet_peer->tablet_metadata()->schema();
+      if (!req->has_column_idx() || req->column_idx() >= schema.num_columns()) {
+        SetupErrorAndRespond(resp->mutable_error(),
+                             Status::InvalidArgument(
+                                 Substitute("Invalid column index $0 for COLUMN block",
+                                            req->column_idx())),
+                             TabletServerErrorPB::UNKNOWN_ERROR, context);
+        return;
+      }
+      block = &session->column_blocks[req->column_idx()];
+      break;
+    }
+    case BulkIngestDataRequestPB::BLOOM:
+      block = &session->bloom_block;
+      break;
+    case BulkIngestDataRequestPB::ADHOC_INDEX:
+      block = &session->adhoc_index_block;
+      break;
+    default:
+      SetupErrorAndRespond(resp->mutable_error(),
+                           Status::InvalidArgument("Unknown block type"),
+                           TabletServerErrorPB::UNKNOWN_ERROR, context);
+      return;
+  }
+
+  Status s;
+  if (!*block) {
+    gscoped_ptr<WritableBlock> new_block;
+    s = server_->fs_manager()->CreateNewBlock(&new_block);
+    if (s.ok()) {
+      block->reset(new_block.release());
+    }
+  }
+  if (s.ok()) {
+    s = (*block)->Append(req->data());
+  }
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s,
+                         TabletServerErrorPB::UNKNOWN_ERROR, context);
+    return;
+  }
+
+  session->last_active = MonoTime::Now();
+  {
+    std::lock_guard<simple_spinlock> l(bulk_ingest_lock_);
+    bulk_ingest_sessions_.emplace(req->session_id(), std::move(session));
+  }
+  context->RespondSuccess();
+}
+
+void TabletServiceAdminImpl::FinishBulkIngest(const FinishBulkIngestRequestPB* req,
+                                              FinishBulkIngestResponsePB* resp,
+                                              rpc::RpcContext* context) {
+  if (!CheckUuidMatchOrRespond(server_->tablet_manager(), "FinishBulkIngest", req, resp, context)) {
+    return;
+  }
+
+  unique_ptr<BulkIngestSession> session = TakeBulkIngestSession(req->session_id());
+  if (!session) {
+    SetupErrorAndRespond(resp->mutable_error(),
+                         Status::NotFound("Unknown bulk ingest session", req->session_id()),
+                         TabletServerErrorPB::UNKNOWN_ERROR, context);
+    return;
+  }
+  const string& tablet_id = session->tablet_peer->tablet_id();
+
+  if (req->abort()) {
+    LOG(INFO) << "Aborting bulk ingest session " << req->session_id()
+              << " on tablet " << tablet_id;
+    // Dropping the session aborts its blocks.
+    context->RespondSuccess();
+    return;
+  }
+
+  shared_ptr<Tablet> tablet;
+  TabletServerErrorPB::Code error_code;
+  Status s = GetTabletRef(session->tablet_peer, &tablet, &error_code);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+    return;
+  }
+
+  // Reject the commit if the schema changed while the session was open:
+  // the uploaded blocks carry the old column set.
+  const Schema& schema = session->tablet_peer->tablet_metadata()->schema();
+  if (session->tablet_peer->tablet_metadata()->schema_version() != session->schema_version) {
+    SetupErrorAndRespond(resp->mutable_error(),
+                         Status::Aborted("Tablet schema changed while the bulk ingest "
+                                         "session was open"),
+                         TabletServerErrorPB::MISMATCHED_SCHEMA, context);
+    return;
+  }
+
+  // The block set must describe a complete DiskRowSet: one cfile per
+  // column, a bloom file, and an ad hoc index when the primary key is
+  // compound (CFileSet cannot open a rowset otherwise).
+  s = Status::OK();
+  for (size_t idx = 0; idx < schema.num_columns(); idx++) {
+    if (!ContainsKey(session->column_blocks, idx)) {
+      s = Status::InvalidArgument(
+          Substitute("No data uploaded for column '$0' (index $1)",
+                     schema.column(idx).name(), idx));
+      break;
+    }
+  }
+  if (s.ok() && !session->bloom_block) {
+    s = Status::InvalidArgument("No bloom filter block uploaded");
+  }
+  if (s.ok() && schema.num_key_columns() > 1 && !session->adhoc_index_block) {
+    s = Status::InvalidArgument("No ad hoc index block uploaded for compound primary key");
+  }
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s,
+                         TabletServerErrorPB::UNKNOWN_ERROR, context);
+    return;
+  }
+
+  // Close the blocks, syncing their contents, and collect their ids.
+  RowSetMetadata::ColumnIdToBlockIdMap cols_by_id;
+  for (const auto& e : session->column_blocks) {
+    cols_by_id[schema.column_id(e.first)] = e.second->id();
+    s = e.second->Close();
+    if (PREDICT_FALSE(!s.ok())) break;
+  }
+  BlockId bloom_block_id = session->bloom_block->id();
+  if (s.ok()) {
+    s = session->bloom_block->Close();
+  }
+  BlockId adhoc_index_block_id;
+  if (s.ok() && session->adhoc_index_block) {
+    adhoc_index_block_id = session->adhoc_index_block->id();
+    s = session->adhoc_index_block->Close();
+  }
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(),
+                         s.CloneAndPrepend("Unable to close bulk ingest block"),
+                         TabletServerErrorPB::UNKNOWN_ERROR, context);
+    return;
+  }
+
+  shared_ptr<RowSetMetadata> rowset_meta;
+  s = session->tablet_peer->tablet_metadata()->CreateRowSet(&rowset_meta, schema);
+  if (s.ok()) {
+    rowset_meta->SetColumnDataBlocks(cols_by_id);
+    rowset_meta->set_bloom_block(bloom_block_id);
+    if (session->adhoc_index_block) {
+      rowset_meta->set_adhoc_index_block(adhoc_index_block_id);
+    }
+    s = tablet->AdoptRowSet(rowset_meta);
+  }
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s,
+                         TabletServerErrorPB::UNKNOWN_ERROR, context);
+    return;
+  }
+
+  LOG(INFO) << "Committed bulk ingest session " << req->session_id()
+            << " on tablet " << tablet_id << ": adopted rowset "
+            << rowset_meta->id() << " with " << cols_by_id.size() << " columns";
+  context->RespondSuccess();
+}
+
 void TabletServiceImpl::Write(const WriteRequestPB* req,
                               WriteResponsePB* resp,
                               rpc::RpcContext* context) {
@@ -722,6 +1182,30 @@ void TabletServiceImpl::Write(const WriteRequestPB* req,
     return;
   }
 
+  // Apply per-tablet admission control: if the tablet already has a deep
+  // queue of pending transactions, reject the write up front rather than
+  // queueing it behind them only to time out later. The SERVER_TOO_BUSY
+  // response causes well-behaved clients to back off before retrying.
+  if (FLAGS_tablet_max_pending_write_ops > 0 ||
+      FLAGS_tablet_max_pending_write_bytes > 0) {
+    const tablet::TransactionTracker* txn_tracker = tablet_peer->transaction_tracker();
+    int64_t pending_ops = txn_tracker->NumPending();
+    int64_t pending_bytes = txn_tracker->PendingBytes();
+    if ((FLAGS_tablet_max_pending_write_ops > 0 &&
+         pending_ops >= FLAGS_tablet_max_pending_write_ops) ||
+        (FLAGS_tablet_max_pending_write_bytes > 0 &&
+         pending_bytes >= FLAGS_tablet_max_pending_write_bytes)) {
+      SetupErrorAndRespond(
+          resp->mutable_error(),
+          Status::ServiceUnavailable(Substitute(
+              "Rejecting Write request: tablet $0 has $1 pending transactions "
+              "totalling $2 bytes", req->tablet_id(), pending_ops, pending_bytes)),
+          TabletServerErrorPB::THROTTLED,
+          context);
+      return;
+    }
+  }
+
   // Check for memory pressure; don't bother doing any additional work if we've
   // exceeded the limit.
   double capacity_pct;
@@ -1036,10 +1520,45 @@ void SetResourceMetrics(ResourceMetricsPB* metrics, rpc::RpcContext* context) {
 }
 } // anonymous namespace
 
+bool TabletServiceImpl::ShouldRunScanOnBulkPool(const ScanRequestPB* req) const {
+  if (!bulk_scan_pool_ || !req->has_scanner_id()) {
+    return false;
+  }
+  SharedScanner scanner;
+  if (!server_->scanner_manager()->LookupScanner(req->scanner_id(), &scanner)) {
+    return false;
+  }
+  return scanner->call_seq_id() >= FLAGS_scanner_bulk_scan_threshold_calls;
+}
+
 void TabletServiceImpl::Scan(const ScanRequestPB* req,
                              ScanResponsePB* resp,
                              rpc::RpcContext* context) {
+  // Continuations of scans which have already served several batches are
+  // offloaded to a small dedicated pool, so that a handful of large scans
+  // can't occupy every RPC worker and starve short requests.
+  if (PREDICT_FALSE(ShouldRunScanOnBulkPool(req))) {
+    Status s = bulk_scan_pool_->SubmitClosure(
+        Bind(&TabletServiceImpl::DoScan, Unretained(this), req, resp, context));
+    if (PREDICT_TRUE(s.ok())) {
+      return;
+    }
+    // If the pool is shutting down, fall through and run the scan inline.
+  }
+  DoScan(req, resp, context);
+}
+
+void TabletServiceImpl::DoScan(const ScanRequestPB* req,
+                               ScanResponsePB* resp,
+                               rpc::RpcContext* context) {
   TRACE_EVENT0("tserver", "TabletServiceImpl::Scan");
+  // Account for the time the request spent queued (from RPC arrival to the
+  // start of processing, including any wait for a bulk scan pool thread) and
+  // the CPU it consumes, so the cost can be returned to the client.
+  int64_t queue_duration_nanos =
+      (MonoTime::Now() - context->GetTimeReceived()).ToNanoseconds();
+  Stopwatch sw(Stopwatch::THIS_THREAD);
+  sw.start();
   // Validate the request: user must pass a new_scan_request or
   // a scanner ID, but not both.
   if (PREDICT_FALSE(req->has_scanner_id() &&
@@ -1050,12 +1569,37 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
   }
 
   size_t batch_size_bytes = GetMaxBatchSizeBytesHint(req);
-  gscoped_ptr<faststring> rows_data(new faststring(batch_size_bytes * 11 / 10));
-  gscoped_ptr<faststring> indirect_data(new faststring(batch_size_bytes * 11 / 10));
+
+  // Determine the wire format for the results. For a new scan this comes
+  // from the request; for a continuation it was remembered by the scanner.
+  RowFormatPB row_format = ROWWISE;
+  if (req->has_new_scan_request()) {
+    row_format = req->new_scan_request().row_format();
+  } else if (req->has_scanner_id()) {
+    SharedScanner scanner;
+    if (server_->scanner_manager()->LookupScanner(req->scanner_id(), &scanner)) {
+      row_format = scanner->row_format();
+    }
+  }
+
+  gscoped_ptr<faststring> rows_data;
+  gscoped_ptr<faststring> indirect_data;
   RowwiseRowBlockPB data;
-  ScanResultCopier collector(&data, rows_data.get(), indirect_data.get());
+  gscoped_ptr<ScanResultCopier> rowwise_collector;
+  gscoped_ptr<ScanResultColumnarCopier> columnar_collector;
+  ScanResultCollector* collector;
+  if (row_format == COLUMNAR) {
+    columnar_collector.reset(new ScanResultColumnarCopier());
+    collector = columnar_collector.get();
+  } else {
+    rows_data.reset(new faststring(batch_size_bytes * 11 / 10));
+    indirect_data.reset(new faststring(batch_size_bytes * 11 / 10));
+    rowwise_collector.reset(new ScanResultCopier(&data, rows_data.get(), indirect_data.get()));
+    collector = rowwise_collector.get();
+  }
 
   bool has_more_results = false;
+  uint32_t batch_size_bytes_hint = 0;
   TabletServerErrorPB::Code error_code = TabletServerErrorPB::UNKNOWN_ERROR;
   if (req->has_new_scan_request()) {
     const NewScanRequestPB& scan_pb = req->new_scan_request();
@@ -1067,22 +1611,27 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
     string scanner_id;
     Timestamp scan_timestamp;
     Status s = HandleNewScanRequest(tablet_peer.get(), req, context,
-                                    &collector, &scanner_id, &scan_timestamp, &has_more_results,
-                                    &error_code);
+                                    collector, resp->mutable_resource_metrics(),
+                                    &scanner_id, &scan_timestamp, &has_more_results,
+                                    &batch_size_bytes_hint, &error_code);
     if (PREDICT_FALSE(!s.ok())) {
       SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
       return;
     }
 
-    // Only set the scanner id if we have more results.
-    if (has_more_results) {
+    // Only set the scanner id if we have more results and retained state
+    // server-side (i.e. this was not a stateless scan).
+    if (has_more_results && !scanner_id.empty()) {
       resp->set_scanner_id(scanner_id);
     }
     if (scan_timestamp != Timestamp::kInvalidTimestamp) {
       resp->set_snap_timestamp(scan_timestamp.ToUint64());
     }
   } else if (req->has_scanner_id()) {
-    Status s = HandleContinueScanRequest(req, &collector, &has_more_results, &error_code);
+    Status s = HandleContinueScanRequest(req, context, collector,
+                                         resp->mutable_resource_metrics(),
+                                         &has_more_results,
+                                         &batch_size_bytes_hint, &error_code);
     if (PREDICT_FALSE(!s.ok())) {
       SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
       return;
@@ -1093,35 +1642,69 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
     return;
   }
   resp->set_has_more_results(has_more_results);
-
-  DVLOG(2) << "Blocks processed: " << collector.BlocksProcessed();
-  if (collector.BlocksProcessed() > 0) {
-    resp->mutable_data()->CopyFrom(data);
-
-    // Add sidecar data to context and record the returned indices.
-    int rows_idx;
-    CHECK_OK(context->AddRpcSidecar(make_gscoped_ptr(
-        new rpc::RpcSidecar(std::move(rows_data))), &rows_idx));
-    resp->mutable_data()->set_rows_sidecar(rows_idx);
-
-    // Add indirect data as a sidecar, if applicable.
-    if (indirect_data->size() > 0) {
-      int indirect_idx;
-      CHECK_OK(context->AddRpcSidecar(make_gscoped_ptr(
-          new rpc::RpcSidecar(std::move(indirect_data))), &indirect_idx));
-      resp->mutable_data()->set_indirect_data_sidecar(indirect_idx);
+  if (has_more_results && batch_size_bytes_hint > 0) {
+    resp->set_batch_size_bytes_hint(batch_size_bytes_hint);
+  }
+
+  DVLOG(2) << "Blocks processed: " << collector->BlocksProcessed();
+  if (collector->BlocksProcessed() > 0) {
+    if (row_format == COLUMNAR) {
+      // Attach each column's buffers as sidecars.
+      ColumnarSerializedBatch* batch = columnar_collector->batch();
+      ColumnarRowBlockPB* data_pb = resp->mutable_columnar_data();
+      data_pb->set_num_rows(batch->num_rows);
+      for (auto& col : batch->columns) {
+        ColumnarRowBlockPB::Column* col_pb = data_pb->add_columns();
+        int sidecar_idx;
+        CHECK_OK(context->AddRpcSidecar(
+            rpc::RpcSidecar::FromFaststring(make_gscoped_ptr(col.data.release())),
+            &sidecar_idx));
+        col_pb->set_data_sidecar(sidecar_idx);
+        if (col.varlen_data) {
+          CHECK_OK(context->AddRpcSidecar(
+              rpc::RpcSidecar::FromFaststring(make_gscoped_ptr(col.varlen_data.release())),
+              &sidecar_idx));
+          col_pb->set_varlen_data_sidecar(sidecar_idx);
+        }
+        if (col.non_null_bitmap) {
+          CHECK_OK(context->AddRpcSidecar(
+              rpc::RpcSidecar::FromFaststring(make_gscoped_ptr(col.non_null_bitmap.release())),
+              &sidecar_idx));
+          col_pb->set_non_null_bitmap_sidecar(sidecar_idx);
+        }
+      }
+    } else {
+      resp->mutable_data()->CopyFrom(data);
+
+      // Add sidecar data to context and record the returned indices.
+      int rows_idx;
+      CHECK_OK(context->AddRpcSidecar(
+          rpc::RpcSidecar::FromFaststring(std::move(rows_data)), &rows_idx));
+      resp->mutable_data()->set_rows_sidecar(rows_idx);
+
+      // Add indirect data as a sidecar, if applicable.
+      if (indirect_data->size() > 0) {
+        int indirect_idx;
+        CHECK_OK(context->AddRpcSidecar(
+            rpc::RpcSidecar::FromFaststring(std::move(indirect_data)), &indirect_idx));
+        resp->mutable_data()->set_indirect_data_sidecar(indirect_idx);
+      }
     }
 
     // Set the last row found by the collector.
     // We could have an empty batch if all the remaining rows are filtered by the predicate,
     // in which case do not set the last row.
-    const faststring& last = collector.last_primary_key();
+    const faststring& last = collector->last_primary_key();
     if (last.length() > 0) {
       resp->set_last_primary_key(last.ToString());
     }
   }
   resp->set_propagated_timestamp(server_->clock()->Now().ToUint64());
   SetResourceMetrics(resp->mutable_resource_metrics(), context);
+  sw.stop();
+  resp->mutable_resource_metrics()->set_queue_duration_nanos(queue_duration_nanos);
+  resp->mutable_resource_metrics()->set_cpu_user_nanos(sw.elapsed().user);
+  resp->mutable_resource_metrics()->set_cpu_system_nanos(sw.elapsed().system);
   context->RespondSuccess();
 }
 
@@ -1144,10 +1727,276 @@ void TabletServiceImpl::ListTablets(const ListTabletsRequestPB* req,
   context->RespondSuccess();
 }
 
+void TabletServiceImpl::SplitKeyRange(const SplitKeyRangeRequestPB* req,
+                                      SplitKeyRangeResponsePB* resp,
+                                      rpc::RpcContext* context) {
+  scoped_refptr<TabletPeer> tablet_peer;
+  if (!LookupTabletPeerOrRespond(server_->tablet_manager(), req->tablet_id(), resp, context,
+                                 &tablet_peer)) {
+    return;
+  }
+  shared_ptr<Tablet> tablet;
+  TabletServerErrorPB::Code error_code;
+  Status s = GetTabletRef(tablet_peer, &tablet, &error_code);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+    return;
+  }
+
+  // Validate that the requested keys decode against the tablet schema before
+  // using them as split bounds.
+  const Schema& tablet_schema = tablet->metadata()->schema();
+  Arena arena(256, 4096);
+  gscoped_ptr<EncodedKey> start, stop;
+  if (req->has_start_primary_key()) {
+    s = EncodedKey::DecodeEncodedString(tablet_schema, &arena,
+                                        req->start_primary_key(), &start);
+    if (PREDICT_FALSE(!s.ok())) {
+      SetupErrorAndRespond(resp->mutable_error(),
+                           s.CloneAndPrepend("Invalid SplitKeyRange start key"),
+                           TabletServerErrorPB::INVALID_SCAN_SPEC, context);
+      return;
+    }
+  }
+  if (req->has_stop_primary_key()) {
+    s = EncodedKey::DecodeEncodedString(tablet_schema, &arena,
+                                        req->stop_primary_key(), &stop);
+    if (PREDICT_FALSE(!s.ok())) {
+      SetupErrorAndRespond(resp->mutable_error(),
+                           s.CloneAndPrepend("Invalid SplitKeyRange stop key"),
+                           TabletServerErrorPB::INVALID_SCAN_SPEC, context);
+      return;
+    }
+  }
+
+  vector<KeyRange> ranges;
+  tablet->SplitKeyRange(start ? start->encoded_key() : Slice(),
+                        stop ? stop->encoded_key() : Slice(),
+                        req->target_chunk_size_bytes(),
+                        &ranges);
+  for (const KeyRange& range : ranges) {
+    KeyRangePB* range_pb = resp->add_ranges();
+    if (!range.start_primary_key.empty()) {
+      range_pb->set_start_primary_key(range.start_primary_key);
+    }
+    if (!range.stop_primary_key.empty()) {
+      range_pb->set_stop_primary_key(range.stop_primary_key);
+    }
+    range_pb->set_size_bytes_estimate(range.size_bytes);
+  }
+  context->RespondSuccess();
+}
+
+void TabletServiceImpl::KeyRangeEstimate(const KeyRangeEstimateRequestPB* req,
+                                         KeyRangeEstimateResponsePB* resp,
+                                         rpc::RpcContext* context) {
+  scoped_refptr<TabletPeer> tablet_peer;
+  if (!LookupTabletPeerOrRespond(server_->tablet_manager(), req->tablet_id(), resp, context,
+                                 &tablet_peer)) {
+    return;
+  }
+  shared_ptr<Tablet> tablet;
+  TabletServerErrorPB::Code error_code;
+  Status s = GetTabletRef(tablet_peer, &tablet, &error_code);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+    return;
+  }
+
+  const Schema& tablet_schema = tablet->metadata()->schema();
+  Arena arena(256, 4096);
+  gscoped_ptr<EncodedKey> start, stop;
+  if (req->has_start_primary_key()) {
+    s = EncodedKey::DecodeEncodedString(tablet_schema, &arena,
+                                        req->start_primary_key(), &start);
+    if (PREDICT_FALSE(!s.ok())) {
+      SetupErrorAndRespond(resp->mutable_error(),
+                           s.CloneAndPrepend("Invalid KeyRangeEstimate start key"),
+                           TabletServerErrorPB::INVALID_SCAN_SPEC, context);
+      return;
+    }
+  }
+  if (req->has_stop_primary_key()) {
+    s = EncodedKey::DecodeEncodedString(tablet_schema, &arena,
+                                        req->stop_primary_key(), &stop);
+    if (PREDICT_FALSE(!s.ok())) {
+      SetupErrorAndRespond(resp->mutable_error(),
+                           s.CloneAndPrepend("Invalid KeyRangeEstimate stop key"),
+                           TabletServerErrorPB::INVALID_SCAN_SPEC, context);
+      return;
+    }
+  }
+
+  uint64_t row_count, bytes;
+  s = tablet->EstimateRowsAndBytesInRange(start.get(), stop.get(), &row_count, &bytes);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s,
+                         TabletServerErrorPB::UNKNOWN_ERROR, context);
+    return;
+  }
+  resp->set_row_count_estimate(row_count);
+  resp->set_size_bytes_estimate(bytes);
+  context->RespondSuccess();
+}
+
+void TabletServiceImpl::MultiGet(const MultiGetRequestPB* req,
+                                 MultiGetResponsePB* resp,
+                                 rpc::RpcContext* context) {
+  scoped_refptr<TabletPeer> tablet_peer;
+  if (!LookupTabletPeerOrRespond(server_->tablet_manager(), req->tablet_id(), resp, context,
+                                 &tablet_peer)) {
+    return;
+  }
+  shared_ptr<Tablet> tablet;
+  TabletServerErrorPB::Code error_code;
+  Status s = GetTabletRef(tablet_peer, &tablet, &error_code);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+    return;
+  }
+
+  Schema projection;
+  s = ColumnPBsToSchema(req->projected_columns(), &projection);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s,
+                         TabletServerErrorPB::INVALID_SCHEMA, context);
+    return;
+  }
+  if (PREDICT_FALSE(projection.has_column_ids())) {
+    SetupErrorAndRespond(resp->mutable_error(),
+                         Status::InvalidArgument("User requests should not have Column IDs"),
+                         TabletServerErrorPB::INVALID_SCHEMA, context);
+    return;
+  }
+
+  const Schema& tablet_schema = tablet->metadata()->schema();
+
+  // All of the lookups in the batch are performed against the same MVCC
+  // snapshot, so the batch sees a consistent view of the tablet.
+  MvccSnapshot snap(*tablet->mvcc_manager());
+
+  // The decoded key bounds must outlive the iterators which reference them,
+  // so they get their own arena, separate from the row block's arena which
+  // is reset on every NextBlock() call.
+  Arena key_arena(1024, 64 * 1024);
+  Arena block_arena(32 * 1024, 1024 * 1024);
+
+  RowwiseRowBlockPB data;
+  gscoped_ptr<faststring> rows_data(new faststring());
+  gscoped_ptr<faststring> indirect_data(new faststring());
+  gscoped_ptr<RowBlock> block;
+
+  for (int i = 0; i < req->primary_keys_size(); i++) {
+    // Each key becomes a tightly-bounded one-row scan spec: the key index
+    // seeks directly to the row, and rowsets whose key ranges don't contain
+    // the key are skipped entirely.
+    gscoped_ptr<EncodedKey> start, stop;
+    s = EncodedKey::DecodeEncodedString(tablet_schema, &key_arena,
+                                        req->primary_keys(i), &start);
+    if (s.ok()) {
+      s = EncodedKey::DecodeEncodedString(tablet_schema, &key_arena,
+                                          req->primary_keys(i), &stop);
+    }
+    if (PREDICT_FALSE(!s.ok())) {
+      SetupErrorAndRespond(resp->mutable_error(),
+                           s.CloneAndPrepend(Substitute("Invalid MultiGet key $0", i)),
+                           TabletServerErrorPB::INVALID_SCAN_SPEC, context);
+      return;
+    }
+    // If the key is the maximum possible encoded key, leave the range open
+    // above; no row can sort after it anyway.
+    if (!EncodedKey::IncrementEncodedKey(tablet_schema, &stop, &key_arena).ok()) {
+      stop.reset();
+    }
+    ScanSpec spec;
+    spec.SetLowerBoundKey(start.get());
+    if (stop) {
+      spec.SetExclusiveUpperBoundKey(stop.get());
+    }
+
+    gscoped_ptr<RowwiseIterator> iter;
+    s = tablet->NewRowIterator(projection, snap, UNORDERED, &iter);
+    if (s.ok()) {
+      s = iter->Init(&spec);
+    }
+    if (PREDICT_FALSE(!s.ok())) {
+      SetupErrorAndRespond(resp->mutable_error(), s,
+                           s.IsInvalidArgument() ? TabletServerErrorPB::MISMATCHED_SCHEMA
+                                                 : TabletServerErrorPB::UNKNOWN_ERROR,
+                           context);
+      return;
+    }
+
+    if (!block) {
+      // A lookup yields at most one live row, but each rowset containing an
+      // older (ghost) version of the row contributes an unselected row to
+      // the block, so leave a bit of headroom.
+      block.reset(new RowBlock(iter->schema(), 16, &block_arena));
+    }
+
+    bool found = false;
+    while (iter->HasNext()) {
+      s = iter->NextBlock(block.get());
+      if (PREDICT_FALSE(!s.ok())) {
+        SetupErrorAndRespond(resp->mutable_error(),
+                             s.CloneAndPrepend("Copying rows from internal iterator failed"),
+                             TabletServerErrorPB::UNKNOWN_ERROR, context);
+        return;
+      }
+      if (block->selection_vector()->AnySelected()) {
+        found = true;
+        SerializeRowBlock(*block, &data, &projection,
+                          rows_data.get(), indirect_data.get());
+      }
+    }
+    if (!found) {
+      resp->add_not_found_key_indexes(i);
+    }
+  }
+
+  if (data.num_rows() > 0) {
+    resp->mutable_data()->CopyFrom(data);
+    int rows_idx;
+    CHECK_OK(context->AddRpcSidecar(
+        rpc::RpcSidecar::FromFaststring(std::move(rows_data)), &rows_idx));
+    resp->mutable_data()->set_rows_sidecar(rows_idx);
+    if (indirect_data->size() > 0) {
+      int indirect_idx;
+      CHECK_OK(context->AddRpcSidecar(
+          rpc::RpcSidecar::FromFaststring(std::move(indirect_data)), &indirect_idx));
+      resp->mutable_data()->set_indirect_data_sidecar(indirect_idx);
+    }
+  }
+  context->RespondSuccess();
+}
+
 void TabletServiceImpl::Checksum(const ChecksumRequestPB* req,
                                  ChecksumResponsePB* resp,
                                  rpc::RpcContext* context) {
+  // Checksum scans are long-running background maintenance work (e.g. ksck
+  // consistency checks), so run every batch on the bulk scan pool rather
+  // than tying up the shared RPC workers. The protocol is already chunked
+  // and resumable: each batch returns the running checksum, and the caller
+  // passes it back along with the scanner id in 'continue_request'.
+  if (bulk_scan_pool_) {
+    Status s = bulk_scan_pool_->SubmitClosure(
+        Bind(&TabletServiceImpl::DoChecksum, Unretained(this), req, resp, context));
+    if (PREDICT_TRUE(s.ok())) {
+      return;
+    }
+    // If the pool is shutting down, fall through and run the scan inline.
+  }
+  DoChecksum(req, resp, context);
+}
+
+void TabletServiceImpl::DoChecksum(const ChecksumRequestPB* req,
+                                   ChecksumResponsePB* resp,
+                                   rpc::RpcContext* context) {
   VLOG(1) << "Full request: " << SecureDebugString(*req);
+  int64_t queue_duration_nanos =
+      (MonoTime::Now() - context->GetTimeReceived()).ToNanoseconds();
+  Stopwatch sw(Stopwatch::THIS_THREAD);
+  sw.start();
 
   // Validate the request: user must pass a new_scan_request or
   // a scanner ID, but not both.
@@ -1178,9 +2027,11 @@ void TabletServiceImpl::Checksum(const ChecksumRequestPB* req,
 
     string scanner_id;
     Timestamp snap_timestamp;
+    uint32_t batch_size_bytes_hint;
     Status s = HandleNewScanRequest(tablet_peer.get(), &scan_req, context,
-                                    &collector, &scanner_id, &snap_timestamp, &has_more,
-                                    &error_code);
+                                    &collector, resp->mutable_resource_metrics(),
+                                    &scanner_id, &snap_timestamp, &has_more,
+                                    &batch_size_bytes_hint, &error_code);
     if (PREDICT_FALSE(!s.ok())) {
       SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
       return;
@@ -1193,7 +2044,10 @@ void TabletServiceImpl::Checksum(const ChecksumRequestPB* req,
     const ContinueChecksumRequestPB& continue_req = req->continue_request();
     collector.set_agg_checksum(continue_req.previous_checksum());
     scan_req.set_scanner_id(continue_req.scanner_id());
-    Status s = HandleContinueScanRequest(&scan_req, &collector, &has_more, &error_code);
+    uint32_t batch_size_bytes_hint;
+    Status s = HandleContinueScanRequest(&scan_req, context, &collector,
+                                         resp->mutable_resource_metrics(), &has_more,
+                                         &batch_size_bytes_hint, &error_code);
     if (PREDICT_FALSE(!s.ok())) {
       SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
       return;
@@ -1207,6 +2061,10 @@ void TabletServiceImpl::Checksum(const ChecksumRequestPB* req,
   resp->set_checksum(collector.agg_checksum());
   resp->set_has_more_results(has_more);
   SetResourceMetrics(resp->mutable_resource_metrics(), context);
+  sw.stop();
+  resp->mutable_resource_metrics()->set_queue_duration_nanos(queue_duration_nanos);
+  resp->mutable_resource_metrics()->set_cpu_user_nanos(sw.elapsed().user);
+  resp->mutable_resource_metrics()->set_cpu_system_nanos(sw.elapsed().system);
   resp->set_rows_checksummed(collector.rows_checksummed());
   context->RespondSuccess();
 }
@@ -1216,6 +2074,9 @@ bool TabletServiceImpl::SupportsFeature(uint32_t feature) const {
 }
 
 void TabletServiceImpl::Shutdown() {
+  if (bulk_scan_pool_) {
+    bulk_scan_pool_->Shutdown();
+  }
 }
 
 // Extract a void* pointer suitable for use in a ColumnRangePredicate from the
@@ -1252,19 +2113,20 @@ static Status ExtractPredicateValue(const ColumnSchema& schema,
 
 static Status DecodeEncodedKeyRange(const NewScanRequestPB& scan_pb,
                                     const Schema& tablet_schema,
-                                    const SharedScanner& scanner,
+                                    Arena* arena,
+                                    AutoReleasePool* pool,
                                     ScanSpec* spec) {
   gscoped_ptr<EncodedKey> start, stop;
   if (scan_pb.has_start_primary_key()) {
     RETURN_NOT_OK_PREPEND(EncodedKey::DecodeEncodedString(
-                            tablet_schema, scanner->arena(),
+                            tablet_schema, arena,
                             scan_pb.start_primary_key(), &start),
                           "Invalid scan start key");
   }
 
   if (scan_pb.has_stop_primary_key()) {
     RETURN_NOT_OK_PREPEND(EncodedKey::DecodeEncodedString(
-                            tablet_schema, scanner->arena(),
+                            tablet_schema, arena,
                             scan_pb.stop_primary_key(), &stop),
                           "Invalid scan stop key");
   }
@@ -1274,41 +2136,48 @@ static Status DecodeEncodedKeyRange(const NewScanRequestPB& scan_pb,
       return Status::InvalidArgument("Cannot specify both a start key and a last key");
     }
     // Set the start key to the last key from a previous scan result.
-    RETURN_NOT_OK_PREPEND(EncodedKey::DecodeEncodedString(tablet_schema, scanner->arena(),
+    RETURN_NOT_OK_PREPEND(EncodedKey::DecodeEncodedString(tablet_schema, arena,
                                                           scan_pb.last_primary_key(), &start),
                           "Failed to decode last primary key");
     // Increment the start key, so we don't return the last row again.
-    RETURN_NOT_OK_PREPEND(EncodedKey::IncrementEncodedKey(tablet_schema, &start, scanner->arena()),
+    RETURN_NOT_OK_PREPEND(EncodedKey::IncrementEncodedKey(tablet_schema, &start, arena),
                           "Failed to increment encoded last row key");
   }
 
   if (start) {
     spec->SetLowerBoundKey(start.get());
-    scanner->autorelease_pool()->Add(start.release());
+    pool->Add(start.release());
   }
   if (stop) {
     spec->SetExclusiveUpperBoundKey(stop.get());
-    scanner->autorelease_pool()->Add(stop.release());
+    pool->Add(stop.release());
   }
 
   return Status::OK();
 }
 
+// Build the ScanSpec for 'scan_pb'. All constants referenced by the spec
+// (predicate values, encoded key bounds) are allocated from 'arena' and
+// 'pool', which must outlive any iterator using the spec.
 static Status SetupScanSpec(const NewScanRequestPB& scan_pb,
                             const Schema& tablet_schema,
                             const Schema& projection,
                             vector<ColumnSchema>* missing_cols,
                             gscoped_ptr<ScanSpec>* spec,
-                            const SharedScanner& scanner) {
+                            Arena* arena,
+                            AutoReleasePool* pool) {
   gscoped_ptr<ScanSpec> ret(new ScanSpec);
   ret->set_cache_blocks(scan_pb.cache_blocks());
+  if (scan_pb.has_mutated_since_timestamp()) {
+    ret->set_mutated_since(Timestamp(scan_pb.mutated_since_timestamp()));
+  }
 
   unordered_set<string> missing_col_names;
 
   // First the column predicates.
   for (const ColumnPredicatePB& pred_pb : scan_pb.column_predicates()) {
     boost::optional<ColumnPredicate> predicate;
-    RETURN_NOT_OK(ColumnPredicateFromPB(tablet_schema, scanner->arena(), pred_pb, &predicate));
+    RETURN_NOT_OK(ColumnPredicateFromPB(tablet_schema, arena, pred_pb, &predicate));
 
     if (projection.find_column(predicate->column().name()) == Schema::kColumnNotFound &&
         !ContainsKey(missing_col_names, predicate->column().name())) {
@@ -1340,19 +2209,19 @@ static Status SetupScanSpec(const NewScanRequestPB& scan_pb,
     if (pred_pb.has_lower_bound()) {
       const void* val;
       RETURN_NOT_OK(ExtractPredicateValue(col, pred_pb.lower_bound(),
-                                          scanner->arena(),
+                                          arena,
                                           &val));
       lower_bound = val;
     }
     if (pred_pb.has_inclusive_upper_bound()) {
       const void* val;
       RETURN_NOT_OK(ExtractPredicateValue(col, pred_pb.inclusive_upper_bound(),
-                                          scanner->arena(),
+                                          arena,
                                           &val));
       upper_bound = val;
     }
 
-    auto pred = ColumnPredicate::InclusiveRange(col, lower_bound, upper_bound, scanner->arena());
+    auto pred = ColumnPredicate::InclusiveRange(col, lower_bound, upper_bound, arena);
     if (pred) {
       if (VLOG_IS_ON(3)) {
         VLOG(3) << "Parsed predicate " << pred->ToString()
@@ -1362,6 +2231,23 @@ static Status SetupScanSpec(const NewScanRequestPB& scan_pb,
     }
   }
 
+  // Computed columns' source columns must be materialized even when they are
+  // not part of the client's projection.
+  for (const ComputedColumnPB& cc_pb : scan_pb.computed_columns()) {
+    int idx = tablet_schema.find_column(cc_pb.column());
+    if (idx == Schema::kColumnNotFound) {
+      return Status::InvalidArgument(
+          Substitute("Computed column source '$0' is not present in the tablet schema",
+                     cc_pb.column()));
+    }
+    const ColumnSchema& col = tablet_schema.column(idx);
+    if (projection.find_column(col.name()) == Schema::kColumnNotFound &&
+        !ContainsKey(missing_col_names, col.name())) {
+      missing_cols->push_back(col);
+      InsertOrDie(&missing_col_names, col.name());
+    }
+  }
+
   // When doing an ordered scan, we need to include the key columns to be able to encode
   // the last row key for the scan response.
   if (scan_pb.order_mode() == kudu::ORDERED &&
@@ -1376,7 +2262,7 @@ static Status SetupScanSpec(const NewScanRequestPB& scan_pb,
     }
   }
   // Then any encoded key range predicates.
-  RETURN_NOT_OK(DecodeEncodedKeyRange(scan_pb, tablet_schema, scanner, ret.get()));
+  RETURN_NOT_OK(DecodeEncodedKeyRange(scan_pb, tablet_schema, arena, pool, ret.get()));
 
   spec->swap(ret);
   return Status::OK();
@@ -1400,6 +2286,133 @@ Status VerifyNotAncientHistory(Tablet* tablet, ReadMode read_mode, Timestamp tim
   }
   return Status::OK();
 }
+
+// Resolve the aggregate specs in 'scan_pb' against the client's projection,
+// producing the validated ops and the derived single-row result schema.
+// The source columns are resolved by index into 'client_projection'; since the
+// server-side projection prepends the client's columns in order (missing
+// columns are appended after them), the same indexes are valid against the
+// iterator's schema.
+Status ResolveScanAggregates(const NewScanRequestPB& scan_pb,
+                             const Schema& client_projection,
+                             vector<AggregateIterator::AggregateOp>* ops,
+                             Schema* result_schema) {
+  for (const ColumnAggregatePB& agg_pb : scan_pb.aggregates()) {
+    AggregateIterator::AggregateOp op;
+    op.col_idx = -1;
+    switch (agg_pb.function()) {
+      case ColumnAggregatePB::COUNT:
+        op.function = AggregateIterator::COUNT;
+        break;
+      case ColumnAggregatePB::MIN:
+        op.function = AggregateIterator::MIN;
+        break;
+      case ColumnAggregatePB::MAX:
+        op.function = AggregateIterator::MAX;
+        break;
+      case ColumnAggregatePB::SUM:
+        op.function = AggregateIterator::SUM;
+        break;
+      default:
+        return Status::InvalidArgument("Unknown aggregate function",
+                                       SecureShortDebugString(agg_pb));
+    }
+    if (op.function != AggregateIterator::COUNT) {
+      if (!agg_pb.has_column()) {
+        return Status::InvalidArgument("Aggregate is missing a source column",
+                                       SecureShortDebugString(agg_pb));
+      }
+      op.col_idx = client_projection.find_column(agg_pb.column());
+      if (op.col_idx == Schema::kColumnNotFound) {
+        return Status::InvalidArgument(
+            Substitute("Aggregate source column '$0' is not in the projection",
+                       agg_pb.column()));
+      }
+    }
+    ops->push_back(op);
+  }
+  return AggregateIterator::ValidateOps(client_projection, *ops, result_schema);
+}
+
+// Parse the computed column specs in 'scan_pb' into ops. The ops' source
+// column indexes are left unresolved (-1); they are resolved later against
+// the server-side projection, once any missing source columns have been
+// appended to it. The derived output columns are appended to 'client_cols',
+// from which the client-facing result schema is built.
+Status ParseComputedColumns(const NewScanRequestPB& scan_pb,
+                            const Schema& tablet_schema,
+                            vector<ComputedColumnsIterator::ComputedOp>* ops,
+                            vector<ColumnSchema>* client_cols) {
+  for (const ComputedColumnPB& cc_pb : scan_pb.computed_columns()) {
+    ComputedColumnsIterator::ComputedOp op;
+    op.col_idx = -1;
+    op.substring_offset = cc_pb.substring_offset();
+    op.substring_length = cc_pb.substring_length();
+    op.cast_type = cc_pb.has_cast_type() ? cc_pb.cast_type() : UINT8;
+    switch (cc_pb.function()) {
+      case ComputedColumnPB::SUBSTRING:
+        if (!cc_pb.has_substring_offset() || !cc_pb.has_substring_length()) {
+          return Status::InvalidArgument("Substring computed column is missing bounds",
+                                         SecureShortDebugString(cc_pb));
+        }
+        op.function = ComputedColumnsIterator::SUBSTRING;
+        break;
+      case ComputedColumnPB::HASH:
+        op.function = ComputedColumnsIterator::HASH;
+        break;
+      case ComputedColumnPB::LENGTH:
+        op.function = ComputedColumnsIterator::LENGTH;
+        break;
+      case ComputedColumnPB::CAST:
+        if (!cc_pb.has_cast_type()) {
+          return Status::InvalidArgument("Cast computed column is missing a target type",
+                                         SecureShortDebugString(cc_pb));
+        }
+        op.function = ComputedColumnsIterator::CAST;
+        break;
+      case ComputedColumnPB::UPPER:
+        op.function = ComputedColumnsIterator::UPPER;
+        break;
+      case ComputedColumnPB::LOWER:
+        op.function = ComputedColumnsIterator::LOWER;
+        break;
+      default:
+        return Status::InvalidArgument("Unknown computed column function",
+                                       SecureShortDebugString(cc_pb));
+    }
+    int idx = tablet_schema.find_column(cc_pb.column());
+    if (idx == Schema::kColumnNotFound) {
+      return Status::InvalidArgument(
+          Substitute("Computed column source '$0' is not present in the tablet schema",
+                     cc_pb.column()));
+    }
+    ColumnSchema out("", UINT8);
+    RETURN_NOT_OK(ComputedColumnsIterator::DeriveOutputColumn(
+        tablet_schema.column(idx), op, &out));
+    client_cols->push_back(out);
+    ops->push_back(op);
+  }
+  return Status::OK();
+}
+
+// Create one iterator per decomposed primary key range, all over the same
+// MVCC snapshot, unioned so that the scan skips the keyspace between the
+// ranges. The ranges are ascending and disjoint, so no row is yielded twice.
+Status NewKeyRangeUnionIterator(Tablet* tablet,
+                                const Schema& projection,
+                                const MvccSnapshot& snap,
+                                const vector<ScanSpec::KeyRange>& key_ranges,
+                                gscoped_ptr<RowwiseIterator>* iter) {
+  vector<shared_ptr<RowwiseIterator>> range_iters;
+  range_iters.reserve(key_ranges.size());
+  for (int i = 0; i < static_cast<int>(key_ranges.size()); i++) {
+    gscoped_ptr<RowwiseIterator> range_iter;
+    RETURN_NOT_OK(tablet->NewRowIterator(projection, snap, UNORDERED, &range_iter));
+    range_iters.emplace_back(range_iter.release());
+  }
+  iter->reset(new UnionIterator(range_iters, key_ranges));
+  return Status::OK();
+}
 } // anonymous namespace
 
 // Start a new scan.
@@ -1407,11 +2420,14 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
                                                const ScanRequestPB* req,
                                                const RpcContext* rpc_context,
                                                ScanResultCollector* result_collector,
+                                               ResourceMetricsPB* resource_metrics,
                                                std::string* scanner_id,
                                                Timestamp* snap_timestamp,
                                                bool* has_more_results,
+                                               uint32_t* batch_size_bytes_hint,
                                                TabletServerErrorPB::Code* error_code) {
   DCHECK(result_collector != nullptr);
+  *batch_size_bytes_hint = 0;
   DCHECK(error_code != nullptr);
   DCHECK(req->has_new_scan_request());
   const NewScanRequestPB& scan_pb = req->new_scan_request();
@@ -1424,6 +2440,7 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
   server_->scanner_manager()->NewScanner(tablet_peer,
                                          rpc_context->requestor_string(),
                                          &scanner);
+  scanner->set_row_format(scan_pb.row_format());
 
   // If we early-exit out of this function, automatically unregister
   // the scanner.
@@ -1452,21 +2469,111 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
     }
   }
 
-  gscoped_ptr<ScanSpec> spec(new ScanSpec);
+  if (scan_pb.stateless() && scan_pb.order_mode() != ORDERED) {
+    // A stateless scan resumes from the last primary key returned in the
+    // previous response, which is only meaningful if rows are returned in
+    // primary key order.
+    *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+    return Status::InvalidArgument("Cannot do a stateless scan that is not ordered");
+  }
+
+  // If the client requested aggregates, resolve and validate them against
+  // the projection, and derive the single-row result schema.
+  vector<AggregateIterator::AggregateOp> aggregate_ops;
+  Schema aggregate_schema;
+  if (scan_pb.aggregates_size() > 0) {
+    if (scan_pb.order_mode() == ORDERED) {
+      // The aggregate result row has no primary key, so there is no
+      // 'last_primary_key' to resume a fault-tolerant scan from.
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return Status::InvalidArgument("Cannot do an ordered scan with aggregates");
+    }
+    s = ResolveScanAggregates(scan_pb, projection, &aggregate_ops, &aggregate_schema);
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return s;
+    }
+  }
+
+  // If the client requested computed columns, parse and validate them, and
+  // derive the client-facing result schema: the projected columns followed
+  // by the computed columns.
+  vector<ComputedColumnsIterator::ComputedOp> computed_ops;
+  Schema computed_client_schema;
+  if (scan_pb.computed_columns_size() > 0) {
+    if (!aggregate_ops.empty()) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return Status::InvalidArgument("Cannot combine aggregates with computed columns");
+    }
+    vector<ColumnSchema> client_cols = projection.columns();
+    s = ParseComputedColumns(scan_pb, tablet_schema, &computed_ops, &client_cols);
+    if (s.ok()) {
+      // Reset() rejects duplicate column names, so a computed column which
+      // collides with a projected column (or a repeated computed column)
+      // fails here.
+      s = computed_client_schema.Reset(client_cols, projection.num_key_columns());
+    }
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return s;
+    }
+  }
+
+  // Compile the scan spec, or reuse a recently compiled spec if one is
+  // cached for an equivalent plan. Only the plan-relevant request fields
+  // participate in the cache key; fields like the snapshot timestamp vary
+  // per request without affecting the compiled spec. The schema version is
+  // part of the key, so entries compiled against an old schema are never
+  // reused after an alter.
+  NewScanRequestPB plan_pb(scan_pb);
+  plan_pb.clear_snap_timestamp();
+  plan_pb.clear_propagated_timestamp();
+  plan_pb.clear_aggregates();
+  plan_pb.clear_row_format();
+  string spec_key = Substitute("$0:$1:", scan_pb.tablet_id(),
+                               tablet_peer->tablet_metadata()->schema_version());
+  spec_key += plan_pb.SerializeAsString();
 
   // Missing columns will contain the columns that are not mentioned in the client
   // projection but are actually needed for the scan, such as columns referred to by
   // predicates or key columns (if this is an ORDERED scan).
+  gscoped_ptr<ScanSpec> spec(new ScanSpec);
   vector<ColumnSchema> missing_cols;
-  s = SetupScanSpec(scan_pb, tablet_schema, projection, &missing_cols, &spec, scanner);
-  if (PREDICT_FALSE(!s.ok())) {
-    *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
-    return s;
-  }
+  std::shared_ptr<CompiledScanSpec> compiled =
+      server_->scanner_manager()->LookupCompiledSpec(spec_key);
+  if (compiled) {
+    // The cached spec is copied, since the iterator mutates its spec; the
+    // copy's predicates and key bounds still point into the cache entry's
+    // storage, which the scanner keeps alive below.
+    *spec = compiled->spec;
+    missing_cols = compiled->missing_cols;
+  } else {
+    compiled = std::make_shared<CompiledScanSpec>();
+    gscoped_ptr<ScanSpec> built(new ScanSpec);
+    s = SetupScanSpec(scan_pb, tablet_schema, projection, &compiled->missing_cols,
+                      &built, &compiled->arena, &compiled->pool);
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return s;
+    }
+
+    VLOG(3) << "Before optimizing scan spec: " << built->ToString(tablet_schema);
+    // Decompose before OptimizeScan(), which strips the predicates it pushes
+    // into the single-range key bounds.
+    built->DecomposePrimaryKeyRanges(tablet_schema, &compiled->arena, &compiled->pool,
+                                     FLAGS_scanner_max_key_ranges, &compiled->key_ranges);
+    built->OptimizeScan(tablet_schema, &compiled->arena, &compiled->pool, true);
+    VLOG(3) << "After optimizing scan spec: " << built->ToString(tablet_schema);
 
-  VLOG(3) << "Before optimizing scan spec: " << spec->ToString(tablet_schema);
-  spec->OptimizeScan(tablet_schema, scanner->arena(), scanner->autorelease_pool(), true);
-  VLOG(3) << "After optimizing scan spec: " << spec->ToString(tablet_schema);
+    compiled->spec = *built;
+    missing_cols = compiled->missing_cols;
+    *spec = compiled->spec;
+    server_->scanner_manager()->InsertCompiledSpec(spec_key, compiled);
+  }
+  // The bound keys in 'key_ranges' are owned by the compiled spec, which the
+  // scanner keeps alive below.
+  vector<ScanSpec::KeyRange> key_ranges = compiled->key_ranges;
+  scanner->set_compiled_spec(std::move(compiled));
 
   if (spec->CanShortCircuit()) {
     VLOG(1) << "short-circuiting without creating a server-side scanner.";
@@ -1474,10 +2581,68 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
     return Status::OK();
   }
 
-  // Store the original projection.
-  gscoped_ptr<Schema> orig_projection(new Schema(projection));
+  // Store the original projection; for an aggregated scan, the derived
+  // result schema; for a scan with computed columns, the projection plus the
+  // computed columns. Result blocks are serialized in this schema.
+  Schema* client_result_schema;
+  if (!aggregate_ops.empty()) {
+    client_result_schema = new Schema(aggregate_schema);
+  } else if (!computed_ops.empty()) {
+    client_result_schema = new Schema(computed_client_schema);
+  } else {
+    client_result_schema = new Schema(projection);
+  }
+  SchemaPtr orig_projection(client_result_schema);
   scanner->set_client_projection_schema(std::move(orig_projection));
 
+  // Determine whether this scan may share a tablet iterator with equivalent
+  // concurrent scans. Only plain rowwise snapshot scans qualify: the archived
+  // batches are serialized rowwise row blocks, ordered scans must resume from
+  // a primary key, and only snapshot reads are repeatable enough that two
+  // scans over the same spec see the same rows.
+  const bool shareable = FLAGS_scanner_shared_scan_window_ms > 0 &&
+      result_collector->SupportsBatchSharing() &&
+      scan_pb.read_mode() == READ_AT_SNAPSHOT &&
+      scan_pb.order_mode() != ORDERED &&
+      !scan_pb.stateless() &&
+      aggregate_ops.empty();
+  std::string share_signature;
+  if (shareable) {
+    // Two scans are equivalent if their requests are byte-identical modulo the
+    // snapshot timestamp, which is matched separately: a scan which lets the
+    // server choose the timestamp may adopt the group's.
+    NewScanRequestPB canonical(scan_pb);
+    canonical.clear_snap_timestamp();
+    canonical.SerializeToString(&share_signature);
+    Timestamp req_snap = scan_pb.has_snap_timestamp() ?
+        Timestamp(scan_pb.snap_timestamp()) : Timestamp::kInvalidTimestamp;
+    scoped_refptr<ScanShareGroup> group = server_->scanner_manager()->TryJoinShareGroup(
+        share_signature, req_snap, scanner->id());
+    if (group) {
+      TRACE("Joined shared scan $0", scanner->id());
+      *snap_timestamp = group->snap_timestamp();
+      scanner->InitShared(std::move(group), gscoped_ptr<ScanSpec>(new ScanSpec(*spec)));
+      unreg_scanner.Cancel();
+      *scanner_id = scanner->id();
+      *has_more_results = true;
+
+      size_t batch_size_bytes = GetMaxBatchSizeBytesHint(req);
+      if (batch_size_bytes > 0) {
+        TRACE("Continuing scan request");
+        ScanRequestPB continue_req(*req);
+        continue_req.set_scanner_id(scanner->id());
+        RETURN_NOT_OK(HandleContinueScanRequest(&continue_req, rpc_context, result_collector,
+                                                resource_metrics, has_more_results,
+                                                batch_size_bytes_hint, error_code));
+      } else {
+        // Increment the scanner call sequence ID. HandleContinueScanRequest
+        // handles this in the non-empty scan case.
+        scanner->IncrementCallSeqId();
+      }
+      return Status::OK();
+    }
+  }
+
   // Build a new projection with the projection columns and the missing columns. Make
   // sure to set whether the column is a key column appropriately.
   SchemaBuilder projection_builder;
@@ -1507,12 +2672,17 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
         return s;
       }
       case READ_LATEST: {
-        s = tablet->NewRowIterator(projection, &iter);
+        if (key_ranges.size() > 1 && scan_pb.order_mode() == UNORDERED) {
+          MvccSnapshot snap(*tablet->mvcc_manager());
+          s = NewKeyRangeUnionIterator(tablet.get(), projection, snap, key_ranges, &iter);
+        } else {
+          s = tablet->NewRowIterator(projection, &iter);
+        }
         break;
       }
       case READ_AT_SNAPSHOT: {
         s = HandleScanAtSnapshot(scan_pb, rpc_context, projection, tablet_peer,
-                                 &iter, snap_timestamp);
+                                 key_ranges, &iter, snap_timestamp);
         // If we got a Status::ServiceUnavailable() from HandleScanAtSnapshot() it might
         // mean we're just behind so let the client try again.
         if (s.IsServiceUnavailable()) {
@@ -1554,6 +2724,40 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
     return s;
   }
 
+  if (!aggregate_ops.empty()) {
+    // Wrap the (initialized) iterator so that the scan yields a single
+    // aggregate result row instead of the projected rows.
+    shared_ptr<RowwiseIterator> base(iter.release());
+    gscoped_ptr<AggregateIterator> agg_iter(new AggregateIterator(
+        std::move(base), std::move(aggregate_ops), aggregate_schema));
+    RETURN_NOT_OK(agg_iter->Init(spec.get()));
+    iter.reset(agg_iter.release());
+  }
+
+  if (!computed_ops.empty()) {
+    // Resolve each op's source column against the server-side projection;
+    // SetupScanSpec() appended any sources missing from the client's
+    // projection, so resolution cannot fail here.
+    for (int i = 0; i < scan_pb.computed_columns_size(); i++) {
+      computed_ops[i].col_idx = projection.find_column(scan_pb.computed_columns(i).column());
+      DCHECK_NE(computed_ops[i].col_idx, Schema::kColumnNotFound);
+    }
+    Schema computed_result_schema;
+    s = ComputedColumnsIterator::ValidateOps(projection, computed_ops,
+                                             &computed_result_schema);
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return s;
+    }
+    // Wrap the (initialized) iterator so that the scan's blocks carry the
+    // computed columns appended after the projected columns.
+    shared_ptr<RowwiseIterator> base(iter.release());
+    gscoped_ptr<ComputedColumnsIterator> computed_iter(new ComputedColumnsIterator(
+        std::move(base), std::move(computed_ops), computed_result_schema));
+    RETURN_NOT_OK(computed_iter->Init(spec.get()));
+    iter.reset(computed_iter.release());
+  }
+
   // If this is a snapshot scan and the user specified a specific timestamp to
   // scan at, then check that we are not attempting to scan at a time earlier
   // than the ancient history mark. Only perform this check if tablet history
@@ -1590,11 +2794,21 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
     return Status::OK();
   }
 
-  scanner->Init(std::move(iter), std::move(orig_spec));
+  if (shareable) {
+    // Publish a share group so that equivalent scans arriving within the
+    // sharing window can attach to this iterator rather than open their own.
+    scoped_refptr<ScanShareGroup> group(
+        new ScanShareGroup(std::move(share_signature), *snap_timestamp, std::move(iter)));
+    CHECK(group->AddMember(scanner->id()));
+    scanner->InitShared(group, std::move(orig_spec));
+    server_->scanner_manager()->RegisterShareGroup(group);
+  } else {
+    scanner->Init(std::move(iter), std::move(orig_spec));
+  }
   unreg_scanner.Cancel();
   *scanner_id = scanner->id();
 
-  VLOG(1) << "Started scanner " << scanner->id() << ": " << scanner->iter()->ToString();
+  VLOG(1) << "Started scanner " << scanner->id();
 
   size_t batch_size_bytes = GetMaxBatchSizeBytesHint(req);
   if (batch_size_bytes > 0) {
@@ -1603,22 +2817,134 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
     // and call the second half directly
     ScanRequestPB continue_req(*req);
     continue_req.set_scanner_id(scanner->id());
-    RETURN_NOT_OK(HandleContinueScanRequest(&continue_req, result_collector, has_more_results,
-                                            error_code));
+    RETURN_NOT_OK(HandleContinueScanRequest(&continue_req, rpc_context, result_collector,
+                                            resource_metrics, has_more_results,
+                                            batch_size_bytes_hint, error_code));
   } else {
     // Increment the scanner call sequence ID. HandleContinueScanRequest handles
     // this in the non-empty scan case.
     scanner->IncrementCallSeqId();
   }
+
+  if (scan_pb.stateless()) {
+    // The client resumes from the returned last primary key rather than from
+    // a scanner ID, so drop all server-side state now instead of pinning it
+    // until the scanner expires.
+    server_->scanner_manager()->UnregisterScanner(scanner->id());
+    scanner_id->clear();
+  }
+  return Status::OK();
+}
+
+namespace {
+
+// Serve one continuation of a scanner attached to a ScanShareGroup.
+//
+// If the member has archived batches it has not yet consumed, one of them is
+// replayed verbatim. Otherwise the member drives the shared iterator forward,
+// archiving the batch it produces for the other members. If the member is the
+// last one left and the sharing window has closed, the iterator is handed back
+// to the scanner and '*served' is set to false so that the caller falls
+// through to the regular (private) scan path.
+Status HandleSharedScanContinue(ScannerManager* scanner_manager,
+                                const SharedScanner& scanner,
+                                ScanResultCollector* result_collector,
+                                size_t batch_size_bytes,
+                                int64_t* rows_scanned,
+                                bool* has_more_results,
+                                TabletServerErrorPB::Code* error_code,
+                                bool* served) {
+  *served = true;
+  if (PREDICT_FALSE(!result_collector->SupportsBatchSharing())) {
+    // e.g. a checksum request aimed at a scanner id created by a normal scan.
+    return Status::InvalidArgument(
+        Substitute("Scanner $0 is part of a shared scan", scanner->id()));
+  }
+  scoped_refptr<ScanShareGroup> group = scanner->share_group();
+  MutexLock l(*group->lock());
+
+  int64_t pos = scanner->shared_scan_position();
+  if (pos < group->num_batches()) {
+    // Replay one archived batch. An archived batch must be the only data in
+    // the response (see ScanResultCollector::AppendArchivedBatch()), so serve
+    // exactly one per call.
+    result_collector->AppendArchivedBatch(group->batch(pos));
+    scanner->set_shared_scan_position(pos + 1);
+    *has_more_results = pos + 1 < group->num_batches() || !group->complete();
+    return Status::OK();
+  }
+
+  if (group->complete()) {
+    *has_more_results = false;
+    return Status::OK();
+  }
+
+  if (group->num_members() == 1 && group->ShouldRetire(MonoTime::Now())) {
+    // Nothing else can join and no one else is attached: stop paying the
+    // archival overhead and revert to a plain scan. The iterator is already
+    // positioned exactly at this member's read point.
+    gscoped_ptr<RowwiseIterator> iter = group->ReleaseIter();
+    l.Unlock();
+    scanner_manager->UnregisterShareGroup(*group);
+    scanner->AdoptIterator(std::move(iter));
+    *served = false;
+    return Status::OK();
+  }
+
+  // This member is at the head of the group: drive the shared iterator.
+  RowwiseIterator* iter = group->iter();
+  RowBlock* block = group->PrepareRowBlock(FLAGS_scanner_batch_size_rows);
+  MonoTime deadline = MonoTime::Now() +
+      MonoDelta::FromMilliseconds(FLAGS_scanner_batch_time_budget_ms);
+  while (iter->HasNext()) {
+    if (PREDICT_FALSE(FLAGS_scanner_inject_latency_on_each_batch_ms > 0)) {
+      SleepFor(MonoDelta::FromMilliseconds(FLAGS_scanner_inject_latency_on_each_batch_ms));
+    }
+    Status s = iter->NextBlock(block);
+    if (PREDICT_FALSE(!s.ok())) {
+      LOG(WARNING) << "Copying rows from internal iterator for shared scan "
+                   << scanner->id();
+      *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+      return s;
+    }
+    if (PREDICT_TRUE(block->nrows() > 0)) {
+      *rows_scanned += block->nrows();
+      result_collector->HandleRowBlock(scanner->client_projection_schema(), *block);
+    }
+    int64_t response_size = result_collector->ResponseSize();
+    if (response_size >= batch_size_bytes ||
+        PREDICT_FALSE(MonoTime::Now() >= deadline)) {
+      break;
+    }
+  }
+  if (!iter->HasNext()) {
+    // Drop the iterator now rather than when the last member detaches, so
+    // that the resources it pins are released as early as possible.
+    group->SetComplete();
+  }
+  if (result_collector->ResponseSize() > 0) {
+    SharedScanBatch batch;
+    result_collector->ArchiveBatch(&batch);
+    group->AppendBatch(std::move(batch));
+    scanner->set_shared_scan_position(group->num_batches());
+  }
+  *has_more_results = scanner->shared_scan_position() < group->num_batches() ||
+      !group->complete();
   return Status::OK();
 }
 
+} // anonymous namespace
+
 // Continue an existing scan request.
 Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
+                                                    const rpc::RpcContext* rpc_context,
                                                     ScanResultCollector* result_collector,
+                                                    ResourceMetricsPB* resource_metrics,
                                                     bool* has_more_results,
+                                                    uint32_t* batch_size_bytes_hint,
                                                     TabletServerErrorPB::Code* error_code) {
   DCHECK(req->has_scanner_id());
+  *batch_size_bytes_hint = 0;
   TRACE_EVENT1("tserver", "TabletServiceImpl::HandleContinueScanRequest",
                "scanner_id", req->scanner_id());
 
@@ -1657,19 +2983,64 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
   scanner->IncrementCallSeqId();
   scanner->UpdateAccessTime();
 
+  // Propagate the client's deadline into the iterator stack, so that an
+  // expensive block decode or merge aborts once nobody is waiting for the
+  // response instead of burning CPU and I/O on a reply that will be thrown
+  // away. An aborted scan returns an error, which unregisters the scanner on
+  // the way out; since the client has already timed out, a retry would find
+  // the scanner expired either way.
+  ScopedScanDeadline scan_deadline(rpc_context->GetClientDeadline());
+
+  if (scanner->share_group()) {
+    bool served = false;
+    int64_t shared_rows_scanned = 0;
+    RETURN_NOT_OK(HandleSharedScanContinue(server_->scanner_manager(), scanner,
+                                           result_collector, batch_size_bytes,
+                                           &shared_rows_scanned, has_more_results,
+                                           error_code, &served));
+    if (served) {
+      scoped_refptr<TabletPeer> tablet_peer = scanner->tablet_peer();
+      shared_ptr<Tablet> tablet;
+      TabletServerErrorPB::Code tablet_ref_error_code;
+      if (GetTabletRef(tablet_peer, &tablet, &tablet_ref_error_code).ok()) {
+        tablet->metrics()->scanner_rows_returned->IncrementBy(
+            result_collector->NumRowsReturned());
+        tablet->metrics()->scanner_cells_returned->IncrementBy(
+            result_collector->NumRowsReturned() *
+                scanner->client_projection_schema()->num_columns());
+        tablet->metrics()->scanner_bytes_returned->IncrementBy(
+            result_collector->ResponseSize());
+        tablet->metrics()->scanner_rows_scanned->IncrementBy(shared_rows_scanned);
+      }
+      scanner->UpdateAccessTime();
+      *has_more_results = *has_more_results && !req->close_scanner();
+      if (*has_more_results) {
+        unreg_scanner.Cancel();
+      } else {
+        VLOG(2) << "Shared scanner " << scanner->id() << " complete: removing...";
+      }
+      return Status::OK();
+    }
+    // The scanner detached from its share group and adopted the iterator;
+    // fall through to the regular scan path.
+  }
+
   RowwiseIterator* iter = scanner->iter();
 
   // TODO: could size the RowBlock based on the user's requested batch size?
   // If people had really large indirect objects, we would currently overshoot
   // their requested batch size by a lot.
-  Arena arena(32 * 1024, 1 * 1024 * 1024);
-  RowBlock block(scanner->iter()->schema(),
-                 FLAGS_scanner_batch_size_rows, &arena);
+  //
+  // The block (and the arena backing its indirect data) is owned by the
+  // scanner and reused across continuation calls, so that scans do no
+  // large allocations per RPC.
+  RowBlock* block = scanner->PrepareRowBlock(FLAGS_scanner_batch_size_rows);
 
-  // TODO: in the future, use the client timeout to set a budget. For now,
-  // just use a half second, which should be plenty to amortize call overhead.
-  int budget_ms = 500;
-  MonoTime deadline = MonoTime::Now() + MonoDelta::FromMilliseconds(budget_ms);
+  // Use the configured batch budget, clamped to the client's own deadline:
+  // there is no point preparing more data than the client will wait for.
+  MonoTime deadline = MonoTime::Now() +
+      MonoDelta::FromMilliseconds(FLAGS_scanner_batch_time_budget_ms);
+  deadline = MonoTime::Earliest(deadline, rpc_context->GetClientDeadline());
 
   int64_t rows_scanned = 0;
   while (iter->HasNext()) {
@@ -1677,7 +3048,7 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
       SleepFor(MonoDelta::FromMilliseconds(FLAGS_scanner_inject_latency_on_each_batch_ms));
     }
 
-    Status s = iter->NextBlock(&block);
+    Status s = iter->NextBlock(block);
     if (PREDICT_FALSE(!s.ok())) {
       LOG(WARNING) << "Copying rows from internal iterator for request "
                    << SecureShortDebugString(*req);
@@ -1685,24 +3056,29 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
       return s;
     }
 
-    if (PREDICT_TRUE(block.nrows() > 0)) {
+    if (PREDICT_TRUE(block->nrows() > 0)) {
       // Count the number of rows scanned, regardless of predicates or deletions.
       // The collector will separately count the number of rows actually returned to
       // the client.
-      rows_scanned += block.nrows();
-      result_collector->HandleRowBlock(scanner->client_projection_schema(), block);
+      rows_scanned += block->nrows();
+      result_collector->HandleRowBlock(scanner->client_projection_schema(), *block);
     }
 
     int64_t response_size = result_collector->ResponseSize();
 
     if (VLOG_IS_ON(2)) {
       // This may be fairly expensive if row block size is small
-      TRACE("Copied block (nrows=$0), new size=$1", block.nrows(), response_size);
+      TRACE("Copied block (nrows=$0), new size=$1", block->nrows(), response_size);
     }
 
     // TODO: should check if RPC got cancelled, once we implement RPC cancellation.
     if (PREDICT_FALSE(MonoTime::Now() >= deadline)) {
       TRACE("Deadline expired - responding early");
+      // Let the client know how much data we managed to produce within the
+      // budget, so that it can size its next request to fit.
+      if (response_size > 0 && implicit_cast<size_t>(response_size) < batch_size_bytes) {
+        *batch_size_bytes_hint = response_size;
+      }
       break;
     }
 
@@ -1749,6 +3125,15 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
   delta_stats.SubtractStats(scanner->already_reported_stats());
   scanner->set_already_reported_stats(total_stats);
 
+  // Return the cost of this batch to the client so that callers can
+  // attribute server load to individual workloads.
+  if (resource_metrics != nullptr) {
+    resource_metrics->set_data_blocks_read_from_disk(
+        delta_stats.data_blocks_read_from_disk);
+    resource_metrics->set_bytes_read_from_disk(delta_stats.bytes_read_from_disk);
+    resource_metrics->set_cells_read_from_disk(delta_stats.cells_read_from_disk);
+  }
+
   if (tablet) {
     tablet->metrics()->scanner_rows_scanned->IncrementBy(
         rows_scanned);
@@ -1786,6 +3171,7 @@ Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
                                                const RpcContext* rpc_context,
                                                const Schema& projection,
                                                TabletPeer* tablet_peer,
+                                               const vector<ScanSpec::KeyRange>& key_ranges,
                                                gscoped_ptr<RowwiseIterator>* iter,
                                                Timestamp* snap_timestamp) {
   // If the client sent a timestamp update our clock with it.
@@ -1881,7 +3267,11 @@ Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
   if (scan_pb.order_mode() == UNKNOWN_ORDER_MODE) {
     return Status::InvalidArgument("Unknown order mode specified");
   }
-  RETURN_NOT_OK(tablet->NewRowIterator(projection, snap, scan_pb.order_mode(), iter));
+  if (key_ranges.size() > 1 && scan_pb.order_mode() == UNORDERED) {
+    RETURN_NOT_OK(NewKeyRangeUnionIterator(tablet, projection, snap, key_ranges, iter));
+  } else {
+    RETURN_NOT_OK(tablet->NewRowIterator(projection, snap, scan_pb.order_mode(), iter));
+  }
   *snap_timestamp = tmp_snap_timestamp;
   return Status::OK();
 }
@@ -19,17 +19,22 @@
 
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "kudu/common/scan_spec.h"
 #include "kudu/consensus/consensus.service.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/tserver/tserver_admin.service.h"
 #include "kudu/tserver/tserver_service.service.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/oid_generator.h"
 
 namespace kudu {
 class RowwiseIterator;
 class Schema;
 class Status;
+class ThreadPool;
 class Timestamp;
 
 namespace tablet {
@@ -67,6 +72,18 @@ class TabletServiceImpl : public TabletServerServiceIf {
                            ListTabletsResponsePB* resp,
                            rpc::RpcContext* context) OVERRIDE;
 
+  virtual void SplitKeyRange(const SplitKeyRangeRequestPB* req,
+                             SplitKeyRangeResponsePB* resp,
+                             rpc::RpcContext* context) OVERRIDE;
+
+  virtual void KeyRangeEstimate(const KeyRangeEstimateRequestPB* req,
+                                KeyRangeEstimateResponsePB* resp,
+                                rpc::RpcContext* context) OVERRIDE;
+
+  virtual void MultiGet(const MultiGetRequestPB* req,
+                        MultiGetResponsePB* resp,
+                        rpc::RpcContext* context) OVERRIDE;
+
   virtual void Checksum(const ChecksumRequestPB* req,
                         ChecksumResponsePB* resp,
                         rpc::RpcContext* context) OVERRIDE;
@@ -76,33 +93,60 @@ class TabletServiceImpl : public TabletServerServiceIf {
   virtual void Shutdown() OVERRIDE;
 
  private:
+  // Return true if the given scan request should be executed on
+  // 'bulk_scan_pool_' rather than on the shared service pool; see Scan().
+  bool ShouldRunScanOnBulkPool(const ScanRequestPB* req) const;
+
+  // The body of Scan(), run either inline or on 'bulk_scan_pool_'.
+  void DoScan(const ScanRequestPB* req,
+              ScanResponsePB* resp,
+              rpc::RpcContext* context);
+
+  // The body of Checksum(), run either inline or on 'bulk_scan_pool_'.
+  void DoChecksum(const ChecksumRequestPB* req,
+                  ChecksumResponsePB* resp,
+                  rpc::RpcContext* context);
+
   Status HandleNewScanRequest(tablet::TabletPeer* tablet_peer,
                               const ScanRequestPB* req,
                               const rpc::RpcContext* rpc_context,
                               ScanResultCollector* result_collector,
+                              ResourceMetricsPB* resource_metrics,
                               std::string* scanner_id,
                               Timestamp* snap_timestamp,
                               bool* has_more_results,
+                              uint32_t* batch_size_bytes_hint,
                               TabletServerErrorPB::Code* error_code);
 
   Status HandleContinueScanRequest(const ScanRequestPB* req,
+                                   const rpc::RpcContext* rpc_context,
                                    ScanResultCollector* result_collector,
+                                   ResourceMetricsPB* resource_metrics,
                                    bool* has_more_results,
+                                   uint32_t* batch_size_bytes_hint,
                                    TabletServerErrorPB::Code* error_code);
 
   Status HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
                               const rpc::RpcContext* rpc_context,
                               const Schema& projection,
                               tablet::TabletPeer* tablet_peer,
+                              const std::vector<ScanSpec::KeyRange>& key_ranges,
                               gscoped_ptr<RowwiseIterator>* iter,
                               Timestamp* snap_timestamp);
 
   TabletServer* server_;
+
+  // Pool executing continuations of long-running scans, so that a burst of
+  // large analytic scans can't occupy every RPC worker and inflate the
+  // latency of point reads. NULL if the separate pool is disabled.
+  gscoped_ptr<ThreadPool> bulk_scan_pool_;
 };
 
 class TabletServiceAdminImpl : public TabletServerAdminServiceIf {
  public:
   explicit TabletServiceAdminImpl(TabletServer* server);
+  virtual ~TabletServiceAdminImpl();
+
   virtual void CreateTablet(const CreateTabletRequestPB* req,
                             CreateTabletResponsePB* resp,
                             rpc::RpcContext* context) OVERRIDE;
@@ -115,8 +159,40 @@ class TabletServiceAdminImpl : public TabletServerAdminServiceIf {
                            AlterSchemaResponsePB* resp,
                            rpc::RpcContext* context) OVERRIDE;
 
+  virtual void BeginBulkIngest(const BeginBulkIngestRequestPB* req,
+                               BeginBulkIngestResponsePB* resp,
+                               rpc::RpcContext* context) OVERRIDE;
+
+  virtual void BulkIngestData(const BulkIngestDataRequestPB* req,
+                              BulkIngestDataResponsePB* resp,
+                              rpc::RpcContext* context) OVERRIDE;
+
+  virtual void FinishBulkIngest(const FinishBulkIngestRequestPB* req,
+                                FinishBulkIngestResponsePB* resp,
+                                rpc::RpcContext* context) OVERRIDE;
+
  private:
+  // State for an open bulk ingest session: the destination tablet and the
+  // writable blocks opened so far. Defined in the .cc file.
+  struct BulkIngestSession;
+
+  // Remove and return the session with the given id, or NULL if it does
+  // not exist. Sessions are re-registered after each successful call so
+  // that a session is only ever operated on by one RPC at a time.
+  std::unique_ptr<BulkIngestSession> TakeBulkIngestSession(const std::string& session_id);
+
+  // Abort any sessions which have been idle longer than
+  // --bulk_ingest_session_idle_timeout_ms, deleting their blocks.
+  void ExpireIdleBulkIngestSessions();
+
   TabletServer* server_;
+
+  // Generates ids for new bulk ingest sessions.
+  ObjectIdGenerator bulk_ingest_oid_generator_;
+
+  // Protects 'bulk_ingest_sessions_'.
+  mutable simple_spinlock bulk_ingest_lock_;
+  std::unordered_map<std::string, std::unique_ptr<BulkIngestSession>> bulk_ingest_sessions_;
 };
 
 class ConsensusServiceImpl : public consensus::ConsensusServiceIf {
@@ -34,6 +34,7 @@
 #include "kudu/consensus/quorum_util.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/casts.h"
+#include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/strings/util.h"
 #include "kudu/master/master.pb.h"
@@ -71,6 +72,25 @@ DEFINE_int32(num_tablets_to_open_simultaneously, 0,
              "may make sense to manually tune this.");
 TAG_FLAG(num_tablets_to_open_simultaneously, advanced);
 
+DEFINE_string(tablet_wal_fast_storage_tables, "",
+              "Comma-separated list of table names whose tablets' write-ahead "
+              "logs are placed on the fast WAL directory (see --fs_wal_fast_dir) "
+              "when the tablets are created. Tablets which already have a WAL "
+              "are not moved. Has no effect if --fs_wal_fast_dir is not set.");
+TAG_FLAG(tablet_wal_fast_storage_tables, advanced);
+TAG_FLAG(tablet_wal_fast_storage_tables, experimental);
+TAG_FLAG(tablet_wal_fast_storage_tables, runtime);
+
+DEFINE_int32(follower_write_apply_pool_num_threads, 0,
+             "Number of threads in a dedicated pool for applying replicated "
+             "write operations on follower replicas. When greater than zero, "
+             "follower write applies bypass the shared apply pool so they are "
+             "not queued behind other apply work, keeping follower apply lag "
+             "low for bounded-staleness follower reads. If 0, follower writes "
+             "are applied on the shared apply pool.");
+TAG_FLAG(follower_write_apply_pool_num_threads, advanced);
+TAG_FLAG(follower_write_apply_pool_num_threads, experimental);
+
 DEFINE_int32(tablet_start_warn_threshold_ms, 500,
              "If a tablet takes more than this number of millis to start, issue "
              "a warning with a trace.");
@@ -101,6 +121,8 @@ DEFINE_double(fault_crash_after_tc_files_fetched, 0.0,
               "(For testing only!)");
 TAG_FLAG(fault_crash_after_tc_files_fetched, unsafe);
 
+DECLARE_bool(tablet_deferred_block_deletion);
+
 namespace kudu {
 namespace tserver {
 
@@ -125,6 +147,15 @@ METRIC_DEFINE_histogram(server, op_apply_run_time, "Operation Apply Run Time",
                         "that operations consist of very large batches.",
                         10000000, 2);
 
+METRIC_DEFINE_histogram(server, op_follower_apply_queue_time,
+                        "Follower Write Apply Queue Time",
+                        MetricUnit::kMicroseconds,
+                        "Time that replicated write operations spent waiting in the "
+                        "dedicated follower apply queue before being processed. Only "
+                        "populated when --follower_write_apply_pool_num_threads is "
+                        "greater than zero.",
+                        10000000, 2);
+
 using consensus::ConsensusMetadata;
 using consensus::ConsensusStatePB;
 using consensus::OpId;
@@ -167,6 +198,20 @@ TSTabletManager::TSTabletManager(FsManager* fs_manager,
       METRIC_op_apply_queue_time.Instantiate(server_->metric_entity()));
   apply_pool_->SetRunTimeMicrosHistogram(
       METRIC_op_apply_run_time.Instantiate(server_->metric_entity()));
+
+  if (FLAGS_follower_write_apply_pool_num_threads > 0) {
+    CHECK_OK(ThreadPoolBuilder("follower-apply")
+             .set_max_threads(FLAGS_follower_write_apply_pool_num_threads)
+             .Build(&follower_write_apply_pool_));
+    follower_write_apply_pool_->SetQueueTimeMicrosHistogram(
+        METRIC_op_follower_apply_queue_time.Instantiate(server_->metric_entity()));
+  }
+
+  if (FLAGS_tablet_deferred_block_deletion) {
+    CHECK_OK(ThreadPoolBuilder("orphan-gc")
+             .set_max_threads(1)
+             .Build(&orphan_gc_pool_));
+  }
 }
 
 TSTabletManager::~TSTabletManager() {
@@ -217,7 +262,10 @@ Status TSTabletManager::Init() {
     metas.push_back(meta);
   }
 
-  // Now submit the "Open" task for each.
+  // Now submit an "Open" task for each. The tasks are not bound to specific
+  // tablets; they pop from 'pending_open_queue_', so that an RPC arriving
+  // for a tablet which has not started bootstrapping yet can move that
+  // tablet to the front of the queue.
   for (const scoped_refptr<TabletMetadata>& meta : metas) {
     scoped_refptr<TransitionInProgressDeleter> deleter;
     {
@@ -226,8 +274,12 @@ Status TSTabletManager::Init() {
     }
 
     scoped_refptr<TabletPeer> tablet_peer = CreateAndRegisterTabletPeer(meta, NEW_PEER);
-    RETURN_NOT_OK(open_tablet_pool_->SubmitFunc(boost::bind(&TSTabletManager::OpenTablet,
-                                                this, meta, deleter)));
+    {
+      std::lock_guard<rw_spinlock> lock(lock_);
+      pending_open_queue_.push_back({ meta, deleter });
+    }
+    RETURN_NOT_OK(open_tablet_pool_->SubmitFunc(
+        boost::bind(&TSTabletManager::OpenNextPendingTablet, this)));
   }
 
   {
@@ -284,6 +336,20 @@ Status TSTabletManager::CreateNewTablet(const string& table_id,
     RETURN_NOT_OK(StartTabletStateTransitionUnlocked(tablet_id, "creating tablet", &deleter));
   }
 
+  // Place the new tablet's WAL on fast storage if its table was selected for
+  // it. This must happen before the tablet's log is first opened, which
+  // fixes the WAL's location.
+  if (fs_manager_->has_fast_wal_root() &&
+      !FLAGS_tablet_wal_fast_storage_tables.empty()) {
+    vector<string> fast_tables = strings::Split(
+        FLAGS_tablet_wal_fast_storage_tables, ",", strings::SkipEmpty());
+    if (std::find(fast_tables.begin(), fast_tables.end(), table_name) !=
+        fast_tables.end()) {
+      RETURN_NOT_OK_PREPEND(fs_manager_->PlaceTabletWalOnFastStorage(tablet_id),
+                            "Couldn't place tablet WAL on fast storage");
+    }
+  }
+
   // Create the metadata.
   TRACE("Creating new metadata...");
   scoped_refptr<TabletMetadata> meta;
@@ -553,6 +619,7 @@ scoped_refptr<TabletPeer> TSTabletManager::CreateAndRegisterTabletPeer(
       new TabletPeer(meta,
                      local_peer_pb_,
                      apply_pool_.get(),
+                     follower_write_apply_pool_.get(),
                      Bind(&TSTabletManager::MarkTabletDirty, Unretained(this), meta->tablet_id())));
   RegisterTablet(meta->tablet_id(), tablet_peer, mode);
   return tablet_peer;
@@ -640,6 +707,10 @@ Status TSTabletManager::DeleteTablet(
 
   tablet_peer->StatusMessage("Deleted tablet blocks from disk");
 
+  // In deferred mode the data blocks are still on disk; hand the metadata off
+  // to the background reclaim task.
+  SubmitDeferredTabletReclaim(tablet_peer->tablet_metadata());
+
   // We only remove DELETED tablets from the tablet map.
   if (delete_type == TABLET_DATA_DELETED) {
     std::lock_guard<rw_spinlock> lock(lock_);
@@ -792,6 +863,33 @@ void TSTabletManager::OpenTablet(const scoped_refptr<TabletMetadata>& meta,
   }
 }
 
+void TSTabletManager::OpenNextPendingTablet() {
+  scoped_refptr<TabletMetadata> meta;
+  scoped_refptr<TransitionInProgressDeleter> deleter;
+  {
+    std::lock_guard<rw_spinlock> lock(lock_);
+    CHECK(!pending_open_queue_.empty());
+    meta = std::move(pending_open_queue_.front().meta);
+    deleter = std::move(pending_open_queue_.front().deleter);
+    pending_open_queue_.pop_front();
+  }
+  OpenTablet(meta, deleter);
+}
+
+void TSTabletManager::PrioritizeTabletForOpen(const string& tablet_id) {
+  std::lock_guard<rw_spinlock> lock(lock_);
+  for (auto it = pending_open_queue_.begin(); it != pending_open_queue_.end(); ++it) {
+    if (it->meta->tablet_id() == tablet_id) {
+      if (it != pending_open_queue_.begin()) {
+        PendingOpenTablet entry = std::move(*it);
+        pending_open_queue_.erase(it);
+        pending_open_queue_.push_front(std::move(entry));
+      }
+      break;
+    }
+  }
+}
+
 void TSTabletManager::Shutdown() {
   {
     std::lock_guard<rw_spinlock> lock(lock_);
@@ -823,6 +921,13 @@ void TSTabletManager::Shutdown() {
   // Shut down the bootstrap pool, so no new tablets are registered after this point.
   open_tablet_pool_->Shutdown();
 
+  // Any tablets which never made it out of the startup open queue will not
+  // be opened; drop their metadata references and transition markers.
+  {
+    std::lock_guard<rw_spinlock> lock(lock_);
+    pending_open_queue_.clear();
+  }
+
   // Take a snapshot of the peers list -- that way we don't have to hold
   // on to the lock while shutting them down, which might cause a lock
   // inversion. (see KUDU-308 for example).
@@ -833,8 +938,14 @@ void TSTabletManager::Shutdown() {
     peer->Shutdown();
   }
 
-  // Shut down the apply pool.
+  // Shut down the apply pools.
+  if (orphan_gc_pool_) {
+    orphan_gc_pool_->Shutdown();
+  }
   apply_pool_->Shutdown();
+  if (follower_write_apply_pool_) {
+    follower_write_apply_pool_->Shutdown();
+  }
 
   {
     std::lock_guard<rw_spinlock> l(lock_);
@@ -1001,6 +1112,7 @@ Status TSTabletManager::HandleNonReadyTabletOnStartup(const scoped_refptr<Tablet
   if (!skip_deletion) {
     // Passing no OpId will retain the last_logged_opid that was previously in the metadata.
     RETURN_NOT_OK(DeleteTabletData(meta, data_state, boost::none));
+    SubmitDeferredTabletReclaim(meta);
   }
 
   // Register TOMBSTONED tablets so that they get reported to the Master, which
@@ -1045,9 +1157,37 @@ Status TSTabletManager::DeleteTabletData(const scoped_refptr<TabletMetadata>& me
   // Only TABLET_DATA_DELETED tablets get this far.
   RETURN_NOT_OK(ConsensusMetadata::DeleteOnDiskData(meta->fs_manager(), meta->tablet_id()));
   MAYBE_FAULT(FLAGS_fault_crash_after_cmeta_deleted);
+
+  // In deferred mode the superblock still references the orphaned blocks, so
+  // it cannot be deleted yet: the background reclaim task deletes it once the
+  // blocks have been removed (see SubmitDeferredTabletReclaim()). If the
+  // server crashes first, the orphans and the superblock are cleaned up when
+  // the metadata is next loaded on startup.
+  if (FLAGS_tablet_deferred_block_deletion) {
+    return Status::OK();
+  }
   return meta->DeleteSuperBlock();
 }
 
+void TSTabletManager::SubmitDeferredTabletReclaim(const scoped_refptr<TabletMetadata>& meta) {
+  if (!orphan_gc_pool_) {
+    return;
+  }
+  WARN_NOT_OK(orphan_gc_pool_->SubmitFunc(
+      boost::bind(&TSTabletManager::ReclaimTabletBlocks, this, meta)),
+              LogPrefix(meta->tablet_id()) + "Unable to submit orphaned block reclaim task");
+}
+
+void TSTabletManager::ReclaimTabletBlocks(const scoped_refptr<TabletMetadata>& meta) {
+  const string& tablet_id = meta->tablet_id();
+  WARN_NOT_OK(meta->ReclaimOrphanedBlocks(),
+              LogPrefix(tablet_id) + "Unable to reclaim orphaned blocks");
+  if (meta->tablet_data_state() == TABLET_DATA_DELETED) {
+    WARN_NOT_OK(meta->DeleteSuperBlock(),
+                LogPrefix(tablet_id) + "Unable to delete superblock");
+  }
+}
+
 void TSTabletManager::LogAndTombstone(const scoped_refptr<TabletPeer>& peer,
                                       const std::string& msg,
                                       const Status& s) {
@@ -1061,6 +1201,7 @@ void TSTabletManager::LogAndTombstone(const scoped_refptr<TabletPeer>& peer,
     LOG(FATAL) << LogPrefix(tablet_id) << "Failed to tombstone tablet after tablet copy: "
                << delete_status.ToString();
   }
+  SubmitDeferredTabletReclaim(peer->tablet_metadata());
   peer->StatusMessage(Substitute("Tombstoned tablet: $0 ($1)", msg, s.ToString()));
 }
 
@@ -19,6 +19,7 @@
 
 #include <boost/optional/optional_fwd.hpp>
 #include <gtest/gtest_prod.h>
+#include <deque>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -151,6 +152,13 @@ class TSTabletManager : public tserver::TabletPeerLookupIf {
       const consensus::StartTabletCopyRequestPB* req,
       std::function<void(const Status&, TabletServerErrorPB::Code)> cb) override;
 
+  // Moves 'tablet_id' to the front of the queue of tablets waiting to be
+  // opened at startup, if it is still waiting. Called when an RPC arrives
+  // for a tablet which has not yet begun bootstrapping, so that tablets with
+  // observed demand (client accesses, consensus vote requests) are opened
+  // before idle ones.
+  virtual void PrioritizeTabletForOpen(const std::string& tablet_id) override;
+
   // Synchronously run the tablet copy procedure.
   void RunTabletCopy(
       const consensus::StartTabletCopyRequestPB* req,
@@ -232,6 +240,12 @@ class TSTabletManager : public tserver::TabletPeerLookupIf {
   void OpenTablet(const scoped_refptr<tablet::TabletMetadata>& meta,
                   const scoped_refptr<TransitionInProgressDeleter>& deleter);
 
+  // Opens the tablet at the front of 'pending_open_queue_'. Init() submits
+  // one such task to 'open_tablet_pool_' per queued tablet; since the tasks
+  // are not bound to specific tablets, PrioritizeTabletForOpen() can reorder
+  // the queue up until the moment a tablet's open actually starts.
+  void OpenNextPendingTablet();
+
   // Open a tablet whose metadata has already been loaded.
   void BootstrapAndInitTablet(const scoped_refptr<tablet::TabletMetadata>& meta,
                               scoped_refptr<tablet::TabletPeer>* peer);
@@ -270,6 +284,16 @@ class TSTabletManager : public tserver::TabletPeerLookupIf {
                                  int64_t leader_term,
                                  int64_t last_logged_term);
 
+  // If --tablet_deferred_block_deletion is enabled, submit a task to
+  // 'orphan_gc_pool_' which reclaims the blocks orphaned by a deferred
+  // tablet deletion or tombstoning. No-op otherwise.
+  void SubmitDeferredTabletReclaim(const scoped_refptr<tablet::TabletMetadata>& meta);
+
+  // Body of the task submitted by SubmitDeferredTabletReclaim(). Deletes the
+  // orphaned blocks in throttled batches and, if the tablet was permanently
+  // deleted, deletes its superblock once no orphans remain.
+  void ReclaimTabletBlocks(const scoped_refptr<tablet::TabletMetadata>& meta);
+
   // Print a log message using the given info and tombstone the specified
   // tablet. If tombstoning the tablet fails, a FATAL error is logged, resulting
   // in a crash.
@@ -312,6 +336,18 @@ class TSTabletManager : public tserver::TabletPeerLookupIf {
   // bootstrap, creation, or deletion is in-progress
   TransitionInProgressMap transition_in_progress_;
 
+  // A tablet waiting to be opened at startup.
+  struct PendingOpenTablet {
+    scoped_refptr<tablet::TabletMetadata> meta;
+    scoped_refptr<TransitionInProgressDeleter> deleter;
+  };
+
+  // Tablets waiting to be opened at startup, in the order they will be
+  // opened. Entries are popped from the front by OpenNextPendingTablet();
+  // PrioritizeTabletForOpen() moves entries with observed demand to the
+  // front. Protected by 'lock_'.
+  std::deque<PendingOpenTablet> pending_open_queue_;
+
   MetricRegistry* metric_registry_;
 
   TSTabletManagerStatePB state_;
@@ -325,6 +361,15 @@ class TSTabletManager : public tserver::TabletPeerLookupIf {
   // Thread pool for apply transactions, shared between all tablets.
   gscoped_ptr<ThreadPool> apply_pool_;
 
+  // Optional dedicated pool for applying replicated writes on follower
+  // replicas, shared between all tablets. NULL unless
+  // --follower_write_apply_pool_num_threads is greater than zero.
+  gscoped_ptr<ThreadPool> follower_write_apply_pool_;
+
+  // Single-threaded pool used to reclaim blocks orphaned by deferred tablet
+  // deletions. NULL unless --tablet_deferred_block_deletion is enabled.
+  gscoped_ptr<ThreadPool> orphan_gc_pool_;
+
   DISALLOW_COPY_AND_ASSIGN(TSTabletManager);
 };
 
@@ -152,6 +152,33 @@ TEST(TestBitMap, TestBulkSetAndTestBits) {
   }
 }
 
+TEST(TestBitMap, TestMergeAnd) {
+  uint8_t dst[16];
+  uint8_t src[16];
+  size_t total_size = sizeof(dst) * 8;
+
+  // AND over every prefix length, checking the bits covered by the merge,
+  // the bits past it, and that set bits survive only where both inputs agree.
+  for (size_t num_bits = 1; num_bits <= total_size; num_bits++) {
+    BitmapChangeBits(dst, 0, total_size, true);
+    BitmapChangeBits(src, 0, total_size, false);
+    for (size_t i = 0; i < total_size; i += 3) {
+      BitmapSet(src, i);
+    }
+
+    BitmapMergeAnd(dst, src, num_bits);
+
+    for (size_t i = 0; i < num_bits; i++) {
+      ASSERT_EQ(i % 3 == 0, BitmapTest(dst, i));
+    }
+    // Bits past the last byte touched by the merge must be untouched.
+    size_t merged_bits = BitmapSize(num_bits) * 8;
+    for (size_t i = merged_bits; i < total_size; i++) {
+      ASSERT_TRUE(BitmapTest(dst, i));
+    }
+  }
+}
+
 TEST(TestBitMap, TestFindBit) {
   uint8_t bm[16];
 
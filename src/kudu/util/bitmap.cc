@@ -17,11 +17,24 @@
 #include <glog/logging.h>
 #include <string>
 
+#include "kudu/gutil/port.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/util/bitmap.h"
 
 namespace kudu {
 
+void BitmapMergeAnd(uint8_t *dst, const uint8_t *src, size_t n_bits) {
+  size_t n_bytes = BitmapSize(n_bits);
+  size_t i = 0;
+  for (; i + 8 <= n_bytes; i += 8) {
+    UNALIGNED_STORE64(dst + i,
+                      UNALIGNED_LOAD64(dst + i) & UNALIGNED_LOAD64(src + i));
+  }
+  for (; i < n_bytes; i++) {
+    dst[i] &= src[i];
+  }
+}
+
 void BitmapChangeBits(uint8_t *bitmap, size_t offset, size_t num_bits, bool value) {
   DCHECK_GT(num_bits, 0);
 
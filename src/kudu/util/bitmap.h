@@ -58,6 +58,11 @@ inline void BitmapMergeOr(uint8_t *dst, const uint8_t *src, size_t n_bits) {
   }
 }
 
+// Merge the two bitmaps using bitwise and, a word at a time. Both bitmaps
+// should have at least n_bits valid bits. Bits in the trailing padding of
+// 'dst' can only be cleared by this, never set, so the padding remains valid.
+void BitmapMergeAnd(uint8_t *dst, const uint8_t *src, size_t n_bits);
+
 // Set bits from offset to (offset + num_bits) to the specified value
 void BitmapChangeBits(uint8_t *bitmap, size_t offset, size_t num_bits, bool value);
 
@@ -25,6 +25,7 @@
 
 #include "kudu/util/countdown_latch.h"
 #include "kudu/util/blocking_queue.h"
+#include "kudu/util/monotime.h"
 
 using std::shared_ptr;
 using std::string;
@@ -65,6 +66,35 @@ TEST(BlockingQueueTest, TestBlockingDrainTo) {
   ASSERT_EQ(3, out[2]);
 }
 
+TEST(BlockingQueueTest, TestBlockingDrainToDeadline) {
+  BlockingQueue<int32_t> test_queue(3);
+  vector<int32_t> out;
+
+  // An empty queue should return true with nothing drained once the
+  // deadline expires.
+  MonoTime deadline = MonoTime::Now() + MonoDelta::FromMilliseconds(5);
+  ASSERT_TRUE(test_queue.BlockingDrainTo(&out, deadline));
+  ASSERT_TRUE(out.empty());
+  ASSERT_GE(MonoTime::Now(), deadline);
+
+  // Available elements should be drained without waiting for the deadline,
+  // appending to the existing contents of 'out'.
+  out.push_back(1);
+  ASSERT_EQ(test_queue.Put(2), QUEUE_SUCCESS);
+  ASSERT_EQ(test_queue.Put(3), QUEUE_SUCCESS);
+  deadline = MonoTime::Now() + MonoDelta::FromSeconds(60);
+  ASSERT_TRUE(test_queue.BlockingDrainTo(&out, deadline));
+  ASSERT_EQ(3, out.size());
+  ASSERT_EQ(1, out[0]);
+  ASSERT_EQ(2, out[1]);
+  ASSERT_EQ(3, out[2]);
+
+  // After shutdown, the timed drain should return false like the
+  // untimed variant.
+  test_queue.Shutdown();
+  ASSERT_FALSE(test_queue.BlockingDrainTo(&out, deadline));
+}
+
 TEST(BlockingQueueTest, TestTooManyInsertions) {
   BlockingQueue<int32_t> test_queue(2);
   ASSERT_EQ(test_queue.Put(123), QUEUE_SUCCESS);
@@ -84,4 +84,43 @@ TEST(TestBloomFilter, TestInsertAndProbe) {
   ASSERT_NEAR(fp_rate, expected_fp_rate, 0.20*expected_fp_rate);
 }
 
+TEST(TestBlockedBloomFilter, TestInsertAndProbe) {
+  int n_keys = 2000;
+  BlockedBloomFilterBuilder bfb(n_keys);
+
+  // Enter n_keys random keys into the filter.
+  srandom(kRandomSeed);
+  for (int i = 0; i < n_keys; i++) {
+    uint64_t key = random();
+    Slice key_slice(reinterpret_cast<const uint8_t *>(&key), sizeof(key));
+    bfb.AddKey(BloomKeyProbe(key_slice));
+  }
+  ASSERT_EQ(n_keys, bfb.count());
+
+  // Verify that the keys we inserted all return true when queried.
+  BlockedBloomFilter bf(bfb.slice());
+  srandom(kRandomSeed);
+  for (int i = 0; i < n_keys; i++) {
+    uint64_t key = random();
+    Slice key_slice(reinterpret_cast<const uint8_t *>(&key), sizeof(key));
+    ASSERT_TRUE(bf.MayContainKey(BloomKeyProbe(key_slice)));
+  }
+
+  // Query a bunch of other keys. At 8 bits per key, the blocked layout
+  // should stay under a ~5% false positive rate.
+  uint32_t num_queries = 100000;
+  uint32_t num_positives = 0;
+  for (int i = 0; i < num_queries; i++) {
+    uint64_t key = random();
+    Slice key_slice(reinterpret_cast<const uint8_t *>(&key), sizeof(key));
+    if (bf.MayContainKey(BloomKeyProbe(key_slice))) {
+      num_positives++;
+    }
+  }
+
+  double fp_rate = static_cast<double>(num_positives) / static_cast<double>(num_queries);
+  LOG(INFO) << "FP rate: " << fp_rate << " (" << num_positives << "/" << num_queries << ")";
+  ASSERT_LT(fp_rate, 0.05);
+}
+
 } // namespace kudu
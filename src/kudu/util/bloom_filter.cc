@@ -15,6 +15,7 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
 #include <math.h>
 
 #include "kudu/util/bloom_filter.h"
@@ -81,6 +82,22 @@ BloomFilter::BloomFilter(const Slice &data, size_t n_hashes)
     n_hashes_(n_hashes)
 {}
 
+BlockedBloomFilterBuilder::BlockedBloomFilterBuilder(size_t expected_count)
+  : n_blocks_(std::max<size_t>(
+        1, (expected_count * kBitsPerKey / 8 + kBlockBytes - 1) / kBlockBytes)),
+    bitmap_(new uint8_t[n_blocks_ * kBlockBytes]),
+    n_inserted_(0) {
+  memset(&bitmap_[0], 0, n_blocks_ * kBlockBytes);
+}
+
+BlockedBloomFilter::BlockedBloomFilter(const Slice &data)
+  : n_blocks_(data.size() / BlockedBloomFilterBuilder::kBlockBytes),
+    bitmap_(reinterpret_cast<const uint8_t *>(data.data())) {
+  CHECK_EQ(data.size() % BlockedBloomFilterBuilder::kBlockBytes, 0)
+      << "blocked bloom filter data must be a multiple of the block size";
+  CHECK_GT(n_blocks_, 0);
+}
+
 
 
 } // namespace kudu
@@ -18,6 +18,10 @@
 DECLARE_string(nvm_cache_path);
 #endif // defined(__linux__)
 
+DECLARE_bool(cache_force_single_shard);
+DECLARE_string(cache_eviction_policy);
+DECLARE_int32(cache_high_priority_reserved_percentage);
+
 namespace kudu {
 
 // Conversions between numeric keys/values and the types expected by Cache.
@@ -81,10 +85,12 @@ class CacheTest : public KuduTest,
     return r;
   }
 
-  void Insert(int key, int value, int charge = 1) {
+  void Insert(int key, int value, int charge = 1,
+              Cache::EntryPriority priority = Cache::LOW_PRIORITY) {
     string key_str = EncodeInt(key);
     string val_str = EncodeInt(value);
-    Cache::PendingHandle* handle = CHECK_NOTNULL(cache_->Allocate(key_str, val_str.size(), charge));
+    Cache::PendingHandle* handle = CHECK_NOTNULL(
+        cache_->Allocate(key_str, val_str.size(), charge, priority));
     memcpy(cache_->MutableValue(handle), val_str.data(), val_str.size());
 
     cache_->Release(cache_->Insert(handle, this));
@@ -231,4 +237,116 @@ TEST_P(CacheTest, NewId) {
   ASSERT_NE(a, b);
 }
 
+// Tests for the SLRU (segmented LRU) eviction policy, which only applies
+// to the DRAM cache.
+class SLRUCacheTest : public CacheTest {
+ public:
+  virtual void SetUp() OVERRIDE {
+    FLAGS_cache_eviction_policy = "SLRU";
+    // Use a single shard for accurate capacity accounting.
+    FLAGS_cache_force_single_shard = true;
+    CacheTest::SetUp();
+  }
+
+ private:
+  // Restores the flags above when the test completes.
+  google::FlagSaver flag_saver_;
+};
+
+INSTANTIATE_TEST_CASE_P(SLRUCacheTypes, SLRUCacheTest, ::testing::Values(DRAM_CACHE));
+
+TEST_P(SLRUCacheTest, ScanResistance) {
+  const int kNumElems = 1000;
+  const int kSizePerElem = kCacheSize / kNumElems;
+  const int kWorkingSetElems = 100;
+
+  // Build up a working set, then access it a second time to promote it into
+  // the protected segment.
+  for (int i = 0; i < kWorkingSetElems; i++) {
+    Insert(i, 1000 + i, kSizePerElem);
+  }
+  for (int i = 0; i < kWorkingSetElems; i++) {
+    ASSERT_EQ(1000 + i, Lookup(i));
+  }
+
+  // Simulate a large scan: insert twice the cache's capacity worth of
+  // entries which are never accessed again.
+  for (int i = 0; i < kNumElems * 2; i++) {
+    Insert(10000 + i, 20000 + i, kSizePerElem);
+  }
+
+  // The one-touch scan entries should not have displaced the promoted
+  // working set.
+  for (int i = 0; i < kWorkingSetElems; i++) {
+    ASSERT_EQ(1000 + i, Lookup(i));
+  }
+}
+
+// Tests for the high-priority entry reservation, which only applies to the
+// DRAM cache.
+class HighPriorityCacheTest : public CacheTest {
+ public:
+  virtual void SetUp() OVERRIDE {
+    // Use a single shard for accurate capacity accounting.
+    FLAGS_cache_force_single_shard = true;
+    CacheTest::SetUp();
+  }
+
+ private:
+  // Restores the flag above when the test completes.
+  google::FlagSaver flag_saver_;
+};
+
+INSTANTIATE_TEST_CASE_P(HighPriorityCacheTypes, HighPriorityCacheTest,
+                        ::testing::Values(DRAM_CACHE));
+
+TEST_P(HighPriorityCacheTest, ScanDoesNotEvictReservedEntries) {
+  const int kNumElems = 1000;
+  const int kSizePerElem = kCacheSize / kNumElems;
+  // 10% of capacity: fits within the default reservation.
+  const int kHighPriElems = 100;
+
+  for (int i = 0; i < kHighPriElems; i++) {
+    Insert(i, 1000 + i, kSizePerElem, Cache::HIGH_PRIORITY);
+  }
+
+  // Simulate a large scan: insert twice the cache's capacity worth of
+  // low-priority entries which are never accessed again.
+  for (int i = 0; i < kNumElems * 2; i++) {
+    Insert(10000 + i, 20000 + i, kSizePerElem);
+  }
+
+  // The scan should not have displaced any high-priority entries.
+  for (int i = 0; i < kHighPriElems; i++) {
+    ASSERT_EQ(1000 + i, Lookup(i));
+  }
+}
+
+TEST_P(HighPriorityCacheTest, OverReservationEntriesCompete) {
+  const int kNumElems = 1000;
+  const int kSizePerElem = kCacheSize / kNumElems;
+  // 50% of capacity: well beyond the default reservation.
+  const int kHighPriElems = 500;
+
+  for (int i = 0; i < kHighPriElems; i++) {
+    Insert(i, 1000 + i, kSizePerElem, Cache::HIGH_PRIORITY);
+  }
+  for (int i = 0; i < kNumElems * 2; i++) {
+    Insert(10000 + i, 20000 + i, kSizePerElem);
+  }
+
+  // High-priority usage should have been cut back to approximately the
+  // reservation: the excess competes with the scan and loses.
+  int cached_weight = 0;
+  for (int i = 0; i < kHighPriElems; i++) {
+    if (Lookup(i) >= 0) {
+      cached_weight += kSizePerElem;
+    }
+  }
+  const int reserved = kCacheSize *
+      FLAGS_cache_high_priority_reserved_percentage / 100;
+  ASSERT_GT(cached_weight, 0);
+  ASSERT_LE(cached_weight, reserved + kSizePerElem);
+}
+
 }  // namespace kudu
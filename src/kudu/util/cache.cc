@@ -12,6 +12,7 @@
 #include <glog/logging.h>
 
 #include "kudu/gutil/atomic_refcount.h"
+#include "kudu/gutil/atomicops.h"
 #include "kudu/gutil/bits.h"
 #include "kudu/gutil/hash/city.h"
 #include "kudu/gutil/stl_util.h"
@@ -35,6 +36,29 @@ DEFINE_bool(cache_force_single_shard, false,
             "Override all cache implementations to use just one shard");
 TAG_FLAG(cache_force_single_shard, hidden);
 
+DEFINE_string(cache_eviction_policy, "LRU",
+              "Eviction policy for the DRAM cache: either 'LRU' or 'SLRU'. "
+              "SLRU (segmented LRU) splits each cache shard into a probationary "
+              "and a protected segment: entries are admitted to the protected "
+              "segment only once they have been accessed more than once, which "
+              "makes the cache resistant to pollution by large one-time scans.");
+TAG_FLAG(cache_eviction_policy, advanced);
+
+DEFINE_int32(cache_slru_protected_percentage, 80,
+             "With the SLRU eviction policy, the percentage of each cache "
+             "shard's capacity which is reserved for entries that have been "
+             "accessed more than once.");
+TAG_FLAG(cache_slru_protected_percentage, advanced);
+
+DEFINE_int32(cache_high_priority_reserved_percentage, 20,
+             "The percentage of each cache shard's capacity which is reserved "
+             "for high-priority entries (e.g. cfile index and bloom filter "
+             "blocks). High-priority entries are only evicted before other "
+             "entries once their total usage exceeds this reservation, so a "
+             "large scan of low-priority data cannot flush them out of the "
+             "cache. Set to 0 to make all entries compete equally.");
+TAG_FLAG(cache_high_priority_reserved_percentage, advanced);
+
 namespace kudu {
 
 class MetricEntity;
@@ -49,8 +73,22 @@ using std::vector;
 
 typedef simple_spinlock MutexType;
 
+// Deferred cache-usage deltas are published to the shared usage gauge once
+// they exceed this many bytes in either direction. See
+// LRUCache::PublishUsageDelta().
+const int64_t kUsagePublishThresholdBytes = 1 << 20;
+
 // LRU cache implementation
 
+// Cache entry segments used by the SLRU eviction policy. With the classic
+// LRU policy, all entries remain in the probationary segment. High-priority
+// entries always live in their own segment, regardless of policy.
+enum LRUSegment {
+  kProbationary,
+  kProtected,
+  kHighPriority
+};
+
 // An entry is a variable length heap-allocated structure.  Entries
 // are kept in a circular doubly linked list ordered by access time.
 struct LRUHandle {
@@ -64,6 +102,13 @@ struct LRUHandle {
   Atomic32 refs;
   uint32_t hash;      // Hash of key(); used for fast sharding and comparisons
 
+  // The LRU segment this entry currently belongs to. Only ever kProtected
+  // when the SLRU policy is enabled.
+  uint8_t segment;
+
+  // The Cache::EntryPriority assigned at allocation time.
+  uint8_t priority;
+
   // The storage for the key/value pair itself. The data is stored as:
   //   [key bytes ...] [padding up to 8-byte boundary] [value bytes ...]
   uint8_t kv_data[1];   // Beginning of key/value pair
@@ -178,8 +223,21 @@ class LRUCache {
   explicit LRUCache(MemTracker* tracker);
   ~LRUCache();
 
-  // Separate from constructor so caller can easily make an array of LRUCache
-  void SetCapacity(size_t capacity) { capacity_ = capacity; }
+  // Separate from constructor so caller can easily make an array of LRUCache.
+  //
+  // 'protected_capacity' is the portion of 'capacity' reserved for entries
+  // which have been accessed more than once. Pass 0 for the classic LRU
+  // policy (a single segment).
+  //
+  // 'high_pri_reserved_capacity' is the portion of 'capacity' reserved for
+  // HIGH_PRIORITY entries: they are evicted before other entries only once
+  // their total usage exceeds this reservation.
+  void SetCapacity(size_t capacity, size_t protected_capacity,
+                   size_t high_pri_reserved_capacity) {
+    capacity_ = capacity;
+    protected_capacity_ = protected_capacity;
+    high_pri_reserved_capacity_ = high_pri_reserved_capacity;
+  }
 
   void SetMetrics(CacheMetrics* metrics) { metrics_ = metrics; }
 
@@ -191,48 +249,91 @@ class LRUCache {
 
  private:
   void LRU_Remove(LRUHandle* e);
-  void LRU_Append(LRUHandle* e);
+  // Append 'e' as the newest entry of the list headed by 'list'. The entry's
+  // 'segment' member must already reflect the segment of the target list.
+  void LRU_Append(LRUHandle* list, LRUHandle* e);
+  // Demote entries from the tail of the protected segment into the
+  // probationary segment until the protected segment is back under its
+  // capacity. Must be called with 'mutex_' held.
+  void BalanceSegments();
   // Just reduce the reference count by 1.
   // Return true if last reference
   bool Unref(LRUHandle* e);
   // Call the user's eviction callback, if it exists, and free the entry.
   void FreeEntry(LRUHandle* e);
+  // Update the shared cache-usage gauge to reflect a change of 'delta' bytes
+  // in this shard. The gauge is a single cache line shared by every shard, so
+  // rather than bouncing it between cores on each insertion and eviction, each
+  // shard accumulates small deltas locally and publishes them only once
+  // kUsagePublishThresholdBytes has built up. Requires 'metrics_' to be set.
+  void PublishUsageDelta(int64_t delta);
 
   // Initialized before use.
   size_t capacity_;
 
+  // Portion of 'capacity_' reserved for multi-touch entries. Zero when the
+  // classic LRU policy is in use.
+  size_t protected_capacity_;
+
+  // Portion of 'capacity_' reserved for HIGH_PRIORITY entries.
+  size_t high_pri_reserved_capacity_;
+
   // mutex_ protects the following state.
   MutexType mutex_;
   size_t usage_;
+  size_t protected_usage_;
+  size_t high_pri_usage_;
 
-  // Dummy head of LRU list.
+  // Dummy head of the probationary LRU list. With the classic LRU policy,
+  // this is the only list in use.
   // lru.prev is newest entry, lru.next is oldest entry.
   LRUHandle lru_;
 
+  // Dummy head of the protected LRU list (SLRU policy only).
+  LRUHandle protected_lru_;
+
+  // Dummy head of the LRU list of HIGH_PRIORITY entries.
+  LRUHandle high_pri_lru_;
+
   HandleTable table_;
 
   MemTracker* mem_tracker_;
 
   CacheMetrics* metrics_;
+
+  // Usage delta not yet published to metrics_->cache_usage. Updated with
+  // atomic ops since entries may be freed outside of 'mutex_'.
+  base::subtle::Atomic64 deferred_usage_delta_;
 };
 
 LRUCache::LRUCache(MemTracker* tracker)
- : usage_(0),
+ : protected_capacity_(0),
+   high_pri_reserved_capacity_(0),
+   usage_(0),
+   protected_usage_(0),
+   high_pri_usage_(0),
    mem_tracker_(tracker),
-   metrics_(nullptr) {
-  // Make empty circular linked list
+   metrics_(nullptr),
+   deferred_usage_delta_(0) {
+  // Make empty circular linked lists
   lru_.next = &lru_;
   lru_.prev = &lru_;
+  protected_lru_.next = &protected_lru_;
+  protected_lru_.prev = &protected_lru_;
+  high_pri_lru_.next = &high_pri_lru_;
+  high_pri_lru_.prev = &high_pri_lru_;
 }
 
 LRUCache::~LRUCache() {
-  for (LRUHandle* e = lru_.next; e != &lru_; ) {
-    LRUHandle* next = e->next;
-    DCHECK_EQ(e->refs, 1);  // Error if caller has an unreleased handle
-    if (Unref(e)) {
-      FreeEntry(e);
+  for (LRUHandle* head : { &lru_, &protected_lru_, &high_pri_lru_ }) {
+    for (LRUHandle* e = head->next; e != head; ) {
+      LRUHandle* next = e->next;
+      DCHECK_EQ(e->refs, 1);  // Error if caller has an unreleased handle
+      if (Unref(e)) {
+        FreeEntry(e);
+      }
+      e = next;
     }
-    e = next;
   }
 }
 
@@ -248,25 +349,57 @@ void LRUCache::FreeEntry(LRUHandle* e) {
   }
   mem_tracker_->Release(e->charge);
   if (PREDICT_TRUE(metrics_)) {
-    metrics_->cache_usage->DecrementBy(e->charge);
+    PublishUsageDelta(-static_cast<int64_t>(e->charge));
     metrics_->evictions->Increment();
   }
   delete [] e;
 }
 
+void LRUCache::PublishUsageDelta(int64_t delta) {
+  int64_t pending = base::subtle::NoBarrier_AtomicIncrement(&deferred_usage_delta_, delta);
+  if (pending >= kUsagePublishThresholdBytes || pending <= -kUsagePublishThresholdBytes) {
+    // Whoever pushed the accumulator over the threshold publishes the whole
+    // pending amount; a concurrent updater simply starts a new accumulation.
+    pending = base::subtle::NoBarrier_AtomicExchange(&deferred_usage_delta_, 0);
+    if (pending != 0) {
+      metrics_->cache_usage->IncrementBy(pending);
+    }
+  }
+}
+
 void LRUCache::LRU_Remove(LRUHandle* e) {
   e->next->prev = e->prev;
   e->prev->next = e->next;
   usage_ -= e->charge;
+  if (e->segment == kProtected) {
+    protected_usage_ -= e->charge;
+  } else if (e->segment == kHighPriority) {
+    high_pri_usage_ -= e->charge;
+  }
 }
 
-void LRUCache::LRU_Append(LRUHandle* e) {
-  // Make "e" newest entry by inserting just before lru_
-  e->next = &lru_;
-  e->prev = lru_.prev;
+void LRUCache::LRU_Append(LRUHandle* list, LRUHandle* e) {
+  // Make "e" newest entry by inserting just before *list
+  e->next = list;
+  e->prev = list->prev;
   e->prev->next = e;
   e->next->prev = e;
   usage_ += e->charge;
+  if (e->segment == kProtected) {
+    protected_usage_ += e->charge;
+  } else if (e->segment == kHighPriority) {
+    high_pri_usage_ += e->charge;
+  }
+}
+
+void LRUCache::BalanceSegments() {
+  while (protected_usage_ > protected_capacity_ &&
+         protected_lru_.next != &protected_lru_) {
+    LRUHandle* old = protected_lru_.next;
+    LRU_Remove(old);
+    old->segment = kProbationary;
+    LRU_Append(&lru_, old);
+  }
 }
 
 Cache::Handle* LRUCache::Lookup(const Slice& key, uint32_t hash, bool caching) {
@@ -277,7 +410,18 @@ Cache::Handle* LRUCache::Lookup(const Slice& key, uint32_t hash, bool caching) {
     if (e != nullptr) {
       base::RefCountInc(&e->refs);
       LRU_Remove(e);
-      LRU_Append(e);
+      if (e->segment == kHighPriority) {
+        // High-priority entries never migrate between segments.
+        LRU_Append(&high_pri_lru_, e);
+      } else if (protected_capacity_ > 0) {
+        // The entry has now been accessed at least twice: promote it to the
+        // protected segment, demoting colder entries if necessary.
+        e->segment = kProtected;
+        LRU_Append(&protected_lru_, e);
+        BalanceSegments();
+      } else {
+        LRU_Append(&lru_, e);
+      }
     }
   }
 
@@ -319,7 +463,7 @@ Cache::Handle* LRUCache::Insert(LRUHandle* e, Cache::EvictionCallback *eviction_
   e->refs = 2;  // One from LRUCache, one for the returned handle
   mem_tracker_->Consume(e->charge);
   if (PREDICT_TRUE(metrics_)) {
-    metrics_->cache_usage->IncrementBy(e->charge);
+    PublishUsageDelta(e->charge);
     metrics_->inserts->Increment();
   }
 
@@ -327,7 +471,16 @@ Cache::Handle* LRUCache::Insert(LRUHandle* e, Cache::EvictionCallback *eviction_
   {
     std::lock_guard<MutexType> l(mutex_);
 
-    LRU_Append(e);
+    // High-priority entries go straight to their own segment. Other new
+    // entries are admitted to the probationary segment; they are only
+    // promoted to the protected segment on a subsequent access.
+    if (e->priority == Cache::HIGH_PRIORITY) {
+      e->segment = kHighPriority;
+      LRU_Append(&high_pri_lru_, e);
+    } else {
+      e->segment = kProbationary;
+      LRU_Append(&lru_, e);
+    }
 
     LRUHandle* old = table_.Insert(e);
     if (old != nullptr) {
@@ -338,6 +491,20 @@ Cache::Handle* LRUCache::Insert(LRUHandle* e, Cache::EvictionCallback *eviction_
       }
     }
 
+    // High-priority entries beyond their reservation compete like any
+    // others; evict them first so that they cannot starve the rest of the
+    // cache.
+    while (usage_ > capacity_ && high_pri_usage_ > high_pri_reserved_capacity_ &&
+           high_pri_lru_.next != &high_pri_lru_) {
+      LRUHandle* old = high_pri_lru_.next;
+      LRU_Remove(old);
+      table_.Remove(old->key(), old->hash);
+      if (Unref(old)) {
+        old->next = to_remove_head;
+        to_remove_head = old;
+      }
+    }
+
     while (usage_ > capacity_ && lru_.next != &lru_) {
       LRUHandle* old = lru_.next;
       LRU_Remove(old);
@@ -347,6 +514,30 @@ Cache::Handle* LRUCache::Insert(LRUHandle* e, Cache::EvictionCallback *eviction_
         to_remove_head = old;
       }
     }
+
+    // If the probationary segment has been exhausted (e.g. nearly everything
+    // has been promoted), fall back to evicting from the protected segment.
+    while (usage_ > capacity_ && protected_lru_.next != &protected_lru_) {
+      LRUHandle* old = protected_lru_.next;
+      LRU_Remove(old);
+      table_.Remove(old->key(), old->hash);
+      if (Unref(old)) {
+        old->next = to_remove_head;
+        to_remove_head = old;
+      }
+    }
+
+    // Last resort: the cache consists almost entirely of high-priority
+    // entries within their reservation.
+    while (usage_ > capacity_ && high_pri_lru_.next != &high_pri_lru_) {
+      LRUHandle* old = high_pri_lru_.next;
+      LRU_Remove(old);
+      table_.Remove(old->key(), old->hash);
+      if (Unref(old)) {
+        old->next = to_remove_head;
+        to_remove_head = old;
+      }
+    }
   }
 
   // we free the entries here outside of mutex for
@@ -378,6 +569,16 @@ void LRUCache::Erase(const Slice& key, uint32_t hash) {
   }
 }
 
+// Returns true if the SLRU (segmented LRU) eviction policy has been selected
+// via --cache_eviction_policy.
+bool SlruPolicyEnabled() {
+  if (FLAGS_cache_eviction_policy == "SLRU") return true;
+  if (FLAGS_cache_eviction_policy == "LRU") return false;
+  LOG(FATAL) << "Unknown value for --cache_eviction_policy: "
+             << FLAGS_cache_eviction_policy;
+  return false;
+}
+
 // Determine the number of bits of the hash that should be used to determine
 // the cache shard. This, in turn, determines the number of shards.
 int DetermineShardBits() {
@@ -421,9 +622,19 @@ class ShardedLRUCache : public Cache {
 
     int num_shards = 1 << shard_bits_;
     const size_t per_shard = (capacity + (num_shards - 1)) / num_shards;
+    size_t per_shard_protected = 0;
+    if (SlruPolicyEnabled()) {
+      CHECK_GE(FLAGS_cache_slru_protected_percentage, 0);
+      CHECK_LE(FLAGS_cache_slru_protected_percentage, 100);
+      per_shard_protected = per_shard * FLAGS_cache_slru_protected_percentage / 100;
+    }
+    CHECK_GE(FLAGS_cache_high_priority_reserved_percentage, 0);
+    CHECK_LE(FLAGS_cache_high_priority_reserved_percentage, 100);
+    const size_t per_shard_high_pri =
+        per_shard * FLAGS_cache_high_priority_reserved_percentage / 100;
     for (int s = 0; s < num_shards; s++) {
       gscoped_ptr<LRUCache> shard(new LRUCache(mem_tracker_.get()));
-      shard->SetCapacity(per_shard);
+      shard->SetCapacity(per_shard, per_shard_protected, per_shard_high_pri);
       shards_.push_back(shard.release());
     }
   }
@@ -465,6 +676,11 @@ class ShardedLRUCache : public Cache {
   }
 
   virtual PendingHandle* Allocate(Slice key, int val_len, int charge) OVERRIDE {
+    return Allocate(key, val_len, charge, LOW_PRIORITY);
+  }
+
+  virtual PendingHandle* Allocate(Slice key, int val_len, int charge,
+                                  EntryPriority priority) OVERRIDE {
     int key_len = key.size();
     DCHECK_GE(key_len, 0);
     DCHECK_GE(val_len, 0);
@@ -478,6 +694,7 @@ class ShardedLRUCache : public Cache {
     handle->val_length = val_len;
     handle->charge = charge;
     handle->hash = HashSlice(key);
+    handle->priority = priority;
     memcpy(handle->kv_data, key.data(), key_len);
 
     return reinterpret_cast<PendingHandle*>(handle);
@@ -106,6 +106,19 @@ class Cache {
     NO_EXPECT_IN_CACHE
   };
 
+  // The priority of an entry, set at allocation time.
+  //
+  // HIGH_PRIORITY entries are kept on a separate LRU list within each cache
+  // shard and are only evicted before LOW_PRIORITY entries when their total
+  // usage exceeds the shard's reserved fraction of capacity (see
+  // --cache_high_priority_reserved_percentage). This lets callers protect
+  // small, expensive-to-rebuild entries (e.g. index blocks) from being
+  // flushed out of the cache by large streams of low-value entries.
+  enum EntryPriority {
+    LOW_PRIORITY,
+    HIGH_PRIORITY
+  };
+
   // If the cache has no mapping for "key", returns NULL.
   //
   // Else return a handle that corresponds to the mapping.  The caller
@@ -179,6 +192,14 @@ class Cache {
   // caller must either free it using Free(), or insert it using Insert().
   virtual PendingHandle* Allocate(Slice key, int val_len, int charge) = 0;
 
+  // As above, but additionally assigns the given priority to the entry.
+  // Implementations which do not support entry priorities ignore the
+  // priority and behave as the three-argument overload.
+  virtual PendingHandle* Allocate(Slice key, int val_len, int charge,
+                                  EntryPriority /* priority */) {
+    return Allocate(key, val_len, charge);
+  }
+
   virtual uint8_t* MutableValue(PendingHandle* handle) = 0;
 
   // Commit a prepared entry into the cache.
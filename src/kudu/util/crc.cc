@@ -31,6 +31,9 @@ static Crc* crc32c_instance = nullptr;
 
 static void InitCrc32cInstance() {
   ScopedLeakCheckDisabler disabler; // CRC instance is never freed.
+  // Passing true enables crcutil's runtime CPU detection: on processors with
+  // SSE4.2 this selects the hardware CRC32 instruction, falling back to the
+  // table-driven multiword implementation elsewhere.
   // TODO: Is initial = 0 and roll window = 4 appropriate for all cases?
   crc32c_instance = crcutil_interface::CRC::CreateCrc32c(true, 0, 4, nullptr);
 }
@@ -391,6 +391,15 @@ class ShortReadRandomAccessFile : public RandomAccessFile {
     return wrapped_->Read(offset, short_n, result, scratch);
   }
 
+  virtual Status Prefetch(uint64_t offset, size_t n) const OVERRIDE {
+    return wrapped_->Prefetch(offset, n);
+  }
+
+  virtual Status HintAccessPattern(uint64_t offset, size_t n,
+                                   FileAccessPatternHint hint) const OVERRIDE {
+    return wrapped_->HintAccessPattern(offset, n, hint);
+  }
+
   virtual Status Size(uint64_t *size) const OVERRIDE {
     return wrapped_->Size(size);
   }
@@ -716,7 +725,12 @@ TEST_F(TestEnv, TestRWFile) {
   string kTestData = "abcde";
   ASSERT_OK(file->Write(0, kTestData));
 
-  // Read from it.
+  // Read from it. Prefetch first; it's just a hint, so the only observable
+  // behavior is that it doesn't fail. Ditto for access pattern hints.
+  ASSERT_OK(file->Prefetch(0, kTestData.length()));
+  ASSERT_OK(file->HintAccessPattern(0, 0, ACCESS_PATTERN_SEQUENTIAL));
+  ASSERT_OK(file->HintAccessPattern(0, 0, ACCESS_PATTERN_RANDOM));
+  ASSERT_OK(file->HintAccessPattern(0, kTestData.length(), ACCESS_PATTERN_DONTNEED));
   Slice result;
   unique_ptr<uint8_t[]> scratch(new uint8_t[kTestData.length()]);
   ASSERT_OK(file->Read(0, kTestData.length(), &result, scratch.get()));
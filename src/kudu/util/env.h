@@ -318,6 +318,23 @@ class Env {
   void operator=(const Env&);
 };
 
+// A hint about the access pattern expected for an open file or a byte range
+// thereof, used to tune OS readahead and page cache behavior. Hints are
+// best-effort: platforms without support simply ignore them.
+enum FileAccessPatternHint {
+  // The data will be read sequentially, so the OS should read ahead
+  // aggressively.
+  ACCESS_PATTERN_SEQUENTIAL,
+
+  // The data will be accessed with random point reads, so the OS should
+  // disable readahead.
+  ACCESS_PATTERN_RANDOM,
+
+  // The data has been consumed and won't be read again soon, so the OS may
+  // drop it from the page cache.
+  ACCESS_PATTERN_DONTNEED,
+};
+
 // A file abstraction for reading sequentially through a file
 class SequentialFile {
  public:
@@ -343,6 +360,12 @@ class SequentialFile {
   // REQUIRES: External synchronization
   virtual Status Skip(uint64_t n) = 0;
 
+  // Hints to the OS how the file will be accessed. Best-effort; see
+  // FileAccessPatternHint.
+  //
+  // REQUIRES: External synchronization
+  virtual Status HintAccessPattern(FileAccessPatternHint hint) = 0;
+
   // Returns the filename provided when the SequentialFile was constructed.
   virtual const std::string& filename() const = 0;
 };
@@ -365,6 +388,21 @@ class RandomAccessFile {
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
                       uint8_t *scratch) const = 0;
 
+  // Hints to the OS that the given byte range will soon be read, so that
+  // it may begin readahead in the background. Best-effort: platforms
+  // without readahead support simply return OK.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual Status Prefetch(uint64_t offset, size_t n) const = 0;
+
+  // Hints to the OS how the byte range given by 'offset' and 'n' will be
+  // accessed. If 'n' is 0, the hint applies from 'offset' to the end of the
+  // file. Best-effort; see FileAccessPatternHint.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual Status HintAccessPattern(uint64_t offset, size_t n,
+                                   FileAccessPatternHint hint) const = 0;
+
   // Returns the size of the file
   virtual Status Size(uint64_t *size) const = 0;
 
@@ -496,6 +534,21 @@ class RWFile {
   virtual Status Read(uint64_t offset, size_t length,
                       Slice* result, uint8_t* scratch) const = 0;
 
+  // Hints to the OS that the given byte range will soon be read, so that
+  // it may begin readahead in the background. Best-effort: platforms
+  // without readahead support simply return OK.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual Status Prefetch(uint64_t offset, size_t length) const = 0;
+
+  // Hints to the OS how the byte range given by 'offset' and 'length' will
+  // be accessed. If 'length' is 0, the hint applies from 'offset' to the end
+  // of the file. Best-effort; see FileAccessPatternHint.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual Status HintAccessPattern(uint64_t offset, size_t length,
+                                   FileAccessPatternHint hint) const = 0;
+
   // Writes 'data' to the file position given by 'offset'.
   virtual Status Write(uint64_t offset, const Slice& data) = 0;
 
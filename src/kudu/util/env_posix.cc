@@ -247,6 +247,17 @@ static Status DoOpen(const string& filename, Env::CreateMode mode, int* fd) {
   return Status::OK();
 }
 
+#if defined(__linux__)
+static int FadviseForAccessPattern(FileAccessPatternHint hint) {
+  switch (hint) {
+    case ACCESS_PATTERN_SEQUENTIAL: return POSIX_FADV_SEQUENTIAL;
+    case ACCESS_PATTERN_RANDOM: return POSIX_FADV_RANDOM;
+    case ACCESS_PATTERN_DONTNEED: return POSIX_FADV_DONTNEED;
+  }
+  LOG(FATAL) << "Unknown access pattern hint: " << hint;
+}
+#endif
+
 class PosixSequentialFile: public SequentialFile {
  private:
   std::string filename_;
@@ -283,6 +294,17 @@ class PosixSequentialFile: public SequentialFile {
     return Status::OK();
   }
 
+  virtual Status HintAccessPattern(FileAccessPatternHint hint) OVERRIDE {
+    ThreadRestrictions::AssertIOAllowed();
+#if defined(__linux__)
+    int ret = posix_fadvise(fileno(file_), 0, 0, FadviseForAccessPattern(hint));
+    if (ret != 0) {
+      return IOError(filename_, ret);
+    }
+#endif
+    return Status::OK();
+  }
+
   virtual const string& filename() const OVERRIDE { return filename_; }
 };
 
@@ -311,6 +333,29 @@ class PosixRandomAccessFile: public RandomAccessFile {
     return s;
   }
 
+  virtual Status Prefetch(uint64_t offset, size_t n) const OVERRIDE {
+    ThreadRestrictions::AssertIOAllowed();
+#if defined(__linux__)
+    int ret = posix_fadvise(fd_, offset, n, POSIX_FADV_WILLNEED);
+    if (ret != 0) {
+      return IOError(filename_, ret);
+    }
+#endif
+    return Status::OK();
+  }
+
+  virtual Status HintAccessPattern(uint64_t offset, size_t n,
+                                   FileAccessPatternHint hint) const OVERRIDE {
+    ThreadRestrictions::AssertIOAllowed();
+#if defined(__linux__)
+    int ret = posix_fadvise(fd_, offset, n, FadviseForAccessPattern(hint));
+    if (ret != 0) {
+      return IOError(filename_, ret);
+    }
+#endif
+    return Status::OK();
+  }
+
   virtual Status Size(uint64_t *size) const OVERRIDE {
     TRACE_EVENT1("io", "PosixRandomAccessFile::Size", "path", filename_);
     ThreadRestrictions::AssertIOAllowed();
@@ -577,6 +622,29 @@ class PosixRWFile : public RWFile {
     return Status::OK();
   }
 
+  virtual Status Prefetch(uint64_t offset, size_t length) const OVERRIDE {
+    ThreadRestrictions::AssertIOAllowed();
+#if defined(__linux__)
+    int ret = posix_fadvise(fd_, offset, length, POSIX_FADV_WILLNEED);
+    if (ret != 0) {
+      return IOError(filename_, ret);
+    }
+#endif
+    return Status::OK();
+  }
+
+  virtual Status HintAccessPattern(uint64_t offset, size_t length,
+                                   FileAccessPatternHint hint) const OVERRIDE {
+    ThreadRestrictions::AssertIOAllowed();
+#if defined(__linux__)
+    int ret = posix_fadvise(fd_, offset, length, FadviseForAccessPattern(hint));
+    if (ret != 0) {
+      return IOError(filename_, ret);
+    }
+#endif
+    return Status::OK();
+  }
+
   virtual Status Write(uint64_t offset, const Slice& data) OVERRIDE {
     MAYBE_RETURN_FAILURE(FLAGS_env_inject_io_error_on_write_or_preallocate,
                          Status::IOError(Env::kInjectedFailureStatusMsg));
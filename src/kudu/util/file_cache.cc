@@ -213,6 +213,19 @@ class Descriptor<RWFile> : public RWFile {
     return opened.file()->Read(offset, length, result, scratch);
   }
 
+  Status Prefetch(uint64_t offset, size_t length) const override {
+    ScopedOpenedDescriptor<RWFile> opened(&base_);
+    RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
+    return opened.file()->Prefetch(offset, length);
+  }
+
+  Status HintAccessPattern(uint64_t offset, size_t length,
+                           FileAccessPatternHint hint) const override {
+    ScopedOpenedDescriptor<RWFile> opened(&base_);
+    RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
+    return opened.file()->HintAccessPattern(offset, length, hint);
+  }
+
   Status Write(uint64_t offset, const Slice& data) override {
     ScopedOpenedDescriptor<RWFile> opened(&base_);
     RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
@@ -326,6 +339,19 @@ class Descriptor<RandomAccessFile> : public RandomAccessFile {
     return opened.file()->Read(offset, n, result, scratch);
   }
 
+  Status Prefetch(uint64_t offset, size_t n) const override {
+    ScopedOpenedDescriptor<RandomAccessFile> opened(&base_);
+    RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
+    return opened.file()->Prefetch(offset, n);
+  }
+
+  Status HintAccessPattern(uint64_t offset, size_t n,
+                           FileAccessPatternHint hint) const override {
+    ScopedOpenedDescriptor<RandomAccessFile> opened(&base_);
+    RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
+    return opened.file()->HintAccessPattern(offset, n, hint);
+  }
+
   Status Size(uint64_t *size) const override {
     ScopedOpenedDescriptor<RandomAccessFile> opened(&base_);
     RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
@@ -463,6 +489,21 @@ Status FileCache<FileType>::DeleteFile(const string& file_name) {
   return env_->DeleteFile(file_name);
 }
 
+template <class FileType>
+void FileCache<FileType>::Invalidate(const string& file_name) {
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    auto it = descriptors_.find(file_name);
+    if (it != descriptors_.end()) {
+      CHECK(it->second.expired())
+          << "Cannot invalidate " << file_name
+          << ": an outstanding descriptor exists";
+      descriptors_.erase(it);
+    }
+  }
+  cache_->Erase(file_name);
+}
+
 template <class FileType>
 int FileCache<FileType>::NumDescriptorsForTests() const {
   std::lock_guard<simple_spinlock> l(lock_);
@@ -559,6 +600,8 @@ Status FileCache<RWFile>::OpenExistingFile(
 template
 Status FileCache<RWFile>::DeleteFile(const string& file_name);
 template
+void FileCache<RWFile>::Invalidate(const string& file_name);
+template
 int FileCache<RWFile>::NumDescriptorsForTests() const;
 template
 string FileCache<RWFile>::ToDebugString() const;
@@ -580,6 +623,8 @@ Status FileCache<RandomAccessFile>::OpenExistingFile(
 template
 Status FileCache<RandomAccessFile>::DeleteFile(const string& file_name);
 template
+void FileCache<RandomAccessFile>::Invalidate(const string& file_name);
+template
 int FileCache<RandomAccessFile>::NumDescriptorsForTests() const;
 template
 string FileCache<RandomAccessFile>::ToDebugString() const;
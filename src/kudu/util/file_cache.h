@@ -130,6 +130,15 @@ class FileCache {
   // deleted immediately.
   Status DeleteFile(const std::string& file_name);
 
+  // Invalidates any cached state for the file with name 'file_name', so
+  // that the next call to OpenExistingFile() opens it anew from the
+  // filesystem. Useful when a file has been replaced on disk (e.g. via
+  // rename) underneath the cache.
+  //
+  // Requires that there are no outstanding descriptors for the file;
+  // invalidating a file which is still in use is not supported.
+  void Invalidate(const std::string& file_name);
+
   // Returns the number of entries in the descriptor map.
   //
   // Only intended for unit tests.
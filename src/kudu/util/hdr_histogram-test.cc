@@ -110,4 +110,39 @@ TEST_F(HdrHistogramTest, PercentileAndCopyTest) {
   ASSERT_EQ(hist.TotalSum(), copy.TotalSum());
 }
 
+TEST_F(HdrHistogramTest, MergeTest) {
+  uint64_t specified_max = 10000;
+  HdrHistogram hist(specified_max, kSigDigits);
+  load_percentiles(&hist);
+
+  // Merging into an empty histogram should reproduce the original.
+  HdrHistogram merged(specified_max, kSigDigits);
+  merged.MergeFrom(hist);
+  NO_FATALS(validate_percentiles(&merged, specified_max));
+  ASSERT_EQ(hist.TotalSum(), merged.TotalSum());
+  ASSERT_EQ(hist.TotalCount(), merged.TotalCount());
+  ASSERT_EQ(hist.MinValue(), merged.MinValue());
+  ASSERT_EQ(hist.MaxValue(), merged.MaxValue());
+
+  // Merging again should double all counts.
+  merged.MergeFrom(hist);
+  ASSERT_EQ(2 * hist.TotalSum(), merged.TotalSum());
+  ASSERT_EQ(2 * hist.TotalCount(), merged.TotalCount());
+}
+
+TEST_F(HdrHistogramTest, StripedHistogramTest) {
+  uint64_t specified_max = 10000;
+  StripedHdrHistogram striped(specified_max, kSigDigits);
+  striped.Increment(10);
+  striped.IncrementBy(100, 5);
+  ASSERT_EQ(6, striped.TotalCount());
+
+  HdrHistogram merged(specified_max, kSigDigits);
+  striped.MergeTo(&merged);
+  ASSERT_EQ(6, merged.TotalCount());
+  ASSERT_EQ(10 + 5 * 100, merged.TotalSum());
+  ASSERT_EQ(10, merged.MinValue());
+  ASSERT_EQ(100, merged.MaxValue());
+}
+
 } // namespace kudu
@@ -23,6 +23,8 @@
 //   http://creativecommons.org/publicdomain/zero/1.0/
 #include "kudu/util/hdr_histogram.h"
 
+#include <unistd.h>
+
 #include <algorithm>
 #include <cmath>
 #include <limits>
@@ -31,6 +33,8 @@
 #include "kudu/gutil/bits.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/status.h"
+#include "kudu/util/striped64.h"
+#include "kudu/util/threadlocal.h"
 
 using base::subtle::Atomic64;
 using base::subtle::NoBarrier_AtomicIncrement;
@@ -184,6 +188,46 @@ void HdrHistogram::IncrementBy(int64_t value, int64_t count) {
   }
 }
 
+void HdrHistogram::MergeFrom(const HdrHistogram& other) {
+  DCHECK_EQ(highest_trackable_value_, other.highest_trackable_value_);
+  DCHECK_EQ(num_significant_digits_, other.num_significant_digits_);
+  DCHECK_EQ(counts_array_length_, other.counts_array_length_);
+
+  // Mirror the snapshot copy constructor: merge the sum and min first, then
+  // the counts in order of ascending magnitude, then the max, and derive the
+  // added total from the counts actually merged.
+  NoBarrier_AtomicIncrement(&total_sum_, NoBarrier_Load(&other.total_sum_));
+
+  {
+    Atomic64 other_min = NoBarrier_Load(&other.min_value_);
+    Atomic64 min_val;
+    while (other_min < (min_val = NoBarrier_Load(&min_value_))) {
+      Atomic64 old_val = NoBarrier_CompareAndSwap(&min_value_, min_val, other_min);
+      if (old_val == min_val) break; // CAS success.
+    }
+  }
+
+  uint64_t total_merged_count = 0;
+  for (int i = 0; i < counts_array_length_; i++) {
+    uint64_t count = NoBarrier_Load(&other.counts_[i]);
+    if (count > 0) {
+      NoBarrier_AtomicIncrement(&counts_[i], count);
+      total_merged_count += count;
+    }
+  }
+
+  {
+    Atomic64 other_max = NoBarrier_Load(&other.max_value_);
+    Atomic64 max_val;
+    while (other_max > (max_val = NoBarrier_Load(&max_value_))) {
+      Atomic64 old_val = NoBarrier_CompareAndSwap(&max_value_, max_val, other_max);
+      if (old_val == max_val) break; // CAS success.
+    }
+  }
+
+  NoBarrier_AtomicIncrement(&total_count_, total_merged_count);
+}
+
 void HdrHistogram::IncrementWithExpectedInterval(int64_t value,
                                                  int64_t expected_interval_between_samples) {
   Increment(value);
@@ -320,6 +364,109 @@ uint64_t HdrHistogram::ValueAtPercentile(double percentile) const {
   return 0;
 }
 
+///////////////////////////////////////////////////////////////////////
+// StripedHdrHistogram
+///////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Pick a power-of-two stripe count based on the number of online CPUs.
+// The count is capped to bound the worst-case memory overhead, since each
+// allocated stripe carries a full counts array.
+int NumHistogramStripes() {
+  static const int kMaxStripes = 16;
+  int ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int stripes = 1;
+  while (stripes < ncpus && stripes < kMaxStripes) {
+    stripes <<= 1;
+  }
+  return stripes;
+}
+
+} // anonymous namespace
+
+StripedHdrHistogram::StripedHdrHistogram(uint64_t highest_trackable_value,
+                                         int num_significant_digits)
+  : highest_trackable_value_(highest_trackable_value),
+    num_significant_digits_(num_significant_digits),
+    num_stripes_(NumHistogramStripes()),
+    stripes_(new base::subtle::AtomicWord[num_stripes_]()) {
+  // Validate the params eagerly rather than on first record.
+  CHECK(HdrHistogram::IsValidHighestTrackableValue(highest_trackable_value_));
+  CHECK(HdrHistogram::IsValidNumSignificantDigits(num_significant_digits_));
+}
+
+StripedHdrHistogram::~StripedHdrHistogram() {
+  for (int i = 0; i < num_stripes_; i++) {
+    delete reinterpret_cast<HdrHistogram*>(base::subtle::Acquire_Load(&stripes_[i]));
+  }
+}
+
+HdrHistogram* StripedHdrHistogram::StripeForCurrentThread() {
+  // Reuse the striped64 per-thread hash code; collisions there are
+  // indicative of collisions here too.
+  BLOCK_STATIC_THREAD_LOCAL(striped64::internal::HashCode, hashcode);
+  int idx = hashcode->code_ & (num_stripes_ - 1);
+  base::subtle::AtomicWord cur = base::subtle::Acquire_Load(&stripes_[idx]);
+  if (PREDICT_TRUE(cur != 0)) {
+    return reinterpret_cast<HdrHistogram*>(cur);
+  }
+
+  // First thread to hash to this slot: allocate the stripe and try to
+  // install it.
+  gscoped_ptr<HdrHistogram> stripe(
+      new HdrHistogram(highest_trackable_value_, num_significant_digits_));
+  base::subtle::AtomicWord prev = base::subtle::Release_CompareAndSwap(
+      &stripes_[idx], 0, reinterpret_cast<base::subtle::AtomicWord>(stripe.get()));
+  if (prev != 0) {
+    // Lost the race; use the winner's stripe and free ours.
+    return reinterpret_cast<HdrHistogram*>(prev);
+  }
+  return stripe.release();
+}
+
+void StripedHdrHistogram::Increment(int64_t value) {
+  StripeForCurrentThread()->Increment(value);
+}
+
+void StripedHdrHistogram::IncrementBy(int64_t value, int64_t count) {
+  StripeForCurrentThread()->IncrementBy(value, count);
+}
+
+uint64_t StripedHdrHistogram::TotalCount() const {
+  uint64_t total = 0;
+  for (int i = 0; i < num_stripes_; i++) {
+    const HdrHistogram* stripe =
+        reinterpret_cast<const HdrHistogram*>(base::subtle::Acquire_Load(&stripes_[i]));
+    if (stripe != nullptr) {
+      total += stripe->TotalCount();
+    }
+  }
+  return total;
+}
+
+uint64_t StripedHdrHistogram::TotalSum() const {
+  uint64_t total = 0;
+  for (int i = 0; i < num_stripes_; i++) {
+    const HdrHistogram* stripe =
+        reinterpret_cast<const HdrHistogram*>(base::subtle::Acquire_Load(&stripes_[i]));
+    if (stripe != nullptr) {
+      total += stripe->TotalSum();
+    }
+  }
+  return total;
+}
+
+void StripedHdrHistogram::MergeTo(HdrHistogram* target) const {
+  for (int i = 0; i < num_stripes_; i++) {
+    const HdrHistogram* stripe =
+        reinterpret_cast<const HdrHistogram*>(base::subtle::Acquire_Load(&stripes_[i]));
+    if (stripe != nullptr) {
+      target->MergeFrom(*stripe);
+    }
+  }
+}
+
 ///////////////////////////////////////////////////////////////////////
 // AbstractHistogramIterator
 ///////////////////////////////////////////////////////////////////////
@@ -95,6 +95,14 @@ class HdrHistogram {
   void IncrementWithExpectedInterval(int64_t value,
                                      int64_t expected_interval_between_samples);
 
+  // Add the contents of 'other' into this histogram. Like the snapshot copy
+  // constructor, this is not a consistent snapshot of 'other' in the presence
+  // of concurrent writers, but is kept roughly close.
+  //
+  // REQUIRES: 'other' was constructed with the same parameters as this
+  // histogram.
+  void MergeFrom(const HdrHistogram& other);
+
   // Fetch configuration params.
   uint64_t highest_trackable_value() const { return highest_trackable_value_; }
   int num_significant_digits() const { return num_significant_digits_; }
@@ -198,6 +206,58 @@ class HdrHistogram {
   HdrHistogram& operator=(const HdrHistogram& other); // Disable assignment operator.
 };
 
+// A sharded ("striped") HdrHistogram for write-heavy histograms.
+//
+// Recording threads are spread across a small set of underlying HdrHistogram
+// stripes based on a per-thread hash, which avoids bouncing the histogram's
+// counter cache lines between cores on hot paths. Stripes are allocated
+// lazily, so memory overhead scales with the number of threads actually
+// recording rather than with the stripe count. Reads merge all stripes into
+// a private HdrHistogram snapshot ("merge on read").
+//
+// This class is thread-safe.
+class StripedHdrHistogram {
+ public:
+  StripedHdrHistogram(uint64_t highest_trackable_value, int num_significant_digits);
+  ~StripedHdrHistogram();
+
+  // Record new data in the current thread's stripe.
+  void Increment(int64_t value);
+  void IncrementBy(int64_t value, int64_t count);
+
+  // Fetch configuration params.
+  uint64_t highest_trackable_value() const { return highest_trackable_value_; }
+  int num_significant_digits() const { return num_significant_digits_; }
+
+  // Count of all events recorded, summed across stripes.
+  uint64_t TotalCount() const;
+
+  // Sum of all events recorded, summed across stripes.
+  uint64_t TotalSum() const;
+
+  // Merge the contents of all stripes into 'target'.
+  //
+  // REQUIRES: 'target' was constructed with the same parameters as this
+  // histogram.
+  void MergeTo(HdrHistogram* target) const;
+
+ private:
+  // Return the stripe the current thread should record into, allocating it
+  // if this is the first thread to hash to its slot.
+  HdrHistogram* StripeForCurrentThread();
+
+  const uint64_t highest_trackable_value_;
+  const int num_significant_digits_;
+
+  // Power of two, sized based on the number of CPUs.
+  const int num_stripes_;
+
+  // Lazily-allocated stripes; each slot holds an HdrHistogram* or NULL.
+  gscoped_array<base::subtle::AtomicWord> stripes_;
+
+  DISALLOW_COPY_AND_ASSIGN(StripedHdrHistogram);
+};
+
 // Value returned from iterators.
 struct HistogramIterationValue {
   HistogramIterationValue()
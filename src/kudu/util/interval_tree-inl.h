@@ -36,8 +36,9 @@ IntervalTree<Traits>::~IntervalTree() {
 }
 
 template<class Traits>
+template<class Container>
 void IntervalTree<Traits>::FindContainingPoint(const point_type &query,
-                                               IntervalVector *results) const {
+                                               Container *results) const {
   if (root_) {
     root_->FindContainingPoint(query, results);
   }
@@ -151,8 +152,9 @@ class ITNode {
   ~ITNode();
 
   // See IntervalTree::FindContainingPoint(...)
+  template<class Container>
   void FindContainingPoint(const point_type &query,
-                           IntervalVector *results) const;
+                           Container *results) const;
 
   // See IntervalTree::FindIntersectingInterval(...)
   void FindIntersectingInterval(const interval_type &query,
@@ -212,8 +214,9 @@ ITNode<Traits>::~ITNode() {
 }
 
 template<class Traits>
+template<class Container>
 void ITNode<Traits>::FindContainingPoint(const point_type &query,
-                                         IntervalVector *results) const {
+                                         Container *results) const {
   int cmp = Traits::compare(query, split_point_);
   if (cmp < 0) {
     // None of the intervals in right_ may intersect this.
@@ -82,10 +82,13 @@ class IntervalTree {
   ~IntervalTree();
 
   // Find all intervals in the tree which contain the query point.
-  // The resulting intervals are added to the 'results' vector.
-  // The vector is not cleared first.
+  // The resulting intervals are added to the 'results' container, which may
+  // be any type with a vector-like push_back/insert API (e.g. a
+  // stack-allocated small vector for allocation-free hot-path queries).
+  // The container is not cleared first.
+  template<class Container>
   void FindContainingPoint(const point_type &query,
-                           IntervalVector *results) const;
+                           Container *results) const;
 
   // Find all intervals in the tree which intersect the given interval.
   // The resulting intervals are added to the 'results' vector.
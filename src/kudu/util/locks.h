@@ -140,6 +140,11 @@ class rw_spinlock {
 // This means that in the read-mostly case, different readers will not cause any
 // cacheline contention.
 //
+// Writers are additionally serialized through an internal queue lock, so that
+// when multiple writers contend, only one of them spins on the per-CPU lock
+// words at a time; the rest wait (spin-then-park) without disturbing readers'
+// cache lines.
+//
 // Usage:
 //   percpu_rwlock mylock;
 //
@@ -179,11 +184,15 @@ class percpu_rwlock {
   }
 
   bool try_lock() {
+    if (!writer_lock_.try_lock()) {
+      return false;
+    }
     for (int i = 0; i < n_cpus_; i++) {
       if (!locks_[i].lock.try_lock()) {
         while (i--) {
           locks_[i].lock.unlock();
         }
+        writer_lock_.unlock();
         return false;
       }
     }
@@ -200,6 +209,13 @@ class percpu_rwlock {
   }
 
   void lock() {
+    // Acquire the writer queue lock first so that at most one writer at a
+    // time sweeps the per-CPU locks. Without this, concurrent writers all
+    // spin CASing on every per-CPU lock word, bouncing those cache lines
+    // across sockets -- exactly the lines readers need for their fast path.
+    // Queued writers instead wait on 'writer_lock_', which spins briefly and
+    // then parks in the kernel (see base::SpinLock).
+    writer_lock_.lock();
     for (int i = 0; i < n_cpus_; i++) {
       locks_[i].lock.lock();
     }
@@ -209,6 +225,7 @@ class percpu_rwlock {
     for (int i = 0; i < n_cpus_; i++) {
       locks_[i].lock.unlock();
     }
+    writer_lock_.unlock();
   }
 
   // Returns the memory usage of this object without the object itself. Should
@@ -225,6 +242,10 @@ class percpu_rwlock {
     char padding[CACHELINE_SIZE - (sizeof(rw_spinlock) % CACHELINE_SIZE)];
   };
 
+  // Serializes writers before they touch the per-CPU locks, so that writer
+  // contention stays on this one lock rather than on every per-CPU cache line.
+  simple_spinlock writer_lock_;
+
   int n_cpus_;
   padded_lock *locks_;
 };
@@ -292,6 +292,43 @@ TEST_F(MaintenanceManagerTest, TestLogRetentionPrioritization) {
   manager_->UnregisterOp(&op2);
 }
 
+// Test that when several ops are runnable at once, the scheduler dispatches
+// them back-to-back until the worker threads are full, rather than launching
+// at most one op per polling interval.
+TEST_F(MaintenanceManagerTest, TestRunsOpsInParallelWithinOnePollingInterval) {
+  // Rebuild the manager with a polling interval much longer than the test:
+  // all of the scheduling below must therefore happen within a single cycle.
+  manager_->Shutdown();
+  MaintenanceManager::Options options;
+  options.num_threads = 2;
+  options.polling_interval_ms = 60 * 1000;
+  options.history_size = kHistorySize;
+  options.parent_mem_tracker = test_tracker_;
+  manager_.reset(new MaintenanceManager(options));
+  manager_->Init();
+
+  TestMaintenanceOp op1("op1", MaintenanceOp::HIGH_IO_USAGE, test_tracker_);
+  op1.set_perf_improvement(10);
+  op1.set_sleep_time(MonoDelta::FromSeconds(2));
+
+  TestMaintenanceOp op2("op2", MaintenanceOp::HIGH_IO_USAGE, test_tracker_);
+  op2.set_perf_improvement(10);
+  op2.set_sleep_time(MonoDelta::FromSeconds(2));
+
+  manager_->RegisterOp(&op1);
+  manager_->RegisterOp(&op2);
+
+  // Both ops should be running concurrently well before the polling interval
+  // elapses.
+  AssertEventually([&]() {
+      ASSERT_EQ(1, op1.RunningGauge()->value());
+      ASSERT_EQ(1, op2.RunningGauge()->value());
+    });
+
+  manager_->UnregisterOp(&op1);
+  manager_->UnregisterOp(&op2);
+}
+
 // Test adding operations and make sure that the history of recently completed operations
 // is correct in that it wraps around and doesn't grow.
 TEST_F(MaintenanceManagerTest, TestCompletedOpsHistory) {
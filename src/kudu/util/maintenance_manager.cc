@@ -161,6 +161,9 @@ void MaintenanceManager::RegisterOp(MaintenanceOp* op) {
       << ", but it already exists in ops_.";
   op->manager_ = shared_from_this();
   op->cond_.reset(new ConditionVariable(&lock_));
+  // Wake up the scheduler so that it considers the new op without waiting
+  // for the current polling interval to elapse.
+  cond_.Signal();
   VLOG_AND_TRACE("maintenance", 1) << "Registered " << op->name();
 }
 
@@ -197,9 +200,18 @@ void MaintenanceManager::RunSchedulerThread() {
   MonoDelta polling_interval = MonoDelta::FromMilliseconds(polling_interval_ms_);
 
   std::unique_lock<Mutex> guard(lock_);
+  // Set when the previous iteration launched an op: in that case we look for
+  // another runnable op right away instead of sleeping, so that when several
+  // ops are worth doing (e.g. flushes and compactions touching different data
+  // directories) we fill all the worker threads in a single polling cycle
+  // rather than launching one op per cycle.
+  bool prev_iter_found_an_op = false;
   while (true) {
     // Loop until we are shutting down or it is time to run another op.
-    cond_.TimedWait(polling_interval);
+    if (!prev_iter_found_an_op) {
+      cond_.TimedWait(polling_interval);
+    }
+    prev_iter_found_an_op = false;
     if (shutdown_) {
       VLOG_AND_TRACE("maintenance", 1) << "Shutting down maintenance manager.";
       return;
@@ -235,6 +247,7 @@ void MaintenanceManager::RunSchedulerThread() {
     Status s = thread_pool_->SubmitFunc(boost::bind(
           &MaintenanceManager::LaunchOp, this, op));
     CHECK(s.ok());
+    prev_iter_found_an_op = true;
   }
 }
 
@@ -393,6 +406,9 @@ void MaintenanceManager::LaunchOp(MaintenanceOp* op) {
   running_ops_--;
   op->running_--;
   op->cond_->Signal();
+  // Wake up the scheduler so that it can backfill the freed worker thread
+  // right away rather than waiting out the rest of its polling interval.
+  cond_.Signal();
 }
 
 void MaintenanceManager::GetMaintenanceManagerStatusDump(MaintenanceManagerStatusPB* out_pb) {
@@ -30,6 +30,7 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_int32(mem_tracker_thread_cache_bytes);
 DECLARE_int32(memory_limit_soft_percentage);
 
 namespace kudu {
@@ -344,6 +345,35 @@ TEST(MemTrackerTest, CollisionDetection) {
 #endif
 }
 
+TEST(MemTrackerTest, ThreadCachedConsumption) {
+  google::FlagSaver saver;
+  FLAGS_mem_tracker_thread_cache_bytes = 1024;
+  shared_ptr<MemTracker> t = MemTracker::CreateTracker(-1, "t");
+
+  // Small updates are batched in the per-thread cache and not immediately
+  // visible in the shared hierarchy.
+  t->Consume(100);
+  ASSERT_EQ(0, t->consumption());
+
+  // Crossing the threshold propagates the full pending delta.
+  t->Consume(1024);
+  ASSERT_EQ(1124, t->consumption());
+
+  // Releases are batched the same way.
+  t->Release(100);
+  ASSERT_EQ(1124, t->consumption());
+  t->Release(1024);
+  ASSERT_EQ(0, t->consumption());
+
+  // A thread's cache is flushed when the thread exits.
+  std::thread consumer([&]{ t->Consume(100); });
+  consumer.join();
+  ASSERT_EQ(100, t->consumption());
+  std::thread releaser([&]{ t->Release(100); });
+  releaser.join();
+  ASSERT_EQ(0, t->consumption());
+}
+
 TEST(MemTrackerTest, TestMultiThreadedRegisterAndDestroy) {
   std::atomic<bool> done(false);
   vector<std::thread> threads;
@@ -24,6 +24,8 @@
 #include <memory>
 #include <mutex>
 #include <sstream>
+#include <unordered_map>
+#include <utility>
 
 #include <gperftools/malloc_extension.h>
 
@@ -39,6 +41,7 @@
 #include "kudu/util/mutex.h"
 #include "kudu/util/random_util.h"
 #include "kudu/util/status.h"
+#include "kudu/util/threadlocal.h"
 
 DEFINE_int64(memory_limit_hard_bytes, 0,
              "Maximum amount of memory this daemon should use, in bytes. "
@@ -59,6 +62,17 @@ DEFINE_int32(memory_limit_warn_threshold_percentage, 98,
              "consume before WARNING level messages are periodically logged.");
 TAG_FLAG(memory_limit_warn_threshold_percentage, advanced);
 
+DEFINE_int32(mem_tracker_thread_cache_bytes, 0,
+             "If non-zero, batch memory tracker consumption updates in a "
+             "per-thread cache, and only propagate them to the shared "
+             "tracker hierarchy once the cached delta for a tracker exceeds "
+             "this many bytes (or the thread exits). This removes a chain of "
+             "atomic operations from every allocation event at the cost of "
+             "reported consumption (and therefore limit enforcement) lagging "
+             "actual usage by up to the threshold per thread per tracker. "
+             "A value of 0 disables the cache.");
+TAG_FLAG(mem_tracker_thread_cache_bytes, experimental);
+
 #ifdef TCMALLOC_ENABLED
 DEFINE_int32(tcmalloc_max_free_bytes_percentage, 10,
              "Maximum percentage of the RSS that tcmalloc is allowed to use for "
@@ -120,6 +134,81 @@ static int64_t GetTCMallocCurrentAllocatedBytes() {
 }
 #endif
 
+// Per-thread cache of pending consumption deltas, analogous to tcmalloc's
+// per-thread free lists. Consume()/Release() calls accumulate here and are
+// only propagated to the shared tracker hierarchy (a chain of atomic adds)
+// once the pending delta for a tracker crosses the configured threshold.
+//
+// Each cached entry holds a strong reference to its tracker so that a
+// tracker with unflushed deltas cannot be destroyed; the reference is
+// dropped when the entry is flushed. All remaining entries are flushed when
+// the thread exits.
+class MemTrackerThreadCache {
+ public:
+  MemTrackerThreadCache() {}
+
+  ~MemTrackerThreadCache() {
+    FlushAll();
+  }
+
+  static MemTrackerThreadCache* GetForThread() {
+    BLOCK_STATIC_THREAD_LOCAL(MemTrackerThreadCache, cache);
+    return cache;
+  }
+
+  void Record(MemTracker* tracker, int64_t delta, int64_t threshold) {
+    auto it = cache_.find(tracker);
+    if (it == cache_.end()) {
+      // Bound the number of trackers which may be kept alive by this
+      // thread's unflushed deltas.
+      if (cache_.size() >= kMaxCachedTrackers) {
+        FlushAll();
+      }
+      it = cache_.emplace(tracker, Entry()).first;
+      it->second.tracker = tracker->shared_from_this();
+    }
+    it->second.pending += delta;
+    if (it->second.pending >= threshold || it->second.pending <= -threshold) {
+      Flush(it);
+    }
+  }
+
+ private:
+  struct Entry {
+    std::shared_ptr<MemTracker> tracker;
+    int64_t pending = 0;
+  };
+
+  typedef std::unordered_map<const MemTracker*, Entry> CacheMap;
+
+  static const int kMaxCachedTrackers = 16;
+
+  void Flush(CacheMap::iterator it) {
+    int64_t pending = it->second.pending;
+    shared_ptr<MemTracker> tracker = std::move(it->second.tracker);
+    cache_.erase(it);
+    if (pending == 0) return;
+    if (pending < 0 &&
+        PREDICT_FALSE(base::subtle::Barrier_AtomicIncrement(
+            &released_memory_since_gc, -pending) > MemTracker::GC_RELEASE_SIZE)) {
+      tracker->GcTcmalloc();
+    }
+    tracker->ApplyConsumptionDelta(pending);
+    // Dropping 'tracker' here may destroy the MemTracker, now that its
+    // consumption is up to date.
+  }
+
+  void FlushAll() {
+    while (!cache_.empty()) {
+      Flush(cache_.begin());
+    }
+  }
+
+  CacheMap cache_;
+
+  DISALLOW_COPY_AND_ASSIGN(MemTrackerThreadCache);
+};
+
 void MemTracker::CreateRootTracker() {
   int64_t limit = FLAGS_memory_limit_hard_bytes;
   if (limit == 0) {
@@ -303,17 +392,44 @@ void MemTracker::Consume(int64_t bytes) {
   if (bytes == 0) {
     return;
   }
+  if (TryCacheDelta(bytes)) {
+    return;
+  }
   if (PREDICT_FALSE(enable_logging_)) {
     LogUpdate(true, bytes);
   }
+  ApplyConsumptionDelta(bytes);
+}
+
+void MemTracker::ApplyConsumptionDelta(int64_t delta) {
   for (auto& tracker : all_trackers_) {
-    tracker->consumption_.IncrementBy(bytes);
+    tracker->consumption_.IncrementBy(delta);
+    // If a UDF calls FunctionContext::TrackAllocation() but allocates less than the
+    // reported amount, the subsequent call to FunctionContext::Free() may cause the
+    // process mem tracker to go negative until it is synced back to the tcmalloc
+    // metric. Don't blow up in this case. (Note that this doesn't affect non-process
+    // trackers since we can enforce that the reported memory usage is internally
+    // consistent.)
     if (!tracker->consumption_func_.empty()) {
       DCHECK_GE(tracker->consumption_.current_value(), 0);
     }
   }
 }
 
+bool MemTracker::TryCacheDelta(int64_t delta) {
+  int64_t threshold = FLAGS_mem_tracker_thread_cache_bytes;
+  if (PREDICT_TRUE(threshold == 0)) {
+    return false;
+  }
+  // Apply updates directly when logging so that LogUpdate() reflects every
+  // individual call.
+  if (PREDICT_FALSE(enable_logging_)) {
+    return false;
+  }
+  MemTrackerThreadCache::GetForThread()->Record(this, delta, threshold);
+  return true;
+}
+
 bool MemTracker::TryConsume(int64_t bytes) {
   if (!consumption_func_.empty()) {
     UpdateConsumption();
@@ -374,35 +490,38 @@ void MemTracker::Release(int64_t bytes) {
     return;
   }
 
-  if (PREDICT_FALSE(base::subtle::Barrier_AtomicIncrement(&released_memory_since_gc, bytes) >
-                    GC_RELEASE_SIZE)) {
-    GcTcmalloc();
+  if (bytes == 0) {
+    if (!consumption_func_.empty()) {
+      UpdateConsumption();
+    }
+    return;
   }
 
   if (!consumption_func_.empty()) {
+    if (PREDICT_FALSE(base::subtle::Barrier_AtomicIncrement(&released_memory_since_gc, bytes) >
+                      GC_RELEASE_SIZE)) {
+      GcTcmalloc();
+    }
     UpdateConsumption();
     return;
   }
 
-  if (bytes == 0) {
+  // When the update is absorbed by the per-thread cache, the released bytes
+  // are accounted against GC_RELEASE_SIZE at flush time instead.
+  if (TryCacheDelta(-bytes)) {
     return;
   }
+
+  if (PREDICT_FALSE(base::subtle::Barrier_AtomicIncrement(&released_memory_since_gc, bytes) >
+                    GC_RELEASE_SIZE)) {
+    GcTcmalloc();
+  }
+
   if (PREDICT_FALSE(enable_logging_)) {
     LogUpdate(false, bytes);
   }
 
-  for (auto& tracker : all_trackers_) {
-    tracker->consumption_.IncrementBy(-bytes);
-    // If a UDF calls FunctionContext::TrackAllocation() but allocates less than the
-    // reported amount, the subsequent call to FunctionContext::Free() may cause the
-    // process mem tracker to go negative until it is synced back to the tcmalloc
-    // metric. Don't blow up in this case. (Note that this doesn't affect non-process
-    // trackers since we can enforce that the reported memory usage is internally
-    // consistent.)
-    if (!tracker->consumption_func_.empty()) {
-      DCHECK_GE(tracker->consumption_.current_value(), 0);
-    }
-  }
+  ApplyConsumptionDelta(-bytes);
 }
 
 bool MemTracker::AnyLimitExceeded() {
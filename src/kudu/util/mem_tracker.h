@@ -34,6 +34,7 @@ namespace kudu {
 
 class Status;
 class MemTracker;
+class MemTrackerThreadCache;
 
 // A MemTracker tracks memory consumption; it contains an optional limit and is
 // arranged into a tree structure such that the consumption tracked by a
@@ -138,6 +139,11 @@ class MemTracker : public std::enable_shared_from_this<MemTracker> {
   void UpdateConsumption();
 
   // Increases consumption of this tracker and its ancestors by 'bytes'.
+  //
+  // If --mem_tracker_thread_cache_bytes is non-zero, small updates are
+  // batched in a per-thread cache and only propagated to the shared tracker
+  // hierarchy once the cached delta crosses the threshold, so consumption()
+  // may lag the true value by up to the threshold per thread.
   void Consume(int64_t bytes);
 
   // Try to expand the limit (by asking the resource broker for more memory) by at least
@@ -222,6 +228,8 @@ class MemTracker : public std::enable_shared_from_this<MemTracker> {
   std::string ToString() const;
 
  private:
+  friend class MemTrackerThreadCache;
+
   // Function signatures for gauge-style memory trackers (where consumption is
   // periodically observed rather than explicitly tracked).
   //
@@ -250,6 +258,15 @@ class MemTracker : public std::enable_shared_from_this<MemTracker> {
   // can cause us to go way over mem limits.
   void GcTcmalloc();
 
+  // Applies a (possibly negative) consumption delta to this tracker and all
+  // of its ancestors, bypassing the per-thread cache.
+  void ApplyConsumptionDelta(int64_t delta);
+
+  // If per-thread consumption caching is enabled, records 'delta' in the
+  // current thread's cache and returns true. Returns false if the update
+  // should be applied directly.
+  bool TryCacheDelta(int64_t delta);
+
   // Further initializes the tracker.
   void Init();
 
@@ -101,6 +101,50 @@ TEST(TestArena, TestAlignment) {
   }
 }
 
+TEST(TestArena, TestSlabPoolBufferAllocator) {
+  SlabPoolBufferAllocator allocator(HeapBufferAllocator::Get(), 1024, 4);
+  ASSERT_EQ(0, allocator.num_free_slabs());
+
+  // Freeing a slab-sized buffer should return it to the pool, and the next
+  // slab-sized allocation should be served from the pool.
+  Buffer* buf = allocator.Allocate(1024);
+  ASSERT_TRUE(buf != nullptr);
+  void* slab_data = buf->data();
+  delete buf;
+  ASSERT_EQ(1, allocator.num_free_slabs());
+  buf = allocator.Allocate(1024);
+  ASSERT_EQ(slab_data, buf->data());
+  ASSERT_EQ(0, allocator.num_free_slabs());
+  delete buf;
+
+  // Other sizes pass through to the delegate and are not pooled.
+  buf = allocator.Allocate(512);
+  ASSERT_TRUE(buf != nullptr);
+  delete buf;
+  ASSERT_EQ(1, allocator.num_free_slabs());
+
+  // The pool retains no more than its configured maximum number of slabs.
+  Buffer* bufs[6];
+  for (Buffer*& b : bufs) {
+    b = allocator.Allocate(1024);
+    ASSERT_TRUE(b != nullptr);
+  }
+  ASSERT_EQ(0, allocator.num_free_slabs());
+  for (Buffer* b : bufs) {
+    delete b;
+  }
+  ASSERT_EQ(4, allocator.num_free_slabs());
+
+  // An arena backed by the pool draws its chunks from it and returns them
+  // when destroyed.
+  {
+    Arena arena(&allocator, 1024, 1024);
+    ASSERT_TRUE(arena.AllocateBytes(512) != nullptr);
+    ASSERT_EQ(3, allocator.num_free_slabs());
+  }
+  ASSERT_EQ(4, allocator.num_free_slabs());
+}
+
 // MemTrackers update their ancestors when consuming and releasing memory to compute
 // usage totals. However, the lifetimes of parent and child trackers can be different.
 // Validate that child trackers can still correctly update their parent stats even when
@@ -278,6 +278,14 @@ class Arena : public ArenaBase<false> {
   explicit Arena(size_t initial_buffer_size, size_t max_buffer_size) :
     ArenaBase<false>(initial_buffer_size, max_buffer_size)
   {}
+
+  // As above, but draw buffers from 'buffer_allocator' (not owned) instead
+  // of the heap.
+  Arena(BufferAllocator* buffer_allocator,
+        size_t initial_buffer_size,
+        size_t max_buffer_size) :
+    ArenaBase<false>(buffer_allocator, initial_buffer_size, max_buffer_size)
+  {}
 };
 
 class ThreadSafeArena : public ArenaBase<true> {
@@ -24,6 +24,7 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <mutex>
 
 #include <gflags/gflags.h>
 
@@ -194,6 +195,71 @@ void ClearingBufferAllocator::FreeInternal(Buffer* buffer) {
   DelegateFree(delegate_, buffer);
 }
 
+SlabPoolBufferAllocator::SlabPoolBufferAllocator(BufferAllocator* delegate,
+                                                 size_t slab_size,
+                                                 size_t max_free_slabs)
+    : delegate_(delegate),
+      slab_size_(slab_size),
+      max_free_slabs_(max_free_slabs) {
+  CHECK_GT(slab_size_, 0);
+  free_slabs_.reserve(max_free_slabs_);
+}
+
+SlabPoolBufferAllocator::~SlabPoolBufferAllocator() {
+  for (void* slab : free_slabs_) {
+    // Hand each pooled slab back to the delegate which originally allocated
+    // it. The temporary Buffer routes its destruction through the delegate.
+    gscoped_ptr<Buffer> buffer(CreateBuffer(slab, slab_size_, delegate_));
+  }
+}
+
+size_t SlabPoolBufferAllocator::num_free_slabs() const {
+  std::lock_guard<simple_spinlock> l(free_slabs_lock_);
+  return free_slabs_.size();
+}
+
+Buffer* SlabPoolBufferAllocator::AllocateInternal(
+    const size_t requested,
+    const size_t minimal,
+    BufferAllocator* const originator) {
+  if (requested == slab_size_ && minimal <= slab_size_) {
+    void* slab = nullptr;
+    {
+      std::lock_guard<simple_spinlock> l(free_slabs_lock_);
+      if (!free_slabs_.empty()) {
+        slab = free_slabs_.back();
+        free_slabs_.pop_back();
+      }
+    }
+    if (slab != nullptr) {
+      return CreateBuffer(slab, slab_size_, originator);
+    }
+  }
+  return DelegateAllocate(delegate_, requested, minimal, originator);
+}
+
+bool SlabPoolBufferAllocator::ReallocateInternal(
+    const size_t requested,
+    const size_t minimal,
+    Buffer* const buffer,
+    BufferAllocator* const originator) {
+  // Every slab was originally allocated by the delegate, so the delegate can
+  // reallocate it directly. Whatever size the buffer ends up with decides
+  // whether it returns to the pool when freed.
+  return DelegateReallocate(delegate_, requested, minimal, buffer, originator);
+}
+
+void SlabPoolBufferAllocator::FreeInternal(Buffer* buffer) {
+  if (buffer->size() == slab_size_) {
+    std::lock_guard<simple_spinlock> l(free_slabs_lock_);
+    if (free_slabs_.size() < max_free_slabs_) {
+      free_slabs_.push_back(buffer->data());
+      return;
+    }
+  }
+  DelegateFree(delegate_, buffer);
+}
+
 Buffer* MediatingBufferAllocator::AllocateInternal(
     const size_t requested,
     const size_t minimal,
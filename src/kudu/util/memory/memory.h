@@ -40,6 +40,7 @@
 #include <vector>
 
 #include "kudu/util/boost_mutex_utils.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/memory/overwrite.h"
 #include "kudu/util/mutex.h"
 #include "kudu/gutil/gscoped_ptr.h"
@@ -319,6 +320,60 @@ class ClearingBufferAllocator : public BufferAllocator {
   DISALLOW_COPY_AND_ASSIGN(ClearingBufferAllocator);
 };
 
+// An allocator which recycles fixed-size buffers ("slabs") through a free
+// list instead of returning them to the underlying allocator. Allocation
+// requests for exactly 'slab_size' bytes are served from the free list when
+// possible; all other requests, and slabs freed while the free list is full,
+// pass through to the delegate. A steady-state workload which repeatedly
+// creates and destroys same-sized scratch arenas (e.g. the per-transaction
+// arenas on the write path) thus performs no large heap allocations at all.
+//
+// Thread-safe. The free list is guarded by a spinlock whose critical section
+// is a single pointer push or pop.
+//
+// NOTE: slabs sitting in the free list were allocated from the delegate and
+// are only handed back to it when this allocator is destroyed, so any memory
+// accounting done by the delegate includes the pooled slabs.
+class SlabPoolBufferAllocator : public BufferAllocator {
+ public:
+  // Does not take ownership of 'delegate', which must outlive this object.
+  // At most 'max_free_slabs' free slabs of 'slab_size' bytes are retained.
+  SlabPoolBufferAllocator(BufferAllocator* delegate,
+                          size_t slab_size,
+                          size_t max_free_slabs);
+  virtual ~SlabPoolBufferAllocator();
+
+  virtual size_t Available() const OVERRIDE {
+    return delegate_->Available();
+  }
+
+  size_t slab_size() const { return slab_size_; }
+
+  // Return the number of slabs currently sitting in the free list.
+  size_t num_free_slabs() const;
+
+ private:
+  virtual Buffer* AllocateInternal(size_t requested,
+                                   size_t minimal,
+                                   BufferAllocator* originator) OVERRIDE;
+
+  virtual bool ReallocateInternal(size_t requested,
+                                  size_t minimal,
+                                  Buffer* buffer,
+                                  BufferAllocator* originator) OVERRIDE;
+
+  virtual void FreeInternal(Buffer* buffer) OVERRIDE;
+
+  BufferAllocator* const delegate_;
+  const size_t slab_size_;
+  const size_t max_free_slabs_;
+
+  mutable simple_spinlock free_slabs_lock_;
+  std::vector<void*> free_slabs_;
+
+  DISALLOW_COPY_AND_ASSIGN(SlabPoolBufferAllocator);
+};
+
 // Abstract policy for modifying allocation requests - e.g. enforcing quotas.
 class Mediator {
  public:
@@ -18,6 +18,7 @@
 #include <gtest/gtest.h>
 #include <rapidjson/document.h>
 #include <string>
+#include <thread>
 #include <unordered_set>
 #include <vector>
 
@@ -33,6 +34,7 @@ using std::string;
 using std::unordered_set;
 using std::vector;
 
+DECLARE_bool(metrics_striped_histograms);
 DECLARE_int32(metrics_retirement_age_ms);
 
 namespace kudu {
@@ -165,6 +167,40 @@ TEST_F(MetricsTest, SimpleHistogramTest) {
   // TODO: Test coverage needs to be improved a lot.
 }
 
+TEST_F(MetricsTest, StripedHistogramTest) {
+  google::FlagSaver saver;
+  FLAGS_metrics_striped_histograms = true;
+  scoped_refptr<Histogram> hist = METRIC_test_hist.Instantiate(entity_);
+  ASSERT_TRUE(hist->striped_histogram_ != nullptr);
+
+  hist->Increment(2);
+  hist->IncrementBy(4, 1);
+  ASSERT_EQ(2, hist->MinValueForTests());
+  ASSERT_EQ(3, hist->MeanValueForTests());
+  ASSERT_EQ(4, hist->MaxValueForTests());
+  ASSERT_EQ(2, hist->TotalCount());
+
+  // Record from a bunch of threads so that multiple stripes are populated,
+  // and verify that reads merge them all.
+  const int kNumThreads = 8;
+  const int kRecordsPerThread = 1000;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&]{
+        for (int j = 0; j < kRecordsPerThread; j++) {
+          hist->Increment(10);
+        }
+      });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(2 + kNumThreads * kRecordsPerThread, hist->TotalCount());
+  ASSERT_EQ(10, hist->MaxValueForTests());
+  ASSERT_EQ(kNumThreads * kRecordsPerThread,
+            hist->CountInBucketForValueForTests(10));
+}
+
 TEST_F(MetricsTest, JsonPrintTest) {
   scoped_refptr<Counter> bytes_seen = METRIC_reqs_pending.Instantiate(entity_);
   bytes_seen->Increment();
@@ -36,6 +36,14 @@
 #include "kudu/util/locks.h"
 #include "kudu/util/status.h"
 
+DEFINE_bool(metrics_striped_histograms, false,
+            "Record histogram metrics into per-core stripes which are merged "
+            "when the metric is read. This reduces cache-line contention on "
+            "hot histograms (e.g. RPC latencies) on machines with many cores, "
+            "at the cost of additional memory for each histogram stripe that "
+            "a recording thread touches.");
+TAG_FLAG(metrics_striped_histograms, experimental);
+
 DEFINE_int32(metrics_retirement_age_ms, 120 * 1000,
              "The minimum number of milliseconds a metric will be kept for after it is "
              "no longer active. (Advanced option)");
@@ -253,7 +261,9 @@ Status MetricEntity::WriteAsJson(JsonWriter* writer,
 }
 
 void MetricEntity::RetireOldMetrics() {
-  MonoTime now(MonoTime::Now());
+  // Metric retirement operates on a timescale of minutes, so the coarse
+  // clock is more than precise enough.
+  MonoTime now(MonoTime::NowCoarse());
 
   std::lock_guard<simple_spinlock> l(lock_);
   for (auto it = metric_map_.begin(); it != metric_map_.end();) {
@@ -592,15 +602,39 @@ scoped_refptr<Histogram> HistogramPrototype::Instantiate(
 
 Histogram::Histogram(const HistogramPrototype* proto)
   : Metric(proto),
-    histogram_(new HdrHistogram(proto->max_trackable_value(), proto->num_sig_digits())) {
+    histogram_(FLAGS_metrics_striped_histograms
+               ? nullptr
+               : new HdrHistogram(proto->max_trackable_value(), proto->num_sig_digits())),
+    striped_histogram_(FLAGS_metrics_striped_histograms
+                       ? new StripedHdrHistogram(proto->max_trackable_value(),
+                                                 proto->num_sig_digits())
+                       : nullptr) {
 }
 
 void Histogram::Increment(int64_t value) {
-  histogram_->Increment(value);
+  if (striped_histogram_) {
+    striped_histogram_->Increment(value);
+  } else {
+    histogram_->Increment(value);
+  }
 }
 
 void Histogram::IncrementBy(int64_t value, int64_t amount) {
-  histogram_->IncrementBy(value, amount);
+  if (striped_histogram_) {
+    striped_histogram_->IncrementBy(value, amount);
+  } else {
+    histogram_->IncrementBy(value, amount);
+  }
+}
+
+void Histogram::SnapshotForReading(gscoped_ptr<HdrHistogram>* snapshot) const {
+  if (striped_histogram_) {
+    snapshot->reset(new HdrHistogram(striped_histogram_->highest_trackable_value(),
+                                     striped_histogram_->num_significant_digits()));
+    striped_histogram_->MergeTo(snapshot->get());
+  } else {
+    snapshot->reset(new HdrHistogram(*histogram_));
+  }
 }
 
 Status Histogram::WriteAsJson(JsonWriter* writer,
@@ -614,7 +648,9 @@ Status Histogram::WriteAsJson(JsonWriter* writer,
 
 Status Histogram::GetHistogramSnapshotPB(HistogramSnapshotPB* snapshot_pb,
                                          const MetricJsonOptions& opts) const {
-  HdrHistogram snapshot(*histogram_);
+  gscoped_ptr<HdrHistogram> snapshot_ptr;
+  SnapshotForReading(&snapshot_ptr);
+  const HdrHistogram& snapshot = *snapshot_ptr;
   snapshot_pb->set_name(prototype_->name());
   if (opts.include_schema_info) {
     snapshot_pb->set_type(MetricType::Name(prototype_->type()));
@@ -648,22 +684,40 @@ Status Histogram::GetHistogramSnapshotPB(HistogramSnapshotPB* snapshot_pb,
 }
 
 uint64_t Histogram::CountInBucketForValueForTests(uint64_t value) const {
-  return histogram_->CountInBucketForValue(value);
+  gscoped_ptr<HdrHistogram> snapshot;
+  SnapshotForReading(&snapshot);
+  return snapshot->CountInBucketForValue(value);
 }
 
 uint64_t Histogram::TotalCount() const {
+  if (striped_histogram_) {
+    return striped_histogram_->TotalCount();
+  }
   return histogram_->TotalCount();
 }
 
+uint64_t Histogram::TotalSum() const {
+  if (striped_histogram_) {
+    return striped_histogram_->TotalSum();
+  }
+  return histogram_->TotalSum();
+}
+
 uint64_t Histogram::MinValueForTests() const {
-  return histogram_->MinValue();
+  gscoped_ptr<HdrHistogram> snapshot;
+  SnapshotForReading(&snapshot);
+  return snapshot->MinValue();
 }
 
 uint64_t Histogram::MaxValueForTests() const {
-  return histogram_->MaxValue();
+  gscoped_ptr<HdrHistogram> snapshot;
+  SnapshotForReading(&snapshot);
+  return snapshot->MaxValue();
 }
 double Histogram::MeanValueForTests() const {
-  return histogram_->MeanValue();
+  gscoped_ptr<HdrHistogram> snapshot;
+  SnapshotForReading(&snapshot);
+  return snapshot->MeanValue();
 }
 
 ScopedLatencyMetric::ScopedLatencyMetric(Histogram* latency_hist)
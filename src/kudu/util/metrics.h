@@ -339,6 +339,7 @@ class HdrHistogram;
 class Histogram;
 class HistogramPrototype;
 class HistogramSnapshotPB;
+class StripedHdrHistogram;
 
 class MetricEntity;
 
@@ -980,6 +981,9 @@ class Histogram : public Metric {
   // or IncrementBy()).
   uint64_t TotalCount() const;
 
+  // Return the sum of all values added to the histogram.
+  uint64_t TotalSum() const;
+
   virtual Status WriteAsJson(JsonWriter* w,
                              const MetricJsonOptions& opts) const OVERRIDE;
 
@@ -994,10 +998,20 @@ class Histogram : public Metric {
 
  private:
   FRIEND_TEST(MetricsTest, SimpleHistogramTest);
+  FRIEND_TEST(MetricsTest, StripedHistogramTest);
   friend class MetricEntity;
   explicit Histogram(const HistogramPrototype* proto);
 
+  // Set 'snapshot' to a merged snapshot of the histogram suitable for
+  // reading. Not a consistent snapshot in the presence of concurrent writers.
+  void SnapshotForReading(gscoped_ptr<HdrHistogram>* snapshot) const;
+
+  // Exactly one of the two members below is non-NULL: when
+  // --metrics_striped_histograms is enabled, values are recorded into
+  // 'striped_histogram_' (per-core stripes, merged on read); otherwise they
+  // are recorded directly into 'histogram_'.
   const gscoped_ptr<HdrHistogram> histogram_;
+  const gscoped_ptr<StripedHdrHistogram> striped_histogram_;
   DISALLOW_COPY_AND_ASSIGN(Histogram);
 };
 
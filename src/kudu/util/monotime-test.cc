@@ -40,6 +40,19 @@ TEST(TestMonoTime, TestMonotonicity) {
   alarm(0);
 }
 
+TEST(TestMonoTime, TestNowCoarse) {
+  // The coarse clock ticks at the granularity of the kernel timer interrupt,
+  // so it may lag the precise clock, but it must never run ahead of it.
+  MonoTime before(MonoTime::Now());
+  MonoTime coarse(MonoTime::NowCoarse());
+  MonoTime after(MonoTime::Now());
+
+  ASSERT_TRUE(coarse.Initialized());
+  ASSERT_TRUE(coarse <= after);
+  // Allow generous slack for the tick-level resolution of the coarse clock.
+  ASSERT_TRUE(coarse >= before - MonoDelta::FromMilliseconds(100));
+}
+
 TEST(TestMonoTime, TestComparison) {
   MonoTime now(MonoTime::Now());
   MonoTime future(now);
@@ -173,6 +173,16 @@ MonoTime MonoTime::Now() {
 #endif // defined(__APPLE__)
 }
 
+MonoTime MonoTime::NowCoarse() {
+#if defined(CLOCK_MONOTONIC_COARSE)
+  struct timespec ts;
+  PCHECK(clock_gettime(CLOCK_MONOTONIC_COARSE, &ts) == 0);
+  return MonoTime(ts);
+#else
+  return Now();
+#endif // defined(CLOCK_MONOTONIC_COARSE)
+}
+
 MonoTime MonoTime::Max() {
   return MonoTime(std::numeric_limits<int64_t>::max());
 }
@@ -160,6 +160,20 @@ class KUDU_EXPORT MonoTime {
   /// @return Time specification for the moment of the method's invocation.
   static MonoTime Now();
 
+  /// Get a coarse-resolution snapshot of the current time.
+  ///
+  /// Reads the kernel's cached coarse clock source, which is updated once
+  /// per kernel tick (typically every 1-4 milliseconds) and is several
+  /// times cheaper to read than Now(). Use this in hot paths which only
+  /// need approximate time, e.g. queue-time accounting or idle-expiry
+  /// checks. The returned value never runs ahead of Now(), but may lag it
+  /// by up to one tick. Falls back to Now() on platforms without a coarse
+  /// clock source.
+  ///
+  /// @return Coarse time specification for the moment of the method's
+  ///   invocation.
+  static MonoTime NowCoarse();
+
   /// @return MonoTime equal to farthest possible time into the future.
   static MonoTime Max();
 
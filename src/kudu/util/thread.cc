@@ -33,6 +33,7 @@
 #include <vector>
 
 #if defined(__linux__)
+#include <sched.h>
 #include <sys/prctl.h>
 #endif // defined(__linux__)
 
@@ -41,6 +42,7 @@
 #include "kudu/gutil/mathlimits.h"
 #include "kudu/gutil/once.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/sysinfo.h"
 #include "kudu/util/debug-util.h"
 #include "kudu/util/errno.h"
 #include "kudu/util/logging.h"
@@ -611,4 +613,18 @@ void Thread::FinishThread(void* arg) {
           << t->category() << ":" << t->name();
 }
 
+Status PinCurrentThreadToCpu(int cpu) {
+#if defined(__linux__)
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  CPU_SET(cpu % base::NumCPUs(), &cpuset);
+  if (sched_setaffinity(0, sizeof(cpuset), &cpuset) != 0) {
+    int err = errno;
+    return Status::RuntimeError("Unable to set thread CPU affinity",
+                                ErrnoToString(err), err);
+  }
+#endif // defined(__linux__)
+  return Status::OK();
+}
+
 } // namespace kudu
@@ -357,6 +357,11 @@ class Thread : public RefCountedThreadSafe<Thread> {
 // the given entity.
 Status StartThreadInstrumentation(const scoped_refptr<MetricEntity>& server_metrics,
                                   WebCallbackRegistry* web);
+
+// Pin the calling thread so that the scheduler only runs it on CPU
+// 'cpu' (taken modulo the number of configured CPUs). Returns an error
+// if the affinity could not be set. No-op on non-Linux platforms.
+Status PinCurrentThreadToCpu(int cpu);
 } // namespace kudu
 
 #endif /* KUDU_UTIL_THREAD_H */
@@ -187,20 +187,42 @@ Status ThreadPool::SubmitFunc(boost::function<void()> func) {
 }
 
 Status ThreadPool::Submit(std::shared_ptr<Runnable> task) {
-  MonoTime submit_time = MonoTime::Now();
+  // Build the queue entry before acquiring the lock: at high submission rates
+  // (e.g. the Raft prepare and apply pools) the lock is contended, so the
+  // critical section should be limited to the bookkeeping which actually
+  // requires it.
+  QueueEntry e;
+  e.runnable = std::move(task);
+  e.trace = Trace::CurrentTrace();
+  // Need to AddRef, since the thread which submitted the task may go away,
+  // and we don't want the trace to be destructed while waiting in the queue.
+  if (e.trace) {
+    e.trace->AddRef();
+  }
+  e.submit_time = MonoTime::Now();
 
   MutexLock guard(lock_);
   if (PREDICT_FALSE(!pool_status_.ok())) {
-    return pool_status_;
+    Status status = pool_status_;
+    guard.Unlock();
+    if (e.trace) {
+      e.trace->Release();
+    }
+    return status;
   }
 
   // Size limit check.
   int64_t capacity_remaining = static_cast<int64_t>(max_threads_) - active_threads_ +
                                static_cast<int64_t>(max_queue_size_) - queue_size_;
   if (capacity_remaining < 1) {
-    return Status::ServiceUnavailable(
+    Status status = Status::ServiceUnavailable(
         Substitute("Thread pool is at capacity ($0/$1 tasks running, $2/$3 tasks queued)",
                    num_threads_, max_threads_, queue_size_, max_queue_size_));
+    guard.Unlock();
+    if (e.trace) {
+      e.trace->Release();
+    }
+    return status;
   }
 
   // Should we create another thread?
@@ -228,21 +250,16 @@ Status ThreadPool::Submit(std::shared_ptr<Runnable> task) {
     }
   }
 
-  QueueEntry e;
-  e.runnable = std::move(task);
-  e.trace = Trace::CurrentTrace();
-  // Need to AddRef, since the thread which submitted the task may go away,
-  // and we don't want the trace to be destructed while waiting in the queue.
-  if (e.trace) {
-    e.trace->AddRef();
-  }
-  e.submit_time = submit_time;
-
   queue_.emplace_back(std::move(e));
   int length_at_submit = queue_size_++;
 
   guard.Unlock();
-  not_empty_.Signal();
+  // Only bother signalling when some thread may actually be waiting: if every
+  // worker is busy executing a task, each will re-check the queue before
+  // going to sleep, so the wakeup would be wasted work on the hot path.
+  if (inactive_threads > 0) {
+    not_empty_.Signal();
+  }
 
   if (queue_length_histogram_) {
     queue_length_histogram_->Increment(length_at_submit);
@@ -66,6 +66,22 @@ TEST_F(TraceTest, TestBasic) {
             result);
 }
 
+// A disabled trace should drop messages, while trace metrics continue to
+// be collected. Re-enabling resumes message collection.
+TEST_F(TraceTest, TestDisabledTrace) {
+  scoped_refptr<Trace> t(new Trace);
+  t->set_enabled(false);
+  TRACE_TO(t, "this message is dropped");
+  t->metrics()->Increment("my_counter", 1);
+  ASSERT_EQ("Metrics: {\"my_counter\":1}",
+            t->DumpToString(Trace::INCLUDE_ALL));
+
+  t->set_enabled(true);
+  TRACE_TO(t, "this message is recorded");
+  ASSERT_EQ("XXXX XX:XX:XX.XXXXXX trace-test.cc:XX] this message is recorded\n",
+            XOutDigits(t->DumpToString(Trace::NO_FLAGS)));
+}
+
 TEST_F(TraceTest, TestAttach) {
   scoped_refptr<Trace> traceA(new Trace);
   scoped_refptr<Trace> traceB(new Trace);
@@ -39,11 +39,18 @@ using strings::internal::SubstituteArg;
 __thread Trace* Trace::threadlocal_trace_;
 
 Trace::Trace()
-  : arena_(new ThreadSafeArena(1024, 128*1024)),
+  : enabled_(true),
     entries_head_(nullptr),
     entries_tail_(nullptr) {
 }
 
+ThreadSafeArena* Trace::arena() {
+  std::call_once(arena_once_, [this]() {
+      arena_.reset(new ThreadSafeArena(1024, 128*1024));
+    });
+  return arena_.get();
+}
+
 Trace::~Trace() {
 }
 
@@ -85,6 +92,9 @@ void Trace::SubstituteAndTrace(const char* file_path,
                                const SubstituteArg& arg4, const SubstituteArg& arg5,
                                const SubstituteArg& arg6, const SubstituteArg& arg7,
                                const SubstituteArg& arg8, const SubstituteArg& arg9) {
+  if (PREDICT_FALSE(!enabled_)) {
+    return;
+  }
   const SubstituteArg* const args_array[] = {
     &arg0, &arg1, &arg2, &arg3, &arg4, &arg5, &arg6, &arg7, &arg8, &arg9, nullptr
   };
@@ -97,7 +107,7 @@ void Trace::SubstituteAndTrace(const char* file_path,
 
 TraceEntry* Trace::NewEntry(int msg_len, const char* file_path, int line_number) {
   int size = sizeof(TraceEntry) + msg_len;
-  uint8_t* dst = reinterpret_cast<uint8_t*>(arena_->AllocateBytes(size));
+  uint8_t* dst = reinterpret_cast<uint8_t*>(arena()->AllocateBytes(size));
   TraceEntry* entry = reinterpret_cast<TraceEntry*>(dst);
   entry->timestamp_micros = GetCurrentTimeMicros();
   entry->message_len = msg_len;
@@ -246,7 +256,7 @@ void Trace::DumpCurrentTrace() {
 }
 
 void Trace::AddChildTrace(StringPiece label, Trace* child_trace) {
-  CHECK(arena_->RelocateStringPiece(label, &label));
+  CHECK(arena()->RelocateStringPiece(label, &label));
 
   std::lock_guard<simple_spinlock> l(lock_);
   scoped_refptr<Trace> ptr(child_trace);
@@ -18,6 +18,7 @@
 #define KUDU_UTIL_TRACE_H
 
 #include <iosfwd>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -201,6 +202,14 @@ class Trace : public RefCountedThreadSafe<Trace> {
     return metrics_;
   }
 
+  // Enable or disable message collection on this trace. When disabled,
+  // SubstituteAndTrace() returns without recording anything, so tracing a
+  // request costs only a predicted branch per message. Trace metrics are
+  // still collected. Must be called before the trace is shared with other
+  // threads.
+  void set_enabled(bool enabled) { enabled_ = enabled; }
+  bool enabled() const { return enabled_; }
+
  private:
   friend class ScopedAdoptTrace;
   friend class RefCountedThreadSafe<Trace>;
@@ -220,6 +229,15 @@ class Trace : public RefCountedThreadSafe<Trace> {
 
   void MetricsToJSON(JsonWriter* jw) const;
 
+  // Return the arena used to allocate trace entries, creating it on first
+  // use. A trace which never records a message never allocates an arena.
+  ThreadSafeArena* arena();
+
+  // Whether messages are recorded; see set_enabled().
+  bool enabled_;
+
+  // Lazily-created on the first recorded entry; see arena().
+  std::once_flag arena_once_;
   gscoped_ptr<ThreadSafeArena> arena_;
 
   // Lock protecting the entries linked list.
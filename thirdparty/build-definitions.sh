@@ -408,12 +408,12 @@ build_bitshuffle() {
   # bitshuffle depends on lz4, therefore set the flag I$PREFIX/include
 
   # This library has significant optimizations when built with -mavx2. However,
-  # we still need to support non-AVX2-capable hardware. So, we build it twice,
-  # once with the flag and once without, and use some linker tricks to
-  # suffix the AVX2 symbols with '_avx2'. OSX doesn't have objcopy, so we only
-  # do this trick on Linux.
+  # we still need to support non-AVX2-capable hardware. So, we build it several
+  # times, once per instruction set extension, and use some linker tricks to
+  # suffix the extension-specific symbols (e.g. '_avx2'). OSX doesn't have
+  # objcopy, so we only do this trick on Linux.
   if [ -n "$OS_LINUX" ]; then
-    arches="default avx2"
+    arches="default avx2 avx512"
   else
     arches="default"
   fi
@@ -422,6 +422,14 @@ build_bitshuffle() {
     arch_flag=""
     if [ "$arch" == "avx2" ]; then
       arch_flag="-mavx2"
+    elif [ "$arch" == "avx512" ]; then
+      # Older compilers don't support the AVX-512 flags. In that case, build
+      # the '_avx512' symbols from the default flags instead so that the
+      # symbols referenced by the runtime dispatch code always exist; the
+      # runtime selection just won't yield any speedup on such builds.
+      if echo | ${CC:-gcc} -mavx512f -mavx512bw -std=c99 -xc -c - -o /dev/null 2>/dev/null; then
+        arch_flag="-mavx512f -mavx512bw"
+      fi
     fi
     tmp_obj=bitshuffle_${arch}_tmp.o
     dst_obj=bitshuffle_${arch}.o
@@ -431,8 +439,8 @@ build_bitshuffle() {
       "$BITSHUFFLE_SOURCE/src/iochain.c"
     # Merge the object files together to produce a combined .o file.
     ld -r -o $tmp_obj bitshuffle_core.o bitshuffle.o iochain.o
-    # For the AVX2 symbols, suffix them.
-    if [ "$arch" == "avx2" ]; then
+    # For the extension-specific symbols, suffix them.
+    if [ "$arch" != "default" ]; then
       # Create a mapping file with '<old_sym> <suffixed_sym>' on each line.
       nm --defined-only --extern-only $tmp_obj | while read addr type sym ; do
         echo ${sym} ${sym}_${arch}